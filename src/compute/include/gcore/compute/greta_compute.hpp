@@ -1,5 +1,6 @@
 #pragma once
 #include "gcore/rt/greta_runtime.hpp"
+#include "gcore/rt/op_cost.hpp"
 #include <cstdint>
 #include <string>
 
@@ -39,6 +40,8 @@ struct GemmAuditInfo {
   uint64_t scales_hash = 0;
   uintptr_t head_scales_ptr = 0;
   uint64_t head_scales_hash = 0;
+  uint64_t flops = 0; // Analytic, see GretaCompute::gemm_cost()
+  uint64_t bytes = 0;
 };
 
 class GretaCompute {
@@ -48,6 +51,12 @@ public:
                           bool transpose_A = false, bool transpose_B = false,
                           GretaDataType accum_type = GretaDataType::FP32);
 
+  // FLOPs and compulsory bytes of gemm(A, B, C, M, N, K) from the operand
+  // dtypes and B's quantization scales. gemm() charges it to the calling
+  // thread's innermost ProfileSpan.
+  static OpCost gemm_cost(const GretaMemory *A, const GretaMemory *B,
+                          uint32_t M, uint32_t N, uint32_t K);
+
   static GretaResult
   attention_decode(GretaStream *stream, GretaMemory *Q, GretaMemory *K_cache,
                    GretaMemory *V_cache, GretaMemory *d_pos, GretaMemory *O,
@@ -3,6 +3,7 @@
 #include "gcore/rt/hip/kernels/attention_kernels.hpp"
 #include "gcore/rt/hip/kernels/fused_attention_kernels.hpp"
 #include "gcore/rt/hip/kernels/gemm_kernels.hpp"
+#include "gcore/rt/profiler.hpp"
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -140,6 +141,25 @@ static std::string dtype_name(gcore::rt::GretaDataType t) {
   }
 }
 
+// Storage bits per element (Q4_K packs 256 weights in 144 bytes).
+static double dtype_bits(gcore::rt::GretaDataType t) {
+  switch (t) {
+  case gcore::rt::GretaDataType::FP16:
+  case gcore::rt::GretaDataType::BF16:
+    return 16.0;
+  case gcore::rt::GretaDataType::INT8:
+  case gcore::rt::GretaDataType::FP8_E4M3:
+  case gcore::rt::GretaDataType::FP8_E5M2:
+    return 8.0;
+  case gcore::rt::GretaDataType::INT4:
+    return 4.0;
+  case gcore::rt::GretaDataType::Q4_K:
+    return 4.5;
+  default:
+    return 32.0;
+  }
+}
+
 namespace gcore::compute {
 
 using namespace gcore::rt::hip;
@@ -237,6 +257,11 @@ GretaResult GretaCompute::gemm(GretaStream *stream, GretaMemory *A,
   GretaDataType type_B = B->data_type();
 
   const bool trace_audit = trace_lmhead_enabled() && is_lm_head;
+  OpCost cost;
+  if (trace_audit || gcore::rt::ProfileSpan::charging()) {
+    cost = gemm_cost(A, B, M, N, K);
+    gcore::rt::ProfileSpan::charge(cost);
+  }
   if (trace_audit) {
     auto &info = last_gemm_audit();
     info.op_label = op_label;
@@ -265,6 +290,8 @@ GretaResult GretaCompute::gemm(GretaStream *stream, GretaMemory *A,
     info.scales_hash = 0;
     info.head_scales_ptr = 0;
     info.head_scales_hash = 0;
+    info.flops = cost.flops;
+    info.bytes = cost.bytes;
     if ((type_B == GretaDataType::INT4 || type_B == GretaDataType::INT8)) {
       auto qinfo = B->quant_info();
       info.scales_ptr = reinterpret_cast<uintptr_t>(qinfo.scales);
@@ -373,6 +400,20 @@ GretaResult GretaCompute::gemm(GretaStream *stream, GretaMemory *A,
   return GretaResult::SUCCESS;
 }
 
+OpCost GretaCompute::gemm_cost(const GretaMemory *A, const GretaMemory *B,
+                               uint32_t M, uint32_t N, uint32_t K) {
+  const GretaDataType type_B = B->data_type();
+  uint64_t scale_bytes = 0;
+  if (type_B == GretaDataType::INT8 || type_B == GretaDataType::INT4) {
+    const GretaQuantInfo q = B->quant_info();
+    scale_bytes = gcore::rt::quant_scale_bytes(N, K, q.group_size,
+                                               q.head_scales ? q.num_heads : 0);
+  }
+  // Every route writes fp32 C.
+  return gcore::rt::gemm_cost(M, N, K, dtype_bits(A->data_type()),
+                              dtype_bits(type_B), 32.0, scale_bytes);
+}
+
 GretaResult GretaCompute::attention_decode(
     GretaStream *stream, GretaMemory *Q, GretaMemory *K_cache,
     GretaMemory *V_cache, GretaMemory *d_pos, GretaMemory *O,
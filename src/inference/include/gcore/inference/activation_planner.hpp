@@ -0,0 +1,70 @@
+#pragma once
+
+#include "gcore/inference/model_config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gcore::inference {
+
+/// A buffer tracked by the planner. A tensor may be written several times in
+/// the op sequence; each write starts a new live interval.
+struct PlannedTensor {
+  std::string name;
+  size_t bytes = 0;
+  bool live_in = false;  // Must hold its value when the sequence starts
+  bool live_out = false; // Must hold its value after the sequence ends
+  std::vector<std::pair<size_t, size_t>> intervals; // [first_op, last_op]
+  size_t offset = 0;                                // Assigned arena offset
+};
+
+/// One step of the op sequence with the tensors it reads and writes.
+struct PlannedOp {
+  std::string name;
+  std::vector<size_t> reads;
+  std::vector<size_t> writes;
+};
+
+/// Result of a planning pass.
+struct ActivationPlan {
+  std::vector<PlannedTensor> tensors;
+  size_t arena_bytes = 0;    // Arena size after offset assignment
+  size_t separate_bytes = 0; // Sum of sizes (one buffer per tensor)
+  size_t live_peak_bytes = 0; // Max live bytes over any op (lower bound)
+
+  /// Index of a tensor by name, or tensors.size() if absent.
+  size_t find(const std::string &name) const;
+
+  /// Human-readable per-tensor offset table plus summary.
+  std::string report() const;
+};
+
+/// Static activation memory planner: computes buffer lifetimes across an op
+/// sequence and packs them into one arena with greedy interval coloring
+/// (largest first, lowest non-conflicting offset).
+class ActivationPlanner {
+public:
+  explicit ActivationPlanner(size_t alignment = 256) : alignment_(alignment) {}
+
+  size_t add_tensor(const std::string &name, size_t bytes,
+                    bool live_in = false, bool live_out = false);
+  void add_op(const std::string &name, std::vector<size_t> reads,
+              std::vector<size_t> writes);
+
+  ActivationPlan plan() const;
+
+private:
+  size_t alignment_;
+  std::vector<PlannedTensor> tensors_;
+  std::vector<PlannedOp> ops_;
+};
+
+/// Plan the per-layer activation buffers used by BlockScheduler::execute_layer
+/// (plus the final RMSNorm and LM head in forward) for a batch of max_seq_len
+/// tokens. Tensor names match the ActivationBuffers members.
+ActivationPlan plan_layer_activations(const ModelConfig &config,
+                                      size_t batch_size, size_t max_seq_len);
+
+} // namespace gcore::inference
@@ -1,10 +1,15 @@
 #pragma once
 
+#include "gcore/inference/activation_planner.hpp"
+#include "gcore/inference/drift_monitor.hpp"
+#include "gcore/inference/kv_session.hpp"
 #include "gcore/inference/layer_trace.hpp"
 #include "gcore/inference/model_config.hpp"
+#include "gcore/inference/runtime_options.hpp"
 #include "gcore/inference/trace.hpp"
 #include "gcore/rt/greta_runtime.hpp"
 #include "gcore/rt/hip/buffer.hpp"
+#include "gcore/rt/op_cost.hpp"
 #include <hip/hip_runtime.h>
 
 #include <cstddef>
@@ -55,12 +60,14 @@ struct ActivationBuffers {
   gcore::rt::hip::Buffer mlp_out;  // MLP output
   gcore::rt::hip::Buffer norm_out; // RMSNorm output
 
-  // KV Cache (persistent across tokens)
-  gcore::rt::hip::Buffer kv_cache_k; // [L, max_seq, H, Dh]
-  gcore::rt::hip::Buffer kv_cache_v; // [L, max_seq, H, Dh]
+  // KV Cache (persistent across tokens), one slot per batch sequence
+  gcore::rt::hip::Buffer kv_cache_k; // [slots, L, H, max_seq, Dh]
+  gcore::rt::hip::Buffer kv_cache_v; // [slots, L, H, max_seq, Dh]
   // Input tokens [B, S]
   gcore::rt::hip::Buffer tokens;
   gcore::rt::hip::Buffer d_pos; // Device-side current position
+  gcore::rt::hip::Buffer batch_pos;  // decode_batch() positions [B]
+  gcore::rt::hip::Buffer batch_slot; // decode_batch() KV slots [B]
 };
 
 /// Block Scheduler: Manages execution of N transformer layers.
@@ -75,20 +82,64 @@ public:
   /// Allocate all weight buffers for the model.
   bool allocate_weights(std::string *err);
 
+  /// Set how many trailing positions of each forward() are projected through
+  /// the LM head (1 = last token only, >1 for speculative verification).
+  /// Must be called before allocate_activations().
+  void set_logits_rows(size_t rows) { logits_rows_ = rows > 0 ? rows : 1; }
+
+  /// Split prefill into chunks of this many tokens (0 = single pass). The
+  /// per-layer activations are then sized for one chunk instead of
+  /// max_seq_len. Defaults to GRETA_PREFILL_CHUNK; must be called before
+  /// allocate_activations().
+  void set_prefill_chunk(size_t tokens) { prefill_chunk_ = tokens; }
+
   /// Allocate activation buffers for batch_size and max sequence length.
+  /// Logits are sized by batch_size * logits_rows, not by max_seq_len. The KV
+  /// cache gets one max_seq_len slot per batch entry.
   bool allocate_activations(size_t batch_size, size_t max_seq_len,
                             std::string *err);
 
   /// Load weights from a WeightLoader into GPU buffers.
   bool load_weights(WeightLoader &loader, std::string *err);
 
-  /// Execute a forward pass for a single layer.
+  /// Execute a forward pass for a single layer, on the KV slot of the last
+  /// forward() call.
   bool execute_layer(size_t layer_idx, size_t seq_start, size_t seq_len,
                      const int32_t *tokens, std::string *err);
 
-  /// Execute forward pass through all layers.
+  /// Execute forward pass through all layers, reading and writing KV slot
+  /// `slot`. GRETA_GRAPH decode replay only applies to slot 0.
   bool forward(const int32_t *tokens, size_t seq_start, size_t seq_len,
-               std::string *err);
+               std::string *err, size_t slot = 0);
+
+  /// One decode step for `batch` independent sequences. Row b feeds
+  /// tokens[b] at positions[b] into KV slot slots[b] (slots < batch_size of
+  /// allocate_activations). Projections run as M=batch GEMMs; logits for row b
+  /// start at b * vocab_size floats in get_logits().
+  bool decode_batch(const int32_t *tokens, const uint32_t *positions,
+                    const uint32_t *slots, size_t batch, std::string *err);
+
+  /// Park a sequence: write KV slot `slot` positions [0, tokens.size()) and
+  /// the token history to `path`. Layers are copied to pinned staging memory
+  /// on the stream while the previous layer is written to disk.
+  bool save_session(const std::string &path,
+                    const std::vector<int32_t> &tokens, size_t slot,
+                    KvSessionCodec codec, std::string *err);
+
+  /// Resume a parked sequence into KV slot `slot`. The session file is
+  /// mmapped and streamed per layer: decoding layer i+1 on the host overlaps
+  /// the upload of layer i. On success `tokens` holds the history and the
+  /// next decode position is tokens->size().
+  bool load_session(const std::string &path, size_t slot,
+                    std::vector<int32_t> *tokens, std::string *err);
+
+  /// Run a prompt from position 0 in prefill chunks, writing KV slot `slot`
+  /// incrementally. Only the last chunk reaches the LM head, so
+  /// last_logits_offset() afterwards refers to the final prompt token. A
+  /// sequence prefilled into slot s continues with decode_batch() rows whose
+  /// slot is s.
+  bool prefill(const int32_t *tokens, size_t n_tokens, std::string *err,
+               size_t slot = 0);
 
   // Sampling
   int32_t sample_greedy_gpu(size_t logits_offset_bytes, std::string *err);
@@ -102,9 +153,27 @@ public:
   /// Get the final RMSNorm output buffer (const).
   const gcore::rt::hip::Buffer &get_norm_out() const;
 
-  /// Get the final logits buffer.
+  /// Get the final logits buffer [B, logits_rows, vocab_size].
   const gcore::rt::hip::Buffer &get_logits() const;
 
+  /// Byte offset in get_logits() of the last position of the most recent
+  /// forward() call. After decode_batch() use logits_offset(row) instead.
+  size_t last_logits_offset() const;
+
+  /// Byte offset in get_logits() of logits row `row`: row b of the last
+  /// decode_batch(), or the row-th projected position of forward().
+  size_t logits_offset(size_t row) const {
+    return row * static_cast<size_t>(config_.vocab_size) * sizeof(float);
+  }
+
+  /// KV cache [slots, L, Hkv, max_seq_len, Dh] fp32.
+  const gcore::rt::hip::Buffer &get_kv_cache_k() const {
+    return activations_.kv_cache_k;
+  }
+  const gcore::rt::hip::Buffer &get_kv_cache_v() const {
+    return activations_.kv_cache_v;
+  }
+
   /// Get LM head weight buffer.
   const gcore::rt::hip::Buffer &get_output_weight() const;
 
@@ -114,30 +183,61 @@ public:
   /// Get number of allocated layers.
   size_t num_layers() const { return blocks_.size(); }
 
+  /// Liveness plan for the per-layer activations (computed by
+  /// allocate_activations; backs them when GRETA_ACTIVATION_ARENA=1).
+  const ActivationPlan &activation_plan() const { return activation_plan_; }
+
 private:
+  /// Layer body for decode_batch(): per-row positions and KV slots.
+  bool execute_layer_batched(size_t layer_idx, size_t batch,
+                             std::string *err);
+
+  /// Element offset of slot kv_slot_ in the KV cache buffers.
+  size_t kv_slot_offset() const;
+
+  /// Attention cost of one decode token at `pos`, summed over all layers.
+  gcore::rt::OpCost decode_attention_cost(size_t pos) const;
+
+  /// Host copies of layer `layer_idx` for the drift monitor.
+  bool fetch_drift_weights(size_t layer_idx, DriftLayerWeights *w,
+                           std::string *err) const;
+
   ModelConfig config_;
   std::vector<BlockBuffers> blocks_;
   ActivationBuffers activations_;
+  ActivationPlan activation_plan_;
+  gcore::rt::hip::Buffer activation_arena_;
 
   // Global weights (outside transformer blocks)
   gcore::rt::hip::Buffer token_embd_;
   gcore::rt::hip::Buffer output_norm_;
   gcore::rt::hip::Buffer output_weight_;
 
-  // Final logits [B, S, vocab_size]
+  // Final logits [B, logits_rows, vocab_size]
   gcore::rt::hip::Buffer logits_;
+  size_t logits_rows_ = 1;
+  size_t last_logits_rows_ = 0;
+  size_t prefill_chunk_ = 0;
+  size_t activation_tokens_ = 0; // Rows per forward() the activations hold
+  size_t kv_slots_ = 1;
+  size_t kv_slot_ = 0; // KV slot of the current forward()
+  bool skip_lm_head_ = false;
 
   gcore::rt::GretaStream *stream_ = nullptr;
   bool initialized_ = false;
+  RuntimeOptions opts_; // Environment knobs, resolved by init()
   size_t current_seq_pos_ = 0;
 
   gcore::inference::Tracer tracer_;
   gcore::inference::LayerTracer layer_tracer_;
   int trace_step_ = 0;
+  // GRETA_DRIFT: CPU shadow checks of sampled decode layers
+  std::unique_ptr<DriftMonitor> drift_;
 
   // GRETA Graph
   gcore::rt::GretaGraph *graph_ = nullptr;
   bool graph_captured_ = false;
+  gcore::rt::OpCost graph_step_cost_; // Captured step minus its attention
   std::vector<hipGraphNode_t> layer_nodes_; // To update 'pos' later if needed
 };
 
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "gcore/inference/runtime_options.hpp"
+#include "gcore/rt/allocator.hpp"
+#include "gcore/rt/staging_pool.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gcore::inference {
+
+/// Activations snapshotted at the op boundaries of one decode layer. Each
+/// op is checked from the GPU's own inputs, so its error is that kernel's
+/// alone and does not compound across the layer.
+enum class DriftPoint : uint32_t {
+  XIn,      // Layer input
+  AttnNorm, // RMSNorm (attention) output; absent with fused RMSNorm+QKV
+  Q,        // Projections, before RoPE
+  K,
+  V,
+  QRope, // After RoPE
+  KRope, // Absent with fused RoPE+KV update (K is roped into the cache)
+  KCache, // Layer cache rows [0, pos], [kv_heads, pos + 1, head_dim]
+  VCache,
+  AttnOut,
+  WoOut,
+  XAttn, // After the attention residual
+  FfnNorm,
+  Gate, // W1 / W3 outputs; absent with the fused FFN front
+  Up,
+  GateAct, // SiLU(gate) * up
+  FfnOut,  // W2 output
+  XOut,
+  Count,
+};
+
+/// Storage of a projection weight.
+enum class DriftDType : uint32_t { F32, F16, INT8, INT4 };
+
+/// Host copy of a projection weight, [N, K] row-major as the GEMV and
+/// quantized kernels read it. Quantized weights dequantize with one fp32
+/// scale per `group_size` consecutive elements and, when present, a scale
+/// per `head_dim` outputs.
+struct DriftWeight {
+  DriftDType type = DriftDType::F32;
+  uint32_t n = 0;
+  uint32_t k = 0;
+  uint32_t group_size = 0;
+  uint32_t head_dim = 0;
+  std::vector<uint8_t> raw;
+  std::vector<float> scales;
+  std::vector<float> head_scales;
+
+  bool empty() const { return raw.empty(); }
+  float at(size_t row, size_t col) const;
+  /// y[n] = sum_k x[k] * W[n, k], accumulated in double.
+  void apply(const float *x, float *y) const;
+};
+
+/// Host copies of what the reference needs from one layer.
+struct DriftLayerWeights {
+  DriftWeight wq, wk, wv, wo, w1, w2, w3;
+  std::vector<float> attn_norm, ffn_norm;
+};
+
+/// Model dimensions and flags of a layer snapshot.
+struct DriftShape {
+  uint32_t dim = 0;
+  uint32_t heads = 0;
+  uint32_t kv_heads = 0;
+  uint32_t head_dim = 0;
+  uint32_t hidden = 0;
+  float rms_eps = 1e-5f;
+  float rope_base = 10000.0f;
+};
+
+/// Log10 histogram of errors: bucket 0 is < 1e-10 (exact matches included),
+/// bucket i in [1, 11] is [1e(i-11), 1e(i-10)), the last bucket >= 10 and
+/// non-finite values.
+struct DriftHistogram {
+  static constexpr int kBuckets = 13;
+  std::array<uint64_t, kBuckets> counts{};
+
+  void add(double v);
+  static int bucket(double v);
+  static const char *label(int bucket);
+};
+
+/// Error statistics of one op over all checks.
+struct DriftOpStats {
+  std::string op;
+  uint64_t checks = 0;
+  uint64_t violations = 0; // rel > max_rel, or non-finite output
+  double max_abs = 0.0;
+  double max_rel = 0.0;
+  int64_t worst_layer = -1; // Where max_rel was seen
+  uint64_t worst_step = 0;
+  DriftHistogram abs_hist;
+  DriftHistogram rel_hist;
+};
+
+struct DriftReport {
+  double threshold = 0.0; // max_rel of the options
+  uint64_t frames_checked = 0;
+  uint64_t frames_skipped = 0; // Sampled while every frame was in flight
+  uint64_t errors = 0;         // Failed copies or weight fetches
+  std::vector<DriftOpStats> ops; // In layer order
+
+  uint64_t violations() const;
+  std::string to_text() const;
+  std::string to_json() const;
+  /// JSON when `path` ends in ".json", text otherwise.
+  bool write(const std::string &path, std::string *err) const;
+};
+
+/// max |got - ref| and ||got - ref||_2 / ||ref||_2 (infinite when `got` has
+/// a non-finite value where `ref` does not).
+void drift_error(const float *ref, const float *got, size_t n,
+                 double *max_abs, double *rel);
+
+class DriftFrame;
+
+/// DriftMonitor: shadow execution of sampled decode layers on the CPU.
+/// - The scheduler asks begin() for a frame on sampled (step, layer) pairs,
+///   snapshots activations into it with capture() (async device->host
+///   copies into pinned memory, no stream sync) and submit()s it.
+/// - A background thread waits for the copies, recomputes every op whose
+///   input and output were captured with a double-accumulating reference
+///   and records max-abs / relative error histograms per op.
+/// - At most `frames` snapshots are in flight; a sample arriving while all
+///   are busy is skipped and counted, so the decode loop never waits.
+/// - Layer weights are fetched to the host on a layer's first check.
+/// Violations of `max_rel` are logged to stderr once per op. The destructor
+/// drains the queue and writes the report to `out` when set.
+class DriftMonitor final {
+public:
+  using WeightFetch = std::function<bool(size_t layer, DriftLayerWeights *w,
+                                         std::string *err)>;
+
+  DriftMonitor(gcore::rt::StagingBackend *backend, const DriftOptions &opt,
+               WeightFetch fetch);
+  ~DriftMonitor();
+
+  DriftMonitor(const DriftMonitor &) = delete;
+  DriftMonitor &operator=(const DriftMonitor &) = delete;
+
+  const DriftOptions &options() const { return opt_; }
+  bool sampled(uint64_t step, size_t layer, size_t num_layers) const;
+
+  /// A free frame for `layer` at position `pos`, or null (skipped).
+  DriftFrame *begin(const DriftShape &shape, size_t layer, uint64_t step,
+                    uint32_t pos);
+  /// Snapshot n floats at `src_dev` in `stream` order.
+  void capture(DriftFrame *f, DriftPoint p, const float *src_dev, size_t n,
+               void *stream);
+  /// Snapshot rows [0, pos] of each head of a [heads, max_seq, head_dim]
+  /// cache layer.
+  void capture_cache(DriftFrame *f, DriftPoint p, const float *cache_dev,
+                     size_t max_seq, void *stream);
+  /// Queue the frame for checking after the work queued so far on `stream`.
+  void submit(DriftFrame *f, void *stream);
+  /// Give back a frame that will not be submitted (the layer failed), once
+  /// the copies already queued into it on `stream` have landed.
+  void abandon(DriftFrame *f, void *stream);
+
+  /// Wait until every submitted frame has been checked.
+  void flush();
+  DriftReport report() const;
+
+private:
+  void loop();
+  void check(DriftFrame &f);
+  const DriftLayerWeights *weights(size_t layer);
+  void record(const char *op, const DriftFrame &f, const float *ref,
+              const float *got, size_t n);
+  void release(DriftFrame *f);
+
+  gcore::rt::StagingBackend *backend_;
+  DriftOptions opt_;
+  WeightFetch fetch_;
+  gcore::rt::HostAllocator host_;
+
+  mutable std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+  std::vector<std::unique_ptr<DriftFrame>> frames_;
+  std::vector<DriftFrame *> free_;
+  std::deque<DriftFrame *> queue_;
+  size_t busy_ = 0; // Frames being checked
+  bool stop_ = false;
+
+  // Worker state.
+  std::map<size_t, std::unique_ptr<DriftLayerWeights>> weights_;
+  std::vector<size_t> failed_layers_;
+
+  // Guarded by mu_.
+  std::map<std::string, DriftOpStats> stats_;
+  std::vector<std::string> op_order_;
+  uint64_t frames_checked_ = 0;
+  uint64_t frames_skipped_ = 0;
+  uint64_t errors_ = 0;
+
+  std::thread thread_;
+};
+
+} // namespace gcore::inference
@@ -29,6 +29,7 @@ struct GenerationStats {
   double total_time_ms = 0.0;
   double tokens_per_second = 0.0;
   double time_to_first_token_ms = 0.0;
+  std::vector<double> decode_step_ms; // Wall time of each decode step
 };
 
 /// Stats per generation step (for alignment/debugging).
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gcore::inference {
+
+/// Storage format of the K/V payload in a session file.
+enum class KvSessionCodec : uint32_t {
+  F32 = 0, // Bit-exact copy of the cache
+  F16 = 1, // Half-precision payload (half the size, restores to fp32)
+};
+
+/// Fixed-size header at the start of a session file.
+struct KvSessionHeader {
+  char magic[4] = {'G', 'K', 'V', 'S'};
+  uint32_t version = 1;
+  uint32_t codec = 0;
+  uint32_t num_layers = 0;
+  uint32_t num_heads_kv = 0;
+  uint32_t head_dim = 0;
+  uint32_t n_tokens = 0; // Cached positions == token history length
+  uint32_t reserved = 0;
+};
+
+/// File layout: header, token history (padded to 64 bytes), then one record
+/// per layer holding K then V, each [num_heads_kv, n_tokens, head_dim].
+/// Only the filled positions are stored, so size scales with n_tokens and not
+/// with max_seq_len.
+class KvSessionWriter {
+public:
+  ~KvSessionWriter();
+
+  /// Start a session file. Data goes to `path + ".tmp"` and is renamed into
+  /// place by finish(), so an interrupted save never leaves a torn file.
+  bool open(const std::string &path, const KvSessionHeader &header,
+            const int32_t *tokens, std::string *err);
+
+  /// Append the next layer. k and v are [num_heads_kv, n_tokens, head_dim].
+  bool write_layer(const float *k, const float *v, std::string *err);
+
+  /// Flush, check that every layer was written, and publish the file.
+  bool finish(std::string *err);
+
+private:
+  bool write_payload(const float *src, size_t count, std::string *err);
+
+  std::string path_;
+  std::string tmp_path_;
+  KvSessionHeader header_;
+  void *file_ = nullptr; // FILE*
+  size_t layers_written_ = 0;
+  std::vector<uint16_t> half_;
+};
+
+/// Read-only mmap view of a session file.
+class KvSessionFile {
+public:
+  KvSessionFile() = default;
+  ~KvSessionFile();
+  KvSessionFile(const KvSessionFile &) = delete;
+  KvSessionFile &operator=(const KvSessionFile &) = delete;
+
+  bool open(const std::string &path, std::string *err);
+  void close();
+
+  const KvSessionHeader &header() const { return header_; }
+  const int32_t *tokens() const;
+
+  /// Elements in one of K or V for a layer (num_heads_kv * n_tokens * dim).
+  size_t layer_elems() const;
+
+  /// Ask the kernel to start reading a layer ahead of read_layer().
+  void prefetch(size_t layer) const;
+
+  /// Decode a layer into fp32 k_dst/v_dst, each layer_elems() floats.
+  void read_layer(size_t layer, float *k_dst, float *v_dst) const;
+
+private:
+  size_t elem_bytes() const;
+  const uint8_t *layer_ptr(size_t layer) const;
+
+  KvSessionHeader header_;
+  const uint8_t *map_ = nullptr;
+  size_t map_size_ = 0;
+  size_t payload_offset_ = 0;
+};
+
+/// IEEE half conversions used by the F16 codec.
+uint16_t kv_float_to_half(float f);
+float kv_half_to_float(uint16_t h);
+
+} // namespace gcore::inference
@@ -1,13 +1,14 @@
 #pragma once
 
 #include "gcore/inference/model_config.hpp"
+#include "gcore/inference/trace_format.hpp"
 #include "gcore/inference/trace.hpp"
 
 #include <hip/hip_runtime.h>
 #include <hip/hip_fp16.h>
 
 #include <cstdint>
-#include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -34,6 +35,8 @@ struct LayerTraceConfig {
   std::string out_path;
 };
 
+// Records go through trace_writer(): tensors are snapshotted in stream
+// order and formatted off the critical path.
 class LayerTracer {
 public:
   void init_from_env(const ModelConfig &config);
@@ -48,8 +51,12 @@ public:
   const LayerTraceConfig &cfg() const { return cfg_; }
 
 private:
+  // GRETA_TRACE_LAYER_OUT, or stdout when unset.
+  const std::string &out_path() const;
+  // Encoder when the output is a binary trace, else null.
+  std::shared_ptr<TraceEncoder> encoder() const;
+
   LayerTraceConfig cfg_{};
-  std::ofstream out_;
 };
 
 void layer_trace_emit_step_header(int step, size_t pos_id, size_t seq_len,
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Diagnostic trace points in the block scheduler. Builds configured with
+// -DGRETA_ENABLE_TRACE=OFF define this to 0: every trace hook is then behind
+// a constant-false condition and compiled out, and the GRETA_TRACE_* knobs
+// are ignored.
+#ifndef GRETA_ENABLE_TRACE
+#define GRETA_ENABLE_TRACE 1
+#endif
+
+namespace gcore::inference {
+
+constexpr bool kTraceEnabled = GRETA_ENABLE_TRACE != 0;
+
+enum class AttnAccumMode { Fp32 = 0, Fp16 = 1 };
+
+/// GRETA_FORCE_ATTN_DECODE_KERNEL.
+enum class AttnDecodeKernel { Auto = 0, Manual = 1, Fused = 2 };
+
+/// GRETA_TRACE_ATTN_POINTS bits.
+enum class AttnTracePoint : uint32_t {
+  Q = 1u << 0,
+  K = 1u << 1,
+  V = 1u << 2,
+  ATTN_OUT = 1u << 3,
+  X_OUT = 1u << 4,
+};
+
+/// Layer filter of the post-WO / RMSNorm traces: `all`, or a list where a
+/// negative entry -N matches the final layer of an N-layer model.
+struct TraceLayerFilter {
+  bool all = false;
+  std::vector<int> layers = {0};
+
+  bool selected(size_t layer_idx, size_t num_layers) const;
+};
+
+/// GRETA_TRACE_* settings read by the block scheduler (the stage and layer
+/// traces keep their own configuration). Empty paths mean "not set".
+struct RuntimeTraceOptions {
+  std::string prompt_id; // GRETA_TRACE_PROMPT_ID
+  bool prompt_id_set = false;
+
+  // Attention decode traces
+  bool attn_decode_verify = false; // GRETA_TRACE_ATTN_DECODE_VERIFY
+  bool attn_ref = false;           // GRETA_TRACE_ATTN_REF
+  bool attn_softmax = false;       // GRETA_TRACE_ATTN_SOFTMAX
+  bool attn_vacc = false;          // GRETA_TRACE_ATTN_VACC
+  bool attn_l0_pipe = false;       // GRETA_TRACE_ATTN_L0_PIPE
+  bool attn_l0_norm = false;       // GRETA_TRACE_ATTN_L0_NORM
+  bool v_addr = false;             // GRETA_TRACE_V_ADDR
+  bool kv_invariants = false;      // GRETA_TRACE_KV_INVARIANTS
+  bool attn_decode_ref = false;    // GRETA_ATTN_DECODE_REF
+  bool attn_mfma_shadow = false;   // GRETA_ATTN_DECODE_MFMA_SHADOW
+  std::vector<int> attn_layers;    // Empty: 0, 1, 2 and the last layer
+  bool attn_layer_set = false;     // GRETA_TRACE_ATTN_LAYER
+  int attn_layer = 0;
+  uint32_t attn_head = 0;
+  uint32_t attn_keys_window = 64;
+  uint32_t attn_dims_sample = 16;
+  uint32_t attn_points = 0x1f; // AttnTracePoint mask
+  std::string attn_decode_out; // _ATTN_DECODE_OUT, else _PREFILL_DECODE_OUT
+  std::string attn_shadow_out; // GRETA_ATTN_DECODE_MFMA_SHADOW_OUT, else ^
+  std::string attn_ref_out;
+  std::string attn_out; // Softmax and V-accumulation traces
+  std::string attn_l0_pipe_out;
+  std::string v_addr_out;
+
+  // Weight verification
+  bool qkv_w_verify = false; // GRETA_TRACE_QKV_W_VERIFY
+  bool wo_w_verify = false;  // GRETA_TRACE_WO_W_VERIFY
+
+  // Post-WO and RMSNorm traces
+  bool post_wo = false;
+  std::string post_wo_out;
+  uint32_t post_wo_sample = 1024;
+  TraceLayerFilter post_wo_layers;
+  std::vector<std::string> post_wo_phases; // Empty: all phases
+  bool rmsnorm = false;
+  std::string rmsnorm_out;
+  uint32_t rmsnorm_sample = 1024;
+  TraceLayerFilter rmsnorm_layers;
+  std::vector<std::string> rmsnorm_phases;
+
+  // GRETA_TRACE_LAYER_DELTA
+  bool layer_delta = false;
+  std::string layer_delta_out; // Else GRETA_TRACE_PREFILL_DECODE_OUT
+
+  /// Synchronize after traced kernels (GRETA_TRACE_READOUT,
+  /// GRETA_TRACE_PREFILL_DECODE or GRETA_TRACE_LANDSCAPE).
+  bool kernel_sync = false;
+  bool embed_verify = false; // GRETA_TRACE_EMBED_VERIFY
+
+  const char *prompt() const {
+    return prompt_id_set ? prompt_id.c_str() : nullptr;
+  }
+  bool post_wo_phase(const char *phase) const;
+  bool rmsnorm_phase(const char *phase) const;
+};
+
+/// GRETA_DRIFT_* settings of the shadow drift monitor (see
+/// drift_monitor.hpp). Unlike the traces it is not compiled out.
+struct DriftOptions {
+  bool enabled = false;  // GRETA_DRIFT=1, or GRETA_DRIFT_OUT set
+  uint32_t every = 64;   // GRETA_DRIFT_EVERY: check one forward step in N
+  TraceLayerFilter layers; // GRETA_DRIFT_LAYERS (default layer 0)
+  double max_rel = 1e-2; // GRETA_DRIFT_MAX_REL: relative error flagged
+  uint32_t frames = 2;   // GRETA_DRIFT_FRAMES: layer snapshots in flight
+  std::string out;       // GRETA_DRIFT_OUT: report written at exit
+};
+
+/// Environment knobs of the forward pass, resolved once by
+/// BlockScheduler::init() so execute_layer()/forward() do no getenv() or
+/// string parsing per call.
+struct RuntimeOptions {
+  bool fused_rmsnorm = false;   // GRETA_USE_FUSED_RMSNORM=1
+  bool fused_attention = false; // GRETA_USE_FUSED_ATTENTION=1
+  bool fused_ffn = false;       // GRETA_USE_FUSED_FFN=1
+  AttnDecodeKernel attn_decode_kernel = AttnDecodeKernel::Auto;
+  AttnAccumMode attn_accum = AttnAccumMode::Fp32; // GRETA_ATTN_ACCUM
+  std::string qkv_force_route;    // GRETA_QKV_FORCE_ROUTE ("" = auto)
+  bool qkv_force_gemm = false;    // GRETA_QKV_FORCE_GEMM
+  std::string gemm_force;         // GRETA_GEMM_FORCE
+  std::string attn_decode_matmul; // GRETA_FORCE_ATTN_DECODE_MATMUL
+  std::string wo_layout_force;    // GRETA_WO_LAYOUT_FORCE
+  bool embed_row_major = true;    // GRETA_EMBED_LAYOUT
+  bool graph = false;             // GRETA_GRAPH=1
+  bool profile_attn = false;      // GRETA_PROFILE_ATTN (set)
+  bool profile_blocks = false;    // GRETA_PROFILE_BLOCKS=1
+  /// Sync the stream per profiled op: GRETA_PROFILE_SYNC=1, implied by
+  /// GRETA_PROFILE_ROOFLINE (a roofline report needs GPU time).
+  bool profile_sync = false;
+  uint32_t prefill_chunk = 0;     // GRETA_PREFILL_CHUNK (0 = single pass)
+  bool activation_arena = false;  // GRETA_ACTIVATION_ARENA=1
+
+  RuntimeTraceOptions trace; // Left at defaults when !kTraceEnabled
+  DriftOptions drift;
+
+  static RuntimeOptions from_env();
+};
+
+} // namespace gcore::inference
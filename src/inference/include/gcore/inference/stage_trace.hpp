@@ -2,11 +2,15 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <hip/hip_runtime.h>
 
+#include "gcore/inference/trace_format.hpp"
+#include "gcore/rt/trace_writer.hpp"
+
 namespace gcore::inference {
 
 struct StageTraceConfig {
@@ -47,7 +51,25 @@ struct StageLogitsStats {
   size_t vocab = 0;
 };
 
-StageTraceConfig stage_trace_config();
+// Process-wide asynchronous trace writer over the HIP staging backend
+// (GRETA_TRACE_RING_MB sets its pinned ring, default 16). Trace files
+// should only be appended through it so their records stay in order;
+// flushed at exit.
+gcore::rt::TraceWriter &trace_writer();
+// trace_writer().append_line(path, line); no-op for a null/empty path.
+void trace_append_line(const char *path, const std::string &line);
+
+// GRETA_TRACE_FORMAT=bin: `path` is the stage or layer trace output and is
+// written in the binary format of trace_format.hpp (lines appended to it
+// become Json chunks).
+bool trace_binary_path(const char *path);
+// GRETA_TRACE_PAYLOAD=1: binary layer records carry the whole tensor.
+bool trace_binary_payload();
+// Encoder of a binary trace file, shared by the formatters that write to it
+// (they all run on the trace writer thread).
+std::shared_ptr<TraceEncoder> trace_encoder(const std::string &path);
+
+const StageTraceConfig &stage_trace_config();
 
 bool stage_trace_enabled();
 bool stage_trace_layer_selected(size_t layer_idx, size_t num_layers);
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gcore::inference {
+
+/// Binary tensor trace (GRETA_TRACE_FORMAT=bin for the stage and layer
+/// traces). A file is a sequence of chunks, each a TraceChunkHeader followed
+/// by `bytes` of payload, in host byte order. Every writer session starts
+/// with a Header chunk (appending a new run to a file starts a new session);
+/// strings are interned per session through String chunks and records refer
+/// to them by id (0 = none). Readers skip chunk types they do not know.
+enum class TraceChunk : uint32_t {
+  Header = 1, // TraceFileHeader
+  String = 2, // uint32_t id, then the bytes (no terminator)
+  Tensor = 3, // TraceTensorRecord, optional blocks (flags), payload_n floats
+  Logits = 4, // TraceLogitsRecord
+  Step = 5,   // TraceStepRecord
+  Json = 6,   // Free-form JSON line (diagnostics without a record type)
+};
+
+struct TraceChunkHeader {
+  uint32_t type = 0;
+  uint32_t bytes = 0;
+};
+
+struct TraceFileHeader {
+  char magic[4] = {'G', 'T', 'R', 'C'};
+  uint32_t version = 1;
+};
+
+enum class TraceSource : uint32_t {
+  Stage = 1, // stage_trace_tensor
+  Layer = 2, // LayerTracer
+};
+
+/// TraceTensorRecord::flags: optional blocks that follow the record, in
+/// this order. The payload is always the last payload_n * 4 bytes of the
+/// chunk, so readers ignore blocks behind flags they do not know.
+constexpr uint32_t kTraceStageFields = 1u << 0; // TraceStageFields
+constexpr uint32_t kTraceInputMeta = 1u << 1;   // TraceInputMeta
+
+/// Common part of every tensor record (the whole layer trace record).
+struct TraceTensorRecord {
+  uint32_t source = 0; // TraceSource
+  uint32_t point = 0;  // String ids
+  uint32_t phase = 0;
+  uint32_t prompt = 0;
+  int32_t layer = 0;
+  uint32_t step = 0;
+  uint32_t n = 0;         // Elements the stats/hash cover
+  uint32_t payload_n = 0; // fp32 values at the end of the chunk
+  uint32_t flags = 0;     // Set by TraceEncoder
+  uint32_t nan = 0;
+  uint32_t inf = 0;
+  float min = 0.0f;
+  float max = 0.0f;
+  float mean = 0.0f;
+  uint64_t hash = 0;
+};
+static_assert(sizeof(TraceTensorRecord) == 64, "trace record layout");
+
+/// Stage trace position and addressing.
+struct TraceStageFields {
+  uint32_t pos_id = 0;
+  uint32_t seq_len = 0;
+  uint32_t tokens_total = 0;
+  uint32_t nz_count = 0;
+  uint64_t token_index = 0;
+  uint64_t stride_elems = 0;
+  uint64_t ptr = 0;
+  uint64_t offset_bytes = 0;
+  float abs_sum = 0.0f;
+  uint32_t reserved = 0;
+};
+static_assert(sizeof(TraceStageFields) == 56, "trace record layout");
+
+/// Stage trace input semantics (GRETA_TRACE_STAGE_DEBUG_INPUT).
+struct TraceInputMeta {
+  uint32_t src_kind = 0; // String ids
+  uint32_t route = 0;
+  uint32_t token_index_used = 0;
+  uint32_t prompt_tokens = 0;
+  uint32_t kv_pos = 0;
+  uint32_t decode_step = 0;
+  uint32_t token_id = 0;
+  uint32_t reserved = 0;
+  uint64_t offset_bytes = 0;
+  uint64_t alloc_bytes = 0;
+};
+static_assert(sizeof(TraceInputMeta) == 48, "trace record layout");
+
+struct TraceLogitsRecord {
+  uint32_t phase = 0; // String ids
+  uint32_t prompt = 0;
+  uint32_t step = 0;
+  uint32_t pos_id = 0;
+  uint32_t seq_len = 0;
+  uint32_t tokens_total = 0;
+  int32_t top1_id = -1;
+  int32_t top2_id = -1;
+  uint64_t hash = 0;
+  uint64_t vocab = 0;
+  uint64_t logits_ptr = 0;
+  uint64_t logits_offset_bytes = 0;
+  float min = 0.0f;
+  float max = 0.0f;
+  float mean = 0.0f;
+  float top1_logit = 0.0f;
+  float top2_logit = 0.0f;
+  float gap = 0.0f;
+};
+static_assert(sizeof(TraceLogitsRecord) == 88, "trace record layout");
+
+/// Layer trace step header.
+struct TraceStepRecord {
+  int32_t step = 0;
+  int32_t token_in = 0;
+  int32_t token_out = 0;
+  uint32_t dim = 0;
+  uint32_t heads = 0;
+  uint32_t head_dim = 0;
+  uint32_t layers = 0; // String ids (GRETA_TRACE_LAYER_LAYERS / _POINTS)
+  uint32_t points = 0;
+  uint64_t pos_id = 0;
+  uint64_t seq_len = 0;
+  uint64_t tokens_total = 0;
+};
+static_assert(sizeof(TraceStepRecord) == 56, "trace record layout");
+
+/// Appends the chunks for one output file to a byte buffer. Keeps the
+/// session's string table; not thread-safe (the trace writer thread owns
+/// it).
+class TraceEncoder {
+public:
+  /// Id for `s` (0 for null/empty), emitting its String chunk on first use.
+  uint32_t intern(const char *s, std::string &out);
+
+  /// `stage` / `meta` are optional; `payload` holds r.payload_n floats.
+  void tensor(const TraceTensorRecord &r, const TraceStageFields *stage,
+              const TraceInputMeta *meta, const float *payload,
+              std::string &out);
+  void logits(const TraceLogitsRecord &r, std::string &out);
+  void step(const TraceStepRecord &r, std::string &out);
+  void json(const std::string &line, std::string &out);
+
+  /// Start a new session (after the file was truncated).
+  void reset();
+
+private:
+  void begin(TraceChunk type, size_t bytes, std::string &out);
+
+  bool started_ = false;
+  std::unordered_map<std::string, uint32_t> ids_;
+};
+
+/// One decoded record. Only the members matching `type` (and, for tensors,
+/// tensor.flags) are meaningful.
+struct TraceEvent {
+  TraceChunk type = TraceChunk::Json;
+  TraceTensorRecord tensor;
+  TraceStageFields stage;
+  TraceInputMeta meta;
+  TraceLogitsRecord logits;
+  TraceStepRecord step;
+  std::vector<float> payload; // Tensor payload
+  std::string json;           // Json line
+};
+
+/// Streaming reader: buffered sequential reads, one record at a time.
+class TraceReader {
+public:
+  TraceReader() = default;
+  ~TraceReader();
+  TraceReader(const TraceReader &) = delete;
+  TraceReader &operator=(const TraceReader &) = delete;
+
+  bool open(const std::string &path, std::string *err);
+  void close();
+
+  /// Next record; Header and String chunks are consumed on the way. Returns
+  /// false at the end of the file (err left empty) or on a malformed or
+  /// truncated chunk (err set).
+  bool next(TraceEvent *ev, std::string *err);
+
+  /// String by id in the current session; "" for 0 or an unknown id.
+  const char *str(uint32_t id) const;
+
+  /// Sessions (Header chunks) seen so far.
+  uint32_t sessions() const { return sessions_; }
+
+private:
+  bool read(void *dst, size_t bytes);
+
+  std::string path_;
+  void *file_ = nullptr; // FILE*
+  uint64_t offset_ = 0;
+  uint32_t sessions_ = 0;
+  std::vector<std::string> strings_;
+  std::vector<char> scratch_;
+};
+
+/// The JSON line the text trace writes for the same record (no newline),
+/// so JSONL tooling keeps working on dumps of binary traces.
+std::string trace_event_json(const TraceReader &reader, const TraceEvent &ev);
+
+} // namespace gcore::inference
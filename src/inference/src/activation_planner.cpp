@@ -0,0 +1,209 @@
+#include "gcore/inference/activation_planner.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace gcore::inference {
+
+static size_t align_up(size_t v, size_t a) {
+  return a > 1 ? ((v + a - 1) / a) * a : v;
+}
+
+static bool intervals_overlap(const PlannedTensor &a, const PlannedTensor &b) {
+  for (const auto &ia : a.intervals) {
+    for (const auto &ib : b.intervals) {
+      if (ia.first <= ib.second && ib.first <= ia.second)
+        return true;
+    }
+  }
+  return false;
+}
+
+size_t ActivationPlan::find(const std::string &name) const {
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    if (tensors[i].name == name)
+      return i;
+  }
+  return tensors.size();
+}
+
+std::string ActivationPlan::report() const {
+  const double mb = 1024.0 * 1024.0;
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2);
+  for (const auto &t : tensors) {
+    oss << "  " << std::left << std::setw(10) << t.name << " offset="
+        << std::setw(12) << t.offset << " bytes=" << std::setw(12) << t.bytes
+        << " live=";
+    for (size_t i = 0; i < t.intervals.size(); ++i) {
+      if (i)
+        oss << ",";
+      oss << "[" << t.intervals[i].first << "," << t.intervals[i].second
+          << "]";
+    }
+    oss << "\n";
+  }
+  const double saved =
+      separate_bytes > 0
+          ? 100.0 * (1.0 - static_cast<double>(arena_bytes) / separate_bytes)
+          : 0.0;
+  oss << "  arena=" << arena_bytes / mb << " MB separate="
+      << separate_bytes / mb << " MB live_peak=" << live_peak_bytes / mb
+      << " MB saved=" << saved << "%\n";
+  return oss.str();
+}
+
+size_t ActivationPlanner::add_tensor(const std::string &name, size_t bytes,
+                                     bool live_in, bool live_out) {
+  PlannedTensor t;
+  t.name = name;
+  t.bytes = bytes;
+  t.live_in = live_in;
+  t.live_out = live_out;
+  tensors_.push_back(std::move(t));
+  return tensors_.size() - 1;
+}
+
+void ActivationPlanner::add_op(const std::string &name,
+                               std::vector<size_t> reads,
+                               std::vector<size_t> writes) {
+  PlannedOp op;
+  op.name = name;
+  op.reads = std::move(reads);
+  op.writes = std::move(writes);
+  ops_.push_back(std::move(op));
+}
+
+ActivationPlan ActivationPlanner::plan() const {
+  ActivationPlan out;
+  out.tensors = tensors_;
+  const size_t n_ops = ops_.size();
+  const size_t last_op = n_ops > 0 ? n_ops - 1 : 0;
+
+  // 1. Liveness: a pure write opens a new interval, reads (and in-place
+  //    read+write) extend the current one.
+  for (size_t t = 0; t < out.tensors.size(); ++t) {
+    auto &ten = out.tensors[t];
+    bool open = ten.live_in;
+    size_t start = 0, end = 0;
+    for (size_t i = 0; i < n_ops; ++i) {
+      const auto &op = ops_[i];
+      const bool reads =
+          std::find(op.reads.begin(), op.reads.end(), t) != op.reads.end();
+      const bool writes =
+          std::find(op.writes.begin(), op.writes.end(), t) != op.writes.end();
+      if (writes && !reads) {
+        if (open)
+          ten.intervals.push_back({start, end});
+        open = true;
+        start = end = i;
+      } else if (reads || writes) {
+        if (!open) {
+          open = true;
+          start = 0;
+        }
+        end = i;
+      }
+    }
+    if (open) {
+      if (ten.live_out)
+        end = last_op;
+      ten.intervals.push_back({start, end});
+    }
+    out.separate_bytes += ten.bytes;
+  }
+
+  for (size_t i = 0; i < n_ops; ++i) {
+    size_t live = 0;
+    for (const auto &ten : out.tensors) {
+      for (const auto &iv : ten.intervals) {
+        if (iv.first <= i && i <= iv.second) {
+          live += ten.bytes;
+          break;
+        }
+      }
+    }
+    out.live_peak_bytes = std::max(out.live_peak_bytes, live);
+  }
+
+  // 2. Offsets: place largest tensors first at the lowest offset that does
+  //    not collide with an already placed tensor whose lifetime overlaps.
+  std::vector<size_t> order(out.tensors.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return out.tensors[a].bytes > out.tensors[b].bytes;
+  });
+
+  std::vector<size_t> placed;
+  for (size_t idx : order) {
+    auto &ten = out.tensors[idx];
+    const size_t need = align_up(ten.bytes, alignment_);
+    std::vector<std::pair<size_t, size_t>> busy;
+    for (size_t p : placed) {
+      const auto &other = out.tensors[p];
+      if (intervals_overlap(ten, other))
+        busy.push_back(
+            {other.offset, other.offset + align_up(other.bytes, alignment_)});
+    }
+    std::sort(busy.begin(), busy.end());
+    size_t offset = 0;
+    for (const auto &b : busy) {
+      if (offset + need <= b.first)
+        break;
+      offset = std::max(offset, b.second);
+    }
+    ten.offset = offset;
+    out.arena_bytes = std::max(out.arena_bytes, offset + need);
+    placed.push_back(idx);
+  }
+
+  return out;
+}
+
+ActivationPlan plan_layer_activations(const ModelConfig &config,
+                                      size_t batch_size, size_t max_seq_len) {
+  const size_t tokens = batch_size * max_seq_len;
+  const size_t heads_kv =
+      config.num_heads_kv > 0 ? config.num_heads_kv : config.num_heads;
+  const size_t hidden = tokens * config.dim * sizeof(float);
+  const size_t kv = tokens * heads_kv * config.head_dim * sizeof(float);
+  const size_t mlp = tokens * config.hidden_dim * sizeof(float);
+
+  ActivationPlanner p;
+  // x carries the residual stream between layers; norm_out feeds the LM head
+  // and is read back by Generator after forward().
+  const size_t x = p.add_tensor("x", hidden, true, true);
+  const size_t norm_out = p.add_tensor("norm_out", hidden, false, true);
+  const size_t q = p.add_tensor("q", hidden);
+  const size_t k = p.add_tensor("k", kv);
+  const size_t v = p.add_tensor("v", kv);
+  const size_t attn_out = p.add_tensor("attn_out", hidden);
+  const size_t mlp_gate = p.add_tensor("mlp_gate", mlp);
+  const size_t mlp_up = p.add_tensor("mlp_up", mlp);
+  const size_t mlp_out = p.add_tensor("mlp_out", hidden);
+
+  // Mirrors execute_layer: WO writes into mlp_out, and norm_out is reused by
+  // the FFN RMSNorm.
+  p.add_op("rmsnorm_attn", {x}, {norm_out});
+  p.add_op("gemm_q", {norm_out}, {q});
+  p.add_op("gemm_k", {norm_out}, {k});
+  p.add_op("gemm_v", {norm_out}, {v});
+  p.add_op("rope", {q, k}, {q, k});
+  p.add_op("kv_update", {k, v}, {});
+  p.add_op("attention", {q, k, v}, {attn_out});
+  p.add_op("gemm_o", {attn_out}, {mlp_out});
+  p.add_op("residual_attn", {x, mlp_out}, {x});
+  p.add_op("rmsnorm_ffn", {x}, {norm_out});
+  p.add_op("gemm_w1", {norm_out}, {mlp_gate});
+  p.add_op("gemm_w3", {norm_out}, {mlp_up});
+  p.add_op("silu_mul", {mlp_gate, mlp_up}, {mlp_gate});
+  p.add_op("gemm_w2", {mlp_gate}, {mlp_out});
+  p.add_op("residual_ffn", {x, mlp_out}, {x});
+  p.add_op("final_rmsnorm", {x}, {norm_out});
+  p.add_op("lm_head", {norm_out}, {});
+  return p.plan();
+}
+
+} // namespace gcore::inference
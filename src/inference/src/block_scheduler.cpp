@@ -4,11 +4,13 @@
 #include "gcore/inference/weight_loader.hpp"
 #include "gcore/rt/greta_runtime.hpp"
 #include "gcore/rt/hip/greta_runtime_hip.hpp"
+#include "gcore/rt/hip/staging.hpp"
 #include "gcore/rt/hip/kernels/attention_kernels.hpp"
 #include "gcore/rt/hip/kernels/basic_kernels.hpp"
 #include "gcore/rt/hip/kernels/fused_attention_kernels.hpp"
 #include "gcore/rt/hip/kernels/fused_compute_kernels.hpp"
 #include "gcore/rt/hip/kernels/gemm_kernels.hpp"
+#include "gcore/rt/profiler.hpp"
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
@@ -19,6 +21,7 @@
 #include <limits>
 #include <sstream>
 #include <string>
+#include <unistd.h>
 #include <unordered_map>
 #include <vector>
 
@@ -29,16 +32,73 @@
 #endif
 
 #define TRACE_ON(layer)                                                        \
-  (GRETA_UNLIKELY(tracer_.should_trace_layer((int)(layer), trace_step_)))
+  (kTraceEnabled &&                                                            \
+   GRETA_UNLIKELY(tracer_.should_trace_layer((int)(layer), trace_step_)))
 
 #define PROFILE_ON() (GRETA_UNLIKELY(tracer_.profile_enabled()))
 
 namespace gcore::inference {
 
-static bool env_flag(const char *k) {
-  const char *v = std::getenv(k);
-  return v && (v[0] == '1' || v[0] == 'y' || v[0] == 'Y');
-}
+// Timeline span (GRETA_PROFILE_TRACE, see gcore/rt/profiler.hpp). Kernel
+// launches are asynchronous, so by default a span covers host-side launch
+// time; with `sync` (RuntimeOptions::profile_sync) it waits for the stream
+// before closing so spans line up with GPU execution (not while a graph is
+// being captured).
+// GretaCompute::gemm() charges its analytic cost to the open span; other
+// kernels add theirs with add_cost().
+class OpSpan {
+public:
+  OpSpan(hipStream_t stream, bool sync, const char *name, size_t layer)
+      : OpSpan(stream, sync, "op", name, "layer",
+               static_cast<int64_t>(layer)) {}
+  OpSpan(hipStream_t stream, bool sync, const char *cat, const char *name,
+         const char *arg_name = nullptr, int64_t arg = 0)
+      : stream_(stream), sync_(sync), span_(cat, name, arg_name, arg) {}
+  ~OpSpan() { end(); }
+
+  void add_cost(const gcore::rt::OpCost &c) { span_.add_cost(c); }
+  void end() {
+    if (!span_.active())
+      return;
+    if (sync_) {
+      hipStreamCaptureStatus status = hipStreamCaptureStatusNone;
+      if (hipStreamIsCapturing(stream_, &status) == hipSuccess &&
+          status == hipStreamCaptureStatusNone)
+        (void)hipStreamSynchronize(stream_);
+    }
+    span_.end();
+  }
+
+private:
+  hipStream_t stream_;
+  bool sync_;
+  gcore::rt::ProfileSpan span_;
+};
+
+// Owns a DriftMonitor frame for one execute_layer() call: any early return
+// (CHECK_HIP_KERNEL, CHECK_GRETA) hands it back instead of leaking it.
+class DriftFrameGuard {
+public:
+  DriftFrameGuard(DriftMonitor *monitor, DriftFrame *frame, hipStream_t stream)
+      : monitor_(monitor), frame_(frame), stream_(stream) {}
+  ~DriftFrameGuard() {
+    if (frame_)
+      monitor_->abandon(frame_, stream_);
+  }
+  DriftFrameGuard(const DriftFrameGuard &) = delete;
+  DriftFrameGuard &operator=(const DriftFrameGuard &) = delete;
+
+  void submit() {
+    if (frame_)
+      monitor_->submit(frame_, stream_);
+    frame_ = nullptr;
+  }
+
+private:
+  DriftMonitor *monitor_;
+  DriftFrame *frame_;
+  hipStream_t stream_;
+};
 
 struct F32Stats {
   float min = 0.0f;
@@ -48,81 +108,16 @@ struct F32Stats {
   int inf = 0;
 };
 
-enum class AttnTracePoint : uint32_t {
-  Q = 1u << 0,
-  K = 1u << 1,
-  V = 1u << 2,
-  ATTN_OUT = 1u << 3,
-  X_OUT = 1u << 4,
-};
-
-static uint32_t attn_point_mask_from_list(const char *v) {
-  if (!v || !*v)
-    return static_cast<uint32_t>(AttnTracePoint::Q) |
-           static_cast<uint32_t>(AttnTracePoint::K) |
-           static_cast<uint32_t>(AttnTracePoint::V) |
-           static_cast<uint32_t>(AttnTracePoint::ATTN_OUT) |
-           static_cast<uint32_t>(AttnTracePoint::X_OUT);
-  std::string s(v);
-  uint32_t mask = 0;
-  size_t start = 0;
-  while (start < s.size()) {
-    size_t end = s.find(',', start);
-    std::string token = s.substr(
-        start, (end == std::string::npos) ? s.size() - start : end - start);
-    if (token == "q")
-      mask |= static_cast<uint32_t>(AttnTracePoint::Q);
-    else if (token == "k")
-      mask |= static_cast<uint32_t>(AttnTracePoint::K);
-    else if (token == "v")
-      mask |= static_cast<uint32_t>(AttnTracePoint::V);
-    else if (token == "attn_out")
-      mask |= static_cast<uint32_t>(AttnTracePoint::ATTN_OUT);
-    else if (token == "x_out")
-      mask |= static_cast<uint32_t>(AttnTracePoint::X_OUT);
-    if (end == std::string::npos)
-      break;
-    start = end + 1;
-  }
-  if (mask == 0) {
-    mask = static_cast<uint32_t>(AttnTracePoint::Q) |
-           static_cast<uint32_t>(AttnTracePoint::K) |
-           static_cast<uint32_t>(AttnTracePoint::V) |
-           static_cast<uint32_t>(AttnTracePoint::ATTN_OUT) |
-           static_cast<uint32_t>(AttnTracePoint::X_OUT);
-  }
-  return mask;
-}
-
-static std::vector<int> parse_layers(const char *v) {
-  std::vector<int> layers;
-  if (!v || !*v)
-    return layers;
-  std::string s(v);
-  if (s == "all" || s == "ALL" || s == "*")
-    return layers;
-  size_t start = 0;
-  while (start < s.size()) {
-    size_t end = s.find(',', start);
-    std::string token = s.substr(
-        start, (end == std::string::npos) ? s.size() - start : end - start);
-    if (!token.empty()) {
-      char *e = nullptr;
-      int val = std::strtol(token.c_str(), &e, 10);
-      if (e != token.c_str())
-        layers.push_back(val);
-    }
-    if (end == std::string::npos)
-      break;
-    start = end + 1;
-  }
-  return layers;
+// Trace predicates over the options resolved by init(). With
+// GRETA_ENABLE_TRACE=0 they are constant false, so the trace blocks they
+// guard are compiled out.
+static const char *opt_path(const std::string &path) {
+  return path.empty() ? nullptr : path.c_str();
 }
 
-static bool attn_trace_layer_selected(size_t layer_idx, size_t num_layers) {
-  const char *layers_env = std::getenv("GRETA_TRACE_ATTN_LAYERS");
-  std::vector<int> layers = parse_layers(layers_env);
-  if (layers.empty()) {
+static bool attn_trace_layer_selected(const RuntimeTraceOptions &t,
+                                      size_t layer_idx, size_t num_layers) {
+  if (t.attn_layers.empty()) {
     const int last = num_layers > 0 ? static_cast<int>(num_layers - 1) : 0;
     const int defaults[] = {0, 1, 2, last};
     for (int l : defaults) {
@@ -131,396 +126,174 @@ static bool attn_trace_layer_selected(size_t layer_idx, size_t num_layers) {
     }
     return false;
   }
-  for (int l : layers) {
+  for (int l : t.attn_layers) {
     if (l == static_cast<int>(layer_idx))
       return true;
   }
   return false;
 }
 
-static const char *attn_trace_out_path() {
-  const char *out = std::getenv("GRETA_TRACE_ATTN_DECODE_OUT");
-  if (out && *out)
-    return out;
-  return std::getenv("GRETA_TRACE_PREFILL_DECODE_OUT");
-}
-
-static const char *attn_shadow_out_path() {
-  const char *out = std::getenv("GRETA_ATTN_DECODE_MFMA_SHADOW_OUT");
-  if (out && *out)
-    return out;
-  return attn_trace_out_path();
-}
-
-static bool trace_attn_decode_verify_enabled() {
-  return env_flag("GRETA_TRACE_ATTN_DECODE_VERIFY");
+static const char *attn_trace_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.attn_decode_out);
 }
 
-static bool attn_decode_ref_enabled() {
-  return env_flag("GRETA_ATTN_DECODE_REF");
-}
-
-static bool trace_attn_ref_enabled() {
-  return env_flag("GRETA_TRACE_ATTN_REF");
-}
-
-static const char *attn_ref_out_path() {
-  const char *out = std::getenv("GRETA_TRACE_ATTN_REF_OUT");
-  if (out && *out)
-    return out;
-  return nullptr;
+static const char *attn_shadow_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.attn_shadow_out);
 }
 
-static bool trace_attn_softmax_enabled() {
-  return env_flag("GRETA_TRACE_ATTN_SOFTMAX");
+static bool trace_attn_decode_verify_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.attn_decode_verify;
 }
 
-static const char *attn_softmax_out_path() {
-  const char *out = std::getenv("GRETA_TRACE_ATTN_OUT");
-  if (out && *out)
-    return out;
-  return nullptr;
+static bool attn_decode_ref_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.attn_decode_ref;
 }
 
-static bool attn_softmax_layer_selected(size_t layer_idx, size_t num_layers) {
-  const char *v = std::getenv("GRETA_TRACE_ATTN_LAYER");
-  if (v && *v) {
-    char *e = nullptr;
-    int val = std::strtol(v, &e, 10);
-    if (e != v)
-      return static_cast<int>(layer_idx) == val;
-  }
-  return attn_trace_layer_selected(layer_idx, num_layers);
+static bool trace_attn_ref_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.attn_ref;
 }
 
-static uint32_t attn_softmax_head() {
-  const char *v = std::getenv("GRETA_TRACE_ATTN_HEAD");
-  if (!v || !*v)
-    return 0;
-  char *e = nullptr;
-  long val = std::strtol(v, &e, 10);
-  if (e == v || val < 0)
-    return 0;
-  return static_cast<uint32_t>(val);
+static const char *attn_ref_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.attn_ref_out);
 }
 
-static uint32_t attn_softmax_window() {
-  const char *v = std::getenv("GRETA_TRACE_ATTN_KEYS_WINDOW");
-  if (!v || !*v)
-    return 64;
-  char *e = nullptr;
-  long val = std::strtol(v, &e, 10);
-  if (e == v || val <= 0)
-    return 64;
-  return static_cast<uint32_t>(val);
+static bool trace_attn_softmax_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.attn_softmax;
 }
 
-static bool trace_attn_vacc_enabled() {
-  return env_flag("GRETA_TRACE_ATTN_VACC");
+static const char *attn_softmax_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.attn_out);
 }
 
-static const char *attn_vacc_out_path() {
-  const char *out = std::getenv("GRETA_TRACE_ATTN_OUT");
-  if (out && *out)
-    return out;
-  return nullptr;
+static bool attn_softmax_layer_selected(const RuntimeTraceOptions &t,
+                                        size_t layer_idx, size_t num_layers) {
+  if (t.attn_layer_set)
+    return static_cast<int>(layer_idx) == t.attn_layer;
+  return attn_trace_layer_selected(t, layer_idx, num_layers);
 }
 
-static bool trace_attn_l0_pipe_enabled() {
-  return env_flag("GRETA_TRACE_ATTN_L0_PIPE");
+static uint32_t attn_softmax_head(const RuntimeTraceOptions &t) {
+  return t.attn_head;
 }
 
-static bool trace_attn_l0_norm_enabled() {
-  return env_flag("GRETA_TRACE_ATTN_L0_NORM");
+static uint32_t attn_softmax_window(const RuntimeTraceOptions &t) {
+  return t.attn_keys_window;
 }
 
-static bool trace_qkv_w_verify_enabled() {
-  return env_flag("GRETA_TRACE_QKV_W_VERIFY");
+static bool trace_attn_vacc_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.attn_vacc;
 }
 
-static bool trace_wo_w_verify_enabled() {
-  return env_flag("GRETA_TRACE_WO_W_VERIFY");
+static const char *attn_vacc_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.attn_out);
 }
 
-static bool trace_post_wo_enabled() { return env_flag("GRETA_TRACE_POST_WO"); }
-
-static const char *post_wo_out_path() {
-  const char *out = std::getenv("GRETA_TRACE_POST_WO_OUT");
-  if (out && *out)
-    return out;
-  return nullptr;
+static bool trace_attn_l0_pipe_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.attn_l0_pipe;
 }
 
-static uint32_t post_wo_sample() {
-  const char *v = std::getenv("GRETA_TRACE_POST_WO_SAMPLE");
-  if (!v || !*v)
-    return 1024;
-  char *e = nullptr;
-  long val = std::strtol(v, &e, 10);
-  if (e == v || val <= 0)
-    return 1024;
-  return static_cast<uint32_t>(val);
+static bool trace_attn_l0_norm_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.attn_l0_norm;
 }
 
-static bool post_wo_trace_all_layers() {
-  static bool cached = false;
-  static bool trace_all = false;
-  if (!cached) {
-    const char *v = std::getenv("GRETA_TRACE_POST_WO_LAYERS");
-    if (v && *v) {
-      std::string s(v);
-      if (s == "all" || s == "ALL" || s == "*")
-        trace_all = true;
-    }
-    cached = true;
-  }
-  return trace_all;
+static bool trace_qkv_w_verify_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.qkv_w_verify;
 }
 
-static std::vector<int> post_wo_layers() {
-  static bool cached = false;
-  static std::vector<int> layers;
-  if (!cached) {
-    const char *v = std::getenv("GRETA_TRACE_POST_WO_LAYERS");
-    if (!v || !*v) {
-      layers.push_back(0);
-    } else {
-      std::string s(v);
-      size_t start = 0;
-      while (start < s.size()) {
-        size_t end = s.find(',', start);
-        std::string token = s.substr(
-            start, (end == std::string::npos) ? s.size() - start : end - start);
-        if (!token.empty()) {
-          char *e = nullptr;
-          long val = std::strtol(token.c_str(), &e, 10);
-          if (e != token.c_str())
-            layers.push_back(static_cast<int>(val));
-        }
-        if (end == std::string::npos)
-          break;
-        start = end + 1;
-      }
-      if (layers.empty() && !post_wo_trace_all_layers()) {
-        layers.push_back(0);
-      }
-    }
-    cached = true;
-  }
-  return layers;
+static bool trace_wo_w_verify_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.wo_w_verify;
 }
 
-static bool post_wo_layer_selected(size_t layer_idx, size_t num_layers) {
-  if (post_wo_trace_all_layers())
-    return true;
-  const auto layers = post_wo_layers();
-  if (layers.empty())
-    return true;
-  for (int layer : layers) {
-    if (layer < 0 && static_cast<size_t>(-layer) == num_layers)
-      return true;
-    if (static_cast<size_t>(layer) == layer_idx)
-      return true;
-  }
-  return false;
+static bool trace_post_wo_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.post_wo;
 }
 
-static bool post_wo_phase_enabled(const char *phase) {
-  const char *v = std::getenv("GRETA_TRACE_POST_WO_PHASES");
-  if (!v || !*v)
-    return true;
-  std::string s(v);
-  size_t start = 0;
-  while (start < s.size()) {
-    size_t end = s.find(',', start);
-    std::string token = s.substr(
-        start, (end == std::string::npos) ? s.size() - start : end - start);
-    if (!token.empty() && token == phase)
-      return true;
-    if (end == std::string::npos)
-      break;
-    start = end + 1;
-  }
-  return false;
+static const char *post_wo_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.post_wo_out);
 }
 
-static bool trace_rmsnorm_enabled() { return env_flag("GRETA_TRACE_RMSNORM"); }
-
-static const char *rmsnorm_out_path() {
-  const char *out = std::getenv("GRETA_TRACE_RMSNORM_OUT");
-  if (out && *out)
-    return out;
-  return nullptr;
+static uint32_t post_wo_sample(const RuntimeTraceOptions &t) {
+  return t.post_wo_sample;
 }
 
-static uint32_t rmsnorm_sample() {
-  const char *v = std::getenv("GRETA_TRACE_RMSNORM_SAMPLE");
-  if (!v || !*v)
-    return 1024;
-  char *e = nullptr;
-  long val = std::strtol(v, &e, 10);
-  if (e == v || val <= 0)
-    return 1024;
-  return static_cast<uint32_t>(val);
+static bool post_wo_layer_selected(const RuntimeTraceOptions &t,
+                                   size_t layer_idx, size_t num_layers) {
+  return t.post_wo_layers.selected(layer_idx, num_layers);
 }
 
-static bool rmsnorm_trace_all_layers() {
-  static bool cached = false;
-  static bool trace_all = false;
-  if (!cached) {
-    const char *v = std::getenv("GRETA_TRACE_RMSNORM_LAYERS");
-    if (v && *v) {
-      std::string s(v);
-      if (s == "all" || s == "ALL" || s == "*")
-        trace_all = true;
-    }
-    cached = true;
-  }
-  return trace_all;
+static bool post_wo_phase_enabled(const RuntimeTraceOptions &t,
+                                  const char *phase) {
+  return t.post_wo_phase(phase);
 }
 
-static std::vector<int> rmsnorm_layers() {
-  static bool cached = false;
-  static std::vector<int> layers;
-  if (!cached) {
-    const char *v = std::getenv("GRETA_TRACE_RMSNORM_LAYERS");
-    if (!v || !*v) {
-      layers.push_back(0);
-    } else {
-      std::string s(v);
-      size_t start = 0;
-      while (start < s.size()) {
-        size_t end = s.find(',', start);
-        std::string token = s.substr(
-            start, (end == std::string::npos) ? s.size() - start : end - start);
-        if (!token.empty()) {
-          char *e = nullptr;
-          long val = std::strtol(token.c_str(), &e, 10);
-          if (e != token.c_str())
-            layers.push_back(static_cast<int>(val));
-        }
-        if (end == std::string::npos)
-          break;
-        start = end + 1;
-      }
-      if (layers.empty() && !rmsnorm_trace_all_layers()) {
-        layers.push_back(0);
-      }
-    }
-    cached = true;
-  }
-  return layers;
+static bool trace_rmsnorm_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.rmsnorm;
 }
 
-static bool rmsnorm_layer_selected(size_t layer_idx, size_t num_layers) {
-  if (rmsnorm_trace_all_layers())
-    return true;
-  const auto layers = rmsnorm_layers();
-  if (layers.empty())
-    return true;
-  for (int layer : layers) {
-    if (layer < 0 && static_cast<size_t>(-layer) == num_layers)
-      return true;
-    if (static_cast<size_t>(layer) == layer_idx)
-      return true;
-  }
-  return false;
+static const char *rmsnorm_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.rmsnorm_out);
 }
 
-static bool rmsnorm_phase_enabled(const char *phase) {
-  const char *v = std::getenv("GRETA_TRACE_RMSNORM_PHASES");
-  if (!v || !*v)
-    return true;
-  std::string s(v);
-  size_t start = 0;
-  while (start < s.size()) {
-    size_t end = s.find(',', start);
-    std::string token = s.substr(
-        start, (end == std::string::npos) ? s.size() - start : end - start);
-    if (!token.empty() && token == phase)
-      return true;
-    if (end == std::string::npos)
-      break;
-    start = end + 1;
-  }
-  return false;
+static uint32_t rmsnorm_sample(const RuntimeTraceOptions &t) {
+  return t.rmsnorm_sample;
 }
 
-static const char *attn_l0_pipe_out_path() {
-  const char *out = std::getenv("GRETA_TRACE_ATTN_L0_PIPE_OUT");
-  if (out && *out)
-    return out;
-  return nullptr;
+static bool rmsnorm_layer_selected(const RuntimeTraceOptions &t,
+                                   size_t layer_idx, size_t num_layers) {
+  return t.rmsnorm_layers.selected(layer_idx, num_layers);
 }
 
-static const char *qkv_force_route_env() {
-  const char *v = std::getenv("GRETA_QKV_FORCE_ROUTE");
-  if (!v || !*v)
-    return nullptr;
-  if (std::strcmp(v, "auto") == 0 || std::strcmp(v, "AUTO") == 0)
-    return nullptr;
-  return v;
+static bool rmsnorm_phase_enabled(const RuntimeTraceOptions &t,
+                                  const char *phase) {
+  return t.rmsnorm_phase(phase);
 }
 
-static bool qkv_force_gemm_enabled() {
-  return env_flag("GRETA_QKV_FORCE_GEMM");
+static const char *attn_l0_pipe_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.attn_l0_pipe_out);
 }
 
-static std::string to_route_label(const char *v) {
-  if (!v || !*v)
+static const char *to_route_label(const std::string &v) {
+  if (v.empty())
     return "auto";
-  std::string s(v);
-  if (s == "mfma" || s == "MFMA")
+  if (v == "mfma" || v == "MFMA")
     return "MFMA";
-  if (s == "valu" || s == "VALU")
+  if (v == "valu" || v == "VALU")
     return "VALU";
-  return s;
+  return v.c_str();
 }
 
-static std::string qkv_route_used(uint32_t m, bool is_decode_step,
-                                  bool use_fused, const char *force_route) {
+static const char *qkv_route_used(const RuntimeOptions &o, uint32_t m,
+                                  bool is_decode_step, bool use_fused) {
   if (use_fused)
     return "FUSED_GEMV";
 
-  if (force_route && *force_route)
-    return to_route_label(force_route);
+  if (!o.qkv_force_route.empty())
+    return to_route_label(o.qkv_force_route);
 
-  const char *force_gemm = std::getenv("GRETA_GEMM_FORCE");
-  if (force_gemm && *force_gemm)
-    return to_route_label(force_gemm);
+  if (!o.gemm_force.empty())
+    return to_route_label(o.gemm_force);
 
-  if (is_decode_step) {
-    const char *attn_force = std::getenv("GRETA_FORCE_ATTN_DECODE_MATMUL");
-    if (attn_force && *attn_force)
-      return to_route_label(attn_force);
-  }
+  if (is_decode_step && !o.attn_decode_matmul.empty())
+    return to_route_label(o.attn_decode_matmul);
 
   const uint32_t GEMM_MFMA_THRESHOLD = 32;
   return (m > GEMM_MFMA_THRESHOLD) ? "MFMA" : "VALU";
 }
 
-static bool trace_v_addr_enabled() { return env_flag("GRETA_TRACE_V_ADDR"); }
+static bool trace_v_addr_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.v_addr;
+}
 
-static const char *v_addr_out_path() {
-  const char *out = std::getenv("GRETA_TRACE_V_ADDR_OUT");
-  if (out && *out)
-    return out;
-  return nullptr;
+static const char *v_addr_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.v_addr_out);
 }
 
-static uint32_t attn_vacc_dims_sample() {
-  const char *v = std::getenv("GRETA_TRACE_ATTN_DIMS_SAMPLE");
-  if (!v || !*v)
-    return 16;
-  char *e = nullptr;
-  long val = std::strtol(v, &e, 10);
-  if (e == v || val <= 0)
-    return 16;
-  return static_cast<uint32_t>(val);
+static uint32_t attn_vacc_dims_sample(const RuntimeTraceOptions &t) {
+  return t.attn_dims_sample;
 }
 
-static bool attn_mfma_shadow_enabled() {
-  return env_flag("GRETA_ATTN_DECODE_MFMA_SHADOW");
+static bool attn_mfma_shadow_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.attn_mfma_shadow;
 }
 
 static void mae_max_f32(const float *a, const float *b, size_t n, double *mae,
@@ -636,6 +409,60 @@ static bool ensure_qkv_weight_cache(const gcore::rt::hip::Buffer &w,
   return true;
 }
 
+// Host copy of an [n, k] projection for the drift monitor. Scale buffers
+// that were never allocated (fp16/fp32 weights) are left empty.
+static bool copy_drift_weight(const gcore::rt::hip::Buffer &w,
+                              const gcore::rt::hip::Buffer &scales,
+                              const gcore::rt::hip::Buffer &head_scales,
+                              uint32_t n, uint32_t k, uint32_t head_dim,
+                              DriftWeight *out, std::string *err) {
+  out->n = n;
+  out->k = k;
+  out->head_dim = head_dim;
+  out->group_size = w.quant_info().group_size;
+  size_t need = static_cast<size_t>(n) * k;
+  switch (w.data_type()) {
+  case gcore::rt::GretaDataType::FP32:
+    out->type = DriftDType::F32;
+    need *= 4;
+    break;
+  case gcore::rt::GretaDataType::FP16:
+    out->type = DriftDType::F16;
+    need *= 2;
+    break;
+  case gcore::rt::GretaDataType::INT8:
+    out->type = DriftDType::INT8;
+    break;
+  case gcore::rt::GretaDataType::INT4:
+    out->type = DriftDType::INT4;
+    need = (need + 1) / 2;
+    break;
+  default:
+    *err = std::string("unsupported weight type ") + dtype_label(w.data_type());
+    return false;
+  }
+  if (w.size() < need) {
+    *err = "weight holds " + std::to_string(w.size()) + " bytes, expected " +
+           std::to_string(need);
+    return false;
+  }
+  out->raw.resize(need);
+  if (!w.copy_to_host(out->raw.data(), need, err))
+    return false;
+  const bool quantized =
+      out->type == DriftDType::INT8 || out->type == DriftDType::INT4;
+  out->scales.assign(quantized ? scales.size() / sizeof(float) : 0, 0.0f);
+  if (!out->scales.empty() &&
+      !scales.copy_to_host(out->scales.data(), scales.size(), err))
+    return false;
+  out->head_scales.assign(head_scales.size() / sizeof(float), 0.0f);
+  if (!out->head_scales.empty() &&
+      !head_scales.copy_to_host(out->head_scales.data(), head_scales.size(),
+                                err))
+    return false;
+  return true;
+}
+
 static float read_weight_value(const QkvWeightHostCache &cache, size_t idx) {
   if (idx >= cache.elems)
     return 0.0f;
@@ -702,18 +529,6 @@ static double mae_f32(const float *a, const float *b, size_t n) {
   return sum / static_cast<double>(n);
 }
 
-enum class AttnAccumMode { Fp32 = 0, Fp16 = 1 };
-
-static AttnAccumMode attn_accum_mode() {
-  const char *v = std::getenv("GRETA_ATTN_ACCUM");
-  if (!v)
-    return AttnAccumMode::Fp32;
-  std::string s(v);
-  if (s == "fp16" || s == "FP16")
-    return AttnAccumMode::Fp16;
-  return AttnAccumMode::Fp32;
-}
-
 static inline float round_fp16_host(float x) {
   return __half2float(__float2half_rn(x));
 }
@@ -973,28 +788,25 @@ static uint64_t hash_f32(const float *p, size_t n) {
   return h;
 }
 
+// Ordered with the async stage/layer trace records of the same file.
 static void append_line(const char *path, const std::string &line) {
-  if (!path || !*path)
-    return;
-  std::ofstream f(path, std::ios::out | std::ios::app);
-  if (!f.is_open())
-    return;
-  f << line << "\n";
+  trace_append_line(path, line);
 }
 
-static void post_wo_trace_tensor(const char *point, const char *phase,
+static void post_wo_trace_tensor(const RuntimeTraceOptions &t,
+                                 const char *point, const char *phase,
                                  const char *prompt_id, size_t layer,
                                  uint32_t step, uint32_t pos_id,
                                  uint32_t seq_len, uint32_t tokens_total,
                                  const float *base, size_t stride_elems,
                                  size_t token_index, size_t alloc_bytes,
                                  hipStream_t stream) {
-  if (!trace_post_wo_enabled())
+  if (!trace_post_wo_enabled(t))
     return;
-  const char *out = post_wo_out_path();
+  const char *out = post_wo_out_path(t);
   if (!out || !*out || !point || !phase)
     return;
-  if (!post_wo_phase_enabled(phase))
+  if (!post_wo_phase_enabled(t, phase))
     return;
   if (!base || stride_elems == 0)
     return;
@@ -1002,57 +814,64 @@ static void post_wo_trace_tensor(const char *point, const char *phase,
   const size_t offset_elems = token_index * stride_elems;
   const float *ptr = base + offset_elems;
   const uint32_t sample_n =
-      std::min<uint32_t>(post_wo_sample(), static_cast<uint32_t>(stride_elems));
-  std::vector<float> host(sample_n, 0.0f);
-  if (sample_n > 0) {
-    hipMemcpyAsync(host.data(), ptr, sample_n * sizeof(float),
-                   hipMemcpyDeviceToHost, stream);
-    hipStreamSynchronize(stream);
-  }
-  const F32Stats stats = stats_f32(host.data(), host.size());
-  const uint64_t hash = hash_f32(host.data(), host.size());
+      std::min<uint32_t>(post_wo_sample(t),
+                         static_cast<uint32_t>(stride_elems));
 
-  std::ostringstream oss;
-  oss << "{\"event\":\"post_wo_trace\"";
+  std::ostringstream head;
+  head << "{\"event\":\"post_wo_trace\"";
   if (prompt_id && *prompt_id)
-    oss << ",\"prompt_id\":\"" << prompt_id << "\"";
-  oss << ",\"phase\":\"" << phase << "\""
-      << ",\"point\":\"" << point << "\""
-      << ",\"layer\":" << layer << ",\"step\":" << step
-      << ",\"pos_id\":" << pos_id << ",\"seq_len\":" << seq_len
-      << ",\"tokens_total\":" << tokens_total
-      << ",\"token_index\":" << token_index
-      << ",\"ptr\":" << reinterpret_cast<uintptr_t>(ptr)
-      << ",\"base_ptr\":" << reinterpret_cast<uintptr_t>(base)
-      << ",\"offset_bytes\":" << (offset_elems * sizeof(float))
-      << ",\"alloc_bytes\":" << alloc_bytes << ",\"sample_n\":" << sample_n
-      << ",\"hash\":" << hash << ",\"min\":" << stats.min
-      << ",\"max\":" << stats.max << ",\"mean\":" << stats.mean
-      << ",\"nan\":" << stats.nan << ",\"inf\":" << stats.inf
-      << ",\"sample\":[";
-  for (size_t i = 0; i < host.size(); ++i) {
-    if (i)
-      oss << ",";
-    oss << host[i];
-  }
-  oss << "]}";
-  append_line(out, oss.str());
+    head << ",\"prompt_id\":\"" << prompt_id << "\"";
+  head << ",\"phase\":\"" << phase << "\""
+       << ",\"point\":\"" << point << "\""
+       << ",\"layer\":" << layer << ",\"step\":" << step
+       << ",\"pos_id\":" << pos_id << ",\"seq_len\":" << seq_len
+       << ",\"tokens_total\":" << tokens_total
+       << ",\"token_index\":" << token_index
+       << ",\"ptr\":" << reinterpret_cast<uintptr_t>(ptr)
+       << ",\"base_ptr\":" << reinterpret_cast<uintptr_t>(base)
+       << ",\"offset_bytes\":" << (offset_elems * sizeof(float))
+       << ",\"alloc_bytes\":" << alloc_bytes << ",\"sample_n\":" << sample_n;
+
+  // Snapshot in stream order; stats and the line are built on the trace
+  // writer thread.
+  trace_writer().capture(
+      out, ptr, sample_n * sizeof(float), stream,
+      [head = head.str()](const void *data, size_t bytes, std::string &line) {
+        const float *host = static_cast<const float *>(data);
+        const size_t n = bytes / sizeof(float);
+        const F32Stats stats = stats_f32(host, n);
+        const uint64_t hash = hash_f32(host, n);
+        std::ostringstream oss;
+        oss << head << ",\"hash\":" << hash << ",\"min\":" << stats.min
+            << ",\"max\":" << stats.max << ",\"mean\":" << stats.mean
+            << ",\"nan\":" << stats.nan << ",\"inf\":" << stats.inf
+            << ",\"sample\":[";
+        for (size_t i = 0; i < n; ++i) {
+          if (i)
+            oss << ",";
+          oss << host[i];
+        }
+        oss << "]}\n";
+        line += oss.str();
+      },
+      nullptr);
 }
 
 static void trace_rmsnorm(
-    const char *phase, const char *prompt_id, size_t layer, size_t num_layers,
+    const RuntimeTraceOptions &t, const char *phase, const char *prompt_id,
+    size_t layer, size_t num_layers,
     uint32_t step, uint32_t pos_id, uint32_t seq_len, uint32_t tokens_total,
     const float *input, const float *output, size_t stride_elems,
     size_t token_index, size_t input_alloc_bytes, size_t output_alloc_bytes,
     const gcore::rt::hip::Buffer &weight, float eps, hipStream_t stream) {
-  if (!trace_rmsnorm_enabled())
+  if (!trace_rmsnorm_enabled(t))
     return;
-  const char *out = rmsnorm_out_path();
+  const char *out = rmsnorm_out_path(t);
   if (!out || !*out || !phase)
     return;
-  if (!rmsnorm_phase_enabled(phase))
+  if (!rmsnorm_phase_enabled(t, phase))
     return;
-  if (!rmsnorm_layer_selected(layer, num_layers))
+  if (!rmsnorm_layer_selected(t, layer, num_layers))
     return;
   if (!input || !output || stride_elems == 0)
     return;
@@ -1061,7 +880,8 @@ static void trace_rmsnorm(
   const float *in_ptr = input + offset_elems;
   const float *out_ptr = output + offset_elems;
   const uint32_t sample_n =
-      std::min<uint32_t>(rmsnorm_sample(), static_cast<uint32_t>(stride_elems));
+      std::min<uint32_t>(rmsnorm_sample(t),
+                         static_cast<uint32_t>(stride_elems));
   std::vector<float> in_host(sample_n, 0.0f);
   std::vector<float> out_host(sample_n, 0.0f);
   std::vector<float> w_host(sample_n, 0.0f);
@@ -1149,11 +969,12 @@ static void trace_rmsnorm(
   append_line(out, oss.str());
 }
 
-static const char *layer_delta_out_path() {
-  const char *out = std::getenv("GRETA_TRACE_LAYER_DELTA_OUT");
-  if (out && *out)
-    return out;
-  return std::getenv("GRETA_TRACE_PREFILL_DECODE_OUT");
+static bool trace_layer_delta_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.layer_delta;
+}
+
+static const char *layer_delta_out_path(const RuntimeTraceOptions &t) {
+  return opt_path(t.layer_delta_out);
 }
 
 class GretaMemoryView final : public gcore::rt::GretaMemory {
@@ -1193,15 +1014,13 @@ private:
   size_t offset_bytes_;
 };
 
-static bool trace_kernel_sync_enabled() {
-  static const bool enabled = env_flag("GRETA_TRACE_READOUT") ||
-                              env_flag("GRETA_TRACE_PREFILL_DECODE") ||
-                              env_flag("GRETA_TRACE_LANDSCAPE");
-  return enabled;
+static bool trace_kernel_sync_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.kernel_sync;
 }
 
-static bool trace_hip_sync(const char *name, std::string *err) {
-  if (!trace_kernel_sync_enabled())
+static bool trace_hip_sync(const RuntimeTraceOptions &t, const char *name,
+                           std::string *err) {
+  if (!trace_kernel_sync_enabled(t))
     return true;
   hipError_t res = hipDeviceSynchronize();
   if (res != hipSuccess) {
@@ -1213,8 +1032,9 @@ static bool trace_hip_sync(const char *name, std::string *err) {
   return true;
 }
 
-static bool trace_hip_check_and_sync(const char *name, std::string *err) {
-  if (!trace_kernel_sync_enabled())
+static bool trace_hip_check_and_sync(const RuntimeTraceOptions &t,
+                                     const char *name, std::string *err) {
+  if (!trace_kernel_sync_enabled(t))
     return true;
   hipError_t err_code = hipGetLastError();
   if (err_code != hipSuccess) {
@@ -1223,39 +1043,21 @@ static bool trace_hip_check_and_sync(const char *name, std::string *err) {
              " hipGetLastError: " + hipGetErrorString(err_code);
     return false;
   }
-  return trace_hip_sync(name, err);
+  return trace_hip_sync(t, name, err);
 }
 
-static bool trace_embed_verify_enabled() {
-  static const bool enabled = env_flag("GRETA_TRACE_EMBED_VERIFY");
-  return enabled;
+static bool trace_embed_verify_enabled(const RuntimeTraceOptions &t) {
+  return kTraceEnabled && t.embed_verify;
 }
 
-static bool embed_layout_row_major() {
-  static bool cached = false;
-  static bool row_major = true;
-  if (cached)
-    return row_major;
-  cached = true;
-  const char *v = std::getenv("GRETA_EMBED_LAYOUT");
-  if (!v)
-    return row_major;
-  std::string val(v);
-  if (val == "col" || val == "COL" || val == "col_major") {
-    row_major = false;
-  } else {
-    row_major = true;
-  }
-  return row_major;
-}
-
-static bool trace_embed_verify_once(const int32_t *tokens, size_t seq_len,
+static bool trace_embed_verify_once(const RuntimeTraceOptions &t,
+                                    const int32_t *tokens, size_t seq_len,
                                     uint32_t dim, uint32_t vocab_size,
                                     const gcore::rt::hip::Buffer &token_embd,
                                     const gcore::rt::hip::Buffer &x,
                                     bool layout_row_major, std::string *err) {
   static bool done = false;
-  if (!trace_embed_verify_enabled() || done)
+  if (!trace_embed_verify_enabled(t) || done)
     return true;
   done = true;
 
@@ -1270,7 +1072,7 @@ static bool trace_embed_verify_once(const int32_t *tokens, size_t seq_len,
     return true;
   }
 
-  if (!trace_hip_sync("Embedding Verify", err))
+  if (!trace_hip_sync(t, "Embedding Verify", err))
     return false;
 
   std::vector<float> out(dim);
@@ -1325,9 +1127,20 @@ static bool trace_embed_verify_once(const int32_t *tokens, size_t seq_len,
   return true;
 }
 
+static bool trace_env_present() {
+  if (!kTraceEnabled)
+    return false;
+  for (char **e = environ; e && *e; ++e) {
+    if (std::strncmp(*e, "GRETA_TRACE_", 12) == 0)
+      return true;
+  }
+  return false;
+}
+
 BlockScheduler::BlockScheduler() = default;
 
 BlockScheduler::~BlockScheduler() {
+  drift_.reset(); // Its frames may have copies queued on stream_
   if (stream_ != nullptr) {
     delete stream_;
     stream_ = nullptr;
@@ -1348,6 +1161,19 @@ bool BlockScheduler::init(const ModelConfig &config, std::string *err) {
 
   tracer_.init_from_env();
   layer_tracer_.init_from_env(config_);
+  opts_ = RuntimeOptions::from_env();
+
+  // Graph replay skips execute_layer, so there is nothing to snapshot.
+  if (opts_.drift.enabled && !opts_.graph) {
+    static gcore::rt::hip::HipStagingBackend drift_backend;
+    drift_ = std::make_unique<DriftMonitor>(
+        &drift_backend, opts_.drift,
+        [this](size_t layer, DriftLayerWeights *w, std::string *e) {
+          return fetch_drift_weights(layer, w, e);
+        });
+  }
+
+  prefill_chunk_ = opts_.prefill_chunk;
 
   initialized_ = true;
   return true;
@@ -1463,45 +1289,111 @@ bool BlockScheduler::allocate_activations(size_t batch_size, size_t max_seq_len,
   const size_t head_dim = config_.head_dim;
   const size_t kv_dim = heads_kv * head_dim;
 
-  size_t hidden_size = batch_size * max_seq_len * D * sizeof(float);
-  activations_.x.allocate(hidden_size, Usage::DeviceOnly,
-                          gcore::rt::GretaDataType::FP32, err);
-  activations_.norm_out.allocate(hidden_size, Usage::DeviceOnly,
-                                 gcore::rt::GretaDataType::FP32, err);
-  activations_.q.allocate(hidden_size, Usage::DeviceOnly,
-                          gcore::rt::GretaDataType::FP32, err);
-  const size_t kv_hidden_size =
-      batch_size * max_seq_len * kv_dim * sizeof(float);
-  activations_.k.allocate(kv_hidden_size, Usage::DeviceOnly,
-                          gcore::rt::GretaDataType::FP32, err);
-  activations_.v.allocate(kv_hidden_size, Usage::DeviceOnly,
-                          gcore::rt::GretaDataType::FP32, err);
-  activations_.attn_out.allocate(hidden_size, Usage::DeviceOnly,
-                                 gcore::rt::GretaDataType::FP32, err);
+  // With chunked prefill no forward() sees more than one chunk, so the
+  // per-layer activations only need chunk rows; the KV cache keeps
+  // max_seq_len. Traces compare whole-prompt buffers and disable chunking.
+  activation_tokens_ = max_seq_len;
+  if (prefill_chunk_ > 0 && prefill_chunk_ < max_seq_len &&
+      !trace_env_present())
+    activation_tokens_ = prefill_chunk_;
+  std::cout << "[GRETA_SCHED] Prefill: "
+            << (activation_tokens_ < max_seq_len
+                    ? "chunk=" + std::to_string(activation_tokens_)
+                    : std::string("single pass"))
+            << std::endl;
+
+  activation_plan_ =
+      plan_layer_activations(config_, batch_size, activation_tokens_);
+  const bool use_arena = opts_.activation_arena && !trace_env_present();
+  if (use_arena) {
+    // One arena, buffers placed by lifetime. Buffers whose live ranges do not
+    // overlap share storage, so traces that read a buffer after its last use
+    // would see clobbered data; those runs keep separate buffers.
+    if (!activation_arena_.allocate(activation_plan_.arena_bytes,
+                                    Usage::DeviceOnly,
+                                    gcore::rt::GretaDataType::FP32, err))
+      return false;
+    const struct {
+      const char *name;
+      gcore::rt::hip::Buffer *buf;
+    } slots[] = {{"x", &activations_.x},
+                 {"norm_out", &activations_.norm_out},
+                 {"q", &activations_.q},
+                 {"k", &activations_.k},
+                 {"v", &activations_.v},
+                 {"attn_out", &activations_.attn_out},
+                 {"mlp_gate", &activations_.mlp_gate},
+                 {"mlp_up", &activations_.mlp_up},
+                 {"mlp_out", &activations_.mlp_out}};
+    for (const auto &slot : slots) {
+      const auto &t = activation_plan_.tensors[activation_plan_.find(slot.name)];
+      if (!slot.buf->alias(activation_arena_, t.offset, t.bytes,
+                           gcore::rt::GretaDataType::FP32, err))
+        return false;
+    }
+  } else {
+    size_t hidden_size =
+        batch_size * activation_tokens_ * D * sizeof(float);
+    activations_.x.allocate(hidden_size, Usage::DeviceOnly,
+                            gcore::rt::GretaDataType::FP32, err);
+    activations_.norm_out.allocate(hidden_size, Usage::DeviceOnly,
+                                   gcore::rt::GretaDataType::FP32, err);
+    activations_.q.allocate(hidden_size, Usage::DeviceOnly,
+                            gcore::rt::GretaDataType::FP32, err);
+    const size_t kv_hidden_size =
+        batch_size * activation_tokens_ * kv_dim * sizeof(float);
+    activations_.k.allocate(kv_hidden_size, Usage::DeviceOnly,
+                            gcore::rt::GretaDataType::FP32, err);
+    activations_.v.allocate(kv_hidden_size, Usage::DeviceOnly,
+                            gcore::rt::GretaDataType::FP32, err);
+    activations_.attn_out.allocate(hidden_size, Usage::DeviceOnly,
+                                   gcore::rt::GretaDataType::FP32, err);
 
-  size_t mlp_size = batch_size * max_seq_len * H * sizeof(float);
-  activations_.mlp_gate.allocate(mlp_size, Usage::DeviceOnly,
+    size_t mlp_size =
+        batch_size * activation_tokens_ * H * sizeof(float);
+    activations_.mlp_gate.allocate(mlp_size, Usage::DeviceOnly,
+                                   gcore::rt::GretaDataType::FP32, err);
+    activations_.mlp_up.allocate(mlp_size, Usage::DeviceOnly,
                                  gcore::rt::GretaDataType::FP32, err);
-  activations_.mlp_up.allocate(mlp_size, Usage::DeviceOnly,
-                               gcore::rt::GretaDataType::FP32, err);
-  activations_.mlp_out.allocate(hidden_size, Usage::DeviceOnly,
-                                gcore::rt::GretaDataType::FP32, err);
+    activations_.mlp_out.allocate(hidden_size, Usage::DeviceOnly,
+                                  gcore::rt::GretaDataType::FP32, err);
+  }
 
-  size_t kv_size = L * max_seq_len * heads_kv * head_dim * sizeof(float);
+  std::cout << "[GRETA_SCHED] Activations: planned="
+            << activation_plan_.arena_bytes / (1024 * 1024)
+            << " MB separate=" << activation_plan_.separate_bytes / (1024 * 1024)
+            << " MB (" << (use_arena ? "arena" : "separate buffers") << ")"
+            << std::endl;
+  if (std::getenv("GRETA_VERBOSE_INFO"))
+    std::cout << activation_plan_.report();
+
+  // Slot-major so slot 0 keeps the single-sequence [L, H, max_seq, Dh] layout
+  // that forward() and the traces index directly.
+  kv_slots_ = batch_size > 0 ? batch_size : 1;
+  size_t kv_size =
+      kv_slots_ * L * max_seq_len * heads_kv * head_dim * sizeof(float);
   activations_.kv_cache_k.allocate(kv_size, Usage::DeviceOnly,
                                    gcore::rt::GretaDataType::FP32, err);
   activations_.kv_cache_v.allocate(kv_size, Usage::DeviceOnly,
                                    gcore::rt::GretaDataType::FP32, err);
 
-  size_t tokens_size = batch_size * max_seq_len * sizeof(int32_t);
+  size_t tokens_size = batch_size * activation_tokens_ * sizeof(int32_t);
   activations_.tokens.allocate(tokens_size, Usage::DeviceOnly,
                                gcore::rt::GretaDataType::FP16, err);
 
   activations_.d_pos.allocate(sizeof(uint32_t), Usage::DeviceOnly,
                               gcore::rt::GretaDataType::FP16, err);
+  activations_.batch_pos.allocate(kv_slots_ * sizeof(uint32_t),
+                                  Usage::DeviceOnly,
+                                  gcore::rt::GretaDataType::FP16, err);
+  activations_.batch_slot.allocate(kv_slots_ * sizeof(uint32_t),
+                                   Usage::DeviceOnly,
+                                   gcore::rt::GretaDataType::FP16, err);
 
+  // Only the sampled rows reach the LM head, so logits do not scale with
+  // max_seq_len (2048x32000 fp32 would otherwise be ~262 MB per batch slot).
   size_t logits_size =
-      batch_size * max_seq_len * config_.vocab_size * sizeof(float);
+      batch_size * logits_rows_ * config_.vocab_size * sizeof(float);
   logits_.allocate(logits_size, Usage::DeviceOnly,
                    gcore::rt::GretaDataType::FP32, err);
 
@@ -1514,6 +1406,7 @@ bool BlockScheduler::load_weights(WeightLoader &loader, std::string *err) {
   bool int8_mode = (use_int8 && std::string(use_int8) == "1");
   bool int4_mode = (use_int4 && std::string(use_int4) == "1");
 
+  gcore::rt::ProfileSpan load_span("loader", "load_weights");
   std::cout << "[GRETA_SCHED] Starting weight load (INT8: "
             << (int8_mode ? "ON" : "OFF")
             << ", INT4: " << (int4_mode ? "ON" : "OFF") << ")" << std::endl;
@@ -1522,6 +1415,8 @@ bool BlockScheduler::load_weights(WeightLoader &loader, std::string *err) {
     if (i % 8 == 0)
       std::cout << "[GRETA_SCHED] Loading layer " << i << "/"
                 << config_.num_layers << "..." << std::endl;
+    gcore::rt::ProfileSpan layer_span("loader", "load_layer", "layer",
+                                      static_cast<int64_t>(i));
     std::string prefix = "blk." + std::to_string(i) + ".";
     auto &b = blocks_[i];
     if (!loader.load_tensor(prefix + "attn_norm.weight", b.attn_norm, err))
@@ -1607,7 +1502,7 @@ bool BlockScheduler::load_weights(WeightLoader &loader, std::string *err) {
                " launch failed: " + hipGetErrorString(err_code);               \
       return false;                                                            \
     }                                                                          \
-    if (!trace_hip_sync(name, err))                                            \
+    if (!trace_hip_sync(opts_.trace, name, err))                               \
       return false;                                                            \
   } while (0)
 
@@ -1618,10 +1513,38 @@ bool BlockScheduler::load_weights(WeightLoader &loader, std::string *err) {
         *err = std::string(name) + " failed";                                  \
       return false;                                                            \
     }                                                                          \
-    if (!trace_hip_check_and_sync(name, err))                                  \
+    if (!trace_hip_check_and_sync(opts_.trace, name, err))                     \
       return false;                                                            \
   } while (0)
 
+bool BlockScheduler::fetch_drift_weights(size_t layer_idx,
+                                         DriftLayerWeights *w,
+                                         std::string *err) const {
+  const auto &b = blocks_[layer_idx];
+  const uint32_t D = static_cast<uint32_t>(config_.dim);
+  const uint32_t Hq = static_cast<uint32_t>(config_.num_heads);
+  const uint32_t Hkv = static_cast<uint32_t>(
+      config_.num_heads_kv > 0 ? config_.num_heads_kv : config_.num_heads);
+  const uint32_t Dh = D / Hq;
+  const uint32_t H = static_cast<uint32_t>(config_.hidden_dim);
+  static const gcore::rt::hip::Buffer kNone;
+  if (!copy_drift_weight(b.wq, b.s_wq, b.sh_wq, D, D, Dh, &w->wq, err) ||
+      !copy_drift_weight(b.wk, b.s_wk, b.sh_wk, Hkv * Dh, D, Dh, &w->wk,
+                         err) ||
+      !copy_drift_weight(b.wv, b.s_wv, b.sh_wv, Hkv * Dh, D, Dh, &w->wv,
+                         err) ||
+      !copy_drift_weight(b.wo, b.s_wo, b.sh_wo, D, D, Dh, &w->wo, err) ||
+      !copy_drift_weight(b.w1, b.s_w1, kNone, H, D, 0, &w->w1, err) ||
+      !copy_drift_weight(b.w2, b.s_w2, kNone, D, H, 0, &w->w2, err) ||
+      !copy_drift_weight(b.w3, b.s_w3, kNone, H, D, 0, &w->w3, err))
+    return false;
+  w->attn_norm.assign(D, 0.0f);
+  w->ffn_norm.assign(D, 0.0f);
+  return b.attn_norm.copy_to_host(w->attn_norm.data(), D * sizeof(float),
+                                  err) &&
+         b.ffn_norm.copy_to_host(w->ffn_norm.data(), D * sizeof(float), err);
+}
+
 bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                                    size_t seq_len, const int32_t *tokens,
                                    std::string *err) {
@@ -1654,8 +1577,9 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
   const float *attn_norm = static_cast<const float *>(b.attn_norm.data());
   const float *ffn_norm = static_cast<const float *>(b.ffn_norm.data());
 
-  size_t offset = (size_t)layer_idx * (size_t)config_.max_seq_len *
-                  (size_t)Hkv * (size_t)Dh;
+  size_t offset = kv_slot_offset() +
+                  (size_t)layer_idx * (size_t)config_.max_seq_len *
+                      (size_t)Hkv * (size_t)Dh;
   float *cache_k =
       static_cast<float *>(activations_.kv_cache_k.data()) + offset;
   float *cache_v =
@@ -1666,10 +1590,31 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
   hipStream_t hip_stream =
       static_cast<gcore::rt::hip::GretaStreamHip *>(stream_)->handle();
 
-  const bool trace_layer = GRETA_UNLIKELY(layer_tracer_.enabled());
-  const bool stage_enabled = stage_trace_enabled();
-  const bool post_wo_enabled = trace_post_wo_enabled();
-  const bool rmsnorm_enabled = trace_rmsnorm_enabled();
+  // GRETA_DRIFT: snapshot sampled decode layers for the CPU reference.
+  DriftFrame *drift = nullptr;
+  if (drift_ && S == 1 &&
+      drift_->sampled(static_cast<uint64_t>(trace_step_), layer_idx,
+                      config_.num_layers)) {
+    DriftShape shape;
+    shape.dim = D;
+    shape.heads = Hq;
+    shape.kv_heads = Hkv;
+    shape.head_dim = Dh;
+    shape.hidden = hidden_dim;
+    shape.rms_eps = config_.rms_eps;
+    shape.rope_base = config_.rope_base;
+    drift = drift_->begin(shape, layer_idx, static_cast<uint64_t>(trace_step_),
+                          static_cast<uint32_t>(seq_start));
+    if (drift)
+      drift_->capture(drift, DriftPoint::XIn, x, D, hip_stream);
+  }
+  DriftFrameGuard drift_guard(drift_.get(), drift, hip_stream);
+
+  const bool trace_layer =
+      kTraceEnabled && GRETA_UNLIKELY(layer_tracer_.enabled());
+  const bool stage_enabled = kTraceEnabled && stage_trace_enabled();
+  const bool post_wo_enabled = trace_post_wo_enabled(opts_.trace);
+  const bool rmsnorm_enabled = trace_rmsnorm_enabled(opts_.trace);
   const bool debug_input = stage_trace_debug_input();
   const char *stage_phase = nullptr;
   if (stage_enabled || post_wo_enabled || rmsnorm_enabled) {
@@ -1684,16 +1629,17 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       stage_trace_layer_selected(layer_idx, config_.num_layers) &&
       stage_trace_phase_enabled(stage_phase);
   const bool post_wo_layer =
-      trace_post_wo_enabled() && stage_phase &&
-      post_wo_layer_selected(layer_idx, config_.num_layers) &&
-      post_wo_phase_enabled(stage_phase) && post_wo_out_path();
+      trace_post_wo_enabled(opts_.trace) && stage_phase &&
+      post_wo_layer_selected(opts_.trace, layer_idx, config_.num_layers) &&
+      post_wo_phase_enabled(opts_.trace, stage_phase) &&
+      post_wo_out_path(opts_.trace);
   const uint32_t stage_tokens_total =
       static_cast<uint32_t>(seq_start + seq_len);
   const uint32_t stage_token_index =
       seq_len > 0 ? static_cast<uint32_t>(seq_len - 1) : 0;
   const uint32_t stage_pos_id =
       static_cast<uint32_t>(seq_start + stage_token_index);
-  const char *stage_prompt_id = std::getenv("GRETA_TRACE_PROMPT_ID");
+  const char *stage_prompt_id = opts_.trace.prompt();
 
   if (stage_layer) {
     const size_t x_stride_elems = D;
@@ -1732,11 +1678,11 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                        stage_token_index, hip_stream, &input_meta);
   }
   if (post_wo_layer) {
-    post_wo_trace_tensor("x_in", stage_phase, stage_prompt_id, layer_idx,
-                         static_cast<uint32_t>(trace_step_), stage_pos_id,
-                         static_cast<uint32_t>(seq_len), stage_tokens_total, x,
-                         D, stage_token_index, activations_.x.size(),
-                         hip_stream);
+    post_wo_trace_tensor(opts_.trace, "x_in", stage_phase, stage_prompt_id,
+                         layer_idx, static_cast<uint32_t>(trace_step_),
+                         stage_pos_id, static_cast<uint32_t>(seq_len),
+                         stage_tokens_total, x, D, stage_token_index,
+                         activations_.x.size(), hip_stream);
   }
   if (trace_layer) {
     layer_tracer_.trace_tensor("x", trace_step_, static_cast<int>(layer_idx),
@@ -1750,7 +1696,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     start->record(stream_);
   }
 
-  bool profile_attn = (std::getenv("GRETA_PROFILE_ATTN") != nullptr);
+  const bool profile_attn = opts_.profile_attn;
   gcore::rt::GretaEvent *ev_q_start = nullptr, *ev_q_end = nullptr;
   gcore::rt::GretaEvent *ev_k_start = nullptr, *ev_k_end = nullptr;
   gcore::rt::GretaEvent *ev_v_start = nullptr, *ev_v_end = nullptr;
@@ -1774,23 +1720,25 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     ev_core_end = ctx.create_event();
   }
 
-  const char *use_fused_env = std::getenv("GRETA_USE_FUSED_RMSNORM");
-  bool use_fused = (use_fused_env && std::string(use_fused_env) == "1") &&
-                   (S == 1) && (Hkv == Hq);
-  const char *qkv_force_route = qkv_force_route_env();
-  const bool qkv_force_gemm = qkv_force_gemm_enabled();
+  bool use_fused = opts_.fused_rmsnorm && (S == 1) && (Hkv == Hq);
+  const char *qkv_force_route =
+      opts_.qkv_force_route.empty() ? nullptr : opts_.qkv_force_route.c_str();
+  const bool qkv_force_gemm = opts_.qkv_force_gemm;
   if (is_decode_step && qkv_force_gemm) {
     use_fused = false;
   }
-  if (layer_idx == 0 && trace_qkv_w_verify_enabled()) {
+  if (layer_idx == 0 && trace_qkv_w_verify_enabled(opts_.trace)) {
     use_fused = false;
   }
 
-  std::string q_route_used = "unknown";
-  std::string k_route_used = "unknown";
-  std::string v_route_used = "unknown";
+  const char *q_route_used = "unknown";
+  const char *k_route_used = "unknown";
+  const char *v_route_used = "unknown";
 
   if (use_fused) {
+    OpSpan fused_span(hip_stream, opts_.profile_sync, "rmsnorm_qkv", layer_idx);
+    fused_span.add_cost(gcore::rt::gemm_cost(1, D + 2 * kv_dim, D, 32, 16, 32) +
+                        gcore::rt::OpCost{4 * D + 2, D * 4});
     CHECK_HIP_KERNEL(launch_fused_rmsnorm_qkv_gemv_f16(
                          hip_stream, x, attn_norm,
                          static_cast<const __half *>(b.wq.data()),
@@ -1798,6 +1746,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                          static_cast<const __half *>(b.wv.data()), q, k, v, D,
                          config_.rms_eps),
                      "Fused RMSNorm+QKV");
+    fused_span.end();
     q_route_used = "FUSED_GEMV";
     k_route_used = "FUSED_GEMV";
     v_route_used = "FUSED_GEMV";
@@ -1811,9 +1760,14 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                                  hip_stream, v, n_kv);
     }
   } else {
+    OpSpan norm_span(hip_stream, opts_.profile_sync, "rmsnorm_attn", layer_idx);
+    norm_span.add_cost(gcore::rt::rmsnorm_cost(S, D));
     CHECK_HIP_KERNEL(launch_rmsnorm_naive(hip_stream, x, attn_norm, norm_out, S,
                                           D, config_.rms_eps),
                      "RMSNorm (Attn)");
+    norm_span.end();
+    if (drift)
+      drift_->capture(drift, DriftPoint::AttnNorm, norm_out, D, hip_stream);
 
     if (trace_layer) {
       layer_tracer_.trace_tensor("norm_out", trace_step_,
@@ -1826,13 +1780,14 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                                 n_x);
     }
 
+    OpSpan qkv_span(hip_stream, opts_.profile_sync, "qkv", layer_idx);
     if (profile_attn)
       ev_q_start->record(stream_);
     gcore::compute::GretaCompute::set_op_label(
         is_decode_step ? "attn_q_decode" : "attn_q_prefill");
     if (is_decode_step && qkv_force_route) {
-      const std::string forced = to_route_label(qkv_force_route);
-      EnvOverride guard("GRETA_GEMM_FORCE", forced.c_str());
+      EnvOverride guard("GRETA_GEMM_FORCE",
+                        to_route_label(opts_.qkv_force_route));
       CHECK_GRETA(
           gcore::compute::GretaCompute::gemm(stream_, &activations_.norm_out,
                                              &b.wq, &activations_.q, S, D, D),
@@ -1844,7 +1799,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
           "GEMM Q");
     }
     q_route_used =
-        qkv_route_used(S, is_decode_step, use_fused, qkv_force_route);
+        qkv_route_used(opts_, S, is_decode_step, use_fused);
     gcore::compute::GretaCompute::set_op_label(nullptr);
     if (profile_attn)
       ev_q_end->record(stream_);
@@ -1854,8 +1809,8 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     gcore::compute::GretaCompute::set_op_label(
         is_decode_step ? "attn_k_decode" : "attn_k_prefill");
     if (is_decode_step && qkv_force_route) {
-      const std::string forced = to_route_label(qkv_force_route);
-      EnvOverride guard("GRETA_GEMM_FORCE", forced.c_str());
+      EnvOverride guard("GRETA_GEMM_FORCE",
+                        to_route_label(opts_.qkv_force_route));
       CHECK_GRETA(gcore::compute::GretaCompute::gemm(
                       stream_, &activations_.norm_out, &b.wk, &activations_.k,
                       S, kv_dim, D),
@@ -1867,7 +1822,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                   "GEMM K");
     }
     k_route_used =
-        qkv_route_used(S, is_decode_step, use_fused, qkv_force_route);
+        qkv_route_used(opts_, S, is_decode_step, use_fused);
     gcore::compute::GretaCompute::set_op_label(nullptr);
     if (profile_attn)
       ev_k_end->record(stream_);
@@ -1877,8 +1832,8 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     gcore::compute::GretaCompute::set_op_label(
         is_decode_step ? "attn_v_decode" : "attn_v_prefill");
     if (is_decode_step && qkv_force_route) {
-      const std::string forced = to_route_label(qkv_force_route);
-      EnvOverride guard("GRETA_GEMM_FORCE", forced.c_str());
+      EnvOverride guard("GRETA_GEMM_FORCE",
+                        to_route_label(opts_.qkv_force_route));
       CHECK_GRETA(gcore::compute::GretaCompute::gemm(
                       stream_, &activations_.norm_out, &b.wv, &activations_.v,
                       S, kv_dim, D),
@@ -1890,10 +1845,11 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                   "GEMM V");
     }
     v_route_used =
-        qkv_route_used(S, is_decode_step, use_fused, qkv_force_route);
+        qkv_route_used(opts_, S, is_decode_step, use_fused);
     gcore::compute::GretaCompute::set_op_label(nullptr);
     if (profile_attn)
       ev_v_end->record(stream_);
+    qkv_span.end();
 
     if (trace_layer) {
       layer_tracer_.trace_tensor("q", trace_step_, static_cast<int>(layer_idx),
@@ -1905,6 +1861,12 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     }
   }
 
+  if (drift) {
+    drift_->capture(drift, DriftPoint::Q, q, D, hip_stream);
+    drift_->capture(drift, DriftPoint::K, k, kv_dim, hip_stream);
+    drift_->capture(drift, DriftPoint::V, v, kv_dim, hip_stream);
+  }
+
   if (TRACE_ON(layer_idx)) {
     launch_debug_tensor_stats(hip_stream, "L.q_proj.q", q, n_x);
     launch_debug_tensor_stats(hip_stream, "L.k_proj.k", k, n_kv);
@@ -1912,22 +1874,20 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
   }
 
   uint32_t pos = static_cast<uint32_t>(seq_start);
-  const char *use_fused_attn_env = std::getenv("GRETA_USE_FUSED_ATTENTION");
-  bool use_fused_attn =
-      (use_fused_attn_env && std::string(use_fused_attn_env) == "1") &&
-      (S == 1) && (Hkv == Hq);
+  bool use_fused_attn = opts_.fused_attention && (S == 1) && (Hkv == Hq);
   if (S == 1) {
-    const char *force_attn = std::getenv("GRETA_FORCE_ATTN_DECODE_KERNEL");
-    if (force_attn) {
-      std::string force_str(force_attn);
-      if (force_str == "manual" || force_str == "MANUAL") {
-        use_fused_attn = false;
-      } else if (force_str == "fused" || force_str == "FUSED") {
-        use_fused_attn = true;
-      }
-    }
+    if (opts_.attn_decode_kernel == AttnDecodeKernel::Manual)
+      use_fused_attn = false;
+    else if (opts_.attn_decode_kernel == AttnDecodeKernel::Fused)
+      use_fused_attn = true;
   }
 
+  OpSpan rope_span(hip_stream, opts_.profile_sync,
+                   use_fused_attn ? "rope_kv_update" : "rope", layer_idx);
+  rope_span.add_cost(gcore::rt::rope_cost(S, Hq, Dh) +
+                     gcore::rt::rope_cost(S, Hkv, Dh));
+  if (use_fused_attn)
+    rope_span.add_cost(gcore::rt::elementwise_cost(2 * S * kv_dim, 1, 0));
   if (profile_attn)
     ev_rope_start->record(stream_);
 
@@ -1958,10 +1918,18 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
   }
   if (profile_attn)
     ev_rope_end->record(stream_);
+  rope_span.end();
+  if (drift) {
+    drift_->capture(drift, DriftPoint::QRope, q, D, hip_stream);
+    if (!use_fused_attn) // The fused kernel ropes K into the cache only
+      drift_->capture(drift, DriftPoint::KRope, k, kv_dim, hip_stream);
+  }
 
   if (profile_attn)
     ev_kv_start->record(stream_);
   if (!use_fused_attn) {
+    OpSpan kv_span(hip_stream, opts_.profile_sync, "kv_update", layer_idx);
+    kv_span.add_cost(gcore::rt::elementwise_cost(2 * S * kv_dim, 1, 0));
     if (S == 1) {
       CHECK_HIP_KERNEL(launch_kv_update(hip_stream, cache_k, cache_v, k, v,
                                         d_pos, config_.max_seq_len, Hkv, Dh),
@@ -1980,16 +1948,25 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     ev_kv_end->record(stream_);
 
   float scale = 1.0f / sqrtf(static_cast<float>(Dh));
+  OpSpan attn_span(hip_stream, opts_.profile_sync, "attention", layer_idx);
+  attn_span.add_cost(gcore::rt::attention_cost(S, seq_start, Hq, Hkv, Dh));
   if (profile_attn)
     ev_core_start->record(stream_);
 
   if (S == 1) {
-    const int accum_mode = (attn_accum_mode() == AttnAccumMode::Fp16) ? 1 : 0;
+    const int accum_mode = (opts_.attn_accum == AttnAccumMode::Fp16) ? 1 : 0;
     CHECK_HIP_KERNEL(launch_flash_attention_decode(
                          hip_stream, q, cache_k, cache_v, attn_out, Hq, Hkv,
                          d_pos, static_cast<uint32_t>(config_.max_seq_len), Dh,
                          scale, accum_mode),
                      "Attention Core (Decode)");
+  } else if (seq_start > 0) {
+    // Later prefill chunk: earlier positions only exist in the KV cache.
+    CHECK_HIP_KERNEL(launch_flash_attention_prefill_cached(
+                         hip_stream, q, cache_k, cache_v, attn_out, S, pos,
+                         static_cast<uint32_t>(config_.max_seq_len), Hq, Hkv,
+                         Dh, scale),
+                     "Flash Attention Prefill (Chunk)");
   } else {
     CHECK_HIP_KERNEL(launch_flash_attention_prefill(hip_stream, q, k, v,
                                                     attn_out, S, Hq, Hkv, Dh,
@@ -1999,6 +1976,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
 
   if (profile_attn)
     ev_core_end->record(stream_);
+  attn_span.end();
 
   if (profile_attn && layer_idx == 0) {
     stream_->synchronize();
@@ -2027,9 +2005,10 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     delete ev_core_end;
   }
 
-  if (attn_mfma_shadow_enabled() && seq_len == 1 && trace_step_ == 1 &&
-      attn_trace_layer_selected(layer_idx, config_.num_layers)) {
-    const char *out = attn_shadow_out_path();
+  if (attn_mfma_shadow_enabled(opts_.trace) && seq_len == 1 &&
+      trace_step_ == 1 &&
+      attn_trace_layer_selected(opts_.trace, layer_idx, config_.num_layers)) {
+    const char *out = attn_shadow_out_path(opts_.trace);
     if (out && *out) {
       using Usage = gcore::rt::hip::BufferUsage;
       const size_t q_bytes = D * sizeof(float);
@@ -2039,6 +2018,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       const size_t kv_layer_stride_bytes =
           kv_layer_stride_elems * sizeof(float);
       const size_t kv_layer_offset_elems =
+          kv_slot_offset() +
           static_cast<size_t>(layer_idx) * kv_layer_stride_elems;
       const float *k_cache_layer =
           static_cast<const float *>(activations_.kv_cache_k.data()) +
@@ -2204,10 +2184,11 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     }
   }
 
-  if ((trace_attn_l0_pipe_enabled() || trace_attn_l0_norm_enabled() ||
-       trace_qkv_w_verify_enabled()) &&
+  if ((trace_attn_l0_pipe_enabled(opts_.trace) ||
+       trace_attn_l0_norm_enabled(opts_.trace) ||
+       trace_qkv_w_verify_enabled(opts_.trace)) &&
       layer_idx == 0) {
-    const char *out = attn_l0_pipe_out_path();
+    const char *out = attn_l0_pipe_out_path(opts_.trace);
     const char *phase = nullptr;
     if (seq_len > 1 && trace_step_ == 0) {
       phase = "prefill_last";
@@ -2215,7 +2196,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       phase = "decode0";
     }
     if (out && *out && phase) {
-      const bool qkv_w_verify = trace_qkv_w_verify_enabled();
+      const bool qkv_w_verify = trace_qkv_w_verify_enabled(opts_.trace);
       const uint32_t head = 0;
       const uint32_t max_seq_len = static_cast<uint32_t>(config_.max_seq_len);
       uint32_t seq_len_used = (seq_len == 1)
@@ -2237,7 +2218,8 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
         const float *q_token = q + static_cast<size_t>(token_index_used) * D;
         const float *q_head = q_token + head * Dh;
 
-        const bool want_norm = trace_attn_l0_norm_enabled() || qkv_w_verify;
+        const bool want_norm =
+            trace_attn_l0_norm_enabled(opts_.trace) || qkv_w_verify;
         const uint32_t norm_sample =
             want_norm
                 ? (qkv_w_verify ? D
@@ -2405,8 +2387,8 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
         uint32_t v_weight_sample = 0;
         if (qkv_w_verify && norm_out_valid &&
             norm_out_host.size() >= static_cast<size_t>(D)) {
-          q_weight_sample = std::min<uint32_t>(attn_vacc_dims_sample(),
-                                               static_cast<uint32_t>(Dh));
+          q_weight_sample = std::min<uint32_t>(
+              attn_vacc_dims_sample(opts_.trace), static_cast<uint32_t>(Dh));
           if (q_weight_sample > 0 && Dh > 0) {
             static QkvWeightHostCache wq_cache;
             const size_t wq_elems = static_cast<size_t>(D) * D;
@@ -2605,7 +2587,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
           return tmp.str();
         };
 
-        const char *prompt_id = std::getenv("GRETA_TRACE_PROMPT_ID");
+        const char *prompt_id = opts_.trace.prompt();
         std::ostringstream oss;
         oss << "{\"event\":\"attn_l0_pipe\"";
         if (prompt_id && *prompt_id)
@@ -2742,6 +2724,14 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     }
   }
 
+  if (drift) {
+    drift_->capture_cache(drift, DriftPoint::KCache, cache_k,
+                          config_.max_seq_len, hip_stream);
+    drift_->capture_cache(drift, DriftPoint::VCache, cache_v,
+                          config_.max_seq_len, hip_stream);
+    drift_->capture(drift, DriftPoint::AttnOut, attn_out, D, hip_stream);
+  }
+
   if (trace_layer) {
     layer_tracer_.trace_tensor("attn_out", trace_step_,
                                static_cast<int>(layer_idx), hip_stream,
@@ -2759,13 +2749,14 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                        attn_out, D, stage_token_index, hip_stream);
   }
   if (post_wo_layer) {
-    post_wo_trace_tensor("attn_out", stage_phase, stage_prompt_id, layer_idx,
-                         static_cast<uint32_t>(trace_step_), stage_pos_id,
-                         static_cast<uint32_t>(seq_len), stage_tokens_total,
-                         attn_out, D, stage_token_index,
+    post_wo_trace_tensor(opts_.trace, "attn_out", stage_phase, stage_prompt_id,
+                         layer_idx, static_cast<uint32_t>(trace_step_),
+                         stage_pos_id, static_cast<uint32_t>(seq_len),
+                         stage_tokens_total, attn_out, D, stage_token_index,
                          activations_.attn_out.size(), hip_stream);
   }
 
+  OpSpan wo_span(hip_stream, opts_.profile_sync, "wo", layer_idx);
   gcore::compute::GretaCompute::set_op_label(is_decode_step ? "attn_o_decode"
                                                             : "attn_o_prefill");
   CHECK_GRETA(
@@ -2773,6 +2764,9 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                                          &activations_.mlp_out, S, D, D),
       "GEMM O");
   gcore::compute::GretaCompute::set_op_label(nullptr);
+  wo_span.end();
+  if (drift)
+    drift_->capture(drift, DriftPoint::WoOut, mlp_out, D, hip_stream);
 
   if (stage_layer) {
     stage_trace_tensor("wo_out", stage_phase, stage_prompt_id, layer_idx,
@@ -2781,18 +2775,19 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                        mlp_out, D, stage_token_index, hip_stream);
   }
   if (post_wo_layer) {
-    post_wo_trace_tensor("wo_out", stage_phase, stage_prompt_id, layer_idx,
-                         static_cast<uint32_t>(trace_step_), stage_pos_id,
-                         static_cast<uint32_t>(seq_len), stage_tokens_total,
-                         mlp_out, D, stage_token_index,
+    post_wo_trace_tensor(opts_.trace, "wo_out", stage_phase, stage_prompt_id,
+                         layer_idx, static_cast<uint32_t>(trace_step_),
+                         stage_pos_id, static_cast<uint32_t>(seq_len),
+                         stage_tokens_total, mlp_out, D, stage_token_index,
                          activations_.mlp_out.size(), hip_stream);
   }
 
-  if (stage_layer && trace_wo_w_verify_enabled()) {
+  if (stage_layer && trace_wo_w_verify_enabled(opts_.trace)) {
     const char *out = stage_trace_out_path();
     if (out && *out) {
       const uint32_t wo_weight_sample =
-          std::min<uint32_t>(attn_vacc_dims_sample(), static_cast<uint32_t>(D));
+          std::min<uint32_t>(attn_vacc_dims_sample(opts_.trace),
+                             static_cast<uint32_t>(D));
       std::string wo_weight_layout = "disabled";
       double wo_weight_mae_row = 0.0;
       double wo_weight_mae_col = 0.0;
@@ -2863,9 +2858,9 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
         }
       }
 
-      const char *wo_layout_env = std::getenv("GRETA_WO_LAYOUT_FORCE");
-      const char *wo_layout_used =
-          (wo_layout_env && *wo_layout_env) ? wo_layout_env : "auto";
+      const char *wo_layout_used = opts_.wo_layout_force.empty()
+                                       ? "auto"
+                                       : opts_.wo_layout_force.c_str();
       std::ostringstream oss;
       oss << "{\"event\":\"wo_verify\"";
       if (stage_prompt_id && *stage_prompt_id)
@@ -2893,8 +2888,14 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     }
   }
 
+  OpSpan residual_attn_span(hip_stream, opts_.profile_sync, "residual_attn",
+                            layer_idx);
+  residual_attn_span.add_cost(gcore::rt::elementwise_cost(S * D, 2, 1));
   CHECK_HIP_KERNEL(launch_add(hip_stream, x, mlp_out, x, S * D),
                    "Residual (Attn)");
+  residual_attn_span.end();
+  if (drift)
+    drift_->capture(drift, DriftPoint::XAttn, x, D, hip_stream);
 
   if (stage_layer) {
     stage_trace_tensor("x_after_attn", stage_phase, stage_prompt_id, layer_idx,
@@ -2903,29 +2904,35 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                        stage_token_index, hip_stream);
   }
   if (post_wo_layer) {
-    post_wo_trace_tensor("x_after_attn", stage_phase, stage_prompt_id,
-                         layer_idx, static_cast<uint32_t>(trace_step_),
-                         stage_pos_id, static_cast<uint32_t>(seq_len),
-                         stage_tokens_total, x, D, stage_token_index,
-                         activations_.x.size(), hip_stream);
+    post_wo_trace_tensor(opts_.trace, "x_after_attn", stage_phase,
+                         stage_prompt_id, layer_idx,
+                         static_cast<uint32_t>(trace_step_), stage_pos_id,
+                         static_cast<uint32_t>(seq_len), stage_tokens_total, x,
+                         D, stage_token_index, activations_.x.size(),
+                         hip_stream);
   }
 
+  OpSpan ffn_norm_span(hip_stream, opts_.profile_sync, "rmsnorm_ffn", layer_idx);
+  ffn_norm_span.add_cost(gcore::rt::rmsnorm_cost(S, D));
   CHECK_HIP_KERNEL(
       launch_rmsnorm_naive(hip_stream, x,
                            static_cast<const float *>(b.ffn_norm.data()),
                            norm_out, S, D, config_.rms_eps),
       "RMSNorm (FFN)");
-
-  if (trace_rmsnorm_enabled() && stage_phase &&
-      rmsnorm_phase_enabled(stage_phase) &&
-      rmsnorm_layer_selected(layer_idx, config_.num_layers) &&
-      rmsnorm_out_path()) {
-    trace_rmsnorm(stage_phase, stage_prompt_id, layer_idx, config_.num_layers,
-                  static_cast<uint32_t>(trace_step_), stage_pos_id,
-                  static_cast<uint32_t>(seq_len), stage_tokens_total, x,
-                  norm_out, D, stage_token_index, activations_.x.size(),
-                  activations_.norm_out.size(), b.ffn_norm, config_.rms_eps,
-                  hip_stream);
+  ffn_norm_span.end();
+  if (drift)
+    drift_->capture(drift, DriftPoint::FfnNorm, norm_out, D, hip_stream);
+
+  if (trace_rmsnorm_enabled(opts_.trace) && stage_phase &&
+      rmsnorm_phase_enabled(opts_.trace, stage_phase) &&
+      rmsnorm_layer_selected(opts_.trace, layer_idx, config_.num_layers) &&
+      rmsnorm_out_path(opts_.trace)) {
+    trace_rmsnorm(opts_.trace, stage_phase, stage_prompt_id, layer_idx,
+                  config_.num_layers, static_cast<uint32_t>(trace_step_),
+                  stage_pos_id, static_cast<uint32_t>(seq_len),
+                  stage_tokens_total, x, norm_out, D, stage_token_index,
+                  activations_.x.size(), activations_.norm_out.size(),
+                  b.ffn_norm, config_.rms_eps, hip_stream);
   }
 
   if (stage_layer) {
@@ -2935,10 +2942,10 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                        norm_out, D, stage_token_index, hip_stream);
   }
   if (post_wo_layer) {
-    post_wo_trace_tensor("ffn_norm", stage_phase, stage_prompt_id, layer_idx,
-                         static_cast<uint32_t>(trace_step_), stage_pos_id,
-                         static_cast<uint32_t>(seq_len), stage_tokens_total,
-                         norm_out, D, stage_token_index,
+    post_wo_trace_tensor(opts_.trace, "ffn_norm", stage_phase, stage_prompt_id,
+                         layer_idx, static_cast<uint32_t>(trace_step_),
+                         stage_pos_id, static_cast<uint32_t>(seq_len),
+                         stage_tokens_total, norm_out, D, stage_token_index,
                          activations_.norm_out.size(), hip_stream);
   }
 
@@ -2953,11 +2960,13 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                               n_x);
   }
 
-  const char *use_fused_ffn_env = std::getenv("GRETA_USE_FUSED_FFN");
-  bool use_fused_ffn =
-      (use_fused_ffn_env && std::string(use_fused_ffn_env) == "1") && (S == 1);
+  OpSpan ffn_span(hip_stream, opts_.profile_sync, "ffn", layer_idx);
+  const bool use_fused_ffn = opts_.fused_ffn && (S == 1);
 
   if (use_fused_ffn) {
+    // Gate and up GEMVs against fp16 weights, then SiLU(gate) * up.
+    ffn_span.add_cost(gcore::rt::gemm_cost(1, 2 * hidden_dim, D, 32, 16, 0) +
+                      gcore::rt::OpCost{5 * hidden_dim, hidden_dim * 4});
     CHECK_HIP_KERNEL(
         launch_fused_ffn_front_f16(
             hip_stream, norm_out, static_cast<const __half *>(b.w1.data()),
@@ -2972,6 +2981,11 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                     stream_, &activations_.norm_out, &b.w3,
                     &activations_.mlp_up, S, hidden_dim, D),
                 "GEMM W3");
+    if (drift) {
+      drift_->capture(drift, DriftPoint::Gate, mlp_gate, hidden_dim,
+                      hip_stream);
+      drift_->capture(drift, DriftPoint::Up, mlp_up, hidden_dim, hip_stream);
+    }
 
     if (trace_layer) {
       layer_tracer_.trace_tensor("mlp_gate", trace_step_,
@@ -2988,6 +3002,8 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       launch_debug_tensor_stats(hip_stream, "L.ffn.up.nonfused", mlp_up, n_mlp);
     }
 
+    ffn_span.add_cost(gcore::rt::elementwise_cost(n_mlp, 1, 4) +
+                      gcore::rt::elementwise_cost(n_mlp, 2, 1));
     CHECK_HIP_KERNEL(
         launch_silu(hip_stream, mlp_gate, mlp_gate, S * hidden_dim), "SiLU");
     CHECK_HIP_KERNEL(
@@ -2999,11 +3015,17 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     launch_debug_tensor_stats(hip_stream, "L.ffn.gate_after_mul", mlp_gate,
                               n_mlp);
   }
+  if (drift)
+    drift_->capture(drift, DriftPoint::GateAct, mlp_gate, hidden_dim,
+                    hip_stream);
 
   CHECK_GRETA(gcore::compute::GretaCompute::gemm(
                   stream_, &activations_.mlp_gate, &b.w2, &activations_.mlp_out,
                   S, D, hidden_dim),
               "GEMM W2");
+  ffn_span.end();
+  if (drift)
+    drift_->capture(drift, DriftPoint::FfnOut, mlp_out, D, hip_stream);
 
   if (trace_layer) {
     layer_tracer_.trace_tensor("mlp_out", trace_step_,
@@ -3022,15 +3044,23 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
                        mlp_out, D, stage_token_index, hip_stream);
   }
   if (post_wo_layer) {
-    post_wo_trace_tensor("mlp_out", stage_phase, stage_prompt_id, layer_idx,
-                         static_cast<uint32_t>(trace_step_), stage_pos_id,
-                         static_cast<uint32_t>(seq_len), stage_tokens_total,
-                         mlp_out, D, stage_token_index,
+    post_wo_trace_tensor(opts_.trace, "mlp_out", stage_phase, stage_prompt_id,
+                         layer_idx, static_cast<uint32_t>(trace_step_),
+                         stage_pos_id, static_cast<uint32_t>(seq_len),
+                         stage_tokens_total, mlp_out, D, stage_token_index,
                          activations_.mlp_out.size(), hip_stream);
   }
 
+  OpSpan residual_ffn_span(hip_stream, opts_.profile_sync, "residual_ffn",
+                           layer_idx);
+  residual_ffn_span.add_cost(gcore::rt::elementwise_cost(S * D, 2, 1));
   CHECK_HIP_KERNEL(launch_add(hip_stream, x, mlp_out, x, S * D),
                    "Residual (FFN)");
+  residual_ffn_span.end();
+  if (drift) {
+    drift_->capture(drift, DriftPoint::XOut, x, D, hip_stream);
+    drift_guard.submit();
+  }
 
   if (stage_layer) {
     stage_trace_tensor("x_after_mlp", stage_phase, stage_prompt_id, layer_idx,
@@ -3045,16 +3075,17 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     }
   }
   if (post_wo_layer) {
-    post_wo_trace_tensor("x_after_mlp", stage_phase, stage_prompt_id, layer_idx,
-                         static_cast<uint32_t>(trace_step_), stage_pos_id,
-                         static_cast<uint32_t>(seq_len), stage_tokens_total, x,
-                         D, stage_token_index, activations_.x.size(),
-                         hip_stream);
-    post_wo_trace_tensor("x_out", stage_phase, stage_prompt_id, layer_idx,
+    post_wo_trace_tensor(opts_.trace, "x_after_mlp", stage_phase,
+                         stage_prompt_id, layer_idx,
                          static_cast<uint32_t>(trace_step_), stage_pos_id,
                          static_cast<uint32_t>(seq_len), stage_tokens_total, x,
                          D, stage_token_index, activations_.x.size(),
                          hip_stream);
+    post_wo_trace_tensor(opts_.trace, "x_out", stage_phase, stage_prompt_id,
+                         layer_idx, static_cast<uint32_t>(trace_step_),
+                         stage_pos_id, static_cast<uint32_t>(seq_len),
+                         stage_tokens_total, x, D, stage_token_index,
+                         activations_.x.size(), hip_stream);
   }
 
   if (PROFILE_ON()) {
@@ -3083,34 +3114,33 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     launch_debug_tensor_stats(hip_stream, "L.residual.x", x, n_x);
   }
 
-  const bool trace_attn_verify = trace_attn_decode_verify_enabled();
-  const bool trace_attn_ref = trace_attn_ref_enabled();
-  const bool trace_attn_softmax = trace_attn_softmax_enabled();
-  const bool trace_attn_vacc = trace_attn_vacc_enabled();
-  const bool trace_v_addr = trace_v_addr_enabled();
+  const bool trace_attn_verify = trace_attn_decode_verify_enabled(opts_.trace);
+  const bool trace_attn_ref = trace_attn_ref_enabled(opts_.trace);
+  const bool trace_attn_softmax = trace_attn_softmax_enabled(opts_.trace);
+  const bool trace_attn_vacc = trace_attn_vacc_enabled(opts_.trace);
+  const bool trace_v_addr = trace_v_addr_enabled(opts_.trace);
   const bool trace_attn_layer =
-      attn_trace_layer_selected(layer_idx, config_.num_layers);
+      attn_trace_layer_selected(opts_.trace, layer_idx, config_.num_layers);
   const bool trace_softmax_layer =
-      attn_softmax_layer_selected(layer_idx, config_.num_layers);
+      attn_softmax_layer_selected(opts_.trace, layer_idx, config_.num_layers);
   const bool trace_vacc_layer =
-      attn_softmax_layer_selected(layer_idx, config_.num_layers);
+      attn_softmax_layer_selected(opts_.trace, layer_idx, config_.num_layers);
   const bool trace_v_addr_layer =
-      attn_softmax_layer_selected(layer_idx, config_.num_layers);
+      attn_softmax_layer_selected(opts_.trace, layer_idx, config_.num_layers);
   if ((trace_attn_verify || trace_attn_ref || trace_attn_softmax ||
        trace_attn_vacc || trace_v_addr) &&
       seq_len == 1 && trace_step_ == 1 &&
       (trace_attn_layer || trace_softmax_layer || trace_vacc_layer ||
        trace_v_addr_layer)) {
-    const char *out = attn_trace_out_path();
-    const char *out_ref = attn_ref_out_path();
-    const char *out_softmax = attn_softmax_out_path();
-    const char *out_vacc = attn_vacc_out_path();
-    const char *out_v_addr = v_addr_out_path();
+    const char *out = attn_trace_out_path(opts_.trace);
+    const char *out_ref = attn_ref_out_path(opts_.trace);
+    const char *out_softmax = attn_softmax_out_path(opts_.trace);
+    const char *out_vacc = attn_vacc_out_path(opts_.trace);
+    const char *out_v_addr = v_addr_out_path(opts_.trace);
     if ((trace_attn_verify && out && *out) || trace_attn_ref ||
         trace_attn_softmax || trace_attn_vacc ||
         (trace_v_addr && out_v_addr && *out_v_addr)) {
-      const uint32_t point_mask =
-          attn_point_mask_from_list(std::getenv("GRETA_TRACE_ATTN_POINTS"));
+      const uint32_t point_mask = opts_.trace.attn_points;
       const uint32_t seq_len_used = static_cast<uint32_t>(seq_start + 1);
       const uint32_t pos_id_used = static_cast<uint32_t>(seq_start);
       const uint32_t max_seq_len = static_cast<uint32_t>(config_.max_seq_len);
@@ -3140,6 +3170,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       const size_t kv_layer_stride_bytes =
           kv_layer_stride_elems * sizeof(float);
       const size_t kv_layer_offset_elems =
+          kv_slot_offset() +
           static_cast<size_t>(layer_idx) * kv_layer_stride_elems;
       const float *k_cache_layer =
           static_cast<const float *>(activations_.kv_cache_k.data()) +
@@ -3148,7 +3179,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
           static_cast<const float *>(activations_.kv_cache_v.data()) +
           kv_layer_offset_elems;
 
-      const uint32_t trace_head = attn_softmax_head();
+      const uint32_t trace_head = attn_softmax_head(opts_.trace);
       const uint32_t group = (Hkv > 0) ? (Hq / Hkv) : 0;
       const uint32_t trace_kv_head =
           (group > 0 && trace_head < Hq) ? (trace_head / group) : 0;
@@ -3160,7 +3191,8 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       std::vector<float> v_cache_host;
       bool kv_head_only = false;
       bool need_kv_full =
-          attn_decode_ref_enabled() || trace_attn_ref || trace_attn_verify ||
+          attn_decode_ref_enabled(opts_.trace) || trace_attn_ref ||
+          trace_attn_verify ||
           (point_mask & static_cast<uint32_t>(AttnTracePoint::K)) ||
           (point_mask & static_cast<uint32_t>(AttnTracePoint::V));
       bool need_kv_head = trace_attn_softmax || trace_attn_vacc || trace_v_addr;
@@ -3232,7 +3264,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       std::vector<float> attn_ref;
       uint64_t attn_ref_hash = 0;
       double attn_mae = 0.0;
-      if (attn_decode_ref_enabled() && !q_host.empty() &&
+      if (attn_decode_ref_enabled(opts_.trace) && !q_host.empty() &&
           !k_cache_host.empty() && !v_cache_host.empty() &&
           !attn_out_host.empty()) {
         const float scale = 1.0f / sqrtf(static_cast<float>(Dh));
@@ -3255,7 +3287,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       const size_t v_read_offset_bytes = v_read_offset_elems * sizeof(float);
       bool kv_invariant_ok = true;
       std::string kv_error;
-      if (env_flag("GRETA_TRACE_KV_INVARIANTS")) {
+      if (opts_.trace.kv_invariants) {
         if (kv_pos != pos_id_used) {
           kv_invariant_ok = false;
           kv_error = "kv_pos_mismatch";
@@ -3286,9 +3318,9 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
             << ",\"pos_id_used\":" << pos_id_used << ",\"kernel_path\":\""
             << (use_fused_attn ? "fused" : "manual") << "\""
             << ",\"matmul_route\":\""
-            << (std::getenv("GRETA_FORCE_ATTN_DECODE_MATMUL")
-                    ? std::getenv("GRETA_FORCE_ATTN_DECODE_MATMUL")
-                    : "auto")
+            << (opts_.attn_decode_matmul.empty()
+                    ? "auto"
+                    : opts_.attn_decode_matmul.c_str())
             << "\""
             << ",\"num_heads\":" << Hq << ",\"num_heads_kv\":" << Hkv
             << ",\"head_dim\":" << Dh << ",\"q_hash\":" << q_hash
@@ -3332,7 +3364,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
             Dh, seq_len_used, max_seq_len, scale_d, attn_ref_hp);
 
         std::vector<float> attn_ref_accum;
-        const AttnAccumMode mode = attn_accum_mode();
+        const AttnAccumMode mode = opts_.attn_accum;
         if (mode == AttnAccumMode::Fp16) {
           compute_attention_ref_fp16_accum(
               q_host.data(), k_cache_host.data(), v_cache_host.data(), Hq, Hkv,
@@ -3421,9 +3453,10 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       const bool need_softmax_window =
           ((trace_attn_softmax && out_softmax && *out_softmax) ||
            (trace_attn_vacc && out_vacc && *out_vacc)) &&
-          attn_softmax_layer_selected(layer_idx, config_.num_layers);
+          attn_softmax_layer_selected(opts_.trace, layer_idx,
+                                      config_.num_layers);
 
-      const uint32_t head = attn_softmax_head();
+      const uint32_t head = attn_softmax_head(opts_.trace);
       const float *q_head = (!q_host.empty() && head < Hq)
                                 ? (q_host.data() + head * Dh)
                                 : nullptr;
@@ -3436,7 +3469,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       }
 
       if (need_softmax_window && q_head && k_head) {
-        const uint32_t window = attn_softmax_window();
+        const uint32_t window = attn_softmax_window(opts_.trace);
         const uint32_t pos_id = pos_id_used;
         seq_len_trace = seq_len_used;
         window_start = (seq_len_trace > window) ? (seq_len_trace - window) : 0;
@@ -3462,6 +3495,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
             const size_t kv_layer_stride_elems =
                 static_cast<size_t>(config_.max_seq_len) * Hkv * Dh;
             const size_t kv_layer_offset_elems =
+                kv_slot_offset() +
                 static_cast<size_t>(layer_idx) * kv_layer_stride_elems;
             const float *k_cache_layer =
                 static_cast<const float *>(activations_.kv_cache_k.data()) +
@@ -3562,7 +3596,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
 
       if (trace_attn_softmax && out_softmax && *out_softmax &&
           softmax_window_ok) {
-        const char *prompt_id = std::getenv("GRETA_TRACE_PROMPT_ID");
+        const char *prompt_id = opts_.trace.prompt();
         std::ostringstream oss;
         oss << "{\"event\":\"attn_softmax_trace\"";
         if (prompt_id && *prompt_id) {
@@ -3627,7 +3661,8 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
 
       if (trace_attn_vacc && out_vacc && *out_vacc && softmax_window_ok &&
           !attn_out_host.empty() && head < Hq) {
-        const uint32_t dims_sample = std::min(attn_vacc_dims_sample(), Dh);
+        const uint32_t dims_sample =
+            std::min(attn_vacc_dims_sample(opts_.trace), Dh);
         if (dims_sample > 0 && window_len > 0) {
           using Usage = gcore::rt::hip::BufferUsage;
           gcore::rt::hip::Buffer v_row_dev;
@@ -3646,6 +3681,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
             const size_t kv_layer_stride_elems =
                 static_cast<size_t>(config_.max_seq_len) * Hkv * Dh;
             const size_t kv_layer_offset_elems =
+                kv_slot_offset() +
                 static_cast<size_t>(layer_idx) * kv_layer_stride_elems;
             const float *v_cache_layer =
                 static_cast<const float *>(activations_.kv_cache_v.data()) +
@@ -3743,7 +3779,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
             }
             pv_mae = dims_sample > 0 ? (pv_mae / dims_sample) : 0.0;
 
-            const char *prompt_id = std::getenv("GRETA_TRACE_PROMPT_ID");
+            const char *prompt_id = opts_.trace.prompt();
             std::ostringstream oss;
             oss << "{\"event\":\"attn_vacc_trace\"";
             if (prompt_id && *prompt_id) {
@@ -3817,7 +3853,8 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
       }
 
       if (trace_v_addr && out_v_addr && *out_v_addr && trace_kv_head < Hkv) {
-        const uint32_t dims_sample = std::min(attn_vacc_dims_sample(), Dh);
+        const uint32_t dims_sample =
+            std::min(attn_vacc_dims_sample(opts_.trace), Dh);
         const uint32_t pos_cur = pos_id_used;
         const uint32_t pos_prev = (pos_cur > 0) ? (pos_cur - 1) : pos_cur;
         const uint32_t pos_next =
@@ -3921,7 +3958,7 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
         const uintptr_t v_pos_ptr =
             v_head_ptr + static_cast<uintptr_t>(pos_cur) * kv_pos_stride_bytes;
 
-        const char *prompt_id = std::getenv("GRETA_TRACE_PROMPT_ID");
+        const char *prompt_id = opts_.trace.prompt();
         std::ostringstream oss;
         oss << "{\"event\":\"v_addr_trace\"";
         if (prompt_id && *prompt_id) {
@@ -4022,9 +4059,9 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
     }
   }
 
-  if (env_flag("GRETA_TRACE_LAYER_DELTA") && seq_len == 1 &&
+  if (trace_layer_delta_enabled(opts_.trace) && seq_len == 1 &&
       (layer_idx == 0 || (layer_idx + 1) == config_.num_layers)) {
-    const char *out = layer_delta_out_path();
+    const char *out = layer_delta_out_path(opts_.trace);
     if (out && *out) {
       auto capture = [&](const float *d, uint32_t n, F32Stats *stats,
                          uint64_t *hash) -> bool {
@@ -4076,8 +4113,15 @@ bool BlockScheduler::execute_layer(size_t layer_idx, size_t seq_start,
 }
 
 bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
-                             size_t seq_len, std::string *err) {
+                             size_t seq_len, std::string *err, size_t slot) {
   using namespace gcore::rt::hip::kernels;
+  if (slot >= kv_slots_) {
+    if (err)
+      *err = "forward: slot=" + std::to_string(slot) + " outside [0, " +
+             std::to_string(kv_slots_) + ")";
+    return false;
+  }
+  kv_slot_ = slot;
   if (seq_len == 0) {
     if (err)
       *err = "Embedding Lookup input has seq_len=0";
@@ -4092,6 +4136,16 @@ bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
     }
     return false;
   }
+  if (seq_len > activation_tokens_) {
+    if (err) {
+      std::ostringstream oss;
+      oss << "Embedding Lookup seq_len(" << seq_len
+          << ") exceeds activation capacity(" << activation_tokens_
+          << "); use prefill() to run it in chunks";
+      *err = oss.str();
+    }
+    return false;
+  }
   if (seq_start + seq_len > config_.max_seq_len) {
     if (err) {
       std::ostringstream oss;
@@ -4111,12 +4165,15 @@ bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
   const float *embd_w = static_cast<const float *>(token_embd_.data());
   const int32_t *d_tokens =
       static_cast<const int32_t *>(activations_.tokens.data());
-  const bool embed_row_major = embed_layout_row_major();
+  const bool embed_row_major = opts_.embed_row_major;
 
   hipStream_t hip_stream =
       static_cast<gcore::rt::hip::GretaStreamHip *>(stream_)->handle();
+  OpSpan forward_span(hip_stream, opts_.profile_sync,
+                      (S == 1 && seq_start > 0) ? "decode" : "prefill",
+                      "forward", "pos", static_cast<int64_t>(seq_start));
 
-  const bool stage_trace_on = stage_trace_enabled();
+  const bool stage_trace_on = kTraceEnabled && stage_trace_enabled();
   const char *stage_phase_fwd = nullptr;
   if (stage_trace_on) {
     if (S > 1 && trace_step_ == 0) {
@@ -4129,7 +4186,7 @@ bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
   // B3.59: Weight Hash (First 1KB)
   if (stage_trace_on && stage_phase_fwd &&
       stage_trace_point_enabled("embd_w_hash")) {
-    const char *stage_prompt_id = std::getenv("GRETA_TRACE_PROMPT_ID");
+    const char *stage_prompt_id = opts_.trace.prompt();
     const float *w_ptr = reinterpret_cast<const float *>(token_embd_.data());
     // We trace only a small sample (256 floats = 1KB) of the weight table to
     // verify it's the same
@@ -4138,14 +4195,17 @@ bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
                        0, hip_stream);
   }
 
+  OpSpan embed_span(hip_stream, opts_.profile_sync, "op", "embedding");
+  embed_span.add_cost(gcore::rt::elementwise_cost(S * D, 1, 0));
   CHECK_HIP_KERNEL(launch_embedding_lookup(hip_stream, d_tokens, embd_w, x, S,
                                            D, config_.vocab_size,
                                            embed_row_major),
                    "Embedding Lookup");
+  embed_span.end();
 
   if (stage_trace_on && stage_phase_fwd &&
       stage_trace_point_enabled("embed_out")) {
-    const char *stage_prompt_id = std::getenv("GRETA_TRACE_PROMPT_ID");
+    const char *stage_prompt_id = opts_.trace.prompt();
     const uint32_t stage_tokens_total = static_cast<uint32_t>(seq_start + S);
     const uint32_t stage_token_index = S > 0 ? static_cast<uint32_t>(S - 1) : 0;
     const uint32_t stage_pos_id =
@@ -4172,31 +4232,39 @@ bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
                        stage_tokens_total, x, D, stage_token_index, hip_stream,
                        &input_meta);
   }
-  if (!trace_embed_verify_once(tokens, seq_len, D, V, token_embd_,
+  if (!trace_embed_verify_once(opts_.trace, tokens, seq_len, D, V, token_embd_,
                                activations_.x, embed_row_major, err))
     return false;
 
   uint32_t pos = static_cast<uint32_t>(seq_start);
   activations_.d_pos.copy_to_device(&pos, sizeof(uint32_t), err);
 
-  const char *use_graph_env = std::getenv("GRETA_GRAPH");
-  bool use_graph =
-      (use_graph_env && std::string(use_graph_env) == "1") && (S == 1);
+  // Non-final prefill chunks of one token skip the LM head; capturing or
+  // replaying the decode graph there would bake in (or skip) that choice.
+  // The graph is captured with slot 0's KV pointers, so only slot 0 uses it.
+  const bool use_graph =
+      opts_.graph && (S == 1) && !skip_lm_head_ && slot == 0;
 
   if (use_graph && graph_captured_) {
-    const char *profile_blocks = std::getenv("GRETA_PROFILE_BLOCKS");
-    if (profile_blocks && std::string(profile_blocks) == "1") {
+    if (opts_.profile_blocks) {
       printf("[GRETA_L0_AUDIT] Graph Launch (Decode Step)\n");
     }
+    OpSpan launch_span(hip_stream, opts_.profile_sync, "op", "graph_launch");
+    launch_span.add_cost(graph_step_cost_ + decode_attention_cost(seq_start));
     CHECK_GRETA(graph_->launch(stream_), "Graph Launch");
+    last_logits_rows_ = 1;
   } else {
     if (use_graph && !graph_captured_) {
       if (!graph_)
         graph_ = gcore::rt::GretaContext::instance().create_graph();
       graph_->capture_start(stream_);
     }
+    // What the spans below charge is what a replay of this step runs.
+    gcore::rt::CostTally step_cost;
 
     for (size_t i = 0; i < config_.num_layers; ++i) {
+      OpSpan block_span(hip_stream, opts_.profile_sync, "layer", "block",
+                        "layer", static_cast<int64_t>(i));
       if (!execute_layer(i, seq_start, seq_len, tokens, err))
         return false;
     }
@@ -4204,12 +4272,16 @@ bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
     float *norm_out = static_cast<float *>(activations_.norm_out.data());
     const float *onorm_w = static_cast<const float *>(output_norm_.data());
 
+    OpSpan final_norm_span(hip_stream, opts_.profile_sync, "op",
+                           "final_rmsnorm");
+    final_norm_span.add_cost(gcore::rt::rmsnorm_cost(S, D));
     CHECK_HIP_KERNEL(launch_rmsnorm_naive(hip_stream, x, onorm_w, norm_out, S,
                                           D, config_.rms_eps),
                      "Final RMSNorm");
+    final_norm_span.end();
 
-    const bool stage_enabled = stage_trace_enabled();
-    const bool post_wo_enabled = trace_post_wo_enabled();
+    const bool stage_enabled = kTraceEnabled && stage_trace_enabled();
+    const bool post_wo_enabled = trace_post_wo_enabled(opts_.trace);
     const char *stage_phase = nullptr;
     if (stage_enabled || post_wo_enabled) {
       if (seq_len > 1 && trace_step_ == 0) {
@@ -4225,7 +4297,7 @@ bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
           seq_len > 0 ? static_cast<uint32_t>(seq_len - 1) : 0;
       const uint32_t stage_pos_id =
           static_cast<uint32_t>(seq_start + stage_token_index);
-      const char *stage_prompt_id = std::getenv("GRETA_TRACE_PROMPT_ID");
+      const char *stage_prompt_id = opts_.trace.prompt();
       const size_t stride_elems = D;
       const size_t final_layer = config_.num_layers;
 
@@ -4252,61 +4324,81 @@ bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
       }
     }
 
-    if (trace_post_wo_enabled() && post_wo_out_path() && stage_phase &&
-        post_wo_phase_enabled(stage_phase)) {
+    if (trace_post_wo_enabled(opts_.trace) && post_wo_out_path(opts_.trace) &&
+        stage_phase && post_wo_phase_enabled(opts_.trace, stage_phase)) {
       const uint32_t stage_tokens_total =
           static_cast<uint32_t>(seq_start + seq_len);
       const uint32_t stage_token_index =
           seq_len > 0 ? static_cast<uint32_t>(seq_len - 1) : 0;
       const uint32_t stage_pos_id =
           static_cast<uint32_t>(seq_start + stage_token_index);
-      const char *stage_prompt_id = std::getenv("GRETA_TRACE_PROMPT_ID");
+      const char *stage_prompt_id = opts_.trace.prompt();
       const size_t stride_elems = D;
       const size_t final_layer = config_.num_layers;
-      if (post_wo_layer_selected(final_layer, config_.num_layers)) {
-        post_wo_trace_tensor("final_rms", stage_phase, stage_prompt_id,
-                             final_layer, static_cast<uint32_t>(trace_step_),
-                             stage_pos_id, static_cast<uint32_t>(seq_len),
-                             stage_tokens_total, norm_out, stride_elems,
-                             stage_token_index, activations_.norm_out.size(),
-                             hip_stream);
-        post_wo_trace_tensor("lm_head_in", stage_phase, stage_prompt_id,
-                             final_layer, static_cast<uint32_t>(trace_step_),
-                             stage_pos_id, static_cast<uint32_t>(seq_len),
-                             stage_tokens_total, norm_out, stride_elems,
-                             stage_token_index, activations_.norm_out.size(),
-                             hip_stream);
+      if (post_wo_layer_selected(opts_.trace, final_layer,
+                                 config_.num_layers)) {
+        post_wo_trace_tensor(opts_.trace, "final_rms", stage_phase,
+                             stage_prompt_id, final_layer,
+                             static_cast<uint32_t>(trace_step_), stage_pos_id,
+                             static_cast<uint32_t>(seq_len), stage_tokens_total,
+                             norm_out, stride_elems, stage_token_index,
+                             activations_.norm_out.size(), hip_stream);
+        post_wo_trace_tensor(opts_.trace, "lm_head_in", stage_phase,
+                             stage_prompt_id, final_layer,
+                             static_cast<uint32_t>(trace_step_), stage_pos_id,
+                             static_cast<uint32_t>(seq_len), stage_tokens_total,
+                             norm_out, stride_elems, stage_token_index,
+                             activations_.norm_out.size(), hip_stream);
       }
     }
 
-    size_t logits_offset_bytes =
-        static_cast<size_t>(seq_start) * static_cast<size_t>(V) * sizeof(float);
-    size_t logits_bytes =
-        static_cast<size_t>(S) * static_cast<size_t>(V) * sizeof(float);
-    if (logits_offset_bytes + logits_bytes > logits_.size()) {
-      if (err) {
-        *err = "LM Head logits offset out of range: offset=" +
-               std::to_string(logits_offset_bytes) +
-               " bytes=" + std::to_string(logits_bytes) +
-               " alloc=" + std::to_string(logits_.size());
+    if (skip_lm_head_) {
+      // Intermediate prefill chunk: only the KV cache it wrote matters.
+      last_logits_rows_ = 0;
+    } else {
+      // LM head: project only the trailing rows that are sampled. Logits row 0
+      // maps to position seq_start + S - logits_rows.
+      const uint32_t logits_rows =
+          static_cast<uint32_t>(std::min<size_t>(logits_rows_, seq_len));
+      size_t logits_bytes = static_cast<size_t>(logits_rows) *
+                            static_cast<size_t>(V) * sizeof(float);
+      if (logits_bytes > logits_.size()) {
+        if (err) {
+          *err = "LM Head logits out of range: rows=" +
+                 std::to_string(logits_rows) +
+                 " bytes=" + std::to_string(logits_bytes) +
+                 " alloc=" + std::to_string(logits_.size());
+        }
+        return false;
       }
-      return false;
+      const size_t lm_head_in_offset_bytes =
+          static_cast<size_t>(S - logits_rows) * static_cast<size_t>(D) *
+          sizeof(float);
+      GretaMemoryView lm_head_in(&activations_.norm_out,
+                                 lm_head_in_offset_bytes);
+      const bool is_decode = (seq_len == 1 && seq_start > 0);
+      const char *lm_head_label =
+          is_decode ? "lm_head_decode" : "lm_head_prefill";
+      OpSpan lm_head_span(hip_stream, opts_.profile_sync, "op", "lm_head");
+      gcore::compute::GretaCompute::set_op_label(lm_head_label);
+      CHECK_GRETA(gcore::compute::GretaCompute::gemm(stream_, &lm_head_in,
+                                                     &output_weight_, &logits_,
+                                                     logits_rows, V, D),
+                  "LM Head");
+      last_logits_rows_ = logits_rows;
+      gcore::compute::GretaCompute::set_op_label(nullptr);
     }
-    GretaMemoryView logits_view(&logits_, logits_offset_bytes);
-    const bool is_decode = (seq_len == 1 && seq_start > 0);
-    const char *lm_head_label =
-        is_decode ? "lm_head_decode" : "lm_head_prefill";
-    gcore::compute::GretaCompute::set_op_label(lm_head_label);
-    CHECK_GRETA(gcore::compute::GretaCompute::gemm(
-                    stream_, &activations_.norm_out, &output_weight_,
-                    &logits_view, S, V, D),
-                "LM Head");
-    gcore::compute::GretaCompute::set_op_label(nullptr);
 
     if (use_graph && !graph_captured_) {
       graph_->capture_end(stream_);
       CHECK_GRETA(graph_->instantiate(), "Graph Instantiate");
       graph_captured_ = true;
+      // Replays run at other positions: keep the step's cost without its
+      // attention, which launch_span re-adds for the replay position.
+      const gcore::rt::OpCost attn = decode_attention_cost(seq_start);
+      graph_step_cost_ = step_cost.cost();
+      graph_step_cost_.flops -= std::min(graph_step_cost_.flops, attn.flops);
+      graph_step_cost_.bytes -= std::min(graph_step_cost_.bytes, attn.bytes);
     }
   }
 
@@ -4315,6 +4407,441 @@ bool BlockScheduler::forward(const int32_t *tokens, size_t seq_start,
   return true;
 }
 
+bool BlockScheduler::prefill(const int32_t *tokens, size_t n_tokens,
+                             std::string *err, size_t slot) {
+  if (n_tokens == 0) {
+    if (err)
+      *err = "Prefill has no tokens";
+    return false;
+  }
+  const size_t chunk = activation_tokens_ > 0 ? activation_tokens_ : n_tokens;
+  size_t pos = 0;
+  while (pos < n_tokens) {
+    const size_t len = std::min(chunk, n_tokens - pos);
+    const bool last = (pos + len == n_tokens);
+    skip_lm_head_ = !last;
+    const bool ok = forward(tokens + pos, pos, len, err, slot);
+    skip_lm_head_ = false;
+    if (!ok)
+      return false;
+    pos += len;
+  }
+  return true;
+}
+
+bool BlockScheduler::execute_layer_batched(size_t layer_idx, size_t batch,
+                                           std::string *err) {
+  using namespace gcore::rt::hip::kernels;
+  auto &b = blocks_[layer_idx];
+  const uint32_t B = static_cast<uint32_t>(batch);
+  const uint32_t D = static_cast<uint32_t>(config_.dim);
+  const uint32_t Hq = static_cast<uint32_t>(config_.num_heads);
+  const uint32_t Hkv = static_cast<uint32_t>(
+      config_.num_heads_kv > 0 ? config_.num_heads_kv : config_.num_heads);
+  const uint32_t Dh = D / Hq;
+  const uint32_t kv_dim = Hkv * Dh;
+  const uint32_t hidden_dim = static_cast<uint32_t>(config_.hidden_dim);
+  const uint32_t max_seq = static_cast<uint32_t>(config_.max_seq_len);
+
+  float *x = static_cast<float *>(activations_.x.data());
+  float *norm_out = static_cast<float *>(activations_.norm_out.data());
+  float *q = static_cast<float *>(activations_.q.data());
+  float *k = static_cast<float *>(activations_.k.data());
+  float *v = static_cast<float *>(activations_.v.data());
+  float *attn_out = static_cast<float *>(activations_.attn_out.data());
+  float *mlp_gate = static_cast<float *>(activations_.mlp_gate.data());
+  float *mlp_up = static_cast<float *>(activations_.mlp_up.data());
+  float *mlp_out = static_cast<float *>(activations_.mlp_out.data());
+  const uint32_t *d_positions =
+      static_cast<const uint32_t *>(activations_.batch_pos.data());
+  const uint32_t *d_slots =
+      static_cast<const uint32_t *>(activations_.batch_slot.data());
+
+  const size_t layer_offset =
+      static_cast<size_t>(layer_idx) * max_seq * kv_dim;
+  const size_t slot_stride = config_.num_layers * max_seq * kv_dim;
+  float *cache_k =
+      static_cast<float *>(activations_.kv_cache_k.data()) + layer_offset;
+  float *cache_v =
+      static_cast<float *>(activations_.kv_cache_v.data()) + layer_offset;
+
+  hipStream_t hip_stream =
+      static_cast<gcore::rt::hip::GretaStreamHip *>(stream_)->handle();
+  using gcore::compute::GretaCompute;
+
+  // No per-op spans here: the GEMMs and these kernels are charged to the
+  // caller's block span. Attention depends on the host positions, so
+  // decode_batch() adds it to that span.
+  using gcore::rt::elementwise_cost;
+  gcore::rt::ProfileSpan::charge(
+      gcore::rt::rmsnorm_cost(B, D) + gcore::rt::rmsnorm_cost(B, D) +
+      gcore::rt::rope_cost(B, Hq, Dh) + gcore::rt::rope_cost(B, Hkv, Dh) +
+      elementwise_cost(2 * B * kv_dim, 1, 0) +
+      elementwise_cost(B * D, 2, 1) + elementwise_cost(B * D, 2, 1) +
+      elementwise_cost(B * hidden_dim, 1, 4) +
+      elementwise_cost(B * hidden_dim, 2, 1));
+
+  CHECK_HIP_KERNEL(
+      launch_rmsnorm_naive(hip_stream, x,
+                           static_cast<const float *>(b.attn_norm.data()),
+                           norm_out, B, D, config_.rms_eps),
+      "RMSNorm (Attn)");
+  CHECK_GRETA(GretaCompute::gemm(stream_, &activations_.norm_out, &b.wq,
+                                 &activations_.q, B, D, D),
+              "GEMM Q");
+  CHECK_GRETA(GretaCompute::gemm(stream_, &activations_.norm_out, &b.wk,
+                                 &activations_.k, B, kv_dim, D),
+              "GEMM K");
+  CHECK_GRETA(GretaCompute::gemm(stream_, &activations_.norm_out, &b.wv,
+                                 &activations_.v, B, kv_dim, D),
+              "GEMM V");
+
+  CHECK_HIP_KERNEL(launch_rope_rows(hip_stream, q, B, Hq, Dh,
+                                    config_.rope_base, d_positions),
+                   "RoPE Q (Batched)");
+  CHECK_HIP_KERNEL(launch_rope_rows(hip_stream, k, B, Hkv, Dh,
+                                    config_.rope_base, d_positions),
+                   "RoPE K (Batched)");
+  CHECK_HIP_KERNEL(launch_kv_update_batched(hip_stream, cache_k, cache_v, k, v,
+                                            d_positions, d_slots, B,
+                                            slot_stride, max_seq, Hkv, Dh),
+                   "KV Update (Batched)");
+
+  const float scale = 1.0f / sqrtf(static_cast<float>(Dh));
+  const int accum_mode = (opts_.attn_accum == AttnAccumMode::Fp16) ? 1 : 0;
+  CHECK_HIP_KERNEL(launch_flash_attention_decode_batched(
+                       hip_stream, q, cache_k, cache_v, attn_out, B,
+                       d_positions, d_slots, slot_stride, Hq, Hkv, max_seq, Dh,
+                       scale, accum_mode),
+                   "Attention Core (Batched Decode)");
+
+  CHECK_GRETA(GretaCompute::gemm(stream_, &activations_.attn_out, &b.wo,
+                                 &activations_.mlp_out, B, D, D),
+              "GEMM O");
+  CHECK_HIP_KERNEL(launch_add(hip_stream, x, mlp_out, x, B * D),
+                   "Residual (Attn)");
+
+  CHECK_HIP_KERNEL(
+      launch_rmsnorm_naive(hip_stream, x,
+                           static_cast<const float *>(b.ffn_norm.data()),
+                           norm_out, B, D, config_.rms_eps),
+      "RMSNorm (FFN)");
+  CHECK_GRETA(GretaCompute::gemm(stream_, &activations_.norm_out, &b.w1,
+                                 &activations_.mlp_gate, B, hidden_dim, D),
+              "GEMM W1");
+  CHECK_GRETA(GretaCompute::gemm(stream_, &activations_.norm_out, &b.w3,
+                                 &activations_.mlp_up, B, hidden_dim, D),
+              "GEMM W3");
+  CHECK_HIP_KERNEL(
+      launch_silu(hip_stream, mlp_gate, mlp_gate, B * hidden_dim), "SiLU");
+  CHECK_HIP_KERNEL(
+      launch_mul(hip_stream, mlp_gate, mlp_up, mlp_gate, B * hidden_dim),
+      "Mul");
+  CHECK_GRETA(GretaCompute::gemm(stream_, &activations_.mlp_gate, &b.w2,
+                                 &activations_.mlp_out, B, D, hidden_dim),
+              "GEMM W2");
+  CHECK_HIP_KERNEL(launch_add(hip_stream, x, mlp_out, x, B * D),
+                   "Residual (FFN)");
+  return true;
+}
+
+bool BlockScheduler::decode_batch(const int32_t *tokens,
+                                  const uint32_t *positions,
+                                  const uint32_t *slots, size_t batch,
+                                  std::string *err) {
+  using namespace gcore::rt::hip::kernels;
+  const size_t max_batch = std::min(kv_slots_, activation_tokens_);
+  if (batch == 0 || batch > max_batch) {
+    if (err)
+      *err = "decode_batch: batch=" + std::to_string(batch) +
+             " outside [1, " + std::to_string(max_batch) + "]";
+    return false;
+  }
+  // Two rows on one slot would write the same KV rows and read each other's
+  // half-updated cache.
+  std::vector<bool> slot_used(kv_slots_, false);
+  for (size_t i = 0; i < batch; ++i) {
+    if (positions[i] >= config_.max_seq_len || slots[i] >= kv_slots_) {
+      if (err) {
+        std::ostringstream oss;
+        oss << "decode_batch: row " << i << " pos=" << positions[i]
+            << " slot=" << slots[i] << " exceeds max_seq_len="
+            << config_.max_seq_len << " slots=" << kv_slots_;
+        *err = oss.str();
+      }
+      return false;
+    }
+    if (slot_used[slots[i]]) {
+      if (err)
+        *err = "decode_batch: row " + std::to_string(i) + " reuses slot " +
+               std::to_string(slots[i]);
+      return false;
+    }
+    slot_used[slots[i]] = true;
+  }
+
+  const uint32_t B = static_cast<uint32_t>(batch);
+  const uint32_t D = static_cast<uint32_t>(config_.dim);
+  const uint32_t V = static_cast<uint32_t>(config_.vocab_size);
+  if (static_cast<size_t>(B) * V * sizeof(float) > logits_.size()) {
+    if (err)
+      *err = "decode_batch: logits buffer too small for batch=" +
+             std::to_string(batch);
+    return false;
+  }
+
+  if (!activations_.tokens.copy_to_device(tokens, B * sizeof(int32_t), err) ||
+      !activations_.batch_pos.copy_to_device(positions, B * sizeof(uint32_t),
+                                             err) ||
+      !activations_.batch_slot.copy_to_device(slots, B * sizeof(uint32_t),
+                                              err))
+    return false;
+
+  hipStream_t hip_stream =
+      static_cast<gcore::rt::hip::GretaStreamHip *>(stream_)->handle();
+  // Cost-free like forward()'s span: its time covers the block spans, so
+  // the work is charged to the inner spans only.
+  OpSpan forward_span(hip_stream, opts_.profile_sync, "decode",
+                      "decode_batch", "batch", static_cast<int64_t>(batch));
+  float *x = static_cast<float *>(activations_.x.data());
+  OpSpan embed_span(hip_stream, opts_.profile_sync, "op", "embedding");
+  embed_span.add_cost(gcore::rt::elementwise_cost(B * D, 1, 0));
+  CHECK_HIP_KERNEL(
+      launch_embedding_lookup(
+          hip_stream, static_cast<const int32_t *>(activations_.tokens.data()),
+          static_cast<const float *>(token_embd_.data()), x, B, D,
+          config_.vocab_size, opts_.embed_row_major),
+      "Embedding Lookup");
+  embed_span.end();
+
+  const uint32_t Hkv = static_cast<uint32_t>(
+      config_.num_heads_kv > 0 ? config_.num_heads_kv : config_.num_heads);
+  gcore::rt::OpCost attn_cost; // Per layer, each row at its own position
+  for (size_t i = 0; i < batch; ++i)
+    attn_cost += gcore::rt::attention_cost(1, positions[i], config_.num_heads,
+                                           Hkv, D / config_.num_heads);
+  for (size_t i = 0; i < config_.num_layers; ++i) {
+    OpSpan block_span(hip_stream, opts_.profile_sync, "layer", "block", "layer",
+                      static_cast<int64_t>(i));
+    block_span.add_cost(attn_cost);
+    if (!execute_layer_batched(i, batch, err))
+      return false;
+  }
+
+  OpSpan final_norm_span(hip_stream, opts_.profile_sync, "op", "final_rmsnorm");
+  final_norm_span.add_cost(gcore::rt::rmsnorm_cost(B, D));
+  CHECK_HIP_KERNEL(
+      launch_rmsnorm_naive(hip_stream, x,
+                           static_cast<const float *>(output_norm_.data()),
+                           static_cast<float *>(activations_.norm_out.data()),
+                           B, D, config_.rms_eps),
+      "Final RMSNorm");
+  final_norm_span.end();
+
+  OpSpan lm_head_span(hip_stream, opts_.profile_sync, "op", "lm_head");
+  gcore::compute::GretaCompute::set_op_label("lm_head_decode");
+  CHECK_GRETA(gcore::compute::GretaCompute::gemm(stream_,
+                                                 &activations_.norm_out,
+                                                 &output_weight_, &logits_, B,
+                                                 V, D),
+              "LM Head");
+  gcore::compute::GretaCompute::set_op_label(nullptr);
+  lm_head_span.end();
+  last_logits_rows_ = B;
+
+  stream_->synchronize();
+  return true;
+}
+
+namespace {
+
+/// Double-buffered pinned staging for per-layer session streaming. Each
+/// buffer holds one layer's K followed by V; done[i] marks the last copy
+/// that used buffer i.
+struct SessionStaging {
+  float *host[2] = {nullptr, nullptr};
+  hipEvent_t done[2] = {nullptr, nullptr};
+
+  ~SessionStaging() {
+    for (int i = 0; i < 2; ++i) {
+      if (done[i]) {
+        hipEventSynchronize(done[i]); // No copy may still read host[i]
+        hipEventDestroy(done[i]);
+      }
+      if (host[i])
+        hipHostFree(host[i]);
+    }
+  }
+
+  bool init(size_t bytes_each, std::string *err) {
+    for (int i = 0; i < 2; ++i) {
+      if (hipHostMalloc(reinterpret_cast<void **>(&host[i]), bytes_each,
+                        hipHostMallocDefault) != hipSuccess ||
+          hipEventCreateWithFlags(&done[i], hipEventDisableTiming) !=
+              hipSuccess) {
+        if (err)
+          *err = "Session staging allocation failed (" +
+                 std::to_string(bytes_each) + " bytes)";
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+} // namespace
+
+bool BlockScheduler::save_session(const std::string &path,
+                                  const std::vector<int32_t> &tokens,
+                                  size_t slot, KvSessionCodec codec,
+                                  std::string *err) {
+  const size_t n = tokens.size();
+  if (slot >= kv_slots_ || n == 0 || n > config_.max_seq_len) {
+    if (err)
+      *err = "save_session: slot=" + std::to_string(slot) +
+             " tokens=" + std::to_string(n) + " out of range";
+    return false;
+  }
+  const size_t L = config_.num_layers;
+  const size_t Hkv =
+      config_.num_heads_kv > 0 ? config_.num_heads_kv : config_.num_heads;
+  const size_t Dh = config_.dim / config_.num_heads;
+  const size_t max_seq = config_.max_seq_len;
+  const size_t layer_elems = Hkv * n * Dh;
+  const size_t slot_stride = L * max_seq * Hkv * Dh;
+
+  KvSessionHeader header;
+  header.codec = static_cast<uint32_t>(codec);
+  header.num_layers = static_cast<uint32_t>(L);
+  header.num_heads_kv = static_cast<uint32_t>(Hkv);
+  header.head_dim = static_cast<uint32_t>(Dh);
+  header.n_tokens = static_cast<uint32_t>(n);
+
+  KvSessionWriter writer;
+  SessionStaging staging;
+  if (!writer.open(path, header, tokens.data(), err) ||
+      !staging.init(2 * layer_elems * sizeof(float), err))
+    return false;
+
+  hipStream_t hip_stream =
+      static_cast<gcore::rt::hip::GretaStreamHip *>(stream_)->handle();
+  const float *base_k =
+      static_cast<const float *>(activations_.kv_cache_k.data()) +
+      slot * slot_stride;
+  const float *base_v =
+      static_cast<const float *>(activations_.kv_cache_v.data()) +
+      slot * slot_stride;
+  const size_t row_bytes = n * Dh * sizeof(float);
+  const size_t src_pitch = max_seq * Dh * sizeof(float);
+
+  // Layer i is copied off the device while layer i-1 is written to disk.
+  for (size_t i = 0; i <= L; ++i) {
+    if (i < L) {
+      float *dst = staging.host[i % 2];
+      const size_t layer_off = i * max_seq * Hkv * Dh;
+      if (hipMemcpy2DAsync(dst, row_bytes, base_k + layer_off, src_pitch,
+                           row_bytes, Hkv, hipMemcpyDeviceToHost,
+                           hip_stream) != hipSuccess ||
+          hipMemcpy2DAsync(dst + layer_elems, row_bytes, base_v + layer_off,
+                           src_pitch, row_bytes, Hkv, hipMemcpyDeviceToHost,
+                           hip_stream) != hipSuccess ||
+          hipEventRecord(staging.done[i % 2], hip_stream) != hipSuccess) {
+        if (err)
+          *err = "save_session: KV copy failed at layer " + std::to_string(i);
+        return false;
+      }
+    }
+    if (i > 0) {
+      const size_t prev = (i - 1) % 2;
+      if (hipEventSynchronize(staging.done[prev]) != hipSuccess) {
+        if (err)
+          *err = "save_session: KV copy failed at layer " +
+                 std::to_string(i - 1);
+        return false;
+      }
+      if (!writer.write_layer(staging.host[prev],
+                              staging.host[prev] + layer_elems, err))
+        return false;
+    }
+  }
+  return writer.finish(err);
+}
+
+bool BlockScheduler::load_session(const std::string &path, size_t slot,
+                                  std::vector<int32_t> *tokens,
+                                  std::string *err) {
+  KvSessionFile file;
+  if (!file.open(path, err))
+    return false;
+  const KvSessionHeader &h = file.header();
+  const size_t L = config_.num_layers;
+  const size_t Hkv =
+      config_.num_heads_kv > 0 ? config_.num_heads_kv : config_.num_heads;
+  const size_t Dh = config_.dim / config_.num_heads;
+  const size_t max_seq = config_.max_seq_len;
+  const size_t n = h.n_tokens;
+  if (h.num_layers != L || h.num_heads_kv != Hkv || h.head_dim != Dh) {
+    if (err)
+      *err = "load_session: " + path + " was saved for a different model";
+    return false;
+  }
+  if (slot >= kv_slots_ || n == 0 || n > max_seq) {
+    if (err)
+      *err = "load_session: slot=" + std::to_string(slot) +
+             " tokens=" + std::to_string(n) + " out of range";
+    return false;
+  }
+
+  const size_t layer_elems = file.layer_elems();
+  const size_t slot_stride = L * max_seq * Hkv * Dh;
+  SessionStaging staging;
+  if (!staging.init(2 * layer_elems * sizeof(float), err))
+    return false;
+
+  hipStream_t hip_stream =
+      static_cast<gcore::rt::hip::GretaStreamHip *>(stream_)->handle();
+  float *base_k =
+      static_cast<float *>(activations_.kv_cache_k.data()) + slot * slot_stride;
+  float *base_v =
+      static_cast<float *>(activations_.kv_cache_v.data()) + slot * slot_stride;
+  const size_t row_bytes = n * Dh * sizeof(float);
+  const size_t dst_pitch = max_seq * Dh * sizeof(float);
+
+  // Reading layer i from the mapping (page faults, F16 decode) overlaps the
+  // async upload of layer i-1; a staging buffer is reused only after the
+  // upload that last read it has finished.
+  file.prefetch(0);
+  for (size_t i = 0; i < L; ++i) {
+    const size_t buf = i % 2;
+    if (i >= 2 && hipEventSynchronize(staging.done[buf]) != hipSuccess) {
+      if (err)
+        *err = "load_session: KV upload failed at layer " +
+               std::to_string(i - 2);
+      return false;
+    }
+    file.prefetch(i + 1);
+    float *src = staging.host[buf];
+    file.read_layer(i, src, src + layer_elems);
+    const size_t layer_off = i * max_seq * Hkv * Dh;
+    if (hipMemcpy2DAsync(base_k + layer_off, dst_pitch, src, row_bytes,
+                         row_bytes, Hkv, hipMemcpyHostToDevice,
+                         hip_stream) != hipSuccess ||
+        hipMemcpy2DAsync(base_v + layer_off, dst_pitch, src + layer_elems,
+                         row_bytes, row_bytes, Hkv, hipMemcpyHostToDevice,
+                         hip_stream) != hipSuccess ||
+        hipEventRecord(staging.done[buf], hip_stream) != hipSuccess) {
+      if (err)
+        *err = "load_session: KV upload failed at layer " + std::to_string(i);
+      return false;
+    }
+  }
+  stream_->synchronize();
+
+  if (tokens)
+    tokens->assign(file.tokens(), file.tokens() + n);
+  return true;
+}
+
 gcore::rt::hip::Buffer &BlockScheduler::get_hidden_state() {
   return activations_.x;
 }
@@ -4331,6 +4858,28 @@ const gcore::rt::hip::Buffer &BlockScheduler::get_logits() const {
   return logits_;
 }
 
+size_t BlockScheduler::last_logits_offset() const {
+  return logits_offset(last_logits_rows_ > 0 ? last_logits_rows_ - 1 : 0);
+}
+
+gcore::rt::OpCost BlockScheduler::decode_attention_cost(size_t pos) const {
+  const size_t Hkv =
+      config_.num_heads_kv > 0 ? config_.num_heads_kv : config_.num_heads;
+  const gcore::rt::OpCost per_layer = gcore::rt::attention_cost(
+      1, pos, config_.num_heads, Hkv, config_.dim / config_.num_heads);
+  gcore::rt::OpCost c;
+  c.flops = per_layer.flops * config_.num_layers;
+  c.bytes = per_layer.bytes * config_.num_layers;
+  return c;
+}
+
+size_t BlockScheduler::kv_slot_offset() const {
+  const size_t Hkv =
+      config_.num_heads_kv > 0 ? config_.num_heads_kv : config_.num_heads;
+  return kv_slot_ * config_.num_layers * config_.max_seq_len * Hkv *
+         (config_.dim / config_.num_heads);
+}
+
 const gcore::rt::hip::Buffer &BlockScheduler::get_output_weight() const {
   return output_weight_;
 }
@@ -4343,6 +4892,7 @@ int32_t BlockScheduler::sample_greedy_gpu(size_t logits_offset_bytes,
       static_cast<gcore::rt::hip::GretaStreamHip *>(stream_)->handle();
   const float *logits_base = static_cast<const float *>(logits_.data());
   const size_t offset_elems = logits_offset_bytes / sizeof(float);
+  OpSpan span(hip_stream, opts_.profile_sync, "sampler", "argmax_gpu");
   rt::hip::kernels::launch_argmax(hip_stream, logits_base + offset_elems,
                                   config_.vocab_size, &top_id);
   return top_id;
@@ -0,0 +1,744 @@
+#include "gcore/inference/drift_monitor.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace gcore::inference {
+
+namespace {
+
+constexpr size_t kPoints = static_cast<size_t>(DriftPoint::Count);
+constexpr size_t kAlignFloats = 16; // 64-byte aligned snapshots
+
+size_t align_up(size_t n) {
+  return (n + kAlignFloats - 1) & ~(kAlignFloats - 1);
+}
+
+float half_to_float(uint16_t h) {
+  const uint32_t sign = static_cast<uint32_t>(h >> 15) << 31;
+  uint32_t exp = (h >> 10) & 0x1f;
+  uint32_t mant = h & 0x3ff;
+  uint32_t bits;
+  if (exp == 0) {
+    if (mant == 0) {
+      bits = sign;
+    } else { // Subnormal: normalize
+      exp = 127 - 14;
+      while ((mant & 0x400) == 0) {
+        mant <<= 1;
+        --exp;
+      }
+      bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+  } else if (exp == 31) {
+    bits = sign | 0x7f800000u | (mant << 13);
+  } else {
+    bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+  }
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+bool ends_with(const std::string &s, const char *suffix) {
+  const size_t n = std::strlen(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// --- Reference ops (double accumulation) ---
+
+void rmsnorm_ref(const float *x, const float *w, size_t n, float eps,
+                 float *y) {
+  double ss = 0.0;
+  for (size_t i = 0; i < n; ++i)
+    ss += static_cast<double>(x[i]) * x[i];
+  const double inv = 1.0 / std::sqrt(ss / static_cast<double>(n) + eps);
+  for (size_t i = 0; i < n; ++i)
+    y[i] = static_cast<float>(x[i] * inv * w[i]);
+}
+
+// Rotates (i, i + head_dim / 2) pairs of every head, like launch_rope.
+void rope_ref(const float *x, uint32_t heads, uint32_t head_dim, uint32_t pos,
+              float base, float *y) {
+  const uint32_t half = head_dim / 2;
+  for (uint32_t h = 0; h < heads; ++h) {
+    const float *xh = x + static_cast<size_t>(h) * head_dim;
+    float *yh = y + static_cast<size_t>(h) * head_dim;
+    for (uint32_t i = 0; i < half; ++i) {
+      const double theta =
+          pos * std::pow(static_cast<double>(base), -2.0 * i / head_dim);
+      const double c = std::cos(theta), s = std::sin(theta);
+      yh[i] = static_cast<float>(xh[i] * c - xh[i + half] * s);
+      yh[i + half] = static_cast<float>(xh[i] * s + xh[i + half] * c);
+    }
+    if (head_dim % 2)
+      yh[head_dim - 1] = xh[head_dim - 1];
+  }
+}
+
+// One query row over `rows` cached positions; K/V are
+// [kv_heads, rows, head_dim] and query heads share KV heads in groups.
+void attention_ref(const float *q, const float *kc, const float *vc,
+                   const DriftShape &s, uint32_t rows, float *out) {
+  const uint32_t group = s.heads / std::max<uint32_t>(1, s.kv_heads);
+  const double scale = 1.0 / std::sqrt(static_cast<double>(s.head_dim));
+  std::vector<double> p(rows);
+  for (uint32_t h = 0; h < s.heads; ++h) {
+    const uint32_t kvh = std::min(h / std::max<uint32_t>(1, group),
+                                  s.kv_heads - 1);
+    const float *qh = q + static_cast<size_t>(h) * s.head_dim;
+    const float *kh = kc + static_cast<size_t>(kvh) * rows * s.head_dim;
+    const float *vh = vc + static_cast<size_t>(kvh) * rows * s.head_dim;
+    double maxv = -INFINITY;
+    for (uint32_t r = 0; r < rows; ++r) {
+      double dot = 0.0;
+      for (uint32_t d = 0; d < s.head_dim; ++d)
+        dot += static_cast<double>(qh[d]) * kh[r * s.head_dim + d];
+      p[r] = dot * scale;
+      maxv = std::max(maxv, p[r]);
+    }
+    double sum = 0.0;
+    for (uint32_t r = 0; r < rows; ++r) {
+      p[r] = std::exp(p[r] - maxv);
+      sum += p[r];
+    }
+    for (uint32_t d = 0; d < s.head_dim; ++d) {
+      double acc = 0.0;
+      for (uint32_t r = 0; r < rows; ++r)
+        acc += p[r] * vh[r * s.head_dim + d];
+      out[static_cast<size_t>(h) * s.head_dim + d] =
+          static_cast<float>(acc / sum);
+    }
+  }
+}
+
+void silu_mul_ref(const float *g, const float *u, size_t n, float *y) {
+  for (size_t i = 0; i < n; ++i) {
+    const double gd = g[i];
+    y[i] = static_cast<float>(gd / (1.0 + std::exp(-gd)) * u[i]);
+  }
+}
+
+void add_ref(const float *a, const float *b, size_t n, float *y) {
+  for (size_t i = 0; i < n; ++i)
+    y[i] = static_cast<float>(static_cast<double>(a[i]) + b[i]);
+}
+
+// JSON has no infinity.
+void json_num(std::ostringstream &os, double v) {
+  if (!std::isfinite(v)) {
+    os << "null";
+    return;
+  }
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.4e", v);
+  os << buf;
+}
+
+} // namespace
+
+/// Snapshot buffer of one sampled layer.
+class DriftFrame {
+public:
+  DriftShape shape;
+  size_t layer = 0;
+  uint64_t step = 0;
+  uint32_t pos = 0;
+
+  float *buf = nullptr; // Pinned
+  size_t cap = 0;       // Floats
+  size_t used = 0;
+  std::array<size_t, kPoints> off{};
+  std::array<size_t, kPoints> len{};
+  void *event = nullptr;
+  bool failed = false;
+
+  const float *get(DriftPoint p) const {
+    const size_t i = static_cast<size_t>(p);
+    return len[i] ? buf + off[i] : nullptr;
+  }
+  // Room for `n` floats at point `p`, or null when full.
+  float *reserve(DriftPoint p, size_t n) {
+    const size_t at = align_up(used);
+    if (at + n > cap)
+      return nullptr;
+    off[static_cast<size_t>(p)] = at;
+    len[static_cast<size_t>(p)] = n;
+    used = at + n;
+    return buf + at;
+  }
+};
+
+// --- DriftWeight ---
+
+float DriftWeight::at(size_t row, size_t col) const {
+  const size_t idx = row * k + col;
+  float v = 0.0f;
+  switch (type) {
+  case DriftDType::F32:
+    std::memcpy(&v, raw.data() + idx * 4, 4);
+    return v;
+  case DriftDType::F16: {
+    uint16_t h;
+    std::memcpy(&h, raw.data() + idx * 2, 2);
+    return half_to_float(h);
+  }
+  case DriftDType::INT8:
+    v = static_cast<float>(static_cast<int8_t>(raw[idx]));
+    break;
+  case DriftDType::INT4: {
+    const uint8_t packed = raw[idx / 2];
+    int8_t q = static_cast<int8_t>((idx % 2 == 0) ? (packed & 0x0f)
+                                                  : (packed >> 4));
+    if (q & 0x08)
+      q = static_cast<int8_t>(q | 0xf0);
+    v = static_cast<float>(q);
+    break;
+  }
+  }
+  if (group_size > 0 && !scales.empty())
+    v *= scales[std::min(idx / group_size, scales.size() - 1)];
+  return v;
+}
+
+void DriftWeight::apply(const float *x, float *y) const {
+  for (uint32_t r = 0; r < n; ++r) {
+    double acc = 0.0;
+    for (uint32_t c = 0; c < k; ++c)
+      acc += static_cast<double>(x[c]) * at(r, c);
+    if (head_dim > 0 && !head_scales.empty())
+      acc *= head_scales[std::min<size_t>(r / head_dim,
+                                          head_scales.size() - 1)];
+    y[r] = static_cast<float>(acc);
+  }
+}
+
+// --- Histograms and report ---
+
+int DriftHistogram::bucket(double v) {
+  if (!std::isfinite(v))
+    return kBuckets - 1;
+  if (v < 1e-10)
+    return 0;
+  const int b = static_cast<int>(std::floor(std::log10(v))) + 11;
+  return std::clamp(b, 1, kBuckets - 1);
+}
+
+void DriftHistogram::add(double v) { counts[bucket(v)] += 1; }
+
+const char *DriftHistogram::label(int bucket) {
+  static const char *const kLabels[kBuckets] = {
+      "<1e-10", "1e-10", "1e-9", "1e-8", "1e-7", "1e-6", "1e-5",
+      "1e-4",   "1e-3",  "1e-2", "1e-1", "1",    ">=10"};
+  return (bucket >= 0 && bucket < kBuckets) ? kLabels[bucket] : "?";
+}
+
+void drift_error(const float *ref, const float *got, size_t n,
+                 double *max_abs, double *rel) {
+  double mx = 0.0, diff2 = 0.0, ref2 = 0.0;
+  bool nonfinite = false;
+  for (size_t i = 0; i < n; ++i) {
+    if (!std::isfinite(got[i]) && std::isfinite(ref[i])) {
+      nonfinite = true;
+      continue;
+    }
+    const double d = std::fabs(static_cast<double>(got[i]) - ref[i]);
+    mx = std::max(mx, d);
+    diff2 += d * d;
+    ref2 += static_cast<double>(ref[i]) * ref[i];
+  }
+  if (nonfinite) {
+    *max_abs = INFINITY;
+    *rel = INFINITY;
+    return;
+  }
+  *max_abs = mx;
+  *rel = ref2 > 0.0 ? std::sqrt(diff2 / ref2) : (diff2 > 0.0 ? INFINITY : 0.0);
+}
+
+uint64_t DriftReport::violations() const {
+  uint64_t v = 0;
+  for (const auto &op : ops)
+    v += op.violations;
+  return v;
+}
+
+std::string DriftReport::to_text() const {
+  std::ostringstream os;
+  char buf[160];
+  std::snprintf(buf, sizeof(buf),
+                "Numerical drift vs CPU reference (flag rel > %.1e): %llu "
+                "frames checked, %llu skipped, %llu errors, %llu "
+                "violations\n\n",
+                threshold, static_cast<unsigned long long>(frames_checked),
+                static_cast<unsigned long long>(frames_skipped),
+                static_cast<unsigned long long>(errors),
+                static_cast<unsigned long long>(violations()));
+  os << buf;
+  std::snprintf(buf, sizeof(buf), "%-16s %8s %11s %11s %12s %6s\n", "op",
+                "checks", "max_abs", "max_rel", "layer@step", "viol");
+  os << buf;
+  for (const auto &op : ops) {
+    std::snprintf(buf, sizeof(buf),
+                  "%-16s %8llu %11.3e %11.3e %5lld@%-6llu %6llu\n",
+                  op.op.c_str(), static_cast<unsigned long long>(op.checks),
+                  op.max_abs, op.max_rel,
+                  static_cast<long long>(op.worst_layer),
+                  static_cast<unsigned long long>(op.worst_step),
+                  static_cast<unsigned long long>(op.violations));
+    os << buf;
+  }
+  os << "\nRelative error histogram (checks per decade)\n";
+  std::snprintf(buf, sizeof(buf), "%-16s", "op");
+  os << buf;
+  for (int b = 0; b < DriftHistogram::kBuckets; ++b) {
+    std::snprintf(buf, sizeof(buf), " %6s", DriftHistogram::label(b));
+    os << buf;
+  }
+  os << '\n';
+  for (const auto &op : ops) {
+    std::snprintf(buf, sizeof(buf), "%-16s", op.op.c_str());
+    os << buf;
+    for (uint64_t c : op.rel_hist.counts) {
+      std::snprintf(buf, sizeof(buf), " %6llu",
+                    static_cast<unsigned long long>(c));
+      os << buf;
+    }
+    os << '\n';
+  }
+  return os.str();
+}
+
+std::string DriftReport::to_json() const {
+  std::ostringstream os;
+  os << "{\"threshold\":";
+  json_num(os, threshold);
+  os << ",\"frames_checked\":" << frames_checked
+     << ",\"frames_skipped\":" << frames_skipped << ",\"errors\":" << errors
+     << ",\"violations\":" << violations() << ",\"buckets\":[";
+  for (int b = 0; b < DriftHistogram::kBuckets; ++b)
+    os << (b ? "," : "") << '"' << DriftHistogram::label(b) << '"';
+  os << "],\n\"ops\":[";
+  for (size_t i = 0; i < ops.size(); ++i) {
+    const DriftOpStats &op = ops[i];
+    os << (i ? ",\n" : "\n") << "{\"op\":\"" << op.op
+       << "\",\"checks\":" << op.checks << ",\"violations\":" << op.violations
+       << ",\"max_abs\":";
+    json_num(os, op.max_abs);
+    os << ",\"max_rel\":";
+    json_num(os, op.max_rel);
+    os << ",\"worst_layer\":" << op.worst_layer
+       << ",\"worst_step\":" << op.worst_step;
+    for (const auto *h : {&op.abs_hist, &op.rel_hist}) {
+      os << (h == &op.abs_hist ? ",\"abs_hist\":[" : ",\"rel_hist\":[");
+      for (size_t b = 0; b < h->counts.size(); ++b)
+        os << (b ? "," : "") << h->counts[b];
+      os << ']';
+    }
+    os << '}';
+  }
+  os << "]}\n";
+  return os.str();
+}
+
+bool DriftReport::write(const std::string &path, std::string *err) const {
+  const std::string data = ends_with(path, ".json") ? to_json() : to_text();
+  std::FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    if (err)
+      *err = "open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  const bool wrote = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+  const bool closed = std::fclose(f) == 0;
+  if (!wrote || !closed) {
+    if (err)
+      *err = "write " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+// --- DriftMonitor ---
+
+DriftMonitor::DriftMonitor(gcore::rt::StagingBackend *backend,
+                           const DriftOptions &opt, WeightFetch fetch)
+    : backend_(backend), opt_(opt), fetch_(std::move(fetch)) {
+  const uint32_t n = std::max<uint32_t>(1, opt_.frames);
+  for (uint32_t i = 0; i < n; ++i) {
+    frames_.push_back(std::make_unique<DriftFrame>());
+    free_.push_back(frames_.back().get());
+  }
+  thread_ = std::thread([this] { loop(); });
+}
+
+DriftMonitor::~DriftMonitor() {
+  flush();
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  work_cv_.notify_one();
+  thread_.join();
+  if (!opt_.out.empty()) {
+    std::string err;
+    if (!report().write(opt_.out, &err))
+      std::cerr << "[GRETA_DRIFT] report not written: " << err << "\n";
+  }
+  for (auto &f : frames_) {
+    if (f->event)
+      backend_->destroy_event(f->event);
+    if (f->buf) {
+      backend_->unpin(f->buf);
+      host_.free(f->buf);
+    }
+  }
+}
+
+bool DriftMonitor::sampled(uint64_t step, size_t layer,
+                           size_t num_layers) const {
+  return opt_.enabled && step % std::max<uint32_t>(1, opt_.every) == 0 &&
+         opt_.layers.selected(layer, num_layers);
+}
+
+DriftFrame *DriftMonitor::begin(const DriftShape &shape, size_t layer,
+                                uint64_t step, uint32_t pos) {
+  DriftFrame *f = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (free_.empty()) {
+      ++frames_skipped_;
+      return nullptr;
+    }
+    f = free_.back();
+    free_.pop_back();
+  }
+  const size_t kv = static_cast<size_t>(shape.kv_heads) * shape.head_dim;
+  // Upper bound over all points, each padded for alignment.
+  const size_t need = 10 * static_cast<size_t>(shape.dim) + 3 * kv +
+                      3 * static_cast<size_t>(shape.hidden) +
+                      2 * kv * (static_cast<size_t>(pos) + 1) +
+                      kPoints * kAlignFloats;
+  if (need > f->cap) {
+    if (f->buf) {
+      backend_->unpin(f->buf);
+      host_.free(f->buf);
+      f->buf = nullptr;
+      f->cap = 0;
+    }
+    size_t cap = 1;
+    while (cap < need)
+      cap <<= 1; // Grows with pos: keep re-pinning rare
+    std::string err;
+    auto *p = static_cast<float *>(host_.alloc(cap * sizeof(float), 4096));
+    if (p && !backend_->pin(p, cap * sizeof(float), &err)) {
+      host_.free(p);
+      p = nullptr;
+    }
+    if (!p) {
+      release(f);
+      std::lock_guard<std::mutex> lock(mu_);
+      ++errors_;
+      return nullptr;
+    }
+    f->buf = p;
+    f->cap = cap;
+  }
+  f->shape = shape;
+  f->layer = layer;
+  f->step = step;
+  f->pos = pos;
+  f->used = 0;
+  f->off.fill(0);
+  f->len.fill(0);
+  f->failed = false;
+  return f;
+}
+
+void DriftMonitor::capture(DriftFrame *f, DriftPoint p, const float *src_dev,
+                           size_t n, void *stream) {
+  if (!f || f->failed)
+    return;
+  float *dst = f->reserve(p, n);
+  std::string err;
+  if (!dst || !backend_->copy_async(dst, src_dev, n * sizeof(float),
+                                    gcore::rt::StagingCopyKind::DeviceToHost,
+                                    stream, &err))
+    f->failed = true;
+}
+
+void DriftMonitor::capture_cache(DriftFrame *f, DriftPoint p,
+                                 const float *cache_dev, size_t max_seq,
+                                 void *stream) {
+  if (!f || f->failed)
+    return;
+  const size_t row = static_cast<size_t>(f->pos + 1) * f->shape.head_dim;
+  float *dst = f->reserve(p, row * f->shape.kv_heads);
+  if (!dst) {
+    f->failed = true;
+    return;
+  }
+  std::string err;
+  for (uint32_t h = 0; h < f->shape.kv_heads && !f->failed; ++h) {
+    const float *src = cache_dev + h * max_seq * f->shape.head_dim;
+    if (!backend_->copy_async(dst + h * row, src, row * sizeof(float),
+                              gcore::rt::StagingCopyKind::DeviceToHost,
+                              stream, &err))
+      f->failed = true;
+  }
+}
+
+void DriftMonitor::submit(DriftFrame *f, void *stream) {
+  if (!f)
+    return;
+  std::string err;
+  if (!f->failed && !f->event)
+    f->event = backend_->create_event(&err);
+  if (f->failed || !f->event || !backend_->record(f->event, stream, &err)) {
+    // Copies already queued into the frame must land before it is reused.
+    backend_->sync(stream, &err);
+    release(f);
+    std::lock_guard<std::mutex> lock(mu_);
+    ++errors_;
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    queue_.push_back(f);
+  }
+  work_cv_.notify_one();
+}
+
+void DriftMonitor::abandon(DriftFrame *f, void *stream) {
+  if (!f)
+    return;
+  std::string err;
+  backend_->sync(stream, &err);
+  release(f);
+}
+
+void DriftMonitor::release(DriftFrame *f) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    free_.push_back(f);
+  }
+  idle_cv_.notify_all();
+}
+
+void DriftMonitor::flush() {
+  std::unique_lock<std::mutex> lock(mu_);
+  idle_cv_.wait(lock, [this] { return queue_.empty() && busy_ == 0; });
+}
+
+void DriftMonitor::loop() {
+  for (;;) {
+    DriftFrame *f = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      work_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty())
+        return; // stop_
+      f = queue_.front();
+      queue_.pop_front();
+      ++busy_;
+    }
+    std::string err;
+    const bool ready = backend_->wait(f->event, &err);
+    if (ready)
+      check(*f);
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (ready)
+        ++frames_checked_;
+      else
+        ++errors_;
+      --busy_;
+      free_.push_back(f);
+    }
+    idle_cv_.notify_all();
+  }
+}
+
+const DriftLayerWeights *DriftMonitor::weights(size_t layer) {
+  auto it = weights_.find(layer);
+  if (it != weights_.end())
+    return it->second.get();
+  if (std::find(failed_layers_.begin(), failed_layers_.end(), layer) !=
+      failed_layers_.end())
+    return nullptr;
+  auto w = std::make_unique<DriftLayerWeights>();
+  std::string err;
+  if (!fetch_ || !fetch_(layer, w.get(), &err)) {
+    failed_layers_.push_back(layer);
+    std::cerr << "[GRETA_DRIFT] layer " << layer
+              << " weights unavailable, skipping its projections: " << err
+              << "\n";
+    std::lock_guard<std::mutex> lock(mu_);
+    ++errors_;
+    return nullptr;
+  }
+  return (weights_[layer] = std::move(w)).get();
+}
+
+void DriftMonitor::record(const char *op, const DriftFrame &f,
+                          const float *ref, const float *got, size_t n) {
+  double max_abs = 0.0, rel = 0.0;
+  drift_error(ref, got, n, &max_abs, &rel);
+  const bool violation = !(rel <= opt_.max_rel);
+  bool first_violation = false;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = stats_.find(op);
+    if (it == stats_.end()) {
+      it = stats_.emplace(op, DriftOpStats{}).first;
+      it->second.op = op;
+      op_order_.push_back(op);
+    }
+    DriftOpStats &s = it->second;
+    ++s.checks;
+    s.abs_hist.add(max_abs);
+    s.rel_hist.add(rel);
+    s.max_abs = std::max(s.max_abs, max_abs);
+    if (s.worst_layer < 0 || !(rel <= s.max_rel)) {
+      s.max_rel = rel;
+      s.worst_layer = static_cast<int64_t>(f.layer);
+      s.worst_step = f.step;
+    }
+    if (violation)
+      first_violation = s.violations++ == 0;
+  }
+  if (first_violation)
+    std::cerr << "[GRETA_DRIFT] " << op << " layer=" << f.layer
+              << " step=" << f.step << " pos=" << f.pos << " rel=" << rel
+              << " max_abs=" << max_abs << " exceeds " << opt_.max_rel
+              << " (further violations of this op are only counted)\n";
+}
+
+void DriftMonitor::check(DriftFrame &f) {
+  using P = DriftPoint;
+  const DriftShape &s = f.shape;
+  const size_t D = s.dim, kv = static_cast<size_t>(s.kv_heads) * s.head_dim;
+  const size_t H = s.hidden;
+  const DriftLayerWeights *w = weights(f.layer);
+  std::vector<float> ref(std::max({D, kv, H}) * 3);
+  const float *x_in = f.get(P::XIn), *attn_norm = f.get(P::AttnNorm);
+  const float *q = f.get(P::Q), *k = f.get(P::K), *v = f.get(P::V);
+  const float *q_rope = f.get(P::QRope), *k_rope = f.get(P::KRope);
+  const float *kc = f.get(P::KCache), *vc = f.get(P::VCache);
+  const float *attn_out = f.get(P::AttnOut), *wo_out = f.get(P::WoOut);
+  const float *x_attn = f.get(P::XAttn), *ffn_norm = f.get(P::FfnNorm);
+  const float *gate = f.get(P::Gate), *up = f.get(P::Up);
+  const float *gate_act = f.get(P::GateAct), *ffn_out = f.get(P::FfnOut);
+  const float *x_out = f.get(P::XOut);
+
+  if (w && x_in && attn_norm) {
+    rmsnorm_ref(x_in, w->attn_norm.data(), D, s.rms_eps, ref.data());
+    record("rmsnorm_attn", f, ref.data(), attn_norm, D);
+  }
+  if (w && attn_norm && q && k && v) {
+    w->wq.apply(attn_norm, ref.data());
+    record("q_proj", f, ref.data(), q, D);
+    w->wk.apply(attn_norm, ref.data());
+    record("k_proj", f, ref.data(), k, kv);
+    w->wv.apply(attn_norm, ref.data());
+    record("v_proj", f, ref.data(), v, kv);
+  } else if (w && x_in && q && k && v) {
+    // Fused RMSNorm + QKV: one check over [q, k, v].
+    std::vector<float> norm(D), got(D + 2 * kv);
+    rmsnorm_ref(x_in, w->attn_norm.data(), D, s.rms_eps, norm.data());
+    w->wq.apply(norm.data(), ref.data());
+    w->wk.apply(norm.data(), ref.data() + D);
+    w->wv.apply(norm.data(), ref.data() + D + kv);
+    std::copy(q, q + D, got.begin());
+    std::copy(k, k + kv, got.begin() + D);
+    std::copy(v, v + kv, got.begin() + D + kv);
+    record("rmsnorm_qkv", f, ref.data(), got.data(), D + 2 * kv);
+  }
+  if (q && q_rope) {
+    rope_ref(q, s.heads, s.head_dim, f.pos, s.rope_base, ref.data());
+    record("rope_q", f, ref.data(), q_rope, D);
+  }
+  if (k && k_rope) {
+    rope_ref(k, s.kv_heads, s.head_dim, f.pos, s.rope_base, ref.data());
+    record("rope_k", f, ref.data(), k_rope, kv);
+  }
+  if (kc && vc && v && (k_rope || k)) {
+    // Cache row `pos` of every KV head against the new K (roped) and V.
+    const size_t rows = static_cast<size_t>(f.pos) + 1;
+    std::vector<float> got(2 * kv);
+    for (uint32_t h = 0; h < s.kv_heads; ++h) {
+      const size_t src = (h * rows + f.pos) * s.head_dim;
+      std::copy(kc + src, kc + src + s.head_dim,
+                got.begin() + h * s.head_dim);
+      std::copy(vc + src, vc + src + s.head_dim,
+                got.begin() + kv + h * s.head_dim);
+    }
+    if (k_rope)
+      std::copy(k_rope, k_rope + kv, ref.begin());
+    else
+      rope_ref(k, s.kv_heads, s.head_dim, f.pos, s.rope_base, ref.data());
+    std::copy(v, v + kv, ref.begin() + kv);
+    record(k_rope ? "kv_update" : "rope_kv_update", f, ref.data(), got.data(),
+           2 * kv);
+  }
+  if (q_rope && kc && vc && attn_out) {
+    attention_ref(q_rope, kc, vc, s, f.pos + 1, ref.data());
+    record("attention", f, ref.data(), attn_out, D);
+  }
+  if (w && attn_out && wo_out) {
+    w->wo.apply(attn_out, ref.data());
+    record("wo", f, ref.data(), wo_out, D);
+  }
+  if (x_in && wo_out && x_attn) {
+    add_ref(x_in, wo_out, D, ref.data());
+    record("residual_attn", f, ref.data(), x_attn, D);
+  }
+  if (w && x_attn && ffn_norm) {
+    rmsnorm_ref(x_attn, w->ffn_norm.data(), D, s.rms_eps, ref.data());
+    record("rmsnorm_ffn", f, ref.data(), ffn_norm, D);
+  }
+  if (w && ffn_norm && gate && up) {
+    w->w1.apply(ffn_norm, ref.data());
+    record("ffn_gate", f, ref.data(), gate, H);
+    w->w3.apply(ffn_norm, ref.data());
+    record("ffn_up", f, ref.data(), up, H);
+  }
+  if (gate && up && gate_act) {
+    silu_mul_ref(gate, up, H, ref.data());
+    record("silu_mul", f, ref.data(), gate_act, H);
+  } else if (w && ffn_norm && gate_act) {
+    // Fused gate/up GEMVs + SiLU * up.
+    std::vector<float> g(H), u(H);
+    w->w1.apply(ffn_norm, g.data());
+    w->w3.apply(ffn_norm, u.data());
+    silu_mul_ref(g.data(), u.data(), H, ref.data());
+    record("ffn_front", f, ref.data(), gate_act, H);
+  }
+  if (w && gate_act && ffn_out) {
+    w->w2.apply(gate_act, ref.data());
+    record("ffn_down", f, ref.data(), ffn_out, D);
+  }
+  if (x_attn && ffn_out && x_out) {
+    add_ref(x_attn, ffn_out, D, ref.data());
+    record("residual_ffn", f, ref.data(), x_out, D);
+  }
+}
+
+DriftReport DriftMonitor::report() const {
+  DriftReport r;
+  r.threshold = opt_.max_rel;
+  std::lock_guard<std::mutex> lock(mu_);
+  r.frames_checked = frames_checked_;
+  r.frames_skipped = frames_skipped_;
+  r.errors = errors_;
+  for (const auto &name : op_order_)
+    r.ops.push_back(stats_.at(name));
+  return r;
+}
+
+} // namespace gcore::inference
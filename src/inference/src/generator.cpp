@@ -5,6 +5,8 @@
 #include "gcore/inference/stage_trace.hpp"
 #include "gcore/inference/tokenizer.hpp"
 #include "gcore/inference/trace.hpp"
+#include "gcore/rt/hip/staging.hpp"
+#include "gcore/rt/profiler.hpp"
 
 #include <algorithm>
 #include <chrono>
@@ -330,13 +332,9 @@ static bool trace_lmhead_w_verify_once(const gcore::rt::hip::Buffer &weights,
   return true;
 }
 
+// Ordered with the async stage/layer trace records of the same file.
 static void append_line(const char *path, const std::string &line) {
-  if (!path || !*path)
-    return;
-  std::ofstream f(path, std::ios::out | std::ios::app);
-  if (!f.is_open())
-    return;
-  f << line << "\n";
+  trace_append_line(path, line);
 }
 
 struct ReadoutTrace {
@@ -700,6 +698,8 @@ bool Generator::init(const ModelConfig &config, BlockScheduler *scheduler,
 
 int32_t Generator::sample(const float *logits, size_t vocab_size,
                           const SamplingParams &params) {
+  gcore::rt::ProfileSpan span("sampler", params.greedy ? "sample_greedy"
+                                                       : "sample_temperature");
   // Diagnostic: Check if logits are sane
   float min_l = logits[0], max_l = logits[0], sum_l = 0.0f;
   int nan_count = 0;
@@ -788,6 +788,8 @@ Generator::generate_tokens(const std::vector<int32_t> &prompt_tokens,
   std::vector<int32_t> output = prompt_tokens;
   auto start = std::chrono::high_resolution_clock::now();
   auto first_token_time = start;
+  if (stats)
+    stats->decode_step_ms.clear();
   bool first_token = true;
 
   std::vector<float> logits_host(config_.vocab_size);
@@ -838,24 +840,22 @@ Generator::generate_tokens(const std::vector<int32_t> &prompt_tokens,
     }
   }
 
-  // 1. Prefill: Process all prompt tokens at once
-  if (!scheduler_->forward(prompt_tokens.data(), 0, prompt_tokens.size(),
-                           err)) {
+  // 1. Prefill: Process the prompt (in chunks when GRETA_PREFILL_CHUNK is set)
+  gcore::rt::ProfileSpan prefill_span("generate", "prefill", "tokens",
+                                      static_cast<int64_t>(prompt_tokens.size()));
+  if (!scheduler_->prefill(prompt_tokens.data(), prompt_tokens.size(), err)) {
     return output;
   }
+  prefill_span.end();
 
   // Sample first generated token from the last set of logits in the prefill
-  size_t last_token_offset = 0;
-  if (!prompt_tokens.empty()) {
-    last_token_offset =
-        (prompt_tokens.size() - 1) * config_.vocab_size * sizeof(float);
-  }
+  const size_t last_token_offset = scheduler_->last_logits_offset();
   const auto &logits_buf = scheduler_->get_logits();
   log_d2h_trace(trace_any, "logits", 0, -1, logits_buf, last_token_offset,
                 config_.vocab_size * sizeof(float));
-  if (!scheduler_->get_logits().copy_to_host_offset(
-          logits_host.data(), last_token_offset,
-          config_.vocab_size * sizeof(float), err)) {
+  if (!rt::hip::download_staged(logits_buf, last_token_offset,
+                                logits_host.data(),
+                                config_.vocab_size * sizeof(float), err)) {
     return output;
   }
 
@@ -1128,6 +1128,8 @@ Generator::generate_tokens(const std::vector<int32_t> &prompt_tokens,
   for (int i = 1; i < params.max_tokens; ++i) {
     if (next_token == tokenizer_->eos_id())
       break;
+    gcore::rt::ProfileSpan step_span("generate", "decode_step", "step", i);
+    const auto step_start = std::chrono::high_resolution_clock::now();
 
     // Use current sequence length (output.size() - 1) as start position for the
     // new token
@@ -1145,17 +1147,16 @@ Generator::generate_tokens(const std::vector<int32_t> &prompt_tokens,
     const bool need_logits_host =
         !params.greedy || align_callback || trace_readout || trace_landscape ||
         trace_prefill_decode || trace_delta || trace_stage || trace_post_wo;
-    const size_t decode_logits_offset =
-        decode_seq_start * config_.vocab_size * sizeof(float);
+    const size_t decode_logits_offset = scheduler_->last_logits_offset();
     if (params.greedy && !align_callback && !need_logits_host) {
       next_token = scheduler_->sample_greedy_gpu(decode_logits_offset, err);
     } else {
       const auto &logits_buf = scheduler_->get_logits();
       log_d2h_trace(trace_any, "logits", i, -1, logits_buf,
                     decode_logits_offset, config_.vocab_size * sizeof(float));
-      if (!scheduler_->get_logits().copy_to_host_offset(
-              logits_host.data(), decode_logits_offset,
-              config_.vocab_size * sizeof(float), err)) {
+      if (!rt::hip::download_staged(logits_buf, decode_logits_offset,
+                                    logits_host.data(),
+                                    config_.vocab_size * sizeof(float), err)) {
         break;
       }
 
@@ -1460,6 +1461,11 @@ Generator::generate_tokens(const std::vector<int32_t> &prompt_tokens,
     }
 
     output.push_back(next_token);
+    if (stats)
+      stats->decode_step_ms.push_back(
+          std::chrono::duration<double, std::milli>(
+              std::chrono::high_resolution_clock::now() - step_start)
+              .count());
   }
 
   auto end = std::chrono::high_resolution_clock::now();
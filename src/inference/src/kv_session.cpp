@@ -0,0 +1,271 @@
+#include "gcore/inference/kv_session.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gcore::inference {
+
+static size_t tokens_bytes_padded(uint32_t n_tokens) {
+  const size_t bytes = static_cast<size_t>(n_tokens) * sizeof(int32_t);
+  return (bytes + 63) / 64 * 64;
+}
+
+static size_t payload_offset_for(const KvSessionHeader &h) {
+  return sizeof(KvSessionHeader) + tokens_bytes_padded(h.n_tokens);
+}
+
+uint16_t kv_float_to_half(float f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  const uint32_t sign = (x >> 16) & 0x8000u;
+  const uint32_t exp = (x >> 23) & 0xffu;
+  uint32_t mant = x & 0x7fffffu;
+
+  if (exp == 0xffu) // Inf / NaN
+    return static_cast<uint16_t>(sign | 0x7c00u | (mant ? 0x200u : 0u));
+  int32_t e = static_cast<int32_t>(exp) - 127 + 15;
+  if (e >= 0x1f)
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  if (e <= 0) {
+    if (e < -10)
+      return static_cast<uint16_t>(sign);
+    mant |= 0x800000u;
+    const uint32_t shift = static_cast<uint32_t>(14 - e);
+    uint32_t half = mant >> shift;
+    const uint32_t rem = mant & ((1u << shift) - 1u);
+    const uint32_t mid = 1u << (shift - 1);
+    if (rem > mid || (rem == mid && (half & 1u)))
+      ++half;
+    return static_cast<uint16_t>(sign | half);
+  }
+  uint32_t half = (static_cast<uint32_t>(e) << 10) | (mant >> 13);
+  const uint32_t rem = mant & 0x1fffu;
+  if (rem > 0x1000u || (rem == 0x1000u && (half & 1u)))
+    ++half; // May carry into the exponent, which is the correct rounding.
+  return static_cast<uint16_t>(sign | half);
+}
+
+float kv_half_to_float(uint16_t h) {
+  const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+  uint32_t exp = (h >> 10) & 0x1fu;
+  uint32_t mant = h & 0x3ffu;
+  uint32_t x;
+  if (exp == 0x1fu) {
+    x = sign | 0x7f800000u | (mant << 13);
+  } else if (exp == 0) {
+    if (mant == 0) {
+      x = sign;
+    } else {
+      exp = 127 - 15 + 1;
+      while ((mant & 0x400u) == 0) {
+        mant <<= 1;
+        --exp;
+      }
+      x = sign | (exp << 23) | ((mant & 0x3ffu) << 13);
+    }
+  } else {
+    x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+  }
+  float f;
+  std::memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+KvSessionWriter::~KvSessionWriter() {
+  if (file_) {
+    std::fclose(static_cast<FILE *>(file_));
+    std::remove(tmp_path_.c_str());
+  }
+}
+
+bool KvSessionWriter::open(const std::string &path,
+                           const KvSessionHeader &header,
+                           const int32_t *tokens, std::string *err) {
+  path_ = path;
+  tmp_path_ = path + ".tmp";
+  header_ = header;
+  layers_written_ = 0;
+  FILE *f = std::fopen(tmp_path_.c_str(), "wb");
+  if (!f) {
+    if (err)
+      *err = "Failed to create session file: " + tmp_path_;
+    return false;
+  }
+  file_ = f;
+
+  const size_t tok_bytes =
+      static_cast<size_t>(header_.n_tokens) * sizeof(int32_t);
+  const size_t pad = tokens_bytes_padded(header_.n_tokens) - tok_bytes;
+  static const char zeros[64] = {};
+  if (std::fwrite(&header_, sizeof(header_), 1, f) != 1 ||
+      (tok_bytes && std::fwrite(tokens, 1, tok_bytes, f) != tok_bytes) ||
+      (pad && std::fwrite(zeros, 1, pad, f) != pad)) {
+    if (err)
+      *err = "Failed to write session header: " + tmp_path_;
+    return false;
+  }
+  return true;
+}
+
+bool KvSessionWriter::write_payload(const float *src, size_t count,
+                                    std::string *err) {
+  FILE *f = static_cast<FILE *>(file_);
+  size_t written;
+  if (header_.codec == static_cast<uint32_t>(KvSessionCodec::F16)) {
+    half_.resize(count);
+    for (size_t i = 0; i < count; ++i)
+      half_[i] = kv_float_to_half(src[i]);
+    written = std::fwrite(half_.data(), sizeof(uint16_t), count, f);
+  } else {
+    written = std::fwrite(src, sizeof(float), count, f);
+  }
+  if (written != count) {
+    if (err)
+      *err = "Failed to write session layer: " + tmp_path_;
+    return false;
+  }
+  return true;
+}
+
+bool KvSessionWriter::write_layer(const float *k, const float *v,
+                                  std::string *err) {
+  if (!file_ || layers_written_ >= header_.num_layers) {
+    if (err)
+      *err = "Session writer: unexpected layer";
+    return false;
+  }
+  const size_t count = static_cast<size_t>(header_.num_heads_kv) *
+                       header_.n_tokens * header_.head_dim;
+  if (!write_payload(k, count, err) || !write_payload(v, count, err))
+    return false;
+  ++layers_written_;
+  return true;
+}
+
+bool KvSessionWriter::finish(std::string *err) {
+  if (!file_)
+    return false;
+  FILE *f = static_cast<FILE *>(file_);
+  file_ = nullptr;
+  const bool flushed = std::fflush(f) == 0;
+  std::fclose(f);
+  if (!flushed || layers_written_ != header_.num_layers) {
+    std::remove(tmp_path_.c_str());
+    if (err)
+      *err = "Session file incomplete: " + path_;
+    return false;
+  }
+  if (std::rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+    std::remove(tmp_path_.c_str());
+    if (err)
+      *err = "Failed to publish session file: " + path_;
+    return false;
+  }
+  return true;
+}
+
+KvSessionFile::~KvSessionFile() { close(); }
+
+void KvSessionFile::close() {
+  if (map_)
+    munmap(const_cast<uint8_t *>(map_), map_size_);
+  map_ = nullptr;
+  map_size_ = 0;
+}
+
+bool KvSessionFile::open(const std::string &path, std::string *err) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (err)
+      *err = "Failed to open session file: " + path;
+    return false;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(KvSessionHeader)) {
+    ::close(fd);
+    if (err)
+      *err = "Session file too small: " + path;
+    return false;
+  }
+  map_size_ = static_cast<size_t>(st.st_size);
+  void *p = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    map_size_ = 0;
+    if (err)
+      *err = "Failed to mmap session file: " + path;
+    return false;
+  }
+  map_ = static_cast<const uint8_t *>(p);
+  std::memcpy(&header_, map_, sizeof(header_));
+
+  const KvSessionHeader ref;
+  const bool codec_ok =
+      header_.codec == static_cast<uint32_t>(KvSessionCodec::F32) ||
+      header_.codec == static_cast<uint32_t>(KvSessionCodec::F16);
+  payload_offset_ = payload_offset_for(header_);
+  const size_t expected =
+      payload_offset_ + 2 * header_.num_layers * layer_elems() * elem_bytes();
+  if (std::memcmp(header_.magic, ref.magic, 4) != 0 ||
+      header_.version != ref.version || !codec_ok || map_size_ != expected) {
+    close();
+    if (err)
+      *err = "Invalid or truncated session file: " + path;
+    return false;
+  }
+  return true;
+}
+
+const int32_t *KvSessionFile::tokens() const {
+  return reinterpret_cast<const int32_t *>(map_ + sizeof(KvSessionHeader));
+}
+
+size_t KvSessionFile::elem_bytes() const {
+  return header_.codec == static_cast<uint32_t>(KvSessionCodec::F16)
+             ? sizeof(uint16_t)
+             : sizeof(float);
+}
+
+size_t KvSessionFile::layer_elems() const {
+  return static_cast<size_t>(header_.num_heads_kv) * header_.n_tokens *
+         header_.head_dim;
+}
+
+const uint8_t *KvSessionFile::layer_ptr(size_t layer) const {
+  return map_ + payload_offset_ + 2 * layer * layer_elems() * elem_bytes();
+}
+
+void KvSessionFile::prefetch(size_t layer) const {
+  if (!map_ || layer >= header_.num_layers)
+    return;
+  // madvise wants a page-aligned start.
+  const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  const uintptr_t start = reinterpret_cast<uintptr_t>(layer_ptr(layer));
+  const uintptr_t aligned = start & ~(page - 1);
+  const size_t len = 2 * layer_elems() * elem_bytes() + (start - aligned);
+  madvise(reinterpret_cast<void *>(aligned), len, MADV_WILLNEED);
+}
+
+void KvSessionFile::read_layer(size_t layer, float *k_dst,
+                               float *v_dst) const {
+  const size_t count = layer_elems();
+  const uint8_t *src = layer_ptr(layer);
+  if (header_.codec == static_cast<uint32_t>(KvSessionCodec::F16)) {
+    const uint16_t *h = reinterpret_cast<const uint16_t *>(src);
+    for (size_t i = 0; i < count; ++i)
+      k_dst[i] = kv_half_to_float(h[i]);
+    for (size_t i = 0; i < count; ++i)
+      v_dst[i] = kv_half_to_float(h[count + i]);
+  } else {
+    std::memcpy(k_dst, src, count * sizeof(float));
+    std::memcpy(v_dst, src + count * sizeof(float), count * sizeof(float));
+  }
+}
+
+} // namespace gcore::inference
@@ -1,4 +1,5 @@
 #include "gcore/inference/layer_trace.hpp"
+#include "gcore/inference/stage_trace.hpp"
 
 #include <algorithm>
 #include <cmath>
@@ -12,7 +13,7 @@ namespace gcore::inference {
 
 static bool env_flag(const char *k) {
   const char *v = std::getenv(k);
-  return v && v[0] == 1;
+  return v && v[0] == '1';
 }
 
 struct F32Stats {
@@ -178,7 +179,14 @@ void LayerTracer::init_from_env(const ModelConfig &config) {
   }
 
   if (!cfg_.out_path.empty()) {
-    out_.open(cfg_.out_path, std::ios::out | std::ios::trunc);
+    trace_writer().truncate(cfg_.out_path);
+    if (auto enc = encoder()) {
+      // The truncated file starts a new session.
+      trace_writer().capture(
+          cfg_.out_path, nullptr, 0, nullptr,
+          [enc](const void *, size_t, std::string &) { enc->reset(); },
+          nullptr);
+    }
   }
 }
 
@@ -201,6 +209,53 @@ bool LayerTracer::point_enabled(const char *tag) const {
   return (cfg_.points_mask & bit) != 0;
 }
 
+// Formatted on the trace writer thread once the snapshot has landed: a
+// binary record when `enc` is set, else the JSON line.
+static void format_tensor(TraceEncoder *enc, int step, int layer,
+                          const char *tag, uint32_t n, const float *host,
+                          std::string &out) {
+  F32Stats s = stats_f32(host, n);
+  uint64_t h = hash_f32(host, n);
+
+  if (enc) {
+    TraceTensorRecord rec;
+    rec.source = static_cast<uint32_t>(TraceSource::Layer);
+    rec.point = enc->intern(tag, out);
+    rec.layer = layer;
+    rec.step = static_cast<uint32_t>(step);
+    rec.n = n;
+    rec.payload_n = trace_binary_payload() ? n : 0;
+    rec.hash = h;
+    rec.min = s.min;
+    rec.max = s.max;
+    rec.mean = s.mean;
+    rec.nan = static_cast<uint32_t>(s.nan);
+    rec.inf = static_cast<uint32_t>(s.inf);
+    enc->tensor(rec, nullptr, nullptr, rec.payload_n ? host : nullptr, out);
+    return;
+  }
+
+  std::ostringstream oss;
+  oss << "{\"step\":" << step << ",\"layer\":" << layer
+      << ",\"tag\":\"" << tag << "\""
+      << ",\"n\":" << n << ",\"hash\":" << h
+      << ",\"min\":" << s.min << ",\"max\":" << s.max
+      << ",\"mean\":" << s.mean << ",\"nan\":" << s.nan
+      << ",\"inf\":" << s.inf << "}\n";
+  out += oss.str();
+}
+
+const std::string &LayerTracer::out_path() const {
+  static const std::string kStdout = "/dev/stdout";
+  return cfg_.out_path.empty() ? kStdout : cfg_.out_path;
+}
+
+std::shared_ptr<TraceEncoder> LayerTracer::encoder() const {
+  if (!trace_binary_path(cfg_.out_path.c_str()))
+    return nullptr;
+  return trace_encoder(cfg_.out_path);
+}
+
 void LayerTracer::trace_tensor(const char *tag, int step, int layer,
                                hipStream_t stream, const float *d,
                                uint32_t n) {
@@ -213,29 +268,15 @@ void LayerTracer::trace_tensor(const char *tag, int step, int layer,
   if (n == 0)
     return;
 
-  std::vector<float> host(n);
-  if (hipMemcpyAsync(host.data(), d, n * sizeof(float), hipMemcpyDeviceToHost,
-                     stream) != hipSuccess) {
-    return;
-  }
-  hipStreamSynchronize(stream);
-
-  F32Stats s = stats_f32(host.data(), n);
-  uint64_t h = hash_f32(host.data(), n);
-
-  std::ostringstream oss;
-  oss << "{\"step\":" << step << ",\"layer\":" << layer
-      << ",\"tag\":\"" << tag << "\""
-      << ",\"n\":" << n << ",\"hash\":" << h
-      << ",\"min\":" << s.min << ",\"max\":" << s.max
-      << ",\"mean\":" << s.mean << ",\"nan\":" << s.nan
-      << ",\"inf\":" << s.inf << "}";
-
-  if (out_.is_open()) {
-    out_ << oss.str() << "\n";
-  } else {
-    std::cout << oss.str() << "\n";
-  }
+  // tag is one of the point literals (point_enabled() matched it).
+  trace_writer().capture(
+      out_path(), d, n * sizeof(float), stream,
+      [enc = encoder(), step, layer, tag, n](const void *data, size_t,
+                                             std::string &out) {
+        format_tensor(enc.get(), step, layer, tag, n,
+                      static_cast<const float *>(data), out);
+      },
+      nullptr);
 }
 
 void LayerTracer::trace_tensor_f16(const char *tag, int step, int layer,
@@ -250,34 +291,18 @@ void LayerTracer::trace_tensor_f16(const char *tag, int step, int layer,
   if (n == 0)
     return;
 
-  std::vector<__half> host_half(n);
-  if (hipMemcpyAsync(host_half.data(), d, n * sizeof(__half),
-                     hipMemcpyDeviceToHost, stream) != hipSuccess) {
-    return;
-  }
-  hipStreamSynchronize(stream);
-
-  std::vector<float> host(n);
-  for (uint32_t i = 0; i < n; ++i) {
-    host[i] = __half2float(host_half[i]);
-  }
-
-  F32Stats s = stats_f32(host.data(), n);
-  uint64_t h = hash_f32(host.data(), n);
-
-  std::ostringstream oss;
-  oss << "{\"step\":" << step << ",\"layer\":" << layer
-      << ",\"tag\":\"" << tag << "\""
-      << ",\"n\":" << n << ",\"hash\":" << h
-      << ",\"min\":" << s.min << ",\"max\":" << s.max
-      << ",\"mean\":" << s.mean << ",\"nan\":" << s.nan
-      << ",\"inf\":" << s.inf << "}";
-
-  if (out_.is_open()) {
-    out_ << oss.str() << "\n";
-  } else {
-    std::cout << oss.str() << "\n";
-  }
+  trace_writer().capture(
+      out_path(), d, n * sizeof(__half), stream,
+      [enc = encoder(), step, layer, tag, n](const void *data, size_t,
+                                             std::string &out) {
+        const __half *host_half = static_cast<const __half *>(data);
+        std::vector<float> host(n);
+        for (uint32_t i = 0; i < n; ++i) {
+          host[i] = __half2float(host_half[i]);
+        }
+        format_tensor(enc.get(), step, layer, tag, n, host.data(), out);
+      },
+      nullptr);
 }
 
 void layer_trace_emit_step_header(int step, size_t pos_id, size_t seq_len,
@@ -292,9 +317,30 @@ void layer_trace_emit_step_header(int step, size_t pos_id, size_t seq_len,
   const char *layers = std::getenv("GRETA_TRACE_LAYER_LAYERS");
   const char *points = std::getenv("GRETA_TRACE_LAYER_POINTS");
 
-  std::ofstream f(out, std::ios::out | std::ios::app);
-  if (!f.is_open())
+  if (trace_binary_path(out)) {
+    TraceStepRecord rec;
+    rec.step = step;
+    rec.token_in = token_in;
+    rec.token_out = token_out;
+    rec.dim = cfg.dim;
+    rec.heads = cfg.num_heads;
+    rec.head_dim = cfg.head_dim;
+    rec.pos_id = pos_id;
+    rec.seq_len = seq_len;
+    rec.tokens_total = tokens_total;
+    trace_writer().capture(
+        out, nullptr, 0, nullptr,
+        [enc = trace_encoder(out), rec,
+         layers = std::string(layers ? layers : ""),
+         points = std::string(points ? points : "")](
+            const void *, size_t, std::string &line) mutable {
+          rec.layers = enc->intern(layers.c_str(), line);
+          rec.points = enc->intern(points.c_str(), line);
+          enc->step(rec, line);
+        },
+        nullptr);
     return;
+  }
 
   std::ostringstream oss;
   oss << "{\"type\":\"step_header\""
@@ -310,7 +356,7 @@ void layer_trace_emit_step_header(int step, size_t pos_id, size_t seq_len,
       << ",\"layers\":\"" << (layers ? layers : "") << "\""
       << ",\"points\":\"" << (points ? points : "") << "\""
       << "}";
-  f << oss.str() << "\n";
+  trace_append_line(out, oss.str());
 }
 
 } // namespace gcore::inference
@@ -0,0 +1,269 @@
+#include "gcore/inference/runtime_options.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace gcore::inference {
+
+static bool env_flag(const char *k) {
+  const char *v = std::getenv(k);
+  return v && (v[0] == '1' || v[0] == 'y' || v[0] == 'Y');
+}
+
+static bool env_equals(const char *k, const char *value) {
+  const char *v = std::getenv(k);
+  return v && std::strcmp(v, value) == 0;
+}
+
+static std::string env_str(const char *k) {
+  const char *v = std::getenv(k);
+  return v ? std::string(v) : std::string();
+}
+
+// First non-empty of `k`, then `fallback`.
+static std::string env_path(const char *k, const char *fallback = nullptr) {
+  std::string out = env_str(k);
+  if (out.empty() && fallback)
+    out = env_str(fallback);
+  return out;
+}
+
+static uint32_t env_u32(const char *k, uint32_t def, bool allow_zero) {
+  const char *v = std::getenv(k);
+  if (!v || !*v)
+    return def;
+  char *e = nullptr;
+  long val = std::strtol(v, &e, 10);
+  if (e == v || val < 0 || (val == 0 && !allow_zero))
+    return def;
+  return static_cast<uint32_t>(val);
+}
+
+static double env_double(const char *k, double def) {
+  const char *v = std::getenv(k);
+  if (!v || !*v)
+    return def;
+  char *e = nullptr;
+  const double val = std::strtod(v, &e);
+  return (e == v || !(val > 0.0)) ? def : val;
+}
+
+static std::vector<std::string> split_csv(const char *v) {
+  std::vector<std::string> out;
+  if (!v || !*v)
+    return out;
+  std::string s(v);
+  size_t start = 0;
+  while (start < s.size()) {
+    size_t end = s.find(',', start);
+    std::string token = s.substr(
+        start, (end == std::string::npos) ? s.size() - start : end - start);
+    if (!token.empty())
+      out.push_back(token);
+    if (end == std::string::npos)
+      break;
+    start = end + 1;
+  }
+  return out;
+}
+
+static bool is_all(const std::string &s) {
+  return s == "all" || s == "ALL" || s == "*";
+}
+
+// Empty for unset or `all`.
+static std::vector<int> parse_layers(const char *v) {
+  std::vector<int> layers;
+  if (!v || is_all(v))
+    return layers;
+  for (const auto &token : split_csv(v)) {
+    char *e = nullptr;
+    long val = std::strtol(token.c_str(), &e, 10);
+    if (e != token.c_str())
+      layers.push_back(static_cast<int>(val));
+  }
+  return layers;
+}
+
+static TraceLayerFilter parse_layer_filter(const char *k) {
+  TraceLayerFilter f;
+  const char *v = std::getenv(k);
+  f.all = v && is_all(v);
+  if (!f.all)
+    f.layers = parse_layers(v);
+  if (f.layers.empty() && !f.all)
+    f.layers.push_back(0);
+  return f;
+}
+
+static uint32_t parse_attn_points(const char *v) {
+  uint32_t mask = 0;
+  for (const auto &token : split_csv(v)) {
+    if (token == "q")
+      mask |= static_cast<uint32_t>(AttnTracePoint::Q);
+    else if (token == "k")
+      mask |= static_cast<uint32_t>(AttnTracePoint::K);
+    else if (token == "v")
+      mask |= static_cast<uint32_t>(AttnTracePoint::V);
+    else if (token == "attn_out")
+      mask |= static_cast<uint32_t>(AttnTracePoint::ATTN_OUT);
+    else if (token == "x_out")
+      mask |= static_cast<uint32_t>(AttnTracePoint::X_OUT);
+  }
+  return mask ? mask : RuntimeTraceOptions().attn_points;
+}
+
+static bool phase_listed(const std::vector<std::string> &phases,
+                         const char *phase) {
+  if (phases.empty())
+    return true;
+  if (!phase)
+    return false;
+  for (const auto &p : phases) {
+    if (p == phase)
+      return true;
+  }
+  return false;
+}
+
+bool TraceLayerFilter::selected(size_t layer_idx, size_t num_layers) const {
+  if (all || layers.empty())
+    return true;
+  for (int layer : layers) {
+    if (layer < 0 && static_cast<size_t>(-layer) == num_layers)
+      return true;
+    if (static_cast<size_t>(layer) == layer_idx)
+      return true;
+  }
+  return false;
+}
+
+bool RuntimeTraceOptions::post_wo_phase(const char *phase) const {
+  return phase_listed(post_wo_phases, phase);
+}
+
+bool RuntimeTraceOptions::rmsnorm_phase(const char *phase) const {
+  return phase_listed(rmsnorm_phases, phase);
+}
+
+static RuntimeTraceOptions trace_options_from_env() {
+  RuntimeTraceOptions t;
+  if (const char *v = std::getenv("GRETA_TRACE_PROMPT_ID")) {
+    t.prompt_id = v;
+    t.prompt_id_set = true;
+  }
+
+  t.attn_decode_verify = env_flag("GRETA_TRACE_ATTN_DECODE_VERIFY");
+  t.attn_ref = env_flag("GRETA_TRACE_ATTN_REF");
+  t.attn_softmax = env_flag("GRETA_TRACE_ATTN_SOFTMAX");
+  t.attn_vacc = env_flag("GRETA_TRACE_ATTN_VACC");
+  t.attn_l0_pipe = env_flag("GRETA_TRACE_ATTN_L0_PIPE");
+  t.attn_l0_norm = env_flag("GRETA_TRACE_ATTN_L0_NORM");
+  t.v_addr = env_flag("GRETA_TRACE_V_ADDR");
+  t.kv_invariants = env_flag("GRETA_TRACE_KV_INVARIANTS");
+  t.attn_decode_ref = env_flag("GRETA_ATTN_DECODE_REF");
+  t.attn_mfma_shadow = env_flag("GRETA_ATTN_DECODE_MFMA_SHADOW");
+  t.attn_layers = parse_layers(std::getenv("GRETA_TRACE_ATTN_LAYERS"));
+  if (const char *v = std::getenv("GRETA_TRACE_ATTN_LAYER")) {
+    char *e = nullptr;
+    long val = std::strtol(v, &e, 10);
+    if (*v && e != v) {
+      t.attn_layer_set = true;
+      t.attn_layer = static_cast<int>(val);
+    }
+  }
+  t.attn_head = env_u32("GRETA_TRACE_ATTN_HEAD", 0, true);
+  t.attn_keys_window = env_u32("GRETA_TRACE_ATTN_KEYS_WINDOW", 64, false);
+  t.attn_dims_sample = env_u32("GRETA_TRACE_ATTN_DIMS_SAMPLE", 16, false);
+  t.attn_points = parse_attn_points(std::getenv("GRETA_TRACE_ATTN_POINTS"));
+  t.attn_decode_out =
+      env_path("GRETA_TRACE_ATTN_DECODE_OUT", "GRETA_TRACE_PREFILL_DECODE_OUT");
+  t.attn_shadow_out = env_path("GRETA_ATTN_DECODE_MFMA_SHADOW_OUT");
+  if (t.attn_shadow_out.empty())
+    t.attn_shadow_out = t.attn_decode_out;
+  t.attn_ref_out = env_path("GRETA_TRACE_ATTN_REF_OUT");
+  t.attn_out = env_path("GRETA_TRACE_ATTN_OUT");
+  t.attn_l0_pipe_out = env_path("GRETA_TRACE_ATTN_L0_PIPE_OUT");
+  t.v_addr_out = env_path("GRETA_TRACE_V_ADDR_OUT");
+
+  t.qkv_w_verify = env_flag("GRETA_TRACE_QKV_W_VERIFY");
+  t.wo_w_verify = env_flag("GRETA_TRACE_WO_W_VERIFY");
+
+  t.post_wo = env_flag("GRETA_TRACE_POST_WO");
+  t.post_wo_out = env_path("GRETA_TRACE_POST_WO_OUT");
+  t.post_wo_sample = env_u32("GRETA_TRACE_POST_WO_SAMPLE", 1024, false);
+  t.post_wo_layers = parse_layer_filter("GRETA_TRACE_POST_WO_LAYERS");
+  t.post_wo_phases = split_csv(std::getenv("GRETA_TRACE_POST_WO_PHASES"));
+  t.rmsnorm = env_flag("GRETA_TRACE_RMSNORM");
+  t.rmsnorm_out = env_path("GRETA_TRACE_RMSNORM_OUT");
+  t.rmsnorm_sample = env_u32("GRETA_TRACE_RMSNORM_SAMPLE", 1024, false);
+  t.rmsnorm_layers = parse_layer_filter("GRETA_TRACE_RMSNORM_LAYERS");
+  t.rmsnorm_phases = split_csv(std::getenv("GRETA_TRACE_RMSNORM_PHASES"));
+
+  t.layer_delta = env_flag("GRETA_TRACE_LAYER_DELTA");
+  t.layer_delta_out =
+      env_path("GRETA_TRACE_LAYER_DELTA_OUT", "GRETA_TRACE_PREFILL_DECODE_OUT");
+
+  t.kernel_sync = env_flag("GRETA_TRACE_READOUT") ||
+                  env_flag("GRETA_TRACE_PREFILL_DECODE") ||
+                  env_flag("GRETA_TRACE_LANDSCAPE");
+  t.embed_verify = env_flag("GRETA_TRACE_EMBED_VERIFY");
+  return t;
+}
+
+static DriftOptions drift_options_from_env() {
+  DriftOptions d;
+  d.out = env_path("GRETA_DRIFT_OUT");
+  d.enabled = env_flag("GRETA_DRIFT") || !d.out.empty();
+  d.every = env_u32("GRETA_DRIFT_EVERY", d.every, false);
+  if (const char *v = std::getenv("GRETA_DRIFT_LAYERS")) {
+    if (is_all(v))
+      d.layers = {true, {}};
+    else if (!parse_layers(v).empty())
+      d.layers.layers = parse_layers(v);
+  }
+  d.max_rel = env_double("GRETA_DRIFT_MAX_REL", d.max_rel);
+  d.frames = env_u32("GRETA_DRIFT_FRAMES", d.frames, false);
+  return d;
+}
+
+RuntimeOptions RuntimeOptions::from_env() {
+  RuntimeOptions o;
+  o.fused_rmsnorm = env_equals("GRETA_USE_FUSED_RMSNORM", "1");
+  o.fused_attention = env_equals("GRETA_USE_FUSED_ATTENTION", "1");
+  o.fused_ffn = env_equals("GRETA_USE_FUSED_FFN", "1");
+  const std::string kernel = env_str("GRETA_FORCE_ATTN_DECODE_KERNEL");
+  if (kernel == "manual" || kernel == "MANUAL")
+    o.attn_decode_kernel = AttnDecodeKernel::Manual;
+  else if (kernel == "fused" || kernel == "FUSED")
+    o.attn_decode_kernel = AttnDecodeKernel::Fused;
+  const std::string accum = env_str("GRETA_ATTN_ACCUM");
+  if (accum == "fp16" || accum == "FP16")
+    o.attn_accum = AttnAccumMode::Fp16;
+
+  o.qkv_force_route = env_str("GRETA_QKV_FORCE_ROUTE");
+  if (o.qkv_force_route == "auto" || o.qkv_force_route == "AUTO")
+    o.qkv_force_route.clear();
+  o.qkv_force_gemm = env_flag("GRETA_QKV_FORCE_GEMM");
+  o.gemm_force = env_str("GRETA_GEMM_FORCE");
+  o.attn_decode_matmul = env_str("GRETA_FORCE_ATTN_DECODE_MATMUL");
+  o.wo_layout_force = env_str("GRETA_WO_LAYOUT_FORCE");
+  const std::string layout = env_str("GRETA_EMBED_LAYOUT");
+  o.embed_row_major =
+      !(layout == "col" || layout == "COL" || layout == "col_major");
+
+  o.graph = env_equals("GRETA_GRAPH", "1");
+  o.profile_attn = std::getenv("GRETA_PROFILE_ATTN") != nullptr;
+  o.profile_blocks = env_equals("GRETA_PROFILE_BLOCKS", "1");
+  o.profile_sync = env_flag("GRETA_PROFILE_SYNC") ||
+                   std::getenv("GRETA_PROFILE_ROOFLINE") != nullptr;
+  o.prefill_chunk = env_u32("GRETA_PREFILL_CHUNK", 0, true);
+  o.activation_arena = env_flag("GRETA_ACTIVATION_ARENA");
+
+  if (kTraceEnabled)
+    o.trace = trace_options_from_env();
+  o.drift = drift_options_from_env();
+  return o;
+}
+
+} // namespace gcore::inference
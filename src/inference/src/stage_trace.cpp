@@ -1,10 +1,12 @@
 #include "gcore/inference/stage_trace.hpp"
+#include "gcore/rt/hip/staging.hpp"
 
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
-#include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
 
 namespace gcore::inference {
@@ -107,47 +109,101 @@ static uint64_t hash_f32(const float *p, size_t n) {
   return h;
 }
 
-static void append_line(const char *path, const std::string &line) {
+gcore::rt::TraceWriter &trace_writer() {
+  // Leaked on purpose (like staging_pool()): flushed from atexit, before
+  // the HIP runtime tears down.
+  static gcore::rt::TraceWriter *writer = [] {
+    gcore::rt::TraceWriterOptions opt;
+    if (const char *mb = std::getenv("GRETA_TRACE_RING_MB")) {
+      const size_t v = std::strtoull(mb, nullptr, 10);
+      if (v > 0)
+        opt.ring_bytes = v << 20;
+    }
+    static gcore::rt::hip::HipStagingBackend backend;
+    auto *w = new gcore::rt::TraceWriter(&backend, opt);
+    std::atexit([] { trace_writer().flush(); });
+    return w;
+  }();
+  return *writer;
+}
+
+void trace_append_line(const char *path, const std::string &line) {
   if (!path || !*path)
     return;
-  std::ofstream f(path, std::ios::out | std::ios::app);
-  if (!f.is_open())
+  if (trace_binary_path(path)) {
+    trace_writer().capture(
+        path, nullptr, 0, nullptr,
+        [enc = trace_encoder(path), line](const void *, size_t,
+                                          std::string &out) {
+          enc->json(line, out);
+        },
+        nullptr);
     return;
-  f << line << "\n";
+  }
+  trace_writer().append_line(path, line);
 }
 
-StageTraceConfig stage_trace_config() {
-  static StageTraceConfig cfg;
-  static bool initialized = false;
-  if (!initialized) {
-    cfg.enabled = false;
+bool trace_binary_path(const char *path) {
+  static const bool binary = [] {
+    const char *f = std::getenv("GRETA_TRACE_FORMAT");
+    return f && (std::strcmp(f, "bin") == 0 || std::strcmp(f, "binary") == 0);
+  }();
+  if (!binary || !path || !*path)
+    return false;
+  const char *stage = std::getenv("GRETA_TRACE_STAGE_OUT");
+  const char *layer = std::getenv("GRETA_TRACE_LAYER_OUT");
+  return (stage && std::strcmp(stage, path) == 0) ||
+         (layer && std::strcmp(layer, path) == 0);
+}
+
+bool trace_binary_payload() {
+  static const bool on = [] {
+    const char *v = std::getenv("GRETA_TRACE_PAYLOAD");
+    return v && v[0] == '1';
+  }();
+  return on;
+}
+
+std::shared_ptr<TraceEncoder> trace_encoder(const std::string &path) {
+  static std::mutex mu;
+  static std::map<std::string, std::shared_ptr<TraceEncoder>> encoders;
+  std::lock_guard<std::mutex> lock(mu);
+  auto &enc = encoders[path];
+  if (!enc)
+    enc = std::make_shared<TraceEncoder>();
+  return enc;
+}
+
+// Read once; the hot path only reads the cached config.
+const StageTraceConfig &stage_trace_config() {
+  static const StageTraceConfig cfg = [] {
+    StageTraceConfig c;
     const char *on = std::getenv("GRETA_TRACE_STAGE");
     if (on && (on[0] == '1' || on[0] == 'y' || on[0] == 'Y'))
-      cfg.enabled = true;
-    cfg.out_path = std::getenv("GRETA_TRACE_STAGE_OUT");
-    cfg.layers = parse_layers(std::getenv("GRETA_TRACE_STAGE_LAYERS"));
-    cfg.points = split_csv(std::getenv("GRETA_TRACE_STAGE_POINTS"));
-    cfg.phases = split_csv(std::getenv("GRETA_TRACE_STAGE_PHASES"));
-    cfg.debug_input = false;
+      c.enabled = true;
+    c.out_path = std::getenv("GRETA_TRACE_STAGE_OUT");
+    c.layers = parse_layers(std::getenv("GRETA_TRACE_STAGE_LAYERS"));
+    c.points = split_csv(std::getenv("GRETA_TRACE_STAGE_POINTS"));
+    c.phases = split_csv(std::getenv("GRETA_TRACE_STAGE_PHASES"));
     const char *dbg = std::getenv("GRETA_TRACE_STAGE_DEBUG_INPUT");
     if (dbg && (dbg[0] == '1' || dbg[0] == 'y' || dbg[0] == 'Y'))
-      cfg.debug_input = true;
+      c.debug_input = true;
     const char *s = std::getenv("GRETA_TRACE_STAGE_SAMPLE");
     if (s && *s) {
       char *e = nullptr;
       long val = std::strtol(s, &e, 10);
       if (e != s && val > 0)
-        cfg.sample = static_cast<uint32_t>(val);
+        c.sample = static_cast<uint32_t>(val);
     }
-    initialized = true;
-  }
+    return c;
+  }();
   return cfg;
 }
 
 bool stage_trace_enabled() { return stage_trace_config().enabled; }
 
 bool stage_trace_layer_selected(size_t layer_idx, size_t num_layers) {
-  const auto cfg = stage_trace_config();
+  const auto &cfg = stage_trace_config();
   if (!cfg.enabled)
     return false;
   if (cfg.layers.empty())
@@ -162,7 +218,7 @@ bool stage_trace_layer_selected(size_t layer_idx, size_t num_layers) {
 }
 
 bool stage_trace_point_enabled(const char *point) {
-  const auto cfg = stage_trace_config();
+  const auto &cfg = stage_trace_config();
   if (!cfg.enabled)
     return false;
   if (cfg.points.empty())
@@ -175,7 +231,7 @@ bool stage_trace_point_enabled(const char *point) {
 }
 
 bool stage_trace_phase_enabled(const char *phase) {
-  const auto cfg = stage_trace_config();
+  const auto &cfg = stage_trace_config();
   if (!cfg.enabled)
     return false;
   if (cfg.phases.empty())
@@ -199,7 +255,7 @@ void stage_trace_tensor(const char *point, const char *phase,
                         uint32_t tokens_total, const float *base,
                         size_t stride_elems, size_t token_index,
                         hipStream_t stream, const StageInputMeta *input_meta) {
-  const auto cfg = stage_trace_config();
+  const auto &cfg = stage_trace_config();
   if (!cfg.enabled || !cfg.out_path || !*cfg.out_path || !point || !phase)
     return;
   if (!stage_trace_phase_enabled(phase))
@@ -209,18 +265,10 @@ void stage_trace_tensor(const char *point, const char *phase,
   if (!base || stride_elems == 0)
     return;
 
-  size_t offset_elems = token_index * stride_elems;
+  const size_t offset_elems = token_index * stride_elems;
   const float *ptr = base + offset_elems;
   const uint32_t sample_n =
       std::min<uint32_t>(cfg.sample, static_cast<uint32_t>(stride_elems));
-  std::vector<float> host(sample_n, 0.0f);
-  if (sample_n > 0) {
-    hipMemcpyAsync(host.data(), ptr, sample_n * sizeof(float),
-                   hipMemcpyDeviceToHost, stream);
-    hipStreamSynchronize(stream);
-  }
-  const F32Stats stats = stats_f32(host.data(), host.size());
-  const uint64_t hash = hash_f32(host.data(), host.size());
 
   uint32_t debug_token_id = 0;
   if (cfg.debug_input && phase && std::strcmp(phase, "decode0") == 0) {
@@ -230,57 +278,126 @@ void stage_trace_tensor(const char *point, const char *phase,
           static_cast<uint32_t>(std::strtoul(tid_env, nullptr, 10));
     }
   }
-
-  std::ostringstream oss;
-  oss << "{\"event\":\"stage_trace\"";
-  if (prompt_id && *prompt_id)
-    oss << ",\"prompt_id\":\"" << prompt_id << "\"";
-  oss << ",\"phase\":\"" << phase << "\""
-      << ",\"point\":\"" << point << "\""
-      << ",\"layer\":" << layer << ",\"step\":" << step
-      << ",\"pos_id\":" << pos_id << ",\"seq_len\":" << seq_len
-      << ",\"tokens_total\":" << tokens_total
-      << ",\"token_index\":" << token_index
-      << ",\"stride_elems\":" << stride_elems << ",\"sample_n\":" << sample_n
-      << ",\"ptr\":" << reinterpret_cast<uintptr_t>(base)
-      << ",\"offset_bytes\":" << (offset_elems * sizeof(float))
-      << ",\"hash\":" << hash << ",\"min\":" << stats.min
-      << ",\"max\":" << stats.max << ",\"mean\":" << stats.mean
-      << ",\"abs_sum\":" << stats.abs_sum << ",\"nan\":" << stats.nan
-      << ",\"inf\":" << stats.inf << ",\"nz_count\":" << stats.nz_count
-      << ",\"sample\":[";
-  for (size_t i = 0; i < host.size(); ++i) {
-    if (i)
-      oss << ",";
-    oss << host[i];
-  }
-  oss << "]";
-
   uint32_t final_token_id = (input_meta ? input_meta->token_id : 0);
   if (final_token_id == 0 && debug_token_id != 0)
     final_token_id = debug_token_id;
 
+  if (trace_binary_path(cfg.out_path)) {
+    TraceTensorRecord rec;
+    rec.source = static_cast<uint32_t>(TraceSource::Stage);
+    rec.layer = static_cast<int32_t>(layer);
+    rec.step = step;
+    TraceStageFields st;
+    st.pos_id = pos_id;
+    st.seq_len = seq_len;
+    st.tokens_total = tokens_total;
+    st.token_index = token_index;
+    st.stride_elems = stride_elems;
+    st.ptr = reinterpret_cast<uintptr_t>(base);
+    st.offset_bytes = offset_elems * sizeof(float);
+    TraceInputMeta meta;
+    std::string src_kind, route;
+    if (input_meta) {
+      src_kind = input_meta->src_kind ? input_meta->src_kind : "";
+      route = input_meta->route ? input_meta->route : "";
+      meta.token_index_used = input_meta->token_index_used;
+      meta.offset_bytes = input_meta->offset_bytes;
+      meta.alloc_bytes = input_meta->alloc_bytes;
+      meta.prompt_tokens = input_meta->prompt_tokens;
+      meta.kv_pos = input_meta->kv_pos;
+      meta.decode_step = input_meta->decode_step;
+      meta.token_id = final_token_id;
+    }
+    auto fmt = [enc = trace_encoder(cfg.out_path), rec, st, meta,
+                has_meta = input_meta != nullptr, point = std::string(point),
+                phase = std::string(phase),
+                prompt = std::string(prompt_id ? prompt_id : ""), src_kind,
+                route](const void *data, size_t bytes,
+                       std::string &out) mutable {
+      const float *host = static_cast<const float *>(data);
+      const size_t n = bytes / sizeof(float);
+      const F32Stats stats = stats_f32(host, n);
+      rec.point = enc->intern(point.c_str(), out);
+      rec.phase = enc->intern(phase.c_str(), out);
+      rec.prompt = enc->intern(prompt.c_str(), out);
+      rec.n = rec.payload_n = static_cast<uint32_t>(n);
+      rec.hash = hash_f32(host, n);
+      rec.min = stats.min;
+      rec.max = stats.max;
+      rec.mean = stats.mean;
+      rec.nan = static_cast<uint32_t>(stats.nan);
+      rec.inf = static_cast<uint32_t>(stats.inf);
+      st.abs_sum = stats.abs_sum;
+      st.nz_count = static_cast<uint32_t>(stats.nz_count);
+      if (has_meta) {
+        meta.src_kind = enc->intern(src_kind.c_str(), out);
+        meta.route = enc->intern(route.c_str(), out);
+      }
+      enc->tensor(rec, &st, has_meta ? &meta : nullptr, host, out);
+    };
+    trace_writer().capture(cfg.out_path, ptr, sample_n * sizeof(float),
+                           stream, std::move(fmt), nullptr);
+    return;
+  }
+
+  // Everything the record needs is copied now; the sample is copied in
+  // stream order and the line is formatted on the trace writer thread.
+  std::ostringstream head;
+  head << "{\"event\":\"stage_trace\"";
+  if (prompt_id && *prompt_id)
+    head << ",\"prompt_id\":\"" << prompt_id << "\"";
+  head << ",\"phase\":\"" << phase << "\""
+       << ",\"point\":\"" << point << "\""
+       << ",\"layer\":" << layer << ",\"step\":" << step
+       << ",\"pos_id\":" << pos_id << ",\"seq_len\":" << seq_len
+       << ",\"tokens_total\":" << tokens_total
+       << ",\"token_index\":" << token_index
+       << ",\"stride_elems\":" << stride_elems << ",\"sample_n\":" << sample_n
+       << ",\"ptr\":" << reinterpret_cast<uintptr_t>(base)
+       << ",\"offset_bytes\":" << (offset_elems * sizeof(float));
+  std::ostringstream tail;
   if (input_meta) {
     const char *kind = input_meta->src_kind ? input_meta->src_kind : "";
-    oss << ",\"src_kind\":\"" << kind << "\""
-        << ",\"token_index_used\":" << input_meta->token_index_used
-        << ",\"offset_bytes\":" << input_meta->offset_bytes
-        << ",\"alloc_bytes\":" << input_meta->alloc_bytes
-        << ",\"prompt_tokens\":" << input_meta->prompt_tokens
-        << ",\"kv_pos\":" << input_meta->kv_pos
-        << ",\"decode_step\":" << input_meta->decode_step
-        << ",\"token_id\":" << final_token_id << ",\"route\":\""
-        << (input_meta->route ? input_meta->route : "") << "\"";
+    tail << ",\"src_kind\":\"" << kind << "\""
+         << ",\"token_index_used\":" << input_meta->token_index_used
+         << ",\"offset_bytes\":" << input_meta->offset_bytes
+         << ",\"alloc_bytes\":" << input_meta->alloc_bytes
+         << ",\"prompt_tokens\":" << input_meta->prompt_tokens
+         << ",\"kv_pos\":" << input_meta->kv_pos
+         << ",\"decode_step\":" << input_meta->decode_step
+         << ",\"token_id\":" << final_token_id << ",\"route\":\""
+         << (input_meta->route ? input_meta->route : "") << "\"";
   }
+  tail << "}\n";
 
-  oss << "}";
-  append_line(cfg.out_path, oss.str());
+  auto fmt = [head = head.str(), tail = tail.str()](
+                 const void *data, size_t bytes, std::string &out) {
+    const float *host = static_cast<const float *>(data);
+    const size_t n = bytes / sizeof(float);
+    const F32Stats stats = stats_f32(host, n);
+    const uint64_t hash = hash_f32(host, n);
+    std::ostringstream oss;
+    oss << head << ",\"hash\":" << hash << ",\"min\":" << stats.min
+        << ",\"max\":" << stats.max << ",\"mean\":" << stats.mean
+        << ",\"abs_sum\":" << stats.abs_sum << ",\"nan\":" << stats.nan
+        << ",\"inf\":" << stats.inf << ",\"nz_count\":" << stats.nz_count
+        << ",\"sample\":[";
+    for (size_t i = 0; i < n; ++i) {
+      if (i)
+        oss << ",";
+      oss << host[i];
+    }
+    oss << "]" << tail;
+    out += oss.str();
+  };
+  trace_writer().capture(cfg.out_path, ptr, sample_n * sizeof(float), stream,
+                         std::move(fmt), nullptr);
 }
 
 void stage_trace_logits(const char *phase, const char *prompt_id, uint32_t step,
                         uint32_t pos_id, uint32_t seq_len,
                         uint32_t tokens_total, const StageLogitsStats &stats) {
-  const auto cfg = stage_trace_config();
+  const auto &cfg = stage_trace_config();
   if (!cfg.enabled || !cfg.out_path || !*cfg.out_path || !phase)
     return;
   if (!stage_trace_phase_enabled(phase))
@@ -288,6 +405,37 @@ void stage_trace_logits(const char *phase, const char *prompt_id, uint32_t step,
   if (!stage_trace_point_enabled("logits"))
     return;
 
+  if (trace_binary_path(cfg.out_path)) {
+    TraceLogitsRecord rec;
+    rec.step = step;
+    rec.pos_id = pos_id;
+    rec.seq_len = seq_len;
+    rec.tokens_total = tokens_total;
+    rec.top1_id = stats.top1_id;
+    rec.top2_id = stats.top2_id;
+    rec.hash = stats.hash;
+    rec.vocab = stats.vocab;
+    rec.logits_ptr = stats.logits_ptr;
+    rec.logits_offset_bytes = stats.logits_offset_bytes;
+    rec.min = stats.min;
+    rec.max = stats.max;
+    rec.mean = stats.mean;
+    rec.top1_logit = stats.top1_logit;
+    rec.top2_logit = stats.top2_logit;
+    rec.gap = stats.gap;
+    trace_writer().capture(
+        cfg.out_path, nullptr, 0, nullptr,
+        [enc = trace_encoder(cfg.out_path), rec, phase = std::string(phase),
+         prompt = std::string(prompt_id ? prompt_id : "")](
+            const void *, size_t, std::string &out) mutable {
+          rec.phase = enc->intern(phase.c_str(), out);
+          rec.prompt = enc->intern(prompt.c_str(), out);
+          enc->logits(rec, out);
+        },
+        nullptr);
+    return;
+  }
+
   std::ostringstream oss;
   oss << "{\"event\":\"stage_logits\"";
   if (prompt_id && *prompt_id)
@@ -305,7 +453,7 @@ void stage_trace_logits(const char *phase, const char *prompt_id, uint32_t step,
       << ",\"top2_logit\":" << stats.top2_logit << ",\"gap\":" << stats.gap
       << ",\"vocab\":" << stats.vocab << ",\"logits_ptr\":" << stats.logits_ptr
       << ",\"logits_offset_bytes\":" << stats.logits_offset_bytes << "}";
-  append_line(cfg.out_path, oss.str());
+  trace_append_line(cfg.out_path, oss.str());
 }
 
 } // namespace gcore::inference
@@ -0,0 +1,341 @@
+#include "gcore/inference/trace_format.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+namespace gcore::inference {
+
+// Larger chunks are treated as corruption rather than allocated.
+static constexpr uint32_t kMaxChunkBytes = 1u << 30;
+
+uint32_t TraceEncoder::intern(const char *s, std::string &out) {
+  if (!s || !*s)
+    return 0;
+  auto it = ids_.find(s);
+  if (it != ids_.end())
+    return it->second;
+  const uint32_t id = static_cast<uint32_t>(ids_.size() + 1);
+  ids_.emplace(s, id);
+  const size_t len = std::strlen(s);
+  begin(TraceChunk::String, sizeof(id) + len, out);
+  out.append(reinterpret_cast<const char *>(&id), sizeof(id));
+  out.append(s, len);
+  return id;
+}
+
+template <typename T> static void append_pod(const T &v, std::string &out) {
+  out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+void TraceEncoder::tensor(const TraceTensorRecord &r,
+                          const TraceStageFields *stage,
+                          const TraceInputMeta *meta, const float *payload,
+                          std::string &out) {
+  TraceTensorRecord rec = r;
+  rec.flags = (stage ? kTraceStageFields : 0) | (meta ? kTraceInputMeta : 0);
+  if (!payload)
+    rec.payload_n = 0;
+  const size_t payload_bytes = size_t(rec.payload_n) * sizeof(float);
+  begin(TraceChunk::Tensor,
+        sizeof(rec) + (stage ? sizeof(*stage) : 0) +
+            (meta ? sizeof(*meta) : 0) + payload_bytes,
+        out);
+  append_pod(rec, out);
+  if (stage)
+    append_pod(*stage, out);
+  if (meta)
+    append_pod(*meta, out);
+  if (payload_bytes)
+    out.append(reinterpret_cast<const char *>(payload), payload_bytes);
+}
+
+void TraceEncoder::logits(const TraceLogitsRecord &r, std::string &out) {
+  begin(TraceChunk::Logits, sizeof(r), out);
+  append_pod(r, out);
+}
+
+void TraceEncoder::step(const TraceStepRecord &r, std::string &out) {
+  begin(TraceChunk::Step, sizeof(r), out);
+  append_pod(r, out);
+}
+
+void TraceEncoder::json(const std::string &line, std::string &out) {
+  begin(TraceChunk::Json, line.size(), out);
+  out.append(line);
+}
+
+void TraceEncoder::reset() {
+  started_ = false;
+  ids_.clear();
+}
+
+void TraceEncoder::begin(TraceChunk type, size_t bytes, std::string &out) {
+  if (!started_) {
+    started_ = true;
+    append_pod(TraceChunkHeader{static_cast<uint32_t>(TraceChunk::Header),
+                                sizeof(TraceFileHeader)},
+               out);
+    append_pod(TraceFileHeader{}, out);
+  }
+  append_pod(TraceChunkHeader{static_cast<uint32_t>(type),
+                              static_cast<uint32_t>(bytes)},
+             out);
+}
+
+TraceReader::~TraceReader() { close(); }
+
+bool TraceReader::open(const std::string &path, std::string *err) {
+  close();
+  FILE *f = std::fopen(path.c_str(), "rb");
+  if (!f) {
+    if (err)
+      *err = "Failed to open trace: " + path;
+    return false;
+  }
+  std::setvbuf(f, nullptr, _IOFBF, 1 << 20);
+  file_ = f;
+  path_ = path;
+  return true;
+}
+
+void TraceReader::close() {
+  if (file_)
+    std::fclose(static_cast<FILE *>(file_));
+  file_ = nullptr;
+  offset_ = 0;
+  sessions_ = 0;
+  strings_.clear();
+}
+
+bool TraceReader::read(void *dst, size_t bytes) {
+  if (bytes == 0)
+    return true;
+  const size_t got = std::fread(dst, 1, bytes, static_cast<FILE *>(file_));
+  offset_ += got;
+  return got == bytes;
+}
+
+// Records are fixed-size per format version; bytes past them are ignored.
+template <typename T>
+static bool take(const std::vector<char> &chunk, size_t *pos, T *dst) {
+  if (chunk.size() < *pos + sizeof(T))
+    return false;
+  std::memcpy(dst, chunk.data() + *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
+bool TraceReader::next(TraceEvent *ev, std::string *err) {
+  if (err)
+    err->clear();
+  if (!file_) {
+    if (err)
+      *err = "Trace not open";
+    return false;
+  }
+  for (;;) {
+    const uint64_t at = offset_;
+    TraceChunkHeader h;
+    const size_t got =
+        std::fread(&h, 1, sizeof(h), static_cast<FILE *>(file_));
+    offset_ += got;
+    if (got == 0)
+      return false; // Clean end of file
+    auto fail = [&](const char *what) {
+      if (err)
+        *err = path_ + ": " + what + " at offset " + std::to_string(at);
+      return false;
+    };
+    if (got != sizeof(h))
+      return fail("truncated chunk header");
+    if (h.bytes > kMaxChunkBytes)
+      return fail("oversized chunk");
+    scratch_.resize(h.bytes);
+    if (!read(scratch_.data(), h.bytes))
+      return fail("truncated chunk");
+
+    switch (static_cast<TraceChunk>(h.type)) {
+    case TraceChunk::Header: {
+      TraceFileHeader fh;
+      if (h.bytes < sizeof(fh))
+        return fail("short header");
+      std::memcpy(&fh, scratch_.data(), sizeof(fh));
+      if (std::memcmp(fh.magic, TraceFileHeader{}.magic, 4) != 0)
+        return fail("bad magic");
+      if (fh.version != TraceFileHeader{}.version)
+        return fail("unsupported version");
+      ++sessions_;
+      strings_.clear();
+      continue;
+    }
+    case TraceChunk::String: {
+      uint32_t id;
+      if (h.bytes < sizeof(id))
+        return fail("short string");
+      std::memcpy(&id, scratch_.data(), sizeof(id));
+      if (id == 0 || id > strings_.size() + 1)
+        return fail("string id out of order");
+      strings_.resize(id);
+      strings_[id - 1].assign(scratch_.data() + sizeof(id),
+                              h.bytes - sizeof(id));
+      continue;
+    }
+    default:
+      break;
+    }
+    if (sessions_ == 0)
+      return fail("record before header");
+
+    size_t pos = 0;
+    switch (static_cast<TraceChunk>(h.type)) {
+    case TraceChunk::Tensor: {
+      if (!take(scratch_, &pos, &ev->tensor))
+        return fail("short tensor record");
+      ev->stage = TraceStageFields{};
+      ev->meta = TraceInputMeta{};
+      if ((ev->tensor.flags & kTraceStageFields) &&
+          !take(scratch_, &pos, &ev->stage))
+        return fail("short tensor record");
+      if ((ev->tensor.flags & kTraceInputMeta) &&
+          !take(scratch_, &pos, &ev->meta))
+        return fail("short tensor record");
+      const size_t payload_bytes =
+          static_cast<size_t>(ev->tensor.payload_n) * sizeof(float);
+      if (h.bytes < pos + payload_bytes)
+        return fail("short tensor payload");
+      ev->payload.resize(ev->tensor.payload_n);
+      if (payload_bytes)
+        std::memcpy(ev->payload.data(),
+                    scratch_.data() + (h.bytes - payload_bytes),
+                    payload_bytes);
+      break;
+    }
+    case TraceChunk::Logits:
+      if (!take(scratch_, &pos, &ev->logits))
+        return fail("short logits record");
+      break;
+    case TraceChunk::Step:
+      if (!take(scratch_, &pos, &ev->step))
+        return fail("short step record");
+      break;
+    case TraceChunk::Json:
+      ev->json.assign(scratch_.data(), scratch_.size());
+      break;
+    default:
+      continue; // Newer chunk type
+    }
+    ev->type = static_cast<TraceChunk>(h.type);
+    return true;
+  }
+}
+
+const char *TraceReader::str(uint32_t id) const {
+  if (id == 0 || id > strings_.size())
+    return "";
+  return strings_[id - 1].c_str();
+}
+
+// Field order and number formatting follow the JSONL writers in
+// stage_trace.cpp and layer_trace.cpp.
+static void stage_tensor_json(std::ostringstream &oss, const TraceReader &rd,
+                              const TraceEvent &ev) {
+  const TraceTensorRecord &r = ev.tensor;
+  const TraceStageFields &st = ev.stage;
+  oss << "{\"event\":\"stage_trace\"";
+  if (r.prompt)
+    oss << ",\"prompt_id\":\"" << rd.str(r.prompt) << "\"";
+  oss << ",\"phase\":\"" << rd.str(r.phase) << "\""
+      << ",\"point\":\"" << rd.str(r.point) << "\""
+      << ",\"layer\":" << r.layer << ",\"step\":" << r.step
+      << ",\"pos_id\":" << st.pos_id << ",\"seq_len\":" << st.seq_len
+      << ",\"tokens_total\":" << st.tokens_total
+      << ",\"token_index\":" << st.token_index
+      << ",\"stride_elems\":" << st.stride_elems << ",\"sample_n\":" << r.n
+      << ",\"ptr\":" << st.ptr << ",\"offset_bytes\":" << st.offset_bytes
+      << ",\"hash\":" << r.hash << ",\"min\":" << r.min
+      << ",\"max\":" << r.max << ",\"mean\":" << r.mean
+      << ",\"abs_sum\":" << st.abs_sum << ",\"nan\":" << r.nan
+      << ",\"inf\":" << r.inf << ",\"nz_count\":" << st.nz_count
+      << ",\"sample\":[";
+  for (size_t i = 0; i < ev.payload.size(); ++i) {
+    if (i)
+      oss << ",";
+    oss << ev.payload[i];
+  }
+  oss << "]";
+  if (r.flags & kTraceInputMeta) {
+    const TraceInputMeta &m = ev.meta;
+    oss << ",\"src_kind\":\"" << rd.str(m.src_kind) << "\""
+        << ",\"token_index_used\":" << m.token_index_used
+        << ",\"offset_bytes\":" << m.offset_bytes
+        << ",\"alloc_bytes\":" << m.alloc_bytes
+        << ",\"prompt_tokens\":" << m.prompt_tokens
+        << ",\"kv_pos\":" << m.kv_pos << ",\"decode_step\":" << m.decode_step
+        << ",\"token_id\":" << m.token_id << ",\"route\":\""
+        << rd.str(m.route) << "\"";
+  }
+  oss << "}";
+}
+
+static void layer_tensor_json(std::ostringstream &oss, const TraceReader &rd,
+                              const TraceEvent &ev) {
+  const TraceTensorRecord &r = ev.tensor;
+  oss << "{\"step\":" << r.step << ",\"layer\":" << r.layer
+      << ",\"tag\":\"" << rd.str(r.point) << "\""
+      << ",\"n\":" << r.n << ",\"hash\":" << r.hash << ",\"min\":" << r.min
+      << ",\"max\":" << r.max << ",\"mean\":" << r.mean
+      << ",\"nan\":" << r.nan << ",\"inf\":" << r.inf << "}";
+}
+
+std::string trace_event_json(const TraceReader &rd, const TraceEvent &ev) {
+  std::ostringstream oss;
+  switch (ev.type) {
+  case TraceChunk::Tensor:
+    if (ev.tensor.source == static_cast<uint32_t>(TraceSource::Layer))
+      layer_tensor_json(oss, rd, ev);
+    else
+      stage_tensor_json(oss, rd, ev);
+    break;
+  case TraceChunk::Logits: {
+    const TraceLogitsRecord &r = ev.logits;
+    oss << "{\"event\":\"stage_logits\"";
+    if (r.prompt)
+      oss << ",\"prompt_id\":\"" << rd.str(r.prompt) << "\"";
+    oss << ",\"phase\":\"" << rd.str(r.phase) << "\""
+        << ",\"point\":\"logits\""
+        << ",\"layer\":-1"
+        << ",\"step\":" << r.step << ",\"pos_id\":" << r.pos_id
+        << ",\"seq_len\":" << r.seq_len
+        << ",\"tokens_total\":" << r.tokens_total
+        << ",\"hash\":" << r.hash << ",\"min\":" << r.min
+        << ",\"max\":" << r.max << ",\"mean\":" << r.mean
+        << ",\"top1_id\":" << r.top1_id << ",\"top1_logit\":" << r.top1_logit
+        << ",\"top2_id\":" << r.top2_id << ",\"top2_logit\":" << r.top2_logit
+        << ",\"gap\":" << r.gap << ",\"vocab\":" << r.vocab
+        << ",\"logits_ptr\":" << r.logits_ptr
+        << ",\"logits_offset_bytes\":" << r.logits_offset_bytes << "}";
+    break;
+  }
+  case TraceChunk::Step: {
+    const TraceStepRecord &r = ev.step;
+    oss << "{\"type\":\"step_header\""
+        << ",\"step\":" << r.step << ",\"pos_id\":" << r.pos_id
+        << ",\"seq_len\":" << r.seq_len
+        << ",\"tokens_total\":" << r.tokens_total
+        << ",\"token_in\":" << r.token_in << ",\"token_out\":" << r.token_out
+        << ",\"dim\":" << r.dim << ",\"heads\":" << r.heads
+        << ",\"head_dim\":" << r.head_dim << ",\"layers\":\""
+        << rd.str(r.layers) << "\""
+        << ",\"points\":\"" << rd.str(r.points) << "\""
+        << "}";
+    break;
+  }
+  default:
+    return ev.json;
+  }
+  return oss.str();
+}
+
+} // namespace gcore::inference
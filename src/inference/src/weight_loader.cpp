@@ -1,4 +1,6 @@
 #include "gcore/inference/weight_loader.hpp"
+#include "gcore/rt/hip/staging.hpp"
+#include "gcore/rt/profiler.hpp"
 
 #include <cmath>
 #include <cstring>
@@ -507,6 +509,7 @@ struct GGUFLoader::Impl {
 GGUFLoader::GGUFLoader() : impl_(std::make_unique<Impl>()) {}
 GGUFLoader::~GGUFLoader() = default;
 bool GGUFLoader::open(const std::string &path, std::string *err) {
+  gcore::rt::ProfileSpan span("loader", "gguf_open");
   impl_->path = path;
   impl_->file.open(path, std::ios::binary);
   if (!impl_->file.is_open())
@@ -567,7 +570,7 @@ bool GGUFLoader::load_tensor(const std::string &name,
   if (!buffer.allocate(ups, gcore::rt::hip::BufferUsage::DeviceOnly,
                        gcore::rt::GretaDataType::FP32, err))
     return false;
-  return buffer.copy_to_device(up, ups, err);
+  return rt::hip::upload_staged(buffer, up, ups, err);
 }
 
 bool GGUFLoader::load_tensor_fp16(const std::string &name,
@@ -662,7 +665,7 @@ bool GGUFLoader::load_tensor_fp16(const std::string &name,
   if (!buffer.allocate(ups, gcore::rt::hip::BufferUsage::DeviceOnly,
                        gcore::rt::GretaDataType::FP16, err))
     return false;
-  return buffer.copy_to_device(fp16.data(), ups, err);
+  return rt::hip::upload_staged(buffer, fp16.data(), ups, err);
 }
 
 bool GGUFLoader::load_tensor_int8(const std::string &name,
@@ -809,9 +812,10 @@ bool GGUFLoader::load_tensor_int8(const std::string &name,
                        rt::GretaDataType::FP32, err))
     return false;
 
-  if (!buffer.copy_to_device(weights.data(), n_elem, err))
+  if (!rt::hip::upload_staged(buffer, weights.data(), n_elem, err))
     return false;
-  if (!scales.copy_to_device(scale_data.data(), scale_data.size() * 4, err))
+  if (!rt::hip::upload_staged(scales, scale_data.data(),
+                              scale_data.size() * 4, err))
     return false;
 
   gcore::rt::GretaQuantInfo qinfo;
@@ -964,9 +968,11 @@ bool GGUFLoader::load_tensor_int4(const std::string &name,
                        rt::GretaDataType::FP32, err))
     return false;
 
-  if (!buffer.copy_to_device(packed_weights.data(), packed_weights.size(), err))
+  if (!rt::hip::upload_staged(buffer, packed_weights.data(),
+                              packed_weights.size(), err))
     return false;
-  if (!scales.copy_to_device(scale_data.data(), scale_data.size() * 4, err))
+  if (!rt::hip::upload_staged(scales, scale_data.data(),
+                              scale_data.size() * 4, err))
     return false;
 
   // 4. Per-head Scaling (Phase 5.3)
@@ -993,7 +999,8 @@ bool GGUFLoader::load_tensor_int4(const std::string &name,
     if (!head_scales.allocate(num_heads * 4, rt::hip::BufferUsage::DeviceOnly,
                               rt::GretaDataType::FP32, err))
       return false;
-    if (!head_scales.copy_to_device(h_scales.data(), num_heads * 4, err))
+    if (!rt::hip::upload_staged(head_scales, h_scales.data(), num_heads * 4,
+                                err))
       return false;
   }
 
@@ -0,0 +1,55 @@
+#include "gcore/inference/activation_planner.hpp"
+#include "gcore/inference/model_config.hpp"
+
+#include <iostream>
+
+using gcore::inference::ActivationPlan;
+
+static bool overlaps(const ActivationPlan &plan, size_t a, size_t b) {
+  const auto &ta = plan.tensors[a];
+  const auto &tb = plan.tensors[b];
+  bool live = false;
+  for (const auto &ia : ta.intervals)
+    for (const auto &ib : tb.intervals)
+      live |= (ia.first <= ib.second && ib.first <= ia.second);
+  if (!live)
+    return false;
+  return ta.offset < tb.offset + tb.bytes && tb.offset < ta.offset + ta.bytes;
+}
+
+int main() {
+  std::cout << "GRETA CORE: Activation Planner Test\n";
+
+  auto cfg = gcore::inference::ModelConfig::llama2_7b();
+  const size_t batch = 1, seq = 2048;
+  ActivationPlan plan =
+      gcore::inference::plan_layer_activations(cfg, batch, seq);
+  std::cout << plan.report();
+
+  // No two simultaneously live tensors may share bytes.
+  for (size_t a = 0; a < plan.tensors.size(); ++a) {
+    for (size_t b = a + 1; b < plan.tensors.size(); ++b) {
+      if (overlaps(plan, a, b)) {
+        std::cerr << "Overlap: " << plan.tensors[a].name << " / "
+                  << plan.tensors[b].name << "\n";
+        return 1;
+      }
+    }
+  }
+
+  if (plan.arena_bytes < plan.live_peak_bytes ||
+      plan.arena_bytes >= plan.separate_bytes) {
+    std::cerr << "Unexpected arena size: " << plan.arena_bytes << "\n";
+    return 1;
+  }
+
+  // x is the residual stream and must stay live for the whole sequence.
+  const auto &x = plan.tensors[plan.find("x")];
+  if (x.intervals.size() != 1 || x.intervals[0].first != 0) {
+    std::cerr << "x is not live across the layer\n";
+    return 1;
+  }
+
+  std::cout << "\nSTATUS=OK\n";
+  return 0;
+}
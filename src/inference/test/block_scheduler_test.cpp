@@ -1,50 +1,397 @@
 #include "gcore/inference/block_scheduler.hpp"
 #include "gcore/inference/model_config.hpp"
+#include "gcore/inference/weight_loader.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 
-int main() {
-  std::cout << "GRETA CORE: Block Scheduler Test\n";
+using namespace gcore::inference;
+
+static int g_failures = 0;
+
+static void check(bool cond, const std::string &what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+// Small Llama-shaped model: every kernel path of the 7B model, at a size
+// that loads in milliseconds.
+static ModelConfig tiny_config() {
+  ModelConfig cfg;
+  cfg.dim = 256;
+  cfg.num_heads = 2;
+  cfg.num_heads_kv = 2;
+  cfg.num_layers = 2;
+  cfg.vocab_size = 512;
+  cfg.hidden_dim = 512;
+  cfg.head_dim = 128;
+  cfg.max_seq_len = 32;
+  return cfg;
+}
+
+static uint16_t float_to_half(float f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  const uint32_t sign = (x >> 16) & 0x8000u;
+  const int32_t exp = static_cast<int32_t>((x >> 23) & 0xff) - 127 + 15;
+  const uint32_t mant = x & 0x7fffffu;
+  if (exp <= 0)
+    return static_cast<uint16_t>(sign); // Flush tiny values to zero
+  return static_cast<uint16_t>(sign | (static_cast<uint32_t>(exp) << 10) |
+                               ((mant + 0x1000u) >> 13));
+}
+
+// Deterministic pseudo-random weights, seeded by tensor name. Norm weights
+// stay near 1 so activations keep a sane scale across layers.
+class SyntheticLoader : public WeightLoader {
+public:
+  bool open(const std::string &, std::string *) override { return true; }
+  std::vector<TensorInfo> list_tensors() const override { return {}; }
+
+  bool load_tensor(const std::string &name, gcore::rt::hip::Buffer &buffer,
+                   std::string *err) override {
+    std::vector<float> host(buffer.size() / sizeof(float));
+    const bool norm = name.find("norm") != std::string::npos;
+    uint64_t state = seed(name);
+    for (auto &v : host)
+      v = norm ? 1.0f + 0.1f * next(&state) : next(&state);
+    return buffer.copy_to_device(host.data(), host.size() * sizeof(float),
+                                 err);
+  }
+
+  bool load_tensor_fp16(const std::string &name,
+                        gcore::rt::hip::Buffer &buffer,
+                        std::string *err) override {
+    std::vector<uint16_t> host(buffer.size() / sizeof(uint16_t));
+    uint64_t state = seed(name);
+    for (auto &v : host)
+      v = float_to_half(0.05f * next(&state));
+    return buffer.copy_to_device(host.data(), host.size() * sizeof(uint16_t),
+                                 err);
+  }
+
+  bool load_tensor_int8(const std::string &, gcore::rt::hip::Buffer &,
+                        gcore::rt::hip::Buffer &, std::string *err) override {
+    *err = "SyntheticLoader: INT8 weights not supported";
+    return false;
+  }
+
+  bool load_tensor_int4(const std::string &, gcore::rt::hip::Buffer &,
+                        gcore::rt::hip::Buffer &, gcore::rt::hip::Buffer &,
+                        std::string *err) override {
+    *err = "SyntheticLoader: INT4 weights not supported";
+    return false;
+  }
+
+  ModelConfig get_config() const override { return tiny_config(); }
+
+private:
+  static uint64_t seed(const std::string &name) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : name) {
+      h ^= c;
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+  // Uniform in [-1, 1).
+  static float next(uint64_t *s) {
+    *s = *s * 6364136223846793005ull + 1442695040888963407ull;
+    return static_cast<float>((*s >> 40) & 0xffffff) / 8388608.0f - 1.0f;
+  }
+};
 
-  auto cfg = gcore::inference::ModelConfig::llama2_7b();
+// Llama-2 7B shapes end to end: init, full-size allocations and one
+// forward pass over the (unloaded) weights must succeed.
+static void test_llama2_7b_smoke() {
+  const ModelConfig cfg = ModelConfig::llama2_7b();
   std::cout << "Config: " << cfg.num_layers << " layers, dim=" << cfg.dim
             << "\n";
+  BlockScheduler scheduler;
+  std::string err;
+  if (!scheduler.init(cfg, &err)) {
+    check(false, "7B init: " + err);
+    return;
+  }
+  check(scheduler.num_layers() == cfg.num_layers, "7B layer count");
+  if (!scheduler.allocate_weights(&err)) {
+    check(false, "7B weight allocation: " + err);
+    return;
+  }
+  if (!scheduler.allocate_activations(1, 128, &err)) {
+    check(false, "7B activation allocation (batch=1, seq=128): " + err);
+    return;
+  }
+  const std::vector<int32_t> tokens(10, 1);
+  const bool ok = scheduler.forward(tokens.data(), 0, tokens.size(), &err);
+  check(ok, "7B forward (10 tokens): " + err);
+}
 
-  gcore::inference::BlockScheduler scheduler;
+static bool make_scheduler(BlockScheduler *s, size_t batch, size_t chunk,
+                           std::string *err) {
+  const ModelConfig cfg = tiny_config();
+  SyntheticLoader loader;
+  if (!s->init(cfg, err))
+    return false;
+  s->set_prefill_chunk(chunk);
+  return s->allocate_weights(err) &&
+         s->allocate_activations(batch, cfg.max_seq_len, err) &&
+         s->load_weights(loader, err);
+}
+
+static std::vector<float> last_logits(const BlockScheduler &s,
+                                      std::string *err) {
+  const size_t V = s.config().vocab_size;
+  std::vector<float> out(V);
+  if (!s.get_logits().copy_to_host_offset(out.data(), s.last_logits_offset(),
+                                          V * sizeof(float), err))
+    out.clear();
+  return out;
+}
+
+// Positions [0, n) of every layer and head of KV slot 0.
+static std::vector<float> kv_prefix(const BlockScheduler &s,
+                                    const gcore::rt::hip::Buffer &kv, size_t n,
+                                    std::string *err) {
+  const ModelConfig &c = s.config();
+  const size_t Dh = c.dim / c.num_heads;
+  const size_t rows = c.num_layers * c.num_heads_kv;
+  std::vector<float> all(rows * c.max_seq_len * Dh);
+  if (!kv.copy_to_host(all.data(), all.size() * sizeof(float), err))
+    return {};
+  std::vector<float> out;
+  for (size_t r = 0; r < rows; ++r) {
+    const float *base = all.data() + r * c.max_seq_len * Dh;
+    out.insert(out.end(), base, base + n * Dh);
+  }
+  return out;
+}
+
+// Max |a - b| relative to max |a|. Different chunk sizes pick different GEMM
+// shapes, so results agree to rounding, not bit for bit.
+static double rel_diff(const std::vector<float> &a,
+                       const std::vector<float> &b) {
+  if (a.size() != b.size() || a.empty())
+    return INFINITY;
+  double scale = 1e-6, diff = 0.0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    scale = std::max(scale, static_cast<double>(std::fabs(a[i])));
+    diff = std::max(diff, static_cast<double>(std::fabs(a[i] - b[i])));
+  }
+  return diff / scale;
+}
+
+static constexpr double kTol = 2e-3;
+
+// Chunked prefill must leave the same final logits and KV cache as a single
+// pass, and decode from either must agree. chunk=1 with GRETA_GRAPH=1 also
+// checks the decode graph is not captured from an LM-head-less chunk.
+static void test_chunked_prefill(const std::vector<int32_t> &prompt,
+                                 const std::vector<int32_t> &decode) {
   std::string err;
+  BlockScheduler ref;
+  if (!make_scheduler(&ref, 1, 0, &err) ||
+      !ref.prefill(prompt.data(), prompt.size(), &err)) {
+    check(false, "single-pass prefill: " + err);
+    return;
+  }
+  const std::vector<float> ref_logits = last_logits(ref, &err);
+  const std::vector<float> ref_k =
+      kv_prefix(ref, ref.get_kv_cache_k(), prompt.size(), &err);
+  const std::vector<float> ref_v =
+      kv_prefix(ref, ref.get_kv_cache_v(), prompt.size(), &err);
+  std::vector<std::vector<float>> ref_decode;
+  for (size_t i = 0; i < decode.size(); ++i) {
+    if (!ref.forward(&decode[i], prompt.size() + i, 1, &err)) {
+      check(false, "reference decode: " + err);
+      return;
+    }
+    ref_decode.push_back(last_logits(ref, &err));
+  }
 
-  // Initialize
-  if (!scheduler.init(cfg, &err)) {
-    std::cerr << "Init failed: " << err << "\n";
-    return 1;
+  const struct {
+    size_t chunk;
+    bool graph;
+  } cases[] = {{4, false}, {5, false}, {1, false}, {1, true}};
+  for (const auto &c : cases) {
+    const std::string name = "chunk=" + std::to_string(c.chunk) +
+                             (c.graph ? " graph" : "");
+    if (c.graph)
+      setenv("GRETA_GRAPH", "1", 1);
+    BlockScheduler s;
+    const bool ok = make_scheduler(&s, 1, c.chunk, &err);
+    unsetenv("GRETA_GRAPH");
+    if (!ok || !s.prefill(prompt.data(), prompt.size(), &err)) {
+      check(false, name + " prefill: " + err);
+      continue;
+    }
+    check(rel_diff(ref_logits, last_logits(s, &err)) < kTol,
+          name + ": final prompt logits");
+    check(rel_diff(ref_k, kv_prefix(s, s.get_kv_cache_k(), prompt.size(),
+                                    &err)) < kTol,
+          name + ": K cache");
+    check(rel_diff(ref_v, kv_prefix(s, s.get_kv_cache_v(), prompt.size(),
+                                    &err)) < kTol,
+          name + ": V cache");
+    for (size_t i = 0; i < decode.size(); ++i) {
+      if (!s.forward(&decode[i], prompt.size() + i, 1, &err)) {
+        check(false, name + " decode: " + err);
+        break;
+      }
+      check(rel_diff(ref_decode[i], last_logits(s, &err)) < kTol,
+            name + ": decode step " + std::to_string(i) + " logits");
+    }
   }
-  std::cout << "Initialized scheduler for " << scheduler.num_layers()
-            << " layers\n";
+}
 
-  // Allocate weights
-  std::cout << "Allocating weights...\n";
-  if (!scheduler.allocate_weights(&err)) {
-    std::cerr << "Weight allocation failed: " << err << "\n";
-    return 1;
+// decode_batch() over B rows must match B independent forward() decodes.
+// Rows join at different steps, so each batch mixes KV positions, and slots
+// are assigned in reverse so row order and slot order differ.
+static void test_decode_batch(const std::vector<std::vector<int32_t>> &seqs,
+                              const std::vector<size_t> &join) {
+  std::string err;
+  const size_t B = seqs.size();
+  const size_t V = tiny_config().vocab_size;
+
+  BlockScheduler single;
+  if (!make_scheduler(&single, 1, 0, &err)) {
+    check(false, "single-sequence scheduler: " + err);
+    return;
+  }
+  std::vector<std::vector<std::vector<float>>> ref(B);
+  for (size_t b = 0; b < B; ++b) {
+    for (size_t p = 0; p < seqs[b].size(); ++p) {
+      if (!single.forward(&seqs[b][p], p, 1, &err)) {
+        check(false, "reference forward: " + err);
+        return;
+      }
+      ref[b].push_back(last_logits(single, &err));
+    }
   }
-  std::cout << "Weight buffers allocated\n";
 
-  // Allocate activations for batch=1, seq=128
-  std::cout << "Allocating activations (batch=1, seq=128)...\n";
-  if (!scheduler.allocate_activations(1, 128, &err)) {
-    std::cerr << "Activation allocation failed: " << err << "\n";
-    return 1;
+  BlockScheduler batched;
+  if (!make_scheduler(&batched, B, 0, &err)) {
+    check(false, "batched scheduler: " + err);
+    return;
   }
-  std::cout << "Activation buffers allocated\n";
+  size_t steps = 0;
+  for (size_t b = 0; b < B; ++b)
+    steps = std::max(steps, join[b] + seqs[b].size());
+  for (size_t t = 0; t < steps; ++t) {
+    std::vector<int32_t> tokens;
+    std::vector<uint32_t> positions, slots;
+    std::vector<size_t> rows;
+    for (size_t b = 0; b < B; ++b) {
+      if (t < join[b] || t - join[b] >= seqs[b].size())
+        continue;
+      const size_t p = t - join[b];
+      tokens.push_back(seqs[b][p]);
+      positions.push_back(static_cast<uint32_t>(p));
+      slots.push_back(static_cast<uint32_t>(B - 1 - b));
+      rows.push_back(b);
+    }
+    if (!batched.decode_batch(tokens.data(), positions.data(), slots.data(),
+                              rows.size(), &err)) {
+      check(false, "decode_batch step " + std::to_string(t) + ": " + err);
+      return;
+    }
+    std::vector<float> logits(rows.size() * V);
+    if (!batched.get_logits().copy_to_host(
+            logits.data(), logits.size() * sizeof(float), &err)) {
+      check(false, "decode_batch logits: " + err);
+      return;
+    }
+    for (size_t i = 0; i < rows.size(); ++i) {
+      const std::vector<float> row(logits.begin() + i * V,
+                                   logits.begin() + (i + 1) * V);
+      check(rel_diff(ref[rows[i]][positions[i]], row) < kTol,
+            "decode_batch step " + std::to_string(t) + " row " +
+                std::to_string(i) + " (sequence " + std::to_string(rows[i]) +
+                ", pos " + std::to_string(positions[i]) + ")");
+    }
+  }
+}
 
-  // Execute forward pass (skeleton)
-  std::cout << "Executing forward pass...\n";
-  if (!scheduler.forward(0, 10, &err)) {
-    std::cerr << "Forward pass failed: " << err << "\n";
-    return 1;
+// A prompt prefilled into slot 1 and continued with decode_batch() must match
+// slot 0 driven by forward(); rows sharing a slot are rejected.
+static void test_prefill_slot(const std::vector<int32_t> &prompt,
+                              const std::vector<int32_t> &decode) {
+  std::string err;
+  const size_t V = tiny_config().vocab_size;
+  BlockScheduler ref;
+  if (!make_scheduler(&ref, 1, 0, &err) ||
+      !ref.prefill(prompt.data(), prompt.size(), &err)) {
+    check(false, "slot 0 prefill: " + err);
+    return;
+  }
+  std::vector<std::vector<float>> ref_logits{last_logits(ref, &err)};
+  for (size_t i = 0; i < decode.size(); ++i) {
+    if (!ref.forward(&decode[i], prompt.size() + i, 1, &err)) {
+      check(false, "slot 0 decode: " + err);
+      return;
+    }
+    ref_logits.push_back(last_logits(ref, &err));
   }
-  std::cout << "Forward pass completed (skeleton)\n";
 
-  std::cout << "\nSTATUS=OK\n";
+  BlockScheduler s;
+  if (!make_scheduler(&s, 2, 0, &err) ||
+      !s.prefill(prompt.data(), prompt.size(), &err, 1)) {
+    check(false, "slot 1 prefill: " + err);
+    return;
+  }
+  check(rel_diff(ref_logits[0], last_logits(s, &err)) < kTol,
+        "slot 1 prefill logits");
+  check(!s.forward(prompt.data(), 0, 1, &err, 2), "slot out of range");
+  for (size_t i = 0; i < decode.size(); ++i) {
+    const uint32_t pos = static_cast<uint32_t>(prompt.size() + i);
+    const uint32_t slot = 1;
+    if (!s.decode_batch(&decode[i], &pos, &slot, 1, &err)) {
+      check(false, "slot 1 decode_batch: " + err);
+      return;
+    }
+    std::vector<float> row(V);
+    if (!s.get_logits().copy_to_host_offset(row.data(), s.logits_offset(0),
+                                            V * sizeof(float), &err)) {
+      check(false, "slot 1 logits: " + err);
+      return;
+    }
+    check(rel_diff(ref_logits[i + 1], row) < kTol,
+          "slot 1 decode step " + std::to_string(i) + " logits");
+  }
+
+  const int32_t toks[2] = {decode[0], decode[1]};
+  const uint32_t pos[2] = {0, 1};
+  const uint32_t same[2] = {1, 1};
+  check(!s.decode_batch(toks, pos, same, 2, &err), "duplicate slots rejected");
+}
+
+int main() {
+  std::cout << "GRETA CORE: Block Scheduler Test\n";
+
+  test_llama2_7b_smoke();
+
+  const std::vector<int32_t> prompt = {1,  17, 300, 42, 7,  511, 128,
+                                       64, 3,  250, 99, 12, 400};
+  const std::vector<int32_t> decode = {5, 200, 77};
+  test_chunked_prefill(prompt, decode);
+  test_decode_batch({{1, 17, 300, 42, 7, 511},
+                     {64, 3, 250, 99},
+                     {400, 12, 5, 200, 77, 8, 9}},
+                    {0, 2, 1});
+  test_prefill_slot(prompt, decode);
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
   return 0;
 }
@@ -0,0 +1,552 @@
+#include "gcore/inference/drift_monitor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace gcore::inference;
+using gcore::rt::CpuStagingBackend;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+static bool contains(const std::string &hay, const std::string &needle) {
+  return hay.find(needle) != std::string::npos;
+}
+
+static std::string read_file(const std::string &path) {
+  std::ifstream f(path);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+static const DriftOpStats *find_op(const DriftReport &r, const char *op) {
+  for (const auto &s : r.ops)
+    if (s.op == op)
+      return &s;
+  return nullptr;
+}
+
+// Small GQA layer: 4 query heads share 2 KV heads.
+constexpr uint32_t kDim = 16, kHeads = 4, kKvHeads = 2, kHeadDim = 4;
+constexpr uint32_t kHidden = 24, kMaxSeq = 8, kPos = 5, kGroup = 8;
+constexpr float kEps = 1e-5f, kRopeBase = 10000.0f;
+
+static DriftShape test_shape() {
+  DriftShape s;
+  s.dim = kDim;
+  s.heads = kHeads;
+  s.kv_heads = kKvHeads;
+  s.head_dim = kHeadDim;
+  s.hidden = kHidden;
+  s.rms_eps = kEps;
+  s.rope_base = kRopeBase;
+  return s;
+}
+
+// A weight in storage form plus its dequantized [n, k] values, decoded here
+// independently of DriftWeight.
+struct TestWeight {
+  DriftWeight w;
+  std::vector<float> dense;
+};
+
+static TestWeight make_weight(DriftDType type, uint32_t n, uint32_t k,
+                              bool head_scales, std::mt19937 &rng) {
+  TestWeight t;
+  t.w.type = type;
+  t.w.n = n;
+  t.w.k = k;
+  const size_t count = static_cast<size_t>(n) * k;
+  std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+  std::uniform_int_distribution<int> bits(0, 1 << 16);
+  t.dense.resize(count);
+  switch (type) {
+  case DriftDType::F32:
+    t.w.raw.resize(count * 4);
+    for (size_t i = 0; i < count; ++i) {
+      t.dense[i] = uni(rng) * 0.5f;
+      std::memcpy(t.w.raw.data() + i * 4, &t.dense[i], 4);
+    }
+    break;
+  case DriftDType::F16:
+    // Normal halves in [2^-5, 2).
+    t.w.raw.resize(count * 2);
+    for (size_t i = 0; i < count; ++i) {
+      const int r = bits(rng);
+      const uint32_t sign = r & 1, exp = 10 + (r >> 1) % 6,
+                     mant = (r >> 4) & 0x3ff;
+      const uint16_t h =
+          static_cast<uint16_t>((sign << 15) | (exp << 10) | mant);
+      std::memcpy(t.w.raw.data() + i * 2, &h, 2);
+      t.dense[i] = (sign ? -1.0f : 1.0f) * (1.0f + mant / 1024.0f) *
+                   std::ldexp(1.0f, static_cast<int>(exp) - 15);
+    }
+    break;
+  case DriftDType::INT8:
+  case DriftDType::INT4: {
+    const bool int4 = type == DriftDType::INT4;
+    t.w.group_size = kGroup;
+    t.w.scales.resize((count + kGroup - 1) / kGroup);
+    for (auto &s : t.w.scales)
+      s = 0.01f + 0.05f * (uni(rng) + 1.0f);
+    t.w.raw.assign(int4 ? (count + 1) / 2 : count, 0);
+    std::uniform_int_distribution<int> q(int4 ? -8 : -127, int4 ? 7 : 127);
+    for (size_t i = 0; i < count; ++i) {
+      const int v = q(rng);
+      if (int4)
+        t.w.raw[i / 2] |= static_cast<uint8_t>((v & 0x0f) << (i % 2 ? 4 : 0));
+      else
+        t.w.raw[i] = static_cast<uint8_t>(static_cast<int8_t>(v));
+      t.dense[i] = v * t.w.scales[i / kGroup];
+    }
+    break;
+  }
+  }
+  if (head_scales) {
+    t.w.head_dim = kHeadDim;
+    for (uint32_t h = 0; h < n / kHeadDim; ++h)
+      t.w.head_scales.push_back(0.5f + 0.25f * h);
+  }
+  return t;
+}
+
+static std::vector<float> gemv(const TestWeight &t,
+                               const std::vector<float> &x) {
+  std::vector<float> y(t.w.n, 0.0f);
+  for (uint32_t r = 0; r < t.w.n; ++r) {
+    float acc = 0.0f;
+    for (uint32_t c = 0; c < t.w.k; ++c)
+      acc += x[c] * t.dense[static_cast<size_t>(r) * t.w.k + c];
+    if (!t.w.head_scales.empty())
+      acc *= t.w.head_scales[r / kHeadDim];
+    y[r] = acc;
+  }
+  return y;
+}
+
+static std::vector<float> rmsnorm(const std::vector<float> &x,
+                                  const std::vector<float> &w) {
+  float ss = 0.0f;
+  for (float v : x)
+    ss += v * v;
+  const float inv = 1.0f / std::sqrt(ss / x.size() + kEps);
+  std::vector<float> y(x.size());
+  for (size_t i = 0; i < x.size(); ++i)
+    y[i] = x[i] * inv * w[i];
+  return y;
+}
+
+static std::vector<float> rope(std::vector<float> x, uint32_t heads) {
+  const uint32_t half = kHeadDim / 2;
+  for (uint32_t h = 0; h < heads; ++h) {
+    float *p = x.data() + h * kHeadDim;
+    for (uint32_t i = 0; i < half; ++i) {
+      const float theta =
+          kPos * std::pow(kRopeBase, -2.0f * i / static_cast<float>(kHeadDim));
+      const float v0 = p[i], v1 = p[i + half];
+      p[i] = v0 * std::cos(theta) - v1 * std::sin(theta);
+      p[i + half] = v0 * std::sin(theta) + v1 * std::cos(theta);
+    }
+  }
+  return x;
+}
+
+static std::vector<float> add(const std::vector<float> &a,
+                              const std::vector<float> &b) {
+  std::vector<float> y(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+    y[i] = a[i] + b[i];
+  return y;
+}
+
+// "Device" side of one decode layer, in plain float.
+struct TestLayer {
+  DriftLayerWeights weights;
+  TestWeight wq, wk, wv, wo, w1, w2, w3;
+  std::vector<float> x_in, attn_norm, q, k, v, q_rope, k_rope;
+  std::vector<float> cache_k, cache_v; // [kv_heads, max_seq, head_dim]
+  std::vector<float> attn_out, wo_out, x_attn, ffn_norm, gate, up, gate_act;
+  std::vector<float> ffn_out, x_out;
+
+  // `attn_gain` scales the attention output, as a faulty kernel would;
+  // everything downstream is computed from the faulty value.
+  explicit TestLayer(uint32_t seed, float attn_gain = 1.0f) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+    auto rand_vec = [&](size_t n) {
+      std::vector<float> v(n);
+      for (auto &e : v)
+        e = uni(rng);
+      return v;
+    };
+    const uint32_t kv = kKvHeads * kHeadDim;
+    wq = make_weight(DriftDType::F16, kDim, kDim, false, rng);
+    wk = make_weight(DriftDType::INT8, kv, kDim, true, rng);
+    wv = make_weight(DriftDType::INT4, kv, kDim, true, rng);
+    wo = make_weight(DriftDType::F32, kDim, kDim, false, rng);
+    w1 = make_weight(DriftDType::INT4, kHidden, kDim, false, rng);
+    w2 = make_weight(DriftDType::INT8, kDim, kHidden, false, rng);
+    w3 = make_weight(DriftDType::F16, kHidden, kDim, false, rng);
+    weights.wq = wq.w;
+    weights.wk = wk.w;
+    weights.wv = wv.w;
+    weights.wo = wo.w;
+    weights.w1 = w1.w;
+    weights.w2 = w2.w;
+    weights.w3 = w3.w;
+    weights.attn_norm = rand_vec(kDim);
+    weights.ffn_norm = rand_vec(kDim);
+
+    x_in = rand_vec(kDim);
+    attn_norm = rmsnorm(x_in, weights.attn_norm);
+    q = gemv(wq, attn_norm);
+    k = gemv(wk, attn_norm);
+    v = gemv(wv, attn_norm);
+    q_rope = rope(q, kHeads);
+    k_rope = rope(k, kKvHeads);
+
+    cache_k = rand_vec(kKvHeads * kMaxSeq * kHeadDim);
+    cache_v = rand_vec(kKvHeads * kMaxSeq * kHeadDim);
+    for (uint32_t h = 0; h < kKvHeads; ++h)
+      for (uint32_t d = 0; d < kHeadDim; ++d) {
+        cache_k[(h * kMaxSeq + kPos) * kHeadDim + d] = k_rope[h * kHeadDim + d];
+        cache_v[(h * kMaxSeq + kPos) * kHeadDim + d] = v[h * kHeadDim + d];
+      }
+
+    attn_out.assign(kDim, 0.0f);
+    const float scale = 1.0f / std::sqrt(static_cast<float>(kHeadDim));
+    for (uint32_t h = 0; h < kHeads; ++h) {
+      const uint32_t kvh = h / (kHeads / kKvHeads);
+      std::vector<float> p(kPos + 1);
+      float maxv = -INFINITY, sum = 0.0f;
+      for (uint32_t r = 0; r <= kPos; ++r) {
+        float dot = 0.0f;
+        for (uint32_t d = 0; d < kHeadDim; ++d)
+          dot += q_rope[h * kHeadDim + d] *
+                 cache_k[(kvh * kMaxSeq + r) * kHeadDim + d];
+        p[r] = dot * scale;
+        maxv = std::max(maxv, p[r]);
+      }
+      for (auto &e : p) {
+        e = std::exp(e - maxv);
+        sum += e;
+      }
+      for (uint32_t r = 0; r <= kPos; ++r)
+        for (uint32_t d = 0; d < kHeadDim; ++d)
+          attn_out[h * kHeadDim + d] +=
+              p[r] / sum * cache_v[(kvh * kMaxSeq + r) * kHeadDim + d];
+    }
+    for (auto &e : attn_out)
+      e *= attn_gain;
+
+    wo_out = gemv(wo, attn_out);
+    x_attn = add(x_in, wo_out);
+    ffn_norm = rmsnorm(x_attn, weights.ffn_norm);
+    gate = gemv(w1, ffn_norm);
+    up = gemv(w3, ffn_norm);
+    gate_act.resize(kHidden);
+    for (uint32_t i = 0; i < kHidden; ++i)
+      gate_act[i] = gate[i] / (1.0f + std::exp(-gate[i])) * up[i];
+    ffn_out = gemv(w2, gate_act);
+    x_out = add(x_attn, ffn_out);
+  }
+
+  // Snapshot every point the unfused decode path exposes; `fused` drops the
+  // ones fused kernels keep on chip.
+  void capture(DriftMonitor &m, DriftFrame *f, void *stream, bool fused) {
+    using P = DriftPoint;
+    m.capture(f, P::XIn, x_in.data(), kDim, stream);
+    if (!fused)
+      m.capture(f, P::AttnNorm, attn_norm.data(), kDim, stream);
+    m.capture(f, P::Q, q.data(), kDim, stream);
+    m.capture(f, P::K, k.data(), k.size(), stream);
+    m.capture(f, P::V, v.data(), v.size(), stream);
+    m.capture(f, P::QRope, q_rope.data(), kDim, stream);
+    if (!fused)
+      m.capture(f, P::KRope, k_rope.data(), k_rope.size(), stream);
+    m.capture_cache(f, P::KCache, cache_k.data(), kMaxSeq, stream);
+    m.capture_cache(f, P::VCache, cache_v.data(), kMaxSeq, stream);
+    m.capture(f, P::AttnOut, attn_out.data(), kDim, stream);
+    m.capture(f, P::WoOut, wo_out.data(), kDim, stream);
+    m.capture(f, P::XAttn, x_attn.data(), kDim, stream);
+    m.capture(f, P::FfnNorm, ffn_norm.data(), kDim, stream);
+    if (!fused) {
+      m.capture(f, P::Gate, gate.data(), kHidden, stream);
+      m.capture(f, P::Up, up.data(), kHidden, stream);
+    }
+    m.capture(f, P::GateAct, gate_act.data(), kHidden, stream);
+    m.capture(f, P::FfnOut, ffn_out.data(), kDim, stream);
+    m.capture(f, P::XOut, x_out.data(), kDim, stream);
+  }
+};
+
+static DriftMonitor::WeightFetch fetch_from(const TestLayer &layer) {
+  return [&layer](size_t, DriftLayerWeights *w, std::string *) {
+    *w = layer.weights;
+    return true;
+  };
+}
+
+int main() {
+  std::cout << "GRETA CORE: drift_monitor_test\n";
+  std::string err;
+
+  // Histogram buckets and the error metric.
+  {
+    check(DriftHistogram::bucket(0.0) == 0 &&
+              DriftHistogram::bucket(5e-11) == 0,
+          "exact bucket");
+    check(DriftHistogram::bucket(5e-10) == 1 &&
+              DriftHistogram::bucket(3e-3) == 8 &&
+              DriftHistogram::bucket(0.5) == 10 &&
+              DriftHistogram::bucket(5.0) == 11,
+          "decade buckets");
+    check(DriftHistogram::bucket(50.0) == 12 &&
+              DriftHistogram::bucket(INFINITY) == 12 &&
+              DriftHistogram::bucket(NAN) == 12,
+          "overflow bucket");
+    check(std::string(DriftHistogram::label(8)) == "1e-3" &&
+              std::string(DriftHistogram::label(0)) == "<1e-10",
+          "bucket labels");
+
+    const float ref[4] = {3.0f, 0.0f, 4.0f, 0.0f};
+    const float got[4] = {3.0f, 0.5f, 4.0f, 0.0f};
+    double max_abs = 0.0, rel = 0.0;
+    drift_error(ref, got, 4, &max_abs, &rel);
+    check(max_abs == 0.5 && std::fabs(rel - 0.1) < 1e-12, "L2 relative error");
+    drift_error(ref, ref, 4, &max_abs, &rel);
+    check(max_abs == 0.0 && rel == 0.0, "exact match");
+    const float bad[4] = {3.0f, NAN, 4.0f, 0.0f};
+    drift_error(ref, bad, 4, &max_abs, &rel);
+    check(std::isinf(rel) && std::isinf(max_abs), "non-finite output");
+  }
+
+  // Sampling: one step in `every`, selected layers only.
+  {
+    CpuStagingBackend backend;
+    DriftOptions opt;
+    opt.enabled = true;
+    opt.every = 4;
+    DriftMonitor m(&backend, opt, nullptr);
+    check(m.sampled(0, 0, 2) && m.sampled(8, 0, 2), "sampled steps");
+    check(!m.sampled(1, 0, 2) && !m.sampled(4, 1, 2), "unsampled steps");
+  }
+
+  // A correct layer: every op checked, nothing flagged.
+  {
+    CpuStagingBackend backend;
+    CpuStagingBackend::Stream stream;
+    DriftOptions opt;
+    opt.enabled = true;
+    TestLayer layer(7);
+    DriftMonitor m(&backend, opt, fetch_from(layer));
+    for (uint64_t step = 0; step < 3; ++step) {
+      DriftFrame *f = m.begin(test_shape(), 0, step, kPos);
+      check(f != nullptr, "frame available");
+      layer.capture(m, f, &stream, false);
+      m.submit(f, &stream);
+      m.flush();
+    }
+    const DriftReport r = m.report();
+    check(r.frames_checked == 3 && r.frames_skipped == 0 && r.errors == 0,
+          "frames checked");
+    check(r.violations() == 0, "no violations on a correct layer");
+    const char *ops[] = {"rmsnorm_attn", "q_proj",      "k_proj",
+                         "v_proj",       "rope_q",      "rope_k",
+                         "kv_update",    "attention",   "wo",
+                         "residual_attn", "rmsnorm_ffn", "ffn_gate",
+                         "ffn_up",       "silu_mul",    "ffn_down",
+                         "residual_ffn"};
+    check(r.ops.size() == sizeof(ops) / sizeof(ops[0]), "op count");
+    for (size_t i = 0; i < r.ops.size() && i < 16; ++i)
+      check(r.ops[i].op == ops[i] && r.ops[i].checks == 3 &&
+                r.ops[i].max_rel < 1e-5,
+            ops[i]);
+    const DriftOpStats *q = find_op(r, "q_proj");
+    uint64_t in_hist = 0;
+    for (uint64_t c : q ? q->rel_hist.counts : DriftHistogram{}.counts)
+      in_hist += c;
+    check(in_hist == 3, "histogram holds every check");
+  }
+
+  // A faulty attention kernel is flagged; ops fed its output are not.
+  {
+    CpuStagingBackend backend;
+    CpuStagingBackend::Stream stream;
+    DriftOptions opt;
+    opt.enabled = true;
+    TestLayer layer(11, 1.1f);
+    DriftMonitor m(&backend, opt, fetch_from(layer));
+    DriftFrame *f = m.begin(test_shape(), 3, 64, kPos);
+    layer.capture(m, f, &stream, false);
+    m.submit(f, &stream);
+    m.flush();
+    const DriftReport r = m.report();
+    const DriftOpStats *attn = find_op(r, "attention");
+    check(attn && attn->violations == 1 && attn->max_rel > 0.05 &&
+              attn->max_rel < 0.15,
+          "attention flagged");
+    check(attn && attn->worst_layer == 3 && attn->worst_step == 64,
+          "worst sample located");
+    const DriftOpStats *wo = find_op(r, "wo");
+    check(wo && wo->violations == 0, "downstream op not flagged");
+    check(r.violations() == 1, "single violation");
+    check(contains(r.to_text(), "attention") &&
+              contains(r.to_text(), "1 violations"),
+          "text report");
+  }
+
+  // Fused kernels: RMSNorm+QKV, RoPE+KV update and the FFN front are
+  // checked as one op each.
+  {
+    CpuStagingBackend backend;
+    CpuStagingBackend::Stream stream;
+    DriftOptions opt;
+    opt.enabled = true;
+    TestLayer layer(13);
+    DriftMonitor m(&backend, opt, fetch_from(layer));
+    DriftFrame *f = m.begin(test_shape(), 0, 0, kPos);
+    layer.capture(m, f, &stream, true);
+    m.submit(f, &stream);
+    m.flush();
+    const DriftReport r = m.report();
+    check(find_op(r, "rmsnorm_qkv") && find_op(r, "rope_kv_update") &&
+              find_op(r, "ffn_front"),
+          "fused ops checked");
+    check(!find_op(r, "q_proj") && !find_op(r, "rope_k") &&
+              !find_op(r, "silu_mul"),
+          "unfused ops absent");
+    check(r.violations() == 0, "fused layer clean");
+  }
+
+  // No free frame: the sample is skipped, not waited for.
+  {
+    CpuStagingBackend backend;
+    CpuStagingBackend::Stream stream;
+    DriftOptions opt;
+    opt.enabled = true;
+    opt.frames = 1;
+    TestLayer layer(17);
+    DriftMonitor m(&backend, opt, fetch_from(layer));
+    DriftFrame *f = m.begin(test_shape(), 0, 0, kPos);
+    check(f && m.begin(test_shape(), 1, 0, kPos) == nullptr, "busy frame");
+    layer.capture(m, f, &stream, false);
+    m.submit(f, &stream);
+    m.flush();
+    check(m.begin(test_shape(), 0, 1, kPos) != nullptr, "frame reused");
+    const DriftReport r = m.report();
+    check(r.frames_skipped == 1 && r.frames_checked == 1, "skip counted");
+  }
+
+  // A frame abandoned by a failed layer goes back to the pool unchecked.
+  {
+    CpuStagingBackend backend;
+    CpuStagingBackend::Stream stream;
+    DriftOptions opt;
+    opt.enabled = true;
+    opt.frames = 1;
+    TestLayer layer(23);
+    DriftMonitor m(&backend, opt, fetch_from(layer));
+    for (uint64_t step = 0; step < 3; ++step) {
+      DriftFrame *f = m.begin(test_shape(), 0, step, kPos);
+      check(f != nullptr, "abandoned frame reused");
+      layer.capture(m, f, &stream, false);
+      m.abandon(f, &stream);
+    }
+    m.flush();
+    const DriftReport r = m.report();
+    check(r.frames_skipped == 0 && r.frames_checked == 0 && r.errors == 0,
+          "abandoned frames not checked");
+  }
+
+  // Missing weights: projections are skipped, weight-free ops still run.
+  {
+    CpuStagingBackend backend;
+    CpuStagingBackend::Stream stream;
+    DriftOptions opt;
+    opt.enabled = true;
+    TestLayer layer(19);
+    DriftMonitor m(&backend, opt,
+                   [](size_t, DriftLayerWeights *, std::string *e) {
+                     *e = "no weights";
+                     return false;
+                   });
+    for (uint64_t step = 0; step < 2; ++step) {
+      DriftFrame *f = m.begin(test_shape(), 0, step, kPos);
+      layer.capture(m, f, &stream, false);
+      m.submit(f, &stream);
+      m.flush();
+    }
+    const DriftReport r = m.report();
+    check(r.errors == 1, "fetch failure counted once");
+    check(!find_op(r, "q_proj") && find_op(r, "attention") &&
+              find_op(r, "attention")->checks == 2,
+          "weight-free ops checked");
+  }
+
+  // Reports: JSON by extension, text otherwise, written at destruction.
+  {
+    const std::string base =
+        "/tmp/greta_drift_monitor_test_" + std::to_string(getpid());
+    TestLayer layer(23);
+    {
+      CpuStagingBackend backend;
+      CpuStagingBackend::Stream stream;
+      DriftOptions opt;
+      opt.enabled = true;
+      opt.out = base + ".json";
+      DriftMonitor m(&backend, opt, fetch_from(layer));
+      DriftFrame *f = m.begin(test_shape(), 2, 5, kPos);
+      layer.capture(m, f, &stream, false);
+      m.submit(f, &stream); // Checked by the destructor's drain
+    }
+    const std::string json = read_file(base + ".json");
+    check(contains(json, "\"frames_checked\":1") &&
+              contains(json, "\"op\":\"ffn_down\"") &&
+              contains(json, "\"rel_hist\":[") &&
+              contains(json, "\"worst_layer\":2"),
+          "JSON report written at exit");
+
+    DriftReport r;
+    r.threshold = 1e-2;
+    DriftOpStats s;
+    s.op = "wo";
+    s.checks = 1;
+    s.max_rel = INFINITY;
+    s.violations = 1;
+    r.ops.push_back(s);
+    check(contains(r.to_json(), "\"max_rel\":null"), "non-finite as null");
+    check(r.write(base + ".txt", &err) &&
+              contains(read_file(base + ".txt"), "Relative error histogram"),
+          "text report file");
+    check(!r.write("/nonexistent/dir/drift.json", &err) &&
+              contains(err, "/nonexistent/dir/drift.json"),
+          "write error");
+    std::remove((base + ".json").c_str());
+    std::remove((base + ".txt").c_str());
+  }
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
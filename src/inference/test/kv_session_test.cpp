@@ -0,0 +1,119 @@
+#include "gcore/inference/kv_session.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using namespace gcore::inference;
+
+static bool roundtrip(KvSessionCodec codec, float tol) {
+  KvSessionHeader h;
+  h.codec = static_cast<uint32_t>(codec);
+  h.num_layers = 3;
+  h.num_heads_kv = 2;
+  h.head_dim = 8;
+  h.n_tokens = 5;
+  const size_t elems = size_t(h.num_heads_kv) * h.n_tokens * h.head_dim;
+
+  std::vector<int32_t> tokens = {1, 15043, 29892, 3186, 29991};
+  std::vector<std::vector<float>> k(h.num_layers), v(h.num_layers);
+  for (uint32_t l = 0; l < h.num_layers; ++l) {
+    k[l].resize(elems);
+    v[l].resize(elems);
+    for (size_t i = 0; i < elems; ++i) {
+      k[l][i] = std::sin(0.37f * (l * elems + i)) * 3.0f;
+      v[l][i] = std::cos(0.11f * (l * elems + i)) - 0.5f;
+    }
+  }
+
+  const std::string path = "kv_session_test.gkvs";
+  std::string err;
+  {
+    KvSessionWriter w;
+    if (!w.open(path, h, tokens.data(), &err)) {
+      std::cerr << err << "\n";
+      return false;
+    }
+    for (uint32_t l = 0; l < h.num_layers; ++l) {
+      if (!w.write_layer(k[l].data(), v[l].data(), &err)) {
+        std::cerr << err << "\n";
+        return false;
+      }
+    }
+    if (!w.finish(&err)) {
+      std::cerr << err << "\n";
+      return false;
+    }
+  }
+
+  KvSessionFile f;
+  if (!f.open(path, &err)) {
+    std::cerr << err << "\n";
+    return false;
+  }
+  bool ok = f.header().n_tokens == h.n_tokens && f.layer_elems() == elems;
+  for (size_t i = 0; ok && i < tokens.size(); ++i)
+    ok = f.tokens()[i] == tokens[i];
+  std::vector<float> k_out(elems), v_out(elems);
+  float max_err = 0.0f;
+  for (uint32_t l = 0; ok && l < h.num_layers; ++l) {
+    f.prefetch(l);
+    f.read_layer(l, k_out.data(), v_out.data());
+    for (size_t i = 0; i < elems; ++i) {
+      max_err = std::fmax(max_err, std::fabs(k_out[i] - k[l][i]));
+      max_err = std::fmax(max_err, std::fabs(v_out[i] - v[l][i]));
+    }
+  }
+  f.close();
+  std::remove(path.c_str());
+  std::cout << "codec=" << h.codec << " max_err=" << max_err << "\n";
+  return ok && max_err <= tol;
+}
+
+int main() {
+  std::cout << "GRETA CORE: KV Session Test\n";
+
+  if (!roundtrip(KvSessionCodec::F32, 0.0f) ||
+      !roundtrip(KvSessionCodec::F16, 2e-3f)) {
+    std::cerr << "Roundtrip mismatch\n";
+    return 1;
+  }
+
+  // Half conversion edge cases.
+  const float cases[] = {0.0f, -0.0f, 1.0f, 65504.0f, 6.1035156e-05f,
+                         5.9604645e-08f};
+  for (float c : cases) {
+    if (kv_half_to_float(kv_float_to_half(c)) != c) {
+      std::cerr << "Half roundtrip failed for " << c << "\n";
+      return 1;
+    }
+  }
+  if (!std::isinf(kv_half_to_float(kv_float_to_half(1e6f)))) {
+    std::cerr << "Overflow did not saturate to inf\n";
+    return 1;
+  }
+
+  // Truncated files must be rejected.
+  {
+    FILE *fp = std::fopen("kv_session_bad.gkvs", "wb");
+    KvSessionHeader h;
+    h.num_layers = 1;
+    h.num_heads_kv = 1;
+    h.head_dim = 4;
+    h.n_tokens = 4;
+    std::fwrite(&h, sizeof(h), 1, fp);
+    std::fclose(fp);
+    KvSessionFile f;
+    std::string err;
+    const bool opened = f.open("kv_session_bad.gkvs", &err);
+    std::remove("kv_session_bad.gkvs");
+    if (opened) {
+      std::cerr << "Truncated session accepted\n";
+      return 1;
+    }
+  }
+
+  std::cout << "\nSTATUS=OK\n";
+  return 0;
+}
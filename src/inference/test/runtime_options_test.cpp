@@ -0,0 +1,157 @@
+#include "gcore/inference/runtime_options.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace gcore::inference;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+int main() {
+  std::cout << "GRETA CORE: runtime_options_test\n";
+
+  // Defaults with nothing set.
+  {
+    const RuntimeOptions o = RuntimeOptions::from_env();
+    check(!o.fused_rmsnorm && !o.fused_attention && !o.fused_ffn,
+          "fused kernels off by default");
+    check(o.attn_decode_kernel == AttnDecodeKernel::Auto &&
+              o.attn_accum == AttnAccumMode::Fp32 && o.embed_row_major,
+          "kernel defaults");
+    check(o.qkv_force_route.empty() && !o.graph && !o.profile_attn,
+          "no forced routes");
+    check(!o.profile_sync, "profiled ops not synchronized by default");
+    check(o.trace.prompt() == nullptr && !o.trace.post_wo &&
+              o.trace.attn_points == 0x1f && o.trace.attn_keys_window == 64,
+          "trace defaults");
+    check(o.trace.post_wo_layers.selected(0, 32) &&
+              !o.trace.post_wo_layers.selected(1, 32),
+          "post-WO traces layer 0 by default");
+    check(o.trace.post_wo_phase("decode0"), "all phases by default");
+    check(!o.drift.enabled && o.drift.every == 64 && o.drift.frames == 2 &&
+              o.drift.out.empty(),
+          "drift monitor off by default");
+    check(o.drift.layers.selected(0, 32) && !o.drift.layers.selected(1, 32),
+          "drift checks layer 0 by default");
+    check(o.prefill_chunk == 0 && !o.activation_arena,
+          "single-pass prefill, separate activations by default");
+  }
+
+  // Prefill and activation knobs.
+  {
+    setenv("GRETA_PREFILL_CHUNK", "256", 1);
+    setenv("GRETA_ACTIVATION_ARENA", "1", 1);
+    const RuntimeOptions o = RuntimeOptions::from_env();
+    check(o.prefill_chunk == 256, "prefill chunk");
+    check(o.activation_arena, "activation arena");
+    setenv("GRETA_PREFILL_CHUNK", "-8", 1);
+    setenv("GRETA_ACTIVATION_ARENA", "0", 1);
+    const RuntimeOptions o2 = RuntimeOptions::from_env();
+    check(o2.prefill_chunk == 0, "bad prefill chunk keeps single pass");
+    check(!o2.activation_arena, "activation arena off with \"0\"");
+    unsetenv("GRETA_PREFILL_CHUNK");
+    unsetenv("GRETA_ACTIVATION_ARENA");
+  }
+
+  // Profiling sync: explicit, or implied by the roofline report.
+  {
+    setenv("GRETA_PROFILE_SYNC", "1", 1);
+    check(RuntimeOptions::from_env().profile_sync, "GRETA_PROFILE_SYNC=1");
+    setenv("GRETA_PROFILE_SYNC", "0", 1);
+    check(!RuntimeOptions::from_env().profile_sync, "GRETA_PROFILE_SYNC=0");
+    setenv("GRETA_PROFILE_ROOFLINE", "/tmp/roofline.json", 1);
+    check(RuntimeOptions::from_env().profile_sync,
+          "GRETA_PROFILE_ROOFLINE implies sync");
+    unsetenv("GRETA_PROFILE_SYNC");
+    unsetenv("GRETA_PROFILE_ROOFLINE");
+  }
+
+  // Drift monitor knobs.
+  {
+    setenv("GRETA_DRIFT_OUT", "/tmp/drift.json", 1);
+    setenv("GRETA_DRIFT_EVERY", "0", 1);
+    setenv("GRETA_DRIFT_LAYERS", "5,31", 1);
+    setenv("GRETA_DRIFT_MAX_REL", "1e-3", 1);
+    const RuntimeOptions o = RuntimeOptions::from_env();
+    check(o.drift.enabled && o.drift.out == "/tmp/drift.json",
+          "drift report path enables the monitor");
+    check(o.drift.every == 64, "drift every 0 keeps the default");
+    check(o.drift.layers.selected(5, 32) && o.drift.layers.selected(31, 32) &&
+              !o.drift.layers.selected(0, 32),
+          "drift layers");
+    check(o.drift.max_rel == 1e-3, "drift threshold");
+    setenv("GRETA_DRIFT_MAX_REL", "-1", 1);
+    setenv("GRETA_DRIFT_LAYERS", "all", 1);
+    const RuntimeOptions o2 = RuntimeOptions::from_env();
+    check(o2.drift.max_rel == 1e-2 && o2.drift.layers.selected(17, 32),
+          "bad threshold keeps the default; all layers");
+    unsetenv("GRETA_DRIFT_OUT");
+    unsetenv("GRETA_DRIFT_EVERY");
+    unsetenv("GRETA_DRIFT_LAYERS");
+    unsetenv("GRETA_DRIFT_MAX_REL");
+  }
+
+  setenv("GRETA_USE_FUSED_RMSNORM", "1", 1);
+  setenv("GRETA_USE_FUSED_FFN", "yes", 1); // Only "1" enables it
+  setenv("GRETA_FORCE_ATTN_DECODE_KERNEL", "MANUAL", 1);
+  setenv("GRETA_ATTN_ACCUM", "fp16", 1);
+  setenv("GRETA_QKV_FORCE_ROUTE", "auto", 1);
+  setenv("GRETA_EMBED_LAYOUT", "col_major", 1);
+  setenv("GRETA_PROFILE_ATTN", "", 1); // Any value, even empty
+  setenv("GRETA_TRACE_PROMPT_ID", "p7", 1);
+  setenv("GRETA_TRACE_POST_WO", "y", 1);
+  setenv("GRETA_TRACE_POST_WO_LAYERS", "3,-32", 1);
+  setenv("GRETA_TRACE_POST_WO_PHASES", "decode0", 1);
+  setenv("GRETA_TRACE_RMSNORM_LAYERS", "all", 1);
+  setenv("GRETA_TRACE_ATTN_POINTS", "q,attn_out", 1);
+  setenv("GRETA_TRACE_ATTN_LAYER", "0", 1);
+  setenv("GRETA_TRACE_ATTN_KEYS_WINDOW", "-3", 1);
+  setenv("GRETA_TRACE_PREFILL_DECODE_OUT", "/tmp/pd.jsonl", 1);
+  {
+    const RuntimeOptions o = RuntimeOptions::from_env();
+    check(o.fused_rmsnorm && !o.fused_ffn, "fused toggles need \"1\"");
+    check(o.attn_decode_kernel == AttnDecodeKernel::Manual &&
+              o.attn_accum == AttnAccumMode::Fp16 && !o.embed_row_major,
+          "kernel knobs");
+    check(o.qkv_force_route.empty(), "auto route is no route");
+    check(o.profile_attn, "profile_attn when set");
+    if (kTraceEnabled) {
+      check(o.trace.prompt() && o.trace.prompt_id == "p7", "prompt id");
+      check(o.trace.post_wo && o.trace.post_wo_layers.selected(3, 32) &&
+                o.trace.post_wo_layers.selected(32, 32),
+            "post-WO layers, -N = final layer of N");
+      check(o.trace.post_wo_phase("decode0") &&
+                !o.trace.post_wo_phase("prefill_last"),
+            "post-WO phases");
+      check(o.trace.rmsnorm_layers.selected(17, 32), "rmsnorm all layers");
+      check(o.trace.attn_points ==
+                (static_cast<uint32_t>(AttnTracePoint::Q) |
+                 static_cast<uint32_t>(AttnTracePoint::ATTN_OUT)),
+            "attention trace points");
+      check(o.trace.attn_layer_set && o.trace.attn_layer == 0,
+            "attention trace layer");
+      check(o.trace.attn_keys_window == 64, "bad window keeps default");
+      check(o.trace.attn_decode_out == "/tmp/pd.jsonl" &&
+                o.trace.attn_shadow_out == "/tmp/pd.jsonl" &&
+                o.trace.layer_delta_out == "/tmp/pd.jsonl",
+            "trace path fallbacks");
+    } else {
+      check(o.trace.prompt() == nullptr && !o.trace.post_wo,
+            "trace knobs ignored when compiled out");
+    }
+  }
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
@@ -0,0 +1,272 @@
+#include "gcore/inference/trace_format.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace gcore::inference;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+static bool write_file(const std::string &path, const std::string &data) {
+  FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f)
+    return false;
+  const bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+  return std::fclose(f) == 0 && ok;
+}
+
+// One session: stage tensor with input meta, layer tensor, logits, step
+// header and a free-form line.
+static std::string encode_session(TraceEncoder &enc, const char *phase) {
+  std::string out;
+  std::vector<float> sample = {0.5f, -1.25f, 0.0f, 3.0f};
+
+  TraceTensorRecord st;
+  st.source = static_cast<uint32_t>(TraceSource::Stage);
+  st.point = enc.intern("x_in", out);
+  st.phase = enc.intern(phase, out);
+  st.prompt = enc.intern("p0", out);
+  st.layer = 0;
+  st.step = 1;
+  st.n = st.payload_n = static_cast<uint32_t>(sample.size());
+  st.hash = 42;
+  st.min = -1.25f;
+  st.max = 3.0f;
+  st.mean = 0.5625f;
+  TraceStageFields sf;
+  sf.pos_id = 7;
+  sf.seq_len = 8;
+  sf.tokens_total = 8;
+  sf.token_index = 7;
+  sf.stride_elems = 4096;
+  sf.ptr = 4096;
+  sf.offset_bytes = 7 * 4096 * 4;
+  sf.abs_sum = 4.75f;
+  sf.nz_count = 3;
+  TraceInputMeta meta;
+  meta.src_kind = enc.intern("embedding", out);
+  meta.route = enc.intern("valu", out);
+  meta.token_index_used = 7;
+  meta.offset_bytes = 28;
+  meta.alloc_bytes = 1024;
+  meta.prompt_tokens = 7;
+  meta.kv_pos = 7;
+  meta.decode_step = 1;
+  meta.token_id = 29871;
+  enc.tensor(st, &sf, &meta, sample.data(), out);
+
+  TraceTensorRecord lt;
+  lt.source = static_cast<uint32_t>(TraceSource::Layer);
+  lt.point = enc.intern("x_out", out);
+  lt.layer = 31;
+  lt.step = 2;
+  lt.n = 4096;
+  lt.hash = 7;
+  lt.min = -2.0f;
+  lt.max = 2.5f;
+  lt.mean = 0.1f;
+  lt.inf = 1;
+  enc.tensor(lt, nullptr, nullptr, nullptr, out);
+
+  TraceLogitsRecord lg;
+  lg.phase = enc.intern(phase, out);
+  lg.step = 1;
+  lg.top1_id = 5;
+  lg.top1_logit = 12.5f;
+  lg.top2_id = 9;
+  lg.top2_logit = 11.0f;
+  lg.gap = 1.5f;
+  lg.vocab = 32000;
+  enc.logits(lg, out);
+
+  TraceStepRecord sh;
+  sh.step = 2;
+  sh.token_in = 1;
+  sh.token_out = 2;
+  sh.dim = 4096;
+  sh.heads = 32;
+  sh.head_dim = 128;
+  sh.layers = enc.intern("0,31", out);
+  sh.pos_id = 9;
+  sh.seq_len = 10;
+  sh.tokens_total = 10;
+  enc.step(sh, out);
+
+  enc.json("{\"event\":\"note\"}", out);
+  return out;
+}
+
+int main() {
+  std::cout << "GRETA CORE: trace_format_test\n";
+  const std::string path = "trace_format_test.gtrace";
+  std::string err;
+
+  // Two sessions in one file (a second run appending); the second has its
+  // own string table.
+  {
+    TraceEncoder enc;
+    std::string data = encode_session(enc, "decode0");
+    enc.reset();
+    data += encode_session(enc, "prefill_last");
+    check(write_file(path, data), "write trace");
+  }
+  {
+    TraceReader rd;
+    check(rd.open(path, &err), "open");
+    std::vector<std::string> lines;
+    TraceEvent ev;
+    while (rd.next(&ev, &err))
+      lines.push_back(trace_event_json(rd, ev));
+    check(err.empty(), "clean end of file");
+    check(rd.sessions() == 2 && lines.size() == 10, "records and sessions");
+    if (lines.size() == 10) {
+      check(lines[0] ==
+                "{\"event\":\"stage_trace\",\"prompt_id\":\"p0\","
+                "\"phase\":\"decode0\",\"point\":\"x_in\",\"layer\":0,"
+                "\"step\":1,\"pos_id\":7,\"seq_len\":8,\"tokens_total\":8,"
+                "\"token_index\":7,\"stride_elems\":4096,\"sample_n\":4,"
+                "\"ptr\":4096,\"offset_bytes\":114688,\"hash\":42,"
+                "\"min\":-1.25,\"max\":3,\"mean\":0.5625,\"abs_sum\":4.75,"
+                "\"nan\":0,\"inf\":0,\"nz_count\":3,"
+                "\"sample\":[0.5,-1.25,0,3],\"src_kind\":\"embedding\","
+                "\"token_index_used\":7,\"offset_bytes\":28,"
+                "\"alloc_bytes\":1024,\"prompt_tokens\":7,\"kv_pos\":7,"
+                "\"decode_step\":1,\"token_id\":29871,\"route\":\"valu\"}",
+            "stage record json");
+      check(lines[1] == "{\"step\":2,\"layer\":31,\"tag\":\"x_out\","
+                        "\"n\":4096,\"hash\":7,\"min\":-2,\"max\":2.5,"
+                        "\"mean\":0.1,\"nan\":0,\"inf\":1}",
+            "layer record json");
+      check(lines[2].find("\"event\":\"stage_logits\",\"phase\":\"decode0\","
+                          "\"point\":\"logits\",\"layer\":-1") !=
+                    std::string::npos &&
+                lines[2].find("\"top1_id\":5,\"top1_logit\":12.5") !=
+                    std::string::npos,
+            "logits record json");
+      check(lines[3].find("{\"type\":\"step_header\",\"step\":2") == 0 &&
+                lines[3].find("\"layers\":\"0,31\",\"points\":\"\"}") !=
+                    std::string::npos,
+            "step header json");
+      check(lines[4] == "{\"event\":\"note\"}", "json line");
+      check(lines[5].find("\"phase\":\"prefill_last\"") != std::string::npos,
+            "second session strings");
+    }
+  }
+
+  // Unknown chunk types, and blocks behind flags this reader does not know,
+  // are skipped over.
+  {
+    TraceEncoder enc;
+    std::string data = encode_session(enc, "decode0");
+    const TraceChunkHeader unknown{99, 3};
+    data.append(reinterpret_cast<const char *>(&unknown), sizeof(unknown));
+    data.append("abc");
+    TraceTensorRecord lt;
+    lt.source = static_cast<uint32_t>(TraceSource::Layer);
+    lt.layer = 5;
+    lt.payload_n = 2;
+    lt.flags = 1u << 7; // A newer optional block of 8 bytes
+    const float payload[2] = {1.0f, 2.0f};
+    const TraceChunkHeader grown{static_cast<uint32_t>(TraceChunk::Tensor),
+                                 sizeof(lt) + 8 + sizeof(payload)};
+    data.append(reinterpret_cast<const char *>(&grown), sizeof(grown));
+    data.append(reinterpret_cast<const char *>(&lt), sizeof(lt));
+    data.append(8, '\0');
+    data.append(reinterpret_cast<const char *>(payload), sizeof(payload));
+    check(write_file(path, data), "write trace");
+
+    TraceReader rd;
+    check(rd.open(path, &err), "open");
+    TraceEvent ev;
+    size_t n = 0;
+    while (rd.next(&ev, &err))
+      ++n;
+    check(err.empty() && n == 6, "unknown chunk skipped");
+    check(ev.tensor.layer == 5 && ev.payload.size() == 2 &&
+              ev.payload[1] == 2.0f,
+          "unknown block skipped, payload kept");
+  }
+
+  // A file cut mid-chunk (process killed while writing) reports an error
+  // after the intact records.
+  {
+    TraceEncoder enc;
+    std::string data = encode_session(enc, "decode0");
+    data.resize(data.size() - 5);
+    check(write_file(path, data), "write trace");
+    TraceReader rd;
+    check(rd.open(path, &err), "open");
+    TraceEvent ev;
+    size_t n = 0;
+    while (rd.next(&ev, &err))
+      ++n;
+    check(n == 4 && err.find("truncated chunk") != std::string::npos,
+          "truncated file");
+  }
+
+  // Size against the JSONL lines: a stage record with a 256-value sample
+  // and a layer record.
+  {
+    TraceEncoder enc;
+    std::string bin;
+    std::vector<float> sample(256);
+    for (size_t i = 0; i < sample.size(); ++i)
+      sample[i] = std::sin(0.37f * i) * 3.0f;
+    const uint32_t point = enc.intern("attn_out", bin);
+    const uint32_t phase = enc.intern("decode0", bin);
+    TraceReader rd; // Only for trace_event_json's string lookup
+    TraceEvent ev;
+    ev.type = TraceChunk::Tensor;
+    ev.tensor.source = static_cast<uint32_t>(TraceSource::Stage);
+    ev.tensor.point = point;
+    ev.tensor.phase = phase;
+    ev.tensor.layer = 17;
+    ev.tensor.step = 3;
+    ev.tensor.n = ev.tensor.payload_n = 256;
+    ev.tensor.hash = 14695981039346656037ull;
+    ev.tensor.min = -2.99871f;
+    ev.tensor.max = 2.99915f;
+    ev.tensor.mean = 0.0123457f;
+    ev.stage.stride_elems = 4096;
+    ev.stage.ptr = 0x7f3a12345600;
+    ev.payload = sample;
+
+    size_t before = bin.size();
+    enc.tensor(ev.tensor, &ev.stage, nullptr, sample.data(), bin);
+    const size_t stage_bin = bin.size() - before;
+    const size_t stage_text = trace_event_json(rd, ev).size() + 1;
+
+    ev.tensor.source = static_cast<uint32_t>(TraceSource::Layer);
+    ev.tensor.n = 4096;
+    ev.tensor.payload_n = 0;
+    ev.payload.clear();
+    before = bin.size();
+    enc.tensor(ev.tensor, nullptr, nullptr, nullptr, bin);
+    const size_t layer_bin = bin.size() - before;
+    const size_t layer_text = trace_event_json(rd, ev).size() + 1;
+
+    std::cout << "  stage record: jsonl=" << stage_text
+              << " B binary=" << stage_bin << " B; layer record: jsonl="
+              << layer_text << " B binary=" << layer_bin << " B\n";
+    check(stage_bin * 2 < stage_text && layer_bin * 5 < layer_text * 3,
+          "binary smaller than jsonl");
+  }
+
+  std::remove(path.c_str());
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
@@ -2,80 +2,124 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <mutex>
-#include <vector>
+#include <memory>
+
+#include "gcore/rt/host_memory.hpp"
 
 namespace gcore::rt {
 
 // HostAllocator: caching/pooling allocator for CPU memory.
-// - Small allocations go to power-of-two bins with freelists.
-// - Large allocations bypass bins.
+// - Small allocations go to size classes with `classes_per_doubling` steps
+//   between powers of two (64, 80, 96, 112, 128, 160, ... for 4).
+// - Class objects are carved back to back from 2 MiB slabs; classes too
+//   large to fit 8 per slab get one page-rounded extent per object.
+// - Blocks carry no header: free() finds the owning slab through a
+//   process-wide slab map keyed by 2 MiB address chunk.
+// - Large allocations bypass classes (direct mapping). Those of 2 MiB and
+//   up are huge-page backed per Policy::huge_pages.
+// - One arena (slabs + central freelists) per NUMA node. A thread allocates
+//   from the arena of the node it first allocated on; frees return blocks to
+//   the arena that owns them.
 //
-// Thread-safety: coarse-grained mutex (v1). We can evolve to per-bin locks.
+// Thread-safety: each thread keeps a small magazine (LIFO cache) per class and
+// only touches shared state to refill or drain it in batches. The shared
+// per-class freelists are lock-free Treiber stacks of batch descriptors (one
+// CAS moves half a magazine) whose head carries a 16-bit tag against ABA.
+// Blocks freed on another thread land in that thread's magazine. release()
+// and the destructor must not race with alloc/free, and blocks must not be
+// used once the allocator is destroyed.
 class HostAllocator final {
 public:
   struct Stats {
     uint64_t alloc_calls = 0;
     uint64_t free_calls = 0;
-    uint64_t reuse_hits = 0; // satisfied from freelist
-    uint64_t os_allocs = 0;  // new allocations from OS
+    uint64_t reuse_hits = 0; // satisfied from a magazine or central freelist
+    uint64_t os_allocs = 0;  // slab or direct mappings from the OS
     uint64_t bytes_in_use = 0;
-    uint64_t bytes_reserved = 0; // total allocated from OS
+    uint64_t bytes_reserved = 0; // total mapped from OS
+    // Cumulative over all alloc() calls: bytes asked for vs bytes handed
+    // out after size-class rounding.
+    uint64_t bytes_requested_total = 0;
+    uint64_t bytes_allocated_total = 0;
+
+    // Share of handed-out bytes lost to size-class rounding.
+    double internal_fragmentation() const {
+      return bytes_allocated_total == 0
+                 ? 0.0
+                 : 1.0 - static_cast<double>(bytes_requested_total) /
+                             static_cast<double>(bytes_allocated_total);
+    }
   };
 
-  // bin_min_pow2: smallest bin size = 2^bin_min_pow2 bytes
-  // bin_max_pow2: largest bin size = 2^bin_max_pow2 bytes
+  // bin_min_pow2: smallest class size = 2^bin_min_pow2 bytes
+  // bin_max_pow2: largest class size = 2^bin_max_pow2 bytes
   // large_threshold_pow2: >= 2^large_threshold_pow2 uses direct allocation
+  // classes_per_doubling: 1, 2, 4 or 8 (1 gives plain power-of-two bins)
   HostAllocator(int bin_min_pow2 = 6,  // 64 B
                 int bin_max_pow2 = 20, // 1 MiB
-                int large_threshold_pow2 = 20);
+                int large_threshold_pow2 = 20, int classes_per_doubling = 4);
 
   ~HostAllocator();
 
   HostAllocator(const HostAllocator &) = delete;
   HostAllocator &operator=(const HostAllocator &) = delete;
 
-  // Allocate `size` bytes with alignment (power of two).
+  // Placement of new mappings. Defaults come from GRETA_HOST_NUMA
+  // (first-touch|local|interleave) and GRETA_HOST_HUGEPAGES
+  // (off|thp|explicit, default thp).
+  struct Policy {
+    NumaPlacement placement = NumaPlacement::FirstTouch;
+    HugePageMode huge_pages = HugePageMode::Transparent;
+  };
+
+  // Applies to mappings made after the call; must not race with alloc/free.
+  void set_policy(const Policy &policy);
+  Policy policy() const;
+
+  // Allocate `size` bytes with alignment (power of two, at least 16).
   // Returns nullptr on failure.
   void *alloc(std::size_t size, std::size_t alignment = 64);
 
-  // Free memory previously allocated by this allocator.
+  // Free memory previously allocated by this allocator. Pointers the slab
+  // map does not attribute to this allocator are ignored.
   void free(void *p);
 
-  // Returns a snapshot of stats.
+  // Returns a snapshot of stats (summed over live thread caches).
   Stats stats() const;
 
-  // Release cached blocks back to OS (best-effort).
-  // Useful for tests; not required for normal operation.
+  // Release cached memory back to OS (best-effort): the calling thread's
+  // magazines go back to the central freelists, then every slab whose
+  // objects are all free is unmapped. Other threads' magazines are returned
+  // when those threads exit.
   void release();
 
 private:
-  struct BlockHeader {
-    uint32_t magic;
-    uint16_t bin_index; // 0xFFFF for direct allocation
-    uint16_t reserved;
-    uint64_t requested; // requested payload size
-    uint64_t allocated; // payload capacity
-    BlockHeader *next;
-  };
-
-  static constexpr uint32_t kMagic = 0x47434F52; // 'GCOR'
+  struct Shared;      // Per-node arenas, thread-cache registry, counters
+  struct ThreadCache; // Per-thread magazines for one allocator
+  struct TlsRegistry; // thread_local list of this thread's caches
 
   int bin_min_pow2_;
   int bin_max_pow2_;
   int large_threshold_pow2_;
+  int class_shift_; // log2(classes per doubling)
   int bin_count_;
+  uint64_t id_; // Never reused, so stale thread-local entries cannot match
 
-  mutable std::mutex mu_;
-
-  std::vector<BlockHeader *> freelists_;
-  Stats stats_;
+  // Shared with thread caches, which may outlive the allocator until their
+  // thread exits.
+  std::shared_ptr<Shared> shared_;
 
-  int size_to_bin(std::size_t size) const;
+  // Smallest class that holds `size` bytes at `alignment`, or -1.
+  int size_to_bin(std::size_t size, std::size_t alignment) const;
   std::size_t bin_to_size(int bin) const;
 
-  void *os_alloc(std::size_t bytes, std::size_t alignment);
-  void os_free(void *base);
+  // This thread's cache for this allocator; nullptr once the thread's
+  // registry is gone (callers then go straight to the central stacks).
+  ThreadCache *local_cache(bool create = true);
+  static void retire_cache(ThreadCache *tc);
+  void count_in_use(ThreadCache *tc, int64_t delta);
+  void count_alloc(ThreadCache *tc, std::size_t requested,
+                   std::size_t allocated, bool reused);
 
   static std::size_t align_up(std::size_t x, std::size_t a);
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gcore::rt {
+
+// Page backing for host mappings.
+enum class HugePageMode : uint8_t {
+  Off,         // Base pages, system THP defaults
+  Transparent, // madvise(MADV_HUGEPAGE) on a 2 MiB aligned range
+  Explicit,    // MAP_HUGETLB from the reserved pool, else Transparent
+};
+
+// NUMA placement for host mappings.
+enum class NumaPlacement : uint8_t {
+  FirstTouch, // Kernel default: pages land on the node that touches them
+  Local,      // mbind(MPOL_BIND) to one node
+  Interleave, // mbind(MPOL_INTERLEAVE) across all online nodes
+};
+
+static constexpr std::size_t kHugePageBytes = std::size_t{1} << 21;
+
+struct HostMapping {
+  void *base = nullptr;
+  std::size_t bytes = 0; // Mapped length, pass back to unmap_host_memory()
+  bool hugetlb = false;  // Backed by the explicit huge page pool
+};
+
+// Anonymous read/write mapping of at least `bytes`, aligned to `alignment`.
+// With huge pages the length is rounded to 2 MiB. base is nullptr on failure.
+HostMapping map_host_memory(std::size_t bytes, std::size_t alignment,
+                            HugePageMode huge);
+void unmap_host_memory(void *base, std::size_t bytes);
+
+// Apply a placement policy to a fresh mapping before it is touched. `node`
+// is used by Local (-1 = node of the calling thread). A no-op on single-node
+// systems and for FirstTouch; returns false if the kernel rejects the policy.
+bool bind_host_memory(void *base, std::size_t bytes, NumaPlacement placement,
+                      int node = -1);
+
+// Number of NUMA nodes (highest online node + 1), at least 1.
+int numa_node_count();
+// Node of the CPU the calling thread is running on.
+int numa_current_node();
+
+// AnonHugePages of this process (from /proc/self/smaps_rollup), in bytes.
+std::size_t host_anon_huge_bytes();
+
+// Parse "off|thp|explicit" and "first-touch|local|interleave" (CLI and env
+// spellings). Return false and leave *out untouched on unknown input.
+bool parse_huge_page_mode(const std::string &s, HugePageMode *out);
+bool parse_numa_placement(const std::string &s, NumaPlacement *out);
+const char *huge_page_mode_name(HugePageMode mode);
+const char *numa_placement_name(NumaPlacement placement);
+
+} // namespace gcore::rt
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "gcore/rt/allocator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace gcore::rt {
+
+// Direction of a staged copy.
+enum class StagingCopyKind : uint8_t { HostToDevice, DeviceToHost };
+
+// Device hooks used by StagingPool. Streams and events are opaque handles
+// owned by the backend (hipStream_t / hipEvent_t for HIP); a null stream is
+// the backend's default stream.
+class StagingBackend {
+public:
+  virtual ~StagingBackend() = default;
+
+  // Page-lock [p, p + bytes) so the device can DMA to/from it.
+  virtual bool pin(void *p, std::size_t bytes, std::string *err) = 0;
+  virtual void unpin(void *p) = 0;
+
+  virtual void *create_event(std::string *err) = 0;
+  virtual void destroy_event(void *event) = 0;
+
+  virtual bool copy_async(void *dst, const void *src, std::size_t bytes,
+                          StagingCopyKind kind, void *stream,
+                          std::string *err) = 0;
+  virtual bool record(void *event, void *stream, std::string *err) = 0;
+  // True once all work queued before the last record() has finished.
+  virtual bool query(void *event) = 0;
+  virtual bool wait(void *event, std::string *err) = 0;
+  virtual bool sync(void *stream, std::string *err) = 0;
+};
+
+// A page-locked host buffer checked out of a StagingPool.
+struct StagingBuffer {
+  void *data = nullptr;
+  std::size_t capacity = 0;
+
+  // Pool bookkeeping.
+  int size_class = 0;
+  void *event = nullptr; // Created on first release_after()
+};
+
+// StagingPool: reusable pinned host buffers for host<->device transfers.
+// - Buffers come from a HostAllocator and are pinned once, then recycled by
+//   power-of-two size class (64 KiB and up).
+// - A buffer given back with release_after() stays busy until the work
+//   queued on its stream completes (tracked with a backend event).
+// - Total pinned bytes are kept under a budget: idle buffers of other
+//   classes are dropped first, then acquire() waits for the oldest busy one.
+// - upload()/download() split large copies into chunks so the host memcpy
+//   of one chunk overlaps the DMA of the previous one.
+// Thread-safe.
+class StagingPool {
+public:
+  struct Stats {
+    uint64_t acquires = 0;
+    uint64_t reuse_hits = 0;  // served from an idle buffer
+    uint64_t pins = 0;        // buffers allocated and pinned
+    uint64_t stalls = 0;      // acquire() had to wait for a busy buffer
+    uint64_t bytes_pinned = 0;
+    uint64_t bytes_busy = 0;
+  };
+
+  static constexpr std::size_t kMinClassBytes = std::size_t{64} << 10;
+
+  explicit StagingPool(StagingBackend *backend,
+                       std::size_t max_pinned_bytes = std::size_t{64} << 20,
+                       std::size_t chunk_bytes = std::size_t{4} << 20);
+  ~StagingPool();
+
+  StagingPool(const StagingPool &) = delete;
+  StagingPool &operator=(const StagingPool &) = delete;
+
+  // Pinned buffer with capacity >= bytes. nullptr on failure.
+  StagingBuffer *acquire(std::size_t bytes, std::string *err);
+
+  // Give back a buffer with no device work pending on it.
+  void release(StagingBuffer *buf);
+  // Give back a buffer that work already queued on `stream` still reads or
+  // writes; it is reused once that work has completed.
+  bool release_after(StagingBuffer *buf, void *stream, std::string *err);
+
+  // Copy pageable host memory to the device through staging buffers. Returns
+  // once `src` may be reused; the device copy completes in stream order.
+  bool upload(void *dst_dev, const void *src, std::size_t bytes, void *stream,
+              std::string *err);
+
+  // Copy device memory to pageable host memory. Blocks until dst_host is
+  // filled.
+  bool download(void *dst_host, const void *src_dev, std::size_t bytes,
+                void *stream, std::string *err);
+
+  // Enqueue a device->pinned copy and record its completion. Call wait()
+  // before reading buf->data, then release(buf).
+  StagingBuffer *download_async(const void *src_dev, std::size_t bytes,
+                                void *stream, std::string *err);
+  bool wait(StagingBuffer *buf, std::string *err);
+
+  Stats stats() const;
+
+  // Unpin and free idle buffers. Buffers still checked out are not touched;
+  // release them before destroying the pool.
+  void trim();
+
+private:
+  static int size_to_class(std::size_t bytes);
+  static std::size_t class_to_size(int cls);
+
+  // Move completed busy buffers to the idle lists. Caller holds mu_.
+  void reap_locked();
+  void destroy_locked(StagingBuffer *buf);
+  bool record_locked(StagingBuffer *buf, void *stream, std::string *err);
+
+  StagingBackend *backend_;
+  std::size_t max_pinned_bytes_;
+  std::size_t chunk_bytes_;
+  HostAllocator host_;
+
+  mutable std::mutex mu_;
+  std::vector<std::vector<StagingBuffer *>> idle_; // by size class
+  std::deque<StagingBuffer *> busy_;               // in release order
+  Stats stats_;
+};
+
+// CPU stand-in backend. Copies queued on a CpuStagingBackend::Stream run when
+// the stream is drained (run(), wait() on one of its events, or sync()), so
+// tests can observe in-flight buffers; a null stream runs them immediately.
+// Host-side pointers must lie in a pinned range.
+class CpuStagingBackend final : public StagingBackend {
+public:
+  struct Stream {
+    struct Op {
+      void *dst;
+      const void *src;
+      std::size_t bytes;
+    };
+    std::deque<Op> pending;
+    uint64_t queued = 0;   // ops ever queued
+    uint64_t executed = 0; // ops ever executed
+  };
+
+  bool pin(void *p, std::size_t bytes, std::string *err) override;
+  void unpin(void *p) override;
+  void *create_event(std::string *err) override;
+  void destroy_event(void *event) override;
+  bool copy_async(void *dst, const void *src, std::size_t bytes,
+                  StagingCopyKind kind, void *stream,
+                  std::string *err) override;
+  bool record(void *event, void *stream, std::string *err) override;
+  bool query(void *event) override;
+  bool wait(void *event, std::string *err) override;
+  bool sync(void *stream, std::string *err) override;
+
+  // Execute up to `max_ops` queued copies on `s`.
+  void run(Stream *s, std::size_t max_ops = SIZE_MAX);
+
+  std::size_t pinned_ranges() const;
+
+private:
+  struct Event {
+    Stream *stream = nullptr;
+    uint64_t target = 0;
+  };
+  bool is_pinned(const void *p, std::size_t bytes) const;
+
+  mutable std::mutex mu_;
+  std::set<std::pair<uintptr_t, std::size_t>> pinned_;
+};
+
+} // namespace gcore::rt
@@ -1,227 +1,788 @@
 #include "gcore/rt/allocator.hpp"
 
-#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <new>
+#include <string>
+#include <unistd.h>
+#include <vector>
 
 namespace gcore::rt {
 
-static constexpr uint16_t kDirectBin = 0xFFFF;
+namespace {
+
+constexpr uint16_t kDirectBin = 0xFFFF;
+
+// Magazine sizing: cache about kMagazineBytes per class and thread, bounded
+// to [kMagazineMin, kMagazineMax] blocks. Refills and drains move half a
+// magazine, so a thread alternating alloc/free at the boundary does not
+// bounce a block through the central stack every call.
+constexpr std::size_t kMagazineBytes = 1u << 20;
+constexpr uint32_t kMagazineMin = 2;
+constexpr uint32_t kMagazineMax = 64;
+
+// Slabs are 2 MiB and 2 MiB aligned, so (addr >> kSlabShift) names the slab.
+// Classes that fit fewer than kSlabMinObjects per slab get a dedicated
+// page-rounded extent per object instead (still 2 MiB aligned).
+constexpr unsigned kSlabShift = 21;
+constexpr std::size_t kSlabBytes = std::size_t{1} << kSlabShift;
+constexpr std::size_t kSlabMinObjects = 8;
+
+// Tagged stack head: low 48 bits hold the pointer (user-space addresses on
+// x86-64/AArch64), high 16 bits a counter bumped by every successful CAS.
+constexpr unsigned kAddrBits = 48;
+constexpr uint64_t kPtrMask = (1ull << kAddrBits) - 1;
+
+std::atomic<uint64_t> g_next_allocator_id{1};
+
+// Set once this thread's cache registry has been destroyed (thread exit, or
+// main-thread teardown before static allocators die). Later calls on this
+// thread bypass the magazines.
+thread_local bool tls_registry_gone = false;
+
+// One-entry lookup cache in front of the registry scan. Ids are never reused,
+// so a stale entry can only miss.
+thread_local uint64_t tls_last_id = 0;
+thread_local void *tls_last_cache = nullptr;
+
+std::size_t page_bytes() {
+  static const std::size_t page =
+      static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  return page;
+}
+
+// One mapping owned by an allocator: a slab of class objects or a single
+// direct allocation. Lives outside the mapping so blocks stay headerless.
+struct Slab {
+  uint8_t *base = nullptr;
+  std::size_t map_bytes = 0;
+  std::size_t obj_bytes = 0; // class size, or payload for direct mappings
+  uint32_t capacity = 0;
+  // Written under the class mutex; free() reads it unlocked to bound
+  // pointers, which is safe because a block is carved before it is handed out.
+  std::atomic<uint32_t> carved{0};
+  uint16_t bin = kDirectBin;
+  uint16_t arena = 0;
+  const void *owner = nullptr; // HostAllocator::Shared
+  uint32_t free_mark = 0;      // scratch for release()
+};
+
+// Two-level radix map from 2 MiB chunk to Slab. Leaves are created on demand
+// and never freed, so lookups are two lock-free loads.
+class SlabMap {
+public:
+  Slab *find(const void *p) const {
+    const uint64_t key = reinterpret_cast<uintptr_t>(p) >> kSlabShift;
+    const uint64_t r = key >> kLeafBits;
+    if (r >= kRootSize)
+      return nullptr;
+    const Leaf *leaf = root_[r].load(std::memory_order_acquire);
+    if (!leaf)
+      return nullptr;
+    return leaf->slots[key & (kLeafSize - 1)].load(std::memory_order_acquire);
+  }
+
+  bool set(const void *p, Slab *s) {
+    const uint64_t key = reinterpret_cast<uintptr_t>(p) >> kSlabShift;
+    const uint64_t r = key >> kLeafBits;
+    if (r >= kRootSize)
+      return false;
+    Leaf *leaf = root_[r].load(std::memory_order_acquire);
+    if (!leaf) {
+      Leaf *fresh = new (std::nothrow) Leaf();
+      if (!fresh)
+        return false;
+      if (root_[r].compare_exchange_strong(leaf, fresh,
+                                           std::memory_order_acq_rel))
+        leaf = fresh;
+      else
+        delete fresh;
+    }
+    leaf->slots[key & (kLeafSize - 1)].store(s, std::memory_order_release);
+    return true;
+  }
+
+private:
+  static constexpr unsigned kLeafBits = 14;
+  static constexpr std::size_t kLeafSize = std::size_t{1} << kLeafBits;
+  static constexpr std::size_t kRootSize = std::size_t{1}
+                                           << (kAddrBits - kSlabShift -
+                                               kLeafBits);
+  struct Leaf {
+    std::atomic<Slab *> slots[kLeafSize] = {};
+  };
+  std::atomic<Leaf *> root_[kRootSize] = {};
+};
+
+constinit SlabMap g_slab_map;
+
+// Central freelists move pointers in batch descriptors that are never handed
+// to callers, so a racing pop only ever reads descriptor memory.
+struct Batch {
+  Batch *next = nullptr; // accessed atomically while on a stack
+  uint32_t count = 0;
+  void *ptrs[kMagazineMax];
+};
+
+struct alignas(64) BatchStack {
+  std::atomic<uint64_t> head{0};
+
+  static Batch *ptr_of(uint64_t v) {
+    return reinterpret_cast<Batch *>(v & kPtrMask);
+  }
+  static uint64_t pack(Batch *p, uint64_t old) {
+    return (((old >> kAddrBits) + 1) << kAddrBits) |
+           (reinterpret_cast<uint64_t>(p) & kPtrMask);
+  }
+
+  void push(Batch *b) {
+    uint64_t old = head.load(std::memory_order_relaxed);
+    do {
+      __atomic_store_n(&b->next, ptr_of(old), __ATOMIC_RELAXED);
+    } while (!head.compare_exchange_weak(old, pack(b, old),
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+  }
+
+  Batch *pop() {
+    uint64_t old = head.load(std::memory_order_acquire);
+    for (;;) {
+      Batch *b = ptr_of(old);
+      if (!b)
+        return nullptr;
+      // b may already have been popped and reused; descriptors live until
+      // the allocator dies and the tag makes the CAS fail in that case.
+      Batch *next = __atomic_load_n(&b->next, __ATOMIC_RELAXED);
+      if (head.compare_exchange_weak(old, pack(next, old),
+                                     std::memory_order_acquire,
+                                     std::memory_order_acquire))
+        return b;
+    }
+  }
+
+  // Only valid when no other thread touches the stack.
+  Batch *take_all() {
+    return ptr_of(head.exchange(0, std::memory_order_acquire));
+  }
+};
+
+} // namespace
 
 std::size_t HostAllocator::align_up(std::size_t x, std::size_t a) {
   return (x + (a - 1)) & ~(a - 1);
 }
 
+struct HostAllocator::Shared {
+  struct ClassState {
+    std::mutex mu; // Guards slabs/current; taken only to carve or release
+    std::vector<Slab *> slabs;
+    Slab *current = nullptr;
+  };
+
+  // Slabs and central freelists of one NUMA node.
+  struct Arena {
+    explicit Arena(int bins)
+        : central(static_cast<size_t>(bins)),
+          classes(static_cast<size_t>(bins)) {}
+    std::vector<BatchStack> central;
+    std::vector<ClassState> classes;
+  };
+
+  Shared(int bins, int nodes) {
+    for (int n = 0; n < nodes; ++n)
+      arenas.push_back(std::make_unique<Arena>(bins));
+  }
+
+  ~Shared() {
+    for (auto &arena : arenas) {
+      for (auto &cs : arena->classes) {
+        for (Slab *s : cs.slabs) {
+          g_slab_map.set(s->base, nullptr);
+          unmap_host_memory(s->base, s->map_bytes);
+          delete s;
+        }
+      }
+    }
+  }
+
+  // Arena for the calling thread.
+  uint16_t home_arena() const {
+    if (arenas.size() == 1 || policy.placement == NumaPlacement::Interleave)
+      return 0;
+    return static_cast<uint16_t>(std::min<size_t>(
+        static_cast<size_t>(numa_current_node()), arenas.size() - 1));
+  }
+
+  Batch *get_batch() {
+    if (Batch *b = free_batches.pop())
+      return b;
+    constexpr size_t kChunk = 64;
+    std::lock_guard<std::mutex> lk(batch_mu);
+    batch_chunks.emplace_back(new Batch[kChunk]);
+    Batch *chunk = batch_chunks.back().get();
+    for (size_t i = 1; i < kChunk; ++i)
+      free_batches.push(&chunk[i]);
+    return &chunk[0];
+  }
+
+  void push_batch(int arena, int bin, void *const *ptrs, uint32_t n) {
+    if (n == 0)
+      return;
+    Batch *b = get_batch();
+    std::memcpy(b->ptrs, ptrs, n * sizeof(void *));
+    b->count = n;
+    arenas[static_cast<size_t>(arena)]->central[static_cast<size_t>(bin)].push(
+        b);
+  }
+
+  // Pop one batch into out[] (room for kMagazineMax). Returns its size.
+  uint32_t pop_batch(int arena, int bin, void **out) {
+    Batch *b = arenas[static_cast<size_t>(arena)]
+                   ->central[static_cast<size_t>(bin)]
+                   .pop();
+    if (!b)
+      return 0;
+    const uint32_t n = b->count;
+    std::memcpy(out, b->ptrs, n * sizeof(void *));
+    free_batches.push(b);
+    return n;
+  }
+
+  // Carve up to `want` fresh objects of `obj_bytes` from the class's current
+  // slab, mapping a new one when it runs out.
+  uint32_t carve(int arena, int bin, std::size_t obj_bytes, void **out,
+                 uint32_t want) {
+    ClassState &cs =
+        arenas[static_cast<size_t>(arena)]->classes[static_cast<size_t>(bin)];
+    std::lock_guard<std::mutex> lk(cs.mu);
+    uint32_t n = 0;
+    while (n < want) {
+      Slab *s = cs.current;
+      if (!s || s->carved == s->capacity) {
+        s = map_slab(arena, bin, obj_bytes);
+        if (!s)
+          break;
+        cs.slabs.push_back(s);
+        cs.current = s;
+      }
+      const uint32_t first = s->carved.load(std::memory_order_relaxed);
+      const uint32_t take = std::min(want - n, s->capacity - first);
+      for (uint32_t i = 0; i < take; ++i)
+        out[n++] = s->base + static_cast<std::size_t>(first + i) * obj_bytes;
+      s->carved.store(first + take, std::memory_order_relaxed);
+    }
+    return n;
+  }
+
+  // Map and register a slab (or a direct mapping when bin == kDirectBin).
+  // Slabs use base pages; huge pages only back direct mappings.
+  Slab *map_slab(int arena, int bin, std::size_t obj_bytes,
+                 std::size_t alignment = kSlabBytes,
+                 HugePageMode huge = HugePageMode::Off) {
+    std::size_t bytes = obj_bytes;
+    if (bin != kDirectBin)
+      bytes = obj_bytes * kSlabMinObjects <= kSlabBytes
+                  ? kSlabBytes
+                  : align_up(obj_bytes, page_bytes());
+    const HostMapping m =
+        map_host_memory(bytes, std::max(alignment, kSlabBytes), huge);
+    if (!m.base)
+      return nullptr;
+    // Placement must be set before the first touch. Arena index == node.
+    bind_host_memory(m.base, m.bytes, policy.placement, arena);
+
+    auto *s = new Slab();
+    s->base = static_cast<uint8_t *>(m.base);
+    s->map_bytes = m.bytes;
+    s->obj_bytes = bin == kDirectBin ? m.bytes : obj_bytes;
+    s->capacity = static_cast<uint32_t>(m.bytes / s->obj_bytes);
+    s->carved = bin == kDirectBin ? 1 : 0;
+    s->bin = static_cast<uint16_t>(bin);
+    s->arena = static_cast<uint16_t>(arena);
+    s->owner = this;
+    if (!g_slab_map.set(m.base, s)) {
+      unmap_host_memory(m.base, m.bytes);
+      delete s;
+      return nullptr;
+    }
+    os_allocs.fetch_add(1, std::memory_order_relaxed);
+    bytes_reserved.fetch_add(static_cast<int64_t>(m.bytes),
+                             std::memory_order_relaxed);
+    return s;
+  }
+
+  void unmap_slab(Slab *s) {
+    g_slab_map.set(s->base, nullptr);
+    unmap_host_memory(s->base, s->map_bytes);
+    bytes_reserved.fetch_sub(static_cast<int64_t>(s->map_bytes),
+                             std::memory_order_relaxed);
+    delete s;
+  }
+
+  std::vector<std::unique_ptr<Arena>> arenas; // One per NUMA node
+  Policy policy;
+
+  BatchStack free_batches;
+  std::mutex batch_mu;
+  std::vector<std::unique_ptr<Batch[]>> batch_chunks;
+
+  std::atomic<uint64_t> os_allocs{0};
+  std::atomic<int64_t> bytes_reserved{0};
+
+  // Registry of live thread caches plus counters folded in from retired ones.
+  mutable std::mutex caches_mu;
+  std::vector<ThreadCache *> caches;
+  bool alive = true;
+  uint64_t retired_alloc_calls = 0;
+  uint64_t retired_free_calls = 0;
+  uint64_t retired_reuse_hits = 0;
+  int64_t retired_bytes_in_use = 0;
+  uint64_t retired_requested = 0;
+  uint64_t retired_allocated = 0;
+
+  // Counters for calls made after this thread's caches were torn down.
+  void count_uncached(uint64_t allocs, uint64_t frees, uint64_t reuses,
+                      int64_t in_use, uint64_t requested = 0,
+                      uint64_t allocated = 0) {
+    std::lock_guard<std::mutex> lk(caches_mu);
+    retired_alloc_calls += allocs;
+    retired_free_calls += frees;
+    retired_reuse_hits += reuses;
+    retired_bytes_in_use += in_use;
+    retired_requested += requested;
+    retired_allocated += allocated;
+  }
+};
+
+struct HostAllocator::ThreadCache {
+  struct Magazine {
+    void *slots[kMagazineMax];
+    uint32_t count = 0;
+    uint32_t cap = kMagazineMin;
+  };
+
+  uint64_t owner_id = 0;
+  uint16_t arena = 0;
+  std::shared_ptr<Shared> shared;
+  std::vector<Magazine> mags;
+
+  // Written only by the owning thread; stats() reads them concurrently.
+  std::atomic<uint64_t> alloc_calls{0};
+  std::atomic<uint64_t> free_calls{0};
+  std::atomic<uint64_t> reuse_hits{0};
+  std::atomic<int64_t> bytes_in_use{0};
+  std::atomic<uint64_t> bytes_requested{0};
+  std::atomic<uint64_t> bytes_allocated{0};
+
+  template <typename T> static void bump(std::atomic<T> &c, T d) {
+    c.store(c.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+  }
+};
+
+struct HostAllocator::TlsRegistry {
+  std::vector<ThreadCache *> caches;
+  ~TlsRegistry() {
+    tls_registry_gone = true;
+    tls_last_id = 0;
+    tls_last_cache = nullptr;
+    for (ThreadCache *tc : caches)
+      HostAllocator::retire_cache(tc);
+    caches.clear();
+  }
+};
+
 HostAllocator::HostAllocator(int bin_min_pow2, int bin_max_pow2,
-                             int large_threshold_pow2)
+                             int large_threshold_pow2,
+                             int classes_per_doubling)
     : bin_min_pow2_(bin_min_pow2), bin_max_pow2_(bin_max_pow2),
-      large_threshold_pow2_(large_threshold_pow2) {
+      large_threshold_pow2_(large_threshold_pow2),
+      id_(g_next_allocator_id.fetch_add(1, std::memory_order_relaxed)) {
   if (bin_min_pow2_ < 4)
     bin_min_pow2_ = 4;
   if (bin_max_pow2_ < bin_min_pow2_)
     bin_max_pow2_ = bin_min_pow2_;
+  if (bin_max_pow2_ > static_cast<int>(kSlabShift))
+    bin_max_pow2_ = static_cast<int>(kSlabShift);
   if (large_threshold_pow2_ < bin_min_pow2_)
     large_threshold_pow2_ = bin_max_pow2_;
 
-  bin_count_ = (bin_max_pow2_ - bin_min_pow2_) + 1;
-  freelists_.assign(static_cast<size_t>(bin_count_), nullptr);
+  // Steps must stay whole multiples of 16 bytes (the minimum alignment).
+  const unsigned per = std::bit_floor(static_cast<unsigned>(
+      std::clamp(classes_per_doubling, 1, 8)));
+  class_shift_ = std::countr_zero(per);
+  class_shift_ = std::min(class_shift_, bin_min_pow2_ - 4);
+
+  bin_count_ = ((bin_max_pow2_ - bin_min_pow2_) << class_shift_) + 1;
+  shared_ = std::make_shared<Shared>(bin_count_, numa_node_count());
+
+  Policy policy;
+  if (const char *v = std::getenv("GRETA_HOST_NUMA"))
+    parse_numa_placement(v, &policy.placement);
+  if (const char *v = std::getenv("GRETA_HOST_HUGEPAGES"))
+    parse_huge_page_mode(v, &policy.huge_pages);
+  shared_->policy = policy;
 }
 
-HostAllocator::~HostAllocator() { release(); }
+HostAllocator::~HostAllocator() {
+  release();
+  // Caches of threads that are still running keep shared_ alive; the slabs
+  // are unmapped when the last of them exits.
+  std::lock_guard<std::mutex> lk(shared_->caches_mu);
+  shared_->alive = false;
+}
 
-int HostAllocator::size_to_bin(std::size_t size) const {
-  // include header overhead in bin sizing
-  const std::size_t need = size;
-  // find smallest pow2 >= need
-  std::size_t s = 1ull << static_cast<unsigned>(bin_min_pow2_);
-  int bin = 0;
-  while (s < need && (bin_min_pow2_ + bin) < bin_max_pow2_) {
-    s <<= 1;
-    bin++;
+void HostAllocator::set_policy(const Policy &policy) {
+  shared_->policy = policy;
+}
+
+HostAllocator::Policy HostAllocator::policy() const { return shared_->policy; }
+
+int HostAllocator::size_to_bin(std::size_t size,
+                               std::size_t alignment) const {
+  const std::size_t min_size = std::size_t{1} << bin_min_pow2_;
+  int bin;
+  if (size <= min_size) {
+    bin = 0;
+  } else {
+    // 2^p < size <= 2^(p+1); the doubling above 2^p has 2^class_shift_ steps.
+    const int p = static_cast<int>(std::bit_width(size - 1)) - 1;
+    if (p >= bin_max_pow2_)
+      return -1;
+    const std::size_t base = std::size_t{1} << p;
+    const std::size_t step = base >> class_shift_;
+    const std::size_t idx = (size - base + step - 1) / step; // 1..steps
+    bin = ((p - bin_min_pow2_) << class_shift_) + static_cast<int>(idx);
   }
-  return bin;
+  // Objects sit at multiples of the class size inside an aligned slab.
+  while (bin < bin_count_ && (bin_to_size(bin) & (alignment - 1)) != 0)
+    ++bin;
+  return bin < bin_count_ ? bin : -1;
 }
 
 std::size_t HostAllocator::bin_to_size(int bin) const {
-  return 1ull << static_cast<unsigned>(bin_min_pow2_ + bin);
+  const int doubling = bin >> class_shift_;
+  const std::size_t step_idx =
+      static_cast<std::size_t>(bin & ((1 << class_shift_) - 1));
+  const std::size_t base = std::size_t{1}
+                           << static_cast<unsigned>(bin_min_pow2_ + doubling);
+  return base + step_idx * (base >> class_shift_);
 }
 
-void *HostAllocator::os_alloc(std::size_t bytes, std::size_t alignment) {
-  // We need space for header + payload with requested alignment.
-  // We'll allocate a base pointer aligned at least to alignment.
-  void *p = nullptr;
-  const std::size_t a = std::max<std::size_t>(alignment, 64);
-  if (posix_memalign(&p, a, bytes) != 0)
+void HostAllocator::count_in_use(ThreadCache *tc, int64_t delta) {
+  if (tc)
+    ThreadCache::bump<int64_t>(tc->bytes_in_use, delta);
+  else
+    shared_->count_uncached(0, 0, 0, delta);
+}
+
+void HostAllocator::count_alloc(ThreadCache *tc, std::size_t requested,
+                                std::size_t allocated, bool reused) {
+  if (tc) {
+    if (reused)
+      ThreadCache::bump<uint64_t>(tc->reuse_hits, 1);
+    ThreadCache::bump<int64_t>(tc->bytes_in_use,
+                               static_cast<int64_t>(allocated));
+    ThreadCache::bump<uint64_t>(tc->bytes_requested, requested);
+    ThreadCache::bump<uint64_t>(tc->bytes_allocated, allocated);
+  } else {
+    shared_->count_uncached(0, 0, reused ? 1 : 0,
+                            static_cast<int64_t>(allocated), requested,
+                            allocated);
+  }
+}
+
+HostAllocator::ThreadCache *HostAllocator::local_cache(bool create) {
+  if (tls_last_id == id_)
+    return static_cast<ThreadCache *>(tls_last_cache);
+  if (tls_registry_gone)
     return nullptr;
-  return p;
+  static thread_local TlsRegistry registry;
+  for (ThreadCache *tc : registry.caches) {
+    if (tc->owner_id == id_) {
+      tls_last_id = id_;
+      tls_last_cache = tc;
+      return tc;
+    }
+  }
+  if (!create)
+    return nullptr;
+
+  // Drop entries of allocators that have since been destroyed.
+  auto &list = registry.caches;
+  for (size_t i = 0; i < list.size();) {
+    bool dead;
+    {
+      std::lock_guard<std::mutex> lk(list[i]->shared->caches_mu);
+      dead = !list[i]->shared->alive;
+    }
+    if (dead) {
+      if (tls_last_cache == list[i]) {
+        tls_last_id = 0;
+        tls_last_cache = nullptr;
+      }
+      retire_cache(list[i]);
+      list.erase(list.begin() + static_cast<std::ptrdiff_t>(i));
+    } else {
+      ++i;
+    }
+  }
+
+  auto *tc = new ThreadCache();
+  tc->owner_id = id_;
+  tc->arena = shared_->home_arena();
+  tc->shared = shared_;
+  tc->mags.resize(static_cast<size_t>(bin_count_));
+  for (int bin = 0; bin < bin_count_; ++bin) {
+    const std::size_t cap = kMagazineBytes / bin_to_size(bin);
+    tc->mags[static_cast<size_t>(bin)].cap = static_cast<uint32_t>(
+        std::clamp<std::size_t>(cap, kMagazineMin, kMagazineMax));
+  }
+  {
+    std::lock_guard<std::mutex> lk(shared_->caches_mu);
+    shared_->caches.push_back(tc);
+  }
+  list.push_back(tc);
+  tls_last_id = id_;
+  tls_last_cache = tc;
+  return tc;
 }
 
-void HostAllocator::os_free(void *base) { std::free(base); }
+void HostAllocator::retire_cache(ThreadCache *tc) {
+  Shared &sh = *tc->shared;
+  {
+    std::lock_guard<std::mutex> lk(sh.caches_mu);
+    auto it = std::find(sh.caches.begin(), sh.caches.end(), tc);
+    if (it != sh.caches.end())
+      sh.caches.erase(it);
+    sh.retired_alloc_calls += tc->alloc_calls.load(std::memory_order_relaxed);
+    sh.retired_free_calls += tc->free_calls.load(std::memory_order_relaxed);
+    sh.retired_reuse_hits += tc->reuse_hits.load(std::memory_order_relaxed);
+    sh.retired_bytes_in_use +=
+        tc->bytes_in_use.load(std::memory_order_relaxed);
+    sh.retired_requested += tc->bytes_requested.load(std::memory_order_relaxed);
+    sh.retired_allocated += tc->bytes_allocated.load(std::memory_order_relaxed);
+
+    // Once the allocator is gone its slabs die with Shared; nothing to hand
+    // back.
+    if (sh.alive) {
+      for (size_t bin = 0; bin < tc->mags.size(); ++bin) {
+        auto &m = tc->mags[bin];
+        sh.push_batch(tc->arena, static_cast<int>(bin), m.slots, m.count);
+        m.count = 0;
+      }
+    }
+  }
+  delete tc;
+}
 
 void *HostAllocator::alloc(std::size_t size, std::size_t alignment) {
   if (size == 0)
     size = 1;
 
-  const std::size_t a = std::max<std::size_t>(alignment, 64);
-  const std::size_t header_bytes = align_up(sizeof(BlockHeader), 64);
-  const std::size_t need_payload = align_up(size, a);
-  const std::size_t need_total = header_bytes + need_payload;
+  const std::size_t a = std::max<std::size_t>(alignment, 16);
 
-  std::lock_guard<std::mutex> lk(mu_);
-  stats_.alloc_calls++;
+  ThreadCache *tc = local_cache();
+  if (tc)
+    ThreadCache::bump<uint64_t>(tc->alloc_calls, 1);
+  else
+    shared_->count_uncached(1, 0, 0, 0);
 
-  // Large allocations bypass bins
+  // Large allocations bypass classes
   const std::size_t large_threshold =
       1ull << static_cast<unsigned>(large_threshold_pow2_);
-  if (need_payload >= large_threshold) {
-    void *base = os_alloc(need_total, a);
-    if (!base)
+  int bin = -1;
+  if (size < large_threshold)
+    bin = size_to_bin(size, a);
+
+  if (bin < 0) {
+    const Policy &pol = shared_->policy;
+    const HugePageMode huge = size >= kHugePageBytes ? pol.huge_pages
+                                                     : HugePageMode::Off;
+    Slab *s = shared_->map_slab(shared_->home_arena(), kDirectBin, size, a,
+                                huge);
+    if (!s)
       return nullptr;
-
-    stats_.os_allocs++;
-    stats_.bytes_reserved += need_total;
-    stats_.bytes_in_use += need_payload;
-
-    auto *h = reinterpret_cast<BlockHeader *>(base);
-    std::memset(h, 0, header_bytes);
-    h->magic = kMagic;
-    h->bin_index = kDirectBin;
-    h->requested = size;
-    h->allocated = need_payload;
-    h->next = nullptr;
-
-    return reinterpret_cast<void *>(reinterpret_cast<std::uint8_t *>(base) +
-                                    header_bytes);
+    count_alloc(tc, size, s->obj_bytes, false);
+    return s->base;
   }
 
-  const int bin = size_to_bin(need_payload);
-  if (bin < 0 || bin >= bin_count_) {
-    // Should not happen with thresholds, but fallback direct
-    void *base = os_alloc(need_total, a);
-    if (!base)
-      return nullptr;
-
-    stats_.os_allocs++;
-    stats_.bytes_reserved += need_total;
-    stats_.bytes_in_use += need_payload;
-
-    auto *h = reinterpret_cast<BlockHeader *>(base);
-    std::memset(h, 0, header_bytes);
-    h->magic = kMagic;
-    h->bin_index = kDirectBin;
-    h->requested = size;
-    h->allocated = need_payload;
-    h->next = nullptr;
-
-    return reinterpret_cast<void *>(reinterpret_cast<std::uint8_t *>(base) +
-                                    header_bytes);
-  }
-
-  const std::size_t bin_payload = bin_to_size(bin);
-  const std::size_t total = header_bytes + bin_payload;
+  const std::size_t obj_bytes = bin_to_size(bin);
 
-  // Try freelist
-  if (freelists_[static_cast<size_t>(bin)] != nullptr) {
-    BlockHeader *h = freelists_[static_cast<size_t>(bin)];
-    freelists_[static_cast<size_t>(bin)] = h->next;
-    h->next = nullptr;
-
-    stats_.reuse_hits++;
-    stats_.bytes_in_use += bin_payload;
-
-    // payload pointer
-    return reinterpret_cast<void *>(reinterpret_cast<std::uint8_t *>(h) +
-                                    header_bytes);
+  // Magazine first, then one batch from the central stack, then carve.
+  if (tc) {
+    auto &m = tc->mags[static_cast<size_t>(bin)];
+    if (m.count > 0) {
+      count_alloc(tc, size, obj_bytes, true);
+      return m.slots[--m.count];
+    }
+    m.count = shared_->pop_batch(tc->arena, bin, m.slots);
+    const bool reused = m.count > 0;
+    if (!reused)
+      m.count = shared_->carve(tc->arena, bin, obj_bytes, m.slots,
+                               std::max<uint32_t>(1, m.cap / 2));
+    if (m.count == 0)
+      return nullptr;
+    count_alloc(tc, size, obj_bytes, reused);
+    return m.slots[--m.count];
   }
 
-  // OS allocate new
-  void *base = os_alloc(total, a);
-  if (!base)
+  const int arena = shared_->home_arena();
+  void *batch[kMagazineMax];
+  const uint32_t n = shared_->pop_batch(arena, bin, batch);
+  void *p = nullptr;
+  if (n > 0) {
+    p = batch[n - 1];
+    shared_->push_batch(arena, bin, batch, n - 1);
+  } else if (shared_->carve(arena, bin, obj_bytes, &p, 1) == 0) {
     return nullptr;
-
-  stats_.os_allocs++;
-  stats_.bytes_reserved += total;
-  stats_.bytes_in_use += bin_payload;
-
-  auto *h = reinterpret_cast<BlockHeader *>(base);
-  std::memset(h, 0, header_bytes);
-  h->magic = kMagic;
-  h->bin_index = static_cast<uint16_t>(bin);
-  h->requested = size;
-  h->allocated = bin_payload;
-  h->next = nullptr;
-
-  return reinterpret_cast<void *>(reinterpret_cast<std::uint8_t *>(base) +
-                                  header_bytes);
+  }
+  count_alloc(tc, size, obj_bytes, n > 0);
+  return p;
 }
 
 void HostAllocator::free(void *p) {
   if (!p)
     return;
 
-  const std::size_t header_bytes = align_up(sizeof(BlockHeader), 64);
-  auto *base = reinterpret_cast<std::uint8_t *>(p) - header_bytes;
-  auto *h = reinterpret_cast<BlockHeader *>(base);
-
-  std::lock_guard<std::mutex> lk(mu_);
-  stats_.free_calls++;
+  ThreadCache *tc = local_cache();
+  if (tc)
+    ThreadCache::bump<uint64_t>(tc->free_calls, 1);
+  else
+    shared_->count_uncached(0, 1, 0, 0);
 
-  if (h->magic != kMagic) {
-    // Not a GRETA block: ignore hard fail in v1 (could be UB); we choose
-    // safety. In debug builds, this could assert.
+  Slab *s = g_slab_map.find(p);
+  if (!s || s->owner != shared_.get()) {
+    // Not one of ours: ignore rather than corrupt a freelist.
     return;
   }
+  // Interior pointers are not ours either: for a direct slab that would
+  // unmap a live mapping, for a bin it would hand out an overlapping block.
+  // Neither is the rest of the 2 MiB chunk past what the slab carved: not
+  // handed out yet, or not even mapped for a per-object slab.
+  const std::ptrdiff_t off = static_cast<uint8_t *>(p) - s->base;
+  if (s->bin == kDirectBin) {
+    if (off != 0)
+      return;
+  } else {
+    const std::ptrdiff_t obj = static_cast<std::ptrdiff_t>(s->obj_bytes);
+    const std::ptrdiff_t carved =
+        static_cast<std::ptrdiff_t>(s->carved.load(std::memory_order_relaxed));
+    if (off < 0 || off % obj != 0 || off / obj >= carved)
+      return;
+  }
 
-  const uint16_t bin = h->bin_index;
-  const std::size_t payload = static_cast<std::size_t>(h->allocated);
-  if (stats_.bytes_in_use >= payload)
-    stats_.bytes_in_use -= payload;
+  count_in_use(tc, -static_cast<int64_t>(s->obj_bytes));
 
-  if (bin == kDirectBin) {
-    // direct free to OS
-    const std::size_t total = header_bytes + payload;
-    // bytes_reserved tracks OS allocations; reduce on free
-    if (stats_.bytes_reserved >= total)
-      stats_.bytes_reserved -= total;
-    os_free(base);
+  if (s->bin == kDirectBin) {
+    shared_->unmap_slab(s);
     return;
   }
 
-  if (bin >= static_cast<uint16_t>(bin_count_)) {
-    // corrupt bin index -> safest: free to OS
-    const std::size_t total = header_bytes + payload;
-    if (stats_.bytes_reserved >= total)
-      stats_.bytes_reserved -= total;
-    os_free(base);
+  // Blocks go back to the arena that owns their slab; remote ones skip the
+  // magazine.
+  const int bin = s->bin;
+  if (!tc || s->arena != tc->arena) {
+    shared_->push_batch(s->arena, bin, &p, 1);
     return;
   }
 
-  // push to freelist
-  h->next = freelists_[static_cast<size_t>(bin)];
-  freelists_[static_cast<size_t>(bin)] = h;
+  // Full magazine: hand the older half to the central stack as one batch.
+  auto &m = tc->mags[static_cast<size_t>(bin)];
+  if (m.count == m.cap) {
+    const uint32_t n = std::max<uint32_t>(1, m.cap / 2);
+    shared_->push_batch(tc->arena, bin, m.slots, n);
+    std::memmove(m.slots, m.slots + n, (m.count - n) * sizeof(m.slots[0]));
+    m.count -= n;
+  }
+  m.slots[m.count++] = p;
 }
 
 HostAllocator::Stats HostAllocator::stats() const {
-  std::lock_guard<std::mutex> lk(mu_);
-  return stats_;
+  Stats st;
+  const Shared &sh = *shared_;
+  std::lock_guard<std::mutex> lk(sh.caches_mu);
+  int64_t in_use = sh.retired_bytes_in_use;
+  st.alloc_calls = sh.retired_alloc_calls;
+  st.free_calls = sh.retired_free_calls;
+  st.reuse_hits = sh.retired_reuse_hits;
+  st.bytes_requested_total = sh.retired_requested;
+  st.bytes_allocated_total = sh.retired_allocated;
+  for (const ThreadCache *tc : sh.caches) {
+    st.alloc_calls += tc->alloc_calls.load(std::memory_order_relaxed);
+    st.free_calls += tc->free_calls.load(std::memory_order_relaxed);
+    st.reuse_hits += tc->reuse_hits.load(std::memory_order_relaxed);
+    in_use += tc->bytes_in_use.load(std::memory_order_relaxed);
+    st.bytes_requested_total +=
+        tc->bytes_requested.load(std::memory_order_relaxed);
+    st.bytes_allocated_total +=
+        tc->bytes_allocated.load(std::memory_order_relaxed);
+  }
+  st.os_allocs = sh.os_allocs.load(std::memory_order_relaxed);
+  st.bytes_in_use = in_use > 0 ? static_cast<uint64_t>(in_use) : 0;
+  const int64_t reserved = sh.bytes_reserved.load(std::memory_order_relaxed);
+  st.bytes_reserved = reserved > 0 ? static_cast<uint64_t>(reserved) : 0;
+  return st;
 }
 
 void HostAllocator::release() {
-  const std::size_t header_bytes = align_up(sizeof(BlockHeader), 64);
-
-  std::lock_guard<std::mutex> lk(mu_);
-  for (int bin = 0; bin < bin_count_; bin++) {
-    BlockHeader *h = freelists_[static_cast<size_t>(bin)];
-    freelists_[static_cast<size_t>(bin)] = nullptr;
-    while (h) {
-      BlockHeader *next = h->next;
-      const std::size_t payload = static_cast<std::size_t>(h->allocated);
-      const std::size_t total = header_bytes + payload;
-      if (stats_.bytes_reserved >= total)
-        stats_.bytes_reserved -= total;
-      os_free(reinterpret_cast<void *>(h));
-      h = next;
+  Shared &sh = *shared_;
+
+  // Move this thread's magazines to the central stacks first.
+  if (ThreadCache *tc = local_cache(false)) {
+    for (int bin = 0; bin < bin_count_; bin++) {
+      auto &m = tc->mags[static_cast<size_t>(bin)];
+      sh.push_batch(tc->arena, bin, m.slots, m.count);
+      m.count = 0;
+    }
+  }
+
+  // Per class: count free objects per slab, unmap slabs with nothing carved
+  // still live, and put the rest back on the central stack.
+  std::vector<void *> free_objs;
+  std::vector<void *> keep;
+  for (size_t arena = 0; arena < sh.arenas.size(); ++arena) {
+    Shared::Arena &ar = *sh.arenas[arena];
+    for (int bin = 0; bin < bin_count_; bin++) {
+      auto &cs = ar.classes[static_cast<size_t>(bin)];
+      std::lock_guard<std::mutex> lk(cs.mu);
+
+      free_objs.clear();
+      for (Batch *b = ar.central[static_cast<size_t>(bin)].take_all(); b;) {
+        Batch *next = b->next;
+        free_objs.insert(free_objs.end(), b->ptrs, b->ptrs + b->count);
+        sh.free_batches.push(b);
+        b = next;
+      }
+      for (void *p : free_objs)
+        g_slab_map.find(p)->free_mark++;
+
+      keep.clear();
+      for (void *p : free_objs) {
+        const Slab *s = g_slab_map.find(p);
+        if (s->free_mark != s->carved)
+          keep.push_back(p);
+      }
+      auto dead = std::stable_partition(
+          cs.slabs.begin(), cs.slabs.end(),
+          [](const Slab *s) { return s->free_mark != s->carved; });
+      for (auto it = dead; it != cs.slabs.end(); ++it) {
+        if (*it == cs.current)
+          cs.current = nullptr;
+        sh.unmap_slab(*it);
+      }
+      cs.slabs.erase(dead, cs.slabs.end());
+      for (Slab *s : cs.slabs)
+        s->free_mark = 0;
+
+      for (size_t i = 0; i < keep.size(); i += kMagazineMax) {
+        const size_t n = std::min<size_t>(kMagazineMax, keep.size() - i);
+        sh.push_batch(static_cast<int>(arena), bin, keep.data() + i,
+                      static_cast<uint32_t>(n));
+      }
     }
   }
 }
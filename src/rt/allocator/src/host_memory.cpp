@@ -0,0 +1,195 @@
+#include "gcore/rt/host_memory.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace gcore::rt {
+
+static std::size_t page_size() {
+  static const std::size_t page =
+      static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  return page;
+}
+
+static std::size_t round_up(std::size_t x, std::size_t a) {
+  return (x + (a - 1)) & ~(a - 1);
+}
+
+// Over-map by the alignment and trim both ends.
+static void *map_aligned(std::size_t bytes, std::size_t alignment) {
+  const std::size_t span = bytes + alignment;
+  void *raw = mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED)
+    return nullptr;
+  const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+  const uintptr_t aligned = round_up(start, alignment);
+  if (aligned > start)
+    munmap(raw, aligned - start);
+  const std::size_t tail = start + span - (aligned + bytes);
+  if (tail)
+    munmap(reinterpret_cast<void *>(aligned + bytes), tail);
+  return reinterpret_cast<void *>(aligned);
+}
+
+HostMapping map_host_memory(std::size_t bytes, std::size_t alignment,
+                            HugePageMode huge) {
+  HostMapping m;
+  alignment = std::max(alignment, page_size());
+  if (huge == HugePageMode::Off) {
+    m.bytes = round_up(bytes, page_size());
+    m.base = map_aligned(m.bytes, alignment);
+    return m;
+  }
+
+  m.bytes = round_up(bytes, kHugePageBytes);
+  alignment = std::max(alignment, kHugePageBytes);
+  if (huge == HugePageMode::Explicit && alignment == kHugePageBytes) {
+    // hugetlb mappings come back aligned to the huge page size.
+    void *p = mmap(nullptr, m.bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                       (21 << MAP_HUGE_SHIFT),
+                   -1, 0);
+    if (p != MAP_FAILED) {
+      m.base = p;
+      m.hugetlb = true;
+      return m;
+    }
+    // No reserved pool (vm.nr_hugepages == 0): fall back to THP.
+  }
+  m.base = map_aligned(m.bytes, alignment);
+  if (m.base)
+    madvise(m.base, m.bytes, MADV_HUGEPAGE);
+  return m;
+}
+
+void unmap_host_memory(void *base, std::size_t bytes) {
+  if (base)
+    munmap(base, bytes);
+}
+
+int numa_node_count() {
+  static const int count = [] {
+    // Format: "0", "0-1", "0-3,6" ...
+    std::ifstream f("/sys/devices/system/node/online");
+    std::string s;
+    if (!(f >> s))
+      return 1;
+    int max_node = 0;
+    for (size_t i = 0; i < s.size();) {
+      size_t j = i;
+      while (j < s.size() && s[j] >= '0' && s[j] <= '9')
+        ++j;
+      if (j > i)
+        max_node = std::max(max_node, std::stoi(s.substr(i, j - i)));
+      i = j + 1;
+    }
+    return max_node + 1;
+  }();
+  return count;
+}
+
+int numa_current_node() {
+  unsigned cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+    return 0;
+  return static_cast<int>(node);
+}
+
+bool bind_host_memory(void *base, std::size_t bytes, NumaPlacement placement,
+                      int node) {
+  const int nodes = numa_node_count();
+  if (!base || placement == NumaPlacement::FirstTouch || nodes <= 1)
+    return true;
+
+  constexpr int kMaskBits = 1024;
+  unsigned long mask[kMaskBits / (8 * sizeof(unsigned long))] = {};
+  auto set_bit = [&](int n) {
+    if (n >= 0 && n < kMaskBits)
+      mask[n / (8 * sizeof(unsigned long))] |=
+          1ul << (n % (8 * sizeof(unsigned long)));
+  };
+  int mode;
+  if (placement == NumaPlacement::Local) {
+    set_bit(node < 0 ? numa_current_node() : node);
+    mode = MPOL_BIND;
+  } else {
+    for (int n = 0; n < nodes; ++n)
+      set_bit(n);
+    mode = MPOL_INTERLEAVE;
+  }
+  return syscall(SYS_mbind, base, bytes, mode, mask,
+                 static_cast<unsigned long>(kMaskBits), 0) == 0;
+}
+
+std::size_t host_anon_huge_bytes() {
+  std::ifstream f("/proc/self/smaps_rollup");
+  std::string key;
+  std::size_t kib = 0;
+  while (f >> key) {
+    if (key == "AnonHugePages:") {
+      f >> kib;
+      return kib * 1024;
+    }
+    f.ignore(4096, '\n');
+  }
+  return 0;
+}
+
+bool parse_huge_page_mode(const std::string &s, HugePageMode *out) {
+  if (s == "off" || s == "0" || s == "4k")
+    *out = HugePageMode::Off;
+  else if (s == "thp" || s == "1" || s == "transparent")
+    *out = HugePageMode::Transparent;
+  else if (s == "explicit" || s == "hugetlb")
+    *out = HugePageMode::Explicit;
+  else
+    return false;
+  return true;
+}
+
+bool parse_numa_placement(const std::string &s, NumaPlacement *out) {
+  if (s == "first-touch" || s == "off" || s == "0")
+    *out = NumaPlacement::FirstTouch;
+  else if (s == "local" || s == "bind")
+    *out = NumaPlacement::Local;
+  else if (s == "interleave")
+    *out = NumaPlacement::Interleave;
+  else
+    return false;
+  return true;
+}
+
+const char *huge_page_mode_name(HugePageMode mode) {
+  switch (mode) {
+  case HugePageMode::Off:
+    return "off";
+  case HugePageMode::Transparent:
+    return "thp";
+  case HugePageMode::Explicit:
+    return "explicit";
+  }
+  return "?";
+}
+
+const char *numa_placement_name(NumaPlacement placement) {
+  switch (placement) {
+  case NumaPlacement::FirstTouch:
+    return "first-touch";
+  case NumaPlacement::Local:
+    return "local";
+  case NumaPlacement::Interleave:
+    return "interleave";
+  }
+  return "?";
+}
+
+} // namespace gcore::rt
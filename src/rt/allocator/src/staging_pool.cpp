@@ -0,0 +1,370 @@
+#include "gcore/rt/staging_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace gcore::rt {
+
+namespace {
+
+constexpr unsigned kMinClassShift = 16; // 64 KiB
+constexpr std::size_t kStagingAlignment = 4096;
+
+} // namespace
+
+StagingPool::StagingPool(StagingBackend *backend, std::size_t max_pinned_bytes,
+                         std::size_t chunk_bytes)
+    : backend_(backend), max_pinned_bytes_(max_pinned_bytes),
+      chunk_bytes_(std::bit_ceil(std::max(chunk_bytes, kMinClassBytes))) {}
+
+StagingPool::~StagingPool() {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (StagingBuffer *buf : busy_) {
+    backend_->wait(buf->event, nullptr);
+    destroy_locked(buf);
+  }
+  busy_.clear();
+  for (auto &list : idle_) {
+    for (StagingBuffer *buf : list)
+      destroy_locked(buf);
+    list.clear();
+  }
+}
+
+int StagingPool::size_to_class(std::size_t bytes) {
+  if (bytes <= kMinClassBytes)
+    return 0;
+  return std::bit_width(bytes - 1) - static_cast<int>(kMinClassShift);
+}
+
+std::size_t StagingPool::class_to_size(int cls) {
+  return std::size_t{1} << (kMinClassShift + static_cast<unsigned>(cls));
+}
+
+void StagingPool::reap_locked() {
+  auto done = [&](StagingBuffer *buf) {
+    if (!backend_->query(buf->event))
+      return false;
+    stats_.bytes_busy -= buf->capacity;
+    idle_[buf->size_class].push_back(buf);
+    return true;
+  };
+  busy_.erase(std::remove_if(busy_.begin(), busy_.end(), done), busy_.end());
+}
+
+void StagingPool::destroy_locked(StagingBuffer *buf) {
+  backend_->unpin(buf->data);
+  if (buf->event)
+    backend_->destroy_event(buf->event);
+  host_.free(buf->data);
+  stats_.bytes_pinned -= buf->capacity;
+  delete buf;
+}
+
+bool StagingPool::record_locked(StagingBuffer *buf, void *stream,
+                                std::string *err) {
+  if (!buf->event) {
+    buf->event = backend_->create_event(err);
+    if (!buf->event)
+      return false;
+  }
+  return backend_->record(buf->event, stream, err);
+}
+
+StagingBuffer *StagingPool::acquire(std::size_t bytes, std::string *err) {
+  const int cls = size_to_class(bytes);
+  const std::size_t cap = class_to_size(cls);
+
+  std::lock_guard<std::mutex> lock(mu_);
+  if (idle_.size() <= static_cast<std::size_t>(cls))
+    idle_.resize(cls + 1);
+  stats_.acquires++;
+
+  for (;;) {
+    reap_locked();
+    auto &list = idle_[cls];
+    if (!list.empty()) {
+      StagingBuffer *buf = list.back();
+      list.pop_back();
+      stats_.reuse_hits++;
+      return buf;
+    }
+    if (stats_.bytes_pinned + cap <= max_pinned_bytes_)
+      break;
+    // Over budget: drop idle buffers of other classes, then wait for the
+    // oldest in-flight one. With nothing in flight every buffer is checked
+    // out, so go over budget rather than block forever.
+    for (auto &other : idle_) {
+      while (!other.empty() && stats_.bytes_pinned + cap > max_pinned_bytes_) {
+        destroy_locked(other.back());
+        other.pop_back();
+      }
+    }
+    if (stats_.bytes_pinned + cap <= max_pinned_bytes_ || busy_.empty())
+      break;
+    stats_.stalls++;
+    if (!backend_->wait(busy_.front()->event, err))
+      return nullptr;
+  }
+
+  void *p = host_.alloc(cap, kStagingAlignment);
+  if (!p) {
+    if (err)
+      *err = "staging buffer allocation failed (" + std::to_string(cap) +
+             " bytes)";
+    return nullptr;
+  }
+  if (!backend_->pin(p, cap, err)) {
+    host_.free(p);
+    return nullptr;
+  }
+  auto *buf = new StagingBuffer;
+  buf->data = p;
+  buf->capacity = cap;
+  buf->size_class = cls;
+  stats_.pins++;
+  stats_.bytes_pinned += cap;
+  return buf;
+}
+
+void StagingPool::release(StagingBuffer *buf) {
+  if (!buf)
+    return;
+  std::lock_guard<std::mutex> lock(mu_);
+  idle_[buf->size_class].push_back(buf);
+}
+
+bool StagingPool::release_after(StagingBuffer *buf, void *stream,
+                                std::string *err) {
+  if (!buf)
+    return true;
+  std::lock_guard<std::mutex> lock(mu_);
+  if (!record_locked(buf, stream, err)) {
+    // No event to track the copy: drain the stream before reusing.
+    backend_->sync(stream, nullptr);
+    idle_[buf->size_class].push_back(buf);
+    return false;
+  }
+  busy_.push_back(buf);
+  stats_.bytes_busy += buf->capacity;
+  return true;
+}
+
+bool StagingPool::upload(void *dst_dev, const void *src, std::size_t bytes,
+                         void *stream, std::string *err) {
+  auto *dst = static_cast<uint8_t *>(dst_dev);
+  const auto *s = static_cast<const uint8_t *>(src);
+  for (std::size_t off = 0; off < bytes;) {
+    const std::size_t n = std::min(chunk_bytes_, bytes - off);
+    StagingBuffer *buf = acquire(n, err);
+    if (!buf)
+      return false;
+    std::memcpy(buf->data, s + off, n);
+    if (!backend_->copy_async(dst + off, buf->data, n,
+                              StagingCopyKind::HostToDevice, stream, err)) {
+      release(buf);
+      return false;
+    }
+    if (!release_after(buf, stream, err))
+      return false;
+    off += n;
+  }
+  return true;
+}
+
+StagingBuffer *StagingPool::download_async(const void *src_dev,
+                                           std::size_t bytes, void *stream,
+                                           std::string *err) {
+  StagingBuffer *buf = acquire(bytes, err);
+  if (!buf)
+    return nullptr;
+  if (!backend_->copy_async(buf->data, src_dev, bytes,
+                            StagingCopyKind::DeviceToHost, stream, err)) {
+    release(buf);
+    return nullptr;
+  }
+  bool ok;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ok = record_locked(buf, stream, err);
+  }
+  if (!ok) {
+    backend_->sync(stream, nullptr);
+    release(buf);
+    return nullptr;
+  }
+  return buf;
+}
+
+bool StagingPool::wait(StagingBuffer *buf, std::string *err) {
+  return buf && buf->event && backend_->wait(buf->event, err);
+}
+
+bool StagingPool::download(void *dst_host, const void *src_dev,
+                           std::size_t bytes, void *stream, std::string *err) {
+  struct Pending {
+    StagingBuffer *buf;
+    std::size_t off;
+    std::size_t n;
+  };
+  auto *dst = static_cast<uint8_t *>(dst_host);
+  const auto *src = static_cast<const uint8_t *>(src_dev);
+
+  // Keep two chunks in flight: copy one out while the next is transferred.
+  Pending q[2];
+  int head = 0, count = 0;
+  bool ok = true;
+  auto drain_one = [&]() {
+    Pending &p = q[head];
+    if (ok && !wait(p.buf, err))
+      ok = false;
+    if (ok)
+      std::memcpy(dst + p.off, p.buf->data, p.n);
+    release(p.buf);
+    head ^= 1;
+    --count;
+  };
+
+  for (std::size_t off = 0; ok && off < bytes;) {
+    const std::size_t n = std::min(chunk_bytes_, bytes - off);
+    if (count == 2)
+      drain_one();
+    StagingBuffer *buf = download_async(src + off, n, stream, err);
+    if (!buf) {
+      ok = false;
+      break;
+    }
+    q[(head + count) & 1] = {buf, off, n};
+    ++count;
+    off += n;
+  }
+  while (count > 0)
+    drain_one();
+  return ok;
+}
+
+StagingPool::Stats StagingPool::stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return stats_;
+}
+
+void StagingPool::trim() {
+  std::lock_guard<std::mutex> lock(mu_);
+  reap_locked();
+  for (auto &list : idle_) {
+    for (StagingBuffer *buf : list)
+      destroy_locked(buf);
+    list.clear();
+  }
+  host_.release();
+}
+
+// ---------------------------------------------------------------------------
+// CpuStagingBackend
+
+bool CpuStagingBackend::pin(void *p, std::size_t bytes, std::string *err) {
+  if (!p || bytes == 0) {
+    if (err)
+      *err = "pin: empty range";
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  pinned_.emplace(reinterpret_cast<uintptr_t>(p), bytes);
+  return true;
+}
+
+void CpuStagingBackend::unpin(void *p) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = pinned_.lower_bound({reinterpret_cast<uintptr_t>(p), 0});
+  if (it != pinned_.end() && it->first == reinterpret_cast<uintptr_t>(p))
+    pinned_.erase(it);
+}
+
+bool CpuStagingBackend::is_pinned(const void *p, std::size_t bytes) const {
+  const uintptr_t a = reinterpret_cast<uintptr_t>(p);
+  auto it = pinned_.upper_bound({a, SIZE_MAX});
+  if (it == pinned_.begin())
+    return false;
+  --it;
+  return a >= it->first && a + bytes <= it->first + it->second;
+}
+
+std::size_t CpuStagingBackend::pinned_ranges() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return pinned_.size();
+}
+
+void *CpuStagingBackend::create_event(std::string *) { return new Event; }
+
+void CpuStagingBackend::destroy_event(void *event) {
+  delete static_cast<Event *>(event);
+}
+
+bool CpuStagingBackend::copy_async(void *dst, const void *src,
+                                   std::size_t bytes, StagingCopyKind kind,
+                                   void *stream, std::string *err) {
+  std::lock_guard<std::mutex> lock(mu_);
+  const void *host = kind == StagingCopyKind::HostToDevice ? src : dst;
+  if (!is_pinned(host, bytes)) {
+    if (err)
+      *err = "copy_async: host pointer is not pinned";
+    return false;
+  }
+  auto *s = static_cast<Stream *>(stream);
+  if (!s) {
+    std::memcpy(dst, src, bytes);
+    return true;
+  }
+  s->pending.push_back({dst, src, bytes});
+  s->queued++;
+  return true;
+}
+
+bool CpuStagingBackend::record(void *event, void *stream, std::string *) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto *e = static_cast<Event *>(event);
+  auto *s = static_cast<Stream *>(stream);
+  e->stream = s;
+  e->target = s ? s->queued : 0;
+  return true;
+}
+
+bool CpuStagingBackend::query(void *event) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto *e = static_cast<Event *>(event);
+  return !e->stream || e->stream->executed >= e->target;
+}
+
+void CpuStagingBackend::run(Stream *s, std::size_t max_ops) {
+  if (!s)
+    return;
+  std::lock_guard<std::mutex> lock(mu_);
+  for (; max_ops > 0 && !s->pending.empty(); --max_ops) {
+    const Stream::Op op = s->pending.front();
+    s->pending.pop_front();
+    std::memcpy(op.dst, op.src, op.bytes);
+    s->executed++;
+  }
+}
+
+bool CpuStagingBackend::wait(void *event, std::string *) {
+  Stream *s;
+  uint64_t behind;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto *e = static_cast<Event *>(event);
+    s = e->stream;
+    behind = s && s->executed < e->target ? e->target - s->executed : 0;
+  }
+  if (behind)
+    run(s, behind);
+  return true;
+}
+
+bool CpuStagingBackend::sync(void *stream, std::string *) {
+  run(static_cast<Stream *>(stream));
+  return true;
+}
+
+} // namespace gcore::rt
@@ -21,6 +21,12 @@ public:
                 std::string *err = nullptr);
   void free();
 
+  /// Make this buffer a non-owning view of [offset, offset + size) of base.
+  /// The view never frees memory; base must outlive it.
+  bool alias(Buffer &base, size_t offset, size_t size,
+             GretaDataType type = GretaDataType::FP32,
+             std::string *err = nullptr);
+
   void *data() override { return ptr_; }
   const void *data() const override { return ptr_; }
   size_t size() const override { return size_; }
@@ -49,6 +55,7 @@ private:
   GretaDataType type_ = GretaDataType::FP32;
   GretaQuantInfo qinfo_;
   BufferUsage usage_ = BufferUsage::DeviceOnly;
+  bool owned_ = true;
 };
 
 } // namespace gcore::rt::hip
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <hip/hip_runtime.h>
 
@@ -23,6 +24,16 @@ void launch_rope(hipStream_t stream, float *x, uint32_t seq_len,
                  uint32_t num_heads, uint32_t head_dim, float base,
                  const uint32_t *d_pos);
 
+/**
+ * @brief RoPE for a batch of decode rows, each at its own position.
+ *
+ * @param x Input/Output tensor (rows, num_heads, head_dim).
+ * @param d_positions Device array [rows]; row r is rotated by d_positions[r].
+ */
+void launch_rope_rows(hipStream_t stream, float *x, uint32_t rows,
+                      uint32_t num_heads, uint32_t head_dim, float base,
+                      const uint32_t *d_positions);
+
 /**
  * @brief Apply Causal Masking (inplace).
  * Sets values where col > row to a large negative number.
@@ -58,6 +69,23 @@ void launch_kv_update(hipStream_t stream, float *cache_k, float *cache_v,
                       const uint32_t *d_pos, uint32_t max_seq_len,
                       uint32_t num_heads, uint32_t head_dim);
 
+/**
+ * @brief Write one K/V row per sequence into that sequence's cache slot.
+ *
+ * Slot s of the cache starts slot_stride floats after cache_k/cache_v.
+ *
+ * @param new_k New Key projections [rows, num_heads, head_dim].
+ * @param new_v New Value projections [rows, num_heads, head_dim].
+ * @param d_positions Device array [rows] of cache positions.
+ * @param d_slots Device array [rows] of cache slots.
+ */
+void launch_kv_update_batched(hipStream_t stream, float *cache_k,
+                              float *cache_v, const float *new_k,
+                              const float *new_v, const uint32_t *d_positions,
+                              const uint32_t *d_slots, uint32_t rows,
+                              size_t slot_stride, uint32_t max_seq_len,
+                              uint32_t num_heads, uint32_t head_dim);
+
 /**
  * @brief FlashAttention v2 for decode mode (single query against KV cache).
  *
@@ -87,6 +115,23 @@ void launch_flash_attention_decode(hipStream_t stream, const float *Q,
                                    uint32_t max_seq_len, uint32_t head_dim,
                                    float scale, int accum_mode = 0);
 
+/**
+ * @brief Decode attention for a batch of independent sequences.
+ *
+ * Row r attends cache slot d_slots[r] over positions [0, d_positions[r]].
+ *
+ * @param Q Query tensor [rows, num_heads, head_dim].
+ * @param K Key cache base; slot s starts slot_stride floats in.
+ * @param V Value cache base; slot s starts slot_stride floats in.
+ * @param O Output tensor [rows, num_heads, head_dim].
+ */
+void launch_flash_attention_decode_batched(
+    hipStream_t stream, const float *Q, const float *K, const float *V,
+    float *O, uint32_t rows, const uint32_t *d_positions,
+    const uint32_t *d_slots, size_t slot_stride, uint32_t num_heads,
+    uint32_t num_heads_kv, uint32_t max_seq_len, uint32_t head_dim,
+    float scale, int accum_mode = 0);
+
 void launch_attn_softmax_trace(hipStream_t stream, const float *Q,
                                const float *K_cache, uint32_t num_heads,
                                uint32_t num_heads_kv, uint32_t head_dim,
@@ -127,4 +172,27 @@ void launch_flash_attention_prefill(hipStream_t stream, const float *Q,
                                     uint32_t num_heads_kv, uint32_t head_dim,
                                     float scale, bool causal);
 
+/**
+ * @brief Causal attention for a prefill chunk over the KV cache.
+ *
+ * Query i of the chunk sits at absolute position pos_offset + i and attends
+ * cache positions [0, pos_offset + i]. The chunk's own K/V must already be
+ * written to the cache (launch_kv_update) before this runs.
+ *
+ * @param stream HIP stream.
+ * @param Q Query tensor [seq_len, num_heads, head_dim].
+ * @param cache_k Key cache for this layer [num_heads_kv, max_seq_len, head_dim].
+ * @param cache_v Value cache for this layer [num_heads_kv, max_seq_len, head_dim].
+ * @param O Output tensor [seq_len, num_heads, head_dim].
+ * @param seq_len Number of queries in the chunk.
+ * @param pos_offset Absolute position of the first query.
+ * @param max_seq_len Cache capacity (row stride of cache_k/cache_v).
+ * @param scale Attention scale factor (1/sqrt(head_dim)).
+ */
+void launch_flash_attention_prefill_cached(
+    hipStream_t stream, const float *Q, const float *cache_k,
+    const float *cache_v, float *O, uint32_t seq_len, uint32_t pos_offset,
+    uint32_t max_seq_len, uint32_t num_heads, uint32_t num_heads_kv,
+    uint32_t head_dim, float scale);
+
 } // namespace gcore::rt::hip::kernels
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "gcore/rt/hip/buffer.hpp"
+#include "gcore/rt/staging_pool.hpp"
+
+#include <cstddef>
+#include <hip/hip_runtime.h>
+#include <string>
+
+namespace gcore::rt::hip {
+
+// StagingBackend over the HIP runtime: hipHostRegister for pinning,
+// hipMemcpyAsync for copies and timing-disabled events for completion.
+class HipStagingBackend final : public gcore::rt::StagingBackend {
+public:
+  bool pin(void *p, size_t bytes, std::string *err) override;
+  void unpin(void *p) override;
+  void *create_event(std::string *err) override;
+  void destroy_event(void *event) override;
+  bool copy_async(void *dst, const void *src, size_t bytes,
+                  gcore::rt::StagingCopyKind kind, void *stream,
+                  std::string *err) override;
+  bool record(void *event, void *stream, std::string *err) override;
+  bool query(void *event) override;
+  bool wait(void *event, std::string *err) override;
+  bool sync(void *stream, std::string *err) override;
+};
+
+// Process-wide staging pool over HipStagingBackend, created on first use.
+// nullptr when disabled with GRETA_STAGING=0. GRETA_STAGING_MAX_MB sets the
+// pinned budget (default 64).
+gcore::rt::StagingPool *staging_pool();
+
+// Copies between pageable host memory and a Buffer. Transfers of at least
+// kStagedCopyMin bytes go through staging_pool(); smaller ones (or all, with
+// staging disabled) use Buffer's plain copies.
+static constexpr size_t kStagedCopyMin = size_t{64} << 10;
+
+// Returns once `src` may be reused; the device copy completes in `stream`
+// order (the null stream by default, which orders it before later work on
+// blocking streams).
+bool upload_staged(Buffer &dst, const void *src, size_t size,
+                   std::string *err, hipStream_t stream = nullptr);
+
+// Blocks until host_ptr is filled.
+bool download_staged(const Buffer &src, size_t offset, void *host_ptr,
+                     size_t size, std::string *err,
+                     hipStream_t stream = nullptr);
+
+} // namespace gcore::rt::hip
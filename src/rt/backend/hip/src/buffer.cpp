@@ -33,14 +33,35 @@ bool Buffer::allocate(size_t size, BufferUsage usage, GretaDataType type,
 
 void Buffer::free() {
   if (ptr_) {
-    if (usage_ == BufferUsage::HostVisible) {
-      (void)hipHostFree(ptr_);
-    } else {
-      (void)hipFree(ptr_);
+    if (owned_) {
+      if (usage_ == BufferUsage::HostVisible) {
+        (void)hipHostFree(ptr_);
+      } else {
+        (void)hipFree(ptr_);
+      }
     }
     ptr_ = nullptr;
     size_ = 0;
   }
+  owned_ = true;
+}
+
+bool Buffer::alias(Buffer &base, size_t offset, size_t size,
+                   GretaDataType type, std::string *err) {
+  if (!base.ptr_ || offset + size > base.size_) {
+    if (err)
+      *err = "Buffer alias out of bounds: offset=" + std::to_string(offset) +
+             ", size=" + std::to_string(size) +
+             ", base_size=" + std::to_string(base.size_);
+    return false;
+  }
+  free();
+  ptr_ = static_cast<char *>(base.ptr_) + offset;
+  size_ = size;
+  usage_ = base.usage_;
+  type_ = type;
+  owned_ = false;
+  return true;
 }
 
 bool Buffer::copy_to_device(const void *host_ptr, size_t size,
@@ -0,0 +1,113 @@
+#include "gcore/rt/hip/staging.hpp"
+
+#include <cstdlib>
+
+namespace gcore::rt::hip {
+
+static bool hip_ok(hipError_t res, const char *what, std::string *err) {
+  if (res == hipSuccess)
+    return true;
+  if (err)
+    *err = std::string(what) + " failed: " + hipGetErrorString(res);
+  return false;
+}
+
+bool HipStagingBackend::pin(void *p, size_t bytes, std::string *err) {
+  return hip_ok(hipHostRegister(p, bytes, hipHostRegisterDefault),
+                "hipHostRegister", err);
+}
+
+void HipStagingBackend::unpin(void *p) { (void)hipHostUnregister(p); }
+
+void *HipStagingBackend::create_event(std::string *err) {
+  hipEvent_t ev = nullptr;
+  if (!hip_ok(hipEventCreateWithFlags(&ev, hipEventDisableTiming),
+              "hipEventCreateWithFlags", err))
+    return nullptr;
+  return ev;
+}
+
+void HipStagingBackend::destroy_event(void *event) {
+  (void)hipEventDestroy(static_cast<hipEvent_t>(event));
+}
+
+bool HipStagingBackend::copy_async(void *dst, const void *src, size_t bytes,
+                                   gcore::rt::StagingCopyKind kind,
+                                   void *stream, std::string *err) {
+  const hipMemcpyKind k = kind == gcore::rt::StagingCopyKind::HostToDevice
+                              ? hipMemcpyHostToDevice
+                              : hipMemcpyDeviceToHost;
+  return hip_ok(hipMemcpyAsync(dst, src, bytes, k,
+                               static_cast<hipStream_t>(stream)),
+                "hipMemcpyAsync", err);
+}
+
+bool HipStagingBackend::record(void *event, void *stream, std::string *err) {
+  return hip_ok(hipEventRecord(static_cast<hipEvent_t>(event),
+                               static_cast<hipStream_t>(stream)),
+                "hipEventRecord", err);
+}
+
+bool HipStagingBackend::query(void *event) {
+  return hipEventQuery(static_cast<hipEvent_t>(event)) == hipSuccess;
+}
+
+bool HipStagingBackend::wait(void *event, std::string *err) {
+  return hip_ok(hipEventSynchronize(static_cast<hipEvent_t>(event)),
+                "hipEventSynchronize", err);
+}
+
+bool HipStagingBackend::sync(void *stream, std::string *err) {
+  return hip_ok(hipStreamSynchronize(static_cast<hipStream_t>(stream)),
+                "hipStreamSynchronize", err);
+}
+
+gcore::rt::StagingPool *staging_pool() {
+  // Leaked on purpose: buffers may still be in flight during static
+  // destruction, after the HIP runtime has started tearing down.
+  static gcore::rt::StagingPool *pool = []() -> gcore::rt::StagingPool * {
+    const char *env = std::getenv("GRETA_STAGING");
+    if (env && env[0] == '0')
+      return nullptr;
+    size_t max_mb = 64;
+    if (const char *mb = std::getenv("GRETA_STAGING_MAX_MB"))
+      max_mb = std::strtoull(mb, nullptr, 10);
+    if (max_mb == 0)
+      max_mb = 64;
+    static HipStagingBackend backend;
+    return new gcore::rt::StagingPool(&backend, max_mb << 20);
+  }();
+  return pool;
+}
+
+bool upload_staged(Buffer &dst, const void *src, size_t size,
+                   std::string *err, hipStream_t stream) {
+  if (size > dst.size()) {
+    if (err)
+      *err = "Staged upload out of bounds: size=" + std::to_string(size) +
+             ", total_size=" + std::to_string(dst.size());
+    return false;
+  }
+  gcore::rt::StagingPool *pool = staging_pool();
+  if (!pool || size < kStagedCopyMin)
+    return dst.copy_to_device(src, size, err);
+  return pool->upload(dst.data(), src, size, stream, err);
+}
+
+bool download_staged(const Buffer &src, size_t offset, void *host_ptr,
+                     size_t size, std::string *err, hipStream_t stream) {
+  gcore::rt::StagingPool *pool = staging_pool();
+  if (!pool || size < kStagedCopyMin)
+    return src.copy_to_host_offset(host_ptr, offset, size, err);
+  if (offset + size > src.size()) {
+    if (err)
+      *err = "Buffer copy out of bounds: offset=" + std::to_string(offset) +
+             ", size=" + std::to_string(size) +
+             ", total_size=" + std::to_string(src.size());
+    return false;
+  }
+  const char *device_ptr = static_cast<const char *>(src.data()) + offset;
+  return pool->download(host_ptr, device_ptr, size, stream, err);
+}
+
+} // namespace gcore::rt::hip
@@ -203,56 +203,20 @@ static void probe_subgroup_best_effort(VkPhysicalDevice phy, uint32_t &reported,
   }
 }
 
-std::optional<DeviceInfo> probe_device() {
-  VkApplicationInfo app{VK_STRUCTURE_TYPE_APPLICATION_INFO};
-  app.pApplicationName = "gretacore_autotune_probe";
-  app.applicationVersion = 1;
-  app.pEngineName = "gretacore";
-  app.engineVersion = 1;
-  app.apiVersion = VK_API_VERSION_1_1;
-
-  VkInstanceCreateInfo ici{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
-  ici.pApplicationInfo = &app;
-
-  VkInstance inst{};
-  VkResult r = vkCreateInstance(&ici, nullptr, &inst);
-  if (r != VK_SUCCESS)
-    return std::nullopt;
-
-  uint32_t pcount = 0;
-  r = vkEnumeratePhysicalDevices(inst, &pcount, nullptr);
-  if (r != VK_SUCCESS || pcount == 0) {
-    vkDestroyInstance(inst, nullptr);
-    return std::nullopt;
-  }
-
-  std::vector<VkPhysicalDevice> phys(pcount);
-  vk_check(vkEnumeratePhysicalDevices(inst, &pcount, phys.data()),
-           "vkEnumeratePhysicalDevices");
-
-  VkPhysicalDevice chosen = phys[0];
-  for (auto d : phys) {
-    VkPhysicalDeviceProperties p{};
-    vkGetPhysicalDeviceProperties(d, &p);
-    if (!contains_llvmpipe(p.deviceName)) {
-      chosen = d;
-      break;
-    }
-  }
-
+DeviceInfo describe_device(VkPhysicalDevice phys) {
   VkPhysicalDeviceProperties p{};
-  vkGetPhysicalDeviceProperties(chosen, &p);
+  vkGetPhysicalDeviceProperties(phys, &p);
 
   DeviceInfo di;
   di.vendor_id = p.vendorID;
   di.device_id = p.deviceID;
   di.device_name = std::string(p.deviceName);
-  di.driver_name = get_driver_name_best_effort(chosen);
+  di.driver_name = get_driver_name_best_effort(phys);
 
-  probe_subgroup_best_effort(chosen, di.reported_subgroup_size,
+  probe_subgroup_best_effort(phys, di.reported_subgroup_size,
                              di.min_subgroup_size, di.max_subgroup_size);
 
-  auto exts = enumerate_device_extensions(chosen);
+  auto exts = enumerate_device_extensions(phys);
 
   // FP16 capability (best-effort)
   const bool has_f16_int8_ext =
@@ -268,7 +232,7 @@ std::optional<DeviceInfo> probe_device() {
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
   feats2.pNext = &f16i8;
   f16i8.pNext = &storage16;
-  vkGetPhysicalDeviceFeatures2(chosen, &feats2);
+  vkGetPhysicalDeviceFeatures2(phys, &feats2);
 
   di.fp16_supported = has_f16_int8_ext && has_16bit_storage_ext &&
                       (f16i8.shaderFloat16 == VK_TRUE) &&
@@ -318,6 +282,47 @@ std::optional<DeviceInfo> probe_device() {
     }
   }
 
+  return di;
+}
+
+std::optional<DeviceInfo> probe_device() {
+  VkApplicationInfo app{VK_STRUCTURE_TYPE_APPLICATION_INFO};
+  app.pApplicationName = "gretacore_autotune_probe";
+  app.applicationVersion = 1;
+  app.pEngineName = "gretacore";
+  app.engineVersion = 1;
+  app.apiVersion = VK_API_VERSION_1_1;
+
+  VkInstanceCreateInfo ici{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+  ici.pApplicationInfo = &app;
+
+  VkInstance inst{};
+  VkResult r = vkCreateInstance(&ici, nullptr, &inst);
+  if (r != VK_SUCCESS)
+    return std::nullopt;
+
+  uint32_t pcount = 0;
+  r = vkEnumeratePhysicalDevices(inst, &pcount, nullptr);
+  if (r != VK_SUCCESS || pcount == 0) {
+    vkDestroyInstance(inst, nullptr);
+    return std::nullopt;
+  }
+
+  std::vector<VkPhysicalDevice> phys(pcount);
+  vk_check(vkEnumeratePhysicalDevices(inst, &pcount, phys.data()),
+           "vkEnumeratePhysicalDevices");
+
+  VkPhysicalDevice chosen = phys[0];
+  for (auto d : phys) {
+    VkPhysicalDeviceProperties p{};
+    vkGetPhysicalDeviceProperties(d, &p);
+    if (!contains_llvmpipe(p.deviceName)) {
+      chosen = d;
+      break;
+    }
+  }
+
+  DeviceInfo di = describe_device(chosen);
   vkDestroyInstance(inst, nullptr);
   return di;
 }
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 
+#include <vulkan/vulkan.h>
+
 namespace greta::vk_autotune {
 
 // ------------------------
@@ -36,6 +38,10 @@ struct DeviceInfo {
 // possible). Returns nullopt if Vulkan instance/device enumeration fails.
 std::optional<DeviceInfo> probe_device();
 
+// Same description for a physical device the caller already picked (no
+// extra VkInstance), e.g. to derive key_string() from a live Backend.
+DeviceInfo describe_device(VkPhysicalDevice phys);
+
 // Check if this device is blacklisted for FP16 (healthcheck failed before).
 bool fp16_blacklisted(const DeviceInfo &di);
 // Human-readable reason for FP16 blacklist (includes override hint).
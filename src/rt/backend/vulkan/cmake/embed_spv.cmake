@@ -0,0 +1,40 @@
+# Script mode: cmake -DOUT=<file.inc> -DSPVS=<a.spv|b.spv|...> -P embed_spv.cmake
+# Writes the kEmbeddedSpv table included by kernels/embedded_spv.cpp. SPIR-V
+# words are little-endian, as glslangValidator emits them.
+if(NOT OUT OR NOT SPVS)
+  message(FATAL_ERROR "embed_spv.cmake: OUT and SPVS are required")
+endif()
+string(REPLACE "|" ";" SPVS "${SPVS}")
+
+set(body "// Generated by embed_spv.cmake; do not edit.\n")
+set(table "static const EmbeddedSpv kEmbeddedSpv[] = {\n")
+set(i 0)
+# Eight words per line (CMake regexes have no {n} repetition).
+string(REPEAT "0x........u," 8 w8)
+foreach(spv IN LISTS SPVS)
+  file(READ "${spv}" hex HEX)
+  string(LENGTH "${hex}" nhex)
+  math(EXPR rem "${nhex} % 8")
+  if(nhex EQUAL 0 OR NOT rem EQUAL 0)
+    message(FATAL_ERROR "embed_spv.cmake: ${spv} is not SPIR-V (size % 4)")
+  endif()
+  math(EXPR nwords "${nhex} / 8")
+  string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u," words "${hex}")
+  string(REGEX REPLACE "(${w8})" "\\1\n    " words "${words}")
+  get_filename_component(name "${spv}" NAME)
+  string(APPEND body
+    "static const uint32_t kSpv${i}[] = {\n    ${words}\n};\n")
+  string(APPEND table "    {\"${name}\", kSpv${i}, ${nwords}},\n")
+  math(EXPR i "${i} + 1")
+endforeach()
+string(APPEND table "    {nullptr, nullptr, 0},\n};\n")
+
+# Only touch OUT when the content changes, so dependents do not rebuild.
+set(content "${body}${table}")
+if(EXISTS "${OUT}")
+  file(READ "${OUT}" old)
+  if(old STREQUAL content)
+    return()
+  endif()
+endif()
+file(WRITE "${OUT}" "${content}")
@@ -30,6 +30,12 @@ bool create_staging_buffer(VkPhysicalDevice phys, VkDevice dev,
 
 void destroy_buffer(VkDevice dev, Buffer *b);
 
+// Called by destroy_buffer() before vkDestroyBuffer, so caches keyed by
+// VkBuffer handle (the GEMM runtimes' descriptor sets) drop the buffer
+// before the driver can hand its handle out again. One hook per process.
+using BufferDestroyHook = void (*)(VkDevice dev, VkBuffer buf);
+void set_buffer_destroy_hook(BufferDestroyHook hook);
+
 // Map/unmap helpers (only valid if memory is HOST_VISIBLE)
 bool map_buffer(VkDevice dev, const Buffer &b, void **out_ptr,
                 std::string *err = nullptr);
@@ -45,6 +45,8 @@ struct GemmDispatchDesc {
 //
 // This class is intentionally thin: it delegates pipeline creation/dispatch
 // to src/rt/backend/vulkan/kernels/gemm_f16acc32_runtime.{hpp,cpp}.
+// Pipelines are created through the shared on-disk VkPipelineCache
+// (kernels/pipeline_cache.hpp; GRETA_VK_PIPELINE_CACHE=0 disables).
 class GemmF16Acc32 {
 public:
   GemmF16Acc32() = default;
@@ -64,6 +66,19 @@ public:
   bool record_dispatch(VkCommandBuffer cmd, const GemmDispatchDesc &d,
                        std::string *err);
 
+  // Descriptor sets: one per (A, B, C), written on first use and rebound
+  // afterwards (GRETA_VK_DESC_CACHE=0 or set_descriptor_caching(false)
+  // writes a fresh set per dispatch). Call retire(cmd) once cmd has
+  // completed, or was reset or freed unsubmitted: the sets it no longer
+  // needs go back to the pool. vk::destroy_buffer() drops cached sets of
+  // the buffer; forget_buffer() does it for buffers destroyed otherwise.
+  // reset_descriptors() recycles every set and needs all recorded command
+  // buffers completed.
+  void set_descriptor_caching(bool on);
+  void retire(VkCommandBuffer cmd);
+  void forget_buffer(VkBuffer buf);
+  void reset_descriptors();
+
   // Debug/telemetry
   GemmVariant last_variant() const { return last_variant_; }
   std::string last_winner_name() const { return last_winner_name_; }
@@ -94,6 +109,12 @@ public:
   bool record_dispatch(VkCommandBuffer cmd, const GemmDispatchDesc &d,
                        std::string *err);
 
+  // See GemmF16Acc32.
+  void set_descriptor_caching(bool on);
+  void retire(VkCommandBuffer cmd);
+  void forget_buffer(VkBuffer buf);
+  void reset_descriptors();
+
 private:
   Backend *backend_ = nullptr;
   std::string shader_dir_;
@@ -116,6 +137,12 @@ public:
   bool record_dispatch(VkCommandBuffer cmd, const GemmDispatchDesc &d,
                        std::string *err);
 
+  // Forwarded to both precisions (see GemmF16Acc32).
+  void set_descriptor_caching(bool on);
+  void retire(VkCommandBuffer cmd);
+  void forget_buffer(VkBuffer buf);
+  void reset_descriptors();
+
   GemmPrecision active_precision() const { return active_precision_; }
   std::string fallback_reason() const { return fallback_reason_; }
 
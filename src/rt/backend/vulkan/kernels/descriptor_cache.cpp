@@ -0,0 +1,294 @@
+#include "descriptor_cache.hpp"
+
+#include "gcore/rt/vk/buffer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+namespace gcore::rt::vk {
+
+// Live caches, for the destroy_buffer() hook. Never destroyed, so caches
+// owned by other statics can still unregister at exit.
+struct CacheRegistry {
+  std::mutex mu;
+  std::vector<DescriptorSetCache *> caches;
+};
+
+static CacheRegistry &registry() {
+  static CacheRegistry *r = new CacheRegistry;
+  return *r;
+}
+
+static bool desc_cache_env_default() {
+  const char *v = std::getenv("GRETA_VK_DESC_CACHE");
+  return !(v && (std::strcmp(v, "0") == 0 || std::strcmp(v, "false") == 0 ||
+                 std::strcmp(v, "off") == 0));
+}
+
+DescriptorSetCache::DescriptorSetCache(VkDevice dev)
+    : dev_(dev), caching_(desc_cache_env_default()) {
+  CacheRegistry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mu);
+  r.caches.push_back(this);
+  set_buffer_destroy_hook(&DescriptorSetCache::on_buffer_destroyed);
+}
+
+DescriptorSetCache::~DescriptorSetCache() {
+  {
+    CacheRegistry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mu);
+    r.caches.erase(std::remove(r.caches.begin(), r.caches.end(), this),
+                   r.caches.end());
+  }
+  destroy();
+}
+
+void DescriptorSetCache::on_buffer_destroyed(VkDevice dev, VkBuffer buf) {
+  CacheRegistry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mu);
+  for (DescriptorSetCache *c : r.caches) {
+    if (c->dev_ == dev)
+      c->invalidate(buf); // Takes c->mu_: lock order is registry, cache
+  }
+}
+
+size_t DescriptorSetCache::KeyHash::operator()(const Key &k) const {
+  size_t h = std::hash<VkDescriptorSetLayout>{}(k.dsl);
+  for (VkBuffer b : {k.a, k.b, k.c})
+    h = h * 0x9E3779B97F4A7C15ull + std::hash<VkBuffer>{}(b);
+  return h;
+}
+
+bool DescriptorSetCache::new_pool(std::string *err) {
+  VkDescriptorPoolSize ps{};
+  ps.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  ps.descriptorCount = 3 * kSetsPerPool;
+
+  VkDescriptorPoolCreateInfo dpci{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+  dpci.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+  dpci.maxSets = kSetsPerPool;
+  dpci.poolSizeCount = 1;
+  dpci.pPoolSizes = &ps;
+
+  VkDescriptorPool dp = VK_NULL_HANDLE;
+  if (vkCreateDescriptorPool(dev_, &dpci, nullptr, &dp) != VK_SUCCESS) {
+    if (err)
+      *err = "vkCreateDescriptorPool failed";
+    return false;
+  }
+  pools_.push_back({dp, kSetsPerPool});
+  cur_ = pools_.size() - 1;
+  return true;
+}
+
+VkDescriptorSet DescriptorSetCache::allocate(VkDescriptorSetLayout dsl,
+                                             std::string *err) {
+  VkDescriptorSetAllocateInfo dsai{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+  dsai.descriptorSetCount = 1;
+  dsai.pSetLayouts = &dsl;
+
+  // Every set has the same shape, so freed slots never fragment: a pool
+  // with free > 0 can serve the request. A new pool is the last resort.
+  const size_t n = pools_.size(), start = cur_;
+  for (size_t i = 0; i <= n; ++i) {
+    if (i == n) {
+      if (!new_pool(err))
+        return VK_NULL_HANDLE;
+    } else {
+      cur_ = (start + i) % n;
+      if (pools_[cur_].free == 0)
+        continue;
+    }
+    dsai.descriptorPool = pools_[cur_].pool;
+    VkDescriptorSet ds = VK_NULL_HANDLE;
+    VkResult r = vkAllocateDescriptorSets(dev_, &dsai, &ds);
+    if (r == VK_SUCCESS) {
+      --pools_[cur_].free;
+      live_[ds].pool = static_cast<uint32_t>(cur_);
+      return ds;
+    }
+    if (r != VK_ERROR_OUT_OF_POOL_MEMORY && r != VK_ERROR_FRAGMENTED_POOL)
+      break;
+    pools_[cur_].free = 0; // Counting was off; skip it until sets return
+  }
+  if (err)
+    *err = "vkAllocateDescriptorSets failed";
+  return VK_NULL_HANDLE;
+}
+
+void DescriptorSetCache::track(VkDescriptorSet ds, VkCommandBuffer cmd) {
+  SetInfo &info = live_[ds];
+  if (info.last_cmd == cmd)
+    return;
+  info.last_cmd = cmd;
+  ++info.pending;
+  in_flight_[cmd].push_back(ds);
+}
+
+void DescriptorSetCache::release_if_unused(VkDescriptorSet ds) {
+  auto it = live_.find(ds);
+  if (it == live_.end() || it->second.cached || it->second.pending > 0)
+    return;
+  Pool &p = pools_[it->second.pool];
+  vkFreeDescriptorSets(dev_, p.pool, 1, &ds);
+  ++p.free;
+  live_.erase(it);
+}
+
+// Cache full: start over. Sets still referenced by a pending command
+// buffer are freed when it retires.
+void DescriptorSetCache::drop_cached() {
+  std::vector<VkDescriptorSet> dropped;
+  dropped.reserve(sets_.size());
+  for (const auto &kv : sets_) {
+    live_[kv.second].cached = false;
+    dropped.push_back(kv.second);
+  }
+  sets_.clear();
+  for (VkDescriptorSet ds : dropped)
+    release_if_unused(ds);
+}
+
+VkDescriptorSet DescriptorSetCache::acquire(VkDescriptorSetLayout dsl,
+                                            VkBuffer A, VkBuffer B,
+                                            VkBuffer C, VkCommandBuffer cmd,
+                                            std::string *err) {
+  if (dev_ == VK_NULL_HANDLE || dsl == VK_NULL_HANDLE ||
+      cmd == VK_NULL_HANDLE) {
+    if (err)
+      *err = "DescriptorSetCache: device/layout/cmd no inicializados";
+    return VK_NULL_HANDLE;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  const Key key{dsl, A, B, C};
+  if (caching_) {
+    auto it = sets_.find(key);
+    if (it != sets_.end()) {
+      ++hits_;
+      track(it->second, cmd);
+      return it->second;
+    }
+  }
+  ++misses_;
+
+  VkDescriptorSet ds = allocate(dsl, err);
+  if (ds == VK_NULL_HANDLE)
+    return VK_NULL_HANDLE;
+
+  VkDescriptorBufferInfo db[3] = {{A, 0, VK_WHOLE_SIZE},
+                                  {B, 0, VK_WHOLE_SIZE},
+                                  {C, 0, VK_WHOLE_SIZE}};
+  VkWriteDescriptorSet wr[3]{};
+  for (uint32_t i = 0; i < 3; i++) {
+    wr[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    wr[i].dstSet = ds;
+    wr[i].dstBinding = i;
+    wr[i].descriptorCount = 1;
+    wr[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    wr[i].pBufferInfo = &db[i];
+  }
+  vkUpdateDescriptorSets(dev_, 3, wr, 0, nullptr);
+
+  if (caching_) {
+    if (sets_.size() >= kMaxCachedSets)
+      drop_cached();
+    sets_.emplace(key, ds);
+    live_[ds].cached = true;
+  }
+  track(ds, cmd);
+  return ds;
+}
+
+void DescriptorSetCache::retire(VkCommandBuffer cmd) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = in_flight_.find(cmd);
+  if (it == in_flight_.end())
+    return;
+  const std::vector<VkDescriptorSet> sets = std::move(it->second);
+  in_flight_.erase(it);
+  for (VkDescriptorSet ds : sets) {
+    auto info = live_.find(ds);
+    if (info == live_.end())
+      continue;
+    --info->second.pending;
+    if (info->second.last_cmd == cmd)
+      info->second.last_cmd = VK_NULL_HANDLE;
+    release_if_unused(ds);
+  }
+}
+
+void DescriptorSetCache::invalidate(VkBuffer buf) {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::vector<VkDescriptorSet> dropped;
+  for (auto it = sets_.begin(); it != sets_.end();) {
+    const Key &k = it->first;
+    if (k.a == buf || k.b == buf || k.c == buf) {
+      live_[it->second].cached = false;
+      dropped.push_back(it->second);
+      it = sets_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // A set still recorded in a pending command buffer is freed on retire().
+  for (VkDescriptorSet ds : dropped)
+    release_if_unused(ds);
+}
+
+void DescriptorSetCache::reset() {
+  std::lock_guard<std::mutex> lock(mu_);
+  sets_.clear();
+  live_.clear();
+  in_flight_.clear();
+  for (Pool &p : pools_) {
+    vkResetDescriptorPool(dev_, p.pool, 0);
+    p.free = kSetsPerPool;
+  }
+  cur_ = 0;
+}
+
+void DescriptorSetCache::destroy() {
+  std::lock_guard<std::mutex> lock(mu_);
+  sets_.clear();
+  live_.clear();
+  in_flight_.clear();
+  if (dev_ != VK_NULL_HANDLE) {
+    for (const Pool &p : pools_)
+      vkDestroyDescriptorPool(dev_, p.pool, nullptr);
+  }
+  pools_.clear();
+  cur_ = 0;
+}
+
+uint64_t DescriptorSetCache::hits() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return hits_;
+}
+
+uint64_t DescriptorSetCache::misses() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return misses_;
+}
+
+size_t DescriptorSetCache::pool_count() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return pools_.size();
+}
+
+size_t DescriptorSetCache::live_sets() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return live_.size();
+}
+
+size_t DescriptorSetCache::cached_sets() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return sets_.size();
+}
+
+} // namespace gcore::rt::vk
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace gcore::rt::vk {
+
+// Descriptor sets for the GEMM runtimes' layout: bindings 0..2 = storage
+// buffers A, B, C (whole buffer).
+// - Sets come from fixed-size pools (FREE_DESCRIPTOR_SET_BIT) created on
+//   demand. acquire() notes the command buffer each set is recorded into;
+//   retire(cmd) once that cmd has completed (or was reset / freed without
+//   being submitted) frees the sets nothing else needs, so the pools stay
+//   bounded by what is in flight.
+// - With caching on (default) a set is written once per (layout, A, B, C)
+//   and rebound on later dispatches, up to kMaxCachedSets; past that the
+//   cache starts over. Off: a fresh set is written per acquire() (baseline
+//   for measurements, GRETA_VK_DESC_CACHE=0).
+// - vk::destroy_buffer() invalidates the sets that point at the buffer in
+//   every cache of its device, so a reused VkBuffer handle never hits a
+//   stale set. invalidate() covers buffers destroyed some other way.
+// reset() recycles everything at once and needs no pending command buffer.
+// Calls are serialized by an internal mutex, since destroy_buffer() may run
+// on another thread than the one recording.
+class DescriptorSetCache {
+public:
+  static constexpr uint32_t kSetsPerPool = 64;
+  static constexpr size_t kMaxCachedSets = 1024;
+
+  explicit DescriptorSetCache(VkDevice dev);
+  ~DescriptorSetCache();
+  DescriptorSetCache(const DescriptorSetCache &) = delete;
+  DescriptorSetCache &operator=(const DescriptorSetCache &) = delete;
+
+  void set_caching(bool on) {
+    std::lock_guard<std::mutex> lock(mu_);
+    caching_ = on;
+  }
+  bool caching() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return caching_;
+  }
+
+  // Set for a dispatch recorded into `cmd`. VK_NULL_HANDLE on failure.
+  VkDescriptorSet acquire(VkDescriptorSetLayout dsl, VkBuffer A, VkBuffer B,
+                          VkBuffer C, VkCommandBuffer cmd, std::string *err);
+
+  void retire(VkCommandBuffer cmd);
+  void invalidate(VkBuffer buf);
+  void reset();
+  void destroy();
+
+  uint64_t hits() const;
+  uint64_t misses() const;
+  size_t pool_count() const;
+  size_t live_sets() const;
+  size_t cached_sets() const;
+
+private:
+  struct Key {
+    VkDescriptorSetLayout dsl;
+    VkBuffer a, b, c;
+    bool operator==(const Key &o) const {
+      return dsl == o.dsl && a == o.a && b == o.b && c == o.c;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key &k) const;
+  };
+  struct Pool {
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    uint32_t free = 0; // Sets still available in this pool
+  };
+  struct SetInfo {
+    uint32_t pool = 0;    // Index in pools_
+    uint32_t pending = 0; // Entries in in_flight_ not yet retired
+    VkCommandBuffer last_cmd = VK_NULL_HANDLE; // Skips repeats within a cmd
+    bool cached = false;  // Reachable from sets_
+  };
+
+  VkDevice dev_ = VK_NULL_HANDLE;
+  mutable std::mutex mu_; // Guards everything below
+  bool caching_ = true;
+
+  std::vector<Pool> pools_;
+  size_t cur_ = 0; // First pool tried by allocate()
+
+  std::unordered_map<Key, VkDescriptorSet, KeyHash> sets_;
+  std::unordered_map<VkDescriptorSet, SetInfo> live_;
+  std::unordered_map<VkCommandBuffer, std::vector<VkDescriptorSet>> in_flight_;
+  uint64_t hits_ = 0, misses_ = 0;
+
+  bool new_pool(std::string *err);
+  VkDescriptorSet allocate(VkDescriptorSetLayout dsl, std::string *err);
+  void track(VkDescriptorSet ds, VkCommandBuffer cmd);
+  void release_if_unused(VkDescriptorSet ds);
+  void drop_cached();
+
+  static void on_buffer_destroyed(VkDevice dev, VkBuffer buf);
+};
+
+} // namespace gcore::rt::vk
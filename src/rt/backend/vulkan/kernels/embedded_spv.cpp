@@ -0,0 +1,29 @@
+#include "embedded_spv.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace gcore::rt::vk {
+
+#if defined(GRETA_VK_EMBED_SPV)
+// Defines: static const EmbeddedSpv kEmbeddedSpv[] = {..., {nullptr, ...}};
+#include "greta_vk_embedded_spv.inc"
+#else
+static const EmbeddedSpv kEmbeddedSpv[] = {{nullptr, nullptr, 0}};
+#endif
+
+const EmbeddedSpv *find_embedded_spv(const std::string &filename) {
+  static const bool from_disk = [] {
+    const char *v = std::getenv("GRETA_VK_SPV_FROM_DISK");
+    return v && std::strcmp(v, "1") == 0;
+  }();
+  if (from_disk)
+    return nullptr;
+  for (const EmbeddedSpv *e = kEmbeddedSpv; e->name; ++e) {
+    if (filename == e->name)
+      return e;
+  }
+  return nullptr;
+}
+
+} // namespace gcore::rt::vk
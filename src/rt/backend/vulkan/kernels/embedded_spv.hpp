@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gcore::rt::vk {
+
+// SPIR-V compiled into the binary. The build generates the table from the
+// .spv outputs (src/rt/backend/vulkan/cmake/embed_spv.cmake) and defines
+// GRETA_VK_EMBED_SPV; without it the table is empty and kernels are read
+// from shader_dir as before.
+struct EmbeddedSpv {
+  const char *name; // e.g. "gemm_f32_tiled.comp.spv"
+  const uint32_t *words;
+  size_t count;
+};
+
+// nullptr if `filename` is not embedded or GRETA_VK_SPV_FROM_DISK=1.
+const EmbeddedSpv *find_embedded_spv(const std::string &filename);
+
+} // namespace gcore::rt::vk
@@ -2,6 +2,8 @@
 
 #include "../autotune/vk_autotune.hpp" // greta::vk_autotune::Cache + probe_device + make_bucket
 
+#include "embedded_spv.hpp"
+
 #include <algorithm>
 #include <cctype>
 #include <cstring>
@@ -83,6 +85,10 @@ const char *kernel_spv_filename(GemmKernelId id) {
 std::vector<uint32_t>
 GemmPipelineCache::read_spv_u32(const std::string &filename,
                                 std::string *err) const {
+  // Embedded SPIR-V first: no file I/O on the startup path.
+  if (const EmbeddedSpv *e = find_embedded_spv(filename))
+    return std::vector<uint32_t>(e->words, e->words + e->count);
+
   std::filesystem::path p = std::filesystem::path(shader_dir_) / filename;
   std::ifstream f(p, std::ios::binary);
   if (!f) {
@@ -213,7 +219,7 @@ bool GemmPipelineCache::create_entry(VkPhysicalDevice /*phys*/,
   cpci.layout = pl_;
 
   VkPipeline pipe = VK_NULL_HANDLE;
-  r = vkCreateComputePipelines(dev_, VK_NULL_HANDLE, 1, &cpci, nullptr, &pipe);
+  r = vkCreateComputePipelines(dev_, vk_cache_, 1, &cpci, nullptr, &pipe);
 
   vkDestroyShaderModule(dev_, sm, nullptr);
 
@@ -247,6 +253,8 @@ void GemmPipelineCache::destroy() {
   if (dev_ == VK_NULL_HANDLE)
     return;
 
+  descs_.destroy();
+
   for (auto &kv : pipes_) {
     if (kv.second.pipe != VK_NULL_HANDLE) {
       vkDestroyPipeline(dev_, kv.second.pipe, nullptr);
@@ -300,6 +308,19 @@ resolve_gemm_kernel_id_autotune(uint32_t M, uint32_t N, uint32_t K) {
   return GemmKernelId::tiled_vec2_32x8;
 }
 
+std::optional<GemmKernelId>
+GemmPipelineCache::resolve_kernel(uint32_t M, uint32_t N, uint32_t K) {
+  const std::string bucket = greta::vk_autotune::make_bucket(M, N, K);
+  auto it = kid_by_bucket_.find(bucket);
+  if (it != kid_by_bucket_.end())
+    return it->second;
+
+  auto kid = resolve_gemm_kernel_id_autotune(M, N, K);
+  if (kid)
+    kid_by_bucket_.emplace(bucket, *kid);
+  return kid;
+}
+
 bool probe_gemm_f16acc32(VkDevice dev, VkPhysicalDevice phys,
                          GemmPipelineCache &cache, GemmKernelId kid,
                          std::string *err) {
@@ -329,66 +350,28 @@ bool dispatch_gemm_f16acc32(VkDevice dev, VkPhysicalDevice phys,
   if (pipe == VK_NULL_HANDLE)
     return false;
 
-  // Descriptor set ephemeral (simple): create pool+set per call (safe).
-  // Si querés, luego lo optimizamos a un pool persistente por thread.
-  VkDescriptorPoolSize ps{};
-  ps.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  ps.descriptorCount = 3;
-
-  VkDescriptorPoolCreateInfo dpci{
-      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-  dpci.maxSets = 1;
-  dpci.poolSizeCount = 1;
-  dpci.pPoolSizes = &ps;
+  // Dispatch mapping (compatible con tu familia tiled actual)
+  // gx = ceil(N, 32), gy = ceil(M, 8)
+  GemmRunArgs a = p.args;
+  uint32_t gx = ceil_div_u32(a.N, 32u);
+  uint32_t gy = ceil_div_u32(a.M, 8u);
 
-  VkDescriptorPool dp = VK_NULL_HANDLE;
-  if (vkCreateDescriptorPool(dev, &dpci, nullptr, &dp) != VK_SUCCESS)
+  if (gx == 0 || gy == 0) {
+    std::cerr << "dispatch_gemm_f16acc32: gx/gy=0 for kid=" << kernel_name(kid)
+              << "\n";
     return false;
+  }
 
-  VkDescriptorSetLayout dsl = cache.dsl();
-
-  VkDescriptorSetAllocateInfo dsai{
-      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
-  dsai.descriptorPool = dp;
-  dsai.descriptorSetCount = 1;
-  dsai.pSetLayouts = &dsl;
-
-  VkDescriptorSet ds = VK_NULL_HANDLE;
-  if (vkAllocateDescriptorSets(dev, &dsai, &ds) != VK_SUCCESS) {
-    vkDestroyDescriptorPool(dev, dp, nullptr);
+  // Set del cache: tiene que sobrevivir a `cmd`, así que sigue asignado
+  // hasta retire(cmd).
+  VkDescriptorSet ds = cache.descriptors().acquire(cache.dsl(), p.A, p.B,
+                                                   p.C, cmd, &err);
+  if (ds == VK_NULL_HANDLE) {
+    std::cerr << "dispatch_gemm_f16acc32: descriptor set: " << err << "\n";
     return false;
   }
 
-  VkDescriptorBufferInfo dbA{p.A, 0, VK_WHOLE_SIZE};
-  VkDescriptorBufferInfo dbB{p.B, 0, VK_WHOLE_SIZE};
-  VkDescriptorBufferInfo dbC{p.C, 0, VK_WHOLE_SIZE};
-
-  VkWriteDescriptorSet wr[3]{};
-  for (int i = 0; i < 3; i++)
-    wr[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-
-  wr[0].dstSet = ds;
-  wr[0].dstBinding = 0;
-  wr[0].descriptorCount = 1;
-  wr[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  wr[0].pBufferInfo = &dbA;
-
-  wr[1].dstSet = ds;
-  wr[1].dstBinding = 1;
-  wr[1].descriptorCount = 1;
-  wr[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  wr[1].pBufferInfo = &dbB;
-
-  wr[2].dstSet = ds;
-  wr[2].dstBinding = 2;
-  wr[2].descriptorCount = 1;
-  wr[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  wr[2].pBufferInfo = &dbC;
-
-  vkUpdateDescriptorSets(dev, 3, wr, 0, nullptr);
-
   // Push constants
-  GemmRunArgs a = p.args;
   GemmPushConstants pc{a.M, a.N, a.K, a.lda, a.ldb, a.ldc};
 
   VkPipelineLayout pl = cache.pl();
@@ -399,30 +382,15 @@ bool dispatch_gemm_f16acc32(VkDevice dev, VkPhysicalDevice phys,
   vkCmdPushConstants(cmd, pl, VK_SHADER_STAGE_COMPUTE_BIT, 0,
                      sizeof(GemmPushConstants), &pc);
 
-  // Dispatch mapping (compatible con tu familia tiled actual)
-  // gx = ceil(N, 32), gy = ceil(M, 8)
-  uint32_t gx = ceil_div_u32(a.N, 32u);
-  uint32_t gy = ceil_div_u32(a.M, 8u);
-
-  if (gx == 0 || gy == 0) {
-    std::cerr << "dispatch_gemm_f16acc32: gx/gy=0 for kid=" << kernel_name(kid)
-              << "\n";
-    vkDestroyDescriptorPool(dev, dp, nullptr);
-    return false;
-  }
-
   vkCmdDispatch(cmd, gx, gy, 1);
-
-  // Destroy DS pool (safe). Más adelante lo persistimos.
-  vkDestroyDescriptorPool(dev, dp, nullptr);
   return true;
 }
 
 bool dispatch_gemm_f16acc32_auto(VkDevice dev, VkPhysicalDevice phys,
                                  VkCommandBuffer cmd, GemmPipelineCache &cache,
                                  const GemmDispatchParams &p,
-                                 std::string *err) {
-  auto kid_opt = resolve_gemm_kernel_id_autotune(p.args.M, p.args.N, p.args.K);
+                                 std::string *err, GemmKernelId *used) {
+  auto kid_opt = cache.resolve_kernel(p.args.M, p.args.N, p.args.K);
   if (!kid_opt) {
     if (err)
       *err = "resolve_gemm_kernel_id_autotune returned nullopt";
@@ -438,6 +406,9 @@ bool dispatch_gemm_f16acc32_auto(VkDevice dev, VkPhysicalDevice phys,
     }
   }
 
+  if (used)
+    *used = kid;
+
   bool ok = dispatch_gemm_f16acc32(dev, phys, cmd, cache, kid, p);
   if (!ok && err) {
     std::ostringstream oss;
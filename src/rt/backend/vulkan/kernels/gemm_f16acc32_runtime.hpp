@@ -8,6 +8,8 @@
 
 #include <vulkan/vulkan.h>
 
+#include "descriptor_cache.hpp"
+
 namespace gcore::rt::vk {
 
 // Debe matchear nombres de winners del autotune/cache
@@ -51,12 +53,16 @@ struct GemmDispatchParams {
 
 class GemmPipelineCache {
 public:
-  explicit GemmPipelineCache(VkDevice dev) : dev_(dev) {}
+  explicit GemmPipelineCache(VkDevice dev) : dev_(dev), descs_(dev) {}
   ~GemmPipelineCache() { destroy(); }
 
   // shader_dir: directorio donde están los .spv (por ej: "./build")
   void set_shader_dir(std::string dir) { shader_dir_ = std::move(dir); }
 
+  // Optional VkPipelineCache for pipeline creation (not owned; see
+  // pipeline_cache.hpp). Must be set before the first get_or_create.
+  void set_pipeline_cache(VkPipelineCache pc) { vk_cache_ = pc; }
+
   // Habilita o no subgroup size control (lo decide Backend al crear device)
   void set_subgroup_size_control(bool enabled) {
     subgroup_size_control_ = enabled;
@@ -70,6 +76,14 @@ public:
   VkPipelineLayout pl() const { return pl_; }
   VkPipeline pipe(GemmKernelId kid) const;
 
+  // Descriptor sets bound by dispatch_gemm_f16acc32 (ver descriptor_cache.hpp).
+  DescriptorSetCache &descriptors() { return descs_; }
+
+  // resolve_gemm_kernel_id_autotune memoizado por bucket: el probe del
+  // device + lectura del JSON se hace una vez, no en cada dispatch.
+  std::optional<GemmKernelId> resolve_kernel(uint32_t M, uint32_t N,
+                                             uint32_t K);
+
   void destroy();
 
 private:
@@ -79,9 +93,13 @@ private:
   };
 
   VkDevice dev_ = VK_NULL_HANDLE;
+  DescriptorSetCache descs_;
+  VkPipelineCache vk_cache_ = VK_NULL_HANDLE;
   std::string shader_dir_ = "./build";
   bool subgroup_size_control_ = false;
 
+  std::unordered_map<std::string, GemmKernelId> kid_by_bucket_;
+
   VkDescriptorSetLayout dsl_ = VK_NULL_HANDLE;
   VkPipelineLayout pl_ = VK_NULL_HANDLE;
 
@@ -111,9 +129,11 @@ bool dispatch_gemm_f16acc32(VkDevice dev, VkPhysicalDevice phys,
                             VkCommandBuffer cmd, GemmPipelineCache &cache,
                             GemmKernelId kid, const GemmDispatchParams &p);
 
-// Ejecuta dispatch con kernel “auto” (resuelve kid por autotune/cache/env)
+// Ejecuta dispatch con kernel “auto” (resuelve kid por autotune/cache/env).
+// `used` (opcional) recibe el kernel efectivamente grabado.
 bool dispatch_gemm_f16acc32_auto(VkDevice dev, VkPhysicalDevice phys,
                                  VkCommandBuffer cmd, GemmPipelineCache &cache,
-                                 const GemmDispatchParams &p, std::string *err);
+                                 const GemmDispatchParams &p, std::string *err,
+                                 GemmKernelId *used = nullptr);
 
 } // namespace gcore::rt::vk
@@ -1,5 +1,7 @@
 #include "gemm_f32_runtime.hpp"
 
+#include "embedded_spv.hpp"
+
 #include <cstring>
 #include <filesystem>
 #include <fstream>
@@ -31,6 +33,10 @@ const char *gemm_f32_kernel_spv_filename(GemmF32KernelId id) {
 std::vector<uint32_t>
 GemmF32PipelineCache::read_spv_u32(const std::string &filename,
                                   std::string *err) const {
+  // Embedded SPIR-V first: no file I/O on the startup path.
+  if (const EmbeddedSpv *e = find_embedded_spv(filename))
+    return std::vector<uint32_t>(e->words, e->words + e->count);
+
   std::filesystem::path p = std::filesystem::path(shader_dir_) / filename;
   std::ifstream f(p, std::ios::binary);
   if (!f) {
@@ -142,7 +148,7 @@ bool GemmF32PipelineCache::create_entry(VkPhysicalDevice /*phys*/,
   cpci.layout = pl_;
 
   VkPipeline pipe = VK_NULL_HANDLE;
-  r = vkCreateComputePipelines(dev_, VK_NULL_HANDLE, 1, &cpci, nullptr, &pipe);
+  r = vkCreateComputePipelines(dev_, vk_cache_, 1, &cpci, nullptr, &pipe);
 
   vkDestroyShaderModule(dev_, sm, nullptr);
 
@@ -178,6 +184,8 @@ void GemmF32PipelineCache::destroy() {
   if (dev_ == VK_NULL_HANDLE)
     return;
 
+  descs_.destroy();
+
   for (auto &kv : pipes_) {
     if (kv.second.pipe != VK_NULL_HANDLE) {
       vkDestroyPipeline(dev_, kv.second.pipe, nullptr);
@@ -225,63 +233,24 @@ bool dispatch_gemm_f32(VkDevice dev, VkPhysicalDevice phys, VkCommandBuffer cmd,
   if (pipe == VK_NULL_HANDLE)
     return false;
 
-  VkDescriptorPoolSize ps{};
-  ps.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  ps.descriptorCount = 3;
-
-  VkDescriptorPoolCreateInfo dpci{
-      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-  dpci.maxSets = 1;
-  dpci.poolSizeCount = 1;
-  dpci.pPoolSizes = &ps;
+  GemmF32RunArgs a = p.args;
+  uint32_t gx = ceil_div_u32(a.N, 16u);
+  uint32_t gy = ceil_div_u32(a.M, 16u);
 
-  VkDescriptorPool dp = VK_NULL_HANDLE;
-  if (vkCreateDescriptorPool(dev, &dpci, nullptr, &dp) != VK_SUCCESS)
+  if (gx == 0 || gy == 0) {
+    std::cerr << "dispatch_gemm_f32: gx/gy=0 for kid="
+              << gemm_f32_kernel_name(kid) << "\n";
     return false;
+  }
 
-  VkDescriptorSetLayout dsl = cache.dsl();
-
-  VkDescriptorSetAllocateInfo dsai{
-      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
-  dsai.descriptorPool = dp;
-  dsai.descriptorSetCount = 1;
-  dsai.pSetLayouts = &dsl;
-
-  VkDescriptorSet ds = VK_NULL_HANDLE;
-  if (vkAllocateDescriptorSets(dev, &dsai, &ds) != VK_SUCCESS) {
-    vkDestroyDescriptorPool(dev, dp, nullptr);
+  // The set must outlive `cmd`: it stays allocated until retire(cmd).
+  VkDescriptorSet ds = cache.descriptors().acquire(cache.dsl(), p.A, p.B,
+                                                   p.C, cmd, &err);
+  if (ds == VK_NULL_HANDLE) {
+    std::cerr << "dispatch_gemm_f32: descriptor set: " << err << "\n";
     return false;
   }
 
-  VkDescriptorBufferInfo dbA{p.A, 0, VK_WHOLE_SIZE};
-  VkDescriptorBufferInfo dbB{p.B, 0, VK_WHOLE_SIZE};
-  VkDescriptorBufferInfo dbC{p.C, 0, VK_WHOLE_SIZE};
-
-  VkWriteDescriptorSet wr[3]{};
-  for (int i = 0; i < 3; i++)
-    wr[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-
-  wr[0].dstSet = ds;
-  wr[0].dstBinding = 0;
-  wr[0].descriptorCount = 1;
-  wr[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  wr[0].pBufferInfo = &dbA;
-
-  wr[1].dstSet = ds;
-  wr[1].dstBinding = 1;
-  wr[1].descriptorCount = 1;
-  wr[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  wr[1].pBufferInfo = &dbB;
-
-  wr[2].dstSet = ds;
-  wr[2].dstBinding = 2;
-  wr[2].descriptorCount = 1;
-  wr[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  wr[2].pBufferInfo = &dbC;
-
-  vkUpdateDescriptorSets(dev, 3, wr, 0, nullptr);
-
-  GemmF32RunArgs a = p.args;
   GemmF32PushConstants pc{a.M, a.N, a.K, a.lda, a.ldb, a.ldc};
 
   VkPipelineLayout pl = cache.pl();
@@ -292,19 +261,7 @@ bool dispatch_gemm_f32(VkDevice dev, VkPhysicalDevice phys, VkCommandBuffer cmd,
   vkCmdPushConstants(cmd, pl, VK_SHADER_STAGE_COMPUTE_BIT, 0,
                      sizeof(GemmF32PushConstants), &pc);
 
-  uint32_t gx = ceil_div_u32(a.N, 16u);
-  uint32_t gy = ceil_div_u32(a.M, 16u);
-
-  if (gx == 0 || gy == 0) {
-    std::cerr << "dispatch_gemm_f32: gx/gy=0 for kid="
-              << gemm_f32_kernel_name(kid) << "\n";
-    vkDestroyDescriptorPool(dev, dp, nullptr);
-    return false;
-  }
-
   vkCmdDispatch(cmd, gx, gy, 1);
-
-  vkDestroyDescriptorPool(dev, dp, nullptr);
   return true;
 }
 
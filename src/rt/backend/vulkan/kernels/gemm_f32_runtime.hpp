@@ -8,6 +8,8 @@
 
 #include <vulkan/vulkan.h>
 
+#include "descriptor_cache.hpp"
+
 namespace gcore::rt::vk {
 
 enum class GemmF32KernelId : uint32_t {
@@ -40,17 +42,24 @@ struct GemmF32DispatchParams {
 
 class GemmF32PipelineCache {
 public:
-  explicit GemmF32PipelineCache(VkDevice dev) : dev_(dev) {}
+  explicit GemmF32PipelineCache(VkDevice dev) : dev_(dev), descs_(dev) {}
   ~GemmF32PipelineCache() { destroy(); }
 
   void set_shader_dir(std::string dir) { shader_dir_ = std::move(dir); }
 
+  // Optional VkPipelineCache for pipeline creation (not owned; see
+  // pipeline_cache.hpp). Must be set before the first get_or_create.
+  void set_pipeline_cache(VkPipelineCache pc) { vk_cache_ = pc; }
+
   bool get_or_create(VkPhysicalDevice phys, GemmF32KernelId kid, std::string *err);
 
   VkDescriptorSetLayout dsl() const { return dsl_; }
   VkPipelineLayout pl() const { return pl_; }
   VkPipeline pipe(GemmF32KernelId kid) const;
 
+  // Descriptor sets bound by dispatch_gemm_f32 (see descriptor_cache.hpp).
+  DescriptorSetCache &descriptors() { return descs_; }
+
   void destroy();
 
 private:
@@ -60,6 +69,8 @@ private:
   };
 
   VkDevice dev_ = VK_NULL_HANDLE;
+  DescriptorSetCache descs_;
+  VkPipelineCache vk_cache_ = VK_NULL_HANDLE;
   std::string shader_dir_ = "./build";
 
   VkDescriptorSetLayout dsl_ = VK_NULL_HANDLE;
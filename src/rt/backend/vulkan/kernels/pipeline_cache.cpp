@@ -0,0 +1,212 @@
+#include "pipeline_cache.hpp"
+
+#include "../autotune/vk_autotune.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+namespace gcore::rt::vk {
+
+static constexpr char kMagic[] = "GRETAVKPC1\n";
+
+struct PipelineCacheSlot {
+  VkPhysicalDevice phys = VK_NULL_HANDLE;
+  VkPipelineCache cache = VK_NULL_HANDLE;
+  std::string path;
+  std::string key;
+  std::vector<char> saved; // Driver data last loaded from / written to disk
+  int refs = 0;
+};
+
+static std::mutex g_mu;
+static std::unordered_map<VkDevice, PipelineCacheSlot> g_caches;
+
+static bool cache_enabled() {
+  const char *v = std::getenv("GRETA_VK_PIPELINE_CACHE");
+  return !(v && (std::strcmp(v, "0") == 0 || std::strcmp(v, "false") == 0 ||
+                 std::strcmp(v, "off") == 0));
+}
+
+static uint64_t fnv1a64(const std::string &s) {
+  uint64_t h = 1469598103934665603ull;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+static std::string cache_file_for(const std::string &key) {
+  greta::vk_autotune::Cache autotune;
+  std::filesystem::path dir =
+      std::filesystem::path(autotune.path()).parent_path();
+  char name[64];
+  std::snprintf(name, sizeof(name), "vk_pipeline_cache_%016llx.bin",
+                (unsigned long long)fnv1a64(key));
+  return (dir / name).string();
+}
+
+// VkPipelineCacheHeaderVersionOne: length, version, vendorID, deviceID,
+// pipelineCacheUUID. A driver update changes the UUID.
+static bool header_matches(VkPhysicalDevice phys,
+                           const std::vector<char> &blob) {
+  if (blob.size() < 32)
+    return false;
+  uint32_t hdr[4];
+  std::memcpy(hdr, blob.data(), sizeof(hdr));
+  VkPhysicalDeviceProperties p{};
+  vkGetPhysicalDeviceProperties(phys, &p);
+  return hdr[0] >= 32 && hdr[1] == 1 && hdr[2] == p.vendorID &&
+         hdr[3] == p.deviceID &&
+         std::memcmp(blob.data() + 16, p.pipelineCacheUUID, VK_UUID_SIZE) ==
+             0;
+}
+
+// Driver data from `path`, empty if missing or written for another key.
+static std::vector<char> load_blob(const PipelineCacheSlot &s) {
+  std::ifstream f(s.path, std::ios::binary);
+  if (!f)
+    return {};
+  std::string magic(sizeof(kMagic) - 1, '\0');
+  std::string key;
+  if (!f.read(&magic[0], magic.size()) || magic != kMagic ||
+      !std::getline(f, key) || key != s.key)
+    return {};
+  std::vector<char> blob((std::istreambuf_iterator<char>(f)),
+                         std::istreambuf_iterator<char>());
+  if (!header_matches(s.phys, blob))
+    return {};
+  return blob;
+}
+
+static bool current_data(VkDevice dev, const PipelineCacheSlot &s,
+                         std::vector<char> *out, std::string *err) {
+  size_t n = 0;
+  if (vkGetPipelineCacheData(dev, s.cache, &n, nullptr) != VK_SUCCESS) {
+    if (err)
+      *err = "vkGetPipelineCacheData failed";
+    return false;
+  }
+  out->resize(n);
+  VkResult r = vkGetPipelineCacheData(dev, s.cache, &n, out->data());
+  if (r != VK_SUCCESS && r != VK_INCOMPLETE) {
+    if (err)
+      *err = "vkGetPipelineCacheData failed";
+    return false;
+  }
+  out->resize(n);
+  return true;
+}
+
+// Writes to a temp file and renames it, so concurrent processes never read
+// a torn cache.
+static bool save_locked(VkDevice dev, PipelineCacheSlot &s, std::string *err) {
+  std::vector<char> data;
+  if (!current_data(dev, s, &data, err))
+    return false;
+  if (data.empty() || data == s.saved)
+    return true;
+
+  const std::string tmp = s.path + ".tmp." + std::to_string(::getpid());
+  {
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    if (!f) {
+      if (err)
+        *err = "cannot write " + tmp;
+      return false;
+    }
+    f.write(kMagic, sizeof(kMagic) - 1);
+    f << s.key << '\n';
+    f.write(data.data(), std::streamsize(data.size()));
+    if (!f) {
+      if (err)
+        *err = "short write to " + tmp;
+      std::remove(tmp.c_str());
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, s.path, ec);
+  if (ec) {
+    std::remove(tmp.c_str());
+    if (err)
+      *err = "rename to " + s.path + " failed: " + ec.message();
+    return false;
+  }
+  s.saved.swap(data);
+  return true;
+}
+
+VkPipelineCache SharedPipelineCache::acquire(VkPhysicalDevice phys,
+                                             VkDevice dev) {
+  if (phys == VK_NULL_HANDLE || dev == VK_NULL_HANDLE || !cache_enabled())
+    return VK_NULL_HANDLE;
+
+  std::lock_guard<std::mutex> lock(g_mu);
+  auto it = g_caches.find(dev);
+  if (it != g_caches.end()) {
+    ++it->second.refs;
+    return it->second.cache;
+  }
+
+  PipelineCacheSlot s;
+  s.phys = phys;
+  s.key = greta::vk_autotune::describe_device(phys).key_string();
+  s.path = cache_file_for(s.key);
+  s.saved = load_blob(s);
+
+  VkPipelineCacheCreateInfo ci{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+  ci.initialDataSize = s.saved.size();
+  ci.pInitialData = s.saved.empty() ? nullptr : s.saved.data();
+  if (vkCreatePipelineCache(dev, &ci, nullptr, &s.cache) != VK_SUCCESS) {
+    // Rejected data: start empty rather than run without a cache.
+    s.saved.clear();
+    ci.initialDataSize = 0;
+    ci.pInitialData = nullptr;
+    if (vkCreatePipelineCache(dev, &ci, nullptr, &s.cache) != VK_SUCCESS)
+      return VK_NULL_HANDLE;
+  }
+  s.refs = 1;
+  VkPipelineCache out = s.cache;
+  g_caches.emplace(dev, std::move(s));
+  return out;
+}
+
+void SharedPipelineCache::release(VkDevice dev) {
+  std::lock_guard<std::mutex> lock(g_mu);
+  auto it = g_caches.find(dev);
+  if (it == g_caches.end() || --it->second.refs > 0)
+    return;
+  std::string err;
+  if (!save_locked(dev, it->second, &err))
+    std::cerr << "SharedPipelineCache: no se pudo guardar "
+              << it->second.path << ": " << err << "\n";
+  vkDestroyPipelineCache(dev, it->second.cache, nullptr);
+  g_caches.erase(it);
+}
+
+bool SharedPipelineCache::save(VkDevice dev, std::string *err) {
+  std::lock_guard<std::mutex> lock(g_mu);
+  auto it = g_caches.find(dev);
+  if (it == g_caches.end())
+    return true;
+  return save_locked(dev, it->second, err);
+}
+
+std::string SharedPipelineCache::path(VkDevice dev) {
+  std::lock_guard<std::mutex> lock(g_mu);
+  auto it = g_caches.find(dev);
+  return it == g_caches.end() ? std::string() : it->second.path;
+}
+
+} // namespace gcore::rt::vk
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include <vulkan/vulkan.h>
+
+namespace gcore::rt::vk {
+
+// VkPipelineCache shared by every GRETA compute pipeline on a VkDevice and
+// persisted next to vk_autotune.json:
+//   <XDG_CACHE_HOME or ~/.cache>/gretacore/vk_pipeline_cache_<hash>.bin
+// <hash> is FNV-1a of vk_autotune DeviceInfo::key_string(); the file also
+// stores the full key and is ignored when the key or the driver's
+// pipelineCacheUUID no longer match.
+// - acquire() creates/loads the cache on first use per device (refcounted).
+// - release() drops a reference; the last one saves (if the driver's data
+//   changed) and destroys the cache.
+// GRETA_VK_PIPELINE_CACHE=0: acquire() returns VK_NULL_HANDLE (no cache).
+class SharedPipelineCache {
+public:
+  static VkPipelineCache acquire(VkPhysicalDevice phys, VkDevice dev);
+  static void release(VkDevice dev);
+
+  // Writes the current data now (e.g. after warm-up in long-running
+  // processes). No-op if there is no cache for `dev` or nothing changed.
+  static bool save(VkDevice dev, std::string *err);
+
+  // Empty if the cache is disabled or `dev` has none.
+  static std::string path(VkDevice dev);
+};
+
+} // namespace gcore::rt::vk
@@ -1,5 +1,6 @@
 #include "gcore/rt/vk/buffer.hpp"
 
+#include <atomic>
 #include <cstring>
 #include <cstdlib>
 
@@ -121,11 +122,21 @@ bool create_staging_buffer(VkPhysicalDevice phys, VkDevice dev,
   return create_buffer(phys, dev, size, u, p, out, err);
 }
 
+static std::atomic<BufferDestroyHook> g_destroy_hook{nullptr};
+
+void set_buffer_destroy_hook(BufferDestroyHook hook) {
+  g_destroy_hook.store(hook, std::memory_order_release);
+}
+
 void destroy_buffer(VkDevice dev, Buffer *b) {
   if (!b)
     return;
-  if (b->buf != VK_NULL_HANDLE)
+  if (b->buf != VK_NULL_HANDLE) {
+    if (BufferDestroyHook hook =
+            g_destroy_hook.load(std::memory_order_acquire))
+      hook(dev, b->buf);
     vkDestroyBuffer(dev, b->buf, nullptr);
+  }
   if (b->mem != VK_NULL_HANDLE)
     vkFreeMemory(dev, b->mem, nullptr);
   b->buf = VK_NULL_HANDLE;
@@ -3,6 +3,7 @@
 
 #include "../kernels/gemm_f16acc32_runtime.hpp"
 #include "../kernels/gemm_f32_runtime.hpp"
+#include "../kernels/pipeline_cache.hpp"
 #include "../autotune/vk_autotune.hpp"
 
 #include <algorithm>
@@ -241,6 +242,7 @@ static bool fp16_health_check(Backend *backend, GemmPipelineCache &cache,
 
   if (!dispatch_gemm_f16acc32(backend->device(), backend->physical_device(), cmd,
                               cache, GemmKernelId::tiled_f16acc32, p)) {
+    cache.descriptors().retire(cmd);
     if (err)
       *err = "dispatch_gemm_f16acc32 failed";
     return false;
@@ -263,6 +265,10 @@ static bool fp16_health_check(Backend *backend, GemmPipelineCache &cache,
   bool ok = submit_and_wait(backend->device(), backend->queue(), cmd,
                             timeout_ms, err);
 
+  // Con timeout el cmd puede seguir pendiente: sus sets quedan asignados.
+  // destroy_buffer() invalida los sets cacheados de A/B/C.
+  if (ok)
+    cache.descriptors().retire(cmd);
   destroy_buffer(backend->device(), &bufA);
   destroy_buffer(backend->device(), &bufB);
   destroy_buffer(backend->device(), &bufC);
@@ -302,7 +308,18 @@ const char *GemmF16Acc32::variant_name(GemmVariant v) {
 }
 
 struct GemmF16Acc32::Impl {
-  explicit Impl(VkDevice dev) : cache(dev) {}
+  Impl(VkPhysicalDevice phys, VkDevice dev)
+      : dev(dev), vk_cache(SharedPipelineCache::acquire(phys, dev)),
+        cache(dev) {
+    cache.set_pipeline_cache(vk_cache);
+  }
+  ~Impl() {
+    cache.destroy();
+    if (vk_cache != VK_NULL_HANDLE)
+      SharedPipelineCache::release(dev);
+  }
+  VkDevice dev;
+  VkPipelineCache vk_cache;
   GemmPipelineCache cache;
   bool probe_only = false;
 };
@@ -358,7 +375,7 @@ bool GemmF16Acc32::init(Backend *backend, std::string shader_dir,
       shader_dir_ = (std::filesystem::current_path() / "build").string();
   }
 
-  impl_ = new Impl(backend_->device());
+  impl_ = new Impl(backend_->physical_device(), backend_->device());
   impl_->cache.set_shader_dir(shader_dir_);
 
   // Backend decide si habilitó subgroup size control en VkDevice
@@ -457,24 +474,52 @@ bool GemmF16Acc32::record_dispatch(VkCommandBuffer cmd,
   p.args.ldb = d.ldb;
   p.args.ldc = d.ldc;
 
+  // Telemetry: kernel actually recorded (after subgroup fallback)
+  GemmKernelId kid = GemmKernelId::tiled_vec2_32x8;
   bool ok = dispatch_gemm_f16acc32_auto(backend_->device(),
                                        backend_->physical_device(), cmd,
-                                       impl_->cache, p, err);
+                                       impl_->cache, p, err, &kid);
   if (!ok)
     return false;
 
-  // Telemetry: resolve winner name for debugging (best-effort)
-  auto kid_opt = resolve_gemm_kernel_id_autotune(d.M, d.N, d.K);
-  if (kid_opt) {
-    last_winner_name_ = kernel_name(*kid_opt);
-    last_variant_ = kid_to_variant(*kid_opt);
-  }
-
+  last_winner_name_ = kernel_name(kid);
+  last_variant_ = kid_to_variant(kid);
   return true;
 }
 
+void GemmF16Acc32::set_descriptor_caching(bool on) {
+  if (impl_)
+    impl_->cache.descriptors().set_caching(on);
+}
+
+void GemmF16Acc32::forget_buffer(VkBuffer buf) {
+  if (impl_)
+    impl_->cache.descriptors().invalidate(buf);
+}
+
+void GemmF16Acc32::retire(VkCommandBuffer cmd) {
+  if (impl_)
+    impl_->cache.descriptors().retire(cmd);
+}
+
+void GemmF16Acc32::reset_descriptors() {
+  if (impl_)
+    impl_->cache.descriptors().reset();
+}
+
 struct GemmF32::Impl {
-  explicit Impl(VkDevice dev) : cache(dev) {}
+  Impl(VkPhysicalDevice phys, VkDevice dev)
+      : dev(dev), vk_cache(SharedPipelineCache::acquire(phys, dev)),
+        cache(dev) {
+    cache.set_pipeline_cache(vk_cache);
+  }
+  ~Impl() {
+    cache.destroy();
+    if (vk_cache != VK_NULL_HANDLE)
+      SharedPipelineCache::release(dev);
+  }
+  VkDevice dev;
+  VkPipelineCache vk_cache;
   GemmF32PipelineCache cache;
   bool probe_only = false;
 };
@@ -505,7 +550,7 @@ bool GemmF32::init(Backend *backend, std::string shader_dir, std::string *err) {
       shader_dir_ = (std::filesystem::current_path() / "build").string();
   }
 
-  impl_ = new Impl(backend_->device());
+  impl_ = new Impl(backend_->physical_device(), backend_->device());
   impl_->cache.set_shader_dir(shader_dir_);
 
   impl_->probe_only = env_true("GRETA_VK_PROBE_ONLY");
@@ -584,6 +629,26 @@ bool GemmF32::record_dispatch(VkCommandBuffer cmd, const GemmDispatchDesc &d,
   return ok;
 }
 
+void GemmF32::set_descriptor_caching(bool on) {
+  if (impl_)
+    impl_->cache.descriptors().set_caching(on);
+}
+
+void GemmF32::forget_buffer(VkBuffer buf) {
+  if (impl_)
+    impl_->cache.descriptors().invalidate(buf);
+}
+
+void GemmF32::retire(VkCommandBuffer cmd) {
+  if (impl_)
+    impl_->cache.descriptors().retire(cmd);
+}
+
+void GemmF32::reset_descriptors() {
+  if (impl_)
+    impl_->cache.descriptors().reset();
+}
+
 GemmAuto::~GemmAuto() { shutdown(); }
 
 bool GemmAuto::init(Backend *backend, std::string shader_dir,
@@ -649,4 +714,24 @@ bool GemmAuto::record_dispatch(VkCommandBuffer cmd, const GemmDispatchDesc &d,
   return f32_.record_dispatch(cmd, d, err);
 }
 
+void GemmAuto::set_descriptor_caching(bool on) {
+  f16_.set_descriptor_caching(on);
+  f32_.set_descriptor_caching(on);
+}
+
+void GemmAuto::forget_buffer(VkBuffer buf) {
+  f16_.forget_buffer(buf);
+  f32_.forget_buffer(buf);
+}
+
+void GemmAuto::retire(VkCommandBuffer cmd) {
+  f16_.retire(cmd);
+  f32_.retire(cmd);
+}
+
+void GemmAuto::reset_descriptors() {
+  f16_.reset_descriptors();
+  f32_.reset_descriptors();
+}
+
 } // namespace gcore::rt::vk
@@ -4,8 +4,10 @@
 #include <functional>
 #include <string_view>
 
+#include "gcore/rt/metrics.hpp"
 #include "gcore/rt/stream.hpp"
 #include "gcore/rt/telemetry.hpp"
+#include "gcore/rt/thread_pool.hpp"
 
 namespace gcore::rt {
 
@@ -16,9 +18,17 @@ public:
     uint64_t submits = 0;
     uint64_t completed = 0;
     uint64_t total_work_ns = 0; // aggregated measured work time (ns)
+    // Per-job work time percentiles (ns), from a log-linear histogram.
+    uint64_t work_p50_ns = 0;
+    uint64_t work_p99_ns = 0;
+    uint64_t work_p999_ns = 0;
   };
 
-  Dispatcher();
+  // Metrics live in MetricsRegistry::global(), labelled
+  // dispatcher="<name>". Dispatchers with the same name share one series
+  // (and stats()), so short-lived instances do not grow the registry; give
+  // long-lived ones a distinct name to report them separately.
+  explicit Dispatcher(std::string_view name = "default");
 
   Dispatcher(const Dispatcher &) = delete;
   Dispatcher &operator=(const Dispatcher &) = delete;
@@ -29,12 +39,32 @@ public:
   Event submit(Stream &stream, std::function<void()> work,
                std::string_view label = "work");
 
+  // Submit independent work onto a pool: no ordering with other submits.
+  Event submit(ThreadPool &pool, std::function<void()> work,
+               std::string_view label = "work");
+
+  // Like submit(pool, ...), but the work becomes runnable only once `dep`
+  // completes. No worker is blocked while it waits.
+  Event submit_after(ThreadPool &pool, const Event &dep,
+                     std::function<void()> work,
+                     std::string_view label = "work");
+
   Stats stats() const;
 
 private:
-  Counter submits_;
-  Counter completed_;
-  Counter work_ns_;
+  // Submitted work plus its instrumentation and completion event.
+  struct Job {
+    Dispatcher *self;
+    std::function<void()> work;
+    Event done;
+    void operator()();
+  };
+
+  MetricLabels labels_;
+  Counter &submits_;
+  Counter &completed_;
+  Counter &work_ns_;
+  Histogram &work_hist_;
 };
 
 } // namespace gcore::rt
@@ -1,29 +1,52 @@
 #include "gcore/rt/dispatch.hpp"
 
-#include <atomic>
+#include <string>
 
 namespace gcore::rt {
 
-Dispatcher::Dispatcher()
-    : submits_("dispatch_submits"), completed_("dispatch_completed"),
-      work_ns_("dispatch_work_ns") {}
+Dispatcher::Dispatcher(std::string_view name)
+    : labels_{{"dispatcher", std::string(name)}},
+      submits_(MetricsRegistry::global().counter(
+          "dispatch_submits", labels_, "Work items submitted")),
+      completed_(MetricsRegistry::global().counter(
+          "dispatch_completed", labels_, "Work items finished")),
+      work_ns_(MetricsRegistry::global().counter(
+          "dispatch_work_ns", labels_, "Total time spent in work items (ns)")),
+      work_hist_(MetricsRegistry::global().histogram(
+          "dispatch_job_ns", labels_, "Time per work item (ns)")) {}
+
+void Dispatcher::Job::operator()() {
+  {
+    ScopedTimer t(self->work_ns_, self->work_hist_);
+    work();
+  }
+  self->completed_.inc(1);
+  done.signal();
+}
 
 Event Dispatcher::submit(Stream &stream, std::function<void()> work,
                          std::string_view /*label*/) {
   submits_.inc(1);
 
   Event done;
-  Event done_copy = done; // handle copiable
+  stream.enqueue(Job{this, std::move(work), done}); // Event es un handle
+  return done;
+}
 
-  stream.enqueue([this, work = std::move(work), done_copy]() mutable {
-    {
-      ScopedTimer t(work_ns_);
-      work();
-    }
-    completed_.inc(1);
-    done_copy.signal();
-  });
+Event Dispatcher::submit(ThreadPool &pool, std::function<void()> work,
+                         std::string_view /*label*/) {
+  submits_.inc(1);
+  Event done;
+  pool.submit(Job{this, std::move(work), done});
+  return done;
+}
 
+Event Dispatcher::submit_after(ThreadPool &pool, const Event &dep,
+                               std::function<void()> work,
+                               std::string_view /*label*/) {
+  submits_.inc(1);
+  Event done;
+  pool.submit_after(dep, Job{this, std::move(work), done});
   return done;
 }
 
@@ -32,6 +55,10 @@ Dispatcher::Stats Dispatcher::stats() const {
   s.submits = submits_.value();
   s.completed = completed_.value();
   s.total_work_ns = work_ns_.value();
+  const Histogram::Snapshot h = work_hist_.snapshot();
+  s.work_p50_ns = h.percentile(0.50);
+  s.work_p99_ns = h.percentile(0.99);
+  s.work_p999_ns = h.percentile(0.999);
   return s;
 }
 
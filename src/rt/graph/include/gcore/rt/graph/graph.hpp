@@ -21,6 +21,12 @@ public:
    */
   virtual bool record(VkCommandBuffer cmd, std::string *err) = 0;
 
+  /**
+   * @brief El commandBuffer ya terminó (o se descartó sin enviarse): libera
+   * lo que el nodo retuvo para él (p. ej. descriptor sets).
+   */
+  virtual void retire(VkCommandBuffer /*cmd*/) {}
+
   virtual const char *name() const = 0;
 };
 
@@ -49,6 +55,14 @@ public:
     return true;
   }
 
+  /**
+   * @brief Avisa a todos los nodos que cmd ya no está pendiente.
+   */
+  void retire_all(VkCommandBuffer cmd) {
+    for (auto &node : nodes_)
+      node->retire(cmd);
+  }
+
   size_t node_count() const { return nodes_.size(); }
 
 private:
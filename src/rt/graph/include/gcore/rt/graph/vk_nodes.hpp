@@ -18,6 +18,8 @@ public:
     return gemm_op_->record_dispatch(cmd, desc_, err);
   }
 
+  void retire(VkCommandBuffer cmd) override { gemm_op_->retire(cmd); }
+
   const char *name() const override { return "GemmNode"; }
 
 private:
@@ -30,6 +30,7 @@ bool GraphRunner::execute(vk::Backend *backend, Graph &graph,
 
   vkBeginCommandBuffer(cmd, &bi);
   if (!graph.record_all(cmd, err)) {
+    graph.retire_all(cmd);
     vkFreeCommandBuffers(dev, pool, 1, &cmd);
     return false;
   }
@@ -50,12 +51,14 @@ bool GraphRunner::execute(vk::Backend *backend, Graph &graph,
     if (err)
       *err = "vkQueueSubmit failed";
     vkDestroyFence(dev, fence, nullptr);
+    graph.retire_all(cmd);
     vkFreeCommandBuffers(dev, pool, 1, &cmd);
     return false;
   }
 
   vkWaitForFences(dev, 1, &fence, VK_TRUE, UINT64_MAX);
   vkDestroyFence(dev, fence, nullptr);
+  graph.retire_all(cmd);
   vkFreeCommandBuffers(dev, pool, 1, &cmd);
 
   return true;
@@ -3,16 +3,23 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
+#include <optional>
+#include <string>
 #include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace gcore::rt {
 
 class Stream;
+class ThreadPool;
 
 // Event: can be recorded on a Stream, waited on, and used for elapsed time.
 class Event final {
@@ -32,47 +39,238 @@ public:
   // Wait: bloquea hasta que el evento esté completo.
   void wait() const;
 
+  // Query: true si ya completó (no bloquea).
+  bool query() const;
+
   // Tiempo entre dos eventos completos (ns). 0 si alguno no completó.
   uint64_t elapsed_ns(const Event &other) const;
 
   // Runtime-internal: marca el evento como completo.
   void signal();
 
+  // Then: ejecuta fn cuando el evento complete, en el hilo que llama a
+  // signal() (o de inmediato en el llamante si ya completó). fn debe ser
+  // corto y no bloquear: corre en el worker de otro stream.
+  void then(std::function<void()> fn);
+
 private:
   struct State;
   std::shared_ptr<State> st_;
 };
 
+// TaskGraph: immutable sequence of tasks and event waits captured from a
+// Stream (Stream::begin_capture / end_capture), replayed with
+// Stream::launch(). Closures are stored once, packed in arena blocks, and
+// invoked again on every launch: replay costs no allocation per task.
+// Events recorded during capture are the same handles on every replay (and
+// Events complete only once), so use them for edges to one-off work; for
+// per-launch completion record a new Event after launch().
+class TaskGraph final {
+public:
+  TaskGraph() = default;
+  ~TaskGraph();
+
+  TaskGraph(TaskGraph &&other) noexcept;
+  TaskGraph &operator=(TaskGraph &&other) noexcept;
+  TaskGraph(const TaskGraph &) = delete;
+  TaskGraph &operator=(const TaskGraph &) = delete;
+
+  std::size_t tasks() const { return nodes_.size(); }
+  // Ring tasks per launch: one per run of tasks between waits.
+  std::size_t segments() const { return segs_.size(); }
+  bool empty() const { return segs_.empty(); }
+
+private:
+  friend class Stream;
+
+  struct Node {
+    void (*invoke)(void *obj);
+    void (*destroy)(void *obj);
+    void *obj;
+  };
+  // Optional gate, then nodes [begin, end).
+  struct Segment {
+    std::optional<Event> gate;
+    uint32_t begin = 0;
+    uint32_t end = 0;
+  };
+
+  template <class F> void add_task(F &&fn);
+  void add_wait(const Event &ev);
+  void *alloc(std::size_t size, std::size_t align);
+  void run(uint32_t begin, uint32_t end) const;
+  void reset();
+
+  std::vector<Node> nodes_;
+  std::vector<Segment> segs_;
+  std::vector<std::unique_ptr<unsigned char[]>> blocks_;
+  std::size_t block_used_ = 0;
+  std::size_t block_cap_ = 0;
+};
+
+// Stream: in-order task queue.
+// - Tasks live in a bounded lock-free MPSC ring; any thread may enqueue.
+// - Callables up to kInlineTaskBytes are stored in the ring slot itself;
+//   larger ones are moved to the heap.
+// - By default a dedicated worker thread drains the ring. A Stream bound to
+//   a ThreadPool has no thread of its own: a drain job is scheduled on the
+//   pool whenever tasks arrive, and at most one runs at a time, so tasks
+//   still execute in order.
+// - enqueue() blocks while the ring is full. The worker, full producers and
+//   flush() spin briefly, then sleep on a futex.
+// - wait_event() holds back later tasks until an Event (typically recorded
+//   on another stream) completes, without blocking any thread on it.
+// - Capture mode records enqueue()/wait_event() into a TaskGraph instead of
+//   running them; launch() replays the graph.
 class Stream final {
 public:
-  Stream();
+  static constexpr std::size_t kInlineTaskBytes = 64;
+
+  // capacity: ring slots, rounded up to a power of two.
+  explicit Stream(std::size_t capacity = 1024);
+  // Run on `pool` (which must outlive the stream). Do not flush() such a
+  // stream from a task of the same pool.
+  explicit Stream(ThreadPool &pool, std::size_t capacity = 1024);
   ~Stream();
 
   Stream(const Stream &) = delete;
   Stream &operator=(const Stream &) = delete;
 
   // Enqueue a task for execution in-order.
-  void enqueue(std::function<void()> fn);
+  template <class F> void enqueue(F &&fn);
 
-  // Blocks until all queued tasks are finished.
+  // Tasks enqueued after this call run only once `ev` has completed. The
+  // stream parks instead of waiting: its worker sleeps (or its pool drain
+  // job returns) and the event's signal() resumes it. `ev` must complete
+  // before the stream is destroyed.
+  void wait_event(const Event &ev);
+
+  // Blocks until all tasks enqueued before the call are finished.
   void flush();
 
+  // Capture: until end_capture(), enqueue() and wait_event() (and so
+  // Event::record and Dispatcher::submit) append to a graph instead of
+  // running. Only the capturing thread may use the stream meanwhile.
+  bool begin_capture(std::string *err = nullptr);
+  bool end_capture(TaskGraph *out, std::string *err = nullptr);
+  bool capturing() const {
+    return capture_.load(std::memory_order_relaxed) != nullptr;
+  }
+
+  // Enqueue a replay of `graph`, in order with other work on this stream.
+  // The graph must stay alive until the replay has run (flush() or an
+  // Event recorded afterwards).
+  void launch(const TaskGraph &graph);
+
 private:
-  struct Task {
-    std::function<void()> fn;
+  using RunFn = void (*)(void *storage); // Invokes, then destroys
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> seq{0};
+    RunFn run = nullptr;
+    alignas(std::max_align_t) unsigned char storage[kInlineTaskBytes];
   };
 
-  std::mutex mu_;
-  std::condition_variable cv_;
-  std::queue<Task> q_;
+  // Claim the slot for the next ticket, waiting while the ring is full.
+  Slot &reserve(uint64_t *pos);
+  // Hand a filled slot to the worker.
+  void publish(Slot &slot, uint64_t pos);
+
+  static void run_noop(void *) {}
+  // Marker for wait_event() slots: storage holds the Event.
+  static void run_gate(void *p);
+
+  void init(std::size_t capacity);
+  // Run ready tasks in order. One caller at a time (the worker thread or the
+  // single scheduled drain job). Stops early at an incomplete gate.
+  void drain();
+  // Next ticket is published and not held back by a gate.
+  bool runnable() const;
+  // Gate's event completed: let drain() past it.
+  void resume();
+  // Wake full producers and flush() callers that can make progress.
+  void wake_waiters();
+  // Pool mode: make sure a drain job is queued or running.
+  void schedule();
+  void drain_job();
+
+  std::unique_ptr<Slot[]> slots_;
+  uint64_t mask_ = 0;
   std::thread worker_;
   std::atomic<bool> stop_{false};
 
-  // For flush semantics
-  std::atomic<uint64_t> enqueued_{0};
+  ThreadPool *pool_ = nullptr;
+  std::atomic<TaskGraph *> capture_{nullptr};
+  std::atomic<uint32_t> scheduled_{0};  // A drain job is queued or running
+  std::atomic<uint32_t> drain_jobs_{0}; // Jobs not yet finished with *this
+  std::atomic<uint32_t> resumes_{0};    // Pending resume() callbacks
+
+  // Producer side.
+  alignas(64) std::atomic<uint64_t> tail_{0}; // Next ticket
+  // Worker side: next ticket to run, and tickets fully executed (flush
+  // target).
+  alignas(64) uint64_t head_ = 0;
   std::atomic<uint64_t> completed_{0};
 
+  // Futex words and waiter flags (see stream.cpp).
+  alignas(64) std::atomic<uint32_t> work_seq_{0};
+  std::atomic<uint32_t> worker_sleeping_{0};
+  std::atomic<uint32_t> gated_{0}; // Parked at an incomplete gate
+  std::atomic<uint32_t> space_seq_{0};
+  std::atomic<uint32_t> space_waiting_{0};
+  std::atomic<uint32_t> flush_seq_{0};
+  std::atomic<uint32_t> flush_waiters_{0};
+  std::atomic<uint64_t> flush_target_{UINT64_MAX};
+
   void worker_loop();
 };
 
+template <class F> void TaskGraph::add_task(F &&fn) {
+  using Fn = std::decay_t<F>;
+  static_assert(alignof(Fn) <= alignof(std::max_align_t),
+                "over-aligned closures cannot be captured");
+  void *obj = alloc(sizeof(Fn), alignof(Fn));
+  ::new (obj) Fn(std::forward<F>(fn));
+  nodes_.push_back(
+      {[](void *p) { (*std::launder(static_cast<Fn *>(p)))(); },
+       [](void *p) { std::launder(static_cast<Fn *>(p))->~Fn(); }, obj});
+  if (segs_.empty())
+    segs_.push_back({});
+  ++segs_.back().end;
+}
+
+template <class F> void Stream::enqueue(F &&fn) {
+  using Fn = std::decay_t<F>;
+  if (TaskGraph *g = capture_.load(std::memory_order_relaxed)) {
+    g->add_task(std::forward<F>(fn));
+    return;
+  }
+  uint64_t pos;
+  Slot &slot = reserve(&pos);
+  try {
+    if constexpr (sizeof(Fn) <= kInlineTaskBytes &&
+                  alignof(Fn) <= alignof(std::max_align_t)) {
+      ::new (static_cast<void *>(slot.storage)) Fn(std::forward<F>(fn));
+      slot.run = [](void *p) {
+        Fn &f = *std::launder(static_cast<Fn *>(p));
+        f();
+        f.~Fn();
+      };
+    } else {
+      Fn *heap = new Fn(std::forward<F>(fn));
+      ::new (static_cast<void *>(slot.storage)) Fn *(heap);
+      slot.run = [](void *p) {
+        std::unique_ptr<Fn> f(*std::launder(static_cast<Fn **>(p)));
+        (*f)();
+      };
+    }
+  } catch (...) {
+    // The ticket is taken: fill it so the worker does not stall.
+    slot.run = &run_noop;
+    publish(slot, pos);
+    throw;
+  }
+  publish(slot, pos);
+}
+
 } // namespace gcore::rt
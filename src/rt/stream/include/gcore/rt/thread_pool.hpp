@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gcore::rt {
+
+class Event;
+
+// ThreadPool: work-stealing executor for independent tasks.
+// - Each worker owns a Chase-Lev deque: it pushes and pops at the bottom
+//   (LIFO, cache-warm), idle workers steal from the top (FIFO).
+// - Tasks submitted from outside the pool go to a shared injection queue.
+// - Idle workers spin briefly, then sleep on a futex; submit() wakes one
+//   only when someone is asleep.
+// - submit_after() parks a task on an Event instead of on a worker.
+// No ordering between tasks; use a Stream bound to the pool for in-order
+// work. Tasks must not block on other tasks of the same pool.
+class ThreadPool final {
+public:
+  struct Stats {
+    uint64_t executed = 0;
+    uint64_t steals = 0;
+    uint64_t sleeps = 0;
+  };
+
+  // workers = 0 uses std::thread::hardware_concurrency().
+  explicit ThreadPool(unsigned workers = 0);
+  // Runs every task already queued, then joins the workers. Tasks parked
+  // with submit_after() must have been released by then.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  template <class F> void submit(F &&fn) {
+    submit_task(make_task(std::forward<F>(fn)));
+  }
+
+  // Run fn once `dep` has completed. No thread waits in the meantime.
+  template <class F> void submit_after(const Event &dep, F &&fn) {
+    submit_after_task(dep, make_task(std::forward<F>(fn)));
+  }
+
+  unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+  // Index of the calling worker of this pool, or -1.
+  int current_worker() const;
+
+  // Summed over workers; approximate while tasks are running.
+  Stats stats() const;
+
+  struct Task {
+    void (*run)(Task *); // Invokes, then deletes
+  };
+
+private:
+  template <class Fn> struct TaskImpl final : Task {
+    Fn fn;
+    template <class F> explicit TaskImpl(F &&f) : fn(std::forward<F>(f)) {
+      run = [](Task *t) {
+        auto *self = static_cast<TaskImpl *>(t);
+        self->fn();
+        delete self;
+      };
+    }
+  };
+
+  template <class F> static Task *make_task(F &&fn) {
+    return new TaskImpl<std::decay_t<F>>(std::forward<F>(fn));
+  }
+
+  // Chase-Lev work-stealing deque of Task pointers (Le et al., PPoPP'13).
+  class Deque {
+  public:
+    Deque();
+    ~Deque();
+    void push(Task *t); // Owner only
+    Task *pop();        // Owner only
+    Task *steal();      // Any thread; nullptr if empty or lost a race
+    bool empty() const;
+
+  private:
+    struct Array {
+      explicit Array(std::size_t cap)
+          : mask(cap - 1), slots(new std::atomic<Task *>[cap]) {}
+      std::size_t mask;
+      std::unique_ptr<std::atomic<Task *>[]> slots;
+    };
+    Array *grow(Array *a, int64_t top, int64_t bottom);
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Array *> array_;
+    // Outgrown arrays stay alive until the deque dies: a thief may still be
+    // reading one.
+    std::vector<std::unique_ptr<Array>> arrays_;
+  };
+
+  struct alignas(64) Worker {
+    Deque deque;
+    uint64_t rng = 0;
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> sleeps{0};
+  };
+
+  void submit_task(Task *t);
+  void submit_after_task(const Event &dep, Task *t);
+  Task *find_task(Worker &self, unsigned index);
+  Task *take_injected();
+  bool has_work() const;
+  void wake_one();
+  void worker_loop(unsigned index);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  std::mutex inject_mu_;
+  std::deque<Task *> injected_;
+  std::atomic<std::size_t> injected_count_{0};
+
+  alignas(64) std::atomic<uint32_t> wake_seq_{0};
+  std::atomic<uint32_t> sleepers_{0};
+  std::atomic<uint32_t> wake_pending_{0};
+  std::atomic<bool> stop_{false};
+};
+
+} // namespace gcore::rt
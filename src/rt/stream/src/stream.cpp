@@ -1,11 +1,38 @@
 #include "gcore/rt/stream.hpp"
 
+#include "gcore/rt/thread_pool.hpp"
+#include "wait.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
 namespace gcore::rt {
+
+using detail::cpu_relax;
+using detail::futex_wait;
+using detail::futex_wake;
+using detail::spin_budget;
+
+namespace {
+
+// Spin budget before sleeping. The worker adapts its own between these
+// bounds: doubled when work shows up while spinning, halved after a sleep.
+constexpr uint32_t kSpinMin = 64;
+constexpr uint32_t kSpinMax = 8192;
+
+// Run at most this many tasks between checks for sleeping producers and
+// flush() callers (each check costs a full fence).
+constexpr uint32_t kWakeBatch = 64;
+
+} // namespace
+
 struct Event::State {
   mutable std::mutex mu;
   mutable std::condition_variable cv;
   bool completed = false;
   std::chrono::steady_clock::time_point tp{};
+  std::vector<std::function<void()>> continuations;
 };
 
 // ---------------- Event ----------------
@@ -14,12 +41,29 @@ Event::Event() : st_(std::make_shared<State>()) {}
 Event::~Event() = default;
 
 void Event::signal() {
+  std::vector<std::function<void()>> conts;
   {
     std::lock_guard<std::mutex> lk(st_->mu);
     st_->completed = true;
     st_->tp = std::chrono::steady_clock::now();
+    conts.swap(st_->continuations);
+    // Notify under the lock: a waiter holding the last handle may destroy
+    // the state as soon as it can observe `completed`.
+    st_->cv.notify_all();
+  }
+  for (auto &fn : conts)
+    fn();
+}
+
+void Event::then(std::function<void()> fn) {
+  {
+    std::lock_guard<std::mutex> lk(st_->mu);
+    if (!st_->completed) {
+      st_->continuations.push_back(std::move(fn));
+      return;
+    }
   }
-  st_->cv.notify_all();
+  fn();
 }
 
 void Event::wait() const {
@@ -27,6 +71,11 @@ void Event::wait() const {
   st_->cv.wait(lk, [&] { return st_->completed; });
 }
 
+bool Event::query() const {
+  std::lock_guard<std::mutex> lk(st_->mu);
+  return st_->completed;
+}
+
 uint64_t Event::elapsed_ns(const Event &other) const {
   // Lock ordenado para evitar deadlock (por dirección del puntero)
   const State *a = st_.get();
@@ -51,54 +100,367 @@ void Event::record(Stream &stream) {
   stream.enqueue([local]() mutable { local.signal(); });
 }
 
+// ---------------- TaskGraph ----------------
+
+namespace {
+constexpr std::size_t kGraphBlockBytes = 16 * 1024;
+} // namespace
+
+TaskGraph::~TaskGraph() { reset(); }
+
+TaskGraph::TaskGraph(TaskGraph &&other) noexcept { *this = std::move(other); }
+
+TaskGraph &TaskGraph::operator=(TaskGraph &&other) noexcept {
+  if (this != &other) {
+    reset();
+    nodes_ = std::move(other.nodes_);
+    segs_ = std::move(other.segs_);
+    blocks_ = std::move(other.blocks_);
+    block_used_ = other.block_used_;
+    block_cap_ = other.block_cap_;
+    other.nodes_.clear();
+    other.segs_.clear();
+    other.blocks_.clear();
+    other.block_used_ = other.block_cap_ = 0;
+  }
+  return *this;
+}
+
+void TaskGraph::reset() {
+  for (auto it = nodes_.rbegin(); it != nodes_.rend(); ++it)
+    it->destroy(it->obj);
+  nodes_.clear();
+  segs_.clear();
+  blocks_.clear();
+  block_used_ = block_cap_ = 0;
+}
+
+void *TaskGraph::alloc(std::size_t size, std::size_t align) {
+  // Closures are packed back to back so a replay walks memory in order.
+  std::size_t at = (block_used_ + align - 1) & ~(align - 1);
+  if (blocks_.empty() || at + size > block_cap_) {
+    const std::size_t cap = std::max(size, kGraphBlockBytes);
+    blocks_.push_back(std::make_unique<unsigned char[]>(cap));
+    block_cap_ = cap;
+    at = 0;
+  }
+  block_used_ = at + size;
+  return blocks_.back().get() + at;
+}
+
+void TaskGraph::add_wait(const Event &ev) {
+  segs_.push_back({ev, static_cast<uint32_t>(nodes_.size()),
+                   static_cast<uint32_t>(nodes_.size())});
+}
+
+void TaskGraph::run(uint32_t begin, uint32_t end) const {
+  for (uint32_t i = begin; i < end; ++i)
+    nodes_[i].invoke(nodes_[i].obj);
+}
+
 // ---------------- Stream ----------------
+//
+// Ring protocol (bounded MPMC queue after D. Vyukov, single consumer):
+// slot i starts with seq = i. A producer holding ticket `pos` may fill slot
+// pos & mask once seq == pos, and publishes it with seq = pos + 1. The worker
+// runs it and frees the slot for the next lap with seq = pos + capacity.
+//
+// Sleeping: a waiter reads a sequence word, raises its flag, re-checks its
+// condition (ordered after the flag by seq_cst) and then futex-waits on the
+// word. The waking side makes its change, then bumps the word only if it can
+// clear the flag, so a wakeup is never lost and each sleep costs one wake
+// syscall.
+//
+// Gates: wait_event() publishes a slot whose run is run_gate and whose
+// storage holds the Event. drain() stops in front of it while the event is
+// incomplete, raises gated_ and registers resume() as the event's
+// continuation (once per park). resume() clears gated_ and restarts the
+// consumer the same way a publish does.
+
+static_assert(sizeof(Event) <= Stream::kInlineTaskBytes);
 
-Stream::Stream() {
+void Stream::init(std::size_t capacity) {
+  const std::size_t cap = std::bit_ceil(capacity < 2 ? 2 : capacity);
+  slots_ = std::make_unique<Slot[]>(cap);
+  for (std::size_t i = 0; i < cap; ++i)
+    slots_[i].seq.store(i, std::memory_order_relaxed);
+  mask_ = cap - 1;
+}
+
+Stream::Stream(std::size_t capacity) {
+  init(capacity);
   worker_ = std::thread([this] { worker_loop(); });
 }
 
+Stream::Stream(ThreadPool &pool, std::size_t capacity) : pool_(&pool) {
+  init(capacity);
+}
+
 Stream::~Stream() {
+  delete capture_.load(std::memory_order_relaxed); // Abandoned capture
   flush();
+  // A resume() or the last drain job may still be on its way out.
+  while (resumes_.load(std::memory_order_acquire) ||
+         drain_jobs_.load(std::memory_order_acquire))
+    std::this_thread::yield();
+  if (pool_)
+    return;
   stop_.store(true, std::memory_order_release);
-  cv_.notify_all();
+  work_seq_.fetch_add(1, std::memory_order_release);
+  futex_wake(work_seq_, 1);
   if (worker_.joinable())
     worker_.join();
 }
 
-void Stream::enqueue(std::function<void()> fn) {
-  {
-    std::lock_guard<std::mutex> lk(mu_);
-    q_.push(Task{std::move(fn)});
-    enqueued_.fetch_add(1, std::memory_order_relaxed);
+Stream::Slot &Stream::reserve(uint64_t *pos_out) {
+  uint64_t pos = tail_.load(std::memory_order_relaxed);
+  for (;;) {
+    Slot &slot = slots_[pos & mask_];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(seq - pos);
+    if (diff == 0) {
+      if (tail_.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_relaxed)) {
+        *pos_out = pos;
+        return slot;
+      }
+    } else if (diff > 0) {
+      pos = tail_.load(std::memory_order_relaxed); // Lost the race
+    } else {
+      // Full: the worker has not freed this slot from the previous lap.
+      bool freed = false;
+      for (uint32_t i = spin_budget(kSpinMin); i > 0 && !freed; --i) {
+        cpu_relax();
+        freed = slot.seq.load(std::memory_order_acquire) != seq;
+      }
+      if (!freed) {
+        const uint32_t v = space_seq_.load(std::memory_order_relaxed);
+        space_waiting_.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (slot.seq.load(std::memory_order_acquire) == seq)
+          futex_wait(space_seq_, v);
+      }
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void Stream::publish(Slot &slot, uint64_t pos) {
+  // A seq_cst RMW orders the publish before the flag check without a
+  // separate fence (a locked xchg instead of mfence on x86).
+  slot.seq.exchange(pos + 1, std::memory_order_seq_cst);
+  if (pool_) {
+    schedule();
+    return;
+  }
+  // Only the producer that clears the flag pays for the syscall. A parked
+  // worker is left alone: resume() wakes it.
+  if (worker_sleeping_.load(std::memory_order_seq_cst) &&
+      !gated_.load(std::memory_order_seq_cst) &&
+      worker_sleeping_.exchange(0, std::memory_order_relaxed)) {
+    work_seq_.fetch_add(1, std::memory_order_release);
+    futex_wake(work_seq_, 1);
+  }
+}
+
+void Stream::run_gate(void *p) {
+  std::launder(static_cast<Event *>(p))->~Event();
+}
+
+void Stream::wait_event(const Event &ev) {
+  if (TaskGraph *g = capture_.load(std::memory_order_relaxed)) {
+    g->add_wait(ev);
+    return;
+  }
+  uint64_t pos;
+  Slot &slot = reserve(&pos);
+  ::new (static_cast<void *>(slot.storage)) Event(ev);
+  slot.run = &run_gate;
+  publish(slot, pos);
+}
+
+bool Stream::begin_capture(std::string *err) {
+  if (capture_.load(std::memory_order_relaxed)) {
+    if (err)
+      *err = "stream is already capturing";
+    return false;
+  }
+  capture_.store(new TaskGraph(), std::memory_order_relaxed);
+  return true;
+}
+
+bool Stream::end_capture(TaskGraph *out, std::string *err) {
+  std::unique_ptr<TaskGraph> g(capture_.load(std::memory_order_relaxed));
+  if (!g) {
+    if (err)
+      *err = "stream is not capturing";
+    return false;
+  }
+  capture_.store(nullptr, std::memory_order_relaxed);
+  *out = std::move(*g);
+  return true;
+}
+
+void Stream::launch(const TaskGraph &graph) {
+  // Each segment is one inline ring task; gates reuse wait_event().
+  const TaskGraph *g = &graph;
+  for (const auto &seg : graph.segs_) {
+    if (seg.gate)
+      wait_event(*seg.gate);
+    if (seg.begin != seg.end)
+      enqueue([g, b = seg.begin, e = seg.end] { g->run(b, e); });
   }
-  cv_.notify_one();
+}
+
+void Stream::resume() {
+  gated_.store(0, std::memory_order_seq_cst);
+  if (pool_) {
+    schedule();
+  } else if (worker_sleeping_.load(std::memory_order_seq_cst) &&
+             worker_sleeping_.exchange(0, std::memory_order_relaxed)) {
+    work_seq_.fetch_add(1, std::memory_order_release);
+    futex_wake(work_seq_, 1);
+  }
+  resumes_.fetch_sub(1, std::memory_order_release); // Last touch
+}
+
+bool Stream::runnable() const {
+  return !gated_.load(std::memory_order_seq_cst) &&
+         slots_[head_ & mask_].seq.load(std::memory_order_seq_cst) ==
+             head_ + 1;
 }
 
 void Stream::flush() {
-  // Wait until completed >= enqueued snapshot
-  const uint64_t target = enqueued_.load(std::memory_order_acquire);
-  while (completed_.load(std::memory_order_acquire) < target) {
-    std::this_thread::yield();
+  // Wait until completed >= tickets handed out so far.
+  const uint64_t target = tail_.load(std::memory_order_acquire);
+  auto done = [&] {
+    return completed_.load(std::memory_order_acquire) >= target;
+  };
+  for (uint32_t i = spin_budget(kSpinMax); i > 0; --i) {
+    if (done())
+      return;
+    cpu_relax();
+  }
+  while (!done()) {
+    flush_waiters_.fetch_add(1, std::memory_order_relaxed);
+    // Read the word before lowering the target: if the worker resets the
+    // target after this point it also bumps the word, so the wait below
+    // returns and we re-register.
+    const uint32_t v = flush_seq_.load(std::memory_order_relaxed);
+    uint64_t cur = flush_target_.load(std::memory_order_relaxed);
+    while (target < cur &&
+           !flush_target_.compare_exchange_weak(cur, target,
+                                                std::memory_order_relaxed)) {
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!done())
+      futex_wait(flush_seq_, v);
+    flush_waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void Stream::schedule() {
+  // Pairs with drain_job(): it clears the flag and then re-checks the ring,
+  // so either it sees this task or we see the flag cleared. While parked,
+  // resume() schedules instead.
+  if (gated_.load(std::memory_order_seq_cst) ||
+      scheduled_.load(std::memory_order_seq_cst) ||
+      scheduled_.exchange(1, std::memory_order_seq_cst))
+    return;
+  drain_jobs_.fetch_add(1, std::memory_order_relaxed);
+  pool_->submit([this] { drain_job(); });
+}
+
+void Stream::drain_job() {
+  for (;;) {
+    drain();
+    // Once the flag is clear another job may start and advance head_.
+    const uint64_t head = head_;
+    scheduled_.store(0, std::memory_order_seq_cst);
+    Slot &next = slots_[head & mask_];
+    if (gated_.load(std::memory_order_seq_cst) ||
+        next.seq.load(std::memory_order_seq_cst) != head + 1 ||
+        scheduled_.exchange(1, std::memory_order_seq_cst))
+      break;
+  }
+  drain_jobs_.fetch_sub(1, std::memory_order_release); // Last touch
+}
+
+void Stream::wake_waiters() {
+  // Producers once half the ring is free (or it is empty), flush() callers
+  // whose target has been reached.
+  const uint64_t cap = mask_ + 1;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (space_waiting_.load(std::memory_order_relaxed) &&
+      tail_.load(std::memory_order_relaxed) - head_ <= cap / 2 &&
+      space_waiting_.exchange(0, std::memory_order_relaxed)) {
+    space_seq_.fetch_add(1, std::memory_order_release);
+    futex_wake(space_seq_, INT32_MAX);
+  }
+  if (flush_waiters_.load(std::memory_order_relaxed) &&
+      head_ >= flush_target_.load(std::memory_order_relaxed)) {
+    flush_target_.store(UINT64_MAX, std::memory_order_relaxed);
+    flush_seq_.fetch_add(1, std::memory_order_release);
+    futex_wake(flush_seq_, INT32_MAX);
   }
 }
 
+void Stream::drain() {
+  const uint64_t cap = mask_ + 1;
+  uint32_t ran = 0;
+  for (;;) {
+    Slot &slot = slots_[head_ & mask_];
+    if (slot.seq.load(std::memory_order_acquire) != head_ + 1)
+      break;
+    if (slot.run == &run_gate) {
+      Event &ev = *std::launder(reinterpret_cast<Event *>(slot.storage));
+      if (!ev.query()) {
+        if (!gated_.exchange(1, std::memory_order_seq_cst)) {
+          resumes_.fetch_add(1, std::memory_order_relaxed);
+          ev.then([this] { resume(); });
+        }
+        break;
+      }
+    }
+    slot.run(slot.storage);
+    slot.seq.store(head_ + cap, std::memory_order_release);
+    completed_.store(++head_, std::memory_order_release);
+    if (++ran == kWakeBatch) {
+      wake_waiters();
+      ran = 0;
+    }
+  }
+  wake_waiters();
+}
+
 void Stream::worker_loop() {
+  uint32_t spin = spin_budget(kSpinMin);
   for (;;) {
-    Task task;
-    {
-      std::unique_lock<std::mutex> lk(mu_);
-      cv_.wait(lk, [&] {
-        return stop_.load(std::memory_order_acquire) || !q_.empty();
-      });
-      if (stop_.load(std::memory_order_acquire) && q_.empty())
-        return;
-      task = std::move(q_.front());
-      q_.pop();
+    drain();
+
+    // Ring empty or parked: spin for a while, then sleep until a producer
+    // publishes or resume() runs.
+    bool got = false;
+    for (uint32_t i = spin; i > 0 && !got; --i) {
+      cpu_relax();
+      got = runnable();
+    }
+    if (got) {
+      spin = std::min(spin * 2, spin_budget(kSpinMax));
+      continue;
     }
+    spin = std::max(spin / 2, spin_budget(kSpinMin));
 
-    // Execute outside lock
-    task.fn();
-    completed_.fetch_add(1, std::memory_order_release);
+    const uint32_t v = work_seq_.load(std::memory_order_acquire);
+    worker_sleeping_.store(1, std::memory_order_seq_cst);
+    if (!runnable()) {
+      if (stop_.load(std::memory_order_acquire)) {
+        worker_sleeping_.store(0, std::memory_order_relaxed);
+        return;
+      }
+      futex_wait(work_seq_, v);
+    }
+    worker_sleeping_.store(0, std::memory_order_relaxed);
   }
 }
 
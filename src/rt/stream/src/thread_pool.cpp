@@ -0,0 +1,265 @@
+#include "gcore/rt/thread_pool.hpp"
+
+#include "gcore/rt/stream.hpp"
+#include "wait.hpp"
+
+#include <algorithm>
+
+namespace gcore::rt {
+
+namespace {
+
+constexpr uint32_t kIdleSpin = 2048;
+constexpr std::size_t kDequeInitialSlots = 256;
+
+// The pool (and worker index) the calling thread belongs to.
+struct TlsWorker {
+  const ThreadPool *pool = nullptr;
+  unsigned index = 0;
+};
+thread_local TlsWorker tls_worker;
+
+uint64_t xorshift(uint64_t &s) {
+  s ^= s << 13;
+  s ^= s >> 7;
+  s ^= s << 17;
+  return s;
+}
+
+} // namespace
+
+// ---------------- Deque ----------------
+
+ThreadPool::Deque::Deque() {
+  arrays_.push_back(std::make_unique<Array>(kDequeInitialSlots));
+  array_.store(arrays_.back().get(), std::memory_order_relaxed);
+}
+
+ThreadPool::Deque::~Deque() = default;
+
+ThreadPool::Deque::Array *ThreadPool::Deque::grow(Array *a, int64_t top,
+                                                  int64_t bottom) {
+  auto bigger = std::make_unique<Array>(2 * (a->mask + 1));
+  for (int64_t i = top; i < bottom; ++i)
+    bigger->slots[i & bigger->mask].store(
+        a->slots[i & a->mask].load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  Array *next = bigger.get();
+  arrays_.push_back(std::move(bigger));
+  array_.store(next, std::memory_order_release);
+  return next;
+}
+
+void ThreadPool::Deque::push(Task *t) {
+  const int64_t b = bottom_.load(std::memory_order_relaxed);
+  const int64_t top = top_.load(std::memory_order_acquire);
+  Array *a = array_.load(std::memory_order_relaxed);
+  if (b - top > static_cast<int64_t>(a->mask))
+    a = grow(a, top, b);
+  a->slots[b & a->mask].store(t, std::memory_order_relaxed);
+  bottom_.store(b + 1, std::memory_order_release); // Publishes the slot
+}
+
+ThreadPool::Task *ThreadPool::Deque::pop() {
+  const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+  Array *a = array_.load(std::memory_order_relaxed);
+  bottom_.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t top = top_.load(std::memory_order_relaxed);
+  if (top > b) {
+    bottom_.store(b + 1, std::memory_order_relaxed); // Empty
+    return nullptr;
+  }
+  Task *t = a->slots[b & a->mask].load(std::memory_order_relaxed);
+  if (top == b) {
+    // Last element: race thieves for it.
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+      t = nullptr;
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+  return t;
+}
+
+ThreadPool::Task *ThreadPool::Deque::steal() {
+  int64_t top = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t b = bottom_.load(std::memory_order_acquire);
+  if (top >= b)
+    return nullptr;
+  Array *a = array_.load(std::memory_order_acquire);
+  Task *t = a->slots[top & a->mask].load(std::memory_order_relaxed);
+  if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed))
+    return nullptr;
+  return t;
+}
+
+bool ThreadPool::Deque::empty() const {
+  return bottom_.load(std::memory_order_acquire) <=
+         top_.load(std::memory_order_acquire);
+}
+
+// ---------------- ThreadPool ----------------
+
+ThreadPool::ThreadPool(unsigned workers) {
+  if (workers == 0)
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < workers; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+    workers_.back()->rng = 0x9E3779B97F4A7C15ull * (i + 1);
+  }
+  threads_.reserve(workers);
+  for (unsigned i = 0; i < workers; ++i)
+    threads_.emplace_back([this, i] { worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  stop_.store(true, std::memory_order_seq_cst);
+  wake_seq_.fetch_add(1, std::memory_order_release);
+  detail::futex_wake(wake_seq_, INT32_MAX);
+  for (auto &t : threads_)
+    t.join();
+  // Late submissions from outside (e.g. an Event fired during shutdown).
+  while (Task *t = take_injected())
+    t->run(t);
+}
+
+int ThreadPool::current_worker() const {
+  return tls_worker.pool == this ? static_cast<int>(tls_worker.index) : -1;
+}
+
+void ThreadPool::submit_task(Task *t) {
+  if (tls_worker.pool == this) {
+    workers_[tls_worker.index]->deque.push(t);
+  } else {
+    std::lock_guard<std::mutex> lock(inject_mu_);
+    injected_.push_back(t);
+    injected_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  wake_one();
+}
+
+void ThreadPool::submit_after_task(const Event &dep, Task *t) {
+  Event e = dep;
+  e.then([this, t] { submit_task(t); });
+}
+
+void ThreadPool::wake_one() {
+  // Pairs with the fence in worker_loop: either the sleeper sees the new
+  // task, or we see the sleeper. One wake is in flight at a time; the woken
+  // worker passes it on if more work is queued.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers_.load(std::memory_order_relaxed) &&
+      !wake_pending_.exchange(1, std::memory_order_relaxed)) {
+    wake_seq_.fetch_add(1, std::memory_order_release);
+    detail::futex_wake(wake_seq_, 1);
+  }
+}
+
+ThreadPool::Task *ThreadPool::take_injected() {
+  if (injected_count_.load(std::memory_order_relaxed) == 0)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(inject_mu_);
+  if (injected_.empty())
+    return nullptr;
+  Task *t = injected_.front();
+  injected_.pop_front();
+  injected_count_.fetch_sub(1, std::memory_order_relaxed);
+  return t;
+}
+
+bool ThreadPool::has_work() const {
+  if (injected_count_.load(std::memory_order_relaxed))
+    return true;
+  for (const auto &w : workers_)
+    if (!w->deque.empty())
+      return true;
+  return false;
+}
+
+ThreadPool::Task *ThreadPool::find_task(Worker &self, unsigned index) {
+  if (Task *t = self.deque.pop())
+    return t;
+  if (Task *t = take_injected())
+    return t;
+  const unsigned n = size();
+  const unsigned start = static_cast<unsigned>(xorshift(self.rng) % n);
+  for (unsigned i = 0; i < n; ++i) {
+    const unsigned victim = (start + i) % n;
+    if (victim == index)
+      continue;
+    if (Task *t = workers_[victim]->deque.steal()) {
+      self.steals.store(self.steals.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+      return t;
+    }
+  }
+  return nullptr;
+}
+
+void ThreadPool::worker_loop(unsigned index) {
+  tls_worker = {this, index};
+  Worker &self = *workers_[index];
+
+  bool woke = false;
+  for (;;) {
+    if (Task *t = find_task(self, index)) {
+      if (woke) {
+        woke = false;
+        if (has_work())
+          wake_one();
+      }
+      t->run(t);
+      // Single writer: a plain increment, readable by stats().
+      self.executed.store(self.executed.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+      continue;
+    }
+
+    bool found = false;
+    for (uint32_t i = detail::spin_budget(kIdleSpin); i > 0 && !found; --i) {
+      detail::cpu_relax();
+      found = has_work();
+    }
+    if (found)
+      continue;
+
+    // Tasks still running elsewhere only push to their own worker's deque,
+    // which that worker drains before it exits.
+    if (stop_.load(std::memory_order_acquire)) {
+      if (!has_work())
+        break;
+      continue;
+    }
+
+    // Clearing wake_pending_ before the re-check means a submitter that
+    // still sees it set has its task seen by the re-check. Cleared again on
+    // the way out: a wake may have been aimed at us even if we did not sleep.
+    const uint32_t v = wake_seq_.load(std::memory_order_acquire);
+    sleepers_.fetch_add(1, std::memory_order_relaxed);
+    wake_pending_.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_work() && !stop_.load(std::memory_order_relaxed)) {
+      self.sleeps.store(self.sleeps.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+      detail::futex_wait(wake_seq_, v);
+    }
+    wake_pending_.store(0, std::memory_order_relaxed);
+    woke = true;
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  tls_worker = {};
+}
+
+ThreadPool::Stats ThreadPool::stats() const {
+  Stats s;
+  for (const auto &w : workers_) {
+    s.executed += w->executed.load(std::memory_order_relaxed);
+    s.steals += w->steals.load(std::memory_order_relaxed);
+    s.sleeps += w->sleeps.load(std::memory_order_relaxed);
+  }
+  return s;
+}
+
+} // namespace gcore::rt
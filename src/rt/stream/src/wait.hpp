@@ -0,0 +1,39 @@
+#pragma once
+
+// Spin/futex helpers shared by Stream and ThreadPool (Linux only).
+
+#include <atomic>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+namespace gcore::rt::detail {
+
+// Spin budget before sleeping. With one CPU the thread we wait for cannot
+// run while we spin, so the budget is zero.
+inline uint32_t spin_budget(uint32_t want) {
+  static const bool single_cpu = std::thread::hardware_concurrency() <= 1;
+  return single_cpu ? 0 : want;
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+inline void futex_wait(std::atomic<uint32_t> &word, uint32_t expected) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE,
+          expected, nullptr, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t> &word, int count) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE,
+          count, nullptr, nullptr, 0);
+}
+
+} // namespace gcore::rt::detail
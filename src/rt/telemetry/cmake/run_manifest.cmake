@@ -0,0 +1,32 @@
+# greta_stamp_run_manifest(<path to run_manifest.cpp>)
+# Compiles the git revision (with a -dirty suffix for uncommitted changes),
+# build type and CXX flags of this configure into run_manifest.cpp, for
+# RunManifest::collect(). The revision is taken at configure time; re-run
+# cmake (or set GRETA_GIT_SHA at run time) after committing.
+function(greta_stamp_run_manifest src)
+  set(sha "unknown")
+  find_package(Git QUIET)
+  if(GIT_FOUND)
+    execute_process(
+      COMMAND ${GIT_EXECUTABLE} rev-parse --short=12 HEAD
+      WORKING_DIRECTORY ${CMAKE_CURRENT_FUNCTION_LIST_DIR}
+      OUTPUT_VARIABLE rev
+      RESULT_VARIABLE rc
+      OUTPUT_STRIP_TRAILING_WHITESPACE
+      ERROR_QUIET)
+    if(rc EQUAL 0 AND rev)
+      set(sha ${rev})
+      execute_process(
+        COMMAND ${GIT_EXECUTABLE} status --porcelain --untracked-files=no
+        WORKING_DIRECTORY ${CMAKE_CURRENT_FUNCTION_LIST_DIR}
+        OUTPUT_VARIABLE dirty
+        ERROR_QUIET)
+      if(dirty)
+        set(sha "${sha}-dirty")
+      endif()
+    endif()
+  endif()
+  string(REPLACE "\"" "\\\"" flags "${CMAKE_CXX_FLAGS}")
+  set_source_files_properties(${src} PROPERTIES COMPILE_DEFINITIONS
+    "GRETA_GIT_SHA=\"${sha}\";GRETA_BUILD_TYPE=\"${CMAKE_BUILD_TYPE}\";GRETA_CXX_FLAGS=\"${flags}\"")
+endfunction()
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gcore::rt {
+
+// One aggregated call stack, outermost frame first. `thread` is the name the
+// sampled thread had when sampled (its comm).
+struct CpuStack {
+  std::string thread;
+  std::vector<std::string> frames;
+  uint64_t count = 0;
+};
+
+// Symbolized samples of one sampling session.
+struct CpuProfile {
+  uint32_t hz = 0;
+  uint64_t samples = 0; // Total, including dropped
+  uint64_t dropped = 0; // Sample buffer full
+  std::vector<CpuStack> stacks; // By count, descending
+
+  // Brendan Gregg's folded format ("thread;outer;...;leaf count" per line),
+  // input of flamegraph.pl / speedscope / inferno.
+  std::string to_folded() const;
+  // Top `top` functions by self samples, with inclusive (total) samples.
+  std::string flat_report(std::size_t top = 25) const;
+  // Top-down call tree per thread; subtrees under `min_pct` of all samples
+  // are pruned.
+  std::string tree_report(double min_pct = 1.0) const;
+  // Folded stacks, or flat + tree report when `path` ends in ".txt".
+  bool write(const std::string &path, std::string *err) const;
+};
+
+// CpuSampler: built-in sampling profiler for the host side (loader
+// conversion, tokenizer, sampler, CPU reference kernels).
+// - setitimer(ITIMER_PROF) raises SIGPROF every 1/hz s of process CPU time;
+//   the kernel delivers it to the thread that was running, so busy threads
+//   are sampled in proportion to their CPU use.
+// - The handler captures the interrupted thread's stack with backtrace()
+//   and its name (prctl) into a preallocated buffer (one fetch_add, no
+//   allocation or locks); samples that do not fit are counted as dropped.
+// - profile() symbolizes with dladdr() + demangling after stop(). Functions
+//   are only named if they are in the dynamic symbol table (link with
+//   -rdynamic); others show as "module+0xoffset".
+// Process-wide (one SIGPROF handler), hence a singleton.
+class CpuSampler final {
+public:
+  // Prime, so sampling does not lock step with periodic work. The kernel
+  // checks ITIMER_PROF on its tick, so rates above CONFIG_HZ (often 250)
+  // are capped there.
+  static constexpr uint32_t kDefaultHz = 199;
+  static constexpr int kMaxDepth = 64;
+  static constexpr std::size_t kDefaultBufferWords = std::size_t{1} << 21;
+
+  static CpuSampler &global();
+
+  // Installs the handler and arms the timer; discards earlier samples.
+  // Fails if already running or the handler/timer cannot be set up.
+  bool start(uint32_t hz, std::string *err,
+             std::size_t buffer_words = kDefaultBufferWords);
+  // Disarms the timer, restores the previous SIGPROF disposition and waits
+  // for in-flight handlers.
+  void stop();
+  bool running() const { return running_.load(std::memory_order_acquire); }
+
+  // Taken, including dropped.
+  uint64_t samples() const {
+    return recorded_.load(std::memory_order_relaxed) + dropped();
+  }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  // Symbolized, aggregated samples (empty while running).
+  CpuProfile profile() const;
+
+  // GRETA_PROFILE_CPU_HZ, or kDefaultHz.
+  static uint32_t hz_from_env();
+
+private:
+  CpuSampler() = default;
+  static void on_signal(int sig);
+
+  std::atomic<bool> running_{false};
+  std::atomic<bool> armed_{false}; // Handler may record
+  std::atomic<int> in_flight_{0};
+  std::atomic<std::size_t> cursor_{0};
+  std::atomic<uint64_t> recorded_{0};
+  std::atomic<uint64_t> dropped_{0};
+  // Records: [depth][thread name, 16 bytes][pc] * depth, back to back.
+  std::unique_ptr<uintptr_t[]> buf_;
+  std::size_t cap_ = 0;
+  uint32_t hz_ = 0;
+};
+
+} // namespace gcore::rt
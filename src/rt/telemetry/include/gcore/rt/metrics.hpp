@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gcore/rt/telemetry.hpp"
+
+namespace gcore::rt {
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+enum class MetricKind { Counter, Gauge, Histogram };
+
+// One metric as read by MetricsRegistry::snapshot().
+struct MetricSnapshot {
+  MetricKind kind = MetricKind::Counter;
+  std::string name;
+  std::string help;
+  MetricLabels labels;
+  uint64_t counter = 0;
+  int64_t gauge = 0;
+  Histogram::Snapshot histogram; // Only for MetricKind::Histogram
+};
+
+// MetricsRegistry: named, labelled metrics that can be enumerated.
+// - counter()/gauge()/histogram() return the metric for (name, labels),
+//   creating it on first use. The registry owns it until the registry dies
+//   (for global(), never), so references stay valid and final values are
+//   still exported after their user is gone.
+// - Registration takes a mutex; updates never do (they go straight to the
+//   metric). snapshot() walks an append-only list without locking.
+class MetricsRegistry final {
+public:
+  MetricsRegistry() = default;
+  ~MetricsRegistry();
+
+  MetricsRegistry(const MetricsRegistry &) = delete;
+  MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+
+  // Process-wide registry used by the runtime.
+  static MetricsRegistry &global();
+
+  Counter &counter(std::string_view name, const MetricLabels &labels = {},
+                   std::string_view help = {});
+  Gauge &gauge(std::string_view name, const MetricLabels &labels = {},
+               std::string_view help = {});
+  Histogram &histogram(std::string_view name, const MetricLabels &labels = {},
+                       std::string_view help = {});
+
+  // Sorted by name, then labels, so exports are deterministic.
+  std::vector<MetricSnapshot> snapshot() const;
+
+private:
+  struct Entry;
+  Entry &get_or_create(MetricKind kind, std::string_view name,
+                       const MetricLabels &labels, std::string_view help);
+
+  std::mutex mu_; // Registration only
+  std::atomic<Entry *> head_{nullptr};
+};
+
+// Prometheus text exposition format (version 0.0.4). Histograms export
+// cumulative buckets at le = 2^k - 1 (exact for integer values), plus
+// _sum and _count.
+std::string to_prometheus(const std::vector<MetricSnapshot> &metrics);
+
+// JSON object: {"timestamp_ns": ..., "metrics": [...]}. Histograms carry
+// count/sum/min/max, p50/p99/p999 and their non-empty buckets.
+std::string to_json(const std::vector<MetricSnapshot> &metrics);
+
+enum class MetricsFormat { Prometheus, Json };
+
+struct MetricsFlushOptions {
+  // File path (rewritten atomically through path.tmp + rename), or
+  // "unix:<path>" to connect to a listening Unix stream socket and send
+  // one snapshot per connection.
+  std::string target;
+  MetricsFormat format = MetricsFormat::Prometheus;
+  uint32_t interval_ms = 1000;
+  MetricsRegistry *registry = nullptr; // nullptr = global()
+};
+
+// Background thread that exports a registry every interval_ms, and once
+// more on stop().
+class MetricsFlusher final {
+public:
+  MetricsFlusher() = default;
+  ~MetricsFlusher(); // stop()
+
+  MetricsFlusher(const MetricsFlusher &) = delete;
+  MetricsFlusher &operator=(const MetricsFlusher &) = delete;
+
+  bool start(const MetricsFlushOptions &opt, std::string *err);
+  // GRETA_METRICS_OUT (target), GRETA_METRICS_FORMAT (prom|json),
+  // GRETA_METRICS_INTERVAL_MS. Returns false with an empty err when
+  // GRETA_METRICS_OUT is unset.
+  bool start_from_env(std::string *err);
+  // Export now from the calling thread.
+  bool flush_now(std::string *err);
+  void stop();
+
+  bool running() const { return thread_.joinable(); }
+  uint64_t flushes() const { return flushes_.load(); }
+  uint64_t failures() const { return failures_.load(); }
+
+private:
+  void loop();
+
+  MetricsFlushOptions opt_;
+  std::thread thread_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  std::atomic<uint64_t> flushes_{0};
+  std::atomic<uint64_t> failures_{0};
+};
+
+} // namespace gcore::rt
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+
+namespace gcore::rt {
+
+// Analytic work of one op: floating-point operations and the bytes it must
+// move to/from memory if every operand is read (or written) exactly once.
+// Transcendentals (exp, sqrt, sin) count as one flop. The byte count is
+// the compulsory traffic, so achieved GB/s against it is a lower bound on
+// what the kernel really moved.
+struct OpCost {
+  uint64_t flops = 0;
+  uint64_t bytes = 0;
+
+  bool empty() const { return flops == 0 && bytes == 0; }
+  // Arithmetic intensity in flop/byte (0 when no bytes).
+  double intensity() const {
+    return bytes ? static_cast<double>(flops) / static_cast<double>(bytes)
+                 : 0.0;
+  }
+  OpCost &operator+=(const OpCost &o) {
+    flops += o.flops;
+    bytes += o.bytes;
+    return *this;
+  }
+};
+
+inline OpCost operator+(OpCost a, const OpCost &b) { return a += b; }
+
+// Element sizes below are in bits, so sub-byte weights are exact (INT4 is
+// 4, Q4_K is 4.5).
+inline uint64_t bits_to_bytes(double bits) {
+  return static_cast<uint64_t>((bits + 7.0) / 8.0);
+}
+
+// Scale bytes of a quantized KxN weight: one fp32 scale per group of
+// `group_size` along K for each column (0 = a single per-tensor scale),
+// plus `num_heads` per-head scales.
+inline uint64_t quant_scale_bytes(uint64_t n, uint64_t k, uint32_t group_size,
+                                  uint32_t num_heads) {
+  const uint64_t scales =
+      group_size ? n * ((k + group_size - 1) / group_size) : 1;
+  return (scales + num_heads) * sizeof(float);
+}
+
+// C[MxN] = A[MxK] * B[KxN].
+inline OpCost gemm_cost(uint64_t m, uint64_t n, uint64_t k, double a_bits,
+                        double b_bits, double c_bits,
+                        uint64_t scale_bytes = 0) {
+  OpCost c;
+  c.flops = 2 * m * n * k;
+  c.bytes = bits_to_bytes(static_cast<double>(m * k) * a_bits +
+                          static_cast<double>(k * n) * b_bits +
+                          static_cast<double>(m * n) * c_bits) +
+            scale_bytes;
+  return c;
+}
+
+// y = x / rms(x) * w over `rows` rows of `cols` fp32 values.
+inline OpCost rmsnorm_cost(uint64_t rows, uint64_t cols) {
+  return {4 * rows * cols + 2 * rows, (2 * rows * cols + cols) * 4};
+}
+
+// `n` fp32 outputs from `inputs` fp32 operands each.
+inline OpCost elementwise_cost(uint64_t n, uint32_t inputs,
+                               uint32_t flops_per_elem) {
+  return {n * flops_per_elem, n * (inputs + 1) * 4};
+}
+
+// In-place rotary embedding of `rows` x `heads` x `head_dim` fp32 values:
+// per pair two sin/cos, four multiplies and two adds.
+inline OpCost rope_cost(uint64_t rows, uint64_t heads, uint64_t head_dim) {
+  const uint64_t n = rows * heads * head_dim;
+  return {4 * n, 2 * n * 4};
+}
+
+// Causal attention of `rows` new queries at positions kv_start.. over a
+// fp32 KV cache: QK^T, softmax (max, sub, exp, sum, scale) and PV per
+// (query, key) pair and head. K/V are read once per KV head.
+inline OpCost attention_cost(uint64_t rows, uint64_t kv_start, uint64_t heads,
+                             uint64_t kv_heads, uint64_t head_dim) {
+  const uint64_t pairs = rows * kv_start + rows * (rows + 1) / 2;
+  const uint64_t kv_len = kv_start + rows;
+  OpCost c;
+  c.flops = heads * pairs * (4 * head_dim + 5);
+  c.bytes = (2 * rows * heads * head_dim + 2 * kv_len * kv_heads * head_dim) *
+            4;
+  return c;
+}
+
+} // namespace gcore::rt
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gcore/rt/op_cost.hpp"
+#include "gcore/rt/telemetry.hpp"
+
+namespace gcore::rt {
+
+// One completed span. cat/name/arg_name must be string literals (or
+// otherwise outlive the Profiler): only the pointers are stored.
+struct ProfileEvent {
+  const char *cat = nullptr;
+  const char *name = nullptr;
+  const char *arg_name = nullptr; // nullptr = no args
+  int64_t arg = 0;
+  uint64_t begin_ns = 0;
+  uint64_t end_ns = 0;
+  uint32_t tid = 0; // OS thread id of the recording thread
+  OpCost cost;      // Analytic work charged to the span (see op_cost.hpp)
+};
+
+// Profiler: span timeline exported as Chrome Trace Event JSON (loads in
+// Perfetto and chrome://tracing).
+// - Each thread records into its own ring (single writer, no locks, no
+//   allocation after the first span). A full ring overwrites its oldest
+//   spans; they are reported by dropped().
+// - Rings outlive their thread, so spans from finished workers still show
+//   up in the export. Readers never block writers.
+// - Disabled by default; a disabled record() is one relaxed load.
+class Profiler final {
+public:
+  static constexpr std::size_t kDefaultCapacity = 1u << 16; // Per thread
+
+  Profiler();
+  ~Profiler();
+
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  // Process-wide profiler used by the runtime.
+  static Profiler &global();
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void set_enabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+  // Spans per thread ring (rounded up to a power of two). Applies to rings
+  // created afterwards.
+  void set_capacity(std::size_t events_per_thread);
+
+  // GRETA_PROFILE_TRACE=<path> enables the profiler and sets trace_path();
+  // GRETA_PROFILE_TRACE_EVENTS sets the per-thread capacity. Returns
+  // enabled().
+  bool init_from_env();
+  const std::string &trace_path() const { return trace_path_; }
+
+  void record(const char *cat, const char *name, uint64_t begin_ns,
+              uint64_t end_ns, const char *arg_name = nullptr,
+              int64_t arg = 0, const OpCost &cost = {});
+
+  // Spans still held by the rings, sorted by begin time.
+  std::vector<ProfileEvent> events() const;
+  uint64_t dropped() const; // Overwritten before being read
+  void clear();
+
+  std::string chrome_trace_json() const;
+  bool write_chrome_trace(const std::string &path, std::string *err) const;
+
+private:
+  struct Ring;
+  Ring *ring();
+
+  std::atomic<bool> enabled_{false};
+  std::atomic<std::size_t> capacity_{kDefaultCapacity};
+  const uint64_t id_; // Tells thread-local ring caches apart
+  std::string trace_path_;
+
+  mutable std::mutex mu_; // Ring registration and readers
+  std::vector<std::unique_ptr<Ring>> rings_;
+};
+
+// Sums the cost of every span this thread closes while the tally is open,
+// nested spans included: e.g. the work a captured graph will replay.
+class CostTally final {
+public:
+  CostTally() : parent_(t_open_) { t_open_ = this; }
+  ~CostTally() { t_open_ = parent_; }
+
+  CostTally(const CostTally &) = delete;
+  CostTally &operator=(const CostTally &) = delete;
+
+  const OpCost &cost() const { return cost_; }
+
+  static void add(const OpCost &c) {
+    for (CostTally *t = t_open_; t; t = t->parent_)
+      t->cost_ += c;
+  }
+
+private:
+  OpCost cost_;
+  CostTally *parent_;
+  static inline thread_local CostTally *t_open_ = nullptr;
+};
+
+// RAII span on Profiler::global(). Costs one relaxed load when disabled.
+// Active spans of a thread nest: charge() adds work to the innermost one,
+// so a GEMM issued inside an op span is accounted to that op only.
+class ProfileSpan final {
+public:
+  ProfileSpan(const char *cat, const char *name,
+              const char *arg_name = nullptr, int64_t arg = 0)
+      : cat_(cat), name_(name), arg_name_(arg_name), arg_(arg),
+        begin_(Profiler::global().enabled() ? now_ns() : 0) {
+    if (begin_) {
+      parent_ = t_open_;
+      t_open_ = this;
+    }
+  }
+  ~ProfileSpan() { end(); }
+
+  ProfileSpan(const ProfileSpan &) = delete;
+  ProfileSpan &operator=(const ProfileSpan &) = delete;
+
+  bool active() const { return begin_ != 0; }
+  void add_cost(const OpCost &c) { cost_ += c; }
+  // Close the span early (idempotent).
+  void end() {
+    if (begin_) {
+      Profiler::global().record(cat_, name_, begin_, now_ns(), arg_name_,
+                                arg_, cost_);
+      CostTally::add(cost_);
+      if (t_open_ == this)
+        t_open_ = parent_;
+      begin_ = 0;
+    }
+  }
+
+  // True when this thread has an active span to charge().
+  static bool charging() { return t_open_ != nullptr; }
+  static void charge(const OpCost &c) {
+    if (t_open_)
+      t_open_->cost_ += c;
+  }
+
+private:
+  const char *cat_;
+  const char *name_;
+  const char *arg_name_;
+  int64_t arg_;
+  uint64_t begin_;
+  OpCost cost_;
+  ProfileSpan *parent_ = nullptr;
+  static inline thread_local ProfileSpan *t_open_ = nullptr;
+};
+
+} // namespace gcore::rt
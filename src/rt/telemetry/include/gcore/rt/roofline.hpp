@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gcore/rt/op_cost.hpp"
+#include "gcore/rt/profiler.hpp"
+
+namespace gcore::rt {
+
+// Peak rates of the device the spans ran on; 0 = unknown (the report then
+// has achieved rates but no roofline percentage or bound).
+struct RooflinePeaks {
+  double gflops = 0.0; // Peak compute, GFLOP/s
+  double gbps = 0.0;   // Peak memory bandwidth, GB/s
+
+  bool known() const { return gflops > 0.0 && gbps > 0.0; }
+  // Intensity (flop/byte) where the bandwidth and compute roofs meet.
+  double ridge() const { return known() ? gflops / gbps : 0.0; }
+
+  // GRETA_ROOFLINE_PEAK_GFLOPS / GRETA_ROOFLINE_PEAK_GBPS.
+  static RooflinePeaks from_env();
+};
+
+// Work and time summed over the spans of one op (or one layer).
+struct RooflineRow {
+  std::string name;
+  int64_t layer = -1; // -1 when the row spans several layers
+  uint64_t calls = 0;
+  uint64_t ns = 0;
+  OpCost cost;
+
+  double gflops() const; // Achieved
+  double gbps() const;
+  // min(peak compute, intensity * peak bandwidth).
+  double attainable_gflops(const RooflinePeaks &p) const;
+  // Achieved over attainable rate: the larger of the GFLOP/s and GB/s
+  // fractions of their roofs, in percent.
+  double roofline_pct(const RooflinePeaks &p) const;
+  bool memory_bound(const RooflinePeaks &p) const {
+    return p.known() && cost.intensity() < p.ridge();
+  }
+};
+
+// Roofline view of a span timeline. Only spans with a cost count; spans
+// tagged with a "layer" arg also feed the per-layer rows.
+struct RooflineReport {
+  RooflinePeaks peaks;
+  std::vector<RooflineRow> ops;    // Per span name, by time spent
+  std::vector<RooflineRow> layers; // Per layer, in layer order
+  RooflineRow total;
+
+  static RooflineReport build(const std::vector<ProfileEvent> &events,
+                              const RooflinePeaks &peaks);
+
+  std::string to_text() const;
+  std::string to_json() const;
+  // JSON when `path` ends in ".json", text otherwise.
+  bool write(const std::string &path, std::string *err) const;
+};
+
+} // namespace gcore::rt
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace gcore::rt {
+
+// ISA and optimization macros of the translation unit that expands it, for
+// RunManifest::collect(): benches build with their own -O / -march flags,
+// so the caller (not run_manifest.cpp) has to report them.
+#if defined(__OPTIMIZE__)
+#define GRETA_BF_OPT "optimized "
+#else
+#define GRETA_BF_OPT "unoptimized "
+#endif
+#if defined(NDEBUG)
+#define GRETA_BF_NDEBUG "ndebug "
+#else
+#define GRETA_BF_NDEBUG "asserts "
+#endif
+#if defined(__AVX512F__)
+#define GRETA_BF_AVX512 "avx512f "
+#else
+#define GRETA_BF_AVX512 ""
+#endif
+#if defined(__AVX2__)
+#define GRETA_BF_AVX2 "avx2 "
+#else
+#define GRETA_BF_AVX2 ""
+#endif
+#if defined(__FMA__)
+#define GRETA_BF_FMA "fma "
+#else
+#define GRETA_BF_FMA ""
+#endif
+#if defined(__F16C__)
+#define GRETA_BF_F16C "f16c "
+#else
+#define GRETA_BF_F16C ""
+#endif
+#if defined(__ARM_NEON)
+#define GRETA_BF_NEON "neon "
+#else
+#define GRETA_BF_NEON ""
+#endif
+#define GRETA_BUILD_FEATURES                                                   \
+  GRETA_BF_OPT GRETA_BF_NDEBUG GRETA_BF_AVX512 GRETA_BF_AVX2 GRETA_BF_FMA      \
+      GRETA_BF_F16C GRETA_BF_NEON
+
+enum class MetricBetter : uint8_t { Lower, Higher };
+
+// One result with its unit. `samples` holds every repetition the bench
+// measured (one value when it only reports an aggregate); the comparator
+// needs at least two per side to test significance.
+struct ManifestMetric {
+  std::string name;
+  std::string unit;
+  MetricBetter better = MetricBetter::Lower;
+  std::vector<double> samples;
+
+  double mean() const;
+  double stddev() const; // Sample standard deviation, 0 for n < 2
+  double percentile(double p) const;
+};
+
+// Where and how a run was built and executed.
+struct HostInfo {
+  std::string hostname;
+  std::string os;   // uname sysname + release
+  std::string arch; // uname machine
+  std::string cpu_model;
+  std::vector<std::string> cpu_flags;
+  uint32_t logical_cpus = 0;
+  uint32_t affinity_cpus = 0; // CPUs this process may run on
+  std::vector<std::string> numa_nodes; // cpulist per node, node 0 first
+  uint64_t mem_total_kb = 0;
+  std::string governor; // cpufreq scaling governor of cpu0, if exposed
+
+  static HostInfo detect();
+};
+
+struct BuildInfo {
+  std::string git_sha;  // Configure-time GRETA_GIT_SHA, env overrides
+  std::string compiler; // __VERSION__
+  std::string build_type;
+  std::string flags;    // CMAKE_CXX_FLAGS + caller's GRETA_BUILD_FEATURES
+};
+
+// RunManifest: machine-readable record of one bench / inference run.
+// - collect() snapshots host, build, command line, GRETA_* (and GPU
+//   visibility) environment and the start time.
+// - param() records the run configuration, metric() the results.
+// - emit() writes JSON to `--manifest <path>` or GRETA_MANIFEST_OUT; a path
+//   naming a directory gets "<tool>-<utc>-<pid>.json" in it.
+// compare_manifests() below diffs two of them.
+class RunManifest {
+public:
+  static constexpr int kVersion = 1;
+
+  std::string tool;
+  std::string started_utc; // ISO 8601
+  std::vector<std::string> argv;
+  BuildInfo build;
+  HostInfo host;
+  uint32_t threads = 0; // Worker threads the run used (default: affinity)
+  std::map<std::string, std::string> env;
+  std::map<std::string, std::string> params;
+  std::vector<ManifestMetric> metrics; // In report order
+  std::string status;                  // "OK" / "FAILED", empty if unset
+
+  // `build_features` should be GRETA_BUILD_FEATURES as seen by the caller.
+  static RunManifest collect(const std::string &tool, int argc,
+                             const char *const *argv,
+                             const char *build_features);
+
+  void param(const std::string &key, const std::string &value) {
+    params[key] = value;
+  }
+  void param(const std::string &key, const char *value) {
+    params[key] = value ? value : "";
+  }
+  template <typename T,
+            typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+  void param(const std::string &key, T value) {
+    params[key] = format_number(static_cast<double>(value));
+  }
+
+  // Adds or replaces metric `name`.
+  void metric(const std::string &name, const std::string &unit,
+              MetricBetter better, std::vector<double> samples);
+  void metric(const std::string &name, const std::string &unit,
+              MetricBetter better, double value) {
+    metric(name, unit, better, std::vector<double>{value});
+  }
+  const ManifestMetric *find(const std::string &name) const;
+
+  std::string to_json() const;
+  static bool from_json(const std::string &text, RunManifest *out,
+                        std::string *err);
+  bool write(const std::string &path, std::string *err) const;
+  static bool load(const std::string &path, RunManifest *out,
+                   std::string *err);
+
+  // `--manifest <path>` from argv, else GRETA_MANIFEST_OUT, else empty.
+  std::string output_path() const;
+  // Writes to output_path() (no-op when empty) and prints where it went.
+  bool emit(std::string *err) const;
+
+  static std::string format_number(double v);
+};
+
+enum class MetricVerdict : uint8_t {
+  Same,       // No significant difference, or below min_rel
+  Improved,
+  Regressed,
+  Unverified, // Moved by >= min_rel but too few samples to test
+  Added,      // Only in the candidate
+  Removed,    // Only in the baseline
+};
+
+const char *metric_verdict_name(MetricVerdict v);
+
+struct CompareOptions {
+  double alpha = 0.05;  // Two-sided significance level of Welch's t-test
+  double min_rel = 0.02; // Smallest relative change worth reporting
+};
+
+struct MetricDelta {
+  std::string name;
+  std::string unit;
+  MetricBetter better = MetricBetter::Lower;
+  size_t n_base = 0, n_cand = 0;
+  double base_mean = 0.0, cand_mean = 0.0;
+  double rel = 0.0;     // (cand - base) / |base|
+  double p_value = 1.0; // 1 when not tested
+  MetricVerdict verdict = MetricVerdict::Same;
+};
+
+struct ManifestDiff {
+  CompareOptions options;
+  // Host / build / env / param differences that make runs less comparable.
+  std::vector<std::string> context;
+  std::vector<MetricDelta> metrics; // Baseline order, then added ones
+
+  size_t count(MetricVerdict v) const;
+  size_t regressions() const { return count(MetricVerdict::Regressed); }
+  std::string to_text() const;
+};
+
+ManifestDiff compare_manifests(const RunManifest &base,
+                               const RunManifest &cand,
+                               const CompareOptions &opt = {});
+
+// Two-sided p-value of Welch's unequal-variance t-test.
+double welch_p_value(const std::vector<double> &a,
+                     const std::vector<double> &b);
+
+} // namespace gcore::rt
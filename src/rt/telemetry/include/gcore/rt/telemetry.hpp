@@ -1,15 +1,22 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <string_view>
+#include <vector>
 
 namespace gcore::rt {
 
 // Monotonic clock helper (ns since unspecified epoch).
 uint64_t now_ns();
 
-// A named counter (lock-free increment).
+// Per-thread shards: threads are numbered on first use and spread over
+// kTelemetryShards cache lines, so concurrent updates from different
+// threads do not contend. Reads sum the shards.
+inline constexpr std::size_t kTelemetryShards = 64;
+
+// A named counter (sharded, lock-free increment).
 class Counter final {
 public:
   explicit Counter(std::string_view name);
@@ -18,18 +25,84 @@ public:
   Counter &operator=(const Counter &) = delete;
 
   void inc(uint64_t v = 1);
-  uint64_t value() const;
+  uint64_t value() const; // Sum over shards; approximate while updating
+  std::string_view name() const;
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> v{0};
+  };
+  Shard shards_[kTelemetryShards];
+  std::string_view name_;
+};
+
+// A named gauge: a level that goes up and down (queue depth, bytes in use).
+class Gauge final {
+public:
+  explicit Gauge(std::string_view name);
+
+  Gauge(const Gauge &) = delete;
+  Gauge &operator=(const Gauge &) = delete;
+
+  void set(int64_t v);
+  void add(int64_t v);
+  int64_t value() const;
+  std::string_view name() const;
+
+private:
+  std::atomic<int64_t> v_{0};
+  std::string_view name_;
+};
+
+// Log-linear latency histogram (HDR-style): values below 16 are exact,
+// larger ones fall in 16 sub-buckets per power of two (<= 6.25% relative
+// error). Shards are allocated on a thread's first record().
+class Histogram final {
+public:
+  static constexpr unsigned kSubBits = 4;
+  static constexpr std::size_t kBuckets = (64 - kSubBits + 1) << kSubBits;
+
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0; // 0 when empty
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets; // kBuckets entries
+
+    // Value at quantile q in [0, 1] (bucket midpoint, clamped to
+    // [min, max]). 0 when empty.
+    uint64_t percentile(double q) const;
+    double mean() const { return count ? double(sum) / double(count) : 0.0; }
+  };
+
+  explicit Histogram(std::string_view name);
+  ~Histogram();
+
+  Histogram(const Histogram &) = delete;
+  Histogram &operator=(const Histogram &) = delete;
+
+  void record(uint64_t v);
+  Snapshot snapshot() const;
   std::string_view name() const;
 
+  static std::size_t bucket_of(uint64_t v);
+  static uint64_t bucket_low(std::size_t b);  // Smallest value in bucket
+  static uint64_t bucket_high(std::size_t b); // Largest value in bucket
+
 private:
-  std::atomic<uint64_t> v_{0};
+  struct Shard;
+  Shard &shard();
+
+  std::atomic<Shard *> shards_[kTelemetryShards] = {};
   std::string_view name_;
 };
 
-// Scoped timer that accumulates elapsed time into a counter (ns).
+// Scoped timer that accumulates elapsed time into a counter (ns), and
+// optionally records it in a latency histogram.
 class ScopedTimer final {
 public:
   explicit ScopedTimer(Counter &sink_ns);
+  ScopedTimer(Counter &sink_ns, Histogram &latency_ns);
   ~ScopedTimer();
 
   ScopedTimer(const ScopedTimer &) = delete;
@@ -37,6 +110,7 @@ public:
 
 private:
   Counter &sink_;
+  Histogram *hist_ = nullptr;
   uint64_t start_;
 };
 
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gcore/rt/allocator.hpp"
+#include "gcore/rt/staging_pool.hpp"
+
+namespace gcore::rt {
+
+struct TraceWriterOptions {
+  // Pinned snapshot ring. Captures larger than half of it get a dedicated
+  // pinned buffer instead.
+  std::size_t ring_bytes = std::size_t{16} << 20;
+  // stdio buffer per output file.
+  std::size_t file_buffer_bytes = std::size_t{1} << 20;
+};
+
+// TraceWriter: asynchronous tensor tracing.
+// - capture() enqueues a device->host copy into a preallocated pinned ring
+//   and records an event after it; it never synchronizes the stream. When
+//   the ring is full it waits for the writer thread to retire old
+//   snapshots (counted in Stats::stalls).
+// - A background thread waits on each event, runs the record's formatter
+//   on the snapshot and appends the bytes to the record's file through a
+//   buffered, kept-open FILE.
+// - Records of all kinds (captures, plain lines, truncations) are written
+//   in submission order, so lines of one file keep their order.
+// Thread-safe; formatters run on the writer thread.
+class TraceWriter final {
+public:
+  // Appends the record for one snapshot to `out` (including any newline).
+  using Formatter =
+      std::function<void(const void *data, std::size_t bytes, std::string &out)>;
+
+  struct Stats {
+    uint64_t captures = 0;
+    uint64_t oversize = 0; // Captures that bypassed the ring
+    uint64_t stalls = 0;   // capture() waited for ring space
+    uint64_t records = 0;  // Records written (captures + lines)
+    uint64_t bytes_captured = 0;
+    uint64_t bytes_written = 0;
+    uint64_t errors = 0; // Failed copies or file writes
+  };
+
+  explicit TraceWriter(StagingBackend *backend,
+                       const TraceWriterOptions &opt = {});
+  ~TraceWriter(); // Drains the queue, closes files
+
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter &operator=(const TraceWriter &) = delete;
+
+  // Snapshot [src_dev, src_dev + bytes) in `stream` order and queue `fmt`
+  // for `path`. bytes may be 0 (fmt then gets no data). `stream` must stay
+  // valid until the record is written (see flush()).
+  bool capture(const std::string &path, const void *src_dev,
+               std::size_t bytes, void *stream, Formatter fmt,
+               std::string *err);
+
+  // Append line + '\n' to `path`.
+  void append_line(const std::string &path, std::string line);
+
+  // Empty `path` before any later record goes to it.
+  void truncate(const std::string &path);
+
+  // Wait until everything queued so far is written and flushed to the OS.
+  void flush();
+
+  Stats stats() const;
+
+private:
+  enum class Kind { Capture, Line, Truncate, Flush };
+
+  struct Job {
+    Kind kind = Kind::Line;
+    std::string path;
+    std::string text; // Line payload
+    Formatter fmt;
+    void *data = nullptr; // Snapshot in the ring or in `owned`
+    std::size_t bytes = 0;
+    std::size_t reserved = 0; // Ring bytes to give back (with wrap padding)
+    void *owned = nullptr;    // Dedicated pinned buffer (oversize capture)
+    void *event = nullptr;
+    uint64_t seq = 0;
+  };
+
+  struct File {
+    std::string path;
+    std::FILE *f = nullptr;
+  };
+
+  // Caller holds mu_.
+  bool reserve_locked(std::size_t bytes, std::unique_lock<std::mutex> &lock,
+                      std::size_t *offset, std::size_t *reserved);
+  void *event_locked(std::string *err);
+  uint64_t push_locked(Job &&job);
+
+  void loop();
+  void run(Job &job);
+  std::FILE *file(const std::string &path, bool truncate);
+  void close_files();
+
+  StagingBackend *backend_;
+  TraceWriterOptions opt_;
+  HostAllocator host_;
+  void *ring_ = nullptr;
+  std::size_t ring_cap_ = 0;
+
+  mutable std::mutex mu_;
+  std::condition_variable work_cv_;  // Writer thread waits for jobs
+  std::condition_variable space_cv_; // Producers wait for ring space / done
+  std::deque<Job> queue_;
+  std::vector<void *> free_events_;
+  std::size_t ring_head_ = 0;
+  std::size_t ring_used_ = 0;
+  uint64_t submitted_ = 0;
+  uint64_t completed_ = 0;
+  bool stop_ = false;
+  Stats stats_;
+
+  std::vector<File> files_; // Writer thread only
+  std::thread thread_;
+};
+
+} // namespace gcore::rt
@@ -0,0 +1,361 @@
+#include "gcore/rt/cpu_sampler.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace gcore::rt {
+
+namespace {
+
+// backtrace() frames above the interrupted one: on_signal and the signal
+// trampoline.
+constexpr int kSkipFrames = 2;
+constexpr uint32_t kMaxHz = 10000;
+constexpr std::size_t kNameWords = 16 / sizeof(uintptr_t); // TASK_COMM_LEN
+
+struct sigaction g_old_action;
+
+bool ends_with(const std::string &s, const char *suffix) {
+  const std::size_t n = std::strlen(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+std::string symbolize(uintptr_t pc) {
+  Dl_info info;
+  char buf[64];
+  if (!dladdr(reinterpret_cast<void *>(pc), &info) || !info.dli_fname) {
+    std::snprintf(buf, sizeof(buf), "0x%llx",
+                  static_cast<unsigned long long>(pc));
+    return buf;
+  }
+  if (info.dli_sname) {
+    int status = 0;
+    char *dem = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string name = status == 0 && dem ? dem : info.dli_sname;
+    std::free(dem);
+    return name;
+  }
+  const char *slash = std::strrchr(info.dli_fname, '/');
+  std::snprintf(buf, sizeof(buf), "+0x%llx",
+                static_cast<unsigned long long>(
+                    pc - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+  return std::string(slash ? slash + 1 : info.dli_fname) + buf;
+}
+
+// ';' separates frames in the folded format.
+std::string folded_safe(std::string s) {
+  std::replace(s.begin(), s.end(), ';', ':');
+  return s;
+}
+
+struct TreeNode {
+  uint64_t count = 0;
+  std::map<std::string, TreeNode> children;
+};
+
+void print_tree(std::ostringstream &os, const std::string &name,
+                const TreeNode &node, int depth, double total,
+                uint64_t min_count) {
+  char buf[48];
+  std::snprintf(buf, sizeof(buf), "%6.1f%% %8llu  ", 100.0 * node.count / total,
+                static_cast<unsigned long long>(node.count));
+  os << buf << std::string(2 * depth, ' ') << name << '\n';
+  std::vector<const std::pair<const std::string, TreeNode> *> kids;
+  for (const auto &kv : node.children)
+    if (kv.second.count >= min_count)
+      kids.push_back(&kv);
+  std::stable_sort(kids.begin(), kids.end(), [](const auto *a, const auto *b) {
+    return a->second.count > b->second.count;
+  });
+  for (const auto *kv : kids)
+    print_tree(os, kv->first, kv->second, depth + 1, total, min_count);
+}
+
+} // namespace
+
+std::string CpuProfile::to_folded() const {
+  std::ostringstream os;
+  for (const CpuStack &s : stacks) {
+    os << folded_safe(s.thread);
+    for (const std::string &f : s.frames)
+      os << ';' << folded_safe(f);
+    os << ' ' << s.count << '\n';
+  }
+  return os.str();
+}
+
+std::string CpuProfile::flat_report(std::size_t top) const {
+  struct Row {
+    uint64_t self = 0;
+    uint64_t total = 0;
+  };
+  std::map<std::string, Row> rows;
+  uint64_t all = 0;
+  for (const CpuStack &s : stacks) {
+    all += s.count;
+    if (s.frames.empty())
+      continue;
+    rows[s.frames.back()].self += s.count;
+    // Count each function once per stack, so recursion is not inflated.
+    std::vector<std::string> seen(s.frames);
+    std::sort(seen.begin(), seen.end());
+    seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+    for (const std::string &f : seen)
+      rows[f].total += s.count;
+  }
+  std::vector<std::pair<std::string, Row>> sorted(rows.begin(), rows.end());
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const auto &a, const auto &b) {
+                     return a.second.self > b.second.self;
+                   });
+  std::ostringstream os;
+  char buf[96];
+  std::snprintf(buf, sizeof(buf), "CPU profile: %llu samples at %u Hz",
+                static_cast<unsigned long long>(samples), hz);
+  os << buf;
+  if (dropped)
+    os << " (" << dropped << " dropped)";
+  os << "\n\n";
+  std::snprintf(buf, sizeof(buf), "%7s %8s %7s %8s  %s\n", "self%", "self",
+                "total%", "total", "function");
+  os << buf;
+  const double denom = all ? static_cast<double>(all) : 1.0;
+  for (std::size_t i = 0; i < sorted.size() && i < top; ++i) {
+    const Row &r = sorted[i].second;
+    std::snprintf(buf, sizeof(buf), "%6.1f%% %8llu %6.1f%% %8llu  ",
+                  100.0 * r.self / denom,
+                  static_cast<unsigned long long>(r.self),
+                  100.0 * r.total / denom,
+                  static_cast<unsigned long long>(r.total));
+    os << buf << sorted[i].first << '\n';
+  }
+  return os.str();
+}
+
+std::string CpuProfile::tree_report(double min_pct) const {
+  std::map<std::string, TreeNode> threads;
+  uint64_t all = 0;
+  for (const CpuStack &s : stacks) {
+    all += s.count;
+    TreeNode *node = &threads[s.thread];
+    node->count += s.count;
+    for (const std::string &f : s.frames) {
+      node = &node->children[f];
+      node->count += s.count;
+    }
+  }
+  const double total = all ? static_cast<double>(all) : 1.0;
+  const uint64_t min_count = std::max<uint64_t>(
+      1, static_cast<uint64_t>(min_pct / 100.0 * static_cast<double>(all)));
+  std::ostringstream os;
+  os << "Call tree (subtrees under " << min_pct << "% pruned)\n\n";
+  std::vector<const std::pair<const std::string, TreeNode> *> sorted;
+  for (const auto &kv : threads)
+    sorted.push_back(&kv);
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const auto *a, const auto *b) {
+                     return a->second.count > b->second.count;
+                   });
+  for (const auto *kv : sorted)
+    if (kv->second.count >= min_count)
+      print_tree(os, "[" + kv->first + "]", kv->second, 0, total, min_count);
+  return os.str();
+}
+
+bool CpuProfile::write(const std::string &path, std::string *err) const {
+  const std::string data = ends_with(path, ".txt")
+                               ? flat_report() + "\n" + tree_report()
+                               : to_folded();
+  std::FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    if (err)
+      *err = "open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  const bool wrote = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+  const bool closed = std::fclose(f) == 0;
+  if (!wrote || !closed) {
+    if (err)
+      *err = "write " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+CpuSampler &CpuSampler::global() {
+  static CpuSampler s;
+  return s;
+}
+
+uint32_t CpuSampler::hz_from_env() {
+  const char *v = std::getenv("GRETA_PROFILE_CPU_HZ");
+  if (!v || !*v)
+    return kDefaultHz;
+  const long hz = std::strtol(v, nullptr, 10);
+  if (hz <= 0)
+    return kDefaultHz;
+  return static_cast<uint32_t>(std::min<long>(hz, kMaxHz));
+}
+
+// Async-signal-safe: no allocation, locks or stdio. backtrace() is warmed up
+// in start() so it does not load libgcc_s here.
+void CpuSampler::on_signal(int) {
+  CpuSampler &s = global();
+  const int saved_errno = errno;
+  s.in_flight_.fetch_add(1);
+  if (s.armed_.load()) {
+    void *pcs[kMaxDepth + kSkipFrames];
+    const int n = backtrace(pcs, kMaxDepth + kSkipFrames) - kSkipFrames;
+    if (n > 0) {
+      const std::size_t words = 1 + kNameWords + static_cast<std::size_t>(n);
+      const std::size_t off =
+          s.cursor_.fetch_add(words, std::memory_order_relaxed);
+      if (off + words <= s.cap_) {
+        uintptr_t *rec = s.buf_.get() + off;
+        rec[0] = static_cast<uintptr_t>(n);
+        char name[16] = {};
+        prctl(PR_GET_NAME, name, 0, 0, 0);
+        std::memcpy(rec + 1, name, sizeof(name));
+        for (int i = 0; i < n; ++i)
+          rec[1 + kNameWords + i] =
+              reinterpret_cast<uintptr_t>(pcs[kSkipFrames + i]);
+        s.recorded_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        s.dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+  s.in_flight_.fetch_sub(1);
+  errno = saved_errno;
+}
+
+bool CpuSampler::start(uint32_t hz, std::string *err,
+                       std::size_t buffer_words) {
+  if (running_.exchange(true)) {
+    if (err)
+      *err = "CPU sampler already running";
+    return false;
+  }
+  hz = std::max<uint32_t>(1, std::min(hz, kMaxHz));
+  if (buffer_words != cap_ || !buf_) {
+    buf_.reset(new uintptr_t[buffer_words]);
+    cap_ = buffer_words;
+  }
+  // Zeroed, so a record never written reads as the end of the buffer.
+  std::fill(buf_.get(), buf_.get() + cap_, uintptr_t{0});
+  cursor_.store(0);
+  recorded_.store(0);
+  dropped_.store(0);
+  hz_ = hz;
+
+  void *warm[4];
+  (void)backtrace(warm, 4);
+
+  struct sigaction sa;
+  std::memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = &CpuSampler::on_signal;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGPROF, &sa, &g_old_action) != 0) {
+    if (err)
+      *err = std::string("sigaction(SIGPROF): ") + std::strerror(errno);
+    running_.store(false);
+    return false;
+  }
+  armed_.store(true);
+  itimerval tv;
+  tv.it_interval.tv_sec = 0;
+  tv.it_interval.tv_usec = static_cast<suseconds_t>(1000000 / hz);
+  tv.it_value = tv.it_interval;
+  if (setitimer(ITIMER_PROF, &tv, nullptr) != 0) {
+    if (err)
+      *err = std::string("setitimer(ITIMER_PROF): ") + std::strerror(errno);
+    armed_.store(false);
+    sigaction(SIGPROF, &g_old_action, nullptr);
+    running_.store(false);
+    return false;
+  }
+  return true;
+}
+
+void CpuSampler::stop() {
+  if (!running_.load())
+    return;
+  itimerval off;
+  std::memset(&off, 0, sizeof(off));
+  setitimer(ITIMER_PROF, &off, nullptr);
+  armed_.store(false);
+  while (in_flight_.load() != 0)
+    std::this_thread::yield();
+  // A SIGPROF raised before the timer stopped may still be pending, and
+  // SIG_DFL for SIGPROF terminates the process: ignore it instead.
+  struct sigaction restore = g_old_action;
+  if (!(restore.sa_flags & SA_SIGINFO) && restore.sa_handler == SIG_DFL)
+    restore.sa_handler = SIG_IGN;
+  sigaction(SIGPROF, &restore, nullptr);
+  running_.store(false);
+}
+
+CpuProfile CpuSampler::profile() const {
+  CpuProfile p;
+  p.hz = hz_;
+  if (running() || !buf_)
+    return p;
+  p.samples = samples();
+  p.dropped = dropped();
+
+  // Aggregate raw stacks first, then symbolize each distinct pc once.
+  // Key: thread name words, then pcs leaf first.
+  std::map<std::vector<uintptr_t>, uint64_t> raw;
+  const std::size_t end = std::min(cursor_.load(), cap_);
+  for (std::size_t pos = 0; pos < end;) {
+    const std::size_t depth = buf_[pos];
+    const std::size_t words = 1 + kNameWords + depth;
+    if (depth == 0 || depth > kMaxDepth || pos + words > end)
+      break;
+    raw[std::vector<uintptr_t>(buf_.get() + pos + 1,
+                               buf_.get() + pos + words)] += 1;
+    pos += words;
+  }
+
+  std::unordered_map<uintptr_t, std::string> syms;
+  std::map<std::pair<std::string, std::vector<std::string>>, uint64_t> merged;
+  for (const auto &kv : raw) {
+    char name[17] = {};
+    std::memcpy(name, kv.first.data(), 16);
+    std::vector<std::string> frames;
+    for (std::size_t i = kv.first.size() - 1; i >= kNameWords; --i) {
+      // Callers' pcs are return addresses: look up the call instruction.
+      const uintptr_t pc = i == kNameWords ? kv.first[i] : kv.first[i] - 1;
+      auto sym = syms.find(pc);
+      if (sym == syms.end())
+        sym = syms.emplace(pc, symbolize(pc)).first;
+      frames.push_back(sym->second);
+    }
+    merged[{name, std::move(frames)}] += kv.second;
+  }
+  for (auto &kv : merged)
+    p.stacks.push_back({kv.first.first, kv.first.second, kv.second});
+  std::stable_sort(p.stacks.begin(), p.stacks.end(),
+                   [](const CpuStack &a, const CpuStack &b) {
+                     return a.count > b.count;
+                   });
+  return p;
+}
+
+} // namespace gcore::rt
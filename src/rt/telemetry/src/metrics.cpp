@@ -0,0 +1,493 @@
+#include "gcore/rt/metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace gcore::rt {
+
+// ---------------- MetricsRegistry ----------------
+
+struct MetricsRegistry::Entry {
+  MetricKind kind;
+  std::string name;
+  std::string help;
+  MetricLabels labels;
+  // The metric's name view points at `name` above.
+  std::unique_ptr<Counter> counter;
+  std::unique_ptr<Gauge> gauge;
+  std::unique_ptr<Histogram> histogram;
+  Entry *next = nullptr; // Immutable once published
+};
+
+MetricsRegistry::~MetricsRegistry() {
+  Entry *e = head_.load(std::memory_order_acquire);
+  while (e) {
+    Entry *next = e->next;
+    delete e;
+    e = next;
+  }
+}
+
+MetricsRegistry &MetricsRegistry::global() {
+  // Never destroyed: metrics may be updated or flushed during exit.
+  static MetricsRegistry *r = new MetricsRegistry();
+  return *r;
+}
+
+MetricsRegistry::Entry &
+MetricsRegistry::get_or_create(MetricKind kind, std::string_view name,
+                               const MetricLabels &labels,
+                               std::string_view help) {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (Entry *e = head_.load(std::memory_order_relaxed); e; e = e->next) {
+    if (e->kind == kind && e->name == name && e->labels == labels)
+      return *e;
+  }
+  auto e = std::make_unique<Entry>();
+  e->kind = kind;
+  e->name = std::string(name);
+  e->help = std::string(help);
+  e->labels = labels;
+  switch (kind) {
+  case MetricKind::Counter:
+    e->counter = std::make_unique<Counter>(e->name);
+    break;
+  case MetricKind::Gauge:
+    e->gauge = std::make_unique<Gauge>(e->name);
+    break;
+  case MetricKind::Histogram:
+    e->histogram = std::make_unique<Histogram>(e->name);
+    break;
+  }
+  e->next = head_.load(std::memory_order_relaxed);
+  Entry *raw = e.release();
+  head_.store(raw, std::memory_order_release); // Publish to snapshot()
+  return *raw;
+}
+
+Counter &MetricsRegistry::counter(std::string_view name,
+                                  const MetricLabels &labels,
+                                  std::string_view help) {
+  return *get_or_create(MetricKind::Counter, name, labels, help).counter;
+}
+
+Gauge &MetricsRegistry::gauge(std::string_view name, const MetricLabels &labels,
+                              std::string_view help) {
+  return *get_or_create(MetricKind::Gauge, name, labels, help).gauge;
+}
+
+Histogram &MetricsRegistry::histogram(std::string_view name,
+                                      const MetricLabels &labels,
+                                      std::string_view help) {
+  return *get_or_create(MetricKind::Histogram, name, labels, help).histogram;
+}
+
+std::vector<MetricSnapshot> MetricsRegistry::snapshot() const {
+  std::vector<MetricSnapshot> out;
+  for (const Entry *e = head_.load(std::memory_order_acquire); e;
+       e = e->next) {
+    MetricSnapshot m;
+    m.kind = e->kind;
+    m.name = e->name;
+    m.help = e->help;
+    m.labels = e->labels;
+    switch (e->kind) {
+    case MetricKind::Counter:
+      m.counter = e->counter->value();
+      break;
+    case MetricKind::Gauge:
+      m.gauge = e->gauge->value();
+      break;
+    case MetricKind::Histogram:
+      m.histogram = e->histogram->snapshot();
+      break;
+    }
+    out.push_back(std::move(m));
+  }
+  std::sort(out.begin(), out.end(),
+            [](const MetricSnapshot &a, const MetricSnapshot &b) {
+              if (a.name != b.name)
+                return a.name < b.name;
+              return a.labels < b.labels;
+            });
+  return out;
+}
+
+// ---------------- Exporters ----------------
+
+namespace {
+
+// Prometheus metric/label names: [a-zA-Z_:][a-zA-Z0-9_:]*.
+std::string prom_name(std::string_view s) {
+  std::string out(s);
+  for (std::size_t i = 0; i < out.size(); ++i) {
+    const char c = out[i];
+    const bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    c == '_' || c == ':' || (i > 0 && c >= '0' && c <= '9');
+    if (!ok)
+      out[i] = '_';
+  }
+  return out.empty() ? "_" : out;
+}
+
+std::string prom_escape(std::string_view s, bool quote) {
+  std::string out;
+  for (char c : s) {
+    if (c == '\\')
+      out += "\\\\";
+    else if (c == '\n')
+      out += "\\n";
+    else if (quote && c == '"')
+      out += "\\\"";
+    else
+      out += c;
+  }
+  return out;
+}
+
+// {a="x",b="y"} with an optional extra label (le).
+std::string prom_labels(const MetricLabels &labels, std::string_view extra_key,
+                        std::string_view extra_val) {
+  if (labels.empty() && extra_key.empty())
+    return {};
+  std::string out = "{";
+  bool first = true;
+  auto add = [&](std::string_view k, std::string_view v) {
+    if (!first)
+      out += ',';
+    first = false;
+    out += prom_name(k);
+    out += "=\"";
+    out += prom_escape(v, true);
+    out += '"';
+  };
+  for (const auto &[k, v] : labels)
+    add(k, v);
+  if (!extra_key.empty())
+    add(extra_key, extra_val);
+  out += '}';
+  return out;
+}
+
+const char *kind_name(MetricKind k) {
+  switch (k) {
+  case MetricKind::Counter:
+    return "counter";
+  case MetricKind::Gauge:
+    return "gauge";
+  case MetricKind::Histogram:
+    return "histogram";
+  }
+  return "untyped";
+}
+
+void json_string(std::ostringstream &os, std::string_view s) {
+  os << '"';
+  for (char c : s) {
+    switch (c) {
+    case '"':
+      os << "\\\"";
+      break;
+    case '\\':
+      os << "\\\\";
+      break;
+    case '\n':
+      os << "\\n";
+      break;
+    case '\t':
+      os << "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+        os << buf;
+      } else {
+        os << c;
+      }
+    }
+  }
+  os << '"';
+}
+
+} // namespace
+
+std::string to_prometheus(const std::vector<MetricSnapshot> &metrics) {
+  std::ostringstream os;
+  std::string last_family;
+  for (const auto &m : metrics) {
+    const std::string name = prom_name(m.name);
+    // HELP/TYPE once per family; snapshot() keeps a family's series together.
+    if (name != last_family) {
+      if (!m.help.empty())
+        os << "# HELP " << name << ' ' << prom_escape(m.help, false) << '\n';
+      os << "# TYPE " << name << ' ' << kind_name(m.kind) << '\n';
+      last_family = name;
+    }
+    switch (m.kind) {
+    case MetricKind::Counter:
+      os << name << prom_labels(m.labels, {}, {}) << ' ' << m.counter << '\n';
+      break;
+    case MetricKind::Gauge:
+      os << name << prom_labels(m.labels, {}, {}) << ' ' << m.gauge << '\n';
+      break;
+    case MetricKind::Histogram: {
+      const auto &h = m.histogram;
+      // Bucket b ends at or below 2^k - 1 iff bucket_high(b) <= 2^k - 1.
+      uint64_t cum = 0;
+      std::size_t b = 0;
+      for (unsigned k = 1; k <= 40; ++k) {
+        const uint64_t le = (uint64_t{1} << k) - 1;
+        while (b < h.buckets.size() && Histogram::bucket_high(b) <= le)
+          cum += h.buckets[b++];
+        os << name << "_bucket"
+           << prom_labels(m.labels, "le", std::to_string(le)) << ' ' << cum
+           << '\n';
+      }
+      os << name << "_bucket" << prom_labels(m.labels, "le", "+Inf") << ' '
+         << h.count << '\n';
+      os << name << "_sum" << prom_labels(m.labels, {}, {}) << ' ' << h.sum
+         << '\n';
+      os << name << "_count" << prom_labels(m.labels, {}, {}) << ' '
+         << h.count << '\n';
+      break;
+    }
+    }
+  }
+  return os.str();
+}
+
+std::string to_json(const std::vector<MetricSnapshot> &metrics) {
+  std::ostringstream os;
+  os << "{\"timestamp_ns\":" << now_ns() << ",\"metrics\":[";
+  bool first = true;
+  for (const auto &m : metrics) {
+    if (!first)
+      os << ',';
+    first = false;
+    os << "{\"name\":";
+    json_string(os, m.name);
+    os << ",\"type\":\"" << kind_name(m.kind) << "\",\"labels\":{";
+    for (std::size_t i = 0; i < m.labels.size(); ++i) {
+      if (i)
+        os << ',';
+      json_string(os, m.labels[i].first);
+      os << ':';
+      json_string(os, m.labels[i].second);
+    }
+    os << '}';
+    if (!m.help.empty()) {
+      os << ",\"help\":";
+      json_string(os, m.help);
+    }
+    switch (m.kind) {
+    case MetricKind::Counter:
+      os << ",\"value\":" << m.counter;
+      break;
+    case MetricKind::Gauge:
+      os << ",\"value\":" << m.gauge;
+      break;
+    case MetricKind::Histogram: {
+      const auto &h = m.histogram;
+      os << ",\"count\":" << h.count << ",\"sum\":" << h.sum
+         << ",\"min\":" << h.min << ",\"max\":" << h.max
+         << ",\"p50\":" << h.percentile(0.50)
+         << ",\"p99\":" << h.percentile(0.99)
+         << ",\"p999\":" << h.percentile(0.999) << ",\"buckets\":[";
+      bool bfirst = true;
+      for (std::size_t b = 0; b < h.buckets.size(); ++b) {
+        if (!h.buckets[b])
+          continue;
+        if (!bfirst)
+          os << ',';
+        bfirst = false;
+        os << '[' << Histogram::bucket_low(b) << ','
+           << Histogram::bucket_high(b) << ',' << h.buckets[b] << ']';
+      }
+      os << ']';
+      break;
+    }
+    }
+    os << '}';
+  }
+  os << "]}\n";
+  return os.str();
+}
+
+// ---------------- MetricsFlusher ----------------
+
+namespace {
+
+constexpr std::string_view kUnixPrefix = "unix:";
+
+bool write_all(int fd, const std::string &data) {
+  std::size_t off = 0;
+  while (off < data.size()) {
+    const ssize_t n = ::write(fd, data.data() + off, data.size() - off);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    off += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+bool send_unix(const std::string &path, const std::string &data,
+               std::string *err) {
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) {
+    if (err)
+      *err = "unix socket path too long: " + path;
+    return false;
+  }
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    if (err)
+      *err = std::string("socket: ") + std::strerror(errno);
+    return false;
+  }
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  bool ok = ::connect(fd, reinterpret_cast<sockaddr *>(&addr),
+                      sizeof(addr)) == 0;
+  if (!ok && err)
+    *err = "connect " + path + ": " + std::strerror(errno);
+  if (ok && !(ok = write_all(fd, data)) && err)
+    *err = "write " + path + ": " + std::strerror(errno);
+  ::close(fd);
+  return ok;
+}
+
+bool write_file(const std::string &path, const std::string &data,
+                std::string *err) {
+  // Readers never see a partial file.
+  const std::string tmp = path + ".tmp";
+  std::FILE *f = std::fopen(tmp.c_str(), "wb");
+  if (!f) {
+    if (err)
+      *err = "open " + tmp + ": " + std::strerror(errno);
+    return false;
+  }
+  const bool wrote = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+  const bool closed = std::fclose(f) == 0;
+  if (!wrote || !closed) {
+    if (err)
+      *err = "write " + tmp + ": " + std::strerror(errno);
+    std::remove(tmp.c_str());
+    return false;
+  }
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    if (err)
+      *err = "rename " + tmp + ": " + std::strerror(errno);
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+MetricsFlusher::~MetricsFlusher() { stop(); }
+
+bool MetricsFlusher::start(const MetricsFlushOptions &opt, std::string *err) {
+  if (running()) {
+    if (err)
+      *err = "metrics flusher already running";
+    return false;
+  }
+  if (opt.target.empty() || opt.target == kUnixPrefix) {
+    if (err)
+      *err = "metrics flusher: empty target";
+    return false;
+  }
+  opt_ = opt;
+  if (!opt_.registry)
+    opt_.registry = &MetricsRegistry::global();
+  if (opt_.interval_ms == 0)
+    opt_.interval_ms = 1;
+  stop_ = false;
+  thread_ = std::thread([this] { loop(); });
+  return true;
+}
+
+bool MetricsFlusher::start_from_env(std::string *err) {
+  const char *out = std::getenv("GRETA_METRICS_OUT");
+  if (!out || !*out) {
+    if (err)
+      err->clear();
+    return false;
+  }
+  MetricsFlushOptions opt;
+  opt.target = out;
+  if (const char *fmt = std::getenv("GRETA_METRICS_FORMAT")) {
+    if (std::strcmp(fmt, "json") == 0) {
+      opt.format = MetricsFormat::Json;
+    } else if (std::strcmp(fmt, "prom") != 0 &&
+               std::strcmp(fmt, "prometheus") != 0) {
+      if (err)
+        *err = std::string("GRETA_METRICS_FORMAT: unknown format ") + fmt;
+      return false;
+    }
+  }
+  if (const char *ms = std::getenv("GRETA_METRICS_INTERVAL_MS"))
+    opt.interval_ms = static_cast<uint32_t>(std::strtoul(ms, nullptr, 10));
+  return start(opt, err);
+}
+
+bool MetricsFlusher::flush_now(std::string *err) {
+  MetricsRegistry &reg =
+      opt_.registry ? *opt_.registry : MetricsRegistry::global();
+  const auto snap = reg.snapshot();
+  const std::string data = opt_.format == MetricsFormat::Json
+                               ? to_json(snap)
+                               : to_prometheus(snap);
+  const std::string_view target = opt_.target;
+  const bool ok =
+      target.substr(0, kUnixPrefix.size()) == kUnixPrefix
+          ? send_unix(std::string(target.substr(kUnixPrefix.size())), data,
+                      err)
+          : write_file(opt_.target, data, err);
+  (ok ? flushes_ : failures_).fetch_add(1);
+  return ok;
+}
+
+void MetricsFlusher::loop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  for (;;) {
+    const bool stopping =
+        cv_.wait_for(lock, std::chrono::milliseconds(opt_.interval_ms),
+                     [&] { return stop_; });
+    lock.unlock();
+    // A scraper that is not listening is not an error worth reporting here;
+    // failures() counts it.
+    flush_now(nullptr);
+    lock.lock();
+    if (stopping)
+      return;
+  }
+}
+
+void MetricsFlusher::stop() {
+  if (!running())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+} // namespace gcore::rt
@@ -0,0 +1,294 @@
+#include "gcore/rt/profiler.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace gcore::rt {
+
+// Single-writer ring. Each slot is a small seqlock: the owner thread zeroes
+// seq, stores the span with relaxed atomics, then sets seq to index + 1
+// and bumps head. Readers copy [head - cap, head) and keep a slot only if
+// its seq was index + 1 before and after the copy, so a span being
+// overwritten is skipped instead of exported torn.
+struct Profiler::Ring {
+  struct Slot {
+    std::atomic<uint64_t> seq; // index + 1 when complete, 0 while writing
+    std::atomic<const char *> cat;
+    std::atomic<const char *> name;
+    std::atomic<const char *> arg_name;
+    std::atomic<int64_t> arg;
+    std::atomic<uint64_t> begin_ns;
+    std::atomic<uint64_t> end_ns;
+    std::atomic<uint64_t> flops;
+    std::atomic<uint64_t> bytes;
+  };
+
+  Ring(std::size_t cap, uint32_t os_tid)
+      : slots(new Slot[cap]()), cap(cap), tid(os_tid) {}
+
+  std::unique_ptr<Slot[]> slots;
+  const uint64_t cap; // Power of two
+  const uint32_t tid;
+  std::string thread_name; // Guarded by Profiler::mu_
+  alignas(64) std::atomic<uint64_t> head{0}; // Written by the owner only
+  std::atomic<uint64_t> floor{0};            // Spans below were cleared
+};
+
+namespace {
+
+std::atomic<uint64_t> g_next_profiler_id{1};
+
+struct RingCache {
+  uint64_t owner = 0; // Profiler::id_
+  void *ring = nullptr;
+  uint32_t tid = 0;
+};
+thread_local RingCache t_ring;
+
+uint32_t current_tid() {
+  if (!t_ring.tid)
+    t_ring.tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+  return t_ring.tid;
+}
+
+std::size_t round_pow2(std::size_t n) {
+  std::size_t p = 16;
+  while (p < n && p < (std::size_t(1) << 30))
+    p <<= 1;
+  return p;
+}
+
+void json_string(std::ostringstream &os, const char *s) {
+  os << '"';
+  for (; s && *s; ++s) {
+    const char c = *s;
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      os << buf;
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+// Trace Event timestamps are microseconds; keep ns precision.
+void json_us(std::ostringstream &os, uint64_t ns) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%llu.%03u",
+                static_cast<unsigned long long>(ns / 1000),
+                static_cast<unsigned>(ns % 1000));
+  os << buf;
+}
+
+} // namespace
+
+Profiler::Profiler() : id_(g_next_profiler_id.fetch_add(1)) {}
+
+Profiler::~Profiler() = default;
+
+Profiler &Profiler::global() {
+  // Never destroyed: spans may be recorded or exported during exit.
+  static Profiler *p = new Profiler();
+  return *p;
+}
+
+void Profiler::set_capacity(std::size_t events_per_thread) {
+  capacity_.store(round_pow2(events_per_thread), std::memory_order_relaxed);
+}
+
+bool Profiler::init_from_env() {
+  if (const char *n = std::getenv("GRETA_PROFILE_TRACE_EVENTS")) {
+    const unsigned long long v = std::strtoull(n, nullptr, 10);
+    if (v > 0)
+      set_capacity(static_cast<std::size_t>(v));
+  }
+  const char *path = std::getenv("GRETA_PROFILE_TRACE");
+  if (path && *path) {
+    trace_path_ = path;
+    set_enabled(true);
+  }
+  return enabled();
+}
+
+Profiler::Ring *Profiler::ring() {
+  if (t_ring.owner == id_)
+    return static_cast<Ring *>(t_ring.ring);
+  const uint32_t tid = current_tid();
+  std::lock_guard<std::mutex> lock(mu_);
+  Ring *r = nullptr;
+  // A ring left by a finished thread with the same OS tid is reused: it
+  // has no writer any more, and the timeline track stays the same.
+  for (auto &existing : rings_) {
+    if (existing->tid == tid) {
+      r = existing.get();
+      break;
+    }
+  }
+  if (!r) {
+    rings_.push_back(std::make_unique<Ring>(
+        capacity_.load(std::memory_order_relaxed), tid));
+    r = rings_.back().get();
+  }
+  char name[16] = {};
+  if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0)
+    r->thread_name = name;
+  t_ring.owner = id_;
+  t_ring.ring = r;
+  return r;
+}
+
+void Profiler::record(const char *cat, const char *name, uint64_t begin_ns,
+                      uint64_t end_ns, const char *arg_name, int64_t arg,
+                      const OpCost &cost) {
+  if (!enabled())
+    return;
+  Ring *r = ring();
+  const uint64_t h = r->head.load(std::memory_order_relaxed);
+  Ring::Slot &s = r->slots[h & (r->cap - 1)];
+  s.seq.store(0, std::memory_order_relaxed);
+  // Pairs with the readers' acquire fence: a reader that sees any of the
+  // stores below also sees seq != h + 1 on its re-check.
+  std::atomic_thread_fence(std::memory_order_release);
+  s.cat.store(cat, std::memory_order_relaxed);
+  s.name.store(name, std::memory_order_relaxed);
+  s.arg_name.store(arg_name, std::memory_order_relaxed);
+  s.arg.store(arg, std::memory_order_relaxed);
+  s.begin_ns.store(begin_ns, std::memory_order_relaxed);
+  s.end_ns.store(end_ns, std::memory_order_relaxed);
+  s.flops.store(cost.flops, std::memory_order_relaxed);
+  s.bytes.store(cost.bytes, std::memory_order_relaxed);
+  s.seq.store(h + 1, std::memory_order_release);
+  r->head.store(h + 1, std::memory_order_release);
+}
+
+std::vector<ProfileEvent> Profiler::events() const {
+  std::vector<ProfileEvent> out;
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const auto &r : rings_) {
+    const uint64_t h = r->head.load(std::memory_order_acquire);
+    const uint64_t lo = std::max(r->floor.load(std::memory_order_relaxed),
+                                 h > r->cap ? h - r->cap : 0);
+    for (uint64_t i = lo; i < h; ++i) {
+      const Ring::Slot &s = r->slots[i & (r->cap - 1)];
+      if (s.seq.load(std::memory_order_acquire) != i + 1)
+        continue; // Being overwritten
+      ProfileEvent e;
+      e.cat = s.cat.load(std::memory_order_relaxed);
+      e.name = s.name.load(std::memory_order_relaxed);
+      e.arg_name = s.arg_name.load(std::memory_order_relaxed);
+      e.arg = s.arg.load(std::memory_order_relaxed);
+      e.begin_ns = s.begin_ns.load(std::memory_order_relaxed);
+      e.end_ns = s.end_ns.load(std::memory_order_relaxed);
+      e.cost.flops = s.flops.load(std::memory_order_relaxed);
+      e.cost.bytes = s.bytes.load(std::memory_order_relaxed);
+      e.tid = r->tid;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s.seq.load(std::memory_order_relaxed) == i + 1)
+        out.push_back(e);
+    }
+  }
+  std::sort(out.begin(), out.end(),
+            [](const ProfileEvent &a, const ProfileEvent &b) {
+              return a.begin_ns != b.begin_ns ? a.begin_ns < b.begin_ns
+                                              : a.end_ns > b.end_ns;
+            });
+  return out;
+}
+
+uint64_t Profiler::dropped() const {
+  uint64_t n = 0;
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const auto &r : rings_) {
+    const uint64_t live = r->head.load(std::memory_order_acquire) -
+                          r->floor.load(std::memory_order_relaxed);
+    if (live > r->cap)
+      n += live - r->cap;
+  }
+  return n;
+}
+
+void Profiler::clear() {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto &r : rings_)
+    r->floor.store(r->head.load(std::memory_order_acquire),
+                   std::memory_order_relaxed);
+}
+
+std::string Profiler::chrome_trace_json() const {
+  const auto evs = events();
+  const unsigned pid = static_cast<unsigned>(::getpid());
+  std::ostringstream os;
+  os << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":"
+     << dropped() << "},\"traceEvents\":[";
+  os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+     << ",\"tid\":0,\"args\":{\"name\":\"greta\"}}";
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (const auto &r : rings_) {
+      if (r->thread_name.empty())
+        continue;
+      os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+         << ",\"tid\":" << r->tid << ",\"args\":{\"name\":";
+      json_string(os, r->thread_name.c_str());
+      os << "}}";
+    }
+  }
+  for (const ProfileEvent &e : evs) {
+    os << ",\n{\"name\":";
+    json_string(os, e.name);
+    os << ",\"cat\":";
+    json_string(os, e.cat);
+    os << ",\"ph\":\"X\",\"ts\":";
+    json_us(os, e.begin_ns);
+    os << ",\"dur\":";
+    json_us(os, e.end_ns > e.begin_ns ? e.end_ns - e.begin_ns : 0);
+    os << ",\"pid\":" << pid << ",\"tid\":" << e.tid;
+    if (e.arg_name || !e.cost.empty()) {
+      os << ",\"args\":{";
+      if (e.arg_name) {
+        json_string(os, e.arg_name);
+        os << ':' << e.arg;
+      }
+      if (!e.cost.empty())
+        os << (e.arg_name ? "," : "") << "\"flops\":" << e.cost.flops
+           << ",\"bytes\":" << e.cost.bytes;
+      os << '}';
+    }
+    os << '}';
+  }
+  os << "\n]}\n";
+  return os.str();
+}
+
+bool Profiler::write_chrome_trace(const std::string &path,
+                                  std::string *err) const {
+  const std::string data = chrome_trace_json();
+  std::FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    if (err)
+      *err = "open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  const bool wrote = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+  const bool closed = std::fclose(f) == 0;
+  if (!wrote || !closed) {
+    if (err)
+      *err = "write " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+} // namespace gcore::rt
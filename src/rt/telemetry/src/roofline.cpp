@@ -0,0 +1,227 @@
+#include "gcore/rt/roofline.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+namespace gcore::rt {
+
+namespace {
+
+double env_double(const char *k) {
+  const char *v = std::getenv(k);
+  if (!v || !*v)
+    return 0.0;
+  const double d = std::strtod(v, nullptr);
+  return d > 0.0 ? d : 0.0;
+}
+
+void add_span(RooflineRow &row, const ProfileEvent &e) {
+  row.calls += 1;
+  row.ns += e.end_ns > e.begin_ns ? e.end_ns - e.begin_ns : 0;
+  row.cost += e.cost;
+}
+
+bool ends_with(const std::string &s, const char *suffix) {
+  const std::size_t n = std::strlen(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+void fmt(std::ostringstream &os, const char *f, double v) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), f, v);
+  os << buf;
+}
+
+void text_row(std::ostringstream &os, const RooflineRow &r,
+              const RooflinePeaks &p) {
+  char head[64];
+  if (r.layer >= 0)
+    std::snprintf(head, sizeof(head), "%-20lld",
+                  static_cast<long long>(r.layer));
+  else
+    std::snprintf(head, sizeof(head), "%-20s", r.name.c_str());
+  os << head;
+  char buf[160];
+  std::snprintf(buf, sizeof(buf), "%8llu %11.3f %10.3f %10.2f %10.2f %9.3f",
+                static_cast<unsigned long long>(r.calls), r.ns / 1e6,
+                static_cast<double>(r.cost.flops) / 1e9, r.gflops(), r.gbps(),
+                r.cost.intensity());
+  os << buf;
+  if (p.known()) {
+    std::snprintf(buf, sizeof(buf), " %7.1f%% %s", r.roofline_pct(p),
+                  r.memory_bound(p) ? "memory" : "compute");
+    os << buf;
+  }
+  os << '\n';
+}
+
+void text_header(std::ostringstream &os, const char *first,
+                 const RooflinePeaks &p) {
+  char buf[160];
+  std::snprintf(buf, sizeof(buf), "%-20s %8s %11s %10s %10s %10s %9s", first,
+                "calls", "time_ms", "gflop", "gflop/s", "gb/s", "flop/B");
+  os << buf;
+  if (p.known())
+    os << "  roofline bound";
+  os << '\n';
+}
+
+void json_row(std::ostringstream &os, const RooflineRow &r,
+              const RooflinePeaks &p) {
+  os << '{';
+  if (r.layer >= 0)
+    os << "\"layer\":" << r.layer;
+  else
+    os << "\"op\":\"" << r.name << '"';
+  os << ",\"calls\":" << r.calls << ",\"ns\":" << r.ns
+     << ",\"flops\":" << r.cost.flops << ",\"bytes\":" << r.cost.bytes
+     << ",\"gflops\":";
+  fmt(os, "%.3f", r.gflops());
+  os << ",\"gbps\":";
+  fmt(os, "%.3f", r.gbps());
+  os << ",\"intensity\":";
+  fmt(os, "%.4f", r.cost.intensity());
+  if (p.known()) {
+    os << ",\"roofline_pct\":";
+    fmt(os, "%.2f", r.roofline_pct(p));
+    os << ",\"bound\":\"" << (r.memory_bound(p) ? "memory" : "compute")
+       << '"';
+  }
+  os << '}';
+}
+
+} // namespace
+
+RooflinePeaks RooflinePeaks::from_env() {
+  RooflinePeaks p;
+  p.gflops = env_double("GRETA_ROOFLINE_PEAK_GFLOPS");
+  p.gbps = env_double("GRETA_ROOFLINE_PEAK_GBPS");
+  return p;
+}
+
+// flop/ns and byte/ns are GFLOP/s and GB/s.
+double RooflineRow::gflops() const {
+  return ns ? static_cast<double>(cost.flops) / static_cast<double>(ns) : 0.0;
+}
+
+double RooflineRow::gbps() const {
+  return ns ? static_cast<double>(cost.bytes) / static_cast<double>(ns) : 0.0;
+}
+
+double RooflineRow::attainable_gflops(const RooflinePeaks &p) const {
+  return std::min(p.gflops, cost.intensity() * p.gbps);
+}
+
+double RooflineRow::roofline_pct(const RooflinePeaks &p) const {
+  if (!p.known())
+    return 0.0;
+  return 100.0 * std::max(gflops() / p.gflops, gbps() / p.gbps);
+}
+
+RooflineReport RooflineReport::build(const std::vector<ProfileEvent> &events,
+                                     const RooflinePeaks &peaks) {
+  RooflineReport rep;
+  rep.peaks = peaks;
+  rep.total.name = "total";
+  std::map<std::string, RooflineRow> ops;
+  std::map<int64_t, RooflineRow> layers;
+  for (const ProfileEvent &e : events) {
+    if (e.cost.empty() || !e.name)
+      continue;
+    RooflineRow &op = ops[e.name];
+    op.name = e.name;
+    add_span(op, e);
+    if (e.arg_name && std::strcmp(e.arg_name, "layer") == 0 && e.arg >= 0) {
+      RooflineRow &layer = layers[e.arg];
+      layer.name = "layer";
+      layer.layer = e.arg;
+      add_span(layer, e);
+    }
+    add_span(rep.total, e);
+  }
+  for (auto &kv : ops)
+    rep.ops.push_back(kv.second);
+  std::stable_sort(rep.ops.begin(), rep.ops.end(),
+                   [](const RooflineRow &a, const RooflineRow &b) {
+                     return a.ns > b.ns;
+                   });
+  for (auto &kv : layers)
+    rep.layers.push_back(kv.second);
+  return rep;
+}
+
+std::string RooflineReport::to_text() const {
+  std::ostringstream os;
+  os << "Roofline";
+  if (peaks.known()) {
+    os << " (peak ";
+    fmt(os, "%.1f", peaks.gflops);
+    os << " GFLOP/s, ";
+    fmt(os, "%.1f", peaks.gbps);
+    os << " GB/s, ridge ";
+    fmt(os, "%.2f", peaks.ridge());
+    os << " flop/B)";
+  } else {
+    os << " (peaks unknown: set GRETA_ROOFLINE_PEAK_GFLOPS and "
+          "GRETA_ROOFLINE_PEAK_GBPS)";
+  }
+  os << "\n\n";
+  text_header(os, "op", peaks);
+  for (const auto &r : ops)
+    text_row(os, r, peaks);
+  text_row(os, total, peaks);
+  if (!layers.empty()) {
+    os << '\n';
+    text_header(os, "layer", peaks);
+    for (const auto &r : layers)
+      text_row(os, r, peaks);
+  }
+  return os.str();
+}
+
+std::string RooflineReport::to_json() const {
+  std::ostringstream os;
+  os << "{\"peak_gflops\":";
+  fmt(os, "%.3f", peaks.gflops);
+  os << ",\"peak_gbps\":";
+  fmt(os, "%.3f", peaks.gbps);
+  os << ",\"total\":";
+  json_row(os, total, peaks);
+  os << ",\n\"ops\":[";
+  for (std::size_t i = 0; i < ops.size(); ++i) {
+    os << (i ? ",\n" : "\n");
+    json_row(os, ops[i], peaks);
+  }
+  os << "],\n\"layers\":[";
+  for (std::size_t i = 0; i < layers.size(); ++i) {
+    os << (i ? ",\n" : "\n");
+    json_row(os, layers[i], peaks);
+  }
+  os << "]}\n";
+  return os.str();
+}
+
+bool RooflineReport::write(const std::string &path, std::string *err) const {
+  const std::string data = ends_with(path, ".json") ? to_json() : to_text();
+  std::FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    if (err)
+      *err = "open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  const bool wrote = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+  const bool closed = std::fclose(f) == 0;
+  if (!wrote || !closed) {
+    if (err)
+      *err = "write " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+} // namespace gcore::rt
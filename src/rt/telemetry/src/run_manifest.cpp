@@ -0,0 +1,1076 @@
+#include "gcore/rt/run_manifest.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <utility>
+
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+extern char **environ;
+
+// Configure-time build description (see the CMakeLists that build this).
+#ifndef GRETA_GIT_SHA
+#define GRETA_GIT_SHA "unknown"
+#endif
+#ifndef GRETA_BUILD_TYPE
+#define GRETA_BUILD_TYPE ""
+#endif
+#ifndef GRETA_CXX_FLAGS
+#define GRETA_CXX_FLAGS ""
+#endif
+
+namespace gcore::rt {
+
+namespace {
+
+// Non-GRETA_ variables that change what a run measures.
+const char *const kExtraEnv[] = {
+    "HIP_VISIBLE_DEVICES", "ROCR_VISIBLE_DEVICES", "HSA_OVERRIDE_GFX_VERSION",
+    "OMP_NUM_THREADS",     "VK_ICD_FILENAMES",
+};
+
+// GRETA_ variables that only say where output goes.
+bool output_only_env(const std::string &k) {
+  return k == "GRETA_MANIFEST_OUT" || k == "GRETA_GIT_SHA" ||
+         (k.size() > 4 && k.compare(k.size() - 4, 4, "_OUT") == 0);
+}
+
+std::string trim(const std::string &s) {
+  const auto b = s.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos)
+    return {};
+  const auto e = s.find_last_not_of(" \t\r\n");
+  return s.substr(b, e - b + 1);
+}
+
+std::string read_line(const char *path) {
+  std::ifstream f(path);
+  std::string line;
+  std::getline(f, line);
+  return trim(line);
+}
+
+std::string utc_now(const char *fmt) {
+  const std::time_t t = std::time(nullptr);
+  std::tm tm{};
+  gmtime_r(&t, &tm);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), fmt, &tm);
+  return buf;
+}
+
+bool is_directory(const std::string &path) {
+  struct stat st {};
+  return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// ---- JSON writing -------------------------------------------------------
+
+void put_string(std::ostringstream &os, const std::string &s) {
+  os << '"';
+  for (unsigned char c : s) {
+    switch (c) {
+    case '"':
+      os << "\\\"";
+      break;
+    case '\\':
+      os << "\\\\";
+      break;
+    case '\n':
+      os << "\\n";
+      break;
+    case '\t':
+      os << "\\t";
+      break;
+    case '\r':
+      os << "\\r";
+      break;
+    default:
+      if (c < 0x20) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+        os << buf;
+      } else {
+        os << static_cast<char>(c);
+      }
+    }
+  }
+  os << '"';
+}
+
+void put_number(std::ostringstream &os, double v) {
+  if (std::isfinite(v))
+    os << RunManifest::format_number(v);
+  else
+    os << "null";
+}
+
+void put_key(std::ostringstream &os, const char *indent, const std::string &k) {
+  os << indent;
+  put_string(os, k);
+  os << ": ";
+}
+
+void put_strings(std::ostringstream &os, const std::vector<std::string> &v) {
+  os << '[';
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    if (i)
+      os << ", ";
+    put_string(os, v[i]);
+  }
+  os << ']';
+}
+
+void put_map(std::ostringstream &os,
+             const std::map<std::string, std::string> &m) {
+  if (m.empty()) {
+    os << "{}";
+    return;
+  }
+  os << "{\n";
+  std::size_t i = 0;
+  for (const auto &[k, v] : m) {
+    put_key(os, "    ", k);
+    put_string(os, v);
+    os << (++i < m.size() ? ",\n" : "\n");
+  }
+  os << "  }";
+}
+
+// ---- JSON reading -------------------------------------------------------
+
+struct Json {
+  enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+  bool b = false;
+  double num = 0.0;
+  std::string str;
+  std::vector<Json> arr;
+  std::vector<std::pair<std::string, Json>> obj;
+
+  const Json *get(const char *key) const {
+    for (const auto &[k, v] : obj)
+      if (k == key)
+        return &v;
+    return nullptr;
+  }
+};
+
+class JsonParser {
+public:
+  explicit JsonParser(const std::string &s) : s_(s) {}
+
+  bool parse(Json *out, std::string *err) {
+    if (!value(out, 0)) {
+      if (err)
+        *err = error_ + " at offset " + std::to_string(i_);
+      return false;
+    }
+    ws();
+    if (i_ != s_.size()) {
+      if (err)
+        *err = "trailing data at offset " + std::to_string(i_);
+      return false;
+    }
+    return true;
+  }
+
+private:
+  static constexpr int kMaxDepth = 64;
+
+  void ws() {
+    while (i_ < s_.size() &&
+           (s_[i_] == ' ' || s_[i_] == '\t' || s_[i_] == '\n' ||
+            s_[i_] == '\r'))
+      ++i_;
+  }
+
+  bool fail(const char *what) {
+    error_ = what;
+    return false;
+  }
+
+  bool literal(const char *word) {
+    const std::size_t n = std::strlen(word);
+    if (s_.compare(i_, n, word) != 0)
+      return fail("invalid literal");
+    i_ += n;
+    return true;
+  }
+
+  bool value(Json *out, int depth) {
+    if (depth > kMaxDepth)
+      return fail("nesting too deep");
+    ws();
+    if (i_ >= s_.size())
+      return fail("unexpected end of input");
+    const char c = s_[i_];
+    if (c == '{')
+      return object(out, depth);
+    if (c == '[')
+      return array(out, depth);
+    if (c == '"') {
+      out->type = Json::String;
+      return string(&out->str);
+    }
+    if (c == 't' || c == 'f') {
+      out->type = Json::Bool;
+      out->b = c == 't';
+      return literal(out->b ? "true" : "false");
+    }
+    if (c == 'n') {
+      out->type = Json::Null;
+      return literal("null");
+    }
+    return number(out);
+  }
+
+  bool object(Json *out, int depth) {
+    out->type = Json::Object;
+    ++i_;
+    ws();
+    if (i_ < s_.size() && s_[i_] == '}') {
+      ++i_;
+      return true;
+    }
+    for (;;) {
+      ws();
+      std::string key;
+      if (i_ >= s_.size() || s_[i_] != '"' || !string(&key))
+        return error_.empty() ? fail("expected object key") : false;
+      ws();
+      if (i_ >= s_.size() || s_[i_] != ':')
+        return fail("expected ':'");
+      ++i_;
+      out->obj.emplace_back(std::move(key), Json{});
+      if (!value(&out->obj.back().second, depth + 1))
+        return false;
+      ws();
+      if (i_ < s_.size() && s_[i_] == ',') {
+        ++i_;
+        continue;
+      }
+      if (i_ < s_.size() && s_[i_] == '}') {
+        ++i_;
+        return true;
+      }
+      return fail("expected ',' or '}'");
+    }
+  }
+
+  bool array(Json *out, int depth) {
+    out->type = Json::Array;
+    ++i_;
+    ws();
+    if (i_ < s_.size() && s_[i_] == ']') {
+      ++i_;
+      return true;
+    }
+    for (;;) {
+      out->arr.emplace_back();
+      if (!value(&out->arr.back(), depth + 1))
+        return false;
+      ws();
+      if (i_ < s_.size() && s_[i_] == ',') {
+        ++i_;
+        continue;
+      }
+      if (i_ < s_.size() && s_[i_] == ']') {
+        ++i_;
+        return true;
+      }
+      return fail("expected ',' or ']'");
+    }
+  }
+
+  static void put_utf8(std::string *out, uint32_t cp) {
+    if (cp < 0x80) {
+      *out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      *out += static_cast<char>(0xc0 | (cp >> 6));
+      *out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+      *out += static_cast<char>(0xe0 | (cp >> 12));
+      *out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+      *out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+  }
+
+  bool string(std::string *out) {
+    ++i_; // Opening quote
+    while (i_ < s_.size()) {
+      const char c = s_[i_++];
+      if (c == '"')
+        return true;
+      if (c != '\\') {
+        *out += c;
+        continue;
+      }
+      if (i_ >= s_.size())
+        break;
+      const char e = s_[i_++];
+      switch (e) {
+      case '"':
+      case '\\':
+      case '/':
+        *out += e;
+        break;
+      case 'b':
+        *out += '\b';
+        break;
+      case 'f':
+        *out += '\f';
+        break;
+      case 'n':
+        *out += '\n';
+        break;
+      case 'r':
+        *out += '\r';
+        break;
+      case 't':
+        *out += '\t';
+        break;
+      case 'u': {
+        if (i_ + 4 > s_.size())
+          return fail("truncated \\u escape");
+        char *end = nullptr;
+        const std::string hex = s_.substr(i_, 4);
+        const unsigned long cp = std::strtoul(hex.c_str(), &end, 16);
+        if (end != hex.c_str() + 4)
+          return fail("invalid \\u escape");
+        i_ += 4;
+        // Surrogates are not paired up; manifests are written by to_json(),
+        // which only escapes control characters.
+        put_utf8(out, static_cast<uint32_t>(cp));
+        break;
+      }
+      default:
+        return fail("invalid escape");
+      }
+    }
+    return fail("unterminated string");
+  }
+
+  bool number(Json *out) {
+    const char *begin = s_.c_str() + i_;
+    char *end = nullptr;
+    errno = 0;
+    const double v = std::strtod(begin, &end);
+    if (end == begin)
+      return fail("unexpected character");
+    out->type = Json::Number;
+    out->num = v;
+    i_ += static_cast<std::size_t>(end - begin);
+    return true;
+  }
+
+  const std::string &s_;
+  std::size_t i_ = 0;
+  std::string error_;
+};
+
+std::string get_string(const Json *o, const char *key) {
+  const Json *v = o ? o->get(key) : nullptr;
+  return v && v->type == Json::String ? v->str : std::string();
+}
+
+double get_number(const Json *o, const char *key) {
+  const Json *v = o ? o->get(key) : nullptr;
+  return v && v->type == Json::Number ? v->num : 0.0;
+}
+
+std::vector<std::string> get_strings(const Json *o, const char *key) {
+  std::vector<std::string> out;
+  const Json *v = o ? o->get(key) : nullptr;
+  if (v && v->type == Json::Array)
+    for (const auto &e : v->arr)
+      if (e.type == Json::String)
+        out.push_back(e.str);
+  return out;
+}
+
+std::map<std::string, std::string> get_map(const Json *o, const char *key) {
+  std::map<std::string, std::string> out;
+  const Json *v = o ? o->get(key) : nullptr;
+  if (v && v->type == Json::Object)
+    for (const auto &[k, e] : v->obj)
+      if (e.type == Json::String)
+        out[k] = e.str;
+  return out;
+}
+
+// ---- Statistics ---------------------------------------------------------
+
+// Continued fraction of the incomplete beta function (modified Lentz).
+double beta_cf(double a, double b, double x) {
+  constexpr double kTiny = 1e-300;
+  const double qab = a + b, qap = a + 1.0, qam = a - 1.0;
+  double c = 1.0;
+  double d = 1.0 - qab * x / qap;
+  if (std::fabs(d) < kTiny)
+    d = kTiny;
+  d = 1.0 / d;
+  double h = d;
+  for (int m = 1; m <= 300; ++m) {
+    const double m2 = 2.0 * m;
+    double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+    d = 1.0 + aa * d;
+    d = std::fabs(d) < kTiny ? kTiny : d;
+    c = 1.0 + aa / c;
+    c = std::fabs(c) < kTiny ? kTiny : c;
+    d = 1.0 / d;
+    h *= d * c;
+    aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+    d = 1.0 + aa * d;
+    d = std::fabs(d) < kTiny ? kTiny : d;
+    c = 1.0 + aa / c;
+    c = std::fabs(c) < kTiny ? kTiny : c;
+    d = 1.0 / d;
+    const double del = d * c;
+    h *= del;
+    if (std::fabs(del - 1.0) < 1e-14)
+      break;
+  }
+  return h;
+}
+
+// Regularized incomplete beta I_x(a, b).
+double inc_beta(double a, double b, double x) {
+  if (x <= 0.0)
+    return 0.0;
+  if (x >= 1.0)
+    return 1.0;
+  const double ln = std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                    a * std::log(x) + b * std::log1p(-x);
+  const double bt = std::exp(ln);
+  if (x < (a + 1.0) / (a + b + 2.0))
+    return bt * beta_cf(a, b, x) / a;
+  return 1.0 - bt * beta_cf(b, a, 1.0 - x) / b;
+}
+
+std::string or_unset(const std::string *v) { return v ? *v : "(unset)"; }
+
+void diff_field(std::vector<std::string> *out, const char *what,
+                const std::string &a, const std::string &b) {
+  if (a != b)
+    out->push_back(std::string(what) + ": " + (a.empty() ? "\"\"" : a) +
+                   " -> " + (b.empty() ? "\"\"" : b));
+}
+
+void diff_map(std::vector<std::string> *out, const char *prefix,
+              const std::map<std::string, std::string> &a,
+              const std::map<std::string, std::string> &b) {
+  std::set<std::string> keys;
+  for (const auto &kv : a)
+    keys.insert(kv.first);
+  for (const auto &kv : b)
+    keys.insert(kv.first);
+  for (const auto &k : keys) {
+    const auto ia = a.find(k), ib = b.find(k);
+    const std::string *va = ia == a.end() ? nullptr : &ia->second;
+    const std::string *vb = ib == b.end() ? nullptr : &ib->second;
+    if (va && vb && *va == *vb)
+      continue;
+    out->push_back(std::string(prefix) + k + ": " + or_unset(va) + " -> " +
+                   or_unset(vb));
+  }
+}
+
+std::string join(const std::vector<std::string> &v, const char *sep) {
+  std::string out;
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    if (i)
+      out += sep;
+    out += v[i];
+  }
+  return out;
+}
+
+} // namespace
+
+// ---- ManifestMetric -----------------------------------------------------
+
+double ManifestMetric::mean() const {
+  if (samples.empty())
+    return 0.0;
+  double sum = 0.0;
+  for (double v : samples)
+    sum += v;
+  return sum / static_cast<double>(samples.size());
+}
+
+double ManifestMetric::stddev() const {
+  const std::size_t n = samples.size();
+  if (n < 2)
+    return 0.0;
+  const double m = mean();
+  double ss = 0.0;
+  for (double v : samples)
+    ss += (v - m) * (v - m);
+  return std::sqrt(ss / static_cast<double>(n - 1));
+}
+
+double ManifestMetric::percentile(double p) const {
+  if (samples.empty())
+    return 0.0;
+  std::vector<double> s = samples;
+  std::sort(s.begin(), s.end());
+  const double pos =
+      std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(s.size() - 1);
+  const std::size_t lo = static_cast<std::size_t>(pos);
+  const std::size_t hi = std::min(lo + 1, s.size() - 1);
+  return s[lo] + (s[hi] - s[lo]) * (pos - static_cast<double>(lo));
+}
+
+// ---- HostInfo -----------------------------------------------------------
+
+HostInfo HostInfo::detect() {
+  HostInfo h;
+  char name[256] = {};
+  if (gethostname(name, sizeof(name) - 1) == 0)
+    h.hostname = name;
+  struct utsname u {};
+  if (uname(&u) == 0) {
+    h.os = std::string(u.sysname) + " " + u.release;
+    h.arch = u.machine;
+  }
+
+  // x86 reports "model name" / "flags", arm64 "Features" (and often no
+  // model name at all).
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    const auto colon = line.find(':');
+    if (colon == std::string::npos)
+      continue;
+    const std::string key = trim(line.substr(0, colon));
+    const std::string val = trim(line.substr(colon + 1));
+    if (h.cpu_model.empty() && (key == "model name" || key == "Model"))
+      h.cpu_model = val;
+    else if (h.cpu_flags.empty() && (key == "flags" || key == "Features")) {
+      std::istringstream ss(val);
+      std::string flag;
+      while (ss >> flag)
+        h.cpu_flags.push_back(flag);
+    }
+    if (!h.cpu_model.empty() && !h.cpu_flags.empty())
+      break;
+  }
+
+  const long online = sysconf(_SC_NPROCESSORS_ONLN);
+  h.logical_cpus = online > 0 ? static_cast<uint32_t>(online) : 0;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    h.affinity_cpus = static_cast<uint32_t>(CPU_COUNT(&set));
+  else
+    h.affinity_cpus = h.logical_cpus;
+
+  for (int node = 0;; ++node) {
+    const std::string path = "/sys/devices/system/node/node" +
+                             std::to_string(node) + "/cpulist";
+    std::ifstream f(path);
+    if (!f)
+      break;
+    std::string cpus;
+    std::getline(f, cpus);
+    h.numa_nodes.push_back(trim(cpus));
+  }
+
+  std::ifstream meminfo("/proc/meminfo");
+  while (std::getline(meminfo, line)) {
+    if (line.compare(0, 9, "MemTotal:") == 0) {
+      h.mem_total_kb = std::strtoull(line.c_str() + 9, nullptr, 10);
+      break;
+    }
+  }
+
+  h.governor =
+      read_line("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
+  return h;
+}
+
+// ---- RunManifest --------------------------------------------------------
+
+RunManifest RunManifest::collect(const std::string &tool, int argc,
+                                 const char *const *argv,
+                                 const char *build_features) {
+  RunManifest m;
+  m.tool = tool;
+  m.started_utc = utc_now("%Y-%m-%dT%H:%M:%SZ");
+  for (int i = 0; i < argc && argv; ++i)
+    m.argv.push_back(argv[i] ? argv[i] : "");
+
+  const char *sha = std::getenv("GRETA_GIT_SHA");
+  m.build.git_sha = sha && *sha ? sha : GRETA_GIT_SHA;
+#if defined(__clang__)
+  m.build.compiler = std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+  m.build.compiler = std::string("gcc ") + __VERSION__;
+#endif
+  m.build.build_type = GRETA_BUILD_TYPE;
+  m.build.flags = trim(std::string(GRETA_CXX_FLAGS) + " " +
+                       (build_features ? build_features : ""));
+
+  m.host = HostInfo::detect();
+  m.threads = m.host.affinity_cpus;
+
+  for (char **e = environ; e && *e; ++e) {
+    const char *eq = std::strchr(*e, '=');
+    if (!eq)
+      continue;
+    const std::string key(*e, static_cast<std::size_t>(eq - *e));
+    const bool extra = std::find_if(std::begin(kExtraEnv), std::end(kExtraEnv),
+                                    [&](const char *k) { return key == k; }) !=
+                       std::end(kExtraEnv);
+    if ((key.compare(0, 6, "GRETA_") == 0 && !output_only_env(key)) || extra)
+      m.env[key] = eq + 1;
+  }
+  return m;
+}
+
+void RunManifest::metric(const std::string &name, const std::string &unit,
+                         MetricBetter better, std::vector<double> samples) {
+  for (auto &mm : metrics) {
+    if (mm.name == name) {
+      mm.unit = unit;
+      mm.better = better;
+      mm.samples = std::move(samples);
+      return;
+    }
+  }
+  metrics.push_back({name, unit, better, std::move(samples)});
+}
+
+const ManifestMetric *RunManifest::find(const std::string &name) const {
+  for (const auto &mm : metrics)
+    if (mm.name == name)
+      return &mm;
+  return nullptr;
+}
+
+std::string RunManifest::format_number(double v) {
+  char buf[40];
+  if (v == std::floor(v) && std::fabs(v) < 1e15) {
+    std::snprintf(buf, sizeof(buf), "%.0f", v);
+    return buf;
+  }
+  // Shortest form that reads back to the same double.
+  for (int prec = 10; prec <= 17; ++prec) {
+    std::snprintf(buf, sizeof(buf), "%.*g", prec, v);
+    if (std::strtod(buf, nullptr) == v)
+      break;
+  }
+  return buf;
+}
+
+std::string RunManifest::to_json() const {
+  std::ostringstream os;
+  os << "{\n  \"version\": " << kVersion << ",\n";
+  put_key(os, "  ", "tool");
+  put_string(os, tool);
+  os << ",\n";
+  put_key(os, "  ", "started_utc");
+  put_string(os, started_utc);
+  os << ",\n";
+  put_key(os, "  ", "status");
+  put_string(os, status);
+  os << ",\n";
+  put_key(os, "  ", "argv");
+  put_strings(os, argv);
+  os << ",\n";
+
+  os << "  \"build\": {\n";
+  put_key(os, "    ", "git_sha");
+  put_string(os, build.git_sha);
+  os << ",\n";
+  put_key(os, "    ", "compiler");
+  put_string(os, build.compiler);
+  os << ",\n";
+  put_key(os, "    ", "build_type");
+  put_string(os, build.build_type);
+  os << ",\n";
+  put_key(os, "    ", "flags");
+  put_string(os, build.flags);
+  os << "\n  },\n";
+
+  os << "  \"host\": {\n";
+  put_key(os, "    ", "hostname");
+  put_string(os, host.hostname);
+  os << ",\n";
+  put_key(os, "    ", "os");
+  put_string(os, host.os);
+  os << ",\n";
+  put_key(os, "    ", "arch");
+  put_string(os, host.arch);
+  os << ",\n";
+  put_key(os, "    ", "cpu_model");
+  put_string(os, host.cpu_model);
+  os << ",\n";
+  put_key(os, "    ", "cpu_flags");
+  put_strings(os, host.cpu_flags);
+  os << ",\n";
+  os << "    \"logical_cpus\": " << host.logical_cpus << ",\n";
+  os << "    \"affinity_cpus\": " << host.affinity_cpus << ",\n";
+  put_key(os, "    ", "numa_nodes");
+  put_strings(os, host.numa_nodes);
+  os << ",\n";
+  os << "    \"mem_total_kb\": " << host.mem_total_kb << ",\n";
+  put_key(os, "    ", "governor");
+  put_string(os, host.governor);
+  os << "\n  },\n";
+
+  os << "  \"threads\": " << threads << ",\n";
+  os << "  \"env\": ";
+  put_map(os, env);
+  os << ",\n  \"params\": ";
+  put_map(os, params);
+  os << ",\n  \"metrics\": [";
+  for (std::size_t i = 0; i < metrics.size(); ++i) {
+    const ManifestMetric &mm = metrics[i];
+    os << (i ? ",\n" : "\n") << "    {";
+    put_key(os, "", "name");
+    put_string(os, mm.name);
+    os << ", ";
+    put_key(os, "", "unit");
+    put_string(os, mm.unit);
+    os << ", \"better\": \""
+       << (mm.better == MetricBetter::Higher ? "higher" : "lower") << "\",\n";
+    os << "     \"n\": " << mm.samples.size() << ", \"mean\": ";
+    put_number(os, mm.mean());
+    os << ", \"stddev\": ";
+    put_number(os, mm.stddev());
+    os << ", \"p50\": ";
+    put_number(os, mm.percentile(50.0));
+    os << ",\n     \"samples\": [";
+    for (std::size_t j = 0; j < mm.samples.size(); ++j) {
+      if (j)
+        os << ", ";
+      put_number(os, mm.samples[j]);
+    }
+    os << "]}";
+  }
+  os << (metrics.empty() ? "]\n}\n" : "\n  ]\n}\n");
+  return os.str();
+}
+
+bool RunManifest::from_json(const std::string &text, RunManifest *out,
+                            std::string *err) {
+  Json root;
+  if (!JsonParser(text).parse(&root, err))
+    return false;
+  if (root.type != Json::Object) {
+    if (err)
+      *err = "manifest is not a JSON object";
+    return false;
+  }
+  const double version = get_number(&root, "version");
+  if (version < 1 || version > kVersion) {
+    if (err)
+      *err = "unsupported manifest version " + format_number(version);
+    return false;
+  }
+
+  RunManifest m;
+  m.tool = get_string(&root, "tool");
+  m.started_utc = get_string(&root, "started_utc");
+  m.status = get_string(&root, "status");
+  m.argv = get_strings(&root, "argv");
+
+  const Json *b = root.get("build");
+  m.build.git_sha = get_string(b, "git_sha");
+  m.build.compiler = get_string(b, "compiler");
+  m.build.build_type = get_string(b, "build_type");
+  m.build.flags = get_string(b, "flags");
+
+  const Json *h = root.get("host");
+  m.host.hostname = get_string(h, "hostname");
+  m.host.os = get_string(h, "os");
+  m.host.arch = get_string(h, "arch");
+  m.host.cpu_model = get_string(h, "cpu_model");
+  m.host.cpu_flags = get_strings(h, "cpu_flags");
+  m.host.logical_cpus = static_cast<uint32_t>(get_number(h, "logical_cpus"));
+  m.host.affinity_cpus = static_cast<uint32_t>(get_number(h, "affinity_cpus"));
+  m.host.numa_nodes = get_strings(h, "numa_nodes");
+  m.host.mem_total_kb = static_cast<uint64_t>(get_number(h, "mem_total_kb"));
+  m.host.governor = get_string(h, "governor");
+
+  m.threads = static_cast<uint32_t>(get_number(&root, "threads"));
+  m.env = get_map(&root, "env");
+  m.params = get_map(&root, "params");
+
+  const Json *metrics = root.get("metrics");
+  if (metrics && metrics->type == Json::Array) {
+    for (const Json &e : metrics->arr) {
+      ManifestMetric mm;
+      mm.name = get_string(&e, "name");
+      if (mm.name.empty())
+        continue;
+      mm.unit = get_string(&e, "unit");
+      mm.better = get_string(&e, "better") == "higher" ? MetricBetter::Higher
+                                                       : MetricBetter::Lower;
+      const Json *s = e.get("samples");
+      if (s && s->type == Json::Array)
+        for (const Json &v : s->arr)
+          mm.samples.push_back(v.type == Json::Number
+                                   ? v.num
+                                   : std::numeric_limits<double>::quiet_NaN());
+      m.metrics.push_back(std::move(mm));
+    }
+  }
+  *out = std::move(m);
+  return true;
+}
+
+bool RunManifest::write(const std::string &path, std::string *err) const {
+  const std::string data = to_json();
+  std::FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    if (err)
+      *err = "open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  const bool wrote = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+  const bool closed = std::fclose(f) == 0;
+  if (!wrote || !closed) {
+    if (err)
+      *err = "write " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool RunManifest::load(const std::string &path, RunManifest *out,
+                       std::string *err) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) {
+    if (err)
+      *err = "open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  std::stringstream ss;
+  ss << f.rdbuf();
+  std::string perr;
+  if (!from_json(ss.str(), out, &perr)) {
+    if (err)
+      *err = path + ": " + perr;
+    return false;
+  }
+  return true;
+}
+
+std::string RunManifest::output_path() const {
+  for (std::size_t i = 1; i < argv.size(); ++i) {
+    if (argv[i] == "--manifest" && i + 1 < argv.size())
+      return argv[i + 1];
+    if (argv[i].compare(0, 11, "--manifest=") == 0)
+      return argv[i].substr(11);
+  }
+  const char *v = std::getenv("GRETA_MANIFEST_OUT");
+  return v ? v : "";
+}
+
+bool RunManifest::emit(std::string *err) const {
+  std::string path = output_path();
+  if (path.empty())
+    return true;
+  const bool dir = path.back() == '/' || is_directory(path);
+  if (dir) {
+    if (path.back() != '/')
+      path += '/';
+    // One level only, like the presets' results/ directories.
+    if (!is_directory(path) && ::mkdir(path.c_str(), 0755) != 0 &&
+        errno != EEXIST) {
+      if (err)
+        *err = "mkdir " + path + ": " + std::strerror(errno);
+      return false;
+    }
+    path += (tool.empty() ? std::string("run") : tool) + "-" +
+            utc_now("%Y%m%dT%H%M%SZ") + "-" + std::to_string(getpid()) +
+            ".json";
+  }
+  if (!write(path, err))
+    return false;
+  std::printf("MANIFEST=%s\n", path.c_str());
+  std::fflush(stdout);
+  return true;
+}
+
+// ---- Comparison ---------------------------------------------------------
+
+const char *metric_verdict_name(MetricVerdict v) {
+  switch (v) {
+  case MetricVerdict::Same:
+    return "same";
+  case MetricVerdict::Improved:
+    return "improved";
+  case MetricVerdict::Regressed:
+    return "REGRESSED";
+  case MetricVerdict::Unverified:
+    return "unverified";
+  case MetricVerdict::Added:
+    return "added";
+  case MetricVerdict::Removed:
+    return "removed";
+  }
+  return "?";
+}
+
+double welch_p_value(const std::vector<double> &a,
+                     const std::vector<double> &b) {
+  if (a.size() < 2 || b.size() < 2)
+    return 1.0;
+  ManifestMetric ma, mb;
+  ma.samples = a;
+  mb.samples = b;
+  const double na = static_cast<double>(a.size());
+  const double nb = static_cast<double>(b.size());
+  const double sa = ma.stddev() * ma.stddev() / na;
+  const double sb = mb.stddev() * mb.stddev() / nb;
+  const double diff = ma.mean() - mb.mean();
+  const double se2 = sa + sb;
+  if (!std::isfinite(se2) || !std::isfinite(diff))
+    return 1.0;
+  if (se2 <= 0.0)
+    return diff == 0.0 ? 1.0 : 0.0;
+  const double t = diff / std::sqrt(se2);
+  // Welch-Satterthwaite degrees of freedom.
+  const double df =
+      se2 * se2 / (sa * sa / (na - 1.0) + sb * sb / (nb - 1.0));
+  return std::clamp(inc_beta(df / 2.0, 0.5, df / (df + t * t)), 0.0, 1.0);
+}
+
+ManifestDiff compare_manifests(const RunManifest &base,
+                               const RunManifest &cand,
+                               const CompareOptions &opt) {
+  ManifestDiff d;
+  d.options = opt;
+
+  auto &ctx = d.context;
+  diff_field(&ctx, "tool", base.tool, cand.tool);
+  diff_field(&ctx, "build.git_sha", base.build.git_sha, cand.build.git_sha);
+  diff_field(&ctx, "build.compiler", base.build.compiler, cand.build.compiler);
+  diff_field(&ctx, "build.build_type", base.build.build_type,
+             cand.build.build_type);
+  diff_field(&ctx, "build.flags", base.build.flags, cand.build.flags);
+  diff_field(&ctx, "host.hostname", base.host.hostname, cand.host.hostname);
+  diff_field(&ctx, "host.os", base.host.os, cand.host.os);
+  diff_field(&ctx, "host.cpu_model", base.host.cpu_model, cand.host.cpu_model);
+  diff_field(&ctx, "host.logical_cpus",
+             std::to_string(base.host.logical_cpus),
+             std::to_string(cand.host.logical_cpus));
+  diff_field(&ctx, "host.affinity_cpus",
+             std::to_string(base.host.affinity_cpus),
+             std::to_string(cand.host.affinity_cpus));
+  diff_field(&ctx, "host.numa_nodes", join(base.host.numa_nodes, " | "),
+             join(cand.host.numa_nodes, " | "));
+  diff_field(&ctx, "host.governor", base.host.governor, cand.host.governor);
+  if (base.host.cpu_flags != cand.host.cpu_flags)
+    ctx.push_back("host.cpu_flags differ");
+  diff_field(&ctx, "threads", std::to_string(base.threads),
+             std::to_string(cand.threads));
+  diff_map(&ctx, "env.", base.env, cand.env);
+  diff_map(&ctx, "params.", base.params, cand.params);
+
+  auto delta = [&](const ManifestMetric *b, const ManifestMetric *c) {
+    MetricDelta md;
+    const ManifestMetric *any = b ? b : c;
+    md.name = any->name;
+    md.unit = any->unit;
+    md.better = any->better;
+    if (!b || !c) {
+      md.n_base = b ? b->samples.size() : 0;
+      md.n_cand = c ? c->samples.size() : 0;
+      md.base_mean = b ? b->mean() : 0.0;
+      md.cand_mean = c ? c->mean() : 0.0;
+      md.verdict = b ? MetricVerdict::Removed : MetricVerdict::Added;
+      return md;
+    }
+    md.n_base = b->samples.size();
+    md.n_cand = c->samples.size();
+    md.base_mean = b->mean();
+    md.cand_mean = c->mean();
+    const double change = md.cand_mean - md.base_mean;
+    if (md.base_mean != 0.0)
+      md.rel = change / std::fabs(md.base_mean);
+    else
+      md.rel = change == 0.0 ? 0.0 : std::copysign(HUGE_VAL, change);
+    const bool big = !(std::fabs(md.rel) < opt.min_rel); // NaN counts
+    const bool worse =
+        md.better == MetricBetter::Lower ? md.rel > 0.0 : md.rel < 0.0;
+    if (md.n_base >= 2 && md.n_cand >= 2) {
+      md.p_value = welch_p_value(b->samples, c->samples);
+      if (md.p_value < opt.alpha && big)
+        md.verdict = worse ? MetricVerdict::Regressed : MetricVerdict::Improved;
+    } else if (big) {
+      md.verdict = MetricVerdict::Unverified;
+    }
+    return md;
+  };
+  for (const auto &b : base.metrics)
+    d.metrics.push_back(delta(&b, cand.find(b.name)));
+  for (const auto &c : cand.metrics)
+    if (!base.find(c.name))
+      d.metrics.push_back(delta(nullptr, &c));
+  return d;
+}
+
+size_t ManifestDiff::count(MetricVerdict v) const {
+  return static_cast<size_t>(
+      std::count_if(metrics.begin(), metrics.end(),
+                    [v](const MetricDelta &m) { return m.verdict == v; }));
+}
+
+std::string ManifestDiff::to_text() const {
+  std::ostringstream os;
+  char buf[200];
+  std::snprintf(buf, sizeof(buf),
+                "Manifest diff (alpha=%.3g, min change %.1f%%): %zu regressed,"
+                " %zu improved, %zu same, %zu unverified\n",
+                options.alpha, options.min_rel * 100.0,
+                count(MetricVerdict::Regressed), count(MetricVerdict::Improved),
+                count(MetricVerdict::Same), count(MetricVerdict::Unverified));
+  os << buf;
+  if (!context.empty()) {
+    os << "Context differences:\n";
+    for (const auto &c : context)
+      os << "  " << c << '\n';
+  }
+  os << '\n';
+  std::snprintf(buf, sizeof(buf), "%-22s %-7s %10s %10s %7s %6s %5s  %s\n",
+                "metric", "unit", "base", "cand", "change", "p", "n",
+                "verdict");
+  os << buf;
+  for (const auto &m : metrics) {
+    char change[16] = "-";
+    char p[16] = "-";
+    if (m.verdict != MetricVerdict::Added &&
+        m.verdict != MetricVerdict::Removed) {
+      std::snprintf(change, sizeof(change), "%+.1f%%", m.rel * 100.0);
+      if (m.n_base >= 2 && m.n_cand >= 2)
+        std::snprintf(p, sizeof(p), m.p_value < 1e-4 ? "<1e-4" : "%.4f",
+                      m.p_value);
+    }
+    char n[24];
+    std::snprintf(n, sizeof(n), "%zu/%zu", m.n_base, m.n_cand);
+    std::snprintf(buf, sizeof(buf),
+                  "%-22s %-7s %10.4g %10.4g %7s %6s %5s  %s\n",
+                  m.name.c_str(), m.unit.c_str(), m.base_mean, m.cand_mean,
+                  change, p, n, metric_verdict_name(m.verdict));
+    os << buf;
+  }
+  return os.str();
+}
+
+} // namespace gcore::rt
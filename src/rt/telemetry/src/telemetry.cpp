@@ -1,9 +1,24 @@
 #include "gcore/rt/telemetry.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cmath>
 
 namespace gcore::rt {
 
+namespace {
+
+// Shard of the calling thread, assigned round-robin on first use.
+std::size_t thread_shard() {
+  static std::atomic<uint32_t> next{0};
+  thread_local const std::size_t shard =
+      next.fetch_add(1, std::memory_order_relaxed) % kTelemetryShards;
+  return shard;
+}
+
+} // namespace
+
 uint64_t now_ns() {
   return static_cast<uint64_t>(
       std::chrono::duration_cast<std::chrono::nanoseconds>(
@@ -11,19 +26,157 @@ uint64_t now_ns() {
           .count());
 }
 
+// ---------------- Counter ----------------
+
 Counter::Counter(std::string_view name) : name_(name) {}
 
-void Counter::inc(uint64_t v) { v_.fetch_add(v, std::memory_order_relaxed); }
+void Counter::inc(uint64_t v) {
+  shards_[thread_shard()].v.fetch_add(v, std::memory_order_relaxed);
+}
 
-uint64_t Counter::value() const { return v_.load(std::memory_order_relaxed); }
+uint64_t Counter::value() const {
+  uint64_t sum = 0;
+  for (const auto &s : shards_)
+    sum += s.v.load(std::memory_order_relaxed);
+  return sum;
+}
 
 std::string_view Counter::name() const { return name_; }
 
+// ---------------- Gauge ----------------
+
+Gauge::Gauge(std::string_view name) : name_(name) {}
+
+void Gauge::set(int64_t v) { v_.store(v, std::memory_order_relaxed); }
+
+void Gauge::add(int64_t v) { v_.fetch_add(v, std::memory_order_relaxed); }
+
+int64_t Gauge::value() const { return v_.load(std::memory_order_relaxed); }
+
+std::string_view Gauge::name() const { return name_; }
+
+// ---------------- Histogram ----------------
+
+struct alignas(64) Histogram::Shard {
+  std::atomic<uint64_t> buckets[kBuckets] = {};
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> min{UINT64_MAX};
+  std::atomic<uint64_t> max{0};
+};
+
+Histogram::Histogram(std::string_view name) : name_(name) {}
+
+Histogram::~Histogram() {
+  for (auto &s : shards_)
+    delete s.load(std::memory_order_relaxed);
+}
+
+std::string_view Histogram::name() const { return name_; }
+
+std::size_t Histogram::bucket_of(uint64_t v) {
+  constexpr uint64_t kSub = uint64_t{1} << kSubBits;
+  if (v < kSub)
+    return static_cast<std::size_t>(v);
+  const unsigned e = 63u - static_cast<unsigned>(std::countl_zero(v));
+  const uint64_t m = (v >> (e - kSubBits)) & (kSub - 1);
+  return static_cast<std::size_t>(((e - kSubBits + 1) << kSubBits) + m);
+}
+
+uint64_t Histogram::bucket_low(std::size_t b) {
+  constexpr uint64_t kSub = uint64_t{1} << kSubBits;
+  if (b < kSub)
+    return b;
+  const unsigned e = static_cast<unsigned>(b >> kSubBits) + kSubBits - 1;
+  const uint64_t m = b & (kSub - 1);
+  return (kSub + m) << (e - kSubBits);
+}
+
+uint64_t Histogram::bucket_high(std::size_t b) {
+  constexpr uint64_t kSub = uint64_t{1} << kSubBits;
+  if (b < kSub)
+    return b;
+  const unsigned e = static_cast<unsigned>(b >> kSubBits) + kSubBits - 1;
+  return bucket_low(b) + ((uint64_t{1} << (e - kSubBits)) - 1);
+}
+
+Histogram::Shard &Histogram::shard() {
+  std::atomic<Shard *> &slot = shards_[thread_shard()];
+  Shard *s = slot.load(std::memory_order_acquire);
+  if (s)
+    return *s;
+  auto *fresh = new Shard();
+  if (slot.compare_exchange_strong(s, fresh, std::memory_order_acq_rel,
+                                   std::memory_order_acquire))
+    return *fresh;
+  delete fresh; // Another thread on the same shard won
+  return *s;
+}
+
+void Histogram::record(uint64_t v) {
+  Shard &s = shard();
+  s.buckets[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+  s.sum.fetch_add(v, std::memory_order_relaxed);
+  uint64_t cur = s.min.load(std::memory_order_relaxed);
+  while (v < cur &&
+         !s.min.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+  }
+  cur = s.max.load(std::memory_order_relaxed);
+  while (v > cur &&
+         !s.max.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+  }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot out;
+  out.buckets.assign(kBuckets, 0);
+  uint64_t mn = UINT64_MAX;
+  for (const auto &slot : shards_) {
+    const Shard *s = slot.load(std::memory_order_acquire);
+    if (!s)
+      continue;
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+      const uint64_t c = s->buckets[b].load(std::memory_order_relaxed);
+      out.buckets[b] += c;
+      out.count += c;
+    }
+    out.sum += s->sum.load(std::memory_order_relaxed);
+    mn = std::min(mn, s->min.load(std::memory_order_relaxed));
+    out.max = std::max(out.max, s->max.load(std::memory_order_relaxed));
+  }
+  out.min = out.count ? mn : 0;
+  return out;
+}
+
+uint64_t Histogram::Snapshot::percentile(double q) const {
+  if (count == 0)
+    return 0;
+  q = std::min(1.0, std::max(0.0, q));
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+  uint64_t seen = 0;
+  for (std::size_t b = 0; b < buckets.size(); ++b) {
+    seen += buckets[b];
+    if (seen >= rank) {
+      const uint64_t lo = bucket_low(b);
+      const uint64_t mid = lo + (bucket_high(b) - lo) / 2;
+      return std::min(max, std::max(min, mid));
+    }
+  }
+  return max;
+}
+
+// ---------------- ScopedTimer ----------------
+
 ScopedTimer::ScopedTimer(Counter &sink_ns) : sink_(sink_ns), start_(now_ns()) {}
 
+ScopedTimer::ScopedTimer(Counter &sink_ns, Histogram &latency_ns)
+    : sink_(sink_ns), hist_(&latency_ns), start_(now_ns()) {}
+
 ScopedTimer::~ScopedTimer() {
-  uint64_t end = now_ns();
-  sink_.inc(end - start_);
+  const uint64_t dt = now_ns() - start_;
+  sink_.inc(dt);
+  if (hist_)
+    hist_->record(dt);
 }
 
 } // namespace gcore::rt
@@ -0,0 +1,259 @@
+#include "gcore/rt/trace_writer.hpp"
+
+#include <cstdio>
+
+namespace gcore::rt {
+
+namespace {
+
+constexpr std::size_t kRingAlignment = 256;
+
+std::size_t align_up(std::size_t n) {
+  return (n + kRingAlignment - 1) & ~(kRingAlignment - 1);
+}
+
+} // namespace
+
+TraceWriter::TraceWriter(StagingBackend *backend, const TraceWriterOptions &opt)
+    : backend_(backend), opt_(opt) {
+  ring_cap_ = align_up(opt_.ring_bytes);
+  if (ring_cap_ > 0) {
+    ring_ = host_.alloc(ring_cap_, 4096);
+    std::string err;
+    if (ring_ && !backend_->pin(ring_, ring_cap_, &err)) {
+      host_.free(ring_);
+      ring_ = nullptr;
+    }
+    if (!ring_)
+      ring_cap_ = 0; // Every capture takes the oversize path
+  }
+  thread_ = std::thread([this] { loop(); });
+}
+
+TraceWriter::~TraceWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  work_cv_.notify_one();
+  thread_.join();
+  close_files();
+  for (void *e : free_events_)
+    backend_->destroy_event(e);
+  if (ring_) {
+    backend_->unpin(ring_);
+    host_.free(ring_);
+  }
+}
+
+bool TraceWriter::reserve_locked(std::size_t bytes,
+                                 std::unique_lock<std::mutex> &lock,
+                                 std::size_t *offset, std::size_t *reserved) {
+  // FIFO ring: snapshots are retired in submission order, so the used
+  // region is [head - used, head) modulo the capacity. A snapshot that does
+  // not fit before the end wraps to 0 and also holds the skipped tail.
+  const std::size_t n = align_up(bytes);
+  if (n == 0 || n > ring_cap_ / 2)
+    return false;
+  bool stalled = false;
+  for (;;) {
+    if (ring_used_ == 0)
+      ring_head_ = 0;
+    const std::size_t tail_room = ring_cap_ - ring_head_;
+    const std::size_t need = n <= tail_room ? n : tail_room + n;
+    if (ring_used_ + need <= ring_cap_) {
+      *offset = n <= tail_room ? ring_head_ : 0;
+      *reserved = need;
+      ring_head_ = *offset + n;
+      ring_used_ += need;
+      return true;
+    }
+    if (!stalled) {
+      stats_.stalls++;
+      stalled = true;
+    }
+    space_cv_.wait(lock);
+  }
+}
+
+void *TraceWriter::event_locked(std::string *err) {
+  if (!free_events_.empty()) {
+    void *e = free_events_.back();
+    free_events_.pop_back();
+    return e;
+  }
+  return backend_->create_event(err);
+}
+
+uint64_t TraceWriter::push_locked(Job &&job) {
+  job.seq = ++submitted_;
+  const uint64_t seq = job.seq;
+  queue_.push_back(std::move(job));
+  work_cv_.notify_one();
+  return seq;
+}
+
+bool TraceWriter::capture(const std::string &path, const void *src_dev,
+                          std::size_t bytes, void *stream, Formatter fmt,
+                          std::string *err) {
+  Job job;
+  job.kind = Kind::Capture;
+  job.path = path;
+  job.fmt = std::move(fmt);
+  job.bytes = bytes;
+
+  std::unique_lock<std::mutex> lock(mu_);
+  stats_.captures++;
+  stats_.bytes_captured += bytes;
+  if (bytes > 0) {
+    std::size_t offset = 0;
+    if (reserve_locked(bytes, lock, &offset, &job.reserved)) {
+      job.data = static_cast<char *>(ring_) + offset;
+    } else {
+      stats_.oversize++;
+      job.owned = host_.alloc(bytes, 4096);
+      if (!job.owned || !backend_->pin(job.owned, bytes, err)) {
+        if (job.owned)
+          host_.free(job.owned);
+        if (err && !job.owned)
+          *err = "trace snapshot allocation failed (" +
+                 std::to_string(bytes) + " bytes)";
+        stats_.errors++;
+        return false;
+      }
+      job.data = job.owned;
+    }
+    job.event = event_locked(err);
+    // The copy and the record are enqueued on the stream without blocking;
+    // only the writer thread waits on the event.
+    if (!job.event ||
+        !backend_->copy_async(job.data, src_dev, bytes,
+                              StagingCopyKind::DeviceToHost, stream, err) ||
+        !backend_->record(job.event, stream, err)) {
+      // Nothing reads the snapshot: give it back through the queue so ring
+      // space is still retired in order.
+      stats_.errors++;
+      job.fmt = nullptr;
+      push_locked(std::move(job));
+      return false;
+    }
+  }
+  push_locked(std::move(job));
+  return true;
+}
+
+void TraceWriter::append_line(const std::string &path, std::string line) {
+  Job job;
+  job.kind = Kind::Line;
+  job.path = path;
+  job.text = std::move(line);
+  job.text.push_back('\n');
+  std::lock_guard<std::mutex> lock(mu_);
+  push_locked(std::move(job));
+}
+
+void TraceWriter::truncate(const std::string &path) {
+  Job job;
+  job.kind = Kind::Truncate;
+  job.path = path;
+  std::lock_guard<std::mutex> lock(mu_);
+  push_locked(std::move(job));
+}
+
+void TraceWriter::flush() {
+  Job job;
+  job.kind = Kind::Flush;
+  std::unique_lock<std::mutex> lock(mu_);
+  const uint64_t seq = push_locked(std::move(job));
+  space_cv_.wait(lock, [&] { return completed_ >= seq; });
+}
+
+TraceWriter::Stats TraceWriter::stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return stats_;
+}
+
+void TraceWriter::loop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  for (;;) {
+    work_cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+    if (queue_.empty())
+      return; // stop_ and drained
+    Job job = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    run(job);
+    lock.lock();
+    ring_used_ -= job.reserved;
+    if (job.event)
+      free_events_.push_back(job.event);
+    completed_ = job.seq;
+    space_cv_.notify_all();
+  }
+}
+
+void TraceWriter::run(Job &job) {
+  std::string out;
+  bool ok = true;
+  switch (job.kind) {
+  case Kind::Capture:
+    if (job.event)
+      ok = backend_->wait(job.event, nullptr);
+    if (ok && job.fmt)
+      job.fmt(job.data, job.bytes, out);
+    break;
+  case Kind::Line:
+    out.swap(job.text);
+    break;
+  case Kind::Truncate:
+    ok = file(job.path, true) != nullptr;
+    break;
+  case Kind::Flush:
+    for (File &f : files_)
+      ok = std::fflush(f.f) == 0 && ok;
+    break;
+  }
+  if (job.owned) {
+    backend_->unpin(job.owned);
+    host_.free(job.owned);
+  }
+  std::size_t written = 0;
+  if (ok && !out.empty()) {
+    std::FILE *f = file(job.path, false);
+    ok = f && std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    written = ok ? out.size() : 0;
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  if (!ok)
+    stats_.errors++;
+  if (written) {
+    stats_.records++;
+    stats_.bytes_written += written;
+  }
+}
+
+std::FILE *TraceWriter::file(const std::string &path, bool truncate) {
+  for (auto it = files_.begin(); it != files_.end(); ++it) {
+    if (it->path != path)
+      continue;
+    if (!truncate)
+      return it->f;
+    std::fclose(it->f);
+    files_.erase(it);
+    break;
+  }
+  std::FILE *f = std::fopen(path.c_str(), truncate ? "wb" : "ab");
+  if (!f)
+    return nullptr;
+  std::setvbuf(f, nullptr, _IOFBF, opt_.file_buffer_bytes);
+  files_.push_back({path, f});
+  return f;
+}
+
+void TraceWriter::close_files() {
+  for (File &f : files_)
+    std::fclose(f.f);
+  files_.clear();
+}
+
+} // namespace gcore::rt
@@ -16,7 +16,8 @@ date_str="${DATE_OVERRIDE:-$(date +%F)}"
 
 run() {
   local bin="$1"; shift
-  "${build}/${bin}" "$@" | tee "${results}/${date_str}_${bin}_${preset}.txt"
+  local out="${results}/${date_str}_${bin}_${preset}"
+  GRETA_MANIFEST_OUT="${out}.json" "${build}/${bin}" "$@" | tee "${out}.txt"
 }
 
 case "$preset" in
@@ -1,3 +1,5 @@
+#include "gcore/rt/run_manifest.hpp"
+
 #include <chrono>
 #include <cmath>
 #include <cstdint>
@@ -41,6 +43,8 @@ int main(int argc, char **argv) {
   const int dump = parse_arg_int(args, "--dump", 0);
 
   std::cout << "GRETA CORE Platform Bench: hip_gemm\n";
+  auto manifest = gcore::rt::RunManifest::collect("hip_gemm", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
   std::cout << "m=" << m << " n=" << n << " k=" << k << " iters=" << iters
             << " warmup=" << warmup << " check=" << check
             << " check_samples=" << check_samples << "\n";
@@ -60,6 +64,8 @@ int main(int argc, char **argv) {
   if (hipGetDeviceProperties(&prop, device) == hipSuccess) {
     std::cout << "device=" << prop.name << "\n";
     std::cout << "gcn_arch=" << prop.gcnArchName << "\n";
+    manifest.param("device", prop.name);
+    manifest.param("gcn_arch", prop.gcnArchName);
   }
 
   const size_t bytes_a = static_cast<size_t>(m) * k * sizeof(float);
@@ -261,6 +267,20 @@ int main(int argc, char **argv) {
     std::cout << "  non_finite_samples=" << non_finite << "\n";
   }
 
+  manifest.param("m", m);
+  manifest.param("n", n);
+  manifest.param("k", k);
+  manifest.param("iters", iters);
+  manifest.param("warmup", warmup);
+  manifest.metric("kernel_ms_avg", "ms", gcore::rt::MetricBetter::Lower,
+                  kernel_ms / double(iters));
+  manifest.metric("tflops", "TFLOP/s", gcore::rt::MetricBetter::Higher,
+                  tflops);
+  manifest.status = "OK";
+  std::string merr;
+  if (!manifest.emit(&merr))
+    std::cerr << "Manifest export failed: " << merr << "\n";
+
   hipEventDestroy(ev_start);
   hipEventDestroy(ev_stop);
   hipStreamDestroy(stream);
@@ -1,3 +1,5 @@
+#include "gcore/rt/run_manifest.hpp"
+
 #include <chrono>
 #include <cstdint>
 #include <iomanip>
@@ -35,6 +37,8 @@ int main(int argc, char **argv) {
   const int iters = parse_arg_int(args, "--iters", 200000);
 
   std::cout << "GRETA CORE Platform Bench: hip_noop_launch\n";
+  auto manifest = gcore::rt::RunManifest::collect("hip_noop_launch", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
   std::cout << "iters=" << iters << "\n";
 
 #if !GRETA_HAS_HIP
@@ -77,6 +81,14 @@ int main(int argc, char **argv) {
   std::cout << "  total_sec=" << dt.count() << "\n";
   std::cout << "  per_launch_us=" << per_launch_us << "\n";
 
+  manifest.param("iters", iters);
+  manifest.metric("per_launch_us", "us", gcore::rt::MetricBetter::Lower,
+                  per_launch_us);
+  manifest.status = "OK";
+  std::string merr;
+  if (!manifest.emit(&merr))
+    std::cerr << "Manifest export failed: " << merr << "\n";
+
   hipStreamDestroy(stream);
   return 0;
 #endif
@@ -1,3 +1,5 @@
+#include "gcore/rt/run_manifest.hpp"
+
 #include <chrono>
 #include <cmath>
 #include <cstdint>
@@ -43,6 +45,8 @@ int main(int argc, char **argv) {
   const int warmup = parse_arg_int(args, "--warmup", 10);
 
   std::cout << "GRETA CORE Platform Bench: hip_vec_add\n";
+  auto manifest = gcore::rt::RunManifest::collect("hip_vec_add", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
   std::cout << "n=" << n << " iters=" << iters << " warmup=" << warmup
             << "\n";
 
@@ -61,6 +65,8 @@ int main(int argc, char **argv) {
   if (hipGetDeviceProperties(&prop, device) == hipSuccess) {
     std::cout << "device=" << prop.name << "\n";
     std::cout << "gcn_arch=" << prop.gcnArchName << "\n";
+    manifest.param("device", prop.name);
+    manifest.param("gcn_arch", prop.gcnArchName);
   }
 
   const size_t bytes = static_cast<size_t>(n) * sizeof(float);
@@ -147,6 +153,19 @@ int main(int argc, char **argv) {
             << "\n";
   std::cout << "  max_abs_err=" << max_abs << "\n";
 
+  manifest.param("n", n);
+  manifest.param("iters", iters);
+  manifest.param("warmup", warmup);
+  manifest.param("max_abs_err", max_abs);
+  manifest.metric("kernel_ms_avg", "ms", gcore::rt::MetricBetter::Lower,
+                  kernel_ms / double(iters));
+  manifest.metric("kernel_gbps", "GB/s", gcore::rt::MetricBetter::Higher,
+                  gbps);
+  manifest.status = "OK";
+  std::string merr;
+  if (!manifest.emit(&merr))
+    std::cerr << "Manifest export failed: " << merr << "\n";
+
   hipEventDestroy(ev_start);
   hipEventDestroy(ev_stop);
   hipStreamDestroy(stream);
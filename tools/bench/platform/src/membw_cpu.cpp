@@ -1,3 +1,6 @@
+#include "gcore/rt/host_memory.hpp"
+#include "gcore/rt/run_manifest.hpp"
+
 #include <algorithm>
 #include <atomic>
 #include <chrono>
@@ -7,6 +10,8 @@
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <pthread.h>
+#include <sched.h>
 #include <string>
 #include <thread>
 #include <vector>
@@ -29,9 +34,35 @@ static int parse_arg_int(const std::vector<std::string> &args,
   return def;
 }
 
+static std::string parse_arg_str(const std::vector<std::string> &args,
+                                 const std::string &key,
+                                 const std::string &def) {
+  for (size_t i = 0; i + 1 < args.size(); i++) {
+    if (args[i] == key)
+      return args[i + 1];
+  }
+  return def;
+}
+
+// Pin the calling thread to one CPU so first-touch and mbind(local) land on
+// that CPU's node.
+static void pin_to_cpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
 // Simple multithreaded memcpy bandwidth test.
 // Measures read+write traffic (copy), so effective bytes moved ~ 2 * size per
 // iter.
+//
+// --pages malloc|off|thp|explicit: posix_memalign (default) or an anonymous
+//   mapping with base pages, THP advice, or MAP_HUGETLB.
+// --numa off|first-touch|local|interleave: off keeps the single-threaded
+//   initialisation (all pages on the main thread's node). The other modes pin
+//   worker t to CPU t and initialise each buffer from its worker; local also
+//   binds it to that worker's node, interleave spreads it over all nodes.
 int main(int argc, char **argv) {
   std::vector<std::string> args;
   args.reserve(static_cast<size_t>(argc));
@@ -44,6 +75,23 @@ int main(int argc, char **argv) {
       args, "--threads", static_cast<int>(std::thread::hardware_concurrency()));
   if (threads <= 0)
     threads = 1;
+  const std::string pages = parse_arg_str(args, "--pages", "malloc");
+  const std::string numa = parse_arg_str(args, "--numa", "off");
+
+  gcore::rt::HugePageMode huge_mode = gcore::rt::HugePageMode::Off;
+  gcore::rt::NumaPlacement placement = gcore::rt::NumaPlacement::FirstTouch;
+  const bool use_malloc = pages == "malloc";
+  const bool pinned = numa != "off";
+  if ((!use_malloc && !gcore::rt::parse_huge_page_mode(pages, &huge_mode)) ||
+      (pinned && !gcore::rt::parse_numa_placement(numa, &placement))) {
+    std::cerr << "Unknown --pages or --numa mode\n";
+    return 1;
+  }
+  if (use_malloc && placement != gcore::rt::NumaPlacement::FirstTouch) {
+    std::cerr << "--numa local/interleave needs --pages off|thp|explicit\n";
+    return 1;
+  }
+  const int cpus = std::max(1u, std::thread::hardware_concurrency());
 
   const size_t total_bytes = size_mb * 1024ull * 1024ull;
   // Split per thread aligned to 64B.
@@ -52,17 +100,31 @@ int main(int argc, char **argv) {
   const size_t used_bytes = per_thread * static_cast<size_t>(threads);
 
   std::cout << "GRETA CORE Platform Bench: membw_cpu\n";
+  auto manifest = gcore::rt::RunManifest::collect("membw_cpu", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
+  manifest.threads = static_cast<uint32_t>(threads);
   std::cout << "size_mb=" << size_mb << " iters=" << iters
             << " threads=" << threads
             << " used_bytes=" << used_bytes / (1024.0 * 1024.0) << " MiB\n";
+  std::cout << "pages=" << pages << " numa=" << numa
+            << " nodes=" << gcore::rt::numa_node_count() << "\n";
 
-  // Allocate 2 buffers (src/dst) with alignment.
-  auto alloc_aligned = [](size_t bytes) -> void * {
-    void *p = nullptr;
-    if (posix_memalign(&p, 64, bytes) != 0)
-      return nullptr;
-    std::memset(p, 0xA5, bytes);
-    return p;
+  // Allocate 2 buffers (src/dst) with alignment. Pages are not touched yet.
+  bool all_hugetlb = !use_malloc;
+  std::vector<size_t> mapped_bytes;
+  auto alloc_aligned = [&](size_t bytes) -> void * {
+    if (use_malloc) {
+      void *p = nullptr;
+      if (posix_memalign(&p, 64, bytes) != 0)
+        return nullptr;
+      return p;
+    }
+    const auto m = gcore::rt::map_host_memory(bytes, 64, huge_mode);
+    all_hugetlb = all_hugetlb && m.hugetlb;
+    mapped_bytes.push_back(m.bytes);
+    if (m.base && placement == gcore::rt::NumaPlacement::Interleave)
+      gcore::rt::bind_host_memory(m.base, m.bytes, placement);
+    return m.base;
   };
 
   std::vector<void *> src_ptrs(static_cast<size_t>(threads), nullptr);
@@ -78,6 +140,31 @@ int main(int argc, char **argv) {
     }
   }
 
+  // Initialise: from the main thread (numa=off, the old behaviour) or from
+  // each pinned worker so pages land on its node.
+  if (!pinned) {
+    for (int t = 0; t < threads; t++) {
+      std::memset(src_ptrs[static_cast<size_t>(t)], 0xA5, per_thread);
+      std::memset(dst_ptrs[static_cast<size_t>(t)], 0xA5, per_thread);
+    }
+  } else {
+    std::vector<std::thread> init;
+    for (int t = 0; t < threads; t++) {
+      init.emplace_back([&, t] {
+        pin_to_cpu(t % cpus);
+        for (void *p : {src_ptrs[static_cast<size_t>(t)],
+                        dst_ptrs[static_cast<size_t>(t)]}) {
+          if (placement == gcore::rt::NumaPlacement::Local)
+            gcore::rt::bind_host_memory(p, per_thread, placement);
+          std::memset(p, 0xA5, per_thread);
+        }
+      });
+    }
+    for (auto &th : init)
+      th.join();
+  }
+  const size_t anon_huge = gcore::rt::host_anon_huge_bytes();
+
   // Warmup: touch pages to reduce first-touch noise.
   for (int t = 0; t < threads; t++) {
     volatile uint8_t *p =
@@ -100,6 +187,8 @@ int main(int argc, char **argv) {
 
     for (int t = 0; t < threads; t++) {
       workers.emplace_back([&, t] {
+        if (pinned)
+          pin_to_cpu(t % cpus);
         ready.fetch_add(1, std::memory_order_acq_rel);
         while (!start.load(std::memory_order_acquire)) { /* spin */
         }
@@ -153,10 +242,38 @@ int main(int argc, char **argv) {
   std::cout << "  mean_sec=" << mean << "  mean_GiBps=" << bw(mean) << "\n";
   std::cout << "  p50_sec=" << p50 << "   p50_GiBps=" << bw(p50) << "\n";
   std::cout << "  p99_sec=" << p99 << "   p99_GiBps=" << bw(p99) << "\n";
+  std::cout << "  pages=" << pages << "  numa=" << numa
+            << "  hugetlb=" << (all_hugetlb ? 1 : 0) << "  anon_huge_mib="
+            << static_cast<double>(anon_huge) / (1024.0 * 1024.0) << "\n";
+
+  manifest.param("size_mb", size_mb);
+  manifest.param("iters", iters);
+  manifest.param("pages", pages);
+  manifest.param("numa", numa);
+  manifest.param("hugetlb", all_hugetlb);
+  std::vector<double> gibps;
+  for (double v : iter_seconds)
+    gibps.push_back(bw(v));
+  manifest.metric("copy_gibps", "GiB/s", gcore::rt::MetricBetter::Higher,
+                  gibps);
+  manifest.metric("iter_sec", "s", gcore::rt::MetricBetter::Lower,
+                  iter_seconds);
+  manifest.status = "OK";
+  std::string err;
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
 
   for (int t = 0; t < threads; t++) {
-    std::free(src_ptrs[static_cast<size_t>(t)]);
-    std::free(dst_ptrs[static_cast<size_t>(t)]);
+    if (use_malloc) {
+      std::free(src_ptrs[static_cast<size_t>(t)]);
+      std::free(dst_ptrs[static_cast<size_t>(t)]);
+    } else {
+      gcore::rt::unmap_host_memory(src_ptrs[static_cast<size_t>(t)],
+                                   mapped_bytes[2 * static_cast<size_t>(t)]);
+      gcore::rt::unmap_host_memory(
+          dst_ptrs[static_cast<size_t>(t)],
+          mapped_bytes[2 * static_cast<size_t>(t) + 1]);
+    }
   }
 
   return 0;
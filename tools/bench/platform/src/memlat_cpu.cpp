@@ -1,3 +1,6 @@
+#include "gcore/rt/host_memory.hpp"
+#include "gcore/rt/run_manifest.hpp"
+
 #include <algorithm>
 #include <chrono>
 #include <cstdint>
@@ -5,8 +8,12 @@
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <linux/perf_event.h>
 #include <random>
 #include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <vector>
 
 // Pointer-chasing latency benchmark.
@@ -30,6 +37,35 @@ static int parse_arg_int(const std::vector<std::string> &args,
   return def;
 }
 
+static std::string parse_arg_str(const std::vector<std::string> &args,
+                                 const std::string &key,
+                                 const std::string &def) {
+  for (size_t i = 0; i + 1 < args.size(); i++) {
+    if (args[i] == key)
+      return args[i + 1];
+  }
+  return def;
+}
+
+// Contador de dTLB load misses del hilo actual (-1 si perf no está
+// disponible, p.ej. perf_event_paranoid o contenedores).
+static int open_dtlb_miss_counter() {
+  perf_event_attr attr{};
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(
+      syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// --pages malloc|off|thp|explicit: posix_memalign (default) o mapeo anónimo
+// con páginas base, THP (madvise) o MAP_HUGETLB. Con 4 KiB casi cada salto
+// falla en el dTLB; con 2 MiB el working set cabe en mucho menos entradas.
 int main(int argc, char **argv) {
   std::vector<std::string> args;
   args.reserve(static_cast<size_t>(argc));
@@ -40,18 +76,37 @@ int main(int argc, char **argv) {
   const int iters = parse_arg_int(args, "--iters", 50);
   const uint64_t seed =
       static_cast<uint64_t>(parse_arg_size(args, "--seed", 12345));
+  const std::string pages = parse_arg_str(args, "--pages", "malloc");
+  const bool use_malloc = pages == "malloc";
+  gcore::rt::HugePageMode huge_mode = gcore::rt::HugePageMode::Off;
+  if (!use_malloc && !gcore::rt::parse_huge_page_mode(pages, &huge_mode)) {
+    std::cerr << "Unknown --pages mode: " << pages << "\n";
+    return 1;
+  }
 
   const size_t bytes = size_mb * 1024ull * 1024ull;
   const size_t count = bytes / sizeof(uint32_t);
 
   std::cout << "GRETA CORE Platform Bench: memlat_cpu\n";
+  auto manifest = gcore::rt::RunManifest::collect("memlat_cpu", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
+  manifest.threads = 1;
   std::cout << "size_mb=" << size_mb << " iters=" << iters << " seed=" << seed
-            << "\n";
+            << " pages=" << pages << "\n";
 
   // Alineación 64B
   uint32_t *next = nullptr;
-  if (posix_memalign(reinterpret_cast<void **>(&next), 64,
-                     count * sizeof(uint32_t)) != 0) {
+  gcore::rt::HostMapping mapping;
+  if (use_malloc) {
+    if (posix_memalign(reinterpret_cast<void **>(&next), 64,
+                       count * sizeof(uint32_t)) != 0)
+      next = nullptr;
+  } else {
+    mapping =
+        gcore::rt::map_host_memory(count * sizeof(uint32_t), 64, huge_mode);
+    next = static_cast<uint32_t *>(mapping.base);
+  }
+  if (!next) {
     std::cerr << "Allocation failed\n";
     return 1;
   }
@@ -105,6 +160,8 @@ int main(int argc, char **argv) {
   double p50 = ns_per_hop[ns_per_hop.size() / 2];
   double p99 = ns_per_hop[static_cast<size_t>(
       std::min<size_t>(ns_per_hop.size() - 1, (ns_per_hop.size() * 99) / 100))];
+  manifest.metric("ns_per_hop", "ns", gcore::rt::MetricBetter::Lower,
+                  ns_per_hop);
 
   std::cout << std::fixed << std::setprecision(2);
   std::cout << "RESULT memlat_cpu:\n";
@@ -112,6 +169,44 @@ int main(int argc, char **argv) {
   std::cout << "  p50_ns_per_hop=" << p50 << "\n";
   std::cout << "  p99_ns_per_hop=" << p99 << "\n";
 
-  std::free(next);
+  // Una ronda extra con el contador de dTLB misses.
+  const int fd = open_dtlb_miss_counter();
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    measure_once(steps);
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t misses = 0;
+    if (read(fd, &misses, sizeof(misses)) != sizeof(misses))
+      misses = 0;
+    close(fd);
+    const double per_hop =
+        static_cast<double>(misses) / static_cast<double>(steps);
+    std::cout << "  dtlb_misses_per_hop=" << per_hop << "\n";
+    manifest.metric("dtlb_misses_per_hop", "count",
+                    gcore::rt::MetricBetter::Lower, per_hop);
+  } else {
+    std::cout << "  dtlb_misses_per_hop=n/a\n";
+  }
+  std::cout << "  pages=" << pages << "  hugetlb=" << (mapping.hugetlb ? 1 : 0)
+            << "  anon_huge_mib="
+            << static_cast<double>(gcore::rt::host_anon_huge_bytes()) /
+                   (1024.0 * 1024.0)
+            << "\n";
+
+  manifest.param("size_mb", size_mb);
+  manifest.param("iters", iters);
+  manifest.param("seed", seed);
+  manifest.param("pages", pages);
+  manifest.param("hugetlb", mapping.hugetlb);
+  manifest.status = "OK";
+  std::string err;
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
+  if (use_malloc)
+    std::free(next);
+  else
+    gcore::rt::unmap_host_memory(mapping.base, mapping.bytes);
   return 0;
 }
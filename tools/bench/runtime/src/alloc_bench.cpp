@@ -1,13 +1,18 @@
 #include "gcore/rt/allocator.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <random>
 #include <string>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
 static int argi(int argc, char **argv, const char *key, int def) {
@@ -26,17 +31,144 @@ static size_t argu(int argc, char **argv, const char *key, size_t def) {
   return def;
 }
 
+// One worker of the multi-threaded mode: the same alloc-batch/free-batch loop
+// as the single-threaded bench, with its own RNG stream.
+static void mt_worker(gcore::rt::HostAllocator &alloc, int iters,
+                      int ops_per_iter, int max_kb, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_int_distribution<int> size_dist(1, max_kb * 1024);
+  std::vector<void *> ptrs(static_cast<size_t>(ops_per_iter), nullptr);
+  for (int i = 0; i < iters; i++) {
+    for (int j = 0; j < ops_per_iter; j++)
+      ptrs[static_cast<size_t>(j)] =
+          alloc.alloc(static_cast<size_t>(size_dist(rng)), 64);
+    for (int j = 0; j < ops_per_iter; j++)
+      alloc.free(ptrs[static_cast<size_t>(j)]);
+  }
+}
+
+// Scaling sweep 1, 2, 4, ... max_threads (plus max_threads itself) on one
+// shared allocator. Reports aggregate throughput and speedup over 1 thread.
+static void run_mt(int max_threads, int iters, int ops_per_iter, int max_kb,
+                   uint64_t seed, int rounds,
+                   gcore::rt::RunManifest *manifest) {
+  std::vector<int> counts;
+  for (int t = 1; t < max_threads; t *= 2)
+    counts.push_back(t);
+  counts.push_back(max_threads);
+
+  std::cout << "RESULT alloc_bench_mt: iters_per_thread=" << iters
+            << " rounds=" << rounds << "\n";
+  double base_ops = 0.0;
+  for (int threads : counts) {
+    gcore::rt::HostAllocator alloc;
+    std::vector<double> secs;
+    for (int round = 0; round < rounds; round++) {
+      std::vector<std::thread> pool;
+      auto t0 = std::chrono::steady_clock::now();
+      for (int t = 0; t < threads; t++)
+        pool.emplace_back(mt_worker, std::ref(alloc), iters, ops_per_iter,
+                          max_kb, seed + static_cast<uint64_t>(t) * 7919);
+      for (auto &th : pool)
+        th.join();
+      auto t1 = std::chrono::steady_clock::now();
+      secs.push_back(std::chrono::duration<double>(t1 - t0).count());
+    }
+    std::vector<double> round_ops;
+    for (double s : secs)
+      round_ops.push_back(static_cast<double>(threads) * iters * ops_per_iter *
+                          2.0 / s);
+    manifest->metric("mt_ops_per_sec_t" + std::to_string(threads), "ops/s",
+                     gcore::rt::MetricBetter::Higher, round_ops);
+    std::sort(secs.begin(), secs.end());
+    const double p50 = secs[secs.size() / 2];
+    const double ops = static_cast<double>(threads) * iters * ops_per_iter *
+                       2.0 / p50; // alloc+free
+    if (threads == 1)
+      base_ops = ops;
+    const auto st = alloc.stats();
+    std::cout << "  threads=" << threads << "  p50_sec=" << p50
+              << "  ops_per_sec=" << ops
+              << "  per_thread_ops_per_sec=" << ops / threads
+              << "  scaling=" << (base_ops > 0.0 ? ops / base_ops : 0.0)
+              << "  reuse_hits=" << st.reuse_hits
+              << "  os_allocs=" << st.os_allocs << "\n";
+  }
+}
+
+// Resident set size of the process, from /proc/self/statm.
+static size_t rss_bytes() {
+  std::ifstream f("/proc/self/statm");
+  size_t pages_total = 0, pages_resident = 0;
+  f >> pages_total >> pages_resident;
+  return pages_resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Hold `live` random-sized blocks (payload fully written) and report the RSS
+// they cost under power-of-two bins versus the default size classes.
+static void run_rss(int live, int max_kb, uint64_t seed,
+                    gcore::rt::RunManifest *manifest) {
+  std::cout << "RESULT alloc_bench_rss: live=" << live << " max_kb=" << max_kb
+            << "\n";
+  for (int per_doubling : {1, 4}) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> size_dist(1, max_kb * 1024);
+    gcore::rt::HostAllocator alloc(6, 20, 20, per_doubling);
+    std::vector<void *> ptrs(static_cast<size_t>(live), nullptr);
+    size_t requested = 0;
+    const size_t rss0 = rss_bytes();
+    for (auto &p : ptrs) {
+      const size_t size = static_cast<size_t>(size_dist(rng));
+      p = alloc.alloc(size, 64);
+      if (p)
+        std::memset(p, 0x5a, size);
+      requested += size;
+    }
+    const size_t rss1 = rss_bytes();
+    const auto st = alloc.stats();
+    for (void *p : ptrs)
+      alloc.free(p);
+    alloc.release();
+    const double rss_delta = static_cast<double>(rss1 > rss0 ? rss1 - rss0 : 0);
+    manifest->metric("rss_delta_kib_cpd" + std::to_string(per_doubling),
+                     "KiB", gcore::rt::MetricBetter::Lower, rss_delta / 1024.0);
+    std::cout << "  classes_per_doubling=" << per_doubling
+              << "  rss_delta_kib=" << rss_delta / 1024.0
+              << "  requested_kib=" << static_cast<double>(requested) / 1024.0
+              << "  rss_overhead="
+              << (requested ? rss_delta / static_cast<double>(requested) - 1.0
+                            : 0.0)
+              << "  bytes_in_use=" << st.bytes_in_use
+              << "  bytes_reserved=" << st.bytes_reserved
+              << "  internal_frag=" << st.internal_fragmentation() << "\n";
+  }
+}
+
 int main(int argc, char **argv) {
   const int iters = argi(argc, argv, "--iters", 200000);
   const int ops_per_iter = argi(argc, argv, "--ops", 64);
   const int max_kb = argi(argc, argv, "--max-kb", 256);
   const uint64_t seed =
       static_cast<uint64_t>(argu(argc, argv, "--seed", 12345));
+  const int threads = argi(argc, argv, "--threads", 1);
+  const int mt_rounds = argi(argc, argv, "--mt-rounds", 5);
+  const int rss_live = argi(argc, argv, "--rss-live", 1024);
 
   std::cout << "GRETA CORE Runtime Bench: alloc_bench\n";
   std::cout << "iters=" << iters << " ops=" << ops_per_iter
             << " max_kb=" << max_kb << " seed=" << seed << "\n";
 
+  auto manifest = gcore::rt::RunManifest::collect("alloc_bench", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
+  manifest.param("iters", iters);
+  manifest.param("ops", ops_per_iter);
+  manifest.param("max_kb", max_kb);
+  manifest.param("seed", seed);
+  manifest.param("threads", threads);
+  manifest.param("mt_rounds", mt_rounds);
+  manifest.param("rss_live", rss_live);
+  manifest.threads = static_cast<uint32_t>(threads);
+
   gcore::rt::HostAllocator alloc;
 
   std::mt19937_64 rng(seed);
@@ -74,6 +206,7 @@ int main(int argc, char **argv) {
     secs.push_back(dt.count());
   }
 
+  manifest.metric("round_sec", "s", gcore::rt::MetricBetter::Lower, secs);
   std::sort(secs.begin(), secs.end());
   double mean = 0.0;
   for (double v : secs)
@@ -105,7 +238,18 @@ int main(int argc, char **argv) {
             << " free_calls=" << st.free_calls
             << " reuse_hits=" << st.reuse_hits << " os_allocs=" << st.os_allocs
             << " bytes_in_use=" << st.bytes_in_use
-            << " bytes_reserved=" << st.bytes_reserved << "\n";
+            << " bytes_reserved=" << st.bytes_reserved
+            << " internal_frag=" << st.internal_fragmentation() << "\n";
+
+  if (rss_live > 0)
+    run_rss(rss_live, max_kb, seed, &manifest);
+
+  if (threads > 1)
+    run_mt(threads, iters, ops_per_iter, max_kb, seed, mt_rounds, &manifest);
 
+  manifest.status = "OK";
+  std::string err;
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
   return 0;
 }
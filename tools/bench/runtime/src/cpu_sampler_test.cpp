@@ -0,0 +1,180 @@
+#include "gcore/rt/cpu_sampler.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace gcore::rt;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+static bool contains(const std::string &hay, const std::string &needle) {
+  return hay.find(needle) != std::string::npos;
+}
+
+static double thread_cpu_ms() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static volatile double g_sink = 0.0;
+
+// Exported (the test links with -rdynamic) and not inlined, so the samples
+// resolve to these names.
+extern "C" __attribute__((noinline)) void greta_test_burn_main(double ms) {
+  const double until = thread_cpu_ms() + ms;
+  double x = 1.0;
+  while (thread_cpu_ms() < until)
+    for (int i = 0; i < 1000; ++i)
+      x = std::sqrt(x + i);
+  g_sink = g_sink + x;
+}
+
+extern "C" __attribute__((noinline)) void greta_test_burn_worker(double ms) {
+  const double until = thread_cpu_ms() + ms;
+  double x = 2.0;
+  while (thread_cpu_ms() < until)
+    for (int i = 0; i < 1000; ++i)
+      x = std::sqrt(x * 1.5 + i);
+  g_sink = g_sink + x;
+}
+
+static std::string read_file(const std::string &path) {
+  std::ifstream f(path);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+int main() {
+  std::cout << "GRETA CORE: cpu_sampler_test\n";
+  CpuSampler &s = CpuSampler::global();
+  std::string err;
+
+  // Two busy threads: both show up, under their own names.
+  {
+    check(s.start(1000, &err), "start");
+    check(s.running(), "running");
+    check(!s.start(1000, &err) && contains(err, "already running"),
+          "second start fails");
+    check(s.profile().stacks.empty(), "no profile while running");
+    std::thread worker([] {
+      pthread_setname_np(pthread_self(), "burner");
+      greta_test_burn_worker(300);
+    });
+    greta_test_burn_main(300);
+    worker.join();
+    s.stop();
+    check(!s.running(), "stopped");
+    s.stop(); // No-op
+    // A SIGPROF still pending at stop() must not hit SIG_DFL, which would
+    // terminate the test here.
+    raise(SIGPROF);
+
+    const CpuProfile p = s.profile();
+    check(p.hz == 1000, "hz");
+    // 600 ms of CPU; the kernel tick caps the rate (250 Hz is common).
+    check(p.samples >= 50 && p.dropped == 0, "sample count");
+    uint64_t sum = 0;
+    for (const auto &st : p.stacks)
+      sum += st.count;
+    check(sum == p.samples, "stacks hold every sample");
+    for (std::size_t i = 1; i < p.stacks.size(); ++i)
+      check(p.stacks[i - 1].count >= p.stacks[i].count, "stacks by count");
+
+    const std::string folded = p.to_folded();
+    check(contains(folded, "burner;") &&
+              contains(folded, "greta_test_burn_worker"),
+          "worker thread stacks");
+    check(contains(folded, ";main;greta_test_burn_main"),
+          "main thread stack, outermost frame first");
+    check(!contains(folded, "on_signal"), "handler frames skipped");
+    std::istringstream lines(folded);
+    std::string line;
+    bool well_formed = true;
+    while (std::getline(lines, line)) {
+      const auto sp = line.rfind(' ');
+      well_formed = well_formed && sp != std::string::npos &&
+                    std::strtoull(line.c_str() + sp + 1, nullptr, 10) > 0;
+    }
+    check(well_formed, "folded lines end in a count");
+
+    const std::string flat = p.flat_report(10);
+    check(contains(flat, "CPU profile: ") && contains(flat, "at 1000 Hz") &&
+              contains(flat, "greta_test_burn_main") &&
+              contains(flat, "greta_test_burn_worker"),
+          "flat report");
+    const std::string tree = p.tree_report(1.0);
+    check(contains(tree, "[burner]") &&
+              contains(tree, "greta_test_burn_worker"),
+          "call tree");
+
+    const std::string base =
+        "/tmp/greta_cpu_sampler_test_" + std::to_string(getpid());
+    check(p.write(base + ".folded", &err) &&
+              read_file(base + ".folded") == folded,
+          "write folded");
+    check(p.write(base + ".txt", &err) &&
+              contains(read_file(base + ".txt"), "Call tree"),
+          "write text report");
+    std::remove((base + ".folded").c_str());
+    std::remove((base + ".txt").c_str());
+    check(!p.write("/nonexistent/dir/p.folded", &err) &&
+              contains(err, "/nonexistent/dir/p.folded"),
+          "write error");
+  }
+
+  // A tiny buffer: samples past it are dropped, not written out of bounds.
+  {
+    check(s.start(1000, &err, 64), "restart with a small buffer");
+    greta_test_burn_main(100);
+    s.stop();
+    const CpuProfile p = s.profile();
+    uint64_t sum = 0;
+    for (const auto &st : p.stacks)
+      sum += st.count;
+    check(p.dropped > 0 && sum + p.dropped == p.samples, "dropped samples");
+  }
+
+  // Sleeping costs no CPU time, so it is not sampled.
+  {
+    check(s.start(1000, &err), "restart");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    s.stop();
+    check(s.samples() < 20, "idle process barely sampled");
+  }
+
+  {
+    setenv("GRETA_PROFILE_CPU_HZ", "250", 1);
+    check(CpuSampler::hz_from_env() == 250, "hz from env");
+    setenv("GRETA_PROFILE_CPU_HZ", "-3", 1);
+    check(CpuSampler::hz_from_env() == CpuSampler::kDefaultHz,
+          "bad hz falls back to default");
+  }
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
@@ -1,6 +1,8 @@
 #include "gcore/rt/dispatch.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <iomanip>
@@ -18,10 +20,16 @@ static int argi(int argc, char **argv, const char *key, int def) {
 
 int main(int argc, char **argv) {
   const int n = argi(argc, argv, "--n", 500000);
+  const int pool_workers = argi(argc, argv, "--pool-workers", 0);
 
   std::cout << "GRETA CORE Runtime Bench: dispatch_bench\n";
   std::cout << "n=" << n << "\n";
 
+  auto manifest = gcore::rt::RunManifest::collect("dispatch_bench", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
+  manifest.param("n", n);
+  manifest.param("pool_workers", pool_workers);
+
   gcore::rt::Stream stream;
   gcore::rt::Dispatcher disp;
 
@@ -45,6 +53,15 @@ int main(int argc, char **argv) {
     secs.push_back(dt.count());
   }
 
+  auto ns_per = [&](double s) { return (s * 1e9) / static_cast<double>(n); };
+  auto record = [&](const char *name, const std::vector<double> &v) {
+    std::vector<double> ns;
+    for (double s : v)
+      ns.push_back(ns_per(s));
+    manifest.metric(name, "ns", gcore::rt::MetricBetter::Lower, ns);
+  };
+  record("ns_per_submit_and_exec", secs);
+
   std::sort(secs.begin(), secs.end());
   double mean = 0.0;
   for (double v : secs)
@@ -55,8 +72,6 @@ int main(int argc, char **argv) {
   const double p99 = secs[static_cast<size_t>(
       std::min<size_t>(secs.size() - 1, (secs.size() * 99) / 100))];
 
-  auto ns_per = [&](double s) { return (s * 1e9) / static_cast<double>(n); };
-
   auto st = disp.stats();
 
   std::cout << std::fixed << std::setprecision(3);
@@ -65,9 +80,76 @@ int main(int argc, char **argv) {
   std::cout << "  p50_ns_per_submit_and_exec=" << ns_per(p50) << "\n";
   std::cout << "  p99_ns_per_submit_and_exec=" << ns_per(p99) << "\n";
 
+  // Eager enqueue vs replay of the same N no-op tasks captured once into a
+  // TaskGraph (one ring task per launch, no per-task allocation).
+  {
+    auto p50_of = [&](const char *name, auto &&body) {
+      std::vector<double> v;
+      for (int round = 0; round < 20; round++) {
+        auto t0 = std::chrono::steady_clock::now();
+        body();
+        stream.flush();
+        auto t1 = std::chrono::steady_clock::now();
+        v.push_back(std::chrono::duration<double>(t1 - t0).count());
+      }
+      record(name, v);
+      std::sort(v.begin(), v.end());
+      return ns_per(v[v.size() / 2]);
+    };
+    const double eager = p50_of("eager_enqueue_ns_per_task", [&] {
+      for (int i = 0; i < n; i++)
+        stream.enqueue([] {});
+    });
+    gcore::rt::TaskGraph graph;
+    stream.begin_capture();
+    for (int i = 0; i < n; i++)
+      stream.enqueue([] {});
+    stream.end_capture(&graph);
+    const double replay =
+        p50_of("graph_replay_ns_per_task", [&] { stream.launch(graph); });
+    std::cout << "  eager_enqueue_p50_ns_per_task=" << eager << "\n";
+    std::cout << "  graph_replay_p50_ns_per_task=" << replay << "\n";
+  }
+
+  // Same work as independent tasks on a work-stealing pool. Completion is
+  // counted instead of chained, since pool tasks are unordered.
+  {
+    gcore::rt::ThreadPool pool(static_cast<unsigned>(pool_workers));
+    std::vector<double> pool_secs;
+    for (int round = 0; round < 20; round++) {
+      std::atomic<int> left{n};
+      gcore::rt::Event all_done;
+      auto t0 = std::chrono::steady_clock::now();
+      for (int i = 0; i < n; i++) {
+        disp.submit(pool, [&] {
+          if (left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            all_done.signal();
+        });
+      }
+      all_done.wait();
+      auto t1 = std::chrono::steady_clock::now();
+      pool_secs.push_back(std::chrono::duration<double>(t1 - t0).count());
+    }
+    record("pool_ns_per_submit_and_exec", pool_secs);
+    std::sort(pool_secs.begin(), pool_secs.end());
+    auto ps = pool.stats();
+    std::cout << "  pool_workers=" << pool.size()
+              << "  p50_ns_per_submit_and_exec="
+              << ns_per(pool_secs[pool_secs.size() / 2])
+              << "  steals=" << ps.steals << "\n";
+  }
+  st = disp.stats();
+
   std::cout << "DISPATCH stats snapshot:\n";
   std::cout << "  submits=" << st.submits << " completed=" << st.completed
             << " total_work_ns=" << st.total_work_ns << "\n";
-
+  std::cout << "  work_p50_ns=" << st.work_p50_ns
+            << " work_p99_ns=" << st.work_p99_ns
+            << " work_p999_ns=" << st.work_p999_ns << "\n";
+
+  manifest.status = "OK";
+  std::string err;
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
   return 0;
 }
@@ -3,6 +3,7 @@
 #include "gcore/rt/hip/backend.hpp"
 #include "gcore/rt/hip/buffer.hpp"
 #include "gcore/rt/hip/stream.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <cmath>
 #include <iostream>
@@ -45,8 +46,10 @@ void rope_ref(float *x, uint32_t seq_len, uint32_t num_heads, uint32_t head_dim,
   }
 }
 
-int main() {
+int main(int argc, char **argv) {
   std::cout << "GRETA CORE: hip_attention_bench (RoPE + Mask)\n";
+  auto manifest = gcore::rt::RunManifest::collect(
+      "hip_attention_bench", argc, argv, GRETA_BUILD_FEATURES);
 
   Backend backend;
   std::string err;
@@ -55,6 +58,8 @@ int main() {
     return 1;
   }
   backend.print_diagnostics(std::cout);
+  manifest.param("device", backend.device_info().name);
+  manifest.param("gcn_arch", backend.device_info().gcn_arch_name);
 
   uint32_t seq_len = 128;
   uint32_t num_heads = 12;
@@ -126,7 +131,19 @@ int main() {
   }
   std::cout << "RoPE Max Diff: " << rope_diff << "\n";
 
-  if (mask_diff > 1e-5 || rope_diff > 1e-5) {
+  manifest.param("seq_len", seq_len);
+  manifest.param("heads", num_heads);
+  manifest.param("head_dim", head_dim);
+  manifest.metric("mask_max_diff", "abs", gcore::rt::MetricBetter::Lower,
+                  mask_diff);
+  manifest.metric("rope_max_diff", "abs", gcore::rt::MetricBetter::Lower,
+                  rope_diff);
+  const bool ok = mask_diff <= 1e-5 && rope_diff <= 1e-5;
+  manifest.status = ok ? "OK" : "FAILED";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
+  if (!ok) {
     std::cout << "STATUS=FAILED\n";
     return 1;
   }
@@ -2,13 +2,17 @@
 #include "gcore/rt/hip/buffer.hpp"
 #include "gcore/rt/hip/kernels/basic_kernels.hpp"
 #include "gcore/rt/hip/stream.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <vector>
 
-int main() {
+int main(int argc, char **argv) {
   std::cout << "GRETA CORE Runtime Bench: hip_fill_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect("hip_fill_bench", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
 
   gcore::rt::hip::Backend backend;
   std::string err;
@@ -17,6 +21,8 @@ int main() {
     return 1;
   }
   backend.print_diagnostics(std::cout);
+  manifest.param("device", backend.device_info().name);
+  manifest.param("gcn_arch", backend.device_info().gcn_arch_name);
 
   size_t N = 1024 * 1024 * 64; // 64M elements * 4 bytes = 256MB
   uint32_t value = 0xDEADBEEF;
@@ -35,6 +41,7 @@ int main() {
   }
 
   std::cout << "Running Fill Kernel (N=" << N << ")...\n";
+  const auto t0 = std::chrono::steady_clock::now();
   gcore::rt::hip::kernels::launch_fill(
       stream.handle(), static_cast<uint32_t *>(buf.data()), value, N);
 
@@ -42,6 +49,9 @@ int main() {
     std::cerr << "Sync failed: " << err << "\n";
     return 1;
   }
+  const double fill_ms = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - t0)
+                             .count();
 
   // Verification
   std::vector<uint32_t> host_data(N);
@@ -61,6 +71,16 @@ int main() {
     }
   }
 
+  manifest.param("n", N);
+  manifest.metric("fill_ms", "ms", gcore::rt::MetricBetter::Lower, fill_ms);
+  manifest.metric("fill_gbps", "GB/s", gcore::rt::MetricBetter::Higher,
+                  N * sizeof(uint32_t) / (fill_ms * 1e6));
+  manifest.metric("errors", "count", gcore::rt::MetricBetter::Lower,
+                  static_cast<double>(errors));
+  manifest.status = errors > 0 ? "FAILED" : "OK";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
   if (errors > 0) {
     std::cout << "STATUS=FAILED errors=" << errors << "\n";
     return 1;
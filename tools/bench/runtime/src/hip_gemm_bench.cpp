@@ -2,6 +2,7 @@
 #include "gcore/rt/hip/buffer.hpp"
 #include "gcore/rt/hip/kernels/gemm_kernels.hpp"
 #include "gcore/rt/hip/stream.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <algorithm>
 #include <chrono>
@@ -54,6 +55,14 @@ int main(int argc, char **argv) {
   else
     std::cout << "Mode: Tiled (Legacy)\n";
 
+  auto manifest = gcore::rt::RunManifest::collect("hip_gemm_bench", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
+  manifest.param("M", M);
+  manifest.param("N", N);
+  manifest.param("K", K);
+  manifest.param("iters", iters);
+  manifest.param("mode", run_mfma ? "mfma" : "tiled");
+
   gcore::rt::hip::Backend backend;
   std::string err;
   if (!backend.init(&err)) {
@@ -61,6 +70,8 @@ int main(int argc, char **argv) {
     return 1;
   }
   backend.print_diagnostics(std::cout);
+  manifest.param("device", backend.device_info().name);
+  manifest.param("gcn_arch", backend.device_info().gcn_arch_name);
 
   // Strides (Row Major)
   int lda = K;
@@ -147,6 +158,13 @@ int main(int argc, char **argv) {
   double gflops = (2.0 * M * N * K) /
                   (avg_ms * 1e6); // 1e-3 (ms->s) * 1e9 (FLOPS->GFLOPS) = 1e6
 
+  std::vector<double> sample_gflops;
+  for (double ms : samples)
+    sample_gflops.push_back((2.0 * M * N * K) / (ms * 1e6));
+  manifest.metric("gemm_ms", "ms", gcore::rt::MetricBetter::Lower, samples);
+  manifest.metric("gflops", "GFLOP/s", gcore::rt::MetricBetter::Higher,
+                  sample_gflops);
+
   std::cout << "Mean time: " << avg_ms << " ms\n";
   std::cout << "Perf: " << gflops << " GFLOPS\n";
 
@@ -168,8 +186,12 @@ int main(int argc, char **argv) {
         max_diff = d;
     }
     std::cout << "Max diff: " << max_diff << "\n";
+    manifest.param("max_diff", max_diff);
     if (max_diff > 1e-2) { // Slightly looser tolerance for MFMA which might
                            // have different accumulation order
+      manifest.status = "FAILED";
+      if (!manifest.emit(&err))
+        std::cerr << "Manifest export failed: " << err << "\n";
       std::cout << "STATUS=FAILED\n";
       return 1;
     }
@@ -177,6 +199,9 @@ int main(int argc, char **argv) {
     std::cout << "Skipping validation (matrix too large for CPU ref)\n";
   }
 
+  manifest.status = "OK";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
   std::cout << "STATUS=OK\n";
   return 0;
 }
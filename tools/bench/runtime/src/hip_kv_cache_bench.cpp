@@ -3,8 +3,10 @@
 #include "gcore/rt/hip/backend.hpp"
 #include "gcore/rt/hip/buffer.hpp"
 #include "gcore/rt/hip/stream.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <random>
@@ -13,8 +15,10 @@
 using namespace gcore::rt::graph;
 using namespace gcore::rt::hip;
 
-int main() {
+int main(int argc, char **argv) {
   std::cout << "GRETA CORE: hip_kv_cache_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect(
+      "hip_kv_cache_bench", argc, argv, GRETA_BUILD_FEATURES);
 
   Backend backend;
   std::string err;
@@ -23,6 +27,8 @@ int main() {
     return 1;
   }
   backend.print_diagnostics(std::cout);
+  manifest.param("device", backend.device_info().name);
+  manifest.param("gcn_arch", backend.device_info().gcn_arch_name);
 
   uint32_t num_heads = 32;
   uint32_t head_dim = 128;
@@ -56,6 +62,7 @@ int main() {
   Stream stream;
   stream.init(&err);
 
+  std::vector<double> update_ms;
   for (uint32_t step = 0; step < test_steps; ++step) {
     std::cout << "Step " << step << "...\n";
 
@@ -79,8 +86,12 @@ int main() {
         (const float *)buf_new_k.data(), (const float *)buf_new_v.data(), step,
         max_seq_len, num_heads, head_dim));
 
+    const auto t0 = std::chrono::steady_clock::now();
     HIPGraphRunner::execute(stream.handle(), graph, &err);
     stream.sync();
+    update_ms.push_back(std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - t0)
+                            .count());
   }
 
   // Final Validation
@@ -107,6 +118,17 @@ int main() {
 
   std::cout << "KV-Cache Max Diff: " << max_diff << "\n";
 
+  manifest.param("heads", num_heads);
+  manifest.param("head_dim", head_dim);
+  manifest.param("max_seq_len", max_seq_len);
+  manifest.param("steps", test_steps);
+  manifest.metric("kv_update_ms", "ms", gcore::rt::MetricBetter::Lower,
+                  update_ms);
+  manifest.metric("max_diff", "abs", gcore::rt::MetricBetter::Lower, max_diff);
+  manifest.status = max_diff > 1e-6 ? "FAILED" : "OK";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
   if (max_diff > 1e-6) {
     std::cout << "STATUS=FAILED\n";
     return 1;
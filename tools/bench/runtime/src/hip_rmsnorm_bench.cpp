@@ -2,6 +2,7 @@
 #include "gcore/rt/hip/buffer.hpp"
 #include "gcore/rt/hip/kernels/basic_kernels.hpp"
 #include "gcore/rt/hip/stream.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <algorithm>
 #include <chrono>
@@ -49,6 +50,12 @@ int main(int argc, char **argv) {
   std::cout << "rows=" << rows << " cols=" << cols << " iters=" << iters
             << "\n";
 
+  auto manifest = gcore::rt::RunManifest::collect(
+      "hip_rmsnorm_bench", argc, argv, GRETA_BUILD_FEATURES);
+  manifest.param("rows", rows);
+  manifest.param("cols", cols);
+  manifest.param("iters", iters);
+
   gcore::rt::hip::Backend backend;
   std::string err;
   if (!backend.init(&err)) {
@@ -56,6 +63,8 @@ int main(int argc, char **argv) {
     return 1;
   }
   backend.print_diagnostics(std::cout);
+  manifest.param("device", backend.device_info().name);
+  manifest.param("gcn_arch", backend.device_info().gcn_arch_name);
 
   size_t size_bytes = static_cast<size_t>(rows) * cols * sizeof(float);
   size_t gamma_bytes = static_cast<size_t>(cols) * sizeof(float);
@@ -116,6 +125,7 @@ int main(int argc, char **argv) {
   for (auto s : samples)
     sum += s;
   std::cout << "Mean time: " << sum / samples.size() << " ms\n";
+  manifest.metric("rmsnorm_ms", "ms", gcore::rt::MetricBetter::Lower, samples);
 
   // Validate
   std::vector<float> y_host(rows * cols);
@@ -135,6 +145,10 @@ int main(int argc, char **argv) {
   }
 
   std::cout << "Max diff: " << max_diff << "\n";
+  manifest.metric("max_diff", "abs", gcore::rt::MetricBetter::Lower, max_diff);
+  manifest.status = max_diff > 1e-4 ? "FAILED" : "OK";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
   if (max_diff > 1e-4) {
     std::cout << "STATUS=FAILED\n";
     return 1;
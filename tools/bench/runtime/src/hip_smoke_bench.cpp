@@ -1,4 +1,5 @@
 #include "gcore/rt/hip/backend.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <chrono>
 #include <cstdint>
@@ -6,8 +7,10 @@
 #include <iostream>
 #include <string>
 
-int main() {
+int main(int argc, char **argv) {
   std::cout << "GRETA CORE Runtime Bench: hip_smoke_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect("hip_smoke_bench", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
 
   gcore::rt::hip::Backend b;
   std::string err;
@@ -52,6 +55,16 @@ int main() {
   std::cout << "  init_ms=" << (init_ns / 1e6) << "\n";
   std::cout << "  device_sync_wait_ms=" << (sync_ns / 1e6) << "\n";
   std::cout << "  device_sync_total_ms=" << (total_sync_ns / 1e6) << "\n";
+
+  manifest.param("device", info.name);
+  manifest.param("gcn_arch", info.gcn_arch_name);
+  manifest.metric("init_ms", "ms", gcore::rt::MetricBetter::Lower,
+                  init_ns / 1e6);
+  manifest.metric("device_sync_total_ms", "ms", gcore::rt::MetricBetter::Lower,
+                  total_sync_ns / 1e6);
+  manifest.status = "OK";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
   std::cout << "STATUS=OK\n";
 
   return 0;
@@ -1,3 +1,5 @@
+#include "gcore/rt/run_manifest.hpp"
+
 #include <algorithm>
 #include <chrono>
 #include <cmath>
@@ -182,6 +184,15 @@ int main(int argc, char **argv) {
   std::cout << "rows=" << rows << " cols=" << cols << " iters=" << iters
             << " mode=" << mode << "\n";
 
+  auto manifest = gcore::rt::RunManifest::collect(
+      "llm_primitives_bench", argc, argv, GRETA_BUILD_FEATURES);
+  manifest.param("rows", rows);
+  manifest.param("cols", cols);
+  manifest.param("iters", iters);
+  manifest.param("eps", eps);
+  manifest.param("mode", mode);
+  manifest.param("seed", seed);
+
   std::mt19937 rng(seed);
   std::uniform_real_distribution<float> dist(-1.f, 1.f);
 
@@ -207,6 +218,8 @@ int main(int argc, char **argv) {
       samples.push_back(ms);
     }
     Stats st = compute_stats(samples);
+    manifest.metric(name + "_ms", "ms", gcore::rt::MetricBetter::Lower,
+                    samples);
 
     double a = 0.0, b = 0.0;
     bool ok = check_fn(a, b);
@@ -257,6 +270,11 @@ int main(int argc, char **argv) {
     run_bench("softmax", fn, check);
   }
 
+  manifest.status = all_ok ? "OK" : "FAILED";
+  std::string err;
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
   if (all_ok) {
     std::cout << "STATUS=OK\n";
     return 0;
@@ -0,0 +1,75 @@
+// greta_manifest_diff: compare two run manifests (see run_manifest.hpp).
+// Exit status: 0 no regression, 1 at least one significant regression,
+// 2 usage or read error.
+#include "gcore/rt/run_manifest.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace gcore::rt;
+
+static void usage(const char *prog) {
+  std::cerr << "Usage: " << prog
+            << " [--alpha A] [--min-rel R] <base.json> <candidate.json>\n"
+            << "  --alpha A    significance level of Welch's t-test "
+               "(default 0.05)\n"
+            << "  --min-rel R  smallest relative change reported "
+               "(default 0.02 = 2%)\n";
+}
+
+static bool parse_double(const char *s, double *out) {
+  char *end = nullptr;
+  const double v = std::strtod(s, &end);
+  if (!s[0] || *end || !(v >= 0.0))
+    return false;
+  *out = v;
+  return true;
+}
+
+int main(int argc, char **argv) {
+  CompareOptions opt;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    const char *a = argv[i];
+    if ((!std::strcmp(a, "--alpha") || !std::strcmp(a, "--min-rel")) &&
+        i + 1 < argc) {
+      double *dst = a[2] == 'a' ? &opt.alpha : &opt.min_rel;
+      if (!parse_double(argv[++i], dst)) {
+        std::cerr << "Invalid value for " << a << ": " << argv[i] << "\n";
+        return 2;
+      }
+    } else if (!std::strcmp(a, "--help") || !std::strcmp(a, "-h")) {
+      usage(argv[0]);
+      return 0;
+    } else if (a[0] == '-' && a[1]) {
+      std::cerr << "Unknown option: " << a << "\n";
+      usage(argv[0]);
+      return 2;
+    } else {
+      files.push_back(a);
+    }
+  }
+  if (files.size() != 2) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  RunManifest base, cand;
+  std::string err;
+  if (!RunManifest::load(files[0], &base, &err) ||
+      !RunManifest::load(files[1], &cand, &err)) {
+    std::cerr << "Error: " << err << "\n";
+    return 2;
+  }
+
+  const ManifestDiff diff = compare_manifests(base, cand, opt);
+  std::cout << "base: " << files[0] << " (" << base.tool << ", "
+            << base.started_utc << ")\n"
+            << "cand: " << files[1] << " (" << cand.tool << ", "
+            << cand.started_utc << ")\n"
+            << diff.to_text();
+  return diff.regressions() ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+#include "gcore/rt/metrics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace gcore::rt;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+static bool contains(const std::string &hay, const std::string &needle) {
+  return hay.find(needle) != std::string::npos;
+}
+
+static std::string read_file(const std::string &path) {
+  std::ifstream f(path);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+static void fill(MetricsRegistry &reg) {
+  reg.counter("req_total", {{"route", "decode"}}, "Requests").inc(3);
+  reg.counter("req_total", {{"route", "prefill"}}).inc(1);
+  reg.gauge("queue_depth", {}, "Queued items").set(-2);
+  Histogram &h = reg.histogram("lat_ns", {{"q", "a\"b"}});
+  for (uint64_t v = 1; v <= 1000; ++v)
+    h.record(v);
+}
+
+int main() {
+  std::cout << "GRETA CORE: metrics_test\n";
+  const std::string dir = "/tmp/greta_metrics_test_" + std::to_string(getpid());
+  std::string cmd = "mkdir -p " + dir;
+  check(std::system(cmd.c_str()) == 0, "mkdir");
+
+  // Get-or-create, ordering and exporters.
+  {
+    MetricsRegistry reg;
+    fill(reg);
+    check(&reg.counter("req_total", {{"route", "decode"}}) ==
+              &reg.counter("req_total", {{"route", "decode"}}),
+          "same name+labels gives the same metric");
+    auto snap = reg.snapshot();
+    check(snap.size() == 4, "snapshot size");
+    check(snap.size() == 4 && snap[0].name == "lat_ns" &&
+              snap[1].name == "queue_depth" && snap[2].name == "req_total" &&
+              snap[2].labels[0].second == "decode",
+          "snapshot sorted by name, labels");
+
+    const std::string prom = to_prometheus(snap);
+    check(contains(prom, "# HELP req_total Requests\n# TYPE req_total counter\n"
+                         "req_total{route=\"decode\"} 3\n"
+                         "req_total{route=\"prefill\"} 1\n"),
+          "prometheus counter family");
+    check(contains(prom, "queue_depth -2\n"), "prometheus gauge");
+    check(contains(prom, "lat_ns_bucket{q=\"a\\\"b\",le=\"1023\"} 1000\n"),
+          "prometheus histogram bucket + label escaping");
+    check(contains(prom, "lat_ns_bucket{q=\"a\\\"b\",le=\"15\"} 15\n"),
+          "prometheus exact low bucket");
+    check(contains(prom, "lat_ns_sum{q=\"a\\\"b\"} 500500\n") &&
+              contains(prom, "lat_ns_count{q=\"a\\\"b\"} 1000\n"),
+          "prometheus histogram sum/count");
+
+    const std::string json = to_json(snap);
+    check(contains(json, "{\"name\":\"req_total\",\"type\":\"counter\","
+                         "\"labels\":{\"route\":\"decode\"},"
+                         "\"help\":\"Requests\",\"value\":3}"),
+          "json counter");
+    check(contains(json, "\"labels\":{\"q\":\"a\\\"b\"}"), "json escaping");
+    check(contains(json, "\"count\":1000,\"sum\":500500,\"min\":1,"
+                         "\"max\":1000"),
+          "json histogram");
+  }
+
+  // Registration, updates and snapshots from several threads at once.
+  {
+    MetricsRegistry reg;
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < 2000; ++i) {
+          reg.counter("c", {{"k", std::to_string(i % 50)}}).inc(1);
+          reg.histogram("h", {{"t", std::to_string(t)}}).record(i);
+        }
+      });
+    std::thread reader([&] {
+      while (!done.load())
+        (void)to_json(reg.snapshot());
+    });
+    for (auto &th : threads)
+      th.join();
+    done = true;
+    reader.join();
+    uint64_t total = 0;
+    std::size_t series = 0;
+    for (const auto &m : reg.snapshot()) {
+      if (m.name == "c") {
+        total += m.counter;
+        ++series;
+      }
+    }
+    check(series == 50 && total == 8000, "concurrent registration");
+  }
+
+  // Flusher to a file.
+  {
+    MetricsRegistry reg;
+    fill(reg);
+    MetricsFlusher fl;
+    MetricsFlushOptions opt;
+    opt.target = dir + "/metrics.prom";
+    opt.interval_ms = 5;
+    opt.registry = &reg;
+    std::string err;
+    check(fl.start(opt, &err), "flusher start");
+    check(!fl.start(opt, &err) && !err.empty(), "double start fails");
+    for (int i = 0; i < 400 && fl.flushes() < 2; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    reg.gauge("queue_depth").set(7);
+    fl.stop();
+    const std::string body = read_file(opt.target);
+    check(fl.flushes() >= 2, "periodic flushes");
+    check(contains(body, "queue_depth 7\n"), "final flush on stop");
+  }
+
+  // Flusher to a Unix socket, configured from the environment.
+  {
+    MetricsRegistry &reg = MetricsRegistry::global();
+    reg.counter("greta_metrics_test_total").inc(42);
+    const std::string sock = dir + "/metrics.sock";
+    const int srv = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, sock.c_str(), sizeof(addr.sun_path) - 1);
+    ::unlink(sock.c_str());
+    check(::bind(srv, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) ==
+                  0 &&
+              ::listen(srv, 4) == 0,
+          "listen");
+    std::string got;
+    std::thread server([&] {
+      const int c = ::accept(srv, nullptr, nullptr);
+      char buf[4096];
+      ssize_t n;
+      while ((n = ::read(c, buf, sizeof(buf))) > 0)
+        got.append(buf, static_cast<std::size_t>(n));
+      ::close(c);
+    });
+    const std::string target = "unix:" + sock;
+    setenv("GRETA_METRICS_OUT", target.c_str(), 1);
+    setenv("GRETA_METRICS_FORMAT", "json", 1);
+    setenv("GRETA_METRICS_INTERVAL_MS", "60000", 1);
+    MetricsFlusher fl;
+    std::string err;
+    check(fl.start_from_env(&err), "start_from_env");
+    fl.stop(); // One flush on stop
+    server.join();
+    ::close(srv);
+    check(fl.failures() == 0, "socket flush succeeded");
+    check(contains(got, "\"name\":\"greta_metrics_test_total\"") &&
+              contains(got, "\"value\":42"),
+          "json over unix socket");
+
+    unsetenv("GRETA_METRICS_OUT");
+    MetricsFlusher off;
+    err = "x";
+    check(!off.start_from_env(&err) && err.empty(), "unset env is a no-op");
+  }
+
+  cmd = "rm -rf " + dir;
+  (void)std::system(cmd.c_str());
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include "gcore/rt/profiler.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace gcore::rt;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+static bool contains(const std::string &hay, const std::string &needle) {
+  return hay.find(needle) != std::string::npos;
+}
+
+static const char *kThreadNames[] = {"t0", "t1", "t2", "t3"};
+
+int main() {
+  std::cout << "GRETA CORE: profiler_test\n";
+
+  // Disabled by default: nothing is recorded.
+  {
+    Profiler p;
+    p.record("op", "noop", 1, 2);
+    check(!p.enabled() && p.events().empty(), "disabled records nothing");
+  }
+
+  // Spans, args and the Chrome trace export.
+  {
+    Profiler p;
+    p.set_enabled(true);
+    p.record("layer", "attention", 2000, 3500, "layer", 7);
+    p.record("layer", "block", 1000, 5000);
+    auto evs = p.events();
+    check(evs.size() == 2 && std::string(evs[0].name) == "block" &&
+              std::string(evs[1].name) == "attention" && evs[1].arg == 7,
+          "events sorted by begin");
+    const std::string json = p.chrome_trace_json();
+    check(contains(json, "{\"name\":\"attention\",\"cat\":\"layer\","
+                         "\"ph\":\"X\",\"ts\":2.000,\"dur\":1.500,"),
+          "complete event with us timestamps");
+    check(contains(json, "\"args\":{\"layer\":7}}"), "span args");
+    check(contains(json, "\"name\":\"process_name\""), "process metadata");
+    check(contains(json, "\"dropped\":0"), "no drops");
+  }
+
+  // A full ring keeps the newest spans and counts the rest as dropped.
+  {
+    Profiler p;
+    p.set_capacity(16);
+    p.set_enabled(true);
+    for (uint64_t i = 0; i < 100; ++i)
+      p.record("op", "x", i, i + 1);
+    auto evs = p.events();
+    check(evs.size() == 16 && evs.front().begin_ns == 84 &&
+              evs.back().begin_ns == 99,
+          "ring keeps newest");
+    check(p.dropped() == 84, "dropped count");
+    p.clear();
+    check(p.events().empty() && p.dropped() == 0, "clear");
+    p.record("op", "y", 500, 501);
+    check(p.events().size() == 1, "record after clear");
+  }
+
+  // Concurrent writers wrapping their rings while a reader exports: every
+  // exported span is intact, and rings outlive their threads.
+  {
+    Profiler p;
+    p.set_capacity(256);
+    p.set_enabled(true);
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> torn{0};
+    std::thread reader([&] {
+      while (!done.load()) {
+        for (const ProfileEvent &e : p.events()) {
+          const int t = static_cast<int>(e.arg);
+          if (t < 0 || t > 3 || e.name != kThreadNames[t] ||
+              e.end_ns != e.begin_ns + 1)
+            torn.fetch_add(1);
+        }
+      }
+    });
+    std::atomic<int> finished{0};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t)
+      writers.emplace_back([&, t] {
+        for (uint64_t i = 1; i <= 50000; ++i)
+          p.record("op", kThreadNames[t], i * 4 + t, i * 4 + t + 1, "t", t);
+        // Stay alive until all have recorded: a finished thread's OS tid
+        // (and so its ring) may be reused by the next one.
+        finished.fetch_add(1);
+        while (finished.load() < 4)
+          std::this_thread::yield();
+      });
+    for (auto &th : writers)
+      th.join();
+    done = true;
+    reader.join();
+    check(torn.load() == 0, "no torn spans");
+    check(p.events().size() == 4 * 256, "spans kept after threads exit");
+    check(p.dropped() == 4 * (50000 - 256), "dropped across threads");
+  }
+
+  // ProfileSpan on the global profiler, configured from the environment.
+  {
+    const std::string path =
+        "/tmp/greta_profiler_test_" + std::to_string(getpid()) + ".json";
+    setenv("GRETA_PROFILE_TRACE", path.c_str(), 1);
+    setenv("GRETA_PROFILE_TRACE_EVENTS", "1000", 1);
+    Profiler &g = Profiler::global();
+    check(g.init_from_env() && g.trace_path() == path, "init_from_env");
+    {
+      ProfileSpan outer("decode", "forward");
+      ProfileSpan inner("layer", "ffn", "layer", 3);
+      check(inner.active(), "span active");
+    }
+    std::string err;
+    check(g.write_chrome_trace(g.trace_path(), &err), "write trace");
+    std::ifstream f(path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    check(contains(ss.str(), "\"name\":\"forward\"") &&
+              contains(ss.str(), "\"args\":{\"layer\":3}"),
+          "trace file");
+    std::remove(path.c_str());
+    g.set_enabled(false);
+    ProfileSpan off("decode", "forward");
+    check(!off.active(), "span inactive when disabled");
+    check(!g.write_chrome_trace("/nonexistent/dir/x.json", &err) &&
+              !err.empty(),
+          "write error reported");
+  }
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
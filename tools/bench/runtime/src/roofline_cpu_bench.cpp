@@ -0,0 +1,391 @@
+// CPU backend for the roofline report: a Llama-style layer stack run with
+// scalar fp32 kernels under the same op spans and analytic costs as
+// BlockScheduler (gemm() charges the open span like GretaCompute::gemm),
+// so the FLOP/byte accounting and the report can be checked off-GPU.
+// Peaks are measured on this core unless --peak-gflops/--peak-gbps are
+// given.
+
+#include "gcore/rt/op_cost.hpp"
+#include "gcore/rt/profiler.hpp"
+#include "gcore/rt/roofline.hpp"
+#include "gcore/rt/run_manifest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace gcore::rt;
+
+static int parse_arg_int(int argc, char **argv, const std::string &key,
+                         int def) {
+  for (int i = 1; i + 1 < argc; i++) {
+    if (argv[i] == key)
+      return std::stoi(argv[i + 1]);
+  }
+  return def;
+}
+
+static double parse_arg_double(int argc, char **argv, const std::string &key,
+                               double def) {
+  for (int i = 1; i + 1 < argc; i++) {
+    if (argv[i] == key)
+      return std::stod(argv[i + 1]);
+  }
+  return def;
+}
+
+static bool has_flag(int argc, char **argv, const std::string &key) {
+  for (int i = 1; i < argc; i++) {
+    if (argv[i] == key)
+      return true;
+  }
+  return false;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+// Independent FMA chains, wide enough for the compiler to vectorize.
+static double measure_peak_gflops() {
+  constexpr int kLanes = 64;
+  constexpr int kIters = 4000000;
+  float acc[kLanes];
+  for (int l = 0; l < kLanes; ++l)
+    acc[l] = static_cast<float>(l) * 1e-3f;
+  const float a = 0.999999f, b = 1e-7f;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int it = 0; it < kIters; ++it) {
+    for (int l = 0; l < kLanes; ++l)
+      acc[l] = acc[l] * a + b;
+  }
+  const double sec = seconds_since(t0);
+  volatile float sink = 0.0f;
+  for (int l = 0; l < kLanes; ++l)
+    sink = sink + acc[l];
+  return 2.0 * kLanes * kIters / sec / 1e9;
+}
+
+// Best of a few scaled copies through buffers larger than the caches.
+static double measure_peak_gbps() {
+  const size_t n = size_t(16) << 20;
+  std::vector<float> src(n, 1.0f), dst(n, 0.0f);
+  double best = 0.0;
+  for (int rep = 0; rep < 5; ++rep) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = src[i] * 1.0001f;
+    best = std::max(best, 2.0 * n * sizeof(float) / seconds_since(t0) / 1e9);
+    std::swap(src, dst);
+  }
+  return best;
+}
+
+// C[MxN] = A[MxK] * B[KxN].
+static void gemm(const float *A, const float *B, float *C, uint32_t M,
+                 uint32_t N, uint32_t K) {
+  ProfileSpan::charge(gemm_cost(M, N, K, 32, 32, 32));
+  for (uint32_t i = 0; i < M; ++i) {
+    float *c = C + static_cast<size_t>(i) * N;
+    std::fill(c, c + N, 0.0f);
+    for (uint32_t k = 0; k < K; ++k) {
+      const float a = A[static_cast<size_t>(i) * K + k];
+      const float *b = B + static_cast<size_t>(k) * N;
+      for (uint32_t j = 0; j < N; ++j)
+        c[j] += a * b[j];
+    }
+  }
+}
+
+static void rmsnorm(const float *x, const float *w, float *y, uint32_t rows,
+                    uint32_t cols, float eps) {
+  for (uint32_t r = 0; r < rows; ++r) {
+    const float *xr = x + static_cast<size_t>(r) * cols;
+    float *yr = y + static_cast<size_t>(r) * cols;
+    float ss = 0.0f;
+    for (uint32_t c = 0; c < cols; ++c)
+      ss += xr[c] * xr[c];
+    const float inv = 1.0f / std::sqrt(ss / cols + eps);
+    for (uint32_t c = 0; c < cols; ++c)
+      yr[c] = xr[c] * inv * w[c];
+  }
+}
+
+static void rope(float *x, uint32_t rows, uint32_t heads, uint32_t head_dim,
+                 uint32_t pos0) {
+  for (uint32_t r = 0; r < rows; ++r) {
+    for (uint32_t h = 0; h < heads; ++h) {
+      float *v = x + (static_cast<size_t>(r) * heads + h) * head_dim;
+      for (uint32_t i = 0; i < head_dim / 2; ++i) {
+        const float theta =
+            (pos0 + r) * std::pow(10000.0f, -2.0f * i / head_dim);
+        const float c = std::cos(theta), s = std::sin(theta);
+        const float a = v[2 * i], b = v[2 * i + 1];
+        v[2 * i] = a * c - b * s;
+        v[2 * i + 1] = a * s + b * c;
+      }
+    }
+  }
+}
+
+// Causal attention of `rows` queries at pos0.. over the cache.
+static void attention(const float *q, const float *cache_k,
+                      const float *cache_v, float *out, uint32_t rows,
+                      uint32_t pos0, uint32_t heads, uint32_t kv_heads,
+                      uint32_t head_dim, std::vector<float> &scores) {
+  const float scale = 1.0f / std::sqrt(static_cast<float>(head_dim));
+  const uint32_t kv_dim = kv_heads * head_dim;
+  for (uint32_t r = 0; r < rows; ++r) {
+    const uint32_t keys = pos0 + r + 1;
+    scores.resize(keys);
+    for (uint32_t h = 0; h < heads; ++h) {
+      const uint32_t kvh = h / (heads / kv_heads);
+      const float *qh = q + (static_cast<size_t>(r) * heads + h) * head_dim;
+      float mx = -INFINITY;
+      for (uint32_t t = 0; t < keys; ++t) {
+        const float *kt =
+            cache_k + static_cast<size_t>(t) * kv_dim + kvh * head_dim;
+        float dot = 0.0f;
+        for (uint32_t d = 0; d < head_dim; ++d)
+          dot += qh[d] * kt[d];
+        scores[t] = dot * scale;
+        mx = std::max(mx, scores[t]);
+      }
+      float sum = 0.0f;
+      for (uint32_t t = 0; t < keys; ++t) {
+        scores[t] = std::exp(scores[t] - mx);
+        sum += scores[t];
+      }
+      float *oh = out + (static_cast<size_t>(r) * heads + h) * head_dim;
+      std::fill(oh, oh + head_dim, 0.0f);
+      for (uint32_t t = 0; t < keys; ++t) {
+        const float p = scores[t] / sum;
+        const float *vt =
+            cache_v + static_cast<size_t>(t) * kv_dim + kvh * head_dim;
+        for (uint32_t d = 0; d < head_dim; ++d)
+          oh[d] += p * vt[d];
+      }
+    }
+  }
+}
+
+struct Layer {
+  std::vector<float> attn_norm, ffn_norm, wq, wk, wv, wo, w1, w3, w2;
+  std::vector<float> cache_k, cache_v;
+};
+
+struct Model {
+  uint32_t D, Hq, Hkv, Dh, kv_dim, hidden, max_seq;
+  std::vector<Layer> layers;
+  std::vector<float> x, norm, q, k, v, attn, gate, up, out, scores;
+
+  void forward(uint32_t pos0, uint32_t S);
+};
+
+static void fill(std::vector<float> &v, size_t n, uint32_t seed, float amp) {
+  v.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    v[i] = amp * (static_cast<float>(seed >> 8) / 16777216.0f - 0.5f);
+  }
+}
+
+// Mirrors BlockScheduler::execute_layer(): same span names and costs.
+void Model::forward(uint32_t pos0, uint32_t S) {
+  for (size_t li = 0; li < layers.size(); ++li) {
+    Layer &L = layers[li];
+    const int64_t l = static_cast<int64_t>(li);
+    {
+      ProfileSpan s("op", "rmsnorm_attn", "layer", l);
+      s.add_cost(rmsnorm_cost(S, D));
+      rmsnorm(x.data(), L.attn_norm.data(), norm.data(), S, D, 1e-5f);
+    }
+    {
+      ProfileSpan s("op", "qkv", "layer", l);
+      gemm(norm.data(), L.wq.data(), q.data(), S, D, D);
+      gemm(norm.data(), L.wk.data(), k.data(), S, kv_dim, D);
+      gemm(norm.data(), L.wv.data(), v.data(), S, kv_dim, D);
+    }
+    {
+      ProfileSpan s("op", "rope", "layer", l);
+      s.add_cost(rope_cost(S, Hq, Dh) + rope_cost(S, Hkv, Dh));
+      rope(q.data(), S, Hq, Dh, pos0);
+      rope(k.data(), S, Hkv, Dh, pos0);
+    }
+    {
+      ProfileSpan s("op", "kv_update", "layer", l);
+      s.add_cost(elementwise_cost(2 * S * kv_dim, 1, 0));
+      std::copy(k.begin(), k.begin() + S * kv_dim,
+                L.cache_k.begin() + static_cast<size_t>(pos0) * kv_dim);
+      std::copy(v.begin(), v.begin() + S * kv_dim,
+                L.cache_v.begin() + static_cast<size_t>(pos0) * kv_dim);
+    }
+    {
+      ProfileSpan s("op", "attention", "layer", l);
+      s.add_cost(attention_cost(S, pos0, Hq, Hkv, Dh));
+      attention(q.data(), L.cache_k.data(), L.cache_v.data(), attn.data(), S,
+                pos0, Hq, Hkv, Dh, scores);
+    }
+    {
+      ProfileSpan s("op", "wo", "layer", l);
+      gemm(attn.data(), L.wo.data(), out.data(), S, D, D);
+    }
+    {
+      ProfileSpan s("op", "residual_attn", "layer", l);
+      s.add_cost(elementwise_cost(S * D, 2, 1));
+      for (uint32_t i = 0; i < S * D; ++i)
+        x[i] += out[i];
+    }
+    {
+      ProfileSpan s("op", "rmsnorm_ffn", "layer", l);
+      s.add_cost(rmsnorm_cost(S, D));
+      rmsnorm(x.data(), L.ffn_norm.data(), norm.data(), S, D, 1e-5f);
+    }
+    {
+      ProfileSpan s("op", "ffn", "layer", l);
+      const uint32_t n = S * hidden;
+      gemm(norm.data(), L.w1.data(), gate.data(), S, hidden, D);
+      gemm(norm.data(), L.w3.data(), up.data(), S, hidden, D);
+      s.add_cost(elementwise_cost(n, 1, 4) + elementwise_cost(n, 2, 1));
+      for (uint32_t i = 0; i < n; ++i)
+        gate[i] = gate[i] / (1.0f + std::exp(-gate[i])) * up[i];
+      gemm(gate.data(), L.w2.data(), out.data(), S, D, hidden);
+    }
+    {
+      ProfileSpan s("op", "residual_ffn", "layer", l);
+      s.add_cost(elementwise_cost(S * D, 2, 1));
+      for (uint32_t i = 0; i < S * D; ++i)
+        x[i] += out[i];
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  const uint32_t D = parse_arg_int(argc, argv, "--dim", 512);
+  const uint32_t Hq = parse_arg_int(argc, argv, "--heads", 8);
+  const uint32_t Hkv = parse_arg_int(argc, argv, "--kv-heads", Hq);
+  const uint32_t hidden = parse_arg_int(argc, argv, "--hidden", 1408);
+  const uint32_t n_layers = parse_arg_int(argc, argv, "--layers", 2);
+  const uint32_t prompt = parse_arg_int(argc, argv, "--prompt", 64);
+  const uint32_t decode = parse_arg_int(argc, argv, "--decode", 16);
+  const bool json = has_flag(argc, argv, "--json");
+
+  std::cout << "GRETA CORE Runtime Bench: roofline_cpu_bench\n";
+  if (D == 0 || Hq == 0 || Hkv == 0 || D % Hq || Hq % Hkv || (D / Hq) % 2 ||
+      prompt == 0) {
+    std::cout << "invalid shape: dim % heads, heads % kv-heads and an even "
+                 "head_dim are required, prompt > 0\n";
+    std::cout << "STATUS=FAILED\n";
+    return 1;
+  }
+
+  RooflinePeaks peaks;
+  peaks.gflops = parse_arg_double(argc, argv, "--peak-gflops", 0.0);
+  peaks.gbps = parse_arg_double(argc, argv, "--peak-gbps", 0.0);
+  if (peaks.gflops <= 0.0)
+    peaks.gflops = measure_peak_gflops();
+  if (peaks.gbps <= 0.0)
+    peaks.gbps = measure_peak_gbps();
+
+  Model m;
+  m.D = D;
+  m.Hq = Hq;
+  m.Hkv = Hkv;
+  m.Dh = D / Hq;
+  m.kv_dim = Hkv * m.Dh;
+  m.hidden = hidden;
+  m.max_seq = prompt + decode;
+  m.layers.resize(n_layers);
+  uint32_t seed = 1;
+  for (Layer &L : m.layers) {
+    const float wa = 2.0f / std::sqrt(static_cast<float>(D));
+    L.attn_norm.assign(D, 1.0f);
+    L.ffn_norm.assign(D, 1.0f);
+    fill(L.wq, size_t(D) * D, seed++, wa);
+    fill(L.wk, size_t(D) * m.kv_dim, seed++, wa);
+    fill(L.wv, size_t(D) * m.kv_dim, seed++, wa);
+    fill(L.wo, size_t(D) * D, seed++, wa);
+    fill(L.w1, size_t(D) * hidden, seed++, wa);
+    fill(L.w3, size_t(D) * hidden, seed++, wa);
+    fill(L.w2, size_t(hidden) * D, seed++,
+         2.0f / std::sqrt(static_cast<float>(hidden)));
+    L.cache_k.assign(size_t(m.max_seq) * m.kv_dim, 0.0f);
+    L.cache_v.assign(size_t(m.max_seq) * m.kv_dim, 0.0f);
+  }
+  const size_t rows = prompt;
+  fill(m.x, rows * D, 99, 1.0f);
+  m.norm.resize(rows * D);
+  m.q.resize(rows * D);
+  m.k.resize(rows * m.kv_dim);
+  m.v.resize(rows * m.kv_dim);
+  m.attn.resize(rows * D);
+  m.gate.resize(rows * hidden);
+  m.up.resize(rows * hidden);
+  m.out.resize(rows * D);
+
+  std::cout << "dim=" << D << " heads=" << Hq << " kv_heads=" << Hkv
+            << " hidden=" << hidden << " layers=" << n_layers
+            << " prompt=" << prompt << " decode=" << decode << "\n";
+
+  auto manifest = RunManifest::collect("roofline_cpu_bench", argc, argv,
+                                       GRETA_BUILD_FEATURES);
+  manifest.param("dim", D);
+  manifest.param("heads", Hq);
+  manifest.param("kv_heads", Hkv);
+  manifest.param("hidden", hidden);
+  manifest.param("layers", n_layers);
+  manifest.param("prompt", prompt);
+  manifest.param("decode", decode);
+  manifest.metric("peak_gflops", "GFLOP/s", MetricBetter::Higher, peaks.gflops);
+  manifest.metric("peak_gbps", "GB/s", MetricBetter::Higher, peaks.gbps);
+
+  Profiler &prof = Profiler::global();
+  prof.set_enabled(true);
+  bool ok = true;
+  const uint64_t spans_per_forward = 10ull * n_layers;
+  for (int phase = 0; phase < 2; ++phase) {
+    prof.clear();
+    uint64_t forwards = 0;
+    if (phase == 0) {
+      m.forward(0, prompt);
+      forwards = 1;
+    } else {
+      for (uint32_t t = 0; t < decode; ++t, ++forwards)
+        m.forward(prompt + t, 1);
+    }
+    if (forwards == 0)
+      continue;
+    const RooflineReport rep = RooflineReport::build(prof.events(), peaks);
+    const std::string phase_name = phase == 0 ? "prefill" : "decode";
+    manifest.metric(phase_name + "_ms", "ms", MetricBetter::Lower,
+                    rep.total.ns / 1e6);
+    manifest.metric(phase_name + "_gflops", "GFLOP/s", MetricBetter::Higher,
+                    rep.total.gflops());
+    std::cout << "\n" << (phase == 0 ? "prefill" : "decode") << ":\n"
+              << (json ? rep.to_json() : rep.to_text());
+    // Every op span carries a cost and lands in exactly one layer row.
+    uint64_t layer_calls = 0;
+    for (const auto &r : rep.layers)
+      layer_calls += r.calls;
+    if (rep.total.calls != forwards * spans_per_forward ||
+        layer_calls != rep.total.calls || rep.layers.size() != n_layers) {
+      std::cout << "  accounting mismatch: spans=" << rep.total.calls
+                << " expected=" << forwards * spans_per_forward << "\n";
+      ok = false;
+    }
+  }
+  prof.set_enabled(false);
+
+  manifest.status = ok ? "OK" : "FAILED";
+  std::string err;
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
+  std::cout << "\nSTATUS=" << (ok ? "OK" : "FAILED") << "\n";
+  return ok ? 0 : 1;
+}
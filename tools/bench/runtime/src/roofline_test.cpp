@@ -0,0 +1,250 @@
+#include "gcore/rt/op_cost.hpp"
+#include "gcore/rt/profiler.hpp"
+#include "gcore/rt/roofline.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+using namespace gcore::rt;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+static bool contains(const std::string &hay, const std::string &needle) {
+  return hay.find(needle) != std::string::npos;
+}
+
+static bool near(double a, double b) {
+  return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b));
+}
+
+// Flops of a naive causal attention, counted per (query, key) pair.
+static uint64_t counted_attention_flops(uint64_t rows, uint64_t kv_start,
+                                        uint64_t heads, uint64_t head_dim) {
+  uint64_t flops = 0;
+  for (uint64_t h = 0; h < heads; ++h) {
+    for (uint64_t r = 0; r < rows; ++r) {
+      const uint64_t keys = kv_start + r + 1;
+      for (uint64_t key = 0; key < keys; ++key)
+        flops += 2 * head_dim + 5 + 2 * head_dim; // QK, softmax, PV
+    }
+  }
+  return flops;
+}
+
+static ProfileEvent span(const char *name, uint64_t begin, uint64_t end,
+                         int64_t layer, uint64_t flops, uint64_t bytes) {
+  ProfileEvent e;
+  e.cat = "op";
+  e.name = name;
+  e.arg_name = layer >= 0 ? "layer" : nullptr;
+  e.arg = layer;
+  e.begin_ns = begin;
+  e.end_ns = end;
+  e.cost = {flops, bytes};
+  return e;
+}
+
+int main() {
+  std::cout << "GRETA CORE: roofline_test\n";
+
+  // Analytic counts.
+  {
+    const OpCost g = gemm_cost(1, 4096, 4096, 32, 16, 32);
+    check(g.flops == 2ull * 4096 * 4096, "gemv flops");
+    check(g.bytes == 4096 * 4 + 4096ull * 4096 * 2 + 4096 * 4, "gemv bytes");
+    check(near(g.intensity(), static_cast<double>(g.flops) / g.bytes),
+          "intensity");
+
+    const OpCost q4 = gemm_cost(1, 3, 256, 32, 4.5, 32);
+    check(q4.bytes == 256 * 4 + 3 * 144 + 3 * 4, "Q4_K weights, 144 B/256");
+    check(gemm_cost(1, 3, 1, 32, 4, 32).bytes == 4 + 2 + 12,
+          "odd INT4 count rounds up to a byte");
+
+    check(quant_scale_bytes(4096, 4096, 128, 0) == 4096 * 32 * 4,
+          "group scales");
+    check(quant_scale_bytes(10, 100, 64, 0) == 10 * 2 * 4,
+          "partial last group");
+    check(quant_scale_bytes(4096, 4096, 0, 32) == (1 + 32) * 4,
+          "per-tensor and head scales");
+    const OpCost i8 =
+        gemm_cost(2, 64, 128, 32, 8, 32, quant_scale_bytes(64, 128, 32, 0));
+    check(i8.bytes == 2 * 128 * 4 + 64 * 128 + 2 * 64 * 4 + 64 * 4 * 4,
+          "int8 gemm with scales");
+
+    check(counted_attention_flops(1, 99, 8, 64) ==
+              attention_cost(1, 99, 8, 8, 64).flops,
+          "decode attention flops");
+    check(counted_attention_flops(16, 0, 4, 32) ==
+              attention_cost(16, 0, 4, 4, 32).flops,
+          "causal prefill attention flops");
+    check(counted_attention_flops(8, 24, 4, 32) ==
+              attention_cost(8, 24, 4, 2, 32).flops,
+          "chunked prefill attention flops");
+    check(attention_cost(1, 99, 8, 2, 64).bytes ==
+              (2 * 8 * 64 + 2 * 100 * 2 * 64) * 4,
+          "attention reads K/V once per KV head");
+
+    const OpCost n = rmsnorm_cost(2, 4096);
+    check(n.flops == 4 * 2 * 4096 + 4 && n.bytes == (2 * 2 * 4096 + 4096) * 4,
+          "rmsnorm");
+    check(elementwise_cost(100, 2, 1).bytes == 100 * 3 * 4, "residual add");
+    const OpCost sum = rope_cost(1, 32, 128) + OpCost{1, 2};
+    check(sum.flops == 4 * 32 * 128 + 1 && sum.bytes == 2 * 32 * 128 * 4 + 2,
+          "rope and OpCost sum");
+  }
+
+  // Spans carry their cost into events and the Chrome trace; charge() goes
+  // to the innermost open span only. A CostTally sums every span it sees
+  // close.
+  {
+    Profiler &g = Profiler::global();
+    g.clear();
+    g.set_enabled(true);
+    check(!ProfileSpan::charging(), "nothing to charge outside spans");
+    ProfileSpan::charge({1, 1}); // Dropped
+    CostTally tally;
+    {
+      ProfileSpan block("layer", "block", "layer", 2);
+      {
+        ProfileSpan op("op", "ffn", "layer", 2);
+        check(ProfileSpan::charging(), "charging inside a span");
+        ProfileSpan::charge({100, 40});
+        ProfileSpan::charge({20, 10});
+        op.add_cost({5, 5});
+      }
+      ProfileSpan::charge({7, 3}); // Back to the block span
+      ProfileSpan early("op", "early");
+      early.end();
+      ProfileSpan::charge({1, 1}); // Still the block span
+    }
+    check(!ProfileSpan::charging(), "spans unwound");
+    check(tally.cost().flops == 133 && tally.cost().bytes == 59,
+          "tally sums nested spans");
+    const auto evs = g.events();
+    const ProfileEvent *ffn = nullptr, *block = nullptr, *early = nullptr;
+    for (const auto &e : evs) {
+      const std::string name = e.name;
+      if (name == "ffn")
+        ffn = &e;
+      else if (name == "block")
+        block = &e;
+      else if (name == "early")
+        early = &e;
+    }
+    check(ffn && ffn->cost.flops == 125 && ffn->cost.bytes == 55,
+          "innermost span charged");
+    check(block && block->cost.flops == 8 && block->cost.bytes == 4,
+          "outer span gets charges outside the inner one");
+    check(early && early->cost.empty(), "span without cost");
+    const std::string json = g.chrome_trace_json();
+    check(contains(json, "\"args\":{\"layer\":2,\"flops\":125,\"bytes\":55}"),
+          "cost in span args");
+    check(contains(json, "\"name\":\"early\",\"cat\":\"op\",\"ph\":\"X\"") &&
+              !contains(json, "\"args\":{\"flops\":0"),
+          "no args without cost");
+    g.set_enabled(false);
+    g.clear();
+  }
+
+  // Report: per op and per layer, against known peaks (ridge 10 flop/B).
+  {
+    std::vector<ProfileEvent> evs;
+    // qkv: 2 calls, 1000 ns each, 1e3 flops / 2e3 bytes -> memory bound.
+    evs.push_back(span("qkv", 0, 1000, 0, 1000, 2000));
+    evs.push_back(span("qkv", 5000, 6000, 1, 1000, 2000));
+    // ffn: 40000 flops / 1000 bytes in 1000 ns -> compute bound.
+    evs.push_back(span("ffn", 2000, 3000, 0, 40000, 1000));
+    // No cost: skipped.
+    evs.push_back(span("block", 0, 4000, 0, 0, 0));
+    // No layer arg: only in the op and total rows.
+    evs.push_back(span("lm_head", 7000, 8500, -1, 2000, 4000));
+
+    RooflinePeaks peaks;
+    peaks.gflops = 100.0;
+    peaks.gbps = 10.0;
+    const RooflineReport rep = RooflineReport::build(evs, peaks);
+    check(rep.ops.size() == 3, "op rows");
+    check(rep.ops.size() == 3 && rep.ops[0].name == "qkv" &&
+              rep.ops[0].ns == 2000 && rep.ops[0].calls == 2,
+          "ops sorted by time");
+    if (rep.ops.size() == 3) {
+      const RooflineRow &qkv = rep.ops[0];
+      check(near(qkv.gflops(), 1.0) && near(qkv.gbps(), 2.0), "qkv rates");
+      check(qkv.memory_bound(peaks) && near(qkv.roofline_pct(peaks), 20.0),
+            "qkv: 2 of 10 GB/s");
+      check(near(qkv.attainable_gflops(peaks), 5.0), "qkv attainable");
+      const RooflineRow &ffn =
+          rep.ops[1].name == "ffn" ? rep.ops[1] : rep.ops[2];
+      check(!ffn.memory_bound(peaks) && near(ffn.roofline_pct(peaks), 40.0),
+            "ffn: 40 of 100 GFLOP/s");
+    }
+    check(rep.layers.size() == 2 && rep.layers[0].layer == 0 &&
+              rep.layers[0].cost.flops == 41000 && rep.layers[1].layer == 1 &&
+              rep.layers[1].ns == 1000,
+          "layer rows");
+    check(rep.total.calls == 4 && rep.total.cost.flops == 44000 &&
+              rep.total.ns == 4500,
+          "total row");
+
+    const std::string text = rep.to_text();
+    check(contains(text, "ridge 10.00 flop/B") && contains(text, "memory") &&
+              contains(text, "compute"),
+          "text report");
+    const std::string json = rep.to_json();
+    check(contains(json, "{\"op\":\"qkv\",\"calls\":2,\"ns\":2000,"
+                         "\"flops\":2000,\"bytes\":4000,\"gflops\":1.000,"
+                         "\"gbps\":2.000,\"intensity\":0.5000,"
+                         "\"roofline_pct\":20.00,\"bound\":\"memory\"}"),
+          "json op row");
+    check(contains(json, "{\"layer\":1,"), "json layer row");
+
+    const RooflineReport unknown = RooflineReport::build(evs, {});
+    check(!contains(unknown.to_json(), "roofline_pct") &&
+              contains(unknown.to_text(), "peaks unknown") &&
+              !unknown.ops[0].memory_bound(unknown.peaks),
+          "no bound without peaks");
+
+    const std::string path =
+        "/tmp/greta_roofline_test_" + std::to_string(getpid()) + ".json";
+    std::string err;
+    check(rep.write(path, &err), "write report");
+    std::ifstream f(path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    check(ss.str() == json, "json file for .json path");
+    std::remove(path.c_str());
+    check(!rep.write("/nonexistent/dir/r.txt", &err) &&
+              contains(err, "/nonexistent/dir/r.txt"),
+          "write error");
+  }
+
+  // Peaks from the environment.
+  {
+    setenv("GRETA_ROOFLINE_PEAK_GFLOPS", "383000", 1);
+    setenv("GRETA_ROOFLINE_PEAK_GBPS", "-5", 1);
+    const RooflinePeaks p = RooflinePeaks::from_env();
+    check(near(p.gflops, 383000.0) && p.gbps == 0.0 && !p.known(),
+          "peaks from env");
+  }
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
@@ -0,0 +1,321 @@
+#include "gcore/rt/run_manifest.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+using namespace gcore::rt;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+static bool contains(const std::string &hay, const std::string &needle) {
+  return hay.find(needle) != std::string::npos;
+}
+
+static bool near(double a, double b, double tol) {
+  return std::fabs(a - b) <= tol;
+}
+
+static RunManifest sample_manifest(const std::vector<double> &lat,
+                                   const std::vector<double> &tput) {
+  const char *argv[] = {"bench", "--n", "4096"};
+  RunManifest m = RunManifest::collect("bench", 3, argv, GRETA_BUILD_FEATURES);
+  m.param("n", 4096);
+  m.param("mode", "tiled");
+  m.metric("latency", "ms", MetricBetter::Lower, lat);
+  m.metric("throughput", "GB/s", MetricBetter::Higher, tput);
+  m.status = "OK";
+  return m;
+}
+
+static const MetricDelta *delta(const ManifestDiff &d, const char *name) {
+  for (const auto &m : d.metrics)
+    if (m.name == name)
+      return &m;
+  return nullptr;
+}
+
+int main() {
+  std::cout << "GRETA CORE: run_manifest_test\n";
+  std::string err;
+
+  // Collection: host, build and environment.
+  {
+    setenv("GRETA_TEST_KNOB", "7", 1);
+    setenv("GRETA_MANIFEST_OUT", "/tmp/ignored", 1);
+    setenv("GRETA_SOMETHING_OUT", "/tmp/ignored", 1);
+    setenv("HIP_VISIBLE_DEVICES", "1", 1);
+    setenv("UNRELATED_VAR", "x", 1);
+    const char *argv[] = {"tool", "--flag"};
+    const RunManifest m =
+        RunManifest::collect("tool", 2, argv, GRETA_BUILD_FEATURES);
+    check(m.tool == "tool" && m.argv.size() == 2 && m.argv[1] == "--flag",
+          "argv");
+    check(m.started_utc.size() == 20 && m.started_utc.back() == 'Z',
+          "ISO 8601 start time");
+    check(!m.build.git_sha.empty() && !m.build.compiler.empty(), "build");
+    check(contains(m.build.flags, "optimized") ||
+              contains(m.build.flags, "unoptimized"),
+          "caller build features");
+    check(m.host.logical_cpus > 0 && m.host.affinity_cpus > 0 &&
+              m.host.affinity_cpus <= m.host.logical_cpus,
+          "cpu counts");
+    check(m.threads == m.host.affinity_cpus, "threads default to affinity");
+    check(!m.host.os.empty() && !m.host.arch.empty(), "uname");
+    check(m.env.count("GRETA_TEST_KNOB") && m.env.at("GRETA_TEST_KNOB") == "7",
+          "GRETA_ env captured");
+    check(m.env.count("HIP_VISIBLE_DEVICES") == 1, "GPU visibility captured");
+    check(!m.env.count("GRETA_MANIFEST_OUT") &&
+              !m.env.count("GRETA_SOMETHING_OUT"),
+          "output paths not captured");
+    check(!m.env.count("UNRELATED_VAR"), "other env not captured");
+    unsetenv("GRETA_TEST_KNOB");
+    unsetenv("GRETA_SOMETHING_OUT");
+    unsetenv("HIP_VISIBLE_DEVICES");
+    unsetenv("UNRELATED_VAR");
+  }
+
+  // Metric statistics.
+  {
+    ManifestMetric mm;
+    mm.samples = {4.0, 1.0, 3.0, 2.0};
+    check(near(mm.mean(), 2.5, 1e-12), "mean");
+    check(near(mm.stddev(), std::sqrt(5.0 / 3.0), 1e-12), "sample stddev");
+    check(near(mm.percentile(50), 2.5, 1e-12), "median interpolates");
+    check(mm.percentile(0) == 1.0 && mm.percentile(100) == 4.0,
+          "percentile bounds");
+    mm.samples = {3.0};
+    check(mm.stddev() == 0.0, "stddev of one sample");
+  }
+
+  // JSON round trip, including escaping and non-finite samples.
+  {
+    RunManifest m = sample_manifest({1.0, 1.5, 2.25}, {10.0, 11.0});
+    m.param("label", "quote\" back\\slash\nnewline\ttab\x01");
+    m.metric("odd", "", MetricBetter::Lower, {NAN, 1e-7, 123456789.125});
+    m.metric("latency", "us", MetricBetter::Lower, {5.0, 6.0}); // Replaces
+    const std::string json = m.to_json();
+    RunManifest back;
+    check(RunManifest::from_json(json, &back, &err), "parse own output");
+    check(back.tool == m.tool && back.started_utc == m.started_utc &&
+              back.status == "OK" && back.argv == m.argv,
+          "top-level fields");
+    check(back.build.git_sha == m.build.git_sha &&
+              back.build.flags == m.build.flags &&
+              back.build.compiler == m.build.compiler,
+          "build fields");
+    check(back.host.cpu_model == m.host.cpu_model &&
+              back.host.cpu_flags == m.host.cpu_flags &&
+              back.host.numa_nodes == m.host.numa_nodes &&
+              back.host.logical_cpus == m.host.logical_cpus &&
+              back.host.mem_total_kb == m.host.mem_total_kb,
+          "host fields");
+    check(back.threads == m.threads && back.env == m.env &&
+              back.params == m.params,
+          "env and params");
+    check(back.params.at("label") == m.params.at("label"), "string escaping");
+    check(back.metrics.size() == 3 && back.metrics[0].name == "latency" &&
+              back.metrics[0].unit == "us" &&
+              back.metrics[0].samples == std::vector<double>{5.0, 6.0},
+          "metric replaced in place");
+    check(back.metrics[1].better == MetricBetter::Higher, "better");
+    const ManifestMetric *odd = back.find("odd");
+    check(odd && odd->samples.size() == 3 && std::isnan(odd->samples[0]) &&
+              odd->samples[1] == 1e-7 && odd->samples[2] == 123456789.125,
+          "number formatting round trip");
+    check(contains(json, "\"n\": 4096") || contains(json, "\"4096\""),
+          "integral params have no decimals");
+    check(back.to_json() == json, "stable serialization");
+  }
+
+  // Malformed input.
+  {
+    RunManifest out;
+    check(!RunManifest::from_json("", &out, &err), "empty input");
+    check(!RunManifest::from_json("{\"version\": 1,", &out, &err) &&
+              contains(err, "offset"),
+          "truncated input");
+    check(!RunManifest::from_json("[1, 2]", &out, &err) &&
+              contains(err, "not a JSON object"),
+          "not an object");
+    check(!RunManifest::from_json("{\"version\": 99}", &out, &err) &&
+              contains(err, "version"),
+          "future version rejected");
+    check(!RunManifest::from_json("{\"version\": 1} x", &out, &err) &&
+              contains(err, "trailing"),
+          "trailing data");
+    std::string deep(200, '[');
+    check(!RunManifest::from_json(deep, &out, &err) &&
+              contains(err, "too deep"),
+          "nesting limit");
+    check(RunManifest::from_json("{\"version\": 1}", &out, &err) &&
+              out.metrics.empty(),
+          "minimal manifest");
+  }
+
+  // Welch's t-test against reference values.
+  {
+    // t = 2 with 10 degrees of freedom: p = 0.0734.
+    const std::vector<double> a = {1, 2, 3, 4, 5, 6};
+    std::vector<double> b;
+    const double shift = 2.0 * std::sqrt(2.0 * 3.5 / 6.0);
+    for (double v : a)
+      b.push_back(v + shift);
+    check(near(welch_p_value(a, b), 0.07339, 2e-4), "p-value t=2 df=10");
+    check(near(welch_p_value(a, a), 1.0, 1e-12), "identical samples");
+    check(welch_p_value({1.0, 1.0}, {2.0, 2.0}) == 0.0,
+          "zero variance, different means");
+    check(welch_p_value({1.0, 1.0}, {1.0, 1.0}) == 1.0,
+          "zero variance, same means");
+    check(welch_p_value({1.0}, {2.0, 3.0}) == 1.0, "too few samples");
+    // Far apart with unequal variances and sizes.
+    check(welch_p_value({10, 11, 10.5, 10.2, 10.8}, {20, 25, 22}) < 0.05,
+          "clear difference");
+  }
+
+  // Comparator verdicts.
+  {
+    const RunManifest base = sample_manifest(
+        {10.0, 10.2, 9.9, 10.1, 10.0, 9.8}, {100, 101, 99, 100, 102, 98});
+    RunManifest same = sample_manifest({10.1, 9.9, 10.0, 10.2, 9.9, 10.0},
+                                       {99, 100, 101, 100, 98, 102});
+    ManifestDiff d = compare_manifests(base, same);
+    check(d.regressions() == 0 && d.count(MetricVerdict::Same) == 2,
+          "noise is not a regression");
+
+    // Latency up 20%, throughput down 20%: both regress.
+    RunManifest slow = sample_manifest({12.0, 12.2, 11.9, 12.1, 12.0, 11.8},
+                                       {80, 81, 79, 80, 82, 78});
+    d = compare_manifests(base, slow);
+    const MetricDelta *lat = delta(d, "latency");
+    const MetricDelta *tput = delta(d, "throughput");
+    check(lat && lat->verdict == MetricVerdict::Regressed &&
+              near(lat->rel, 0.2, 1e-3) && lat->p_value < 1e-6,
+          "lower-is-better regression");
+    check(tput && tput->verdict == MetricVerdict::Regressed &&
+              near(tput->rel, -0.2, 1e-3),
+          "higher-is-better regression");
+    check(d.regressions() == 2, "regression count");
+    // Swapped, the same differences are improvements.
+    d = compare_manifests(slow, base);
+    check(d.count(MetricVerdict::Improved) == 2 && d.regressions() == 0,
+          "improvements");
+
+    // Significant but below min_rel: same.
+    RunManifest tiny = sample_manifest(
+        {10.1, 10.3, 10.0, 10.2, 10.1, 9.9}, {100, 101, 99, 100, 102, 98});
+    d = compare_manifests(base, tiny);
+    check(delta(d, "latency")->verdict == MetricVerdict::Same,
+          "below min_rel");
+    CompareOptions strict;
+    strict.min_rel = 0.0;
+    strict.alpha = 0.5;
+    d = compare_manifests(base, tiny, strict);
+    check(delta(d, "latency")->verdict == MetricVerdict::Regressed,
+          "options honored");
+
+    // One sample per side: cannot test, only flag.
+    RunManifest one_a = sample_manifest({10.0}, {100});
+    RunManifest one_b = sample_manifest({13.0}, {100.5});
+    d = compare_manifests(one_a, one_b);
+    check(delta(d, "latency")->verdict == MetricVerdict::Unverified &&
+              delta(d, "throughput")->verdict == MetricVerdict::Same,
+          "single samples");
+
+    // Added / removed metrics, context differences.
+    RunManifest other = sample_manifest({10.0, 10.1}, {100, 100});
+    other.metrics.erase(other.metrics.begin() + 1);
+    other.metric("new_metric", "ms", MetricBetter::Lower, 1.0);
+    other.param("mode", "naive");
+    other.env["GRETA_EXTRA"] = "1";
+    other.build.git_sha = "feedface";
+    other.threads = base.threads + 3;
+    d = compare_manifests(base, other);
+    check(delta(d, "throughput")->verdict == MetricVerdict::Removed &&
+              delta(d, "new_metric")->verdict == MetricVerdict::Added &&
+              d.metrics.back().name == "new_metric",
+          "added and removed metrics");
+    bool mode = false, env = false, sha = false, threads = false;
+    for (const auto &c : d.context) {
+      mode = mode || c == "params.mode: tiled -> naive";
+      env = env || c == "env.GRETA_EXTRA: (unset) -> 1";
+      sha = sha || contains(c, "build.git_sha:");
+      threads = threads || contains(c, "threads:");
+    }
+    check(mode && env && sha && threads, "context differences");
+
+    const std::string text = compare_manifests(base, slow).to_text();
+    check(contains(text, "2 regressed") && contains(text, "REGRESSED") &&
+              contains(text, "+20.0%") && contains(text, "latency"),
+          "text report");
+  }
+
+  // write / load / emit.
+  {
+    const std::string dir =
+        "/tmp/greta_run_manifest_test_" + std::to_string(getpid());
+    const RunManifest m = sample_manifest({1.0, 2.0}, {3.0, 4.0});
+    const std::string file = dir + ".json";
+    RunManifest back;
+    check(m.write(file, &err) && RunManifest::load(file, &back, &err) &&
+              back.to_json() == m.to_json(),
+          "write and load");
+    std::remove(file.c_str());
+    check(!RunManifest::load("/nonexistent/m.json", &back, &err) &&
+              contains(err, "/nonexistent/m.json"),
+          "load error");
+    check(!m.write("/nonexistent/dir/m.json", &err) &&
+              contains(err, "/nonexistent/dir/m.json"),
+          "write error");
+
+    unsetenv("GRETA_MANIFEST_OUT");
+    check(m.output_path().empty() && m.emit(&err), "no output, no-op");
+
+    setenv("GRETA_MANIFEST_OUT", (dir + "/").c_str(), 1);
+    check(m.output_path() == dir + "/", "path from env");
+    check(m.emit(&err), "emit into a new directory");
+    DIR *d = opendir(dir.c_str());
+    std::string written;
+    if (d) {
+      while (dirent *e = readdir(d))
+        if (std::string(e->d_name).rfind("bench-", 0) == 0)
+          written = dir + "/" + e->d_name;
+      closedir(d);
+    }
+    check(contains(written, "-" + std::to_string(getpid()) + ".json") &&
+              RunManifest::load(written, &back, &err) &&
+              back.find("latency"),
+          "emitted file name and content");
+    std::remove(written.c_str());
+    rmdir(dir.c_str());
+
+    const char *argv[] = {"bench", "--manifest", "/tmp/a.json"};
+    const RunManifest flag = RunManifest::collect("bench", 3, argv, "");
+    check(flag.output_path() == "/tmp/a.json", "--manifest beats the env");
+    const char *argv_eq[] = {"bench", "--manifest=/tmp/b.json"};
+    check(RunManifest::collect("bench", 2, argv_eq, "").output_path() ==
+              "/tmp/b.json",
+          "--manifest=path");
+    unsetenv("GRETA_MANIFEST_OUT");
+  }
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
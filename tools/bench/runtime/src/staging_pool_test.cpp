@@ -0,0 +1,132 @@
+#include "gcore/rt/staging_pool.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using gcore::rt::CpuStagingBackend;
+using gcore::rt::StagingBuffer;
+using gcore::rt::StagingCopyKind;
+using gcore::rt::StagingPool;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+static std::vector<uint8_t> random_bytes(std::size_t n, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> v(n);
+  for (auto &b : v)
+    b = static_cast<uint8_t>(rng());
+  return v;
+}
+
+int main() {
+  std::cout << "GRETA CORE: staging_pool_test\n";
+  constexpr std::size_t MiB = std::size_t{1} << 20;
+  std::string err;
+
+  CpuStagingBackend backend;
+  CpuStagingBackend::Stream stream;
+
+  {
+    // 8 MiB budget, 1 MiB chunks: a 10 MiB upload has to recycle buffers
+    // while earlier chunks are still queued.
+    StagingPool pool(&backend, 8 * MiB, 1 * MiB);
+    const auto src = random_bytes(10 * MiB + 123, 1);
+    std::vector<uint8_t> device(src.size(), 0);
+
+    check(pool.upload(device.data(), src.data(), src.size(), &stream, &err),
+          "upload");
+    check(stream.executed > 0, "budget forced queued copies to complete");
+    check(pool.stats().stalls > 0, "upload stalled on the budget");
+    check(pool.stats().bytes_pinned <= 8 * MiB, "pinned bytes within budget");
+    backend.sync(&stream, &err);
+    check(device == src, "uploaded bytes match");
+
+    // Download reuses the idle buffers left by the upload.
+    const auto hits_before = pool.stats().reuse_hits;
+    std::vector<uint8_t> host(3 * MiB + 77, 0);
+    std::memcpy(device.data(), src.data() + 5, host.size());
+    check(pool.download(host.data(), device.data(), host.size(), &stream, &err),
+          "download");
+    check(std::memcmp(host.data(), src.data() + 5, host.size()) == 0,
+          "downloaded bytes match");
+    check(pool.stats().reuse_hits > hits_before, "download reused buffers");
+
+    // Async download: data lands only after wait().
+    StagingBuffer *buf =
+        pool.download_async(device.data(), 4096, &stream, &err);
+    check(buf != nullptr, "download_async");
+    if (buf) {
+      check(pool.wait(buf, &err), "wait");
+      check(std::memcmp(buf->data, device.data(), 4096) == 0,
+            "async download bytes match");
+      pool.release(buf);
+    }
+
+    // Copies from pageable memory are rejected by the backend.
+    std::vector<uint8_t> pageable(4096);
+    check(!backend.copy_async(device.data(), pageable.data(), pageable.size(),
+                              StagingCopyKind::HostToDevice, &stream, &err),
+          "unpinned copy rejected");
+
+    // Size classes round up to powers of two from 64 KiB.
+    StagingBuffer *small = pool.acquire(1, &err);
+    StagingBuffer *odd = pool.acquire(3 * MiB / 2, &err);
+    check(small && small->capacity == StagingPool::kMinClassBytes,
+          "smallest class is 64 KiB");
+    check(odd && odd->capacity == 2 * MiB, "1.5 MiB rounds to 2 MiB");
+    check(small && reinterpret_cast<uintptr_t>(small->data) % 4096 == 0,
+          "page aligned");
+    pool.release(small);
+    pool.release(odd);
+
+    pool.trim();
+    check(pool.stats().bytes_pinned == 0, "trim unpins idle buffers");
+    check(backend.pinned_ranges() == 0, "no pinned ranges after trim");
+  }
+
+  {
+    // Concurrent uploads on the (synchronous) null stream.
+    StagingPool pool(&backend, 4 * MiB, 256 << 10);
+    constexpr int kThreads = 4;
+    std::vector<std::thread> threads;
+    std::vector<int> ok(kThreads, 0);
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        const auto src = random_bytes(MiB + t * 1000, 100 + t);
+        std::vector<uint8_t> device(src.size());
+        bool good = true;
+        for (int round = 0; round < 20 && good; ++round) {
+          std::string e;
+          good = pool.upload(device.data(), src.data(), src.size(), nullptr,
+                             &e) &&
+                 device == src;
+        }
+        ok[t] = good;
+      });
+    }
+    for (auto &th : threads)
+      th.join();
+    for (int t = 0; t < kThreads; ++t)
+      check(ok[t] != 0, "threaded upload");
+  }
+  check(backend.pinned_ranges() == 0, "pool destructor unpins");
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
@@ -1,3 +1,4 @@
+#include "gcore/rt/run_manifest.hpp"
 #include "gcore/rt/stream.hpp"
 
 #include <algorithm>
@@ -6,6 +7,7 @@
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 static int argi(int argc, char **argv, const char *key, int def) {
@@ -18,27 +20,54 @@ static int argi(int argc, char **argv, const char *key, int def) {
 
 int main(int argc, char **argv) {
   const int n = argi(argc, argv, "--n", 500000);
+  const int producers = argi(argc, argv, "--producers", 1);
 
   std::cout << "GRETA CORE Runtime Bench: stream_bench\n";
   std::cout << "n=" << n << "\n";
 
+  auto manifest = gcore::rt::RunManifest::collect("stream_bench", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
+  manifest.param("n", n);
+  manifest.param("producers", producers);
+
   gcore::rt::Stream s;
 
   // Benchmark enqueue+flush where each task is no-op
   std::vector<double> secs;
   secs.reserve(30);
 
+  // Enqueue-side time alone (producer cost, includes waits on a full ring).
+  std::vector<double> enq_secs;
+  enq_secs.reserve(30);
+
   for (int round = 0; round < 30; round++) {
     auto t0 = std::chrono::steady_clock::now();
     for (int i = 0; i < n; i++) {
       s.enqueue([] {});
     }
+    auto te = std::chrono::steady_clock::now();
     s.flush();
     auto t1 = std::chrono::steady_clock::now();
     std::chrono::duration<double> dt = t1 - t0;
+    std::chrono::duration<double> de = te - t0;
     secs.push_back(dt.count());
+    enq_secs.push_back(de.count());
   }
 
+  auto per_task_ns = [&](double s) {
+    return (s * 1e9) / static_cast<double>(n);
+  };
+  auto per_task_samples = [&](const std::vector<double> &v) {
+    std::vector<double> out;
+    for (double s : v)
+      out.push_back(per_task_ns(s));
+    return out;
+  };
+  manifest.metric("ns_per_task", "ns", gcore::rt::MetricBetter::Lower,
+                  per_task_samples(secs));
+  manifest.metric("enqueue_ns_per_task", "ns", gcore::rt::MetricBetter::Lower,
+                  per_task_samples(enq_secs));
+
   std::sort(secs.begin(), secs.end());
   double mean = 0.0;
   for (double v : secs)
@@ -49,10 +78,6 @@ int main(int argc, char **argv) {
   const double p99 = secs[static_cast<size_t>(
       std::min<size_t>(secs.size() - 1, (secs.size() * 99) / 100))];
 
-  auto per_task_ns = [&](double s) {
-    return (s * 1e9) / static_cast<double>(n);
-  };
-
   std::cout << std::fixed << std::setprecision(3);
   std::cout << "RESULT stream_bench:\n";
   std::cout << "  mean_sec=" << mean
@@ -62,6 +87,35 @@ int main(int argc, char **argv) {
   std::cout << "  p99_sec=" << p99 << "   p99_ns_per_task=" << per_task_ns(p99)
             << "\n";
 
+  std::sort(enq_secs.begin(), enq_secs.end());
+  std::cout << "  enqueue_p50_ns_per_task="
+            << per_task_ns(enq_secs[enq_secs.size() / 2]) << "\n";
+
+  // Several producers on one stream (MPSC path).
+  if (producers > 1) {
+    std::vector<double> mp_secs;
+    for (int round = 0; round < 10; round++) {
+      auto t0 = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&] {
+          for (int i = 0; i < n / producers; i++)
+            s.enqueue([] {});
+        });
+      }
+      for (auto &t : threads)
+        t.join();
+      s.flush();
+      auto t1 = std::chrono::steady_clock::now();
+      mp_secs.push_back(std::chrono::duration<double>(t1 - t0).count());
+    }
+    manifest.metric("mp_ns_per_task", "ns", gcore::rt::MetricBetter::Lower,
+                    per_task_samples(mp_secs));
+    std::sort(mp_secs.begin(), mp_secs.end());
+    std::cout << "  producers=" << producers << "  p50_ns_per_task="
+              << per_task_ns(mp_secs[mp_secs.size() / 2]) << "\n";
+  }
+
   // Event overhead sanity test
   gcore::rt::Event a, b;
   a.record(s);
@@ -72,5 +126,9 @@ int main(int argc, char **argv) {
   std::cout << "EVENT sanity:\n";
   std::cout << "  elapsed_ns(a->b)=" << dt << " (should be small, >=0)\n";
 
+  manifest.status = "OK";
+  std::string err;
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
   return 0;
 }
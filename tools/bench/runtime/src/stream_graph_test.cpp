@@ -0,0 +1,122 @@
+#include "gcore/rt/stream.hpp"
+#include "gcore/rt/thread_pool.hpp"
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using gcore::rt::Event;
+using gcore::rt::Stream;
+using gcore::rt::TaskGraph;
+using gcore::rt::ThreadPool;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+// Capture n ordered tasks plus a gate, replay it several times.
+static void replay(Stream &s, const char *mode) {
+  constexpr int kTasks = 1000;
+  constexpr int kLaunches = 5;
+  std::vector<int> seen;
+  seen.reserve(kTasks * kLaunches + 16);
+  int big_calls = 0;
+  std::array<int, 32> payload{}; // Larger than a ring slot
+  payload[31] = 7;
+
+  Event gate;
+  std::string err;
+  check(s.begin_capture(&err), "begin_capture");
+  check(s.capturing(), "capturing()");
+  for (int i = 0; i < kTasks / 2; ++i)
+    s.enqueue([&seen, i] { seen.push_back(i); });
+  s.wait_event(gate);
+  for (int i = kTasks / 2; i < kTasks; ++i)
+    s.enqueue([&seen, i] { seen.push_back(i); });
+  s.enqueue([&big_calls, payload] { big_calls += payload[31] == 7; });
+  TaskGraph g;
+  check(s.end_capture(&g, &err), "end_capture");
+  check(!s.capturing(), "capture ended");
+  s.flush();
+  check(seen.empty(), "nothing runs during capture");
+  check(g.tasks() == kTasks + 1, "graph task count");
+  check(g.segments() == 2, "graph segment count");
+
+  // First launch stops at the gate until it fires.
+  s.launch(g);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  const std::size_t before_gate = seen.size();
+  gate.signal();
+  for (int l = 1; l < kLaunches; ++l)
+    s.launch(g);
+  s.flush();
+
+  bool order = seen.size() == static_cast<std::size_t>(kTasks * kLaunches);
+  for (std::size_t k = 0; order && k < seen.size(); ++k)
+    order = seen[k] == static_cast<int>(k % kTasks);
+  std::cout << "  " << mode << ": before_gate=" << before_gate
+            << " ran=" << seen.size() << " big=" << big_calls << "\n";
+  check(before_gate == kTasks / 2, "replay parks at the captured gate");
+  check(order, "replay runs every task in order");
+  check(big_calls == kLaunches, "large closure replayed");
+}
+
+int main() {
+  std::cout << "GRETA CORE: stream_graph_test\n";
+
+  {
+    Stream s;
+    std::string err;
+    TaskGraph g;
+    check(!s.end_capture(&g, &err) && !err.empty(),
+          "end_capture without begin fails");
+    check(s.begin_capture(&err), "begin_capture");
+    err.clear();
+    check(!s.begin_capture(&err) && !err.empty(), "nested capture fails");
+    check(s.end_capture(&g, &err) && g.empty(), "empty capture");
+    s.launch(g); // No-op
+    s.flush();
+  }
+
+  {
+    Stream s;
+    replay(s, "threads");
+  }
+  {
+    ThreadPool pool(1);
+    Stream s(pool);
+    replay(s, "pool(1)");
+  }
+
+  // Move keeps the closures alive; destroying an abandoned capture is fine.
+  {
+    Stream s;
+    int hits = 0;
+    s.begin_capture();
+    s.enqueue([&hits] { ++hits; });
+    TaskGraph a;
+    s.end_capture(&a);
+    TaskGraph b = std::move(a);
+    check(a.empty() && b.tasks() == 1, "move");
+    s.launch(b);
+    s.flush();
+    check(hits == 1, "moved graph replays");
+    s.begin_capture();
+    s.enqueue([&hits] { ++hits; });
+  }
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
@@ -1,13 +1,18 @@
+#include "gcore/rt/run_manifest.hpp"
 #include "gcore/rt/telemetry.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <time.h>
+
 static int argi(int argc, char **argv, const char *key, int def) {
   for (int i = 1; i + 1 < argc; i++) {
     if (std::string(argv[i]) == key)
@@ -16,12 +21,51 @@ static int argi(int argc, char **argv, const char *key, int def) {
   return def;
 }
 
+static double thread_cpu_sec() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<double>(ts.tv_sec) + 1e-9 * static_cast<double>(ts.tv_nsec);
+}
+
+// `threads` threads run `iters` scopes each against the same sinks. Returns
+// CPU ns per scope (thread CPU time, so the number holds with fewer cores
+// than threads).
+template <class Body>
+static double cpu_ns_per_scope(int threads, int iters, Body body) {
+  std::vector<double> cpu(threads, 0.0);
+  std::atomic<int> ready{0};
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; t++) {
+    pool.emplace_back([&, t] {
+      ready.fetch_add(1);
+      while (ready.load() < threads)
+        std::this_thread::yield();
+      const double c0 = thread_cpu_sec();
+      for (int i = 0; i < iters; i++)
+        body();
+      cpu[t] = thread_cpu_sec() - c0;
+    });
+  }
+  for (auto &th : pool)
+    th.join();
+  double total = 0.0;
+  for (double c : cpu)
+    total += c;
+  return total * 1e9 / (static_cast<double>(threads) * iters);
+}
+
 int main(int argc, char **argv) {
   const int iters = argi(argc, argv, "--iters", 2000000);
+  const int threads_max = argi(argc, argv, "--threads-max", 64);
 
   std::cout << "GRETA CORE Runtime Bench: telemetry_bench\n";
   std::cout << "iters=" << iters << "\n";
 
+  auto manifest = gcore::rt::RunManifest::collect(
+      "telemetry_bench", argc, argv, GRETA_BUILD_FEATURES);
+  manifest.param("iters", iters);
+  manifest.param("threads_max", threads_max);
+
   gcore::rt::Counter c("timer_ns");
 
   // Measure overhead of ScopedTimer in tight loop.
@@ -39,6 +83,18 @@ int main(int argc, char **argv) {
     secs.push_back(dt.count());
   }
 
+  auto ns_per = [&](double s) {
+    return (s * 1e9) / static_cast<double>(iters);
+  };
+  auto ns_per_samples = [&](const std::vector<double> &v) {
+    std::vector<double> out;
+    for (double s : v)
+      out.push_back(ns_per(s));
+    return out;
+  };
+  manifest.metric("ns_per_scope", "ns", gcore::rt::MetricBetter::Lower,
+                  ns_per_samples(secs));
+
   std::sort(secs.begin(), secs.end());
   double mean = 0.0;
   for (double v : secs)
@@ -49,18 +105,67 @@ int main(int argc, char **argv) {
   const double p99 = secs[static_cast<size_t>(
       std::min<size_t>(secs.size() - 1, (secs.size() * 99) / 100))];
 
-  auto ns_per = [&](double s) {
-    return (s * 1e9) / static_cast<double>(iters);
-  };
-
   std::cout << std::fixed << std::setprecision(3);
   std::cout << "RESULT telemetry_bench:\n";
   std::cout << "  mean_ns_per_scope=" << ns_per(mean) << "\n";
   std::cout << "  p50_ns_per_scope=" << ns_per(p50) << "\n";
   std::cout << "  p99_ns_per_scope=" << ns_per(p99) << "\n";
 
+  // Same loop with a latency histogram attached.
+  gcore::rt::Histogram h("timer_ns");
+  {
+    std::vector<double> hs;
+    for (int round = 0; round < 30; round++) {
+      auto t0 = std::chrono::steady_clock::now();
+      for (int i = 0; i < iters; i++) {
+        gcore::rt::ScopedTimer t(c, h);
+      }
+      auto t1 = std::chrono::steady_clock::now();
+      hs.push_back(std::chrono::duration<double>(t1 - t0).count());
+    }
+    manifest.metric("ns_per_scope_with_histogram", "ns",
+                    gcore::rt::MetricBetter::Lower, ns_per_samples(hs));
+    std::sort(hs.begin(), hs.end());
+    std::cout << "  p50_ns_per_scope_with_histogram="
+              << ns_per(hs[hs.size() / 2]) << "\n";
+  }
+
+  // Thread sweep: every thread updates the same Counter/Histogram. The
+  // single-atomic column is the old Counter layout, for comparison.
+  std::cout << "THREAD sweep (cpu ns per scope):\n";
+  const int per_thread = std::max(1, iters / 10);
+  for (int threads = 1; threads <= threads_max; threads *= 2) {
+    gcore::rt::Counter sc("sweep_ns");
+    gcore::rt::Histogram sh("sweep_ns");
+    std::atomic<uint64_t> shared{0};
+    const double sharded = cpu_ns_per_scope(threads, per_thread, [&] {
+      gcore::rt::ScopedTimer t(sc, sh);
+    });
+    const double single = cpu_ns_per_scope(threads, per_thread, [&] {
+      const uint64_t t0 = gcore::rt::now_ns();
+      shared.fetch_add(gcore::rt::now_ns() - t0, std::memory_order_relaxed);
+    });
+    manifest.metric("sharded_cpu_ns_t" + std::to_string(threads), "ns",
+                    gcore::rt::MetricBetter::Lower, sharded);
+    const auto snap = sh.snapshot();
+    std::cout << "  threads=" << threads << "  sharded_timer_hist=" << sharded
+              << "  single_atomic_timer=" << single
+              << "  hist_count=" << snap.count << "\n";
+  }
+
+  const auto snap = h.snapshot();
   std::cout << "COUNTER snapshot:\n";
   std::cout << "  " << c.name() << "=" << c.value() << "\n";
+  std::cout << "HISTOGRAM snapshot:\n";
+  std::cout << "  " << h.name() << " count=" << snap.count
+            << " p50=" << snap.percentile(0.50)
+            << " p99=" << snap.percentile(0.99)
+            << " p999=" << snap.percentile(0.999) << " max=" << snap.max
+            << "\n";
 
+  manifest.status = "OK";
+  std::string err;
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
   return 0;
 }
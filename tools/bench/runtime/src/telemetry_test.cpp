@@ -0,0 +1,99 @@
+#include "gcore/rt/telemetry.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using gcore::rt::Counter;
+using gcore::rt::Histogram;
+
+static int g_failures = 0;
+
+static void check(bool cond, const char *what) {
+  if (!cond) {
+    std::cout << "  FAIL: " << what << "\n";
+    ++g_failures;
+  }
+}
+
+int main() {
+  std::cout << "GRETA CORE: telemetry_test\n";
+
+  // Every value lands in a bucket that contains it; buckets tile the range.
+  {
+    bool ok = true;
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 200000 && ok; ++i) {
+      const uint64_t v = rng() >> (rng() % 64);
+      const std::size_t b = Histogram::bucket_of(v);
+      ok = b < Histogram::kBuckets && Histogram::bucket_low(b) <= v &&
+           v <= Histogram::bucket_high(b);
+    }
+    for (std::size_t b = 1; b < Histogram::kBuckets && ok; ++b)
+      ok = Histogram::bucket_low(b) == Histogram::bucket_high(b - 1) + 1;
+    check(ok, "bucket bounds");
+    check(Histogram::bucket_of(UINT64_MAX) == Histogram::kBuckets - 1,
+          "top bucket");
+  }
+
+  // Empty histogram.
+  {
+    Histogram h("empty");
+    auto s = h.snapshot();
+    check(s.count == 0 && s.min == 0 && s.max == 0 && s.percentile(0.5) == 0,
+          "empty snapshot");
+  }
+
+  // Uniform 1..100000: percentiles within the bucket error.
+  {
+    Histogram h("uniform");
+    for (uint64_t v = 1; v <= 100000; ++v)
+      h.record(v);
+    auto s = h.snapshot();
+    auto near = [](uint64_t got, double want) {
+      return std::fabs(static_cast<double>(got) - want) <= want * 0.0625;
+    };
+    std::cout << "  uniform: p50=" << s.percentile(0.5)
+              << " p99=" << s.percentile(0.99)
+              << " p999=" << s.percentile(0.999) << "\n";
+    check(s.count == 100000 && s.min == 1 && s.max == 100000, "count/min/max");
+    check(s.sum == 100000ull * 100001 / 2, "sum");
+    check(near(s.percentile(0.5), 50000), "p50");
+    check(near(s.percentile(0.99), 99000), "p99");
+    check(near(s.percentile(0.999), 99900), "p999");
+    check(s.percentile(1.0) == 100000, "p100 is max");
+  }
+
+  // Many threads (more than shards): nothing is lost.
+  {
+    constexpr int kThreads = 96;
+    constexpr int kIters = 20000;
+    Counter c("mt");
+    Histogram h("mt");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < kIters; ++i) {
+          c.inc(2);
+          h.record(static_cast<uint64_t>(t));
+        }
+      });
+    for (auto &th : threads)
+      th.join();
+    auto s = h.snapshot();
+    check(c.value() == 2ull * kThreads * kIters, "sharded counter sum");
+    check(s.count == static_cast<uint64_t>(kThreads) * kIters,
+          "histogram count across threads");
+    check(s.min == 0 && s.max == kThreads - 1, "histogram min/max");
+  }
+
+  if (g_failures) {
+    std::cout << "STATUS=FAILED failures=" << g_failures << "\n";
+    return 1;
+  }
+  std::cout << "STATUS=OK\n";
+  return 0;
+}
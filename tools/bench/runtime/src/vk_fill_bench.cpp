@@ -1,5 +1,6 @@
 #include "gcore/rt/vk/backend.hpp"
 #include "gcore/rt/vk/buffer.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <algorithm>
 #include <chrono>
@@ -43,6 +44,8 @@ int main(int argc, char **argv) {
   const uint32_t fill_value = 0xA5A5A5A5u;
 
   std::cout << "GRETA CORE Runtime Bench: vk_fill_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect("vk_fill_bench", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
   std::cout << "size_mb=" << size_mb << " iters=" << iters << "\n";
 
   gcore::rt::vk::Backend b;
@@ -64,6 +67,8 @@ int main(int argc, char **argv) {
   std::cout << "  name=" << info.name << "\n";
   std::cout << "  driver_name=" << info.driver_name << "\n";
   b.print_diagnostics(std::cout);
+  manifest.param("device", info.name);
+  manifest.param("driver", info.driver_name);
 
   if (b.gpu_blacklisted()) {
     std::cout << "SKIPPED: GPU blacklisted: " << b.blacklist_reason() << "\n";
@@ -430,6 +435,21 @@ int main(int argc, char **argv) {
             << "\n";
   std::cout << "  p99_ms=" << (p99 * 1e3) << "   p99_GiBps=" << (gib / p99)
             << "\n";
+
+  manifest.param("size_mb", size_mb);
+  manifest.param("iters", iters);
+  std::vector<double> fill_ms, fill_gibps;
+  for (double s : secs) {
+    fill_ms.push_back(s * 1e3);
+    fill_gibps.push_back(gib / s);
+  }
+  manifest.metric("fill_ms", "ms", gcore::rt::MetricBetter::Lower, fill_ms);
+  manifest.metric("fill_gibps", "GiB/s", gcore::rt::MetricBetter::Higher,
+                  fill_gibps);
+  manifest.status = validation_ok ? "OK" : "FAILED";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
   if (!validation_ok) {
     std::cout << "STATUS=FAILED reason=\"validation_failed\"\n";
   } else {
@@ -1,3 +1,4 @@
+#include "gcore/rt/run_manifest.hpp"
 #include "gcore/rt/vk/backend.hpp"
 #include "vk_autotune.hpp"
 
@@ -93,6 +94,8 @@ int main(int argc, char **argv) {
   }
 
   std::cout << "GRETA CORE Runtime Bench: vk_gemm_auto_ts_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect(
+      "vk_gemm_auto_ts_bench", argc, argv, GRETA_BUILD_FEATURES);
   std::cout << "M=" << args.M << " N=" << args.N << " K=" << args.K
             << " iters=" << args.iters << " batch=" << args.batch << "\n";
 
@@ -113,6 +116,13 @@ int main(int argc, char **argv) {
   std::cout << "  name=" << info.name << "\n";
   std::cout << "  driver_name=" << info.driver_name << "\n";
   backend.print_diagnostics(std::cout);
+  manifest.param("device", info.name);
+  manifest.param("driver", info.driver_name);
+  manifest.param("m", args.M);
+  manifest.param("n", args.N);
+  manifest.param("k", args.K);
+  manifest.param("iters", args.iters);
+  manifest.param("batch", args.batch);
 
   if (backend.gpu_blacklisted()) {
     std::cout << "SKIPPED: GPU blacklisted: " << backend.blacklist_reason()
@@ -186,6 +196,10 @@ int main(int argc, char **argv) {
     std::cout << "AUTOTUNE FINAL WINNER:\n";
     std::cout << "  winner=" << chosen << "\n";
     std::cout << "  cache_path=" << cache.path() << "\n";
+    manifest.param("winner", chosen);
+    manifest.status = "OK";
+    if (!manifest.emit(&berr))
+      std::cerr << "Manifest export failed: " << berr << "\n";
     std::cout << "STATUS=OK\n";
     return 0;
   }
@@ -205,6 +219,13 @@ int main(int argc, char **argv) {
   std::cout << "\nAUTOTUNE FINAL WINNER:\n";
   std::cout << "  winner=" << rr.winner << "\n";
   std::cout << "  cache_path=" << rr.cache_path << "\n";
+
+  // The candidates' own manifests (if any) carry the timings; this one
+  // records which kernel won.
+  manifest.param("winner", rr.winner);
+  manifest.status = "OK";
+  if (!manifest.emit(&berr))
+    std::cerr << "Manifest export failed: " << berr << "\n";
   std::cout << "STATUS=OK\n";
   return 0;
 }
@@ -1,3 +1,5 @@
+#include "gcore/rt/run_manifest.hpp"
+
 #include <vulkan/vulkan.h>
 
 #include <algorithm>
@@ -209,6 +211,8 @@ int main(int argc, char **argv) {
   }
 
   std::cout << "GRETA CORE Runtime Bench: vk_gemm_f16acc32_subgroup_ts_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect(
+      "vk_gemm_f16acc32_subgroup_ts_bench", argc, argv, GRETA_BUILD_FEATURES);
   std::cout << "M=" << M << " N=" << N << " K=" << K << " iters=" << iters
             << " batch=" << batch << "\n";
 
@@ -250,6 +254,11 @@ int main(int argc, char **argv) {
     }
   }
   print_device(phy);
+  {
+    VkPhysicalDeviceProperties p{};
+    vkGetPhysicalDeviceProperties(phy, &p);
+    manifest.param("device", p.deviceName);
+  }
 
   // --- Subgroup properties + size control props ---
   VkPhysicalDeviceSubgroupProperties sg{
@@ -719,6 +728,17 @@ int main(int argc, char **argv) {
             << "  kernel_p99_ms=" << p99 << "\n";
   std::cout << "  mean_TFLOPs=" << mean_tflops << "  p50_TFLOPs=" << p50_tflops
             << "  p99_TFLOPs=" << p99_tflops << "\n";
+
+  manifest.param("m", M);
+  manifest.param("n", N);
+  manifest.param("k", K);
+  manifest.param("iters", iters);
+  manifest.param("batch", batch);
+  manifest.metric("kernel_ms", "ms", gcore::rt::MetricBetter::Lower, samples);
+  manifest.status = "OK";
+  std::string err;
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
   std::cout << "STATUS=OK\n";
 
   vkDeviceWaitIdle(dev);
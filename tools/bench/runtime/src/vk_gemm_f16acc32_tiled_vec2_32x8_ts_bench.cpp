@@ -1,5 +1,6 @@
 #include "gcore/rt/vk/backend.hpp"
 #include "gcore/rt/vk/buffer.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <algorithm>
 #include <cmath>
@@ -122,6 +123,9 @@ int main(int argc, char **argv) {
 
   std::cout << "GRETA CORE Runtime Bench: "
                "vk_gemm_f16acc32_tiled_vec2_32x8_ts_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect(
+      "vk_gemm_f16acc32_tiled_vec2_32x8_ts_bench", argc, argv,
+      GRETA_BUILD_FEATURES);
   std::cout << "M=" << M << " N=" << N << " K=" << K << " iters=" << iters
             << " batch=" << batch << "\n";
 
@@ -148,6 +152,8 @@ int main(int argc, char **argv) {
   std::cout << "  name=" << info.name << "\n";
   std::cout << "  driver_name=" << info.driver_name << "\n";
   b.print_diagnostics(std::cout);
+  manifest.param("device", info.name);
+  manifest.param("driver", info.driver_name);
 
   if (b.gpu_blacklisted()) {
     std::cout << "SKIPPED: GPU blacklisted: " << b.blacklist_reason() << "\n";
@@ -537,6 +543,17 @@ int main(int argc, char **argv) {
     std::cerr << "No kernel timestamp samples collected.\n";
     timing_ok = false;
   }
+  manifest.param("m", M);
+  manifest.param("n", N);
+  manifest.param("k", K);
+  manifest.param("iters", iters);
+  manifest.param("batch", batch);
+  manifest.metric("kernel_ms", "ms", gcore::rt::MetricBetter::Lower,
+                  kernel_ms);
+  manifest.status = timing_ok && validation_ok ? "OK" : "FAILED";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
   if (!timing_ok) {
     std::cout << "STATUS=FAILED reason=\"no_timing\"\n";
   } else if (!validation_ok) {
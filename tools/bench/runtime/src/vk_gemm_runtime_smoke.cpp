@@ -3,6 +3,7 @@
 #include "gcore/rt/vk/gemm.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
@@ -546,6 +547,146 @@ static bool dispatch_fill_u32(VkDevice dev, VkCommandBuffer cmd,
   return true;
 }
 
+// CPU cost of recording one GEMM dispatch (nothing is submitted):
+// [0] legacy: descriptor pool created, set written and pool destroyed per
+//     dispatch (what the runtime did before its descriptor cache),
+// [1] uncached: GemmF32 writing a fresh set per dispatch,
+// [2] cached: GemmF32 rebinding the set written once for (A, B, C).
+// `first_record_ms`: GemmF32 init + first record_dispatch (SPIR-V, pipeline
+// creation through the on-disk pipeline cache), i.e. startup cost.
+static bool measure_record_overhead(gcore::rt::vk::Backend &backend,
+                                    const std::string &shader_dir, VkBuffer A,
+                                    VkBuffer B, VkBuffer C, uint32_t M,
+                                    uint32_t N, uint32_t K, uint32_t lda,
+                                    uint32_t ldb, uint32_t ldc, uint32_t iters,
+                                    double us_per_dispatch[3],
+                                    double *first_record_ms,
+                                    std::string *err) {
+  using clock = std::chrono::steady_clock;
+  const VkDevice dev = backend.device();
+
+  VkCommandBufferAllocateInfo cbai{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+  cbai.commandPool = backend.command_pool();
+  cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cbai.commandBufferCount = 3;
+  VkCommandBuffer cmds[3] = {};
+  if (vkAllocateCommandBuffers(dev, &cbai, cmds) != VK_SUCCESS) {
+    if (err)
+      *err = "vkAllocateCommandBuffers failed";
+    return false;
+  }
+  VkCommandBufferBeginInfo bi{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  for (VkCommandBuffer c : cmds)
+    vkBeginCommandBuffer(c, &bi);
+
+  VkDispatchResources res;
+  gcore::rt::vk::GemmF32 gemm;
+  gcore::rt::vk::GemmDispatchDesc d{A, B, C, M, N, K, lda, ldb, ldc};
+  std::vector<VkDescriptorPool> pools;
+  pools.reserve(iters);
+  bool ok = true;
+
+  // Legacy: pipeline/layouts built once outside the timed loop. Pools are
+  // destroyed after recording (the old code did it mid-recording) and that
+  // time is added back.
+  ok = dispatch_gemm_f32(dev, backend.physical_device(), cmds[0],
+                         std::filesystem::path(shader_dir) /
+                             "gemm_f32_tiled.comp.spv",
+                         A, B, C, M, N, K, lda, ldb, ldc, &res, err);
+  if (ok) {
+    VkDescriptorPoolSize ps{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3};
+    VkDescriptorPoolCreateInfo dpci{
+        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    dpci.maxSets = 1;
+    dpci.poolSizeCount = 1;
+    dpci.pPoolSizes = &ps;
+    PushConsts pc{M, N, K, lda, ldb, ldc};
+
+    auto t0 = clock::now();
+    for (uint32_t i = 0; i < iters && ok; i++) {
+      VkDescriptorPool dp = VK_NULL_HANDLE;
+      if (vkCreateDescriptorPool(dev, &dpci, nullptr, &dp) != VK_SUCCESS) {
+        ok = false;
+        break;
+      }
+      pools.push_back(dp);
+      VkDescriptorSetAllocateInfo dsai{
+          VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+      dsai.descriptorPool = dp;
+      dsai.descriptorSetCount = 1;
+      dsai.pSetLayouts = &res.dsl;
+      VkDescriptorSet ds = VK_NULL_HANDLE;
+      if (vkAllocateDescriptorSets(dev, &dsai, &ds) != VK_SUCCESS) {
+        ok = false;
+        break;
+      }
+      VkDescriptorBufferInfo db[3] = {{A, 0, VK_WHOLE_SIZE},
+                                      {B, 0, VK_WHOLE_SIZE},
+                                      {C, 0, VK_WHOLE_SIZE}};
+      VkWriteDescriptorSet wr[3]{};
+      for (uint32_t b = 0; b < 3; b++) {
+        wr[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        wr[b].dstSet = ds;
+        wr[b].dstBinding = b;
+        wr[b].descriptorCount = 1;
+        wr[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        wr[b].pBufferInfo = &db[b];
+      }
+      vkUpdateDescriptorSets(dev, 3, wr, 0, nullptr);
+      vkCmdBindPipeline(cmds[0], VK_PIPELINE_BIND_POINT_COMPUTE, res.pipe);
+      vkCmdBindDescriptorSets(cmds[0], VK_PIPELINE_BIND_POINT_COMPUTE, res.pl,
+                              0, 1, &ds, 0, nullptr);
+      vkCmdPushConstants(cmds[0], res.pl, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                         sizeof(PushConsts), &pc);
+      vkCmdDispatch(cmds[0], (N + 15u) / 16u, (M + 15u) / 16u, 1);
+    }
+    auto t1 = clock::now();
+    vkEndCommandBuffer(cmds[0]);
+    auto t2 = clock::now();
+    for (VkDescriptorPool dp : pools)
+      vkDestroyDescriptorPool(dev, dp, nullptr);
+    auto t3 = clock::now();
+    if (!ok && err)
+      *err = "legacy descriptor pool/set allocation failed";
+    us_per_dispatch[0] =
+        std::chrono::duration<double, std::micro>((t1 - t0) + (t3 - t2))
+            .count() /
+        double(iters);
+  }
+
+  // Runtime: the first record_dispatch per mode (pipeline, first write)
+  // stays out of the per-dispatch numbers.
+  auto ti = clock::now();
+  if (ok)
+    ok = gemm.init(&backend, shader_dir, err);
+  for (int mode = 1; mode <= 2 && ok; mode++) {
+    gemm.set_descriptor_caching(mode == 2);
+    ok = gemm.record_dispatch(cmds[mode], d, err);
+    if (mode == 1)
+      *first_record_ms =
+          std::chrono::duration<double, std::milli>(clock::now() - ti)
+              .count();
+    auto t0 = clock::now();
+    for (uint32_t i = 0; i < iters && ok; i++)
+      ok = gemm.record_dispatch(cmds[mode], d, err);
+    auto t1 = clock::now();
+    us_per_dispatch[mode] =
+        std::chrono::duration<double, std::micro>(t1 - t0).count() /
+        double(iters);
+  }
+
+  vkEndCommandBuffer(cmds[1]);
+  vkEndCommandBuffer(cmds[2]);
+  // Never submitted: their sets can go back to the pool right away.
+  gemm.retire(cmds[1]);
+  gemm.retire(cmds[2]);
+  vkFreeCommandBuffers(dev, backend.command_pool(), 3, cmds);
+  gemm.shutdown();
+  destroy_dispatch_resources(dev, &res);
+  return ok;
+}
+
 int main(int argc, char **argv) {
   int M = 8, N = 8, K = 8;
   for (int i = 1; i + 1 < argc; i++) {
@@ -565,6 +706,8 @@ int main(int argc, char **argv) {
   const bool allow_fp16_smoke = getenv_true("GRETA_VK_SMOKE_ALLOW_FP16");
   const std::string smoke_profile = getenv_str("GRETA_VK_SMOKE_PROFILE");
   const uint32_t smoke_tile = getenv_u32("GRETA_VK_SMOKE_TILE", 16);
+  const uint32_t record_iters =
+      getenv_u32("GRETA_VK_SMOKE_RECORD_ITERS", 256);
   std::string active_precision = "fp32";
   std::string fallback_reason;
 
@@ -976,6 +1119,7 @@ int main(int argc, char **argv) {
       cleanup_fp16();
       return 1;
     }
+    gemm.retire(cmd);
 
     if (!gcore::rt::vk::map_buffer(backend.device(), stageC, &pC, &err)) {
       std::cerr << "map_buffer(C) failed: " << err << "\n";
@@ -1232,6 +1376,22 @@ int main(int argc, char **argv) {
 
   std::cout << "max_abs_err=" << max_abs_err << "\n";
 
+  if (record_iters > 0 && max_abs_err <= 1e-2f) {
+    double us[3] = {0.0, 0.0, 0.0};
+    double first_ms = 0.0;
+    if (measure_record_overhead(backend, shader_dir, bufA.buf, bufB.buf,
+                                bufC.buf, M_run, N_run, K_run, uint32_t(lda),
+                                uint32_t(ldb), uint32_t(ldc), record_iters, us,
+                                &first_ms, &err)) {
+      std::cout << "RECORD: first_record_ms=" << first_ms << "\n";
+      std::cout << "RECORD: iters=" << record_iters
+                << " us_per_dispatch legacy=" << us[0]
+                << " uncached=" << us[1] << " cached=" << us[2] << "\n";
+    } else {
+      std::cout << "RECORD: skipped (" << err << ")\n";
+    }
+  }
+
   cleanup_fp32();
 
   if (max_abs_err > 1e-2f) {
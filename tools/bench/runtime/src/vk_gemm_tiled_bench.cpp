@@ -1,5 +1,6 @@
 #include "gcore/rt/vk/backend.hpp"
 #include "gcore/rt/vk/buffer.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <algorithm>
 #include <chrono>
@@ -71,6 +72,8 @@ int main(int argc, char **argv) {
   const int ldc = N;
 
   std::cout << "GRETA CORE Runtime Bench: vk_gemm_tiled_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect(
+      "vk_gemm_tiled_bench", argc, argv, GRETA_BUILD_FEATURES);
   std::cout << "M=" << M << " N=" << N << " K=" << K << " iters=" << iters
             << " compute_only=" << (compute_only ? 1 : 0) << "\n";
 
@@ -92,6 +95,8 @@ int main(int argc, char **argv) {
   std::cout << "  name=" << info.name << "\n";
   std::cout << "  driver_name=" << info.driver_name << "\n";
   b.print_diagnostics(std::cout);
+  manifest.param("device", info.name);
+  manifest.param("driver", info.driver_name);
 
   if (b.gpu_blacklisted()) {
     std::cout << "SKIPPED: GPU blacklisted: " << b.blacklist_reason() << "\n";
@@ -595,6 +600,19 @@ int main(int argc, char **argv) {
     std::cerr << "No timing samples collected.\n";
     timing_ok = false;
   }
+  manifest.param("m", M);
+  manifest.param("n", N);
+  manifest.param("k", K);
+  manifest.param("iters", iters);
+  manifest.param("compute_only", compute_only);
+  std::vector<double> iter_ms;
+  for (double s : secs)
+    iter_ms.push_back(s * 1e3);
+  manifest.metric("iter_ms", "ms", gcore::rt::MetricBetter::Lower, iter_ms);
+  manifest.status = timing_ok && validation_ok ? "OK" : "FAILED";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
   if (!timing_ok) {
     std::cout << "STATUS=FAILED reason=\"no_timing\"\n";
   } else if (!validation_ok) {
@@ -1,5 +1,6 @@
 #include "gcore/rt/vk/backend.hpp"
 #include "gcore/rt/vk/buffer.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <algorithm>
 #include <chrono>
@@ -96,6 +97,8 @@ int main(int argc, char **argv) {
   const double eps = argd(argc, argv, "--eps", 1e-5);
 
   std::cout << "GRETA CORE Runtime Bench: vk_layernorm_rmsnorm_fused_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect(
+      "vk_layernorm_rmsnorm_fused_bench", argc, argv, GRETA_BUILD_FEATURES);
   std::cout << "rows=" << rows << " cols=" << cols << " iters=" << iters
             << "\n";
 
@@ -117,6 +120,8 @@ int main(int argc, char **argv) {
   std::cout << "  name=" << info.name << "\n";
   std::cout << "  driver_name=" << info.driver_name << "\n";
   b.print_diagnostics(std::cout);
+  manifest.param("device", info.name);
+  manifest.param("driver", info.driver_name);
 
   if (b.gpu_blacklisted()) {
     std::cout << "SKIPPED: GPU blacklisted: " << b.blacklist_reason() << "\n";
@@ -533,6 +538,14 @@ int main(int argc, char **argv) {
   vkDestroyDescriptorSetLayout(dev, dsl, nullptr);
   vkDestroyShaderModule(dev, shader, nullptr);
 
+  manifest.param("rows", rows);
+  manifest.param("cols", cols);
+  manifest.param("iters", iters);
+  manifest.metric("iter_ms", "ms", gcore::rt::MetricBetter::Lower, samples);
+  manifest.status = timing_ok && validation_ok ? "OK" : "FAILED";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
   if (!timing_ok) {
     std::cout << "STATUS=FAILED reason=no_timing\n";
     return 1;
@@ -1,4 +1,5 @@
 #include "gcore/rt/vk/backend.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <chrono>
 #include <cstdint>
@@ -6,8 +7,10 @@
 #include <iostream>
 #include <string>
 
-int main() {
+int main(int argc, char **argv) {
   std::cout << "GRETA CORE Runtime Bench: vk_smoke_bench\n";
+  auto manifest = gcore::rt::RunManifest::collect("vk_smoke_bench", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
 
   gcore::rt::vk::Backend b;
   std::string err;
@@ -32,6 +35,8 @@ int main() {
   std::cout << "  name=" << info.name << "\n";
   std::cout << "  driver_name=" << info.driver_name << "\n";
   b.print_diagnostics(std::cout);
+  manifest.param("device", info.name);
+  manifest.param("driver", info.driver_name);
 
   if (b.gpu_blacklisted()) {
     std::cout << "SKIPPED: GPU blacklisted: " << b.blacklist_reason() << "\n";
@@ -61,6 +66,14 @@ int main() {
   std::cout << "  init_ms=" << (init_ns / 1e6) << "\n";
   std::cout << "  empty_submit_wait_ms=" << (submit_ns / 1e6) << "\n";
   std::cout << "  empty_submit_total_ms=" << (total_submit_ns / 1e6) << "\n";
+
+  manifest.metric("init_ms", "ms", gcore::rt::MetricBetter::Lower,
+                  init_ns / 1e6);
+  manifest.metric("empty_submit_total_ms", "ms",
+                  gcore::rt::MetricBetter::Lower, total_submit_ns / 1e6);
+  manifest.status = "OK";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
   std::cout << "STATUS=OK\n";
 
   return 0;
@@ -3,6 +3,11 @@
 #include "gcore/inference/model_config.hpp"
 #include "gcore/inference/tokenizer.hpp"
 #include "gcore/inference/weight_loader.hpp"
+#include "gcore/rt/cpu_sampler.hpp"
+#include "gcore/rt/metrics.hpp"
+#include "gcore/rt/profiler.hpp"
+#include "gcore/rt/roofline.hpp"
+#include "gcore/rt/run_manifest.hpp"
 
 #include <cstdlib>
 #include <cstring>
@@ -23,6 +28,11 @@ void print_usage() {
       << "  --top-k <k>         Top-K sampling (default: 50)\n"
       << "  --greedy            Use greedy decoding\n"
       << "  --demo-tokenizer    Force fallback ASCII tokenizer\n"
+      << "  --profile-cpu <path> Sample host CPU stacks; write folded stacks\n"
+      << "                      (flamegraph input), or a flat + call-tree\n"
+      << "                      report for a .txt path\n"
+      << "  --manifest <path>   Write a JSON run manifest (build, host, env,\n"
+      << "                      results); a directory gets a new file\n"
       << "  --help              Show this help\n";
 }
 
@@ -33,6 +43,10 @@ int main(int argc, char *argv[]) {
   std::cout
       << "╚══════════════════════════════════════════════════════════╝\n\n";
 
+  // --manifest <path> or GRETA_MANIFEST_OUT: JSON record of the run.
+  auto manifest = gcore::rt::RunManifest::collect("greta_infer", argc, argv,
+                                                  GRETA_BUILD_FEATURES);
+
   // Default parameters
   std::string model_path;
   std::string prompt = "Hello, I am a language model";
@@ -45,6 +59,9 @@ int main(int argc, char *argv[]) {
 
   bool force_demo_tokenizer = false;
   bool enable_alignment = false;
+  // GRETA_PROFILE_CPU=<path> is the environment form of --profile-cpu.
+  const char *cpu_profile_env = std::getenv("GRETA_PROFILE_CPU");
+  std::string cpu_profile_path = cpu_profile_env ? cpu_profile_env : "";
 
   // Parse arguments
   for (int i = 1; i < argc; ++i) {
@@ -73,12 +90,26 @@ int main(int argc, char *argv[]) {
       force_demo_tokenizer = true;
     } else if (strcmp(argv[i], "--alignment") == 0) {
       enable_alignment = true;
+    } else if (strcmp(argv[i], "--profile-cpu") == 0 && i + 1 < argc) {
+      cpu_profile_path = argv[++i];
+    } else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+      ++i; // Read by RunManifest::output_path()
     } else if (strcmp(argv[i], "--help") == 0) {
       print_usage();
       return 0;
     }
   }
 
+  // Started first so model loading and tokenization are in the profile.
+  auto &cpu_sampler = gcore::rt::CpuSampler::global();
+  if (!cpu_profile_path.empty()) {
+    std::string err;
+    if (!cpu_sampler.start(gcore::rt::CpuSampler::hz_from_env(), &err)) {
+      std::cerr << "CPU profiling disabled: " << err << "\n";
+      cpu_profile_path.clear();
+    }
+  }
+
   std::cout << "Configuration:\n";
   std::cout << "  Model: " << (model_path.empty() ? "(demo mode)" : model_path)
             << "\n";
@@ -88,6 +119,27 @@ int main(int argc, char *argv[]) {
   std::cout << "  Top-K: " << params.top_k << "\n";
   std::cout << "  Greedy: " << (params.greedy ? "yes" : "no") << "\n";
 
+  // GRETA_METRICS_OUT: export runtime metrics to a file or unix: socket.
+  gcore::rt::MetricsFlusher metrics_flusher;
+  {
+    std::string err;
+    if (!metrics_flusher.start_from_env(&err) && !err.empty())
+      std::cerr << "Metrics export disabled: " << err << "\n";
+  }
+
+  // GRETA_PROFILE_TRACE: Chrome trace (Perfetto) of loader/layer/sampler
+  // spans, written on exit.
+  auto &profiler = gcore::rt::Profiler::global();
+  profiler.init_from_env();
+  // GRETA_PROFILE_ROOFLINE: per-op/per-layer FLOP and byte rates against
+  // GRETA_ROOFLINE_PEAK_GFLOPS / _GBPS, written on exit (text, or JSON for a
+  // .json path). Needs the spans, so it enables the profiler too.
+  const char *roofline_path = std::getenv("GRETA_PROFILE_ROOFLINE");
+  if (roofline_path && *roofline_path)
+    profiler.set_enabled(true);
+  else
+    roofline_path = nullptr;
+
   const char *verbose_info = std::getenv("GRETA_VERBOSE_INFO");
   if (verbose_info && std::string(verbose_info) == "1") {
     int hip_ver = 0;
@@ -263,6 +315,71 @@ int main(int argc, char *argv[]) {
             << " ms\n";
   std::cout << "  Tokens/second: " << stats.tokens_per_second << "\n";
 
+  auto &metrics = gcore::rt::MetricsRegistry::global();
+  metrics.gauge("greta_prompt_tokens").set(stats.prompt_tokens);
+  metrics.gauge("greta_generated_tokens").set(stats.generated_tokens);
+  metrics.gauge("greta_ttft_ns", {}, "Time to first token (ns)")
+      .set(static_cast<int64_t>(stats.time_to_first_token_ms * 1e6));
+  metrics.gauge("greta_generation_ns", {}, "Total generation time (ns)")
+      .set(static_cast<int64_t>(stats.total_time_ms * 1e6));
+  metrics_flusher.stop(); // Final export
+
+  if (!cpu_profile_path.empty()) {
+    cpu_sampler.stop();
+    const auto cpu_profile = cpu_sampler.profile();
+    std::string err;
+    if (cpu_profile.write(cpu_profile_path, &err))
+      std::cout << "  CPU profile: " << cpu_profile_path << " ("
+                << cpu_profile.samples << " samples, "
+                << cpu_profile.dropped << " dropped)\n";
+    else
+      std::cerr << "CPU profile export failed: " << err << "\n";
+  }
+  if (profiler.enabled() && !profiler.trace_path().empty()) {
+    std::string err;
+    if (profiler.write_chrome_trace(profiler.trace_path(), &err))
+      std::cout << "  Trace: " << profiler.trace_path()
+                << " (dropped spans: " << profiler.dropped() << ")\n";
+    else
+      std::cerr << "Trace export failed: " << err << "\n";
+  }
+  if (roofline_path) {
+    const auto report = gcore::rt::RooflineReport::build(
+        profiler.events(), gcore::rt::RooflinePeaks::from_env());
+    std::string err;
+    if (report.write(roofline_path, &err))
+      std::cout << "  Roofline: " << roofline_path << "\n";
+    else
+      std::cerr << "Roofline export failed: " << err << "\n";
+  }
+
+  manifest.param("model", model_path.empty() ? "(demo)" : model_path);
+  manifest.param("layers", config.num_layers);
+  manifest.param("dim", config.dim);
+  manifest.param("heads", config.num_heads);
+  manifest.param("heads_kv", config.num_heads_kv);
+  manifest.param("vocab", config.vocab_size);
+  manifest.param("batch_size", batch_size);
+  manifest.param("max_seq_len", max_seq_len);
+  manifest.param("max_tokens", params.max_tokens);
+  manifest.param("greedy", params.greedy ? "yes" : "no");
+  manifest.param("temperature", params.temperature);
+  manifest.param("top_k", params.top_k);
+  manifest.param("prompt_tokens", stats.prompt_tokens);
+  manifest.param("generated_tokens", stats.generated_tokens);
+  manifest.metric("tokens_per_second", "tokens/s",
+                  gcore::rt::MetricBetter::Higher, stats.tokens_per_second);
+  manifest.metric("ttft_ms", "ms", gcore::rt::MetricBetter::Lower,
+                  stats.time_to_first_token_ms);
+  manifest.metric("total_ms", "ms", gcore::rt::MetricBetter::Lower,
+                  stats.total_time_ms);
+  if (!stats.decode_step_ms.empty())
+    manifest.metric("decode_step_ms", "ms", gcore::rt::MetricBetter::Lower,
+                    stats.decode_step_ms);
+  manifest.status = "OK";
+  if (!manifest.emit(&err))
+    std::cerr << "Manifest export failed: " << err << "\n";
+
   std::cout << "\nSTATUS=OK\n";
   return 0;
 }
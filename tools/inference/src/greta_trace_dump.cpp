@@ -0,0 +1,400 @@
+// greta_trace_dump: print, summarize or diff binary stage/layer traces
+// (GRETA_TRACE_FORMAT=bin).
+
+#include "gcore/inference/trace_format.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace gcore::inference;
+
+namespace {
+
+struct Filter {
+  std::vector<int> layers;
+  std::vector<std::string> points;
+  std::vector<std::string> phases;
+  int64_t step_lo = -1;
+  int64_t step_hi = -1;
+
+  bool match(int layer, const char *point, const char *phase,
+             int64_t step) const {
+    if (!layers.empty()) {
+      bool hit = false;
+      for (int l : layers)
+        hit = hit || l == layer;
+      if (!hit)
+        return false;
+    }
+    if (!points.empty()) {
+      bool hit = false;
+      for (const auto &p : points)
+        hit = hit || p == point;
+      if (!hit)
+        return false;
+    }
+    if (!phases.empty()) {
+      bool hit = false;
+      for (const auto &p : phases)
+        hit = hit || p == phase;
+      if (!hit)
+        return false;
+    }
+    if (step_lo >= 0 && (step < step_lo || step > step_hi))
+      return false;
+    return true;
+  }
+};
+
+std::vector<std::string> split_csv(const char *v) {
+  std::vector<std::string> out;
+  std::string cur;
+  for (const char *p = v; *p; ++p) {
+    if (*p == ',') {
+      if (!cur.empty())
+        out.push_back(cur);
+      cur.clear();
+    } else {
+      cur.push_back(*p);
+    }
+  }
+  if (!cur.empty())
+    out.push_back(cur);
+  return out;
+}
+
+// Identity of a tensor record, shared by both runs of a diff.
+struct RecordKey {
+  int layer = 0;
+  int64_t step = -1; // -1 for records without a step (Json)
+  std::string point;
+  std::string phase;
+  std::string prompt;
+  bool tensor = false; // Tensor or Logits
+};
+
+RecordKey key_of(const TraceReader &rd, const TraceEvent &ev) {
+  RecordKey k;
+  switch (ev.type) {
+  case TraceChunk::Tensor:
+    k.tensor = true;
+    k.layer = ev.tensor.layer;
+    k.step = ev.tensor.step;
+    k.point = rd.str(ev.tensor.point);
+    k.phase = rd.str(ev.tensor.phase);
+    k.prompt = rd.str(ev.tensor.prompt);
+    break;
+  case TraceChunk::Logits:
+    k.tensor = true;
+    k.layer = -1;
+    k.step = ev.logits.step;
+    k.point = "logits";
+    k.phase = rd.str(ev.logits.phase);
+    k.prompt = rd.str(ev.logits.prompt);
+    break;
+  case TraceChunk::Step:
+    k.step = ev.step.step;
+    break;
+  default:
+    break;
+  }
+  return k;
+}
+
+std::string describe(const RecordKey &k) {
+  std::string s = "layer=" + std::to_string(k.layer) + " point=" + k.point +
+                  " step=" + std::to_string(k.step);
+  if (!k.phase.empty())
+    s += " phase=" + k.phase;
+  if (!k.prompt.empty())
+    s += " prompt=" + k.prompt;
+  return s;
+}
+
+struct Snapshot {
+  uint64_t hash = 0;
+  float mean = 0.0f;
+  uint32_t nan = 0;
+  uint32_t inf = 0;
+  std::vector<float> payload;
+  bool matched = false;
+};
+
+Snapshot snapshot_of(TraceEvent &ev) {
+  Snapshot s;
+  if (ev.type == TraceChunk::Logits) {
+    s.hash = ev.logits.hash;
+    s.mean = ev.logits.mean;
+  } else {
+    s.hash = ev.tensor.hash;
+    s.mean = ev.tensor.mean;
+    s.nan = ev.tensor.nan;
+    s.inf = ev.tensor.inf;
+    s.payload.swap(ev.payload);
+  }
+  return s;
+}
+
+// Tensor records repeat with the same identity (e.g. one per prompt run in
+// an appended file); the n-th occurrence in one run pairs with the n-th in
+// the other.
+std::string map_key(const RecordKey &k,
+                    std::unordered_map<std::string, uint32_t> &occurrences) {
+  std::string id = k.prompt + '\x1f' + k.phase + '\x1f' + k.point + '\x1f' +
+                   std::to_string(k.layer) + '\x1f' + std::to_string(k.step);
+  const uint32_t n = occurrences[id]++;
+  return id + '\x1f' + std::to_string(n);
+}
+
+int dump(const std::string &path, const Filter &filter) {
+  TraceReader rd;
+  std::string err;
+  if (!rd.open(path, &err)) {
+    std::cerr << err << "\n";
+    return 2;
+  }
+  TraceEvent ev;
+  std::string line;
+  while (rd.next(&ev, &err)) {
+    const RecordKey k = key_of(rd, ev);
+    if (k.tensor && !filter.match(k.layer, k.point.c_str(), k.phase.c_str(),
+                                  k.step))
+      continue;
+    if (ev.type == TraceChunk::Step && filter.step_lo >= 0 &&
+        (k.step < filter.step_lo || k.step > filter.step_hi))
+      continue;
+    line = trace_event_json(rd, ev);
+    line.push_back('\n');
+    std::fwrite(line.data(), 1, line.size(), stdout);
+  }
+  if (!err.empty()) {
+    std::cerr << err << "\n";
+    return 2;
+  }
+  return 0;
+}
+
+int summary(const std::string &path, const Filter &filter) {
+  TraceReader rd;
+  std::string err;
+  if (!rd.open(path, &err)) {
+    std::cerr << err << "\n";
+    return 2;
+  }
+  struct Count {
+    uint64_t records = 0;
+    uint64_t nan = 0;
+    uint64_t inf = 0;
+    int64_t step_max = -1;
+  };
+  std::map<std::string, Count> by_point;
+  uint64_t steps = 0, json = 0;
+  TraceEvent ev;
+  while (rd.next(&ev, &err)) {
+    const RecordKey k = key_of(rd, ev);
+    if (!k.tensor) {
+      steps += ev.type == TraceChunk::Step;
+      json += ev.type == TraceChunk::Json;
+      continue;
+    }
+    if (!filter.match(k.layer, k.point.c_str(), k.phase.c_str(), k.step))
+      continue;
+    Count &c = by_point[k.point];
+    c.records++;
+    if (ev.type == TraceChunk::Tensor) {
+      c.nan += ev.tensor.nan;
+      c.inf += ev.tensor.inf;
+    }
+    if (k.step > c.step_max)
+      c.step_max = k.step;
+  }
+  std::cout << "sessions=" << rd.sessions() << " step_headers=" << steps
+            << " json_lines=" << json << "\n";
+  std::cout << "point\trecords\tmax_step\tnan\tinf\n";
+  for (const auto &kv : by_point)
+    std::cout << kv.first << "\t" << kv.second.records << "\t"
+              << kv.second.step_max << "\t" << kv.second.nan << "\t"
+              << kv.second.inf << "\n";
+  if (!err.empty()) {
+    std::cerr << err << "\n";
+    return 2;
+  }
+  return 0;
+}
+
+// Streams run A into a map, then compares run B against it in B's order, so
+// the first reported difference is the earliest one in execution order.
+int diff(const std::string &a_path, const std::string &b_path,
+         const Filter &filter, double tol, uint32_t max_report) {
+  TraceReader a, b;
+  std::string err;
+  if (!a.open(a_path, &err) || !b.open(b_path, &err)) {
+    std::cerr << err << "\n";
+    return 2;
+  }
+
+  std::unordered_map<std::string, Snapshot> recs;
+  std::unordered_map<std::string, RecordKey> keys;
+  std::unordered_map<std::string, uint32_t> occ;
+  std::vector<std::string> order;
+  TraceEvent ev;
+  uint64_t n_a = 0;
+  while (a.next(&ev, &err)) {
+    const RecordKey k = key_of(a, ev);
+    if (!k.tensor ||
+        !filter.match(k.layer, k.point.c_str(), k.phase.c_str(), k.step))
+      continue;
+    const std::string id = map_key(k, occ);
+    recs[id] = snapshot_of(ev);
+    keys[id] = k;
+    order.push_back(id);
+    ++n_a;
+  }
+  if (!err.empty()) {
+    std::cerr << err << "\n";
+    return 2;
+  }
+
+  occ.clear();
+  uint64_t n_b = 0, matched = 0, differ = 0, only_b = 0, reported = 0;
+  std::string first;
+  while (b.next(&ev, &err)) {
+    const RecordKey k = key_of(b, ev);
+    if (!k.tensor ||
+        !filter.match(k.layer, k.point.c_str(), k.phase.c_str(), k.step))
+      continue;
+    ++n_b;
+    const std::string id = map_key(k, occ);
+    auto it = recs.find(id);
+    if (it == recs.end()) {
+      ++only_b;
+      continue;
+    }
+    Snapshot &sa = it->second;
+    const Snapshot sb = snapshot_of(ev);
+    sa.matched = true;
+
+    bool same = sa.hash == sb.hash;
+    double max_abs = -1.0;
+    if (!sa.payload.empty() && sa.payload.size() == sb.payload.size()) {
+      max_abs = 0.0;
+      for (size_t i = 0; i < sa.payload.size(); ++i) {
+        const double d = std::fabs(double(sa.payload[i]) - sb.payload[i]);
+        if (d > max_abs || std::isnan(d))
+          max_abs = std::isnan(d) ? INFINITY : d;
+      }
+      if (!same && tol > 0.0)
+        same = max_abs <= tol;
+    }
+    if (same) {
+      ++matched;
+      continue;
+    }
+    ++differ;
+    if (first.empty())
+      first = describe(k);
+    if (reported++ < max_report) {
+      std::cout << "DIFF " << describe(k) << " hash=" << sa.hash << "/"
+                << sb.hash << " mean=" << sa.mean << "/" << sb.mean;
+      if (sa.nan != sb.nan || sa.inf != sb.inf)
+        std::cout << " nan=" << sa.nan << "/" << sb.nan << " inf=" << sa.inf
+                  << "/" << sb.inf;
+      if (max_abs >= 0.0)
+        std::cout << " max_abs=" << max_abs;
+      std::cout << "\n";
+    }
+  }
+  if (!err.empty()) {
+    std::cerr << err << "\n";
+    return 2;
+  }
+
+  uint64_t only_a = 0;
+  for (const std::string &id : order) {
+    if (recs[id].matched)
+      continue;
+    if (only_a++ < max_report)
+      std::cout << "ONLY_A " << describe(keys[id]) << "\n";
+  }
+  std::cout << "records_a=" << n_a << " records_b=" << n_b
+            << " matched=" << matched << " differ=" << differ
+            << " only_a=" << only_a << " only_b=" << only_b << "\n";
+  if (!first.empty())
+    std::cout << "first_divergence: " << first << "\n";
+  return (differ || only_a || only_b) ? 1 : 0;
+}
+
+void usage() {
+  std::cout
+      << "Usage: greta_trace_dump [filters] <trace>          JSONL to stdout\n"
+      << "       greta_trace_dump [filters] --summary <trace>\n"
+      << "       greta_trace_dump [filters] --diff <a> <b> [--tol X]\n"
+      << "                        [--max-report N]\n"
+      << "Filters: --layer L[,L..] --point P[,P..] --phase P[,P..]\n"
+      << "         --step N | --step A-B\n"
+      << "Diff exit status: 0 identical, 1 different, 2 error.\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Filter filter;
+  std::vector<std::string> files;
+  bool do_diff = false;
+  bool do_summary = false;
+  double tol = 0.0;
+  uint32_t max_report = 20;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--layer") == 0 && i + 1 < argc) {
+      for (const auto &l : split_csv(argv[++i]))
+        filter.layers.push_back(std::atoi(l.c_str()));
+    } else if (strcmp(argv[i], "--point") == 0 && i + 1 < argc) {
+      filter.points = split_csv(argv[++i]);
+    } else if (strcmp(argv[i], "--phase") == 0 && i + 1 < argc) {
+      filter.phases = split_csv(argv[++i]);
+    } else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+      const char *v = argv[++i];
+      const char *dash = std::strchr(v, '-');
+      filter.step_lo = std::atoll(v);
+      filter.step_hi = dash ? std::atoll(dash + 1) : filter.step_lo;
+    } else if (strcmp(argv[i], "--diff") == 0) {
+      do_diff = true;
+    } else if (strcmp(argv[i], "--summary") == 0) {
+      do_summary = true;
+    } else if (strcmp(argv[i], "--tol") == 0 && i + 1 < argc) {
+      tol = std::atof(argv[++i]);
+    } else if (strcmp(argv[i], "--max-report") == 0 && i + 1 < argc) {
+      max_report = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--help") == 0) {
+      usage();
+      return 0;
+    } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+      std::cerr << "Unknown option: " << argv[i] << "\n";
+      usage();
+      return 2;
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+
+  if (do_diff) {
+    if (files.size() != 2) {
+      usage();
+      return 2;
+    }
+    return diff(files[0], files[1], filter, tol, max_report);
+  }
+  if (files.size() != 1) {
+    usage();
+    return 2;
+  }
+  return do_summary ? summary(files[0], filter) : dump(files[0], filter);
+}